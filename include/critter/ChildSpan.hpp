@@ -0,0 +1,98 @@
+#ifndef CHILD_SPAN_H_
+#define CHILD_SPAN_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace monkeysworld {
+namespace critter {
+
+class Object;
+
+/**
+ *  Read-only view over an object's children, as raw pointers.
+ *
+ *  Unlike GetChildren, building or iterating a span doesn't allocate or touch any refcounts --
+ *  it just points at the owner's child list. That also means it's only good until that
+ *  list changes: grab a fresh one after adding or removing children.
+ */
+class ChildSpan {
+ public:
+  class iterator {
+   public:
+    iterator(const ChildSpan* span, size_t index) : span_(span), index_(index) {}
+    Object* operator*() const { return (*span_)[index_]; }
+    iterator& operator++() { index_++; return *this; }
+    bool operator==(const iterator& other) const { return index_ == other.index_; }
+    bool operator!=(const iterator& other) const { return index_ != other.index_; }
+   private:
+    const ChildSpan* span_;
+    size_t index_;
+  };
+
+  /**
+   *  Creates an empty span.
+   */
+  ChildSpan() : data_(nullptr), size_(0), get_(nullptr), share_(nullptr) {}
+
+  /**
+   *  Creates a span over a list of children.
+   *  @param children - list of some Object subclass.
+   */
+  template <typename T>
+  ChildSpan(const std::vector<std::shared_ptr<T>>& children)
+    : data_(children.data()), size_(children.size()), get_(&GetChild<T>), share_(&ShareChild<T>) {}
+
+  /**
+   *  @returns the number of children.
+   */
+  size_t GetSize() const {
+    return size_;
+  }
+
+  /**
+   *  @returns the child at `index`. Must be less than GetSize().
+   */
+  Object* operator[](size_t index) const {
+    return get_(data_, index);
+  }
+
+  /**
+   *  @returns a reference to the child at `index`, which keeps it alive after it leaves the list.
+   *           Must be less than GetSize().
+   */
+  std::shared_ptr<Object> Share(size_t index) const {
+    return share_(data_, index);
+  }
+
+  iterator begin() const {
+    return iterator(this, 0);
+  }
+
+  iterator end() const {
+    return iterator(this, size_);
+  }
+
+ private:
+  // T -> Object may need a pointer adjustment, so conversions go through a typed getter
+  template <typename T>
+  static Object* GetChild(const void* data, size_t index) {
+    return static_cast<const std::shared_ptr<T>*>(data)[index].get();
+  }
+
+  template <typename T>
+  static std::shared_ptr<Object> ShareChild(const void* data, size_t index) {
+    return static_cast<const std::shared_ptr<T>*>(data)[index];
+  }
+
+  const void* data_;
+  size_t size_;
+  Object* (*get_)(const void*, size_t);
+  std::shared_ptr<Object> (*share_)(const void*, size_t);
+};
+
+}
+}
+
+#endif  // CHILD_SPAN_H_
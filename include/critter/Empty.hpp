@@ -14,7 +14,10 @@ class Empty : public GameObject {
  public:
   
   // create a new empty
-  Empty(engine::Context* ctx) : GameObject(ctx) {}
+  Empty(engine::Context* ctx) : GameObject(ctx) {
+    // nothing to draw, so only the children count towards culling
+    SetLocalBounds(utils::EmptyBounds());
+  }
 
   // nop
   void PrepareAttributes() override {}
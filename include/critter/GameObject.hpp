@@ -6,6 +6,7 @@
 #include <engine/Context.hpp>
 #include <critter/Object.hpp>
 #include <critter/Camera.hpp>
+#include <critter/TransformHierarchy.hpp>
 
 #include <glm/glm.hpp>
 
@@ -49,6 +50,7 @@ class GameObject : public Object, public std::enable_shared_from_this<GameObject
   std::shared_ptr<Object> GetChild(uint64_t id) override;
 
   std::vector<std::shared_ptr<Object>> GetChildren() override;
+  ChildSpan GetChildSpan() override;
 
   /**
    *  Returns ptr to the object associated with this object.
@@ -57,9 +59,35 @@ class GameObject : public Object, public std::enable_shared_from_this<GameObject
 
   /**
    *  Returns the transformation matrix associated with this object.
+   *  World matrices are kept up to date by the context's TransformHierarchy,
+   *  so this is just a lookup unless something has moved since the last update pass.
    */ 
   glm::mat4 GetTransformationMatrix() const;
 
+  /**
+   *  Returns the normal matrix for this object's transformation,
+   *  computed alongside it by the context's TransformHierarchy.
+   */ 
+  glm::mat3 GetNormalMatrix() const;
+
+  /**
+   *  Returns the bounds of whatever this object draws, in world space.
+   *  Infinite unless a subclass sets its local bounds.
+   */
+  utils::aabb GetWorldBounds() const;
+
+  /**
+   *  Returns a box around this object's world bounds, and those of all its descendants,
+   *  as of the hierarchy's last update pass.
+   */
+  utils::aabb GetSubtreeBounds() const;
+
+  /**
+   *  Returns the hierarchy this object's transform is stored in. It's shared by the whole scene,
+   *  and answers spatial queries about it -- see TransformHierarchy::GetSpatialIndex.
+   */
+  std::shared_ptr<TransformHierarchy> GetTransformHierarchy() const;
+
   /**
    *  Sets XYZ position.
    */ 
@@ -80,7 +108,16 @@ class GameObject : public Object, public std::enable_shared_from_this<GameObject
    */ 
   virtual std::shared_ptr<Camera> GetActiveCamera();
 
+  /**
+   *  Called on the main thread once a frame containing this object has been simulated, before
+   *  it's drawn, while the simulation is idle. When frames are pipelined, the next frame's Update
+   *  runs while this one is drawn -- so anything RenderMaterial reads which Update might write
+   *  should be copied here, and drawn from the copy. Does nothing by default.
+   */
+  virtual void SyncRenderState();
+
   // getters for the above.
+  // references are valid until an object is next added to or removed from the scene.
   const glm::vec3& GetPosition() const;
   const glm::vec3& GetRotation() const;
   const glm::vec3& GetScale() const;
@@ -93,21 +130,42 @@ class GameObject : public Object, public std::enable_shared_from_this<GameObject
 
   // copy + move ctors are necessary lol
 
+  virtual ~GameObject();
+
  protected:
   /**
-   *  Remove a directly nested child
+   *  Remove a child, or anything nested under one, from its parent.
    */ 
   void RemoveChild(uint64_t id);
 
+  /**
+   *  Sets the bounds of whatever this object draws, in its own space.
+   *  Objects which draw nothing should pass utils::EmptyBounds(), so they don't hold up culling.
+   *  @param bounds - box around everything this object draws.
+   */
+  void SetLocalBounds(const utils::aabb& bounds);
+
   /**
    *  0-arg ctor for tests only.
    */ 
   GameObject();
 
  private:
-  glm::vec3 position;
-  glm::vec3 rotation;
-  glm::vec3 scale;
+  /**
+   *  Moves this object's transform, and those of all its descendants, into another hierarchy.
+   *  Used when a child from a different context is added to this object.
+   */
+  void SetTransformHierarchy(const std::shared_ptr<TransformHierarchy>& transforms);
+
+  /**
+   *  Creates a node for this object in `transforms` -- from this thread's reserve,
+   *  if there's a block scope.
+   */
+  TransformHierarchy::handle CreateTransform(const std::shared_ptr<TransformHierarchy>& transforms);
+
+  // where our transform is stored -- shared by everything in our context
+  std::shared_ptr<TransformHierarchy> transforms_;
+  TransformHierarchy::handle transform_;
 
   std::weak_ptr<GameObject> parent_;
   // These fields could become contentious if we're going multi-thread.
@@ -117,12 +175,6 @@ class GameObject : public Object, public std::enable_shared_from_this<GameObject
 
   // set of all children associated with this object
   std::vector<std::shared_ptr<GameObject>> children_;
-
-  // cached transformation matrix
-  glm::mat4 tf_matrix_cache_;
-
-  // whether or not the transformation matrix on store is safe.
-  std::atomic_bool dirty_;
 };
 
 } // namespace critter
@@ -25,7 +25,8 @@ class Model : public GameObject {
   Model(engine::Context* ctx);
 
   /**
-   *  Sets the mesh associated with this model instance.
+   *  Sets the mesh associated with this model instance, and bounds the model by it.
+   *  If the mesh's vertices are edited afterwards, set it again to update the bounds.
    *  @param mesh - shared ptr to a 3D mesh object.
    */ 
   void SetMesh(const std::shared_ptr<const model::Mesh<>>& mesh);
@@ -3,10 +3,14 @@
 
 #include <utils/IDGenerator.hpp>
 
+#include <critter/ChildSpan.hpp>
+#include <critter/ObjectRegistry.hpp>
+
 #include <engine/RenderContext.hpp>
 
 #include <engine/Context.hpp>
 
+#include <memory>
 #include <vector>
 
 // TBA: create forward decl headers in respective namespaces?
@@ -15,6 +19,7 @@ namespace monkeysworld {
 namespace critter {
 
 class Visitor;
+class TransformReservation;
 
 /**
  *  Superclass for all objects which occupy space in the scene.
@@ -68,9 +73,16 @@ class Object {
 
   /**
    *  Returns a list of all children.
+   *  This is a copy -- prefer GetChildSpan for anything that runs every frame.
    */ 
   virtual std::vector<std::shared_ptr<Object>> GetChildren() = 0;
 
+  /**
+   *  Returns a view over all children, without copying them.
+   *  The view is invalidated when children are added or removed.
+   */ 
+  virtual ChildSpan GetChildSpan() = 0;
+
   /**
    *  Returns ptr to the parent object.
    */ 
@@ -88,7 +100,8 @@ class Object {
   /**
    *  Changes the ID associated with this view.
    * 
-   *  For now, does not freak out if duplicate IDs are generated.
+   *  For now, does not freak out if duplicate IDs are generated --
+   *  lookups will return whichever matching object is under the caller.
    *  Assigned IDs might conflict with default IDs, keep the custom value
    *  sufficiently high to avoid clashes.
    */ 
@@ -112,22 +125,150 @@ class Object {
    */ 
   virtual void Destroy();
 
+  /**
+   *  Opts this object in to parallel updates. Objects which return true may have Update
+   *  called on a worker thread, at the same time as other objects -- see ParallelUpdater.
+   *
+   *  While updating on a worker, an object may read anything it owns and set its own position,
+   *  rotation and scale. It must not add or remove children, read world matrices, or touch GL:
+   *  anything like that should be handed to the main thread through
+   *  GetContext()->GetExecutor()->ScheduleOnMainThread, without waiting on the result.
+   *
+   *  @returns true if Update is safe to call off the main thread. False by default.
+   */ 
+  virtual bool IsUpdateThreadSafe();
+
   Object(const Object& other);
   Object(Object&& other);
   Object& operator=(const Object& other);
   Object& operator=(Object&& other);
 
-  // nop -- just there so that we get dtor behavior in all subclasses
-  virtual ~Object() {};
+  virtual ~Object();
+
+  /**
+   *  While one of these exists, objects created on the same thread take their IDs from blocks
+   *  reserved up front, rather than drawing them one at a time from the generator all objects share.
+   *  Their transforms come from nodes reserved a block at a time (see TransformReservation), and
+   *  objects attached to a parent are handed to the registry a block at a time, so that the
+   *  scene's locks are taken once per block rather than once per object.
+   *  Worth it when several threads are spawning lots of objects at once -- i.e. loading scenes.
+   *  (Spawning from several threads is fine as long as the scene isn't updating or drawing
+   *  meanwhile -- see TransformHierarchy.)
+   *
+   *  Lookups from this thread see everything attached so far. Other threads only see objects
+   *  once their block is handed over, and at the latest when the scope ends -- so objects attached
+   *  under a scope shouldn't have their IDs changed from other threads until then.
+   *  Transforms left over when the scope ends are released. Leftover IDs are discarded -- the
+   *  generator never hands them out again, so a scope costs up to `block_size` unused IDs.
+   */
+  class IdBlockScope {
+   public:
+    /**
+     *  @param block_size - number of IDs (and transforms, and registrations) to batch at a time.
+     */
+    IdBlockScope(uint64_t block_size = 256);
+    ~IdBlockScope();
 
-  // tba: noop v. dtor to ensure proper behavior
+    IdBlockScope(const IdBlockScope& other) = delete;
+    IdBlockScope& operator=(const IdBlockScope& other) = delete;
 
+   private:
+    friend class Object;
 
+    /**
+     *  Queues an object to be added to `registry`, handing over the queue first
+     *  if it's full or meant for another registry.
+     */
+    void QueueRegistration(const std::shared_ptr<ObjectRegistry>& registry,
+                           Object* object, uint64_t id, const std::weak_ptr<Object>& ref);
+
+    /**
+     *  Hands queued objects over to their registry.
+     */
+    void FlushRegistrations();
+
+    uint64_t block_size_;
+    utils::id_block block_;
+    IdBlockScope* prev_;
+
+    std::shared_ptr<ObjectRegistry> registry_;
+    std::vector<ObjectRegistry::registration> registrations_;
+    std::unique_ptr<TransformReservation> transforms_;
+  };
+
+ protected:
+  /**
+   *  Finds an object under this one by ID, through the registry rather than by searching.
+   *  Costs the depth of each object with that ID -- usually just the one.
+   *  @param id - ID of the desired object.
+   *  @returns a child, grandchild, etc. with the given ID -- or null if there isn't one.
+   */
+  std::shared_ptr<Object> FindDescendant(uint64_t id);
+
+  /**
+   *  Walks up the tree from this object.
+   *  @param object - the object we're looking for.
+   *  @returns true if `object` is a parent, grandparent, etc. of this object.
+   */
+  bool HasAncestor(Object* object);
+
+  /**
+   *  @returns the registry this object is currently listed in.
+   */
+  std::shared_ptr<ObjectRegistry> GetRegistry() const;
+
+  /**
+   *  Moves this object, and everything under it, over to another registry.
+   *  Called when a subtree is attached to a parent in another scene.
+   *  @param registry - the new registry.
+   */
+  void SetRegistry(std::shared_ptr<ObjectRegistry> registry);
+
+  /**
+   *  Moves this object, and everything under it, over to a parent's registry -- and lets the
+   *  registry hand this object out, so that FindDescendant can find it. Call from AddChild.
+   *  @param self - the shared_ptr which owns this object.
+   *  @param registry - the parent's registry.
+   */
+  void Attach(const std::shared_ptr<Object>& self, std::shared_ptr<ObjectRegistry> registry);
+
+  /**
+   *  @returns the transforms reserved for this thread's innermost block scope,
+   *           or null if there's no scope.
+   */
+  static TransformReservation* GetTransformReservation();
 
  private:
+  /**
+   *  Adds this object to its registry under its current ID -- or queues it, in a block scope.
+   *  @param ref - the shared_ptr which owns this object.
+   */
+  void Register(const std::weak_ptr<Object>& ref);
+
+  /**
+   *  Removes this object from its registry, if it's in it.
+   *  @returns the reference it was registered with.
+   */
+  std::weak_ptr<Object> Unregister();
+
+  /**
+   *  Hands over registrations queued by every block scope on this thread.
+   */
+  static void FlushScopedRegistrations();
+
   engine::Context* ctx_;
   uint64_t id_;
+  std::shared_ptr<ObjectRegistry> registry_;
+  bool registered_;                     // whether we're in (or queued for) registry_
   static utils::IDGenerator id_generator_;
+
+  // innermost block scope on this thread, if any
+  static thread_local IdBlockScope* id_block_scope_;
+
+  /**
+   *  @returns an unused ID, from this thread's block if there is one.
+   */
+  static uint64_t GetNextId();
 };
 
 }
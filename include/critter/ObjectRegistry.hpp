@@ -0,0 +1,95 @@
+#ifndef OBJECT_REGISTRY_H_
+#define OBJECT_REGISTRY_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace monkeysworld {
+namespace critter {
+
+class Object;
+
+/**
+ *  Index of every object in a scene by ID, so that objects can be found without searching the tree.
+ *
+ *  Objects register themselves for as long as they exist, under whatever ID they currently have.
+ *  The registry doesn't know where an object sits in the tree -- callers check that by walking up
+ *  from whatever they find (see Object::FindDescendant), which costs the object's depth rather than
+ *  the size of the tree. Objects moved under a parent from another scene move registries with it.
+ *
+ *  Lookups hand out shared_ptrs, so an object is only found once something has told the registry
+ *  which shared_ptr owns it (see Object::Attach) -- in practice, once it has a parent, which is
+ *  all that FindDescendant needs. Objects are only registered from then on, so creating one doesn't
+ *  touch the registry at all. The registry never touches the objects themselves, so an object
+ *  being destroyed on another thread is simply not found.
+ *
+ *  IDs aren't guaranteed to be unique (see Object::SetId), so an ID may lead to several objects.
+ *  ID 0 is never registered -- moved-from objects are left with it, and nothing should look them up.
+ *
+ *  Thread safe. Objects may be created on loader or update threads while the scene is driven
+ *  from another, and objects without a context all share one process-wide registry.
+ */
+class ObjectRegistry {
+ public:
+  struct registration {
+    Object* object;
+    uint64_t id;
+    std::weak_ptr<Object> ref;
+  };
+
+  /**
+   *  Adds an object to the registry.
+   *  @param object - the object being added.
+   *  @param id - its current ID.
+   *  @param ref - the shared_ptr which owns it, if known. Objects without one can't be found.
+   */
+  void Register(Object* object, uint64_t id, std::weak_ptr<Object> ref = std::weak_ptr<Object>());
+
+  /**
+   *  Adds several objects to the registry at once.
+   *  Objects whose reference has already expired are skipped: they're on their way out,
+   *  and may already have tried to unregister themselves.
+   *  @param entries - the objects being added.
+   *  @param count - number of entries.
+   */
+  void Register(const registration* entries, size_t count);
+
+  /**
+   *  Removes an object from the registry.
+   *  @param object - the object being removed.
+   *  @param id - the ID it was registered under.
+   *  @returns the reference it was registered with, so it can be carried over to a new ID or registry.
+   */
+  std::weak_ptr<Object> Unregister(Object* object, uint64_t id);
+
+  /**
+   *  Finds objects by ID.
+   *  @param id - ID to look for.
+   *  @param out - output param. Cleared, then filled with each live object registered under `id`
+   *               with a reference -- usually just one.
+   */
+  void Find(uint64_t id, std::vector<std::shared_ptr<Object>>* out) const;
+
+  /**
+   *  @returns the number of registered objects.
+   */
+  size_t GetSize() const;
+
+ private:
+  struct entry {
+    Object* object;
+    std::weak_ptr<Object> ref;
+  };
+
+  std::unordered_multimap<uint64_t, entry> objects_;
+  mutable std::mutex lock_;
+};
+
+}
+}
+
+#endif  // OBJECT_REGISTRY_H_
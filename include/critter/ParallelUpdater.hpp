@@ -0,0 +1,115 @@
+#ifndef PARALLEL_UPDATER_H_
+#define PARALLEL_UPDATER_H_
+
+#include <critter/Object.hpp>
+#include <critter/SceneWalker.hpp>
+
+#include <file/LoaderThreadPool.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace monkeysworld {
+namespace critter {
+
+/**
+ *  Spreads the updates of thread-safe subtrees across a thread pool.
+ *
+ *  Whoever walks the scene updates objects which haven't opted in (see Object::IsUpdateThreadSafe)
+ *  as usual, and hands the first thread-safe object it reaches on each branch to Schedule,
+ *  instead of walking beneath it. Run then updates every scheduled subtree as a set of jobs:
+ *  each job walks a few subtrees, and a job which reaches an object with many children splits
+ *  them into further jobs, which idle workers steal. The calling thread runs jobs as well.
+ *
+ *  Any object in a scheduled subtree which hasn't opted in is left for the calling thread,
+ *  and is updated along with everything beneath it once the jobs are done.
+ *
+ *  Ordering: an object's Update always finishes before any of its children's Updates start.
+ *  Nothing else is guaranteed -- siblings, and separate subtrees, may be updated in any order,
+ *  or at the same time.
+ *
+ *  The scene must not change shape while jobs are running, which is why thread-safe objects
+ *  can't add or remove children from Update.
+ */
+class ParallelUpdater {
+ public:
+  /**
+   *  @param pool - pool to run jobs on. With no worker threads, Run updates everything on the calling thread.
+   */
+  ParallelUpdater(std::shared_ptr<file::LoaderThreadPool> pool);
+
+  /**
+   *  Adds a subtree to the next call to Run.
+   *  @param root - a thread-safe object, which has not been updated yet this frame.
+   */
+  void Schedule(Object* root);
+
+  /**
+   *  @returns true if anything has been scheduled since the last call to Run.
+   */
+  bool HasScheduled() const;
+
+  /**
+   *  Updates every scheduled subtree, and returns once they're all done.
+   *  If an Update throws, the remaining jobs still run, and the first exception is rethrown here.
+   */
+  void Run();
+
+  /**
+   *  @returns the number of jobs the last call to Run was split into.
+   */
+  size_t GetLastJobCount() const;
+
+  ParallelUpdater(const ParallelUpdater& other) = delete;
+  ParallelUpdater& operator=(const ParallelUpdater& other) = delete;
+ private:
+  /**
+   *  A run of subtrees to update: children [begin, end) of `parent`,
+   *  or scheduled roots [begin, end) if `parent` is null.
+   */
+  struct job {
+    Object* parent;
+    size_t begin;
+    size_t end;
+  };
+
+  /**
+   *  Hands a range of subtrees to the pool, in jobs of a few subtrees each.
+   */
+  void Submit(Object* parent, size_t begin, size_t end);
+
+  /**
+   *  Updates every subtree in `j`. Called on whichever thread picked the job up.
+   */
+  void RunJob(const job& j);
+
+  /**
+   *  Marks a job done, waking the thread in Run if it was the last one.
+   */
+  void FinishJob();
+
+  std::shared_ptr<file::LoaderThreadPool> pool_;
+  std::vector<Object*> roots_;
+
+  // objects which haven't opted in, found beneath scheduled roots
+  std::mutex deferred_lock_;
+  std::vector<Object*> deferred_;
+  std::exception_ptr error_;          // guarded by `deferred_lock_`
+
+  std::atomic<size_t> outstanding_;   // jobs submitted but not finished
+  std::atomic<size_t> job_count_;
+  std::mutex done_lock_;
+  std::condition_variable done_cond_;
+
+  // for work done on the calling thread, outside of jobs
+  SceneWalker walker_;
+};
+
+}
+}
+
+#endif  // PARALLEL_UPDATER_H_
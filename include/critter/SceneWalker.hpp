@@ -0,0 +1,180 @@
+#ifndef SCENE_WALKER_H_
+#define SCENE_WALKER_H_
+
+#include <critter/Object.hpp>
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace monkeysworld {
+namespace critter {
+
+/**
+ *  What a walk should do after visiting an object.
+ */
+enum WalkAction {
+  WALK_CONTINUE,              // visit this object's children next
+  WALK_SKIP_CHILDREN,         // move on to the next sibling
+  WALK_STOP                   // end the walk here
+};
+
+/**
+ *  Pre-order walk over an object hierarchy, using an explicit stack in place of recursion.
+ *
+ *  Children are read through ChildSpans, so a walk doesn't copy child lists, and the walker keeps
+ *  its capacity between walks -- once it has grown to the size of the scene, walking allocates
+ *  nothing. The walker holds a reference to every object it has visited on the current path
+ *  (and their earlier siblings), which it lets go of as each level of the walk finishes.
+ *
+ *  Visited objects may add or remove children as the walk goes: the walker finds the visited
+ *  object again after each visit, so removing an earlier sibling doesn't skip its subtree, and
+ *  an object which removes itself (even if nothing else holds it) doesn't cause its next sibling
+ *  to be skipped. Children added behind the walk's position are picked up by the next walk.
+ *  An object must not remove one of its own ancestors, though.
+ *
+ *  Not reentrant -- use a separate walker for nested walks.
+ *
+ *  Usage:
+ *    walker.Walk(root.get(), [](Object* o) { o->Update(); });
+ *    walker.Walk(root.get(), [](Object* o) { return (IsCulled(o) ? WALK_SKIP_CHILDREN : WALK_CONTINUE); });
+ */
+class SceneWalker {
+ public:
+  /**
+   *  Visits `root`, then everything beneath it.
+   *  @param root - the top of the walk. Nothing happens if this is null.
+   *  @param func - called with each object. Returns void, or a WalkAction.
+   */
+  template <typename Func>
+  void Walk(Object* root, Func&& func) {
+    // an exception may have left a previous walk's stack behind
+    stack_.clear();
+    visited_.clear();
+    if (root != nullptr && Visit(root, func) == WALK_CONTINUE) {
+      WalkChildren(root, func);
+    }
+  }
+
+  /**
+   *  Visits everything beneath `root`, but not `root` itself.
+   *  @param root - the top of the walk. Nothing happens if this is null.
+   *  @param func - called with each object. Returns void, or a WalkAction.
+   */
+  template <typename Func>
+  void WalkChildren(Object* root, Func&& func) {
+    if (root == nullptr) {
+      return;
+    }
+
+    stack_.clear();
+    visited_.clear();
+    stack_.push_back({ root, 0, 0 });
+    while (!stack_.empty()) {
+      size_t top = stack_.size() - 1;
+      Object* parent = stack_[top].parent;
+      size_t index = stack_[top].next;
+      ChildSpan children = parent->GetChildSpan();
+      if (index >= children.GetSize()) {
+        // nothing at this level can be looked up again, so let go of it
+        visited_.resize(stack_[top].visited);
+        stack_.pop_back();
+        continue;
+      }
+
+      // the visit may drop the last reference to the child, so hold one
+      std::shared_ptr<Object> child = children.Share(index);
+      WalkAction action = Visit(child.get(), func);
+      if (action == WALK_STOP) {
+        stack_.clear();
+        visited_.clear();
+        return;
+      }
+
+      // the visit may have edited the parent's children. find where the child sits now,
+      // so that removing an earlier sibling doesn't skip it
+      Object* visited = child.get();
+      visited_.push_back(std::move(child));
+      children = parent->GetChildSpan();
+      size_t pos = FindChild(children, visited, index);
+      if (pos < children.GetSize()) {
+        stack_[top].next = pos + 1;
+        if (action == WALK_CONTINUE) {
+          stack_.push_back({ visited, 0, visited_.size() });
+        }
+      } else {
+        // the child removed itself: carry on after the last sibling we visited which is still here
+        stack_[top].next = FindResumePoint(children, stack_[top].visited);
+      }
+    }
+  }
+
+  /**
+   *  @returns the depth of the object being visited, relative to the root of the walk (which is at 0).
+   *           Only meaningful from inside a visit.
+   */
+  size_t GetDepth() const {
+    return stack_.size();
+  }
+
+ private:
+  struct Frame {
+    Object* parent;           // object whose children we're going through
+    size_t next;              // index of the next child to visit
+    size_t visited;           // where this level's children start in visited_
+  };
+
+  /**
+   *  @returns the index of `child` in `children`, or the size of the span if it isn't there.
+   *           Starts looking at `hint`, where it was before the visit.
+   */
+  static size_t FindChild(const ChildSpan& children, Object* child, size_t hint) {
+    if (hint < children.GetSize() && children[hint] == child) {
+      return hint;
+    }
+
+    for (size_t i = 0; i < children.GetSize(); i++) {
+      if (children[i] == child) {
+        return i;
+      }
+    }
+
+    return children.GetSize();
+  }
+
+  /**
+   *  @returns the index just past the most recently visited child (from visited_, starting at `first`)
+   *           which is still in `children`, or 0 if none are.
+   */
+  size_t FindResumePoint(const ChildSpan& children, size_t first) const {
+    for (size_t i = visited_.size(); i > first; i--) {
+      size_t pos = FindChild(children, visited_[i - 1].get(), 0);
+      if (pos < children.GetSize()) {
+        return pos + 1;
+      }
+    }
+
+    return 0;
+  }
+
+  template <typename Func>
+  static WalkAction Visit(Object* obj, Func& func) {
+    if constexpr (std::is_void<decltype(func(obj))>::value) {
+      func(obj);
+      return WALK_CONTINUE;
+    } else {
+      return func(obj);
+    }
+  }
+
+  std::vector<Frame> stack_;
+
+  // children visited so far, for each level on the stack. holding them means that a removed
+  // sibling can't be freed and its address reused by a new child while we're still comparing
+  std::vector<std::shared_ptr<Object>> visited_;
+};
+
+}
+}
+
+#endif  // SCENE_WALKER_H_
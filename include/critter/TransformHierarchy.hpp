@@ -0,0 +1,341 @@
+#ifndef TRANSFORM_HIERARCHY_H_
+#define TRANSFORM_HIERARCHY_H_
+
+#include <utils/Bounds.hpp>
+#include <utils/BoundingVolumeTree.hpp>
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace monkeysworld {
+namespace critter {
+
+class GameObject;
+
+/**
+ *  Flat store for the transforms of every GameObject in a scene.
+ *
+ *  Local position/rotation/scale and world matrices live in parallel arrays, sorted so that
+ *  parents always come before their children. That way, a single linear pass can bring every
+ *  world matrix up to date: by the time a node is reached, its parent's matrix is already current.
+ *  Edits only mark a node dirty, and the pass recomputes the nodes which were edited, along with
+ *  everything beneath them. Reading a single node's matrices between passes only recomputes the
+ *  edited part of its own chain of ancestors, and leaves the rest to the next pass.
+ *
+ *  Each node also carries bounds: a box in its local space, which the pass moves into world space,
+ *  and a box around the node and all of its descendants, for culling whole subtrees at once.
+ *  New nodes have infinite bounds, so that nothing is culled unless it says where it is.
+ *
+ *  On request, the hierarchy also keeps a spatial index over every node's world bounds,
+ *  for queries which don't follow the tree -- see GetSpatialIndex.
+ *
+ *  Nodes are referred to by handle, which stay valid while the arrays are reordered.
+ *
+ *  Mostly not thread safe -- a hierarchy belongs to a single scene, and should only be touched
+ *  from the thread driving that scene. There are two exceptions:
+ *    - SetPosition/SetRotation/SetScale may be called from several threads at once as long as
+ *      they're editing different nodes (this is what parallel updates do).
+ *    - Create/Destroy/SetParent/SetOwner/SetOwners are serialized internally, so several threads
+ *      may spawn and wire up objects at once (this is what loading a scene in parallel does).
+ *      Threads spawning lots of objects should create their nodes through a TransformReservation,
+ *      which takes the lock once per batch rather than once per node.
+ *  The two groups may not overlap, and nothing else may run alongside either.
+ */
+class TransformHierarchy {
+ public:
+  typedef uint32_t handle;
+  static const handle NONE = UINT32_MAX;
+
+  /**
+   *  A node, the object it belongs to, and which incarnation of the node's handle that was.
+   */
+  struct node_owner {
+    handle node;
+    uint32_t generation;
+    GameObject* owner;
+  };
+
+  TransformHierarchy();
+
+  /**
+   *  Creates a new root node with an identity transform.
+   *  @param owner - the object the node belongs to, if any. See SetOwner.
+   *  @returns a handle to the new node.
+   */
+  handle Create(GameObject* owner = nullptr);
+
+  /**
+   *  Creates several root nodes at once, without owners.
+   *  @param count - number of nodes to create.
+   *  @param nodes - output param. Filled with `count` nodes -- their owners and generations.
+   */
+  void Create(size_t count, node_owner* nodes);
+
+  /**
+   *  Releases a node. Its handle may be reused by a later call to Create.
+   *  Any children should be detached first -- see SetParent.
+   */
+  void Destroy(handle node);
+
+  /**
+   *  Releases several nodes at once. Same caveats as Destroy.
+   */
+  void Destroy(const node_owner* nodes, size_t count);
+
+  /**
+   *  Moves a node beneath another. Does not check for cycles.
+   *  @param node - the node being moved.
+   *  @param parent - its new parent, or NONE to make it a root.
+   */
+  void SetParent(handle node, handle parent);
+
+  /**
+   *  @returns the parent of `node`, or NONE if it is a root.
+   */
+  handle GetParent(handle node) const;
+
+  void SetPosition(handle node, const glm::vec3& position);
+  void SetRotation(handle node, const glm::vec3& rotation);
+  void SetScale(handle node, const glm::vec3& scale);
+
+  const glm::vec3& GetPosition(handle node) const;
+  const glm::vec3& GetRotation(handle node) const;
+  const glm::vec3& GetScale(handle node) const;
+
+  /**
+   *  @returns the transformation of `node` relative to its root.
+   *           If `node` or any of its ancestors were edited since the last pass, their matrices
+   *           are brought up to date first -- costing the node's depth, not the hierarchy's size.
+   *           The reference is valid until the hierarchy is next modified.
+   */
+  const glm::mat4& GetWorldMatrix(handle node);
+
+  /**
+   *  @returns the inverse transpose of the upper 3x3 of `node`'s world matrix,
+   *           for transforming normals. Same caveats as GetWorldMatrix.
+   */
+  const glm::mat3& GetNormalMatrix(handle node);
+
+  /**
+   *  Sets the bounds of whatever `node` draws, in its local space.
+   *  @param bounds - the node's bounds. Empty if it draws nothing, infinite if it can't say.
+   */
+  void SetLocalBounds(handle node, const utils::aabb& bounds);
+
+  const utils::aabb& GetLocalBounds(handle node) const;
+
+  /**
+   *  @returns the local bounds of `node`, in world space. Same caveats as GetWorldMatrix.
+   */
+  const utils::aabb& GetWorldBounds(handle node);
+
+  /**
+   *  @returns a box around the world bounds of `node` and all of its descendants,
+   *           as of the last update pass. Edits since then aren't reflected until the next one.
+   *           The reference is valid until the hierarchy is next modified.
+   */
+  const utils::aabb& GetSubtreeBounds(handle node);
+
+  /**
+   *  Records the object which `node` belongs to, so that spatial queries can report it.
+   */
+  void SetOwner(handle node, GameObject* owner);
+
+  /**
+   *  Records the owners of several nodes at once.
+   *  Nodes which were destroyed after their generation was handed out are skipped,
+   *  even if their handle has been reused since.
+   */
+  void SetOwners(const node_owner* owners, size_t count);
+
+  /**
+   *  @returns the object which `node` belongs to, or null if none was set.
+   */
+  GameObject* GetOwner(handle node) const;
+
+  /**
+   *  @returns a bounding volume tree over the world bounds of every node, with the handle of
+   *           each node as its proxy's payload. Nodes with empty bounds (nothing to find) or
+   *           infinite bounds (nowhere to put them) are left out.
+   *
+   *           The index is built the first time it is asked for. After that, each update pass
+   *           notes which nodes' bounds changed -- usually because SetPosition/SetRotation/SetScale
+   *           moved them or an ancestor -- and the next call moves just those proxies.
+   *           Hierarchies which are never queried never pay for it.
+   *
+   *           Meant for picking -- see RayCast. Frame culling doesn't use it: walking the tree
+   *           with subtree bounds is cheaper than syncing the index every frame. Nothing assigns
+   *           lights per object either, so lights don't query it.
+   *
+   *           The reference is valid for the hierarchy's lifetime, but the tree may only be
+   *           queried until the hierarchy is next modified.
+   */
+  const utils::BoundingVolumeTree& GetSpatialIndex();
+
+  /**
+   *  Finds the nearest object whose world bounds `r` passes through.
+   *  @param r - ray to cast. if its direction is normalized, distances are in world units.
+   *  @param max_distance - how far along the ray to look.
+   *  @param distance - output param, optional. where the ray enters the object's bounds.
+   *  @returns the owner of the nearest node hit, or null if the ray hits nothing.
+   */
+  GameObject* RayCast(const utils::ray& r, float max_distance, float* distance = nullptr);
+
+  /**
+   *  Brings every world and normal matrix up to date, in one pass over the hierarchy.
+   *  Bounds are updated along with them.
+   *  Cheap if nothing has changed since the last call.
+   */
+  void Update();
+
+  /**
+   *  @returns the number of live nodes in the hierarchy.
+   */
+  size_t GetSize() const;
+
+  TransformHierarchy(const TransformHierarchy& other) = delete;
+  TransformHierarchy& operator=(const TransformHierarchy& other) = delete;
+ private:
+  enum DirtyFlags {
+    DIRTY_LOCAL = 1,        // local transform was edited
+    DIRTY_WORLD = 2,        // parent was swapped
+    DIRTY_BOUNDS = 4        // local bounds were edited
+  };
+
+  /**
+   *  Adds a root node. Must be called with structure_lock_ held.
+   */
+  handle CreateLocked();
+
+  /**
+   *  Releases a node. Must be called with structure_lock_ held.
+   */
+  void DestroyLocked(handle node);
+
+  /**
+   *  Brings the world matrix of a single node up to date, along with those of its ancestors.
+   *  Dirty flags are left as they are, so the next pass still carries edits down to everything else.
+   *  @param node - the node being read.
+   *  @param stale - output param. true if anything on the node's chain was edited since the last pass.
+   *  @returns the node's index.
+   */
+  uint32_t ResolveChain(handle node, bool* stale);
+
+  /**
+   *  Sorts live nodes so that parents precede their children, and drops dead ones.
+   */
+  void Reorder();
+
+  /**
+   *  Queues a node for the spatial index to pick up, if there is one.
+   */
+  void QueueIndexUpdate(handle node);
+
+  /**
+   *  Brings the spatial index up to date with the last update pass.
+   */
+  void SyncIndex();
+
+  // handle -> index into the arrays below, or NONE if the handle is free
+  std::vector<uint32_t> index_;
+  std::vector<handle> free_handles_;
+
+  // per handle
+  std::vector<GameObject*> owner_;
+  std::vector<uint32_t> generation_;    // bumped each time the handle is released
+  std::vector<int> proxy_;              // proxy in the spatial index, or NULL_NODE
+  std::vector<uint8_t> index_queued_;   // whether the handle is in index_queue_
+
+  // per node, in parent-before-child order
+  std::vector<handle> handle_;          // NONE if the node was destroyed
+  std::vector<uint32_t> parent_;        // index of parent, or NONE for roots
+  std::vector<glm::vec3> position_;
+  std::vector<glm::vec3> rotation_;
+  std::vector<glm::vec3> scale_;
+  std::vector<glm::mat4> local_;
+  std::vector<glm::mat4> world_;
+  std::vector<glm::mat3> normal_;
+  std::vector<uint8_t> dirty_;
+  std::vector<uint8_t> changed_;        // whether world_ changed in the last pass
+  std::vector<utils::aabb> local_bounds_;
+  std::vector<utils::aabb> world_bounds_;
+  std::vector<utils::aabb> subtree_bounds_;
+  std::vector<uint32_t> chain_;         // scratch for ResolveChain
+
+  // spatial index, and the nodes whose bounds it hasn't caught up with
+  utils::BoundingVolumeTree spatial_index_;
+  std::vector<handle> index_queue_;
+  std::vector<utils::BoundingVolumeTree::proxy_move> index_moves_;
+  std::vector<utils::aabb> index_new_boxes_;
+  std::vector<handle> index_new_handles_;
+  std::vector<int> index_new_proxies_;
+  bool indexed_;                        // whether the index has been asked for
+
+  size_t dead_;                         // destroyed nodes not yet compacted away
+  bool order_dirty_;                    // a node may precede its parent
+  bool subtrees_dirty_;                 // subtree bounds need merging again
+  std::atomic<bool> pending_;           // something changed since the last pass
+  std::mutex structure_lock_;           // held by Create/Destroy/SetParent/SetOwner(s)
+};
+
+/**
+ *  Nodes created ahead of time, so that a thread spawning lots of objects doesn't have to take
+ *  its hierarchy's lock for each one. Nodes are created a batch at a time, and the objects which
+ *  take them are recorded as their owners a batch at a time too -- until then, spatial queries
+ *  won't report them.
+ *
+ *  Each hierarchy gets its own reserve. Reserved nodes count towards their hierarchy's size
+ *  until they're taken or released. Anything left over is released by Flush, or when the
+ *  reservation is destroyed.
+ *
+ *  Belongs to a single thread -- see Object::IdBlockScope.
+ */
+class TransformReservation {
+ public:
+  /**
+   *  @param batch_size - number of nodes to create at a time.
+   */
+  TransformReservation(size_t batch_size);
+
+  /**
+   *  Takes a root node from the hierarchy's reserve, creating another batch if it's run dry.
+   *  @param transforms - the hierarchy the node should be created in.
+   *  @param owner - the object which the node belongs to.
+   *  @returns a handle to the new node.
+   */
+  TransformHierarchy::handle Create(const std::shared_ptr<TransformHierarchy>& transforms, GameObject* owner);
+
+  /**
+   *  Records the owners of every node handed out so far, and releases the rest.
+   */
+  void Flush();
+
+  ~TransformReservation();
+  TransformReservation(const TransformReservation& other) = delete;
+  TransformReservation& operator=(const TransformReservation& other) = delete;
+ private:
+  struct reserve {
+    std::shared_ptr<TransformHierarchy> transforms;
+    std::vector<TransformHierarchy::node_owner> reserved;   // not handed out yet
+    std::vector<TransformHierarchy::node_owner> owners;     // handed out, owner not recorded yet
+  };
+
+  /**
+   *  Records the owners of every node handed out from `r` so far.
+   */
+  static void FlushOwners(reserve& r);
+
+  size_t batch_size_;
+  // one per hierarchy -- there's rarely more than one or two
+  std::vector<reserve> reserves_;
+};
+
+}
+}
+
+#endif  // TRANSFORM_HIERARCHY_H_
@@ -2,6 +2,7 @@
 #define VISITOR_H_
 
 #include <critter/Object.hpp>
+#include <critter/SceneWalker.hpp>
 #include <critter/GameObject.hpp>
 #include <critter/Model.hpp>
 #include <critter/GameCamera.hpp>
@@ -37,7 +38,23 @@ class Visitor {
   virtual void Visit(std::shared_ptr<font::TextObject> o) = 0;
  protected:
   /** ### ASSISTING FUNCTIONS ### **/
+
+  /**
+   *  Visits everything beneath `o`, in pre-order.
+   *  Called from a Visit method which wants to descend. The walk itself is iterative:
+   *  calls made from inside an ongoing walk just mark the current object for descent.
+   */
   void VisitChildren(std::shared_ptr<Object> o);
+
+  /**
+   *  Ends the walk in progress, skipping everything not yet visited.
+   */
+  void StopVisiting();
+ private:
+  SceneWalker walker_;
+  bool walking_ = false;        // inside VisitChildren's walk
+  bool descend_ = false;        // the object just visited asked for its children
+  bool stop_ = false;
 };
 
 } // namespace render
@@ -0,0 +1,78 @@
+#ifndef COMPOSITE_BATCHER_H_
+#define COMPOSITE_BATCHER_H_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cinttypes>
+#include <vector>
+
+namespace monkeysworld {
+namespace critter {
+namespace ui {
+
+/**
+ *  One child, as a group draws it: a textured rectangle. Laid out for use as instance data.
+ */
+struct composite_quad {
+  glm::vec4 rect;                           // min xy, then max xy, in clip space
+  glm::vec4 texcoords;                      // min uv, then max uv
+  float opacity;
+  float slot;                               // texture unit, within the quad's batch
+};
+
+/**
+ *  A run of quads which can be drawn in one call.
+ */
+struct composite_batch {
+  uint32_t first;                           // index of the first quad
+  uint32_t count;
+  std::vector<GLuint> textures;             // bound to slots 0, 1, ...
+};
+
+/**
+ *  Splits a group's children into as few draw calls as the available texture units allow.
+ *
+ *  Quads are kept in the order they're added, so that they blend in the right order. A batch
+ *  ends once it needs one texture more than there are units -- children drawing into shared
+ *  textures (see UIObject::SetAtlased) take up one unit between them, so a group of them
+ *  usually goes in a single call.
+ */
+class CompositeBatcher {
+ public:
+  CompositeBatcher();
+
+  /**
+   *  Throws away the previous quads and batches.
+   *  @param max_textures - textures which may be bound in a single call.
+   */
+  void Begin(int max_textures);
+
+  /**
+   *  Adds a quad to the end of the last batch, or starts a new one if it's out of units.
+   *  @param texture - texture the quad samples from.
+   *  @param quad - the quad. Its slot is filled in here.
+   */
+  void Add(GLuint texture, composite_quad quad);
+
+  /**
+   *  @returns every quad added since Begin, in order.
+   */
+  const std::vector<composite_quad>& GetQuads() const;
+
+  /**
+   *  @returns the batches the quads were split into, in order.
+   */
+  const std::vector<composite_batch>& GetBatches() const;
+
+ private:
+  int max_textures_;
+  std::vector<composite_quad> quads_;
+  std::vector<composite_batch> batches_;
+};
+
+}
+}
+}
+
+#endif  // COMPOSITE_BATCHER_H_
@@ -2,16 +2,35 @@
 #define UI_GROUP_H_
 
 #include <critter/ui/UIObject.hpp>
-#include <model/Mesh.hpp>
+#include <critter/ui/CompositeBatcher.hpp>
+#include <critter/ui/layout/BoundingBox.hpp>
 
 #include <shader/materials/UIGroupMaterial.hpp>
+#include <utils/BoundingVolumeTree.hpp>
+
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
 
 namespace monkeysworld {
 namespace critter {
 namespace ui {
 
+/**
+ *  What the last layout pass did.
+ */
+struct layout_stats {
+  uint32_t solved;                          // children whose rectangles were worked out
+  uint32_t moved;                           // solved children which ended up somewhere new
+  bool rebuilt;                             // whether the anchor graph had to be sorted again
+};
+
 /**
  *  UIGroups are the parts which actually contain other components.
+ *  Children are composited as instanced quads, in as few draws as texture units allow.
+ *  Clicks and hovers find the children under the cursor through a bounding volume tree of
+ *  their rectangles, built on the first search and kept up to date as children move.
  */ 
 class UIGroup : public UIObject {
  public:
@@ -20,6 +39,7 @@ class UIGroup : public UIObject {
 
   std::shared_ptr<Object> GetChild(uint64_t id) override;
   std::vector<std::shared_ptr<Object>> GetChildren() override;
+  ChildSpan GetChildSpan() override;
 
   /**
    *  Adds a child to this UIGroup.
@@ -28,34 +48,112 @@ class UIGroup : public UIObject {
   void AddChild(std::shared_ptr<UIObject> obj);
 
   /**
-   *  Removes a child from this UIGroup.
+   *  Removes a child from this UIGroup, or from any group nested inside it.
    *  @param id - the id of the child we are removing.
    */ 
   void RemoveChild(uint64_t id);
 
   /**
    *  Override for layout.
+   *  Anchors are sorted once, and kept until a child is added, removed or re-anchored.
+   *  Between passes, children which move, resize or get new margins are collected, and each
+   *  pass only works out those children and whatever is anchored to something which moved.
+   *  Places children exactly where solving every child, every pass, would.
    */ 
   void Layout(glm::vec2 size) override;
 
+  /**
+   *  @returns what the last call to Layout did.
+   */
+  const layout_stats& GetLayoutStats() const;
+
   /**
    *  Uses DrawUI to draw all children to the screen.
    */ 
   void DrawUI(glm::vec2 min, glm::vec2 max, shader::Canvas canvas) override;
 
+  ~UIGroup();
+
+ protected:
+  /**
+   *  Groups sample their children while drawing, so they keep framebuffers of their own.
+   */
+  bool CanShareFramebuffer() override { return false; }
+
+  void OnChildLayoutChanged(UIObject* child, bool anchors) override;
+
+  void GetChildrenAt(glm::vec2 point, std::vector<UIObject*>* children) override;
+
  private:
-  struct UIGroupPacket {
-    glm::vec2 pos;            // vertex positions
-    glm::vec2 texcoord;       // texture coordinates
-    float index;              // index of child being drawn
+  /**
+   *  A child, as laid out by the group.
+   */
+  struct layout_node {
+    UIObject* child;
+    int32_t anchors[4];                     // top, bottom, left, right: a node, the group (-1), or none (-2)
+    std::vector<int32_t> dependents;        // nodes anchored to this one
+    layout::BoundingBox box;                // where the last pass put it
+    bool queued;                            // whether it's waiting in pending_
+  };
 
-    static void Bind();
+  /**
+   *  Sorts children by their anchors, so that every child comes after what it's anchored to.
+   *  @returns false if the anchors can't be laid out -- a cycle, or an anchor
+   *           which isn't a child of this group.
+   */
+  bool BuildLayout();
+
+  /**
+   *  Marks a node as needing to be solved on the next pass.
+   */
+  void QueueLayout(int32_t index);
+
+  /**
+   *  A child, as the hit index keeps it.
+   */
+  struct hit_entry {
+    UIObject* child;                        // nullptr if the slot is free
+    int proxy;                              // in hit_tree_
+    bool moved;                             // whether it's waiting in hit_moved_
   };
 
+  /**
+   *  Builds the hit index if it hasn't been yet, or else catches it up with children which moved.
+   */
+  void UpdateHitIndex();
+
+  /**
+   *  Adds a child to the hit index.
+   */
+  void AddHit(UIObject* child);
+
+  /**
+   *  Removes a child from the hit index.
+   */
+  void RemoveHit(UIObject* child);
+
   std::vector<std::shared_ptr<UIObject>> children_;   // children of this layer
-  model::Mesh<UIGroupPacket> mesh_;                   // group mesh
-  GLint max_textures_;
-  shader::materials::UIGroupMaterial mat_;
+  CompositeBatcher batcher_;                          // children being drawn, split into calls
+  GLuint vao_;                                        // per-instance attributes, from instances_
+  GLuint instances_;                                  // one composite_quad per child drawn
+  std::unique_ptr<shader::materials::UIGroupMaterial> mat_;   // created on first draw
+
+  std::vector<layout_node> nodes_;                    // children, in anchor order
+  std::vector<int32_t> group_dependents_;             // nodes anchored to the group itself
+  std::vector<int32_t> unsettled_;                    // nodes which the next pass will move anyway
+  std::priority_queue<int32_t, std::vector<int32_t>, std::greater<int32_t>> pending_;  // nodes to solve, first to last
+  glm::vec2 layout_size_;                             // group size as of the last pass
+  bool layout_stale_;                                 // anchors changed, need to sort again
+  bool layout_ok_;                                    // anchors could be sorted
+  bool in_layout_;                                    // moving children ourselves
+  layout_stats layout_stats_;
+
+  uint64_t next_sibling_order_;                       // handed to the next child added
+  utils::BoundingVolumeTree hit_tree_;                // child rectangles, with slots as payloads
+  std::vector<hit_entry> hit_entries_;                // by slot
+  std::vector<uint32_t> hit_free_;                    // slots not in use
+  std::vector<uint32_t> hit_moved_;                   // slots whose rectangles changed since the last search
+  bool hit_built_;                                    // whether the hit index exists yet
   
 };
 
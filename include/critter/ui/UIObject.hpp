@@ -15,8 +15,8 @@
 
 #include <critter/ui/layout/UILayoutParams.hpp>
 
-#include <atomic>
 #include <mutex>
+#include <vector>
 
 namespace monkeysworld {
 namespace critter {
@@ -24,11 +24,22 @@ namespace ui {
 
 class UIGroup;
 
+/**
+ *  What redrawing the UI cost.
+ */
+struct redraw_stats {
+  uint32_t objects;                         // framebuffers drawn into
+  uint64_t pixels;                          // pixels covered by those draws
+  uint32_t draws;                           // draw calls made compositing groups
+};
+
 /**
  *  UI Objects are objects which display on top of the rendered window, typically as 2D components.
  * 
  *  UI objects are grouped together, and are positioned relative to their containers.
- *  
+ *
+ *  UI objects belong to the main thread, and are only touched while the simulation is idle
+ *  (see RenderBackend::PrepareUI) -- nothing here, including the damage tracking, is synchronized.
  */ 
 class UIObject : public Object, public std::enable_shared_from_this<UIObject> {
   // quick hack lol
@@ -39,7 +50,8 @@ class UIObject : public Object, public std::enable_shared_from_this<UIObject> {
   void Accept(Visitor& v) override;
 
   /**
-   *  Called prior to Layout.
+   *  Called prior to Layout. Lays out this object and everything under it,
+   *  skipping anything which hasn't changed since the last pass.
    */ 
   void PreLayout();
 
@@ -64,6 +76,11 @@ class UIObject : public Object, public std::enable_shared_from_this<UIObject> {
    */ 
   std::vector<std::shared_ptr<Object>> GetChildren() override;
 
+  /**
+   *  Returns an empty span in all cases.
+   */ 
+  ChildSpan GetChildSpan() override;
+
   /**
    *  Returns parent of this component.
    */ 
@@ -71,7 +88,7 @@ class UIObject : public Object, public std::enable_shared_from_this<UIObject> {
 
   /**
    *  Accepts incoming click events, and dispatches click events to children.
-   *  TODO: Create "MouseEvent" to pass in as params to this and OnClick.
+   *  Children under the click are offered it topmost first, as drawn.
    * 
    *  @param e - a mouse event generated by a cursor event inside this UI object.
    *  @returns true if this UIObject's OnClick method consumed the event,
@@ -91,6 +108,35 @@ class UIObject : public Object, public std::enable_shared_from_this<UIObject> {
     return false; 
   };
 
+  /**
+   *  Tracks which object under this one the cursor is over -- the one GetObjectAt finds.
+   *  When that changes, the object it was over gets OnMouseExit, and the new one OnMouseEnter.
+   *  @param e - a mouse event for the cursor's new position.
+   */
+  void HandleHoverEvent(const input::MouseEvent& e);
+
+  /**
+   *  Called when the cursor moves onto this object, as tracked by HandleHoverEvent.
+   *  @param e - the cursor's position, relative to this object.
+   */
+  virtual void OnMouseEnter(const input::MouseEvent& e) {}
+
+  /**
+   *  Called when the cursor moves off of this object, as tracked by HandleHoverEvent.
+   *  @param e - the cursor's position, relative to this object.
+   */
+  virtual void OnMouseExit(const input::MouseEvent& e) {}
+
+  /**
+   *  Finds the deepest object under a point: the topmost child there, then the topmost child of
+   *  that, and so on.
+   *  @param point - the point, relative to this object.
+   *  @param local - output param for the point relative to the object found. May be nullptr.
+   *  @returns the object found -- this one if no children are there, or nullptr if the point
+   *           isn't on this object at all.
+   */
+  std::shared_ptr<UIObject> GetObjectAt(glm::vec2 point, glm::vec2* local);
+
   /**
    *  Returns the position of this object relative to its parent, in XY coords.
    */ 
@@ -143,11 +189,18 @@ class UIObject : public Object, public std::enable_shared_from_this<UIObject> {
   void PrepareAttributes() override {}
 
   /**
-   *  Binds the framebuffer associated with this UI object and draws it to the screen.
-   *  Calls DrawUI if the UI element has been invalidated by another call.
+   *  Redraws whatever has changed under this UI object since it was last drawn.
+   *  Each object's framebuffer is redrawn only within the region which changed -- anything
+   *  invalidated, along with wherever a child was moved, resized, added or removed.
+   *  Objects which haven't changed, and aren't over anything which has, aren't drawn at all.
    */ 
   void RenderMaterial(const engine::RenderContext& rc) override;
 
+  /**
+   *  @returns what the last call to RenderMaterial redrew, including everything under this object.
+   */ 
+  const redraw_stats& GetRedrawStats() const;
+
   /**
    *  Draws the contents of this framebuffer directly to the screen.
    */ 
@@ -172,9 +225,9 @@ class UIObject : public Object, public std::enable_shared_from_this<UIObject> {
    *    for instance by using the resolution to transform components in-shader.
    *  
    *  The parameters to this method represent the minimally invalidated bounding box
-   *  for this component -- implementors can use these args to save performance
-   *  by only updating a part of the screen, instead of the whole thing. This only really applies
-   *  to groups, so do what you want, for the most part.
+   *  for this component. Drawing is scissored to this box, which has already been cleared --
+   *  implementors can use these args to skip anything which falls outside of it.
+   *  Objects which are invalidated themselves always receive their whole area.
    * 
    *  @param minXY, the minXY of the invalid bounding box, origin top left.
    *  @param maxXY, the maxXY of the invalid bounding box, origin top left.
@@ -185,6 +238,7 @@ class UIObject : public Object, public std::enable_shared_from_this<UIObject> {
   /**
    *  Invalidates the framebuffer, notifying the UIObject
    *  to redraw the UI component on the next render pass.
+   *  Each group above this object recomposites the area it covers.
    */ 
   void Invalidate();
 
@@ -193,6 +247,23 @@ class UIObject : public Object, public std::enable_shared_from_this<UIObject> {
    */ 
   GLuint GetFramebufferColor();
 
+  /**
+   *  Gets the part of the color attachment this object draws to, which may be a region
+   *  of a larger, possibly shared, texture.
+   *  @param min - output param for the texcoords of its lower left corner.
+   *  @param max - output param for the texcoords of its upper right corner.
+   */
+  void GetFramebufferTexcoords(glm::vec2* min, glm::vec2* max) const;
+
+  /**
+   *  Lets this object draw into a region of a texture shared with other small objects,
+   *  instead of a framebuffer of its own. Saves memory, and lets the group above it draw it
+   *  alongside its neighbors. Best for small objects which don't change size often.
+   *  Ignored by objects which can't share (see CanShareFramebuffer), and without a pool.
+   *  @param atlased - whether this object may share.
+   */
+  void SetAtlased(bool atlased);
+
   /**
    *  @returns the descriptor for our framebuffer as a whole.
    */ 
@@ -213,10 +284,29 @@ class UIObject : public Object, public std::enable_shared_from_this<UIObject> {
  protected:
 
   /**
-   *  @returns true if the UIObject is still valid, false otherwise.
+   *  @returns true if neither the UIObject, nor anything under it, needs to be redrawn.
    */ 
   bool IsValid();
 
+  /**
+   *  Works out which region of each changed object's framebuffer the next redraw should cover,
+   *  for this object and everything under it.
+   */ 
+  void UpdateDamage();
+
+  /**
+   *  Fetches the region which this object will redraw, as of the last call to UpdateDamage.
+   *  Empty (min == max) if nothing needs redrawing.
+   *  @param xyMin - output parameter for min XY, origin top left.
+   *  @param xyMax - output parameter for max XY.
+   */ 
+  void GetInvalidatedBoundingBox(glm::vec2* xyMin, glm::vec2* xyMax) const;
+
+  /**
+   *  Marks this object, and everything under it, as up to date.
+   */ 
+  void ClearDamage();
+
   /**
    *  Draws the UI object, as a fullscreen quadrilateral, to the screen.
    *  Useful for transferring (for instance) a texture directly to the UIObject's framebuffer.
@@ -225,11 +315,53 @@ class UIObject : public Object, public std::enable_shared_from_this<UIObject> {
    */ 
   void DrawFullscreenQuad();
 
+  /**
+   *  @returns whether this object may draw into a shared texture (see SetAtlased).
+   *           Objects which sample other objects' framebuffers while drawing can't.
+   */
+  virtual bool CanShareFramebuffer() { return true; }
+
+  /**
+   *  Adds to the draw calls reported for the current redraw. For use in DrawUI.
+   *  @param draws - number of draw calls made.
+   */
+  void CountDraws(uint32_t draws);
+
+  /**
+   *  Called on a parent whenever one of its children moves, resizes, or gets new layout params,
+   *  other than by the parent's own layout. Overridden by groups to track what needs laying out.
+   *  @param child - the child which changed.
+   *  @param anchors - true if the child's anchors changed, false if only its rectangle
+   *                   or margins did.
+   */
+  virtual void OnChildLayoutChanged(UIObject* child, bool anchors) {}
+
+  /**
+   *  Finds the children which contain a point, topmost first. Overridden by groups, which
+   *  keep an index of their children to search.
+   *  @param point - the point, relative to this object.
+   *  @param children - output param for the children found.
+   */
+  virtual void GetChildrenAt(glm::vec2 point, std::vector<UIObject*>* children);
+
+  /**
+   *  @returns true if `a` is drawn above `b`, its sibling: lower z-indices go on top,
+   *           then whichever was added to the group last.
+   */
+  static bool IsDrawnAbove(const UIObject* a, const UIObject* b);
+
  private:
   std::weak_ptr<UIObject> parent_;                      // parent object if valid
   glm::ivec2 pos_;                                       // offset of this component relative to parent
   glm::ivec2 size_;                                      // size of ui object, pixels wide/tall
-  std::atomic_bool valid_;                              // whether or not the view has been invalidated.
+  bool valid_;                                          // whether or not the view has been invalidated.
+  bool damaged_;                                        // whether this, or anything under it, needs redrawing
+  glm::ivec2 pending_min_;                              // region uncovered or covered by children changing shape
+  glm::ivec2 pending_max_;
+  glm::ivec2 damage_min_;                               // region covered by the next redraw -- see UpdateDamage
+  glm::ivec2 damage_max_;
+  redraw_stats last_redraw_;
+  redraw_stats* tally_;                                 // stats for the redraw in progress, if any
   float opacity_;
 
   std::shared_ptr<shader::Framebuffer> fb_;
@@ -244,13 +376,37 @@ class UIObject : public Object, public std::enable_shared_from_this<UIObject> {
   std::shared_ptr<shader::materials::TextureXferMaterial> xfer_mat_;
 
   layout::UILayoutParams layout_; // layout params for this layer
+  int32_t layout_index_;          // where our parent's layout keeps us, or -1 if it doesn't
+  uint64_t sibling_order_;        // when our parent added us, for breaking z-index ties
+  int32_t hit_slot_;              // where our parent's hit index keeps us, or -1 if it doesn't
+  std::weak_ptr<UIObject> hovered_;   // what HandleHoverEvent last found the cursor over
+
+  /**
+   *  Flags this object and its ancestors as needing a redraw.
+   */ 
+  void MarkDamaged();
+
+  /**
+   *  Tells our parent that some region of it, in its own coordinates, needs to be recomposited.
+   */ 
+  void DamageParent(glm::ivec2 min, glm::ivec2 max);
+
+  /**
+   *  Lets our parent know that we need laying out again.
+   *  @param anchors - whether our anchors changed.
+   */
+  void NotifyParentLayout(bool anchors);
+
+  /**
+   *  @returns true if `point`, relative to our parent, is on this object.
+   */
+  bool Covers(glm::vec2 point) const;
 
   /**
-   *  Calculates the minimal bounding box which needs to be updated.
-   *  @param xyMin - output parameter for min XY
-   *  @param xyMax - output parameter for max XY
+   *  Redraws the region found by UpdateDamage, after redrawing any children which changed.
+   *  @param stats - tally of what was redrawn.
    */ 
-  void GetInvalidatedBoundingBox(glm::vec2* xyMin, glm::vec2* xyMax);
+  void Redraw(redraw_stats* stats);
 };
 
 }
@@ -41,8 +41,6 @@ class ActiveCameraFindVisitor : public critter::Visitor {
    */ 
   void Clear();
  private:
-  void ActiveCameraVisitChildren(std::vector<std::shared_ptr<Object>>&);
-
   std::shared_ptr<GameCamera> active_camera_;
   std::atomic_bool cam_found_;
 };
@@ -0,0 +1,121 @@
+#ifndef FRAME_VISITOR_H_
+#define FRAME_VISITOR_H_
+
+#include <critter/Visitor.hpp>
+#include <critter/SceneWalker.hpp>
+#include <critter/ParallelUpdater.hpp>
+
+#include <shader/light/SpotLight.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace monkeysworld {
+namespace critter {
+namespace visitor {
+
+/**
+ *  Does all of a frame's per-object work on the game tree in a single walk.
+ *
+ *  Each object is updated, then sorted into frame-local lists: spotlights, cameras,
+ *  and everything which should be rendered, in scene order. Later stages of the frame
+ *  (light setup, shadow and render passes) read those lists instead of walking the tree again.
+ *
+ *  The lists hold raw pointers, and are only good for the frame they were gathered in. The visitor
+ *  keeps everything it gathers alive until it's cleared, though, so an update which removes an
+ *  object that was already gathered (or itself) doesn't leave the lists dangling -- the removed
+ *  object is still rendered that frame.
+ *  Objects added during the walk are picked up if the walk hasn't passed them yet,
+ *  and otherwise on the next frame.
+ *
+ *  Given a thread pool, subtrees of thread-safe objects are updated in parallel, once the walk
+ *  has updated everything else (see ParallelUpdater for the ordering guarantees). The scene is
+ *  then walked a second time to gather it, since objects may have moved around in the meantime.
+ *  Scenes with no thread-safe objects still take a single walk.
+ *
+ *  The render list keeps track of where each object's subtree ends, so later stages
+ *  (i.e. culling) can skip a whole subtree at once.
+ */
+class FrameVisitor : public critter::Visitor {
+ public:
+  FrameVisitor();
+
+  /**
+   *  Creates a FrameVisitor which updates thread-safe objects in parallel.
+   *  @param update_pool - pool which updates are run on.
+   */
+  FrameVisitor(std::shared_ptr<file::LoaderThreadPool> update_pool);
+
+  void Visit(std::shared_ptr<Object> o) override;
+  void Visit(std::shared_ptr<GameObject> o) override;
+  void Visit(std::shared_ptr<GameCamera> o) override;
+  void Visit(std::shared_ptr<shader::light::SpotLight> o) override;
+  void Visit(std::shared_ptr<font::TextObject> o) override;
+
+  /**
+   *  Updates every object beneath (and including) `root`, and gathers them for the frame.
+   *  Clears anything gathered previously.
+   *  If an update throws, the frame is left partially updated, and nothing is gathered.
+   *  @param root - root of the game tree. Nothing is gathered if null.
+   */
+  void UpdateAndGather(Object* root);
+
+  /**
+   *  Resets the state of the visitor.
+   */
+  void Clear();
+
+  /**
+   *  @returns every gathered object, in pre-order.
+   */
+  const std::vector<Object*>& GetRenderList() const;
+
+  /**
+   *  @returns for each entry in the render list, the index one past its last descendant.
+   *           Entries from i + 1 up to this index make up i's subtree.
+   */
+  const std::vector<uint32_t>& GetSubtreeEnds() const;
+
+  /**
+   *  @returns every gathered spotlight, in pre-order.
+   */
+  const std::vector<shader::light::SpotLight*>& GetSpotLights() const;
+
+  /**
+   *  @returns the first active camera in pre-order, or nullptr if there isn't one.
+   *           Checked once the walk is done, so updates can switch cameras around.
+   */
+  std::shared_ptr<GameCamera> GetActiveCamera() const;
+
+ private:
+  /**
+   *  Gathers an object which has been walked to.
+   */
+  void Gather(Object* o);
+
+  /**
+   *  Adds an object to the render list, and keeps it alive until the visitor is cleared.
+   */
+  void Hold(std::shared_ptr<Object> o);
+
+  /**
+   *  Fills in subtree ends once the walk is done.
+   */
+  void FindSubtreeEnds();
+
+  SceneWalker walker_;
+  std::unique_ptr<ParallelUpdater> updater_;    // null if updates are serial
+  std::vector<Object*> render_list_;
+  std::vector<std::shared_ptr<Object>> held_;   // owns each render list entry for the frame
+  std::vector<uint32_t> depths_;                // depth of each render list entry, during the walk
+  std::vector<uint32_t> subtree_ends_;
+  std::vector<uint32_t> open_;                  // entries whose subtrees haven't ended yet
+  std::vector<shader::light::SpotLight*> spotlights_;
+  std::vector<GameCamera*> cameras_;
+};
+
+}
+}
+}
+
+#endif  // FRAME_VISITOR_H_
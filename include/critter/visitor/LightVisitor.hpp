@@ -41,10 +41,6 @@ class LightVisitor : public critter::Visitor {
   // returns a list of all spotlights visited.
   const std::vector<std::shared_ptr<shader::light::SpotLight>>& GetSpotLights();
  private:
-  /**
-   *  Visits all children of object.
-   */ 
-  void VisitChildren(std::shared_ptr<Object>);
   std::vector<std::shared_ptr<shader::light::SpotLight>> spotlights_;
 
 };
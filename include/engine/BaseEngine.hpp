@@ -36,8 +36,11 @@ std::shared_ptr<engine::EngineContext> CreateContext(GLFWwindow* window, std::sh
  *  @param scene - the first scene to be loaded.
  *  @param ctx - the context associated with this window.
  *  @param window_name - the name associated with this window.
+ *  @param pipelined - if true, each frame is simulated on its own thread while the previous one
+ *                     is drawn. Objects must then draw using the transforms in their render context --
+ *                     see FramePipeline.
  */ 
-void GameLoop(std::shared_ptr<engine::EngineContext> ctx, GLFWwindow* window);
+void GameLoop(std::shared_ptr<engine::EngineContext> ctx, GLFWwindow* window, bool pipelined = false);
 
 // various functions which help push the engine along
 
@@ -7,6 +7,8 @@
 #include <engine/SceneSwap.hpp>
 #include <engine/Executor.hpp>
 #include <engine/EngineExecutor.hpp>
+#include <critter/TransformHierarchy.hpp>
+#include <critter/ObjectRegistry.hpp>
 #include <shader/Framebuffer.hpp>
 
 #define GLFW_INCLUDE_NONE
@@ -24,11 +26,26 @@ class Context {
   virtual std::shared_ptr<audio::AudioManager> GetAudioManager() = 0;
   virtual std::shared_ptr<Executor<EngineExecutor>> GetExecutor() = 0;
 
+  /**
+   *  @returns the hierarchy which GameObjects in this context store their transforms in.
+   */
+  virtual std::shared_ptr<critter::TransformHierarchy> GetTransformHierarchy() = 0;
+
+  /**
+   *  @returns the registry which objects in this context are looked up by ID through.
+   */
+  virtual std::shared_ptr<critter::ObjectRegistry> GetObjectRegistry() = 0;
+
   /**
    *  @returns the last rendered frame, as a framebuffer object.
    */ 
   virtual std::shared_ptr<shader::Framebuffer> GetLastFrame() = 0;
 
+  /**
+   *  @returns the pool which UI framebuffers in this context lease their attachments from.
+   */
+  virtual std::shared_ptr<shader::FramebufferPool> GetFramebufferPool() = 0;
+
   /**
    *  Returns the size of the framebuffer.
    *  @param width -  output param for width.
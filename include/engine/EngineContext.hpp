@@ -76,8 +76,14 @@ class EngineContext : public Context {
 
   std::shared_ptr<Executor<EngineExecutor>> GetExecutor() override;
 
+  std::shared_ptr<critter::TransformHierarchy> GetTransformHierarchy() override;
+
+  std::shared_ptr<critter::ObjectRegistry> GetObjectRegistry() override;
+
   std::shared_ptr<shader::Framebuffer> GetLastFrame() override;
 
+  std::shared_ptr<shader::FramebufferPool> GetFramebufferPool() override;
+
   /**
    *  @returns the framebuffer which is currently being drawn to.
    */ 
@@ -112,6 +118,9 @@ class EngineContext : public Context {
   std::shared_ptr<input::WindowEventManager> event_mgr_;
   std::shared_ptr<audio::AudioManager> audio_mgr_;
   std::shared_ptr<EngineExecutor> executor_;
+  std::shared_ptr<critter::TransformHierarchy> transforms_;
+  std::shared_ptr<critter::ObjectRegistry> registry_;
+  std::shared_ptr<shader::FramebufferPool> fb_pool_;
   Scene* scene_;
   GLFWwindow* window_;
   // the current scene
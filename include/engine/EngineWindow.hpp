@@ -18,6 +18,7 @@ class EngineWindow : public critter::ui::Window {
   std::shared_ptr<critter::Object> GetChild(uint64_t id) override;
   std::vector<std::shared_ptr<critter::Object>> GetChildren() override;
   bool HandleClickEvent(input::MouseEvent& e) override;
+  void HandleHoverEvent(input::MouseEvent& e) override;
   glm::vec2 GetDimensions() const override;
   void RenderMaterial(const engine::RenderContext& rc) override;
 
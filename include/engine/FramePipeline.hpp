@@ -0,0 +1,116 @@
+#ifndef FRAME_PIPELINE_H_
+#define FRAME_PIPELINE_H_
+
+#include <engine/FrameSnapshot.hpp>
+
+#include <critter/visitor/FrameVisitor.hpp>
+#include <file/LoaderThreadPool.hpp>
+#include <utils/Frustum.hpp>
+
+#include <functional>
+#include <future>
+
+namespace monkeysworld {
+namespace engine {
+
+/**
+ *  Splits frames into two stages: simulation, which updates the scene and captures a snapshot
+ *  of it, and rendering, which draws the snapshot. When pipelined, frame N+1 is simulated on
+ *  its own thread while frame N is drawn and presented, so that update time hides behind GL
+ *  submission and vsync, at the cost of a frame of latency.
+ *
+ *  Each frame goes:
+ *    const frame_snapshot& frame = pipeline.WaitForFrame();
+ *    // the simulation is idle: poll events, swap scenes, run executor tasks, update and draw the UI
+ *    backend.PrepareUI(frame);
+ *    pipeline.StartNextFrame();
+ *    backend.Render(frame);
+ *
+ *  While the simulation runs, the render stage must stick to the snapshot: objects draw using the
+ *  transforms in their render context, and shouldn't read state which their Update writes.
+ *  Objects which need more than their transforms copy it in GameObject::SyncRenderState,
+ *  which WaitForFrame calls for every item in the frame before handing it out.
+ *  Nothing on the main thread may touch the game tree or the UI until the next WaitForFrame.
+ *  Objects updating on the simulation thread should hand GL work to the executor, which runs it
+ *  on the main thread between frames.
+ */
+class FramePipeline {
+ public:
+  /**
+   *  Fills in a snapshot for the next frame.
+   */
+  typedef std::function<void(frame_snapshot&)> simulate_func;
+
+  /**
+   *  @param simulate - simulates a frame. Run on the simulation thread, if pipelined.
+   *  @param pipelined - if true, frames are simulated on their own thread, one frame ahead of
+   *                     the render stage. Otherwise, StartNextFrame simulates on the calling thread.
+   */
+  FramePipeline(simulate_func simulate, bool pipelined);
+
+  /**
+   *  Waits for the frame being simulated, simulating one first if none is.
+   *  Once this returns, the simulation is idle until StartNextFrame.
+   *  Every item in the frame has had its render state synced.
+   *  Exceptions thrown while simulating are rethrown here.
+   *  @returns the finished frame. Valid until the next call to WaitForFrame or Reset.
+   */
+  const frame_snapshot& WaitForFrame();
+
+  /**
+   *  Starts simulating the next frame. Must follow a call to WaitForFrame.
+   */
+  void StartNextFrame();
+
+  /**
+   *  Drops every snapshot, releasing the objects they hold. Call while the simulation is idle,
+   *  before tearing down anything the snapshots' objects depend on.
+   */
+  void Reset();
+
+  /**
+   *  @returns true if frames are simulated on their own thread.
+   */
+  bool IsPipelined() const;
+
+  /**
+   *  Captures the scene into a snapshot, once it has been updated.
+   *  Transforms are read from the objects' hierarchy, which should be up to date.
+   *  Objects outside the active camera's frustum are left out. With no active camera, nothing is.
+   *  Every spotlight in the scene is passed along as-is -- lights aren't assigned per object.
+   *  @param visitor - visitor which has gathered the frame.
+   *  @param frame - snapshot to fill in. Anything already in its item list is kept.
+   */
+  static void CaptureFrame(const critter::visitor::FrameVisitor& visitor, frame_snapshot& frame);
+
+  /**
+   *  Adds the objects gathered by `visitor` to the snapshot's item list, leaving out any
+   *  which `frustum` culls. Subtrees whose bounds are outside of the frustum are skipped
+   *  without testing their contents. Tallies what was done in the snapshot's cull stats.
+   *  Subtree bounds are taken from the hierarchy's last update pass, so run one first.
+   *  @param visitor - visitor which has gathered the frame.
+   *  @param frustum - frustum to cull against, or null to keep everything.
+   *  @param frame - snapshot to fill in.
+   */
+  static void CaptureItems(const critter::visitor::FrameVisitor& visitor,
+                           const utils::Frustum* frustum,
+                           frame_snapshot& frame);
+
+  ~FramePipeline();
+  FramePipeline(const FramePipeline& other) = delete;
+  FramePipeline& operator=(const FramePipeline& other) = delete;
+ private:
+  simulate_func simulate_;
+  frame_snapshot snapshots_[2];
+  int front_;                           // snapshot most recently handed out by WaitForFrame
+  uint64_t next_frame_;
+  std::future<void> in_flight_;
+
+  // with no workers, tasks run as soon as they're submitted
+  file::LoaderThreadPool sim_thread_;
+};
+
+}
+}
+
+#endif  // FRAME_PIPELINE_H_
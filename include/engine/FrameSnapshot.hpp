@@ -0,0 +1,55 @@
+#ifndef FRAME_SNAPSHOT_H_
+#define FRAME_SNAPSHOT_H_
+
+#include <engine/RenderContext.hpp>
+
+#include <critter/GameObject.hpp>
+#include <critter/ui/Window.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cinttypes>
+#include <memory>
+#include <vector>
+
+namespace monkeysworld {
+namespace engine {
+
+/**
+ *  An object to draw, along with its transforms as of the end of the frame's simulation.
+ */
+struct render_item {
+  // keeps the object alive until the frame is drawn, even if the simulation drops it in the meantime
+  std::shared_ptr<critter::GameObject> object;
+  glm::mat4 model_matrix;
+  glm::mat3 normal_matrix;
+};
+
+/**
+ *  What frustum culling did with a frame's objects.
+ */
+struct cull_stats {
+  uint32_t tested;                          // bounding boxes tested against the frustum
+  uint32_t culled;                          // objects skipped, alone or along with their subtree
+  uint32_t drawn;                           // objects which made it into the frame
+};
+
+/**
+ *  Everything the render stage needs to draw a frame, captured once the simulation is done with it.
+ *  The render stage only reads from the snapshot, so the next frame can be simulated in the meantime.
+ */
+struct frame_snapshot {
+  uint64_t frame;                           // frame number, starting from 0
+  RenderContext rc;                         // active camera and spotlights
+  std::vector<render_item> items;           // in scene order
+  cull_stats culling {};                    // how `items` was arrived at
+
+  // UI objects aren't captured -- they're updated and drawn in place, while the simulation is
+  // idle (see RenderBackend::PrepareUI)
+  std::shared_ptr<critter::ui::Window> window;
+};
+
+}
+}
+
+#endif  // FRAME_SNAPSHOT_H_
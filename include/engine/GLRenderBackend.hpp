@@ -0,0 +1,49 @@
+#ifndef GL_RENDER_BACKEND_H_
+#define GL_RENDER_BACKEND_H_
+
+#include <engine/RenderBackend.hpp>
+#include <engine/EngineContext.hpp>
+
+#include <critter/SceneWalker.hpp>
+
+namespace monkeysworld {
+namespace engine {
+
+/**
+ *  Draws frames through GL, into the context's current frame, and presents them to a window.
+ *  Must be used from the thread which owns the window's GL context.
+ */
+class GLRenderBackend : public RenderBackend {
+ public:
+  /**
+   *  @param window - the window frames are presented to.
+   */
+  GLRenderBackend(GLFWwindow* window);
+
+  /**
+   *  Sets the context whose framebuffers are drawn into.
+   *  Must be set before the first frame, and updated when the context is swapped.
+   */
+  void SetContext(EngineContext* ctx);
+
+ protected:
+  void BeginFrame(const frame_snapshot& frame) override;
+  void DrawObject(const render_item& item, const RenderContext& rc) override;
+  void UpdateUI(const frame_snapshot& frame, const RenderContext& rc) override;
+  void DrawUI(const frame_snapshot& frame, const RenderContext& rc) override;
+  void EndFrame(const frame_snapshot& frame) override;
+
+ private:
+  GLFWwindow* window_;
+  EngineContext* ctx_;
+  int width_;
+  int height_;
+
+  // updates the UI, which stays on the main thread
+  critter::SceneWalker walker_;
+};
+
+}
+}
+
+#endif  // GL_RENDER_BACKEND_H_
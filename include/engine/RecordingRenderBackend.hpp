@@ -0,0 +1,75 @@
+#ifndef RECORDING_RENDER_BACKEND_H_
+#define RECORDING_RENDER_BACKEND_H_
+
+#include <engine/RenderBackend.hpp>
+
+#include <critter/SceneWalker.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cinttypes>
+#include <thread>
+#include <vector>
+
+namespace monkeysworld {
+namespace engine {
+
+/**
+ *  Identifies a step of the render stage.
+ */
+enum RenderCall {
+  CALL_UPDATE_UI,
+  CALL_BEGIN_FRAME,
+  CALL_DRAW_OBJECT,
+  CALL_DRAW_UI,
+  CALL_END_FRAME
+};
+
+/**
+ *  A single call made to a RecordingRenderBackend.
+ */
+struct recorded_call {
+  RenderCall call;
+  uint64_t frame;
+  uint64_t object_id;           // DRAW_OBJECT only
+  glm::mat4 model_matrix;       // DRAW_OBJECT only
+  glm::vec3 camera_position;
+  std::thread::id thread;       // the thread the call was made on
+};
+
+/**
+ *  Headless backend which records the render stage's calls, instead of drawing anything.
+ *  Lets the frame pipeline run in tests, without a window or a GL context.
+ *  The UI is still updated, as it would be by the engine, but not laid out or drawn.
+ */
+class RecordingRenderBackend : public RenderBackend {
+ public:
+  /**
+   *  @returns every call made so far, in order.
+   */
+  const std::vector<recorded_call>& GetCalls() const;
+
+  /**
+   *  Forgets every call made so far.
+   */
+  void Clear();
+
+ protected:
+  void BeginFrame(const frame_snapshot& frame) override;
+  void DrawObject(const render_item& item, const RenderContext& rc) override;
+  void UpdateUI(const frame_snapshot& frame, const RenderContext& rc) override;
+  void DrawUI(const frame_snapshot& frame, const RenderContext& rc) override;
+  void EndFrame(const frame_snapshot& frame) override;
+
+ private:
+  void Record(RenderCall call, const frame_snapshot& frame);
+
+  std::vector<recorded_call> calls_;
+  uint64_t frame_ = 0;          // frame currently being drawn
+  critter::SceneWalker walker_;
+};
+
+}
+}
+
+#endif  // RECORDING_RENDER_BACKEND_H_
@@ -0,0 +1,98 @@
+#ifndef RENDER_BACKEND_H_
+#define RENDER_BACKEND_H_
+
+#include <engine/FrameSnapshot.hpp>
+#include <engine/RenderContext.hpp>
+#include <shader/FramebufferPool.hpp>
+
+namespace monkeysworld {
+namespace engine {
+
+/**
+ *  What the render stage did with a frame.
+ */
+struct render_stats {
+  critter::ui::redraw_stats ui;             // UI framebuffers redrawn, and the pixels they covered
+  shader::framebuffer_pool_stats framebuffers;  // running totals for the UI framebuffer pool
+};
+
+/**
+ *  The render stage of a frame, split from whatever actually does the drawing.
+ *
+ *  Render walks a snapshot in a fixed order -- BeginFrame, DrawObject for each item,
+ *  DrawUI, then EndFrame -- and subclasses fill in each step. The engine draws through GL,
+ *  while tests can record the calls instead, so that the stage runs without a window.
+ *
+ *  The UI isn't part of the snapshot: UI objects may read game state from their Update, and
+ *  game objects may edit the UI from theirs. So the UI is updated, laid out and drawn into its
+ *  own targets by PrepareUI, which must run while the simulation is idle (between
+ *  FramePipeline::WaitForFrame and StartNextFrame). Render only composites what it drew:
+ *    const frame_snapshot& frame = pipeline.WaitForFrame();
+ *    backend.PrepareUI(frame);
+ *    pipeline.StartNextFrame();
+ *    backend.Render(frame);
+ */
+class RenderBackend {
+ public:
+  /**
+   *  Draws a single frame.
+   *  @param frame - the frame to draw.
+   */
+  void Render(const frame_snapshot& frame);
+
+  /**
+   *  Updates, lays out and draws the UI for a frame, ahead of Render. Only call this while the
+   *  simulation is idle. Starts the frame's stats.
+   *  @param frame - the frame whose UI should be drawn.
+   */
+  void PrepareUI(const frame_snapshot& frame);
+
+  /**
+   *  @returns stats for the last frame prepared and drawn.
+   */
+  const render_stats& GetStats() const;
+
+  virtual ~RenderBackend() {}
+
+ protected:
+  /**
+   *  Gets the frame's target ready to draw into.
+   */
+  virtual void BeginFrame(const frame_snapshot& frame) = 0;
+
+  /**
+   *  Draws an object.
+   *  @param item - the object, with its transforms for this frame.
+   *  @param rc - the frame's render context, with the item's transforms filled in.
+   */
+  virtual void DrawObject(const render_item& item, const RenderContext& rc) = 0;
+
+  /**
+   *  Updates and lays out the frame's UI, then draws it into its own targets.
+   *  Runs while the simulation is idle.
+   */
+  virtual void UpdateUI(const frame_snapshot& frame, const RenderContext& rc) = 0;
+
+  /**
+   *  Draws the UI prepared by UpdateUI on top of everything else.
+   *  Runs alongside the simulation, so mustn't read the UI's state beyond its finished image.
+   */
+  virtual void DrawUI(const frame_snapshot& frame, const RenderContext& rc) = 0;
+
+  /**
+   *  Presents the finished frame.
+   */
+  virtual void EndFrame(const frame_snapshot& frame) = 0;
+
+  // filled in by the steps above, as they go
+  render_stats stats_;
+
+ private:
+  // the snapshot is const, so per-object transforms go into a copy of its context
+  RenderContext rc_;
+};
+
+}
+}
+
+#endif  // RENDER_BACKEND_H_
@@ -4,6 +4,9 @@
 #include <shader/light/LightTypes.hpp>
 #include <critter/Camera.hpp>
 
+#include <glm/glm.hpp>
+
+#include <cinttypes>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -36,7 +39,7 @@ class RenderContext {
   /**
    *  Creates a new render context
    */ 
-  RenderContext() {}
+  RenderContext() : rp_(RENDER), model_matrix_(1.0), normal_matrix_(1.0) {}
 
   /**
    *  Returns a reference to the game camera.
@@ -53,14 +56,29 @@ class RenderContext {
    */ 
   RenderPass GetRenderPass() const;
 
+  /**
+   *  Returns the model matrix of the object currently being drawn, as of the frame being rendered.
+   *  Objects should draw with this, rather than their live transform, which may already have
+   *  moved on to the next frame.
+   */ 
+  const glm::mat4& GetModelMatrix() const;
+
+  /**
+   *  Returns the normal matrix to go with GetModelMatrix.
+   */ 
+  const glm::mat3& GetNormalMatrix() const;
+
   // setters
   void SetActiveCamera(std::shared_ptr<critter::Camera> cam);
   void SetSpotlights(const std::vector<shader::light::spotlight_info>& spotlights);
   void SetRenderPass(RenderPass rp);
+  void SetModelTransforms(const glm::mat4& model_matrix, const glm::mat3& normal_matrix);
  private:
   std::vector<shader::light::spotlight_info> spotlights_;
   critter::camera_info cam_info_;
   RenderPass rp_;
+  glm::mat4 model_matrix_;
+  glm::mat3 normal_matrix_;
 
 };
 
@@ -32,6 +32,12 @@ class SceneSwap {
    */ 
   file::loader_progress GetLoaderProgress();
 
+  /**
+   *  @returns load timings for the incoming scene. Once the swap is ready, these cover
+   *           the whole scene load -- see LoaderTelemetry::WriteChromeTrace.
+   */
+  std::shared_ptr<file::LoaderTelemetry> GetLoaderTelemetry();
+
   /**
    *  Swaps scenes if the next context is ready to be used.
    *  Otherwise, waits until the next scene is initialized, then swaps.
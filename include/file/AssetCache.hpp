@@ -0,0 +1,227 @@
+#ifndef ASSET_CACHE_H_
+#define ASSET_CACHE_H_
+
+#include <file/AssetStamp.hpp>
+
+#include <atomic>
+#include <cinttypes>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace monkeysworld {
+namespace file {
+
+/**
+ *  A loaded asset, along with the version of its source it was built from.
+ *  @param V - the type of data stored in the cache.
+ */
+template <typename V>
+struct cache_entry {
+  V value;
+  asset_stamp stamp;
+  bool packed = false;        // true if `value` was read from an asset pack
+  uint64_t checked = 0;       // revalidation generation at which `stamp` was last checked
+};
+
+/**
+ *  Read-optimized map from paths to cached assets.
+ *
+ *  Lookups never lock: the table is an open-addressed array of node pointers, and nodes are never
+ *  modified or freed once published. Writers serialize on a mutex, and publish new nodes (or a new,
+ *  larger table) with a single release store, so a reader sees either the old state or the new one.
+ *
+ *  Since readers aren't tracked, nothing they might be looking at is freed while the cache lives:
+ *  old tables, and nodes which were replaced by a rebuild, are retired until destruction.
+ *  Tables double in size, so retired tables cost at most as much as the live one. Replaced nodes
+ *  only come from revalidation, which rebuilds assets whose sources were edited.
+ *
+ *  @param V - the type of data stored in the cache.
+ */
+template <typename V>
+class AssetCache {
+ public:
+  struct node {
+    node(const std::string& path, size_t hash, cache_entry<V>&& entry) : path(path),
+                                                                         hash(hash),
+                                                                         value(std::move(entry.value)),
+                                                                         packed(entry.packed),
+                                                                         stamp(entry.stamp),
+                                                                         checked(entry.checked) {}
+    const std::string path;
+    const size_t hash;
+    const V value;
+    const bool packed;
+    asset_stamp stamp;                // only accessed under the write lock
+    std::atomic<uint64_t> checked;    // revalidation generation at which `stamp` was last checked
+  };
+
+  /**
+   *  @param capacity - initial number of slots. Rounded up to a power of two.
+   */
+  AssetCache(size_t capacity = 64) : size_(0) {
+    size_t slots = 16;
+    while (slots < capacity) {
+      slots <<= 1;
+    }
+
+    table* t = new table(slots);
+    tables_.push_back(std::unique_ptr<table>(t));
+    table_.store(t, std::memory_order_release);
+  }
+
+  /**
+   *  Looks up an asset without locking.
+   *  @returns the node stored for `path`, or null if there is none.
+   */
+  node* Find(const std::string& path) const {
+    return Find(path, std::hash<std::string>()(path));
+  }
+
+  /**
+   *  Stores an entry, unless one exists and `replace` is false.
+   *  @returns the node stored for `path` after the call.
+   */
+  node* Store(const std::string& path, cache_entry<V>&& entry, bool replace) {
+    size_t hash = std::hash<std::string>()(path);
+    std::lock_guard<std::mutex> lock(write_lock_);
+    table* t = table_.load(std::memory_order_relaxed);
+    size_t index;
+    node* current = Probe(t, path, hash, &index);
+    if (current != nullptr && !replace) {
+      return current;
+    }
+
+    node* res = new node(path, hash, std::move(entry));
+    nodes_.push_back(std::unique_ptr<node>(res));
+    if (current != nullptr) {
+      // readers may still hold the old node, so it lives on until we're destroyed
+      t->slots[index].store(res, std::memory_order_release);
+      return res;
+    }
+
+    if ((size_ + 1) * 2 > t->mask + 1) {
+      t = Grow(t);
+      Probe(t, path, hash, &index);
+    }
+
+    t->slots[index].store(res, std::memory_order_release);
+    size_++;
+    return res;
+  }
+
+  /**
+   *  Records that a node's source was checked at `generation`.
+   *  @param stamp - the source's current stamp.
+   */
+  void MarkChecked(node* n, const asset_stamp& stamp, uint64_t generation) {
+    std::lock_guard<std::mutex> lock(write_lock_);
+    n->stamp = stamp;
+    n->checked.store(generation, std::memory_order_release);
+  }
+
+  /**
+   *  @returns the last known stamp for a node's source.
+   */
+  asset_stamp GetStamp(const node* n) {
+    std::lock_guard<std::mutex> lock(write_lock_);
+    return n->stamp;
+  }
+
+  /**
+   *  Calls `func(const node&)` for every stored asset. Writers are blocked for the duration.
+   */
+  template <typename Func>
+  void ForEach(Func&& func) {
+    std::lock_guard<std::mutex> lock(write_lock_);
+    table* t = table_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i <= t->mask; i++) {
+      node* n = t->slots[i].load(std::memory_order_relaxed);
+      if (n != nullptr) {
+        func(static_cast<const node&>(*n));
+      }
+    }
+  }
+
+  AssetCache(const AssetCache& other) = delete;
+  AssetCache& operator=(const AssetCache& other) = delete;
+ private:
+  struct table {
+    table(size_t slot_count) : mask(slot_count - 1), slots(new std::atomic<node*>[slot_count]) {
+      for (size_t i = 0; i < slot_count; i++) {
+        slots[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    const size_t mask;
+    std::unique_ptr<std::atomic<node*>[]> slots;
+  };
+
+  node* Find(const std::string& path, size_t hash) const {
+    table* t = table_.load(std::memory_order_acquire);
+    for (size_t i = hash & t->mask;; i = (i + 1) & t->mask) {
+      node* n = t->slots[i].load(std::memory_order_acquire);
+      if (n == nullptr) {
+        return nullptr;
+      }
+
+      if (n->hash == hash && n->path == path) {
+        return n;
+      }
+    }
+  }
+
+  /**
+   *  Finds the slot for `path` in `t`, under the write lock.
+   *  @param index - output param for the slot holding `path`, or the empty slot where it belongs.
+   *  @returns the node stored for `path`, or null if there is none.
+   */
+  static node* Probe(table* t, const std::string& path, size_t hash, size_t* index) {
+    for (size_t i = hash & t->mask;; i = (i + 1) & t->mask) {
+      node* n = t->slots[i].load(std::memory_order_relaxed);
+      if (n == nullptr || (n->hash == hash && n->path == path)) {
+        *index = i;
+        return n;
+      }
+    }
+  }
+
+  /**
+   *  Copies every node into a table twice the size of `t`, and publishes it.
+   *  @returns the new table.
+   */
+  table* Grow(table* t) {
+    table* res = new table((t->mask + 1) * 2);
+    for (size_t i = 0; i <= t->mask; i++) {
+      node* n = t->slots[i].load(std::memory_order_relaxed);
+      if (n != nullptr) {
+        size_t j = n->hash & res->mask;
+        while (res->slots[j].load(std::memory_order_relaxed) != nullptr) {
+          j = (j + 1) & res->mask;
+        }
+
+        res->slots[j].store(n, std::memory_order_relaxed);
+      }
+    }
+
+    // readers still probing `t` find what they were looking for, or miss and retry under a lock
+    tables_.push_back(std::unique_ptr<table>(res));
+    table_.store(res, std::memory_order_release);
+    return res;
+  }
+
+  std::atomic<table*> table_;
+  size_t size_;
+
+  // everything ever published, kept alive for readers which might still hold it
+  std::vector<std::unique_ptr<table>> tables_;
+  std::vector<std::unique_ptr<node>> nodes_;
+  std::mutex write_lock_;
+};
+
+}
+}
+
+#endif  // ASSET_CACHE_H_
@@ -0,0 +1,193 @@
+#ifndef ASSET_PACK_H_
+#define ASSET_PACK_H_
+
+#include <file/BakedMesh.hpp>
+#include <file/CachedLoader.hpp>
+#include <file/CacheStreambuf.hpp>
+#include <file/MappedFile.hpp>
+
+#include <model/Mesh.hpp>
+#include <storage/VertexPacketTypes.hpp>
+
+#include <cinttypes>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace monkeysworld {
+
+namespace shader {
+class Texture;
+}
+
+namespace file {
+
+/**
+ *  Packed asset archive.
+ *  Holds the contents of every asset in a scene's cache in one file, so that a scene can be
+ *  loaded by mapping a single file rather than opening and reading each asset on its own.
+ *  Files are stored raw, textures are stored decoded, and models are stored in the baked mesh format.
+ *
+ *  Layout:
+ *    - asset_pack_header (64 bytes)
+ *    - blob region: one blob per entry, each aligned to ASSET_PACK_ALIGNMENT
+ *    - table of contents: entry_count asset_pack_entry structs, sorted by type, then path
+ *    - string table: entry paths, not null terminated
+ *
+ *  The pack is a snapshot -- it is not checked against the source files when it's opened.
+ *  Each entry records the stamp of its source, which loaders check lazily: an asset whose source
+ *  has changed is rebuilt from disk, and CachedFileLoader rewrites the pack on shutdown.
+ */
+
+static const uint32_t ASSET_PACK_MAGIC = 0x4B50574D;   // MWPK
+static const uint32_t ASSET_PACK_VERSION = 2;
+static const uint64_t ASSET_PACK_ALIGNMENT = 64;
+
+struct asset_pack_header {
+  uint32_t magic;             // ASSET_PACK_MAGIC
+  uint32_t version;           // ASSET_PACK_VERSION
+  uint64_t entry_count;       // number of entries in the table of contents
+  uint64_t toc_offset;        // absolute offset of the table of contents
+  uint64_t strings_offset;    // absolute offset of the string table
+  uint64_t strings_size;      // size of the string table, in bytes
+  uint64_t padding[3];        // pads header out to 64 bytes
+};
+
+struct asset_pack_entry {
+  uint16_t type;              // CacheType of this entry
+  uint16_t reserved;
+  uint32_t path_length;       // length of the path, in bytes
+  uint64_t path_offset;       // offset of the path, relative to the string table
+  uint64_t data_offset;       // absolute offset of the blob
+  uint64_t data_size;         // size of the blob, in bytes
+  uint64_t source_size;       // size of the source file when the pack was built
+  int64_t  source_mtime;      // last write time of the source file when the pack was built
+  uint32_t content_hash;      // CRC32 of the source file when the pack was built
+  uint32_t padding[3];        // pads entry out to 64 bytes
+};
+
+// prefixes decoded pixel data in texture blobs
+struct asset_pack_texture {
+  int32_t width;
+  int32_t height;
+  int32_t channels;
+  int32_t reserved;
+};
+
+static_assert(sizeof(asset_pack_header) == 64, "asset pack header must be 64 bytes");
+static_assert(sizeof(asset_pack_entry) == 64, "asset pack entries must be 64 bytes");
+static_assert(sizeof(asset_pack_texture) == 16, "asset pack texture header must be 16 bytes");
+
+class AssetPack : public std::enable_shared_from_this<AssetPack> {
+ public:
+  /**
+   *  Maps an asset pack from disk.
+   *  @param pack_path - path to the pack.
+   *  @returns the opened pack, or nullptr if it is missing or malformed.
+   */
+  static std::shared_ptr<AssetPack> Open(const std::string& pack_path);
+
+  /**
+   *  Looks up an entry in this pack.
+   *  @param type - the type of asset being searched for.
+   *  @param path - path to the asset, as recorded in the cache.
+   *  @returns the associated entry, or nullptr if the asset isn't in this pack.
+   */
+  const asset_pack_entry* Find(CacheType type, const std::string& path) const;
+
+  /**
+   *  @returns the number of entries stored in this pack.
+   */
+  uint64_t GetEntryCount() const {
+    return entry_count_;
+  }
+
+  /**
+   *  @returns the entry at `index`, in table of contents order.
+   */
+  const asset_pack_entry& GetEntry(uint64_t index) const {
+    return toc_[index];
+  }
+
+  /**
+   *  @returns the path associated with an entry.
+   */
+  std::string_view GetPath(const asset_pack_entry& entry) const;
+
+  /**
+   *  @returns the stamp of the source an entry was built from.
+   */
+  static asset_stamp GetStamp(const asset_pack_entry& entry);
+
+  /**
+   *  @returns a pointer to the start of an entry's blob.
+   */
+  const char* GetData(const asset_pack_entry& entry) const {
+    return file_.GetData() + entry.data_offset;
+  }
+
+  /**
+   *  Reads a raw file out of this pack, without copying it.
+   *  @param path - path to the desired file.
+   *  @param size - output param for the size of the file.
+   *  @param stamp - optional output param for the stamp of the packed file.
+   *  @returns pointer to the file contents, which keeps this pack alive,
+   *           or nullptr if the file isn't in this pack.
+   */
+  std::shared_ptr<const char> GetFile(const std::string& path, uint64_t* size, asset_stamp* stamp = nullptr);
+
+  /**
+   *  Creates a texture from the decoded pixels stored in this pack.
+   *  @param path - path to the source image.
+   *  @param stamp - optional output param for the stamp of the source image.
+   *  @returns the texture, or nullptr if the image isn't in this pack.
+   */
+  std::shared_ptr<shader::Texture> GetTexture(const std::string& path, asset_stamp* stamp = nullptr);
+
+  /**
+   *  Creates a mesh from a baked model stored in this pack.
+   *  @param path - path to the source OBJ.
+   *  @param file_size - output param for the size of the source OBJ.
+   *  @param stamp - optional output param for the stamp of the source OBJ.
+   *  @returns the mesh, or nullptr if the model isn't in this pack.
+   */
+  std::shared_ptr<model::Mesh<storage::VertexPacket3D>> GetModel(const std::string& path,
+                                                                 uint64_t* file_size,
+                                                                 asset_stamp* stamp = nullptr);
+
+  AssetPack(const AssetPack& other) = delete;
+  AssetPack& operator=(const AssetPack& other) = delete;
+ private:
+  AssetPack(MappedFile&& file);
+
+  /**
+   *  Checks that the header and every entry are in bounds.
+   *  @returns true if the pack is well formed, false otherwise.
+   */
+  bool Validate(const std::string& pack_path);
+
+  MappedFile file_;
+  const asset_pack_entry* toc_;
+  const char* strings_;
+  uint64_t entry_count_;
+};
+
+/**
+ *  Builds an asset pack from a list of cache records.
+ *  Records which cannot be packed (fonts, cubemaps, audio) or whose source is missing are skipped --
+ *  loaders will fall back to reading these from disk. Record stamps are used to avoid rehashing
+ *  sources which haven't been touched.
+ *  @param pack_path - destination path. Parent directories are created if missing.
+ *  @param records - the assets being packed.
+ *  @param bake_dir - directory models are baked into on the way, if their bakes are missing or stale.
+ *  @returns true if the pack was written successfully, false otherwise.
+ */
+bool WriteAssetPack(const std::string& pack_path,
+                    const std::vector<cache_record>& records,
+                    const std::string& bake_dir = BAKED_MESH_DIR);
+
+}
+}
+
+#endif  // ASSET_PACK_H_
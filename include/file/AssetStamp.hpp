@@ -0,0 +1,63 @@
+#ifndef ASSET_STAMP_H_
+#define ASSET_STAMP_H_
+
+#include <cinttypes>
+#include <string>
+
+namespace monkeysworld {
+namespace file {
+
+/**
+ *  Identifies the version of a source file which a cached asset was built from.
+ *
+ *  Checking a stamp is cheap in the common case: if the source's size and mtime still match,
+ *  it's assumed to be unchanged. Otherwise the source is rehashed, and only considered changed
+ *  if its contents differ -- so touching a file, or checking it out again, won't trigger a rebuild.
+ *
+ *  Cubemap paths (":a:b:c:d:e:f") are stamped as a whole: the size is the sum of the faces,
+ *  and the mtime and hash are combined from each face.
+ */
+struct asset_stamp {
+  uint64_t source_size = 0;   // size of the source, in bytes
+  int64_t  mtime = 0;         // last write time of the source
+  uint32_t content_hash = 0;  // CRC32 of the source's contents
+};
+
+enum StampResult {
+  STAMP_CURRENT,              // source contents match the stamp
+  STAMP_CHANGED,              // source contents differ from the stamp
+  STAMP_MISSING               // source could not be read
+};
+
+/**
+ *  Fetches the size and last write time of a source file, for staleness checks.
+ *  @param path - path to the source file.
+ *  @param size - output param for the file's size.
+ *  @param mtime - output param for the file's last write time.
+ *  @returns true if the file exists and could be queried, false otherwise.
+ */
+bool GetSourceStamp(const std::string& path, uint64_t* size, int64_t* mtime);
+
+/**
+ *  Brings a stamp up to date with its source. The source is only rehashed if its
+ *  size or mtime no longer match `stamp`, so a zeroed stamp will always be rehashed.
+ *  @param path - path to the source.
+ *  @param stamp - the stamp being updated.
+ *  @returns true if the source could be read, false otherwise. `stamp` is untouched on failure.
+ */
+bool UpdateAssetStamp(const std::string& path, asset_stamp* stamp);
+
+/**
+ *  Checks whether the contents of a source still match a stamp.
+ *  @param path - path to the source.
+ *  @param stamp - the stamp being checked. Updated to match the source, unless it's missing --
+ *                 so a touched but unchanged source won't be rehashed again, and a changed
+ *                 source can be rebuilt without hashing it twice.
+ *  @returns the state of the source, relative to `stamp`.
+ */
+StampResult CheckAssetStamp(const std::string& path, asset_stamp* stamp);
+
+}
+}
+
+#endif  // ASSET_STAMP_H_
@@ -39,9 +39,16 @@ class AudioLoader : public CachedLoader<std::shared_ptr<audio::AudioBuffer>, Aud
     float* left;      // l data
     float* right;     // r data
     int sample_count; // num samples
+    asset_stamp stamp;  // version of the source the samples were read from
+    uint64_t checked;   // revalidation generation at which `stamp` was last checked
   };
 
-  std::shared_ptr<audio::AudioBuffer> LoadFromPath(const std::string& path);
+  /**
+   *  Creates a buffer for an audio file, prefilled from the cache if its samples are up to date.
+   *  @param path - the path to our desired audio file.
+   *  @param stamp - last known stamp for the file, if it isn't cached yet.
+   */
+  std::shared_ptr<audio::AudioBuffer> LoadFromPath(const std::string& path, const asset_stamp& stamp = asset_stamp());
   
   /**
    *  Loads samples to the cache.
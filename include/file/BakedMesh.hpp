@@ -0,0 +1,108 @@
+#ifndef BAKED_MESH_H_
+#define BAKED_MESH_H_
+
+#include <file/AssetStamp.hpp>
+
+#include <model/Mesh.hpp>
+#include <storage/VertexPacketTypes.hpp>
+
+#include <cinttypes>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace monkeysworld {
+namespace file {
+
+/**
+ *  Pre-baked binary mesh format.
+ *  Baked meshes are written after an OBJ is parsed for the first time, so that
+ *  successive loads can map the geometry straight from disk instead of re-tokenizing text.
+ *
+ *  Layout:
+ *    - baked_mesh_header (64 bytes)
+ *    - vertex_count packed VertexPacket3D structs
+ *    - index_count uint32_t indices (triangles)
+ */
+
+static const uint32_t BAKED_MESH_MAGIC = 0x4853454D;   // MESH
+static const uint32_t BAKED_MESH_VERSION = 1;
+
+// where bakes are kept, unless told otherwise
+static const char* const BAKED_MESH_DIR = "resources/cache/mesh/";
+
+struct baked_mesh_header {
+  uint32_t magic;             // BAKED_MESH_MAGIC
+  uint32_t version;           // BAKED_MESH_VERSION
+  uint32_t packet_size;       // sizeof(VertexPacket3D) at bake time
+  uint32_t reserved;
+  uint64_t source_size;       // size of the source OBJ, in bytes
+  int64_t  source_mtime;      // last write time of the source OBJ
+  uint64_t vertex_count;      // number of vertex packets
+  uint64_t index_count;       // number of indices
+  uint64_t padding[2];        // pads header out to 64 bytes
+};
+
+static_assert(sizeof(baked_mesh_header) == 64, "baked mesh header must be 64 bytes");
+
+/**
+ *  @param obj_path - path to a source OBJ file.
+ *  @param bake_dir - directory bakes are kept in, ending in a separator.
+ *  @returns the path where the baked version of `obj_path` is stored.
+ */
+std::string GetBakedMeshPath(const std::string& obj_path, const std::string& bake_dir = BAKED_MESH_DIR);
+
+/**
+ *  Writes a mesh to disk in the baked format.
+ *  @param bake_path - destination path. Parent directories are created if missing.
+ *  @param mesh - the mesh being baked.
+ *  @param source_size - size of the source OBJ.
+ *  @param source_mtime - last write time of the source OBJ.
+ *  @returns true if the bake was written successfully, false otherwise.
+ */
+bool WriteBakedMesh(const std::string& bake_path,
+                    const model::Mesh<storage::VertexPacket3D>& mesh,
+                    uint64_t source_size,
+                    int64_t source_mtime);
+
+/**
+ *  Writes a mesh to an output stream in the baked format.
+ *  Used when baking into a larger container, such as an asset pack.
+ *  @param output - stream being written to.
+ *  @param mesh - the mesh being baked.
+ *  @param source_size - size of the source OBJ.
+ *  @param source_mtime - last write time of the source OBJ.
+ *  @returns true if the bake was written successfully, false otherwise.
+ */
+bool WriteBakedMesh(std::ostream& output,
+                    const model::Mesh<storage::VertexPacket3D>& mesh,
+                    uint64_t source_size,
+                    int64_t source_mtime);
+
+/**
+ *  Maps a baked mesh from disk and constructs a Mesh from its contents.
+ *  @param bake_path - path to the baked mesh.
+ *  @param source_size - expected size of the source OBJ.
+ *  @param source_mtime - expected last write time of the source OBJ.
+ *  @returns the loaded mesh, or nullptr if the bake is missing, malformed, or stale.
+ */
+std::shared_ptr<model::Mesh<storage::VertexPacket3D>> ReadBakedMesh(const std::string& bake_path,
+                                                                    uint64_t source_size,
+                                                                    int64_t source_mtime);
+
+/**
+ *  Constructs a Mesh from a baked mesh which is already in memory.
+ *  Checks that the bake is well formed, but not whether it is stale.
+ *  @param data - pointer to the start of the baked mesh.
+ *  @param size - size of the baked mesh, in bytes.
+ *  @param name - name used to identify the bake in log messages.
+ *  @returns the loaded mesh, or nullptr if the bake is malformed.
+ */
+std::shared_ptr<model::Mesh<storage::VertexPacket3D>> ReadBakedMesh(const char* data,
+                                                                    uint64_t size,
+                                                                    const std::string& name);
+
+}
+}
+
+#endif  // BAKED_MESH_H_
@@ -1,6 +1,8 @@
 #ifndef CACHE_STREAMBUF_H_
 #define CACHE_STREAMBUF_H_
 
+#include <file/MappedFile.hpp>
+
 #include <memory>
 #include <streambuf>
 #include <vector>
@@ -8,17 +10,43 @@
 namespace monkeysworld {
 namespace file {
 
+/**
+ *  Read-only streambuf over a block of cached file contents.
+ *  Copies share the underlying data.
+ *
+ *  Streambufs over a MappedFile hand out the mapping a chunk at a time, and ask the OS to
+ *  page in the next chunk as each one is reached -- so reads can start as soon as the file
+ *  is mapped, rather than after the whole thing has been read in.
+ */
 class CacheStreambuf : public std::streambuf {
 
  public:
+  static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
   CacheStreambuf();
   CacheStreambuf(const std::shared_ptr<std::vector<char>>& data);
 
+  /**
+   *  Creates a streambuf over a block of memory owned elsewhere, e.g. an asset pack mapping.
+   *  @param data - pointer to the start of the block. Should share ownership with
+   *                whatever keeps the block alive (see shared_ptr's aliasing ctor).
+   *  @param size - size of the block, in bytes.
+   */
+  CacheStreambuf(const std::shared_ptr<const char>& data, size_t size);
+
+  /**
+   *  Creates a streambuf which reads straight from a mapped file.
+   *  @param file - the mapping being read. Shared with any other streambufs reading it.
+   *  @param chunk_size - number of bytes exposed by each underflow.
+   */
+  CacheStreambuf(const std::shared_ptr<const MappedFile>& file, size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
   // -1 on failure, abs pos on success
   std::streampos seekoff(std::streamoff off, std::ios_base::seekdir way, std::ios_base::openmode which) override;
   std::streampos seekpos(std::streampos sp, std::ios_base::openmode which) override;
 
   std::streamsize showmanyc() override;
+  std::streamsize xsgetn(char* s, std::streamsize n) override;
 
   // zeroes out inherited output methods to ensure that writing does not occur
   std::streamsize xsputn(const char* s, std::streamsize n) override;
@@ -30,7 +58,17 @@ class CacheStreambuf : public std::streambuf {
   CacheStreambuf(CacheStreambuf&& other);
   CacheStreambuf& operator=(CacheStreambuf&& other);
  private:
-  const std::shared_ptr<std::vector<char>> data_;
+  /**
+   *  Moves the read position to `pos`, and exposes the chunk which follows it.
+   */
+  void SetPosition(size_t pos);
+
+  const std::shared_ptr<const char> data_;
+  size_t size_;
+
+  // only set for mapped files
+  std::shared_ptr<const MappedFile> file_;
+  size_t chunk_size_;
 };
 
 } // namespace file
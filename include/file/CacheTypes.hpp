@@ -0,0 +1,38 @@
+#ifndef CACHE_TYPES_H_
+#define CACHE_TYPES_H_
+
+#include <file/AssetStamp.hpp>
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+
+namespace monkeysworld {
+namespace file {
+
+struct loader_progress {
+  size_t bytes_read;          // number of bytes read thus far
+  size_t bytes_sum;           // number of bytes expected
+};
+
+enum CacheType {
+  MODEL = 0,
+  FONT,
+  TEXTURE,
+  FILE,
+  CUBEMAP,
+  AUDIO
+};
+
+// struct representing a file which may be cached by the loader
+struct cache_record {
+  CacheType type;
+  std::string path;
+  uint64_t file_size;
+  asset_stamp stamp;          // version of the source this record was built from
+};
+
+}
+}
+
+#endif  // CACHE_TYPES_H_
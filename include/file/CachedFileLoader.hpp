@@ -1,12 +1,14 @@
 #ifndef CACHED_FILE_LOADER_H_
 #define CACHED_FILE_LOADER_H_
 
+#include <file/AssetPack.hpp>
 #include <file/CacheStreambuf.hpp>
 #include <file/CachedFileLoader.hpp>
 #include <file/CachedLoader.hpp>
 #include <file/ModelLoader.hpp>
 #include <file/FileLoader.hpp>
 #include <file/FontLoader.hpp>
+#include <file/LoaderTelemetry.hpp>
 #include <file/TextureLoader.hpp>
 #include <file/CubeMapLoader.hpp>
 
@@ -29,28 +31,63 @@ namespace file {
  * 
  *  To clear the cache: just delete the respective cache file.
  * 
+ *  Each cache record stores the size, mtime and content hash of its source. Assets loaded on startup
+ *  are checked against their source lazily -- see RequestRevalidation -- so an edited asset is
+ *  rebuilt on its own, without invalidating the rest of the cache.
+ * 
+ *  In archive mode, the contents of the cache are also kept in an asset pack
+ *  (resources/cache/<cache_name>.pack), which is mapped once on load. Files, textures and models
+ *  found in the pack are served directly from it. The pack is rewritten on shutdown if the scene
+ *  loaded anything it doesn't contain. Assets served from the pack should be released before the
+ *  loader is destroyed -- the old pack can't be replaced while something still maps it on windows.
+ * 
  *  TODO: It looks like there's actually some gains to be made thru multithreading.
  *        It's not a big deal at all but if it comes down to it it might be beneficial lol.
  */ 
 class CachedFileLoader {
  public:
 
-  static const uint32_t CACHE_MAGIC = 0x4D534657;   // WFSM
+  static const uint32_t CACHE_MAGIC = 0x32534657;   // WFS2
   static const uint64_t CACHE_DATA_START = 12;
 
   /**
    *  Constructs a new CachedFileLoader.
    *  The CachedFileLoader will use the cache file located in resources/cache/<cache_name>.filecache.
    *  This ctor call will also spin up the load thread.
+   *  @param cache_name - name of the cache file.
+   *  @param use_archive - if true, assets are also read from and written to an asset pack.
+   */ 
+  CachedFileLoader(const std::string& cache_name, bool use_archive = false);
+
+  /**
+   *  Generates a vector of cache records.
+   *  @param cache_path - path to the cache file.
+   *  @returns the records stored in the cache, or an empty vector if the cache is missing or invalid.
    */ 
-  CachedFileLoader(const std::string& cache_name);
+  static std::vector<cache_record> ReadCacheFileToVector(const std::string& cache_path);
+
+  /**
+   *  Marks every cached asset as possibly stale, e.g. when the window regains focus after
+   *  assets were edited. Each asset is checked against its source the next time it's loaded,
+   *  and only those whose contents have changed are rebuilt.
+   */
+  void RequestRevalidation();
 
   /**
    *  Returns the current state of the loader, in terms of bytes loaded vs. bytes expected.
+   *  Lock-free, so it's safe to poll every frame.
    *  @return copy of the current loader progress.
    */ 
   loader_progress GetLoaderProgress();
 
+  /**
+   *  @returns timings for every asset loaded through this loader, e.g. to dump
+   *           a JSON summary or Chrome trace once a scene has finished loading.
+   */
+  std::shared_ptr<LoaderTelemetry> GetTelemetry() {
+    return telemetry_;
+  }
+
   /**
    *  Loads a file from cache.
    *  @param path - path to the desired file.
@@ -89,12 +126,17 @@ class CachedFileLoader {
  private:
 
   /**
-   *  Generates a vector of cache records.
+   *  @returns true if `cache` contains anything which belongs in our pack, but is missing from it
+   *           or has changed since it was packed.
    */ 
-  std::vector<cache_record> ReadCacheFileToVector(const std::string& cache_path);
+  bool IsPackOutdated(const std::vector<cache_record>& cache);
   
+  std::shared_ptr<LoaderTelemetry> telemetry_;
   std::shared_ptr<LoaderThreadPool> thread_pool_;
   std::string cache_path_;
+  bool use_archive_;
+  std::string pack_path_;
+  std::shared_ptr<AssetPack> pack_;
   std::unique_ptr<FileLoader> file_loader_;
   std::unique_ptr<ModelLoader> model_loader_;
   std::unique_ptr<FontLoader> font_loader_;
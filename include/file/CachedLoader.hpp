@@ -1,15 +1,21 @@
 #ifndef CACHED_LOADER_H_
 #define CACHED_LOADER_H_
 
+#include <file/AssetCache.hpp>
+#include <file/AssetStamp.hpp>
+#include <file/CacheTypes.hpp>
+#include <file/LoaderTelemetry.hpp>
 #include <file/LoaderThreadPool.hpp>
 
 #include <boost/log/trivial.hpp>
 
+#include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <future>
 #include <mutex>
 #include <string>
-#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 // Re-TBA: Use CRTP to call a loader function belonging to the child.
@@ -17,27 +23,6 @@
 namespace monkeysworld {
 namespace file {
 
-struct loader_progress {
-  size_t bytes_read;          // number of bytes read thus far
-  size_t bytes_sum;           // number of bytes expected
-};
-
-enum CacheType {
-  MODEL = 0,
-  FONT,
-  TEXTURE,
-  FILE,
-  CUBEMAP,
-  AUDIO
-};
-
-// struct representing a file which may be cached by the loader
-struct cache_record {
-  CacheType type;
-  std::string path;
-  uint64_t file_size;
-};
-
 /**
  *  Interface for a loader which maintains a cache, and enables files to be loaded into said cache.
  *  @param T - The type of data being returned by the loader.
@@ -50,8 +35,13 @@ class CachedLoader {
   /**
    *  Constructs the cached loader.
    *  @param thread_pool - pool of threads for loading asynchronously.
+   *  @param type - the type of asset this loader handles.
+   *  @param telemetry - where load timings are recorded. May be null.
    */ 
-  CachedLoader(std::shared_ptr<LoaderThreadPool> thread_pool) {
+  CachedLoader(std::shared_ptr<LoaderThreadPool> thread_pool,
+               CacheType type,
+               std::shared_ptr<LoaderTelemetry> telemetry = nullptr) : type_(type),
+                                                                      telemetry_(telemetry) {
     thread_pool_ = thread_pool;
   }
 
@@ -76,7 +66,7 @@ class CachedLoader {
       p->set_value(res);
     };
 
-    thread_pool_->AddTaskToQueue(lambda);
+    QueueTask(lambda);
     return std::move(p->get_future());
   }
 
@@ -103,57 +93,245 @@ class CachedLoader {
    *  False otherwise.
    */ 
   virtual bool IsCached(const std::string& path) = 0;
+
+  /**
+   *  Marks every entry in this cache as possibly stale.
+   *  Each entry is checked against its source the next time it's loaded: a stat if the source's
+   *  size and mtime are unchanged, and a rehash otherwise. Only entries whose contents have
+   *  actually changed are rebuilt -- the rest of the cache is left alone.
+   */
+  void RequestRevalidation() {
+    generation_.fetch_add(1, std::memory_order_acq_rel);
+  }
  protected:
   // implement synchronous loading in LoadFile
   T LoadFromFile(const std::string& path) {
+    // cache hits return straight away -- waiting on prefetch and deduplicating loads
+    // are left to the miss path in LookupEntry
+    U* derived_ptr = static_cast<U*>(this);
+    return derived_ptr->LoadFile(path);
+  }
+
+  std::shared_ptr<LoaderThreadPool>& GetThreadPool() {
+    return thread_pool_;
+  }
+
+  /**
+   *  @returns this loader's telemetry, or null if it has none.
+   */
+  LoaderTelemetry* GetTelemetry() {
+    return telemetry_.get();
+  }
+
+  /**
+   *  @param path - path to an asset which is uploaded to GL lazily.
+   *  @returns a callback which records the asset's upload time, or null if we have no telemetry.
+   *           Only holds a weak reference, since assets may outlive their loader.
+   */
+  std::function<void(uint64_t)> MakeUploadCallback(const std::string& path) {
+    if (!telemetry_) {
+      return nullptr;
+    }
+
+    std::weak_ptr<LoaderTelemetry> weak_telemetry = telemetry_;
+    CacheType type = type_;
+    return [weak_telemetry, type, path](uint64_t upload_ns) {
+      if (auto telemetry = weak_telemetry.lock()) {
+        telemetry->RecordUpload(type, path, telemetry->GetTime() - upload_ns, upload_ns);
+      }
+    };
+  }
+
+  /**
+   *  Queues a task on the thread pool, noting when it was queued so that
+   *  the first asset it loads is charged for the wait.
+   */
+  template <typename Task>
+  void QueueTask(Task task) {
+    uint64_t queued_at = (telemetry_ ? telemetry_->GetTime() : 0);
+    thread_pool_->AddTaskToQueue([task, queued_at] {
+      LoaderTelemetry::SetPendingQueueTime(queued_at);
+      task();
+      // in case nothing was loaded
+      LoaderTelemetry::SetPendingQueueTime(0);
+    });
+  }
+
+  /**
+   *  Reports cache progress to telemetry, if we have any.
+   */
+  void ReportExpectedBytes(uint64_t bytes) {
+    if (telemetry_) {
+      telemetry_->AddExpectedBytes(type_, bytes);
+    }
+  }
+
+  void ReportLoadedBytes(uint64_t bytes) {
+    if (telemetry_) {
+      telemetry_->AddLoadedBytes(type_, bytes);
+    }
+  }
+
+  /**
+   *  @returns the current revalidation generation. Entries checked at this generation are up to date.
+   */
+  uint64_t GetGeneration() const {
+    return generation_.load(std::memory_order_acquire);
+  }
+
+  /**
+   *  Fetches an entry from a derived loader's cache, building it if it's missing,
+   *  and rebuilding it if its source has changed since it was last checked.
+   *
+   *  A hit on an entry which is up to date doesn't lock anything. Misses wait for the cache
+   *  to finish loading, and only one thread builds a given path at a time -- everyone else
+   *  waits for it, then picks up the result.
+   *
+   *  `build` is called as `bool build(const std::string& path, bool use_pack, cache_entry<V>* entry)`.
+   *  It should fill in the entry's value, stamp and packed flag, reading from the loader's pack if
+   *  `use_pack` is set, and return false if the asset could not be loaded. `entry->stamp` holds
+   *  the last known stamp for the source on entry, if any, so the source needn't be rehashed.
+   *  Builds are timed by telemetry; `build` may call LoaderTelemetry::MarkPhase to split them up.
+   *
+   *  @param cache - the derived loader's cache.
+   *  @param path - path to the desired asset.
+   *  @param build - callback which loads the asset.
+   *  @param out - output param for the loaded value.
+   *  @returns true if the asset could be loaded, false otherwise.
+   */
+  template <typename V, typename Build>
+  bool LookupEntry(AssetCache<V>& cache,
+                   const std::string& path,
+                   Build&& build,
+                   V* out) {
+    auto node = cache.Find(path);
+    if (node != nullptr && node->checked.load(std::memory_order_acquire) == GetGeneration()) {
+      *out = node->value;
+      return true;
+    }
+
     // ensure cache is complete
     WaitUntilLoaded();
+    LoadGuard guard(this, path);
 
-    bool load_fresh = false;
-    U* derived_ptr = static_cast<U*>(this);
-    // check cache here
-    {
-      std::unique_lock<std::mutex> lock(loads_lock_);
-      auto rec = loads_.find(path);
-      if (rec != loads_.end()) {
-        // someone is loading for the first time, RIGHT NOW
-        auto cond_var = rec->second;
-        cond_var->wait(lock, [&] { return IsCached(path); });
-      } else if (!IsCached(path)) {
-        // no one's ever loaded this before -- create a record to let everyone know
-        // that we're loading for the first time
-        load_fresh = true;
-        loads_.insert(std::make_pair(path, std::make_shared<std::condition_variable>()));
+    // someone else may have loaded (or checked) this while we were waiting
+    uint64_t generation = GetGeneration();
+    node = cache.Find(path);
+    cache_entry<V> entry;
+    if (node != nullptr) {
+      if (node->checked.load(std::memory_order_acquire) == generation) {
+        *out = node->value;
+        return true;
+      }
+
+      // a missing source isn't treated as a change -- the asset may only exist in our pack
+      entry.stamp = cache.GetStamp(node);
+      if (CheckAssetStamp(path, &entry.stamp) != STAMP_CHANGED) {
+        cache.MarkChecked(node, entry.stamp, generation);
+        *out = node->value;
+        return true;
       }
+
+      BOOST_LOG_TRIVIAL(debug) << path << " changed on disk -- rebuilding";
     }
 
-    BOOST_LOG_TRIVIAL(trace) << "loading your model: " << path;
-    auto res = derived_ptr->LoadFile(path);
-
-    if (load_fresh) {
-      BOOST_LOG_TRIVIAL(trace) << "removing from load list...";
-      // first load, so we created a record. remove that record now :)
-      std::unique_lock<std::mutex> lock(loads_lock_);
-      auto rec = loads_.find(path);
-      auto cond_var = rec->second;
-      loads_.erase(rec);
-      cond_var->notify_all();
+    {
+      LoaderTelemetry::AssetScope scope(telemetry_.get(), type_, path);
+      // a stale entry's pack copy is just as stale, so skip the pack on rebuild
+      if (!BuildEntry(path, node == nullptr, build, &entry)) {
+        scope.Cancel();
+        return false;
+      }
+
+      scope.SetBytes(entry.stamp.source_size);
     }
 
-    return res;
+    entry.checked = generation;
+    *out = cache.Store(path, std::move(entry), true)->value;
+    return true;
   }
 
-  std::shared_ptr<LoaderThreadPool>& GetThreadPool() {
-    return thread_pool_;
+  /**
+   *  Builds an entry without checking the cache. Used when populating the cache on startup --
+   *  the result should be stored without replacing anything which was loaded in the meantime.
+   *  Entries read from a pack are left unchecked, so their sources are only statted when
+   *  they're first loaded. Entries built from source are marked as up to date.
+   *  @param stamp - stamp recorded for this asset, if any.
+   *  @returns true if the asset could be loaded, false otherwise.
+   */
+  template <typename V, typename Build>
+  bool PrefetchEntry(const std::string& path, const asset_stamp& stamp, Build&& build, cache_entry<V>* entry) {
+    uint64_t generation = GetGeneration();
+    entry->stamp = stamp;
+    LoaderTelemetry::AssetScope scope(telemetry_.get(), type_, path);
+    if (!build(path, true, entry)) {
+      scope.Cancel();
+      return false;
+    }
+
+    scope.SetBytes(entry->stamp.source_size);
+    entry->checked = (entry->packed ? 0 : generation);
+    return true;
   }
 
  private:
+  /**
+   *  Marks a path as being built for the lifetime of the guard.
+   *  Blocks while another thread is building the same path.
+   */
+  class LoadGuard {
+   public:
+    LoadGuard(CachedLoader* loader, const std::string& path) : loader_(loader), path_(path) {
+      std::unique_lock<std::mutex> lock(loader_->loads_lock_);
+      loader_->loads_cond_.wait(lock, [&] { return (loader_->loads_.count(path_) == 0); });
+      loader_->loads_.insert(path_);
+    }
+
+    ~LoadGuard() {
+      {
+        std::lock_guard<std::mutex> lock(loader_->loads_lock_);
+        loader_->loads_.erase(path_);
+      }
+
+      loader_->loads_cond_.notify_all();
+    }
+
+    LoadGuard(const LoadGuard& other) = delete;
+    LoadGuard& operator=(const LoadGuard& other) = delete;
+   private:
+    CachedLoader* loader_;
+    const std::string& path_;
+  };
+
+  /**
+   *  Builds an entry. If it comes out of our pack, it's checked against its source right away,
+   *  and rebuilt from source if the pack copy is stale.
+   */
+  template <typename V, typename Build>
+  static bool BuildEntry(const std::string& path, bool use_pack, Build& build, cache_entry<V>* entry) {
+    if (!build(path, use_pack, entry)) {
+      return false;
+    }
+
+    if (entry->packed && CheckAssetStamp(path, &entry->stamp) == STAMP_CHANGED) {
+      BOOST_LOG_TRIVIAL(debug) << path << " is stale in pack -- rebuilding from source";
+      return build(path, false, entry);
+    }
+
+    return true;
+  }
+
   std::shared_ptr<LoaderThreadPool> thread_pool_;
+  const CacheType type_;
+  std::shared_ptr<LoaderTelemetry> telemetry_;
 
-  std::unordered_map<std::string, std::shared_ptr<std::condition_variable>> loads_;
+  // paths which are being built right now
+  std::unordered_set<std::string> loads_;
   std::mutex loads_lock_;
-  
-  
+  std::condition_variable loads_cond_;
+
+  // bumped by RequestRevalidation. generation 0 is never current, so it marks unchecked entries
+  std::atomic<uint64_t> generation_{1};
 };
 
 }
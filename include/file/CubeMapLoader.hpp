@@ -7,15 +7,15 @@
 #include <shader/CubeMap.hpp>
 
 #include <mutex>
-#include <shared_mutex>
-#include <unordered_map>
 
 namespace monkeysworld {
 namespace file {
 
 class CubeMapLoader : public CachedLoader<std::shared_ptr<shader::CubeMap>, CubeMapLoader> {
  public:
-  CubeMapLoader(std::shared_ptr<LoaderThreadPool> thread_pool, std::vector<cache_record> cache);
+  CubeMapLoader(std::shared_ptr<LoaderThreadPool> thread_pool,
+                std::vector<cache_record> cache,
+                std::shared_ptr<LoaderTelemetry> telemetry = nullptr);
 
   std::vector<cache_record> GetCache() override;
   loader_progress GetLoaderProgress() override;
@@ -30,10 +30,16 @@ class CubeMapLoader : public CachedLoader<std::shared_ptr<shader::CubeMap>, Cube
  private:
   void LoadFileToCache(cache_record& record);
 
+  /**
+   *  Loads a cubemap from its six faces. Cubemaps aren't packed, so `use_pack` is ignored.
+   *  @param entry - output param for the cubemap and its stamp.
+   *  @returns true if the cubemap could be loaded, false otherwise.
+   */
+  bool CreateCubeMap(const std::string& path, bool use_pack, cache_entry<std::shared_ptr<shader::CubeMap>>* entry);
+
   loader_progress loader_;
   std::mutex loader_mutex_;
-  std::shared_timed_mutex cache_mutex_;
-  std::unordered_map<std::string, std::shared_ptr<shader::CubeMap>> file_cache_;
+  AssetCache<std::shared_ptr<shader::CubeMap>> file_cache_;
   std::condition_variable load_cond_var_;
 };
 
@@ -1,15 +1,15 @@
 #ifndef FILE_LOADER_H_
 #define FILE_LOADER_H_
 
+#include <file/AssetPack.hpp>
 #include <file/CachedLoader.hpp>
 #include <file/LoaderThreadPool.hpp>
 #include <file/CacheStreambuf.hpp>
+#include <file/MappedFile.hpp>
 
 #include <condition_variable>
 #include <future>
 #include <mutex>
-#include <unordered_map>
-#include <shared_mutex>
 
 namespace monkeysworld {
 namespace file {
@@ -20,8 +20,18 @@ namespace file {
  */ 
 class FileLoader : public CachedLoader<CacheStreambuf, FileLoader> {
  public:
+  /**
+   *  Creates a new file loader.
+   *  @param thread_pool - thread pool shared across loaders.
+   *  @param cache - a list of cached files previously associated with this loader.
+   *  @param pack - optional asset pack. Files stored in the pack are served
+   *                straight from its mapping instead of being read from disk.
+   *  @param telemetry - where load timings are recorded. May be null.
+   */
   FileLoader(std::shared_ptr<LoaderThreadPool> thread_pool,
-             std::vector<cache_record> cache);
+             std::vector<cache_record> cache,
+             std::shared_ptr<AssetPack> pack = nullptr,
+             std::shared_ptr<LoaderTelemetry> telemetry = nullptr);
 
   CacheStreambuf LoadFile(const std::string& path);
   std::vector<cache_record> GetCache() override;
@@ -31,16 +41,45 @@ class FileLoader : public CachedLoader<CacheStreambuf, FileLoader> {
   bool IsCached(const std::string& path) override;
  
  private:
-  // loads a file into an std::vector, puts that vector in the cache,
-  // then returns a CacheStreambuf which reads from that vector.
+  struct file_record {
+    std::shared_ptr<const char> data;     // either a vector we own, or a pack mapping
+    uint64_t size;
+    std::shared_ptr<const MappedFile> mapping;    // set if the file is read straight from its mapping
+    std::shared_future<uint32_t> content_hash;    // set if the mapping is still being hashed -- see MapFile
+  };
+
+  // files at least this large are mapped instead of read in, so that clients
+  // can start streaming them without waiting on (or holding a second copy of) the whole thing
+  static const uint64_t MAP_THRESHOLD = 256 * 1024;
+
+  /**
+   *  Reads a file, from our pack if possible and from disk otherwise.
+   *  Large files are mapped rather than read -- see MAP_THRESHOLD.
+   *  @param use_pack - if false, the file is always read from disk.
+   *  @param entry - output param for the file and its stamp.
+   *  @returns true if the file could be read, false otherwise.
+   */
+  bool ReadFile(const std::string& path, bool use_pack, cache_entry<file_record>* entry);
+
+  /**
+   *  Maps a file from disk, for ReadFile.
+   *  If the file has changed since it was last stamped, it's hashed on the thread pool
+   *  rather than before returning -- clients can start streaming it straight away.
+   *  The entry's stamp only holds its size and mtime, so if the source is touched, it's remapped
+   *  instead of being compared against its old contents -- which is cheap for a mapping.
+   *  @param stamp - the file's current size and mtime.
+   *  @param entry - output param for the file and its stamp.
+   *  @returns true if the file could be mapped, false otherwise.
+   */
+  bool MapFile(const std::string& path, asset_stamp stamp, cache_entry<file_record>* entry);
 
   // method to handle cache loading
   void LoadFileToCache(cache_record& record);
 
   loader_progress loader_;
   std::mutex loader_mutex_;
-  std::shared_timed_mutex cache_mutex_;
-  std::unordered_map<std::string, std::shared_ptr<std::vector<char>>> file_cache_;
+  AssetCache<file_record> file_cache_;
+  std::shared_ptr<AssetPack> pack_;
   std::condition_variable load_cond_var_;
 };
 
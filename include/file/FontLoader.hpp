@@ -9,8 +9,6 @@
 #include <future>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
-#include <unordered_map>
 
 namespace monkeysworld {
 namespace file {
@@ -22,7 +20,8 @@ namespace file {
 class FontLoader : public CachedLoader<std::shared_ptr<font::Font>, FontLoader> {
  public:
   FontLoader(std::shared_ptr<LoaderThreadPool> thread_pool,
-             std::vector<cache_record> cache);
+             std::vector<cache_record> cache,
+             std::shared_ptr<LoaderTelemetry> telemetry = nullptr);
 
   std::shared_ptr<font::Font> LoadFile(const std::string& path);
   std::vector<cache_record> GetCache() override;
@@ -33,10 +32,17 @@ class FontLoader : public CachedLoader<std::shared_ptr<font::Font>, FontLoader>
  private:
   void LoadFontToCache(cache_record& record);
 
+  /**
+   *  Loads a font from disk. Fonts aren't packed, so `use_pack` is ignored.
+   *  @param entry - output param for the font and its stamp.
+   *  @returns true if the font could be loaded.
+   *  @throws BadFontPathException if the font could not be loaded.
+   */
+  bool OpenFont(const std::string& path, bool use_pack, cache_entry<std::shared_ptr<font::Font>>* entry);
+
   loader_progress loader_;
   std::mutex loader_mutex_;
-  std::shared_timed_mutex cache_mutex_;
-  std::unordered_map<std::string, std::shared_ptr<font::Font>> font_cache_;
+  AssetCache<std::shared_ptr<font::Font>> font_cache_;
   std::condition_variable load_cond_var_;
 };
 
@@ -0,0 +1,250 @@
+#ifndef LOADER_TELEMETRY_H_
+#define LOADER_TELEMETRY_H_
+
+#include <file/CacheTypes.hpp>
+
+#include <atomic>
+#include <cinttypes>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace monkeysworld {
+namespace file {
+
+/**
+ *  Stages of an asset load which are timed separately.
+ */
+enum LoadPhase {
+  PHASE_QUEUE = 0,            // waiting in the loader thread pool
+  PHASE_IO,                   // reading and stamping the source
+  PHASE_DECODE,               // parsing/decoding the source into its runtime form
+  PHASE_UPLOAD,               // handing the result to GL, on the main thread
+  PHASE_COUNT
+};
+
+// one more than the last CacheType
+static const int CACHE_TYPE_COUNT = AUDIO + 1;
+
+/**
+ *  Timings for a single asset.
+ */
+struct asset_timing {
+  CacheType type;
+  std::string path;
+  uint64_t bytes;                     // size of the source, in bytes
+  uint64_t start_ns;                  // when the asset was queued (or started, if it wasn't), since telemetry start
+  uint64_t phase_ns[PHASE_COUNT];     // time spent in each phase
+  uint32_t thread;                    // telemetry-assigned id of the thread which loaded the asset
+
+  /**
+   *  @returns time spent actually working on this asset -- everything but the queue wait.
+   */
+  uint64_t GetWorkTime() const {
+    return phase_ns[PHASE_IO] + phase_ns[PHASE_DECODE] + phase_ns[PHASE_UPLOAD];
+  }
+};
+
+/**
+ *  Totals for every asset handled by a single loader.
+ */
+struct loader_timing {
+  uint64_t assets;                    // number of assets loaded
+  uint64_t bytes;                     // sum of their source sizes
+  uint64_t phase_ns[PHASE_COUNT];     // sum of their phase timings
+  double bytes_per_second;            // bytes over time spent in io and decode
+};
+
+/**
+ *  Point-in-time view of a scene load.
+ */
+struct telemetry_snapshot {
+  loader_timing loaders[CACHE_TYPE_COUNT];  // indexed by CacheType
+  loader_progress progress;                 // cache prefetch progress, across all loaders
+  std::vector<asset_timing> assets;         // every recorded asset, in completion order
+  std::vector<asset_timing> slowest;        // the slowest assets by work time, slowest first
+  uint64_t dropped;                         // assets which didn't fit in the event buffer
+  double elapsed_seconds;                   // wall time from the first asset queued to the last one finished
+  double bytes_per_second;                  // total bytes over `elapsed_seconds`
+};
+
+/**
+ *  Collects load timings for a CachedFileLoader and its loaders.
+ *
+ *  Recording is lock-free: per-loader totals and progress are plain atomics, and per-asset events
+ *  are written to a fixed-size buffer whose slots are claimed with a single fetch_add. Once the
+ *  buffer is full, further assets still count towards the totals but are otherwise dropped.
+ *  Snapshots may be taken at any time, from any thread, and only see fully written events.
+ *
+ *  Loaders time an asset by opening an AssetScope around the load. Anything running below that
+ *  on the same thread can then call MarkPhase to close out a phase, without the scope having
+ *  to be threaded through. Time which isn't claimed by a phase is counted as decode time.
+ */
+class LoaderTelemetry {
+ public:
+  /**
+   *  @param capacity - maximum number of per-asset events which will be kept.
+   *  @param clock - returns the current time in nanoseconds, from any thread. Null uses the
+   *                 steady clock -- tests pass their own, so timings don't hang on a sleep.
+   */
+  LoaderTelemetry(size_t capacity = 4096, std::function<uint64_t()> clock = nullptr);
+
+  /**
+   *  Times one asset load on the calling thread. Recorded on destruction.
+   *  A null telemetry pointer makes this a no-op, so loaders needn't check for one.
+   */
+  class AssetScope {
+   public:
+    /**
+     *  @param telemetry - where the timing is recorded. May be null.
+     *  @param type - the type of asset being loaded.
+     *  @param path - path to the asset.
+     *  @param queued_at - when the load was queued, from GetTime, or 0 if it wasn't.
+     */
+    AssetScope(LoaderTelemetry* telemetry, CacheType type, const std::string& path, uint64_t queued_at = 0);
+
+    /**
+     *  @param bytes - size of the asset's source.
+     */
+    void SetBytes(uint64_t bytes) {
+      timing_.bytes = bytes;
+    }
+
+    /**
+     *  Drops the timing -- e.g. because the asset turned out to be cached after all.
+     */
+    void Cancel() {
+      telemetry_ = nullptr;
+    }
+
+    ~AssetScope();
+    AssetScope(const AssetScope& other) = delete;
+    AssetScope& operator=(const AssetScope& other) = delete;
+   private:
+    friend class LoaderTelemetry;
+    LoaderTelemetry* telemetry_;
+    AssetScope* parent_;
+    asset_timing timing_;
+    uint64_t last_mark_;
+  };
+
+  /**
+   *  Attributes the time since the last mark (or the start of the innermost AssetScope)
+   *  to `phase`. Does nothing if the calling thread isn't inside an AssetScope.
+   */
+  static void MarkPhase(LoadPhase phase);
+
+  /**
+   *  Marks the next AssetScope opened on this thread as having been queued at `queued_at`.
+   *  Used where the queue time can't be passed to the scope directly.
+   */
+  static void SetPendingQueueTime(uint64_t queued_at);
+
+  /**
+   *  Records the GL upload of an asset. Uploads happen lazily on the main thread,
+   *  so they're merged into the asset's timing when a snapshot is taken.
+   *  @param start_ns - when the upload began, from GetTime.
+   *  @param upload_ns - how long the upload took.
+   */
+  void RecordUpload(CacheType type, const std::string& path, uint64_t start_ns, uint64_t upload_ns);
+
+  /**
+   *  Adds to the number of bytes the loaders expect to prefetch.
+   */
+  void AddExpectedBytes(CacheType type, uint64_t bytes) {
+    progress_[type].bytes_sum.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  /**
+   *  Adds to the number of bytes the loaders have prefetched.
+   */
+  void AddLoadedBytes(CacheType type, uint64_t bytes) {
+    progress_[type].bytes_read.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  /**
+   *  @returns prefetch progress, summed across every loader. Never blocks.
+   */
+  loader_progress GetProgress() const;
+
+  /**
+   *  @returns nanoseconds since this telemetry was created.
+   */
+  uint64_t GetTime() const;
+
+  /**
+   *  @param slowest_count - number of assets to include in the `slowest` list.
+   *  @returns a snapshot of everything recorded so far.
+   */
+  telemetry_snapshot GetSnapshot(size_t slowest_count = 10) const;
+
+  /**
+   *  Writes a snapshot as JSON: per-loader totals, progress, and the slowest assets.
+   */
+  void WriteJSON(std::ostream& output, size_t slowest_count = 10) const;
+
+  /**
+   *  Writes every recorded asset in Chrome's trace event format, for chrome://tracing or Perfetto.
+   *  Each asset shows up as a slice on the thread which loaded it, split into its io and decode
+   *  phases, with its queue wait and upload on their own tracks.
+   */
+  void WriteChromeTrace(std::ostream& output) const;
+
+  /**
+   *  File variants of the above.
+   *  @returns true if the file was written, false otherwise.
+   */
+  bool WriteJSON(const std::string& path, size_t slowest_count = 10) const;
+  bool WriteChromeTrace(const std::string& path) const;
+
+  /**
+   *  @returns the name used for a cache type in exported telemetry.
+   */
+  static const char* GetTypeName(CacheType type);
+
+  LoaderTelemetry(const LoaderTelemetry& other) = delete;
+  LoaderTelemetry& operator=(const LoaderTelemetry& other) = delete;
+ private:
+  struct event_slot {
+    std::atomic<bool> ready;
+    bool upload;                      // true if this is an upload, to be merged into its asset
+    asset_timing timing;
+  };
+
+  struct loader_totals {
+    std::atomic<uint64_t> assets;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> phase_ns[PHASE_COUNT];
+  };
+
+  struct loader_counters {
+    std::atomic<uint64_t> bytes_read;
+    std::atomic<uint64_t> bytes_sum;
+  };
+
+  /**
+   *  Claims a slot and writes an event to it.
+   */
+  void Record(const asset_timing& timing, bool upload);
+
+  /**
+   *  @returns every event written so far, with uploads merged into their assets.
+   */
+  std::vector<asset_timing> CollectAssets(std::vector<asset_timing>* uploads) const;
+
+  const std::function<uint64_t()> clock_;
+  const uint64_t epoch_ns_;
+  const size_t capacity_;
+  std::unique_ptr<event_slot[]> slots_;
+  std::atomic<uint64_t> next_slot_;
+  std::atomic<uint64_t> dropped_;
+  loader_totals totals_[CACHE_TYPE_COUNT];
+  loader_counters progress_[CACHE_TYPE_COUNT];
+};
+
+}
+}
+
+#endif  // LOADER_TELEMETRY_H_
@@ -3,64 +3,136 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 namespace monkeysworld {
 namespace file {
 
 /**
- *  A simple thread pool implementation used by our file loaders.
- */ 
+ *  Determines the order in which queued tasks are picked up.
+ *  Workers will always run (or steal) a higher priority task before a lower priority one.
+ */
+enum TaskPriority {
+  PRIORITY_HIGH = 0,      // needed for the current frame
+  PRIORITY_NORMAL,        // default -- regular cache loads
+  PRIORITY_LOW,           // background prefetch
+  PRIORITY_COUNT
+};
+
+/**
+ *  Snapshot of a single worker's activity.
+ */
+struct worker_stats {
+  uint64_t tasks_run;         // tasks run by this worker, including stolen ones (counted as they start)
+  uint64_t steals;            // tasks taken from other workers' queues
+  double idle_seconds;        // time spent waiting for work
+};
+
+/**
+ *  A work-stealing thread pool used by our file loaders.
+ *  Each worker owns a set of task deques, one per priority. New tasks are dealt out to workers
+ *  round-robin (or onto the submitting worker's own deque, if submitted from inside a task),
+ *  and idle workers steal from their peers before going to sleep.
+ *
+ *  Tasks which are still queued when the pool is destroyed are run before it shuts down.
+ */
 class LoaderThreadPool {
  public:
   LoaderThreadPool(int num_threads);
 
-  // method which accepts a task (which is intrinsically tied to a future) and computes it
-  // create a promise
-  // pass the promise to this
-  // return the future contained in that promise
-
   /**
    *  Adds a new task to the thread pool.
    *  @param task - a lambda which will be run by this thread pool.
-   */ 
-  void AddTaskToQueue(std::function<void()> func);
+   *  @param priority - priority class for this task.
+   */
+  void AddTaskToQueue(std::function<void()> func, TaskPriority priority = PRIORITY_NORMAL);
+
+  /**
+   *  Adds a new task to the thread pool, and returns a future for its result.
+   *  Exceptions thrown by the task are forwarded to the future.
+   *  @param func - callable which will be run by this thread pool.
+   *  @param priority - priority class for this task.
+   *  @returns a future which resolves to the return value of `func`.
+   */
+  template <typename F>
+  std::future<std::invoke_result_t<std::decay_t<F>>> Submit(F&& func, TaskPriority priority = PRIORITY_NORMAL) {
+    using result_type = std::invoke_result_t<std::decay_t<F>>;
+    // std::function must be copyable, so the packaged task lives on the heap
+    auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<F>(func));
+    std::future<result_type> res = task->get_future();
+    AddTaskToQueue([task] { (*task)(); }, priority);
+    return res;
+  }
+
+  /**
+   *  Runs a single queued task on the calling thread, if there is one.
+   *  Lets a thread which is waiting on the pool's tasks help out, rather than sitting idle.
+   *  @returns true if a task was run, false if there was nothing queued.
+   */
+  bool RunPendingTask();
+
+  /**
+   *  @returns the number of worker threads in this pool.
+   */
+  int GetThreadCount() const {
+    return num_threads_;
+  }
+
+  /**
+   *  @returns a snapshot of each worker's stats, indexed by worker.
+   */
+  std::vector<worker_stats> GetWorkerStats() const;
 
   ~LoaderThreadPool();
   LoaderThreadPool& operator=(const LoaderThreadPool& other) = delete;
   LoaderThreadPool(const LoaderThreadPool& other) = delete;
 
-  LoaderThreadPool& operator=(LoaderThreadPool&& other);
-  LoaderThreadPool(LoaderThreadPool&& other);
+  // workers hold a pointer back to the pool, so it can't be moved either
+  LoaderThreadPool& operator=(LoaderThreadPool&& other) = delete;
+  LoaderThreadPool(LoaderThreadPool&& other) = delete;
  private:
-  // threads are always running
-  // threads should also rely on a kill signal telling them to wind down
-  // when a thread completes a task, it will check the task queue for something to do
-  // if there's nothing there, it should wait on a cond var
-
-  // meanwhile:
-  // when we add a task to the queue, notify one thread.
-  // that thread will pluck the task off the queue!
+  struct worker {
+    std::mutex lock;                                        // guards `tasks`
+    std::deque<std::function<void()>> tasks[PRIORITY_COUNT];
+    std::atomic<uint64_t> tasks_run;
+    std::atomic<uint64_t> steals;
+    std::atomic<uint64_t> idle_ns;
+    std::thread thread;
+  };
 
   /**
    *  Function used by threads.
-   *  @param flag - flag associated with this thread's execution
-   */ 
-  void threadfunc_(std::atomic_flag* flag);
+   *  @param index - index of the worker this thread runs.
+   */
+  void threadfunc_(int index);
+
+  /**
+   *  Looks for the highest priority task available to worker `index`,
+   *  checking its own deques before stealing from others.
+   *  @param task - output param for the task found.
+   *  @returns true if a task was found, false otherwise.
+   */
+  bool FindTask(int index, std::function<void()>& task);
 
   int num_threads_;
-  std::thread* threads_;                            // array of threads
-  std::atomic_flag* flags_;                         // flags for each thread
-  std::queue<std::function<void()>> task_queue_;    // queue of tasks to run
-  std::mutex queue_lock_;                           // lock for accessing task queue
-  std::condition_variable task_condvar_;            // condition var for threads
+  std::unique_ptr<worker[]> workers_;
+  std::atomic<uint64_t> next_worker_;                 // round-robin counter for external submits
+  std::atomic<int64_t> pending_[PRIORITY_COUNT];      // queued tasks per priority, across all workers
+  std::atomic<int64_t> pending_total_;                // queued tasks across all priorities
+  std::atomic<int> sleepers_;                         // workers waiting on `sleep_condvar_`
+  std::atomic_bool stopping_;
+  std::mutex sleep_lock_;
+  std::condition_variable sleep_condvar_;
 };
 
 }
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,69 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cinttypes>
+#include <string>
+
+namespace monkeysworld {
+namespace file {
+
+/**
+ *  Read-only memory mapping of a file on disk.
+ *  The mapping is created on construction and released when the object is destroyed,
+ *  so any pointers obtained from `GetData` are valid only for the lifetime of the MappedFile.
+ */
+class MappedFile {
+ public:
+  /**
+   *  Maps the file at `path` into memory.
+   *  @param path - path to the file being mapped.
+   *  @throws FileNotFoundException if the file could not be opened or mapped.
+   */
+  MappedFile(const std::string& path);
+
+  /**
+   *  @returns a pointer to the start of the mapped region.
+   *           If the file is empty, this returns nullptr.
+   */
+  const char* GetData() const {
+    return data_;
+  }
+
+  /**
+   *  @returns the size of the mapped region, in bytes.
+   */
+  uint64_t GetSize() const {
+    return size_;
+  }
+
+  /**
+   *  Hints that a range of the mapping will be read soon, so the OS can start paging it in.
+   *  Ranges which fall outside of the mapping are clamped.
+   *  @param offset - start of the range, in bytes.
+   *  @param size - length of the range, in bytes.
+   */
+  void Prefetch(uint64_t offset, uint64_t size) const;
+
+  ~MappedFile();
+  MappedFile(const MappedFile& other) = delete;
+  MappedFile& operator=(const MappedFile& other) = delete;
+  MappedFile(MappedFile&& other);
+  MappedFile& operator=(MappedFile&& other);
+ private:
+  /**
+   *  Releases the mapping and any associated handles.
+   */
+  void Unmap();
+
+  const char* data_;
+  uint64_t size_;
+#ifdef _WIN32
+  void* file_handle_;
+  void* mapping_handle_;
+#endif
+};
+
+}
+}
+
+#endif  // MAPPED_FILE_H_
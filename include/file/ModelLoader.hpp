@@ -3,6 +3,8 @@
 
 #include <model/Mesh.hpp>
 #include <storage/VertexPacketTypes.hpp>
+#include <file/AssetPack.hpp>
+#include <file/BakedMesh.hpp>
 #include <file/LoaderThreadPool.hpp>
 #include <file/CachedLoader.hpp>
 
@@ -10,8 +12,6 @@
 #include <future>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
-#include <unordered_map>
 
 namespace monkeysworld {
 namespace file {
@@ -28,9 +28,15 @@ class ModelLoader : public CachedLoader<std::shared_ptr<model::Mesh<storage::Ver
    *  Creates a new model loader
    *  @param thread_pool - thread pool shared across loaders.
    *  @param cache - a list of cached files previously associated with this loader.
+   *  @param pack - optional asset pack. Models stored in the pack are read from its mapping.
+   *  @param telemetry - where load timings are recorded. May be null.
+   *  @param bake_dir - directory baked models are read from and written to.
    */ 
   ModelLoader(std::shared_ptr<LoaderThreadPool> thread_pool,
-              std::vector<cache_record> cache);
+              std::vector<cache_record> cache,
+              std::shared_ptr<AssetPack> pack = nullptr,
+              std::shared_ptr<LoaderTelemetry> telemetry = nullptr,
+              const std::string& bake_dir = BAKED_MESH_DIR);
 
   /**
    *  @returns a list of cache_records associated with this loader.
@@ -50,6 +56,33 @@ class ModelLoader : public CachedLoader<std::shared_ptr<model::Mesh<storage::Ver
   std::shared_ptr<model::Mesh<storage::VertexPacket3D>> LoadFile(const std::string& path);
 
   bool IsCached(const std::string& path) override;
+
+  /**
+   *  Parses an OBJ file into a new mesh, bypassing the cache and any baked copy.
+   *  Large files are split on line boundaries and parsed in parallel if a pool is provided.
+   *  The resulting mesh is identical regardless of how many threads are used.
+   *  @param path - path to the model being loaded
+   *  @param file_size - output param for file size
+   *  @param pool - optional thread pool to parse with. The calling thread also does work,
+   *                so this may be called from within one of the pool's own tasks.
+   *  @throws FileNotFoundException if `path` cannot be opened.
+   */
+  static std::shared_ptr<model::Mesh<storage::VertexPacket3D>> FromObjFile(const std::string& path,
+                                                                           uint64_t* file_size,
+                                                                           LoaderThreadPool* pool = nullptr);
+
+  /**
+   *  Loads a model, preferring its baked binary copy if one exists and is up to date.
+   *  If the bake is missing or stale, the OBJ is parsed and a fresh bake is written.
+   *  @param path - path to the model being loaded
+   *  @param file_size - output param for the size of the source OBJ
+   *  @param pool - optional thread pool, used if the OBJ must be parsed.
+   *  @param bake_dir - directory bakes are read from and written to.
+   */
+  static std::shared_ptr<model::Mesh<storage::VertexPacket3D>> FromBakedOrObjFile(const std::string& path,
+                                                                                  uint64_t* file_size,
+                                                                                  LoaderThreadPool* pool = nullptr,
+                                                                                  const std::string& bake_dir = BAKED_MESH_DIR);
  protected:
  
  private:
@@ -64,11 +97,20 @@ class ModelLoader : public CachedLoader<std::shared_ptr<model::Mesh<storage::Ver
    */ 
   void LoadOBJToCache(cache_record& record);
 
+  /**
+   *  Loads a model from our pack if possible, and from its bake or OBJ otherwise.
+   *  @param use_pack - if false, the model is always loaded from its bake or OBJ.
+   *  @param entry - output param for the model and its stamp.
+   *  @returns true if the model could be loaded, false otherwise.
+   */
+  bool CreateModel(const std::string& path, bool use_pack, cache_entry<model_record>* entry);
+
   loader_progress loader_;
   std::mutex loader_mutex_;
-  std::shared_timed_mutex cache_mutex_;
-  std::unordered_map<std::string, model_record> model_cache_;
+  AssetCache<model_record> model_cache_;
   std::condition_variable load_cond_var_;
+  std::shared_ptr<AssetPack> pack_;
+  const std::string bake_dir_;
 
 
 
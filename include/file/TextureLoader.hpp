@@ -1,6 +1,7 @@
 #ifndef TEXTURE_LOADER_H_
 #define TEXTURE_LOADER_H_
 
+#include <file/AssetPack.hpp>
 #include <file/CachedLoader.hpp>
 #include <file/LoaderThreadPool.hpp>
 
@@ -9,16 +10,23 @@
 #include <condition_variable>
 #include <future>
 #include <mutex>
-#include <shared_mutex>
-#include <unordered_map>
 
 namespace monkeysworld {
 namespace file {
 
 class TextureLoader : public CachedLoader<std::shared_ptr<shader::Texture>, TextureLoader> {
  public:
+  /**
+   *  Creates a new texture loader.
+   *  @param thread_pool - thread pool shared across loaders.
+   *  @param cache - a list of cached files previously associated with this loader.
+   *  @param pack - optional asset pack. Textures stored in the pack skip decoding.
+   *  @param telemetry - where load timings are recorded. May be null.
+   */
   TextureLoader(std::shared_ptr<LoaderThreadPool> thread_pool,
-                std::vector<cache_record> cache);
+                std::vector<cache_record> cache,
+                std::shared_ptr<AssetPack> pack = nullptr,
+                std::shared_ptr<LoaderTelemetry> telemetry = nullptr);
 
   std::vector<cache_record> GetCache() override;
 
@@ -34,11 +42,19 @@ class TextureLoader : public CachedLoader<std::shared_ptr<shader::Texture>, Text
 
   void LoadTextureToCache(const cache_record& record);
 
+  /**
+   *  Creates a texture, from our pack if possible and from disk otherwise.
+   *  @param use_pack - if false, the texture is always decoded from disk.
+   *  @param entry - output param for the texture and its stamp.
+   *  @returns true if the texture could be loaded, false otherwise.
+   */
+  bool CreateTexture(const std::string& path, bool use_pack, cache_entry<std::shared_ptr<shader::Texture>>* entry);
+
   loader_progress loader_;
   std::mutex loader_mutex_;
-  std::shared_timed_mutex cache_mutex_;
-  std::unordered_map<std::string, std::shared_ptr<shader::Texture>> texture_cache_;
+  AssetCache<std::shared_ptr<shader::Texture>> texture_cache_;
   std::condition_variable load_cond_var_;
+  std::shared_ptr<AssetPack> pack_;
   
 };
 
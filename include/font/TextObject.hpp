@@ -32,12 +32,23 @@ class TextObject : public critter::GameObject, public Text {
    */ 
   void Accept(critter::Visitor& v) override;
 
+  /**
+   *  Builds the text's geometry, and copies what's needed to draw it --
+   *  so that SetText and friends can be called from Update while the last frame is drawn.
+   */
+  void SyncRenderState() override;
+
   void PrepareAttributes() override;
   void RenderMaterial(const engine::RenderContext& rc) override;
   void Draw() override;
  private:
   shader::materials::TextMaterial mat;
 
+  // as of the last SyncRenderState. the only text state read while drawing
+  std::shared_ptr<model::Mesh<storage::VertexPacket2D>> frame_geometry_;
+  glm::vec4 frame_color_;
+  GLuint frame_texture_;
+
   
 };
 
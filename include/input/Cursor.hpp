@@ -5,6 +5,9 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include <critter/Camera.hpp>
+#include <utils/Bounds.hpp>
+
 namespace monkeysworld {
 namespace input {
 
@@ -29,6 +32,23 @@ class Cursor {
    */ 
   glm::dvec2 GetCursorPosition();
 
+  /**
+   *  @returns a ray from the camera through the cursor, for picking out objects in the scene
+   *           (see TransformHierarchy::RayCast). Its direction is normalized.
+   *  @param camera - the camera the scene is drawn with.
+   */
+  utils::ray GetPickRay(const critter::camera_info& camera);
+
+  /**
+   *  @returns a ray from `camera` through a point on screen. Its direction is normalized.
+   *  @param camera - the camera the scene is drawn with.
+   *  @param position - point on screen, relative to the top left corner.
+   *  @param window_size - size of the window, in the same units as `position`.
+   */
+  static utils::ray GetPickRay(const critter::camera_info& camera,
+                               const glm::dvec2& position,
+                               const glm::ivec2& window_size);
+
   /**
    *  Grabs the latest cursor position from GLFW. Typically called by context -- will probably
    *  have no impact on what you're doing.
@@ -165,6 +165,9 @@ class WindowEventManager : public EventManager {
   // ptr to cursor object
   std::shared_ptr<Cursor> cursor_;
 
+  // where the cursor was when the UI was last told about it
+  glm::dvec2 hover_pos_;
+
   // ptr to context
   engine::Context* ctx_;
 
@@ -2,8 +2,10 @@
 #define MESH_H_
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include <glad/glad.h>
@@ -13,6 +15,7 @@
 #include <model/VertexDataContext.hpp>
 #include <model/VertexDataContextGL.hpp>
 #include <storage/VertexPacketTypes.hpp>
+#include <utils/Bounds.hpp>
 #include <glm/gtc/constants.hpp>
 
 #include <map>
@@ -47,7 +50,7 @@ class Mesh {
   /**
    *  Constructs a new VertexData object.
    */ 
-  Mesh() : dirty_(true) {
+  Mesh() : dirty_(true), bounds_dirty_(true) {
     context_ = std::make_unique<VertexDataContextGL<Packet>>();
   }
 
@@ -56,8 +59,9 @@ class Mesh {
    *  The new object assumes ownership of the passed-in context.
    */ 
   Mesh(std::unique_ptr<VertexDataContext<Packet>> context) :
+    context_(std::move(context)),
     dirty_(true),
-    context_(std::move(context)) { }
+    bounds_dirty_(true) { }
 
   /**
    *  Stores a new vertex based on the contents of the data packet.
@@ -66,6 +70,7 @@ class Mesh {
   void AddVertex(const Packet& packet) {
     data_.push_back(packet);
     dirty_ = true;
+    bounds_dirty_ = true;
   }
 
   /**
@@ -75,6 +80,23 @@ class Mesh {
     data_.clear();
     indices_.clear();
     dirty_ = true;
+    bounds_dirty_ = true;
+  }
+
+  /**
+   *  Replaces the contents of this mesh with a block of vertices and indices.
+   *  Intended for loading pre-built geometry in bulk -- indices are not bounds-checked.
+   *  @param data - pointer to `vertex_count` packets.
+   *  @param vertex_count - number of packets to copy.
+   *  @param indices - pointer to `index_count` indices, forming triangles.
+   *  @param index_count - number of indices to copy.
+   */
+  void SetData(const Packet* data, size_t vertex_count,
+               const unsigned int* indices, size_t index_count) {
+    data_.assign(data, data + vertex_count);
+    indices_.assign(indices, indices + index_count);
+    dirty_ = true;
+    bounds_dirty_ = true;
   }
 
   /**
@@ -83,6 +105,7 @@ class Mesh {
    */ 
   Packet& operator[](std::size_t index) {
     dirty_ = true;
+    bounds_dirty_ = true;
     return data_.at(index);
   }
 
@@ -95,14 +118,7 @@ class Mesh {
    *  @return true if the vertices are in-bounds, and false otherwise.
    */ 
   bool AddPolygon(unsigned int vertA, unsigned int vertB, unsigned int vertC) {
-    unsigned int min_value = (vertA < vertB ? vertA : vertB);
-    unsigned int max_value = (vertA < vertB ? vertB : vertA);
-    min_value = (vertC < min_value ? vertC : min_value);
-    max_value = (vertC > max_value ? vertC : max_value);
-    if (min_value >= 0 && max_value < GetVertexCount()) {
-      indices_.push_back(vertA);
-      indices_.push_back(vertB);
-      indices_.push_back(vertC);
+    if (AddTriangle(GetVertexCount(), vertA, vertB, vertC, indices_)) {
       dirty_ = true;
       return true;
     }
@@ -112,14 +128,43 @@ class Mesh {
 
   /**
    *  Adds a polygon with an arbitrary number of vertices.
-   *  Simple ver: adds n-2 triangles, reading in increasing order.
    *  @param indices - List of vertices in the polygon.
    */
   bool AddPolygon(const std::vector<unsigned int>& indices) {
+    bool res = TriangulatePolygon(data_.data(), data_.size(), indices, indices_);
+    dirty_ = true;
+    return res;
+  }
+
+  /**
+   *  Appends pre-triangulated indices to this mesh.
+   *  Indices are not bounds-checked -- see TriangulatePolygon.
+   *  @param indices - pointer to `count` indices, forming triangles.
+   *  @param count - number of indices to append.
+   */
+  void AddIndices(const unsigned int* indices, size_t count) {
+    indices_.insert(indices_.end(), indices, indices + count);
+    dirty_ = true;
+  }
+
+  /**
+   *  Splits a polygon into triangles, as AddPolygon would, without touching any mesh.
+   *  Lets large meshes be triangulated on several threads before they're assembled.
+   *  Simple ver: adds n-2 triangles, reading in increasing order.
+   *  @param data - vertices which the polygon refers to.
+   *  @param vertex_count - number of vertices in `data`.
+   *  @param indices - List of vertices in the polygon.
+   *  @param out - vector which the resulting triangles are appended to.
+   *  @returns true if all vertices were in bounds, false otherwise.
+   *           Triangles emitted before an out-of-bounds vertex was found are kept.
+   */
+  static bool TriangulatePolygon(const Packet* data, size_t vertex_count,
+                                 const std::vector<unsigned int>& indices,
+                                 std::vector<unsigned int>& out) {
     // i could try to implement sweep algo
     // http://allenchou.net/2013/12/game-physics-contact-generation-epa/
-    for (int i = 0; i < indices.size() - 2; i++) {
-      if (!AddPolygon(indices[i], indices[i + 1], indices[i + 2])) {
+    for (int i = 0; i + 2 < indices.size(); i++) {
+      if (!AddTriangle(vertex_count, indices[i], indices[i + 1], indices[i + 2], out)) {
         return false;
       }
     }
@@ -171,6 +216,27 @@ class Mesh {
     return indices_.data();
   }
 
+  /**
+   *  Returns the box bounding every vertex in this mesh, in model space.
+   *  Empty if the mesh has no vertices. Recomputed on the first call after the vertices change.
+   *  Safe to call from several threads at once, so long as nothing is editing the mesh.
+   */
+  const utils::aabb& GetBounds() const {
+    std::lock_guard<std::mutex> lock(bounds_lock_);
+    UpdateBounds();
+    return bounds_;
+  }
+
+  /**
+   *  Returns a sphere bounding every vertex in this mesh, centered on its box.
+   *  Radius is negative if the mesh has no vertices. Thread safety is as for GetBounds.
+   */
+  const utils::bounding_sphere& GetBoundingSphere() const {
+    std::lock_guard<std::mutex> lock(bounds_lock_);
+    UpdateBounds();
+    return sphere_;
+  }
+
   /**
    *  Concatenates the passed Mesh object onto `this`.
    *  @param other - the other Mesh being merged.
@@ -186,6 +252,7 @@ class Mesh {
     }
 
     dirty_ = true;
+    bounds_dirty_ = true;
   }
 
   Mesh(const Mesh& other) {
@@ -199,6 +266,7 @@ class Mesh {
     }
 
     dirty_ = true;
+    bounds_dirty_ = true;
   }
 
   Mesh& operator=(const Mesh& other) {
@@ -212,6 +280,7 @@ class Mesh {
     }
 
     dirty_ = true;
+    bounds_dirty_ = true;
 
     return *this;
   }
@@ -221,16 +290,76 @@ class Mesh {
     data_ = std::move(other.data_);
     indices_ = std::move(other.indices_);
     dirty_ = true;
+    bounds_dirty_ = true;
   }
 
   Mesh& operator=(Mesh&& other) {
     data_ = std::move(other.data_);
     indices_ = std::move(other.indices_);
     dirty_ = true;
+    bounds_dirty_ = true;
     return *this;
   }
 
  private:
+  /**
+   *  Appends a triangle to `out`, if all of its vertices are in bounds.
+   *  @returns true if the triangle was added, false otherwise.
+   */
+  static bool AddTriangle(size_t vertex_count, unsigned int vertA, unsigned int vertB, unsigned int vertC,
+                          std::vector<unsigned int>& out) {
+    unsigned int max_value = (vertA < vertB ? vertB : vertA);
+    max_value = (vertC > max_value ? vertC : max_value);
+    if (max_value < vertex_count) {
+      out.push_back(vertA);
+      out.push_back(vertB);
+      out.push_back(vertC);
+      return true;
+    }
+
+    return false;
+  }
+
+  static glm::vec3 ToPoint(const glm::vec3& position) {
+    return position;
+  }
+
+  static glm::vec3 ToPoint(const glm::vec2& position) {
+    return glm::vec3(position, 0.0f);
+  }
+
+  /**
+   *  Recomputes bounds, if the vertices have changed since they were last computed.
+   *  Hold bounds_lock_ -- meshes are shared between models, which may ask from any thread.
+   */
+  void UpdateBounds() const {
+    if (!bounds_dirty_) {
+      return;
+    }
+
+    bounds_ = utils::EmptyBounds();
+    for (const Packet& packet : data_) {
+      glm::vec3 point = ToPoint(packet.position);
+      bounds_.min = glm::min(bounds_.min, point);
+      bounds_.max = glm::max(bounds_.max, point);
+    }
+
+    // not the smallest sphere, but close for most meshes, and cheap
+    sphere_.center = (bounds_.min + bounds_.max) * 0.5f;
+    sphere_.radius = -1.0f;
+    float radius_squared = -1.0f;
+    for (const Packet& packet : data_) {
+      glm::vec3 offset = ToPoint(packet.position) - sphere_.center;
+      radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+    }
+
+    if (radius_squared >= 0.0f) {
+      sphere_.radius = std::sqrt(radius_squared);
+    }
+
+    bounds_dirty_ = false;
+  }
+
   // the underlying data stored.
   std::vector<Packet> data_;
 
@@ -243,6 +372,12 @@ class Mesh {
   // tracks whether we need to update our buffers.
   bool dirty_;
 
+  // computed on demand from data_ -- see UpdateBounds
+  mutable utils::aabb bounds_;
+  mutable utils::bounding_sphere sphere_;
+  mutable bool bounds_dirty_;
+  mutable std::mutex bounds_lock_;                      // guards the above against concurrent readers
+
   
 };
 
@@ -253,22 +388,30 @@ class Mesh {
  *  let it be for now.
  */ 
 template <>
-bool Mesh<storage::VertexPacket3D>::AddPolygon(const std::vector<unsigned int>& indices) {
+inline bool Mesh<storage::VertexPacket3D>::TriangulatePolygon(const storage::VertexPacket3D* data,
+                                                              size_t vertex_count,
+                                                              const std::vector<unsigned int>& indices,
+                                                              std::vector<unsigned int>& out) {
   // smart idea: since it's convex, read top to bottom
   // TODO: http://allenchou.net/2013/12/game-physics-contact-generation-epa/
   // someone says this doesn't work (consi)
   if (indices.size() == 3) {
-    return AddPolygon(indices[0], indices[1], indices[2]);
+    return AddTriangle(vertex_count, indices[0], indices[1], indices[2], out);
+  }
+
+  if (indices.size() < 3) {
+    return false;
   }
 
   std::vector<std::pair<unsigned int, storage::VertexPacket3D>> vertices;
+  vertices.reserve(indices.size());
   for (auto index : indices) {
-    if (index >= data_.size() || index < 0) {
+    if (index >= vertex_count) {
       return false;
     }
 
     vertices.push_back(std::pair<unsigned int,
-                       storage::VertexPacket3D>(index, data_[index]));
+                       storage::VertexPacket3D>(index, data[index]));
   }
 
   glm::vec3 cross_r = vertices[0].second.normals;
@@ -318,7 +461,7 @@ bool Mesh<storage::VertexPacket3D>::AddPolygon(const std::vector<unsigned int>&
   );
 
   for (int i = 2; i < vertices.size(); i++) {
-    AddPolygon(vertices[0].first, vertices[i - 1].first, vertices[i].first);
+    AddTriangle(vertex_count, vertices[0].first, vertices[i - 1].first, vertices[i].first, out);
   }
 
   return true;
@@ -11,6 +11,7 @@
 
 #include <glad/glad.h>
 
+#include <functional>
 #include <string>
 
 namespace monkeysworld {
@@ -43,6 +44,14 @@ class CubeMap {
    */ 
   GLuint GetCubeMapDescriptor() const;
 
+  /**
+   *  Sets a function to call once this cubemap has been uploaded to GL.
+   *  @param callback - called on the uploading thread, with the time the upload took in nanoseconds.
+   */
+  void SetUploadCallback(std::function<void(uint64_t)> callback) {
+    upload_callback_ = std::move(callback);
+  }
+
   /**
    *  @returns the size, in bytes, of the cubemap
    */ 
@@ -62,6 +71,8 @@ class CubeMap {
   };
 
   GLuint cubemap_;
+  // called once, after the first upload
+  std::function<void(uint64_t)> upload_callback_;
   // memory cache for input data
   face_info face_data_[6];
 
@@ -1,9 +1,13 @@
 #ifndef FRAMEBUFFER_H_
 #define FRAMEBUFFER_H_
 
+#include <shader/FramebufferPool.hpp>
+
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <memory>
+
 namespace monkeysworld {
 namespace shader {
 
@@ -28,6 +32,14 @@ class Framebuffer {
    */ 
   Framebuffer();
 
+  /**
+   *  Constructs a new Framebuffer whose attachments are leased from a pool.
+   *  Attachments are only replaced once the framebuffer outgrows them, or shrinks well below
+   *  them, and go back to the pool when they are.
+   *  @param pool - the pool to lease from. If null, attachments match the framebuffer's size exactly.
+   */
+  Framebuffer(std::shared_ptr<FramebufferPool> pool);
+
   /**
    *  Modifies the dimensions of the framebuffer.
    *  @param size - the new width and height of the framebuffer.
@@ -64,6 +76,29 @@ class Framebuffer {
    */ 
   GLuint GetFramebuffer();
 
+  /**
+   *  Lets this framebuffer draw to a region of a render target shared with other framebuffers,
+   *  rather than having attachments of its own. Only applies to framebuffers with a pool, and
+   *  only while they're small enough to share (see FramebufferPool::LeaseRegion).
+   *  Takes effect the next time the framebuffer is bound.
+   *
+   *  Nothing drawing into a shared target may sample from it at the same time.
+   *  @param atlased - whether this framebuffer may share.
+   */
+  void SetAtlased(bool atlased);
+
+  /**
+   *  Pooled and atlased framebuffers may draw to only part of their attachments.
+   *  @returns the lower left corner of the area this framebuffer draws to, in pixels.
+   */
+  glm::ivec2 GetOrigin() const;
+
+  /**
+   *  @param min - output param for the texcoords of the lower left corner of the area drawn to.
+   *  @param max - output param for the texcoords of its upper right corner.
+   */
+  void GetTexcoords(glm::vec2* min, glm::vec2* max) const;
+
   ~Framebuffer();
   Framebuffer(const Framebuffer& other);
   Framebuffer& operator=(const Framebuffer& other);
@@ -73,12 +108,30 @@ class Framebuffer {
  private:
   void GenerateFramebuffer(GLenum target);
 
+  /**
+   *  Gives up the current attachments, if there are any.
+   */
+  void ReleaseFramebuffer();
+
+  /**
+   *  Tries to move into a region of a shared target.
+   *  @returns true if the framebuffer is now drawing to one.
+   */
+  bool LeaseRegion();
+
+  std::shared_ptr<FramebufferPool> pool_;
+  bool atlased_;                            // whether we may lease a region
+  bool in_region_;                          // whether we're drawing to one
+
   GLuint fb_;
   GLuint color_;
   GLuint depth_stencil_;
 
   glm::ivec2 fb_size_;
   glm::ivec2 fb_size_old_;
+  glm::ivec2 alloc_size_;                   // size of the attachments
+  glm::ivec2 origin_;                       // where we draw to, within the attachments
+  glm::ivec2 region_size_;                  // room we have there, if in a region
 };
 
 }
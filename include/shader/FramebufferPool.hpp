@@ -0,0 +1,225 @@
+#ifndef FRAMEBUFFER_POOL_H_
+#define FRAMEBUFFER_POOL_H_
+
+#include <utils/SkylinePacker.hpp>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cinttypes>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace monkeysworld {
+namespace shader {
+
+/**
+ *  A framebuffer along with its color and depth-stencil attachments.
+ */
+struct render_target {
+  GLuint fb;
+  GLuint color;
+  GLuint depth_stencil;
+  glm::ivec2 size;                          // size of the attachments
+};
+
+/**
+ *  Part of a render target shared with other framebuffers.
+ */
+struct atlas_region {
+  render_target page;                       // the shared target
+  glm::ivec2 origin;                        // lower left corner of the region within it
+  glm::ivec2 size;                          // size of the region
+};
+
+/**
+ *  Running totals for a FramebufferPool, for profiling.
+ */
+struct framebuffer_pool_stats {
+  uint64_t allocations;                     // render targets created
+  uint64_t evictions;                       // idle render targets deleted
+  uint64_t leases;                          // render targets handed out
+  uint64_t reuses;                          // leases served by a target returned earlier
+  uint64_t bytes;                           // GPU memory held by all targets, leased or idle
+  uint64_t idle_bytes;                      // GPU memory held by targets nobody is using
+  uint32_t targets;                         // render targets currently allocated
+  uint32_t atlas_pages;                     // leased targets being shared out as regions
+  uint32_t atlas_regions;                   // regions currently leased
+};
+
+/**
+ *  Creates and deletes the GL objects behind a render target.
+ *  Split from the pool so that its bookkeeping can be tested without GL.
+ */
+class RenderTargetAllocator {
+ public:
+  /**
+   *  Creates a render target.
+   *  @param target - the target to fill in. Its size is already set.
+   */
+  virtual void Allocate(render_target* target) = 0;
+
+  /**
+   *  Deletes a render target created by Allocate.
+   *  @param target - the target to delete.
+   */
+  virtual void Free(const render_target& target) = 0;
+
+  virtual ~RenderTargetAllocator() {}
+};
+
+/**
+ *  Allocates render targets with an RGBA color texture and a depth-stencil texture.
+ */
+class RenderTargetAllocatorGL : public RenderTargetAllocator {
+ public:
+  void Allocate(render_target* target) override;
+  void Free(const render_target& target) override;
+};
+
+/**
+ *  Recycles render targets, so that framebuffers which change size don't create and delete
+ *  GL objects each time they do.
+ *
+ *  Sizes are rounded up to buckets (see GetBucketSize), so small changes in size land on the
+ *  same target, and a target returned by one framebuffer can serve the next one asking for a
+ *  similar size. Returned targets are kept until the pool holds more memory than its budget,
+ *  at which point the least recently returned are deleted first.
+ *
+ *  Small framebuffers can lease a region of a shared target instead (see LeaseRegion), saving
+ *  memory and letting whoever composites them bind one texture for many.
+ *
+ *  Not thread safe: targets are GL objects, so the pool belongs to the render thread.
+ */
+class FramebufferPool {
+ public:
+  static const uint64_t DEFAULT_BUDGET = 128 * 1024 * 1024;
+  static const int ATLAS_PAGE_SIZE = 1024;
+  static const int MAX_ATLAS_REGION = 256;
+
+  /**
+   *  Creates a pool which allocates through GL.
+   *  @param budget - memory the pool may hold onto, in bytes.
+   */
+  FramebufferPool(uint64_t budget = DEFAULT_BUDGET);
+
+  /**
+   *  Creates a pool which allocates through `allocator`.
+   *  @param allocator - creates and deletes the pool's targets.
+   *  @param budget - memory the pool may hold onto, in bytes.
+   */
+  FramebufferPool(std::unique_ptr<RenderTargetAllocator> allocator, uint64_t budget = DEFAULT_BUDGET);
+
+  /**
+   *  Hands out a render target which is at least as large as `size`.
+   *  @param size - the size needed.
+   *  @returns a target of size GetBucketSize(size), which stays the caller's until it's returned.
+   */
+  render_target Lease(glm::ivec2 size);
+
+  /**
+   *  Gives a leased render target back to the pool.
+   *  @param target - the target, as returned by Lease.
+   */
+  void Return(const render_target& target);
+
+  /**
+   *  Hands out a region of a shared render target.
+   *
+   *  Regions are packed into pages of ATLAS_PAGE_SIZE, with a pixel of space around each so
+   *  that filtering doesn't pick up their neighbors. Space isn't reused until every region on
+   *  a page has been returned, so regions suit framebuffers which rarely change size.
+   *  @param size - the size needed. Neither dimension may exceed MAX_ATLAS_REGION.
+   *  @param region - output param for the region.
+   *  @returns true if a region was leased, false if the size is too large to share.
+   */
+  bool LeaseRegion(glm::ivec2 size, atlas_region* region);
+
+  /**
+   *  Gives a leased region back to the pool.
+   *  @param region - the region, as returned by LeaseRegion.
+   */
+  void ReturnRegion(const atlas_region& region);
+
+  /**
+   *  Changes the pool's memory budget, deleting idle targets if it's now over.
+   *  Leased targets count against the budget, but are never deleted.
+   *  @param budget - the new budget, in bytes.
+   */
+  void SetBudget(uint64_t budget);
+
+  /**
+   *  @returns the pool's memory budget, in bytes.
+   */
+  uint64_t GetBudget() const;
+
+  /**
+   *  Deletes every idle render target.
+   */
+  void Trim();
+
+  /**
+   *  @returns running totals for this pool.
+   */
+  const framebuffer_pool_stats& GetStats() const;
+
+  /**
+   *  Rounds a size up to the size of the render target which will be leased for it.
+   *  Each dimension is rounded up to a multiple of an eighth of the power of two above it,
+   *  but at least a multiple of 8. So from 64px up, a target is never more than 25% larger
+   *  than needed in either direction -- below that, it's at most 7px larger.
+   *  @param size - the size needed.
+   *  @returns the size of the target.
+   */
+  static glm::ivec2 GetBucketSize(glm::ivec2 size);
+
+  /**
+   *  @returns the memory used by a render target of the given size, in bytes.
+   */
+  static uint64_t GetTargetBytes(glm::ivec2 size);
+
+  ~FramebufferPool();
+  FramebufferPool(const FramebufferPool& other) = delete;
+  FramebufferPool& operator=(const FramebufferPool& other) = delete;
+
+ private:
+  typedef std::list<render_target>::iterator idle_itr;
+
+  static uint64_t GetBucketKey(glm::ivec2 size);
+
+  /**
+   *  Deletes the least recently returned idle targets until the pool is within budget.
+   */
+  void EvictToBudget();
+
+  /**
+   *  Deletes an idle target.
+   */
+  void Evict(idle_itr target);
+
+  struct atlas_page {
+    render_target target;
+    utils::SkylinePacker packer;
+    uint32_t regions;                       // regions leased from this page
+  };
+
+  std::unique_ptr<RenderTargetAllocator> allocator_;
+  uint64_t budget_;
+  framebuffer_pool_stats stats_;
+
+  // idle targets, most recently returned first
+  std::list<render_target> idle_;
+
+  // idle targets by bucket, most recently returned last
+  std::unordered_map<uint64_t, std::vector<idle_itr>> buckets_;
+
+  // pages which regions are being leased from, each one leased from the pool itself
+  std::vector<atlas_page> pages_;
+};
+
+}
+}
+
+#endif  // FRAMEBUFFER_POOL_H_
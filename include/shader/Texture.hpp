@@ -4,6 +4,7 @@
 #include <glad/glad.h>
 #include <shader/Framebuffer.hpp>
 
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -39,6 +40,16 @@ class Texture {
    */ 
   Texture(int width, int height, int channels);
 
+  /**
+   *  Creates a new texture from pixels which have already been decoded, e.g. by an asset pack.
+   *  Pixels are expected in the same layout stb_image produces (rows flipped vertically).
+   *  @param pixels - decoded pixel data. Held until the texture is uploaded.
+   *  @param width - width of the new texture.
+   *  @param height - height of the new texture.
+   *  @param channels - number of channels in `pixels`.
+   */
+  Texture(std::shared_ptr<const unsigned char> pixels, int width, int height, int channels);
+
   /**
    *  Creates a new texture from the contents of a framebuffer.
    *  @param ctx - the currently active context.
@@ -51,6 +62,14 @@ class Texture {
    */ 
   GLuint GetTextureDescriptor() const;
 
+  /**
+   *  Sets a function to call once this texture has been uploaded to GL.
+   *  @param callback - called on the uploading thread, with the time the upload took in nanoseconds.
+   */
+  void SetUploadCallback(std::function<void(uint64_t)> callback) {
+    upload_callback_ = std::move(callback);
+  }
+
   int GetWidth() const {
     return width_;
   }
@@ -77,6 +96,10 @@ class Texture {
  private:
   // stores the texture before being loaded by GL.
   unsigned char* tex_cache_;
+  // pre-decoded pixels, owned by someone else. used in place of tex_cache_.
+  std::shared_ptr<const unsigned char> pixel_source_;
+  // called once, after the first upload
+  std::function<void(uint64_t)> upload_callback_;
   GLuint tex_;
   // tex dims
   // TODO: these ought to be const and public
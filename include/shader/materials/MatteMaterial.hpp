@@ -41,6 +41,11 @@ class MatteMaterial : public ::monkeysworld::shader::Material {
    */ 
   void SetModelTransforms(const glm::mat4& model_matrix);
 
+  /**
+   *  For passing model matrix, along with a precomputed normal matrix.
+   */ 
+  void SetModelTransforms(const glm::mat4& model_matrix, const glm::mat3& normal_matrix);
+
   /**
    *  Passes light data to its respective uniforms. (deprecated)
    */ 
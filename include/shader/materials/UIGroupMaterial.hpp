@@ -1,8 +1,6 @@
 #ifndef UI_GROUP_MATERIAL_H_
 #define UI_GROUP_MATERIAL_H_
 
-#define TEXTURES_PER_CALL 4
-
 #include <shader/Material.hpp>
 
 #include <engine/Context.hpp>
@@ -13,24 +11,31 @@ namespace monkeysworld {
 namespace shader {
 namespace materials {
 
+/**
+ *  Composites a group's children, drawn as instanced quads (see critter::ui::composite_quad).
+ */
 class UIGroupMaterial : public Material {
  public:
+  // size of the shader's sampler array
+  static const int MAX_TEXTURES = 16;
+
   /**
    *  Creates the UIGroupMaterial.
    */ 
   UIGroupMaterial(engine::Context* ctx);
 
   /**
-   *  Sets textures for this call.
-   *  @param textures - array of textures sent to the material.
-   */ 
-  void SetTextures(GLuint textures[TEXTURES_PER_CALL]);
+   *  @returns the number of textures which can be bound for a single call:
+   *           MAX_TEXTURES, or fewer if the GPU can't sample that many at once.
+   */
+  int GetMaxTextures();
 
   /**
-   *  Sets the opacity of each UI group represented in the material.
-   *  @param opacities - array of opacities sent to material.
+   *  Sets textures for this call.
+   *  @param textures - textures sent to the material, by slot.
+   *  @param count - number of textures. Anything past GetMaxTextures is ignored.
    */ 
-  void SetOpacity(float opacities[TEXTURES_PER_CALL]);
+  void SetTextures(const GLuint* textures, int count);
 
   /**
    *  Uses the underlying program.
@@ -38,12 +43,13 @@ class UIGroupMaterial : public Material {
   void UseMaterial() override;
  private:
   ShaderProgram prog_;
-  GLuint textures_[TEXTURES_PER_CALL];
-  float opacities_[TEXTURES_PER_CALL];
+  GLuint textures_[MAX_TEXTURES];
+  int texture_count_;
+  int max_textures_;
 };
 
 }
 }
 }
 
-#endif
\ No newline at end of file
+#endif
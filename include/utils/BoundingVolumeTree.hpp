@@ -0,0 +1,392 @@
+#ifndef BOUNDING_VOLUME_TREE_H_
+#define BOUNDING_VOLUME_TREE_H_
+
+#include <utils/Bounds.hpp>
+#include <utils/Frustum.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+namespace monkeysworld {
+namespace utils {
+
+/**
+ *  Dynamic bounding volume hierarchy, for spatial queries over a changing set of boxes:
+ *  what a frustum contains, what lies near a point, and what a ray hits.
+ *
+ *  Each box is a "proxy", stored as a leaf along with a 32-bit payload for the caller.
+ *  Leaves hold a slightly enlarged ("fat") copy of their box, so that small movements inside it
+ *  don't touch the tree at all. Internal nodes hold the union of their children.
+ *
+ *  When a box escapes its fat box, one of two things happens:
+ *    - if it still overlaps where it was, the leaf is refit: its box and those of its ancestors
+ *      are recomputed in place. Cheap, but the leaf may no longer sit near its neighbours.
+ *    - otherwise it is removed and reinserted wherever it adds the least surface area,
+ *      rebalancing on the way back up.
+ *  Refits keep the tree correct, but not well shaped. Every so often the tree's surface area cost
+ *  is measured, and once it has drifted far enough past what the last rebuild achieved, the
+ *  whole tree is rebuilt from scratch. Batches which touch a large share of the proxies skip
+ *  straight to the rebuild, which is cheaper than placing them one at a time.
+ *
+ *  Queries report proxies whose actual box passes the test, not just their fat box.
+ *  Callbacks take the proxy's payload, and return false to stop the query early.
+ *
+ *  Usage:
+ *    BoundingVolumeTree tree;
+ *    int proxy = tree.CreateProxy(object_bounds, object_id);
+ *    tree.MoveProxy(proxy, new_bounds);
+ *    tree.QueryFrustum(Frustum(camera.vp_matrix), [&](uint32_t id) { draw(id); return true; });
+ *
+ *  Not thread safe. Queries may run alongside one another, but not alongside edits.
+ */
+class BoundingVolumeTree {
+ public:
+  static const int NULL_NODE = -1;
+
+  /**
+   *  A proxy, and where it has moved to.
+   */
+  struct proxy_move {
+    int proxy;
+    aabb box;
+  };
+
+  /**
+   *  Creates a new, empty tree.
+   *  @param margin - how far fat boxes extend past the boxes they hold, on each side.
+   */
+  BoundingVolumeTree(float margin = 0.1f);
+
+  /**
+   *  Adds a box to the tree.
+   *  @param box - box to add. Must be neither empty nor infinite.
+   *  @param data - payload to report when the box is found.
+   *  @returns an id for the new proxy, which stays valid until it is destroyed.
+   */
+  int CreateProxy(const aabb& box, uint32_t data);
+
+  /**
+   *  Adds many boxes at once. Large batches are placed by rebuilding the tree.
+   *  @param proxies - output param. ids of the new proxies, `count` long.
+   */
+  void CreateProxies(const aabb* boxes, const uint32_t* data, size_t count, int* proxies);
+
+  /**
+   *  Removes a proxy from the tree. Its id may be reused.
+   */
+  void DestroyProxy(int proxy);
+
+  /**
+   *  Moves a proxy to a new box.
+   */
+  void MoveProxy(int proxy, const aabb& box);
+
+  /**
+   *  Moves many proxies at once. Large batches rebuild the tree.
+   */
+  void MoveProxies(const proxy_move* moves, size_t count);
+
+  /**
+   *  Rebuilds the tree from its leaves, splitting them at the median of their longest axis.
+   */
+  void Rebuild();
+
+  /**
+   *  @returns the payload passed in when `proxy` was created.
+   */
+  uint32_t GetData(int proxy) const;
+
+  /**
+   *  @returns the box `proxy` was last given.
+   */
+  const aabb& GetBounds(int proxy) const;
+
+  size_t GetProxyCount() const;
+
+  /**
+   *  @returns the number of levels beneath the root, or -1 if the tree is empty.
+   */
+  int GetHeight() const;
+
+  /**
+   *  @returns the tree's surface area cost: the total area of its internal nodes, relative to the root's.
+   *           Roughly how many internal nodes a random ray through the root has to visit.
+   */
+  float GetCost() const;
+
+  /**
+   *  Reports every proxy whose box overlaps `box`.
+   */
+  template <typename Callback>
+  void QueryBox(const aabb& box, Callback callback) const;
+
+  /**
+   *  Reports every proxy whose box overlaps `sphere`.
+   */
+  template <typename Callback>
+  void QuerySphere(const bounding_sphere& sphere, Callback callback) const;
+
+  /**
+   *  Reports every proxy whose box passes `frustum`'s test.
+   *  Subtrees which lie entirely inside the frustum are reported without testing their contents.
+   */
+  template <typename Callback>
+  void QueryFrustum(const Frustum& frustum, Callback callback) const;
+
+  /**
+   *  Reports proxies whose box `ray` passes through, roughly nearest first.
+   *  @param max_t - how far along the ray to look.
+   *  @param callback - called as `float callback(uint32_t data, float t)`, with `t` where the ray
+   *                    enters the box. Returns how far along the ray to keep looking: `t` to only
+   *                    look for nearer boxes, the current limit to find them all, or 0 to stop.
+   */
+  template <typename Callback>
+  void RayCast(const ray& r, float max_t, Callback callback) const;
+
+ private:
+  struct node {
+    aabb box;                   // fat box for leaves, union of the children otherwise
+    int parent;                 // next free node, for nodes on the free list
+    int child1;
+    int child2;                 // NULL_NODE for leaves
+    int height;                 // 0 for leaves, -1 for free nodes
+    uint32_t data;
+  };
+
+  /**
+   *  Stack for traversals. Trees are rarely deep enough to leave the inline storage.
+   */
+  class Stack {
+   public:
+    Stack() : size_(0) {}
+    void Push(int n) {
+      if (size_ < INLINE) {
+        inline_[size_] = n;
+      } else {
+        heap_.push_back(n);
+      }
+
+      size_++;
+    }
+
+    int Pop() {
+      size_--;
+      if (size_ < INLINE) {
+        return inline_[size_];
+      }
+
+      int res = heap_.back();
+      heap_.pop_back();
+      return res;
+    }
+
+    bool Empty() const {
+      return (size_ == 0);
+    }
+
+   private:
+    static const size_t INLINE = 64;
+    int inline_[INLINE];
+    std::vector<int> heap_;
+    size_t size_;
+  };
+
+  int AllocateNode();
+  void FreeNode(int n);
+  int AllocateLeaf(const aabb& box, uint32_t data);
+
+  aabb Fatten(const aabb& box) const;
+
+  void InsertLeaf(int leaf);
+  void RemoveLeaf(int leaf);
+
+  /**
+   *  Rotates the taller child of `n` up, if its children's heights differ by more than one.
+   *  @returns the node now in `n`'s place.
+   */
+  int Balance(int n);
+
+  /**
+   *  Recomputes boxes and heights from `n` up to the root.
+   */
+  void Refit(int n);
+
+  /**
+   *  Builds a subtree over `count` leaves.
+   *  @returns its root.
+   */
+  int Build(int* leaves, size_t count, int parent);
+
+  /**
+   *  Counts an edit towards the next check of the tree's shape, and rebuilds it if it has
+   *  gotten too bad.
+   */
+  void NoteEdits(size_t count);
+
+  bool IsLarge(size_t count) const;
+
+  template <typename Callback>
+  bool ReportAll(int n, Callback& callback) const;
+
+  std::vector<node> nodes_;
+  std::vector<aabb> boxes_;           // per node: the box a leaf was given. unused for internal nodes
+  std::vector<int> leaves_;           // scratch for rebuilds
+  int root_;
+  int free_list_;
+  size_t proxy_count_;
+  float margin_;
+  float built_cost_;                  // cost right after the last rebuild
+  size_t edits_;                      // moves since the cost was last checked
+};
+
+template <typename Callback>
+void BoundingVolumeTree::QueryBox(const aabb& box, Callback callback) const {
+  if (root_ == NULL_NODE) {
+    return;
+  }
+
+  Stack stack;
+  stack.Push(root_);
+  while (!stack.Empty()) {
+    int index = stack.Pop();
+    const node& n = nodes_[index];
+    if (!Overlaps(n.box, box)) {
+      continue;
+    }
+
+    if (n.child1 == NULL_NODE) {
+      if (Overlaps(boxes_[index], box) && !callback(n.data)) {
+        return;
+      }
+    } else {
+      stack.Push(n.child1);
+      stack.Push(n.child2);
+    }
+  }
+}
+
+template <typename Callback>
+void BoundingVolumeTree::QuerySphere(const bounding_sphere& sphere, Callback callback) const {
+  if (root_ == NULL_NODE) {
+    return;
+  }
+
+  Stack stack;
+  stack.Push(root_);
+  while (!stack.Empty()) {
+    int index = stack.Pop();
+    const node& n = nodes_[index];
+    if (!Overlaps(n.box, sphere)) {
+      continue;
+    }
+
+    if (n.child1 == NULL_NODE) {
+      if (Overlaps(boxes_[index], sphere) && !callback(n.data)) {
+        return;
+      }
+    } else {
+      stack.Push(n.child1);
+      stack.Push(n.child2);
+    }
+  }
+}
+
+template <typename Callback>
+void BoundingVolumeTree::QueryFrustum(const Frustum& frustum, Callback callback) const {
+  if (root_ == NULL_NODE) {
+    return;
+  }
+
+  Stack stack;
+  stack.Push(root_);
+  while (!stack.Empty()) {
+    int index = stack.Pop();
+    const node& n = nodes_[index];
+    if (!frustum.TestBox(n.box)) {
+      continue;
+    }
+
+    if (n.child1 == NULL_NODE) {
+      if (frustum.TestBox(boxes_[index]) && !callback(n.data)) {
+        return;
+      }
+    } else if (frustum.ContainsBox(n.box)) {
+      if (!ReportAll(index, callback)) {
+        return;
+      }
+    } else {
+      stack.Push(n.child1);
+      stack.Push(n.child2);
+    }
+  }
+}
+
+template <typename Callback>
+void BoundingVolumeTree::RayCast(const ray& r, float max_t, Callback callback) const {
+  if (root_ == NULL_NODE) {
+    return;
+  }
+
+  glm::vec3 inv_dir = glm::vec3(1.0f) / r.direction;
+  float t;
+  Stack stack;
+  stack.Push(root_);
+  while (!stack.Empty()) {
+    int index = stack.Pop();
+    const node& n = nodes_[index];
+    if (!IntersectRay(n.box, r.origin, inv_dir, max_t, &t)) {
+      continue;
+    }
+
+    if (n.child1 == NULL_NODE) {
+      if (IntersectRay(boxes_[index], r.origin, inv_dir, max_t, &t)) {
+        max_t = callback(n.data, t);
+        if (max_t <= 0.0f) {
+          return;
+        }
+      }
+
+      continue;
+    }
+
+    // visit the nearer child first, so that it can shorten the ray before the other is tested
+    float t1, t2;
+    bool hit1 = IntersectRay(nodes_[n.child1].box, r.origin, inv_dir, max_t, &t1);
+    bool hit2 = IntersectRay(nodes_[n.child2].box, r.origin, inv_dir, max_t, &t2);
+    if (hit1 && hit2) {
+      stack.Push(t1 < t2 ? n.child2 : n.child1);
+      stack.Push(t1 < t2 ? n.child1 : n.child2);
+    } else if (hit1) {
+      stack.Push(n.child1);
+    } else if (hit2) {
+      stack.Push(n.child2);
+    }
+  }
+}
+
+template <typename Callback>
+bool BoundingVolumeTree::ReportAll(int root, Callback& callback) const {
+  Stack stack;
+  stack.Push(root);
+  while (!stack.Empty()) {
+    const node& n = nodes_[stack.Pop()];
+    if (n.child1 == NULL_NODE) {
+      if (!callback(n.data)) {
+        return false;
+      }
+    } else {
+      stack.Push(n.child1);
+      stack.Push(n.child2);
+    }
+  }
+
+  return true;
+}
+
+}
+}
+
+#endif  // BOUNDING_VOLUME_TREE_H_
@@ -0,0 +1,142 @@
+#ifndef BOUNDS_H_
+#define BOUNDS_H_
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+
+namespace monkeysworld {
+namespace utils {
+
+/**
+ *  Axis-aligned bounding box.
+ *
+ *  Two special cases: an empty box (min > max) contains nothing, and is what a box starts out as
+ *  before anything is merged into it. An infinite box (min = -FLT_MAX, max = FLT_MAX) stands in for
+ *  things which can't be bounded, and is never culled.
+ */
+struct aabb {
+  glm::vec3 min;
+  glm::vec3 max;
+};
+
+/**
+ *  Bounding sphere.
+ */
+struct bounding_sphere {
+  glm::vec3 center;
+  float radius;
+};
+
+/**
+ *  Ray, for picking. Points along it are `origin + direction * t`, for t >= 0.
+ */
+struct ray {
+  glm::vec3 origin;
+  glm::vec3 direction;
+};
+
+/**
+ *  @returns a box containing nothing.
+ */
+inline aabb EmptyBounds() {
+  return { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+}
+
+/**
+ *  @returns a box containing everything.
+ */
+inline aabb InfiniteBounds() {
+  return { glm::vec3(-FLT_MAX), glm::vec3(FLT_MAX) };
+}
+
+inline bool IsEmpty(const aabb& box) {
+  return (box.min.x > box.max.x || box.min.y > box.max.y || box.min.z > box.max.z);
+}
+
+inline bool IsInfinite(const aabb& box) {
+  return (box.min.x == -FLT_MAX || box.min.y == -FLT_MAX || box.min.z == -FLT_MAX
+       || box.max.x == FLT_MAX || box.max.y == FLT_MAX || box.max.z == FLT_MAX);
+}
+
+/**
+ *  @returns the smallest box containing both `a` and `b`.
+ */
+inline aabb Merge(const aabb& a, const aabb& b) {
+  return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+}
+
+/**
+ *  @returns true if `a` and `b` overlap, touching included.
+ */
+inline bool Overlaps(const aabb& a, const aabb& b) {
+  return (a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z
+       && b.min.x <= a.max.x && b.min.y <= a.max.y && b.min.z <= a.max.z);
+}
+
+/**
+ *  @returns true if `box` and `sphere` overlap.
+ */
+inline bool Overlaps(const aabb& box, const bounding_sphere& sphere) {
+  glm::vec3 d = sphere.center - glm::min(glm::max(sphere.center, box.min), box.max);
+  return (glm::dot(d, d) <= sphere.radius * sphere.radius);
+}
+
+/**
+ *  @returns true if `box` contains all of `inner`.
+ */
+inline bool Contains(const aabb& box, const aabb& inner) {
+  return (box.min.x <= inner.min.x && box.min.y <= inner.min.y && box.min.z <= inner.min.z
+       && inner.max.x <= box.max.x && inner.max.y <= box.max.y && inner.max.z <= box.max.z);
+}
+
+/**
+ *  @returns the surface area of `box`, which is how likely a random ray is to hit it.
+ */
+inline float SurfaceArea(const aabb& box) {
+  glm::vec3 d = box.max - box.min;
+  return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+/**
+ *  Slab test of a ray against a box.
+ *  @param origin - start of the ray.
+ *  @param inv_direction - 1 / the ray's direction, per component.
+ *  @param max_t - how far along the ray to look.
+ *  @param t - output param. where the ray enters the box, or 0 if it starts inside.
+ *  @returns true if the ray hits the box before `max_t`.
+ */
+inline bool IntersectRay(const aabb& box, const glm::vec3& origin, const glm::vec3& inv_direction,
+                         float max_t, float* t) {
+  glm::vec3 t1 = (box.min - origin) * inv_direction;
+  glm::vec3 t2 = (box.max - origin) * inv_direction;
+  glm::vec3 t_near = glm::min(t1, t2), t_far = glm::max(t1, t2);
+  float enter = glm::max(glm::max(t_near.x, t_near.y), glm::max(t_near.z, 0.0f));
+  float exit = glm::min(glm::min(t_far.x, t_far.y), glm::min(t_far.z, max_t));
+  *t = enter;
+  return (enter <= exit);
+}
+
+/**
+ *  @returns the smallest axis-aligned box containing `box` once transformed by `m`.
+ *           Empty and infinite boxes stay that way.
+ */
+inline aabb TransformBounds(const aabb& box, const glm::mat4& m) {
+  if (IsEmpty(box) || IsInfinite(box)) {
+    return box;
+  }
+
+  // transform the center, then take the extent along each world axis (Arvo)
+  glm::vec3 center = (box.min + box.max) * 0.5f;
+  glm::vec3 extent = (box.max - box.min) * 0.5f;
+  glm::vec3 world_center = glm::vec3(m * glm::vec4(center, 1.0f));
+  glm::vec3 world_extent = glm::abs(glm::vec3(m[0])) * extent.x
+                         + glm::abs(glm::vec3(m[1])) * extent.y
+                         + glm::abs(glm::vec3(m[2])) * extent.z;
+  return { world_center - world_extent, world_center + world_extent };
+}
+
+}
+}
+
+#endif  // BOUNDS_H_
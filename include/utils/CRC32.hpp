@@ -0,0 +1,80 @@
+#ifndef CRC32_H_
+#define CRC32_H_
+
+#include <cinttypes>
+#include <cstddef>
+
+namespace monkeysworld {
+namespace utils {
+
+/**
+ *  Streaming CRC32, matching the hash our cache files have always used.
+ *
+ *  Note that this is *not* the common zlib CRC32 -- our table was generated by shifting right
+ *  with the unreflected polynomial 0x04C11DB7. The results are stable, and existing caches depend
+ *  on them, so that's kept as-is. One consequence is that SSE4.2's crc32 instruction (CRC32C)
+ *  can't help us; large buffers are folded with PCLMULQDQ instead, where available.
+ *
+ *  Usage:
+ *    CRC32 crc;
+ *    crc.Update(data, size);
+ *    crc.Update(more_data, more_size);
+ *    uint32_t hash = crc.GetHash();
+ */
+class CRC32 {
+ public:
+  CRC32();
+
+  /**
+   *  Feeds a block of bytes into the hash.
+   *  @param data - pointer to the start of the block.
+   *  @param size - number of bytes in the block.
+   */
+  void Update(const void* data, size_t size);
+
+  /**
+   *  @returns the hash of all bytes passed to Update since construction, or the last Reset.
+   */
+  uint32_t GetHash() const {
+    return ~state_;
+  }
+
+  /**
+   *  Clears the hash, as if nothing had been passed to Update.
+   */
+  void Reset();
+
+  /**
+   *  Convenience function for hashing a single block.
+   *  @returns the hash of `size` bytes starting at `data`.
+   */
+  static uint32_t Calculate(const void* data, size_t size);
+
+  /**
+   *  Portable slice-by-8 kernel. Exposed for tests and benchmarks --
+   *  most callers should use Update, which picks the fastest available kernel.
+   *  @param state - running CRC state (the complement of the hash).
+   *  @returns the updated state.
+   */
+  static uint32_t UpdateSliceBy8(uint32_t state, const void* data, size_t size);
+
+  /**
+   *  Carry-less multiply kernel. Only valid if HasCLMUL returns true.
+   *  @param state - running CRC state (the complement of the hash).
+   *  @returns the updated state.
+   */
+  static uint32_t UpdateCLMUL(uint32_t state, const void* data, size_t size);
+
+  /**
+   *  @returns true if this CPU supports the carry-less multiply kernel.
+   */
+  static bool HasCLMUL();
+
+ private:
+  uint32_t state_;
+};
+
+}
+}
+
+#endif  // CRC32_H_
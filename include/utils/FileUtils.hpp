@@ -15,6 +15,8 @@ namespace fileutils {
 
 /**
  *  Calculates the CRC Hash of the provided file, from `offset` forward.
+ *  Hashing stops early at the first 0xFF byte, for compatibility with existing caches.
+ *  Use utils::CRC32 directly to hash arbitrary data.
  *  @param input - the istream we are reading from.
  *  @param offset - absolute offset, relative to ios_base::beg, to start reading from.
  */ 
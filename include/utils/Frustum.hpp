@@ -0,0 +1,99 @@
+#ifndef FRUSTUM_H_
+#define FRUSTUM_H_
+
+#include <utils/Bounds.hpp>
+#include <utils/MatrixBatch.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cinttypes>
+#include <cstddef>
+
+namespace monkeysworld {
+namespace utils {
+
+/**
+ *  The six clip planes of a camera, for culling bounding volumes.
+ *
+ *  Single boxes are tested against every plane at once, with the planes stored across SIMD lanes
+ *  (six planes, plus two which never reject anything, for eight lanes). Batches go the other way,
+ *  putting 4 or 8 boxes across the lanes and going through the planes in turn. Kernels are picked
+ *  the same way as MatrixBatch's.
+ *
+ *  Tests are conservative: a box which straddles two planes outside a corner of the frustum
+ *  still counts as visible.
+ *
+ *  Usage:
+ *    Frustum frustum(camera.vp_matrix);
+ *    if (frustum.TestBox(object->GetWorldBounds())) { ... }
+ */
+class Frustum {
+ public:
+  /**
+   *  Creates a frustum which accepts everything.
+   */
+  Frustum();
+
+  /**
+   *  Extracts the clip planes from a view-projection matrix (GL clip space, z in [-w, w]).
+   *  @param vp_matrix - view and projection matrices combined.
+   */
+  Frustum(const glm::mat4& vp_matrix);
+
+  /**
+   *  @returns true if some of `box` may lie inside the frustum.
+   *           Infinite boxes always pass, and empty ones fail unless the frustum accepts everything.
+   */
+  bool TestBox(const aabb& box) const;
+
+  /**
+   *  @returns true if some of `sphere` may lie inside the frustum.
+   */
+  bool TestSphere(const bounding_sphere& sphere) const;
+
+  /**
+   *  @returns true if all of `box` lies inside the frustum, so that anything inside it can skip
+   *           its own test. Infinite and empty boxes are never contained.
+   */
+  bool ContainsBox(const aabb& box) const;
+
+  /**
+   *  Tests many boxes at once, using the fastest kernel available.
+   *  @param boxes - `count` boxes.
+   *  @param visible - output param. set to 1 for each box which passes, and 0 otherwise.
+   *  @returns the number of boxes which passed.
+   */
+  size_t TestBoxes(const aabb* boxes, uint8_t* visible, size_t count) const;
+
+  /**
+   *  Variant which uses a specific kernel. Exposed for tests and benchmarks --
+   *  if `kernel` isn't supported by this CPU, the best one which is will be used instead.
+   */
+  size_t TestBoxes(MatrixBatch::Kernel kernel, const aabb* boxes, uint8_t* visible, size_t count) const;
+
+  static const int PLANE_COUNT = 6;
+
+  /**
+   *  Rows of the plane table, which the kernels read from.
+   */
+  enum PlaneRow {
+    ROW_NX,                 // plane i keeps points where n . p + d >= 0
+    ROW_NY,
+    ROW_NZ,
+    ROW_D,
+    ROW_ABS_NX,             // |n|, for projecting box extents onto the normal
+    ROW_ABS_NY,
+    ROW_ABS_NZ,
+    ROW_COUNT
+  };
+
+ private:
+  // one plane per lane. the last two lanes hold planes which keep everything
+  alignas(32) float planes_[ROW_COUNT][8];
+  MatrixBatch::Kernel kernel_;
+};
+
+}
+}
+
+#endif  // FRUSTUM_H_
@@ -4,17 +4,29 @@
 #include <atomic>
 #include <cinttypes>
 #include <mutex>
-#include <set>
+#include <vector>
 
 namespace monkeysworld {
 namespace utils {
 
+/**
+ *  A run of consecutive IDs, from `first` up to but not including `end`.
+ */
+struct id_block {
+  uint64_t first;
+  uint64_t end;
+};
+
 /**
  *  singleton class which manages ids within a scope.
  * 
  *  reserved IDs:
  *    - 0, representing nothing.
  *    - 1, representing the window. 
+ * 
+ *  Handing out IDs is lock-free, and doesn't allocate: it's a compare-and-swap on a counter,
+ *  unless the counter has caught up with an ID marked as used, in which case we skip past it under a lock.
+ *  IDs marked as used are kept as a list of ranges, so long runs of them stay small.
  */ 
 class IDGenerator {
   // default ctor for id generator
@@ -26,25 +38,47 @@ class IDGenerator {
    */ 
   uint64_t GetUniqueId();
 
+  /**
+   *  Returns a block of consecutive unique IDs, for threads creating lots of objects at once.
+   *  @param count - the most IDs we want. The block may be shorter if it runs into an ID which is in use,
+   *                 but always contains at least one ID.
+   */ 
+  id_block GetUniqueIds(uint64_t count);
+
   /**
    *  Marks an ID as used.
+   *  Only affects IDs which haven't been handed out yet -- including IDs sitting in blocks.
    */ 
   void RegisterUniqueId(uint64_t new_id);
 
+ private:
+  struct id_range {
+    uint64_t first;
+    uint64_t last;
+  };
+
+  /**
+   *  Moves id_next_ past any IDs which are in use, and drops ranges we've moved past.
+   *  Must be called with reserve_lock_ held.
+   */ 
+  void SkipReservedIds();
 
+  // the next ID we'll hand out
+  std::atomic<uint64_t> id_next_;
 
- private:
-  // lock for creating/fetching IDs.
-  std::mutex id_generation_lock_;
+  // the lowest ID which is marked as used, or UINT64_MAX.
+  // IDs below this can be handed out without taking the lock.
+  std::atomic<uint64_t> reserved_min_;
 
-  // tracks the minimum ID which we can use
-  std::atomic<uint64_t> id_min_;
+  // lock for marking IDs as used, and skipping past them.
+  std::mutex reserve_lock_;
 
-  // set of all IDs currently in use within this generator's scope
-  std::set<uint64_t> used_ids_;
+  // ranges of IDs in use which we haven't reached yet, highest first,
+  // so that the ones we pass pop off the back.
+  std::vector<id_range> reserved_;
 };
 
 } // namespace utils
 } // namespace monkeysworld
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,72 @@
+#ifndef MATRIX_BATCH_H_
+#define MATRIX_BATCH_H_
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+namespace monkeysworld {
+namespace utils {
+
+/**
+ *  Transform math for many objects at once.
+ *
+ *  Each kernel matches what we'd get doing the math per-object with glm -- that is,
+ *  `translate * eulerAngleYXZ * scale` for model matrices, and `inverseTranspose(mat3(model))`
+ *  for normal matrices. The scalar kernel is glm, exactly. The SIMD kernels work on 4 or 8 objects
+ *  at a time, with their own sin/cos, so results can differ from glm's by a few ulps.
+ *
+ *  Usage:
+ *    MatrixBatch::ComposeTransforms(positions, rotations, scales, models, count);
+ *    MatrixBatch::ComputeNormalMatrices(models, normals, count);
+ */
+class MatrixBatch {
+ public:
+  enum Kernel {
+    KERNEL_SCALAR,      // per-object glm math
+    KERNEL_SSE,         // 4 objects at a time. available on all x86-64 CPUs
+    KERNEL_AVX2         // 8 objects at a time
+  };
+
+  /**
+   *  Builds model matrices from local transforms, using the fastest kernel available.
+   *  @param position - `count` positions.
+   *  @param rotation - `count` euler angles, in radians, applied as YXZ.
+   *  @param scale - `count` scales.
+   *  @param out - output param for `count` model matrices.
+   */
+  static void ComposeTransforms(const glm::vec3* position,
+                                const glm::vec3* rotation,
+                                const glm::vec3* scale,
+                                glm::mat4* out,
+                                size_t count);
+
+  /**
+   *  Computes normal matrices for model matrices, using the fastest kernel available.
+   *  @param model - `count` model matrices.
+   *  @param out - output param for `count` normal matrices.
+   */
+  static void ComputeNormalMatrices(const glm::mat4* model, glm::mat3* out, size_t count);
+
+  /**
+   *  Variants which use a specific kernel. Exposed for tests and benchmarks --
+   *  if `kernel` isn't supported by this CPU, the best one which is will be used instead.
+   */
+  static void ComposeTransforms(Kernel kernel,
+                                const glm::vec3* position,
+                                const glm::vec3* rotation,
+                                const glm::vec3* scale,
+                                glm::mat4* out,
+                                size_t count);
+  static void ComputeNormalMatrices(Kernel kernel, const glm::mat4* model, glm::mat3* out, size_t count);
+
+  /**
+   *  @returns the fastest kernel supported by this CPU.
+   */
+  static Kernel GetBestKernel();
+};
+
+}
+}
+
+#endif  // MATRIX_BATCH_H_
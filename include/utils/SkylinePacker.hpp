@@ -0,0 +1,74 @@
+#ifndef SKYLINE_PACKER_H_
+#define SKYLINE_PACKER_H_
+
+#include <glm/glm.hpp>
+
+#include <cinttypes>
+#include <vector>
+
+namespace monkeysworld {
+namespace utils {
+
+/**
+ *  Packs rectangles into a fixed area, for building atlases.
+ *
+ *  Tracks the "skyline" -- the top edge of everything placed so far -- as a list of segments,
+ *  and puts each new rectangle wherever its top edge would end up lowest, favoring the left.
+ *  Space under the skyline which can't be reached from above is lost, which is what keeps it
+ *  cheap: an insert costs the number of segments, not the number of rectangles.
+ *
+ *  Rectangles can't be removed one by one. Once everything in an area is unused, Clear it.
+ */
+class SkylinePacker {
+ public:
+  /**
+   *  Creates a packer for an empty area.
+   *  @param size - width and height of the area.
+   */
+  SkylinePacker(glm::ivec2 size);
+
+  /**
+   *  Finds room for a rectangle.
+   *  @param size - width and height of the rectangle.
+   *  @param origin - output param for the rectangle's lower left corner.
+   *  @returns true if the rectangle fit, false otherwise.
+   */
+  bool Insert(glm::ivec2 size, glm::ivec2* origin);
+
+  /**
+   *  Empties the area.
+   */
+  void Clear();
+
+  /**
+   *  @returns the size of the area.
+   */
+  glm::ivec2 GetSize() const;
+
+  /**
+   *  @returns the area covered by rectangles placed since the last Clear, in pixels.
+   */
+  uint64_t GetUsedArea() const;
+
+ private:
+  struct segment {
+    int x;
+    int y;                                  // height of the skyline along this segment
+    int width;
+  };
+
+  /**
+   *  Finds how high a rectangle would sit if its left edge lined up with a segment.
+   *  @returns the bottom of the rectangle, or -1 if it runs off the area.
+   */
+  int Fit(size_t index, glm::ivec2 size) const;
+
+  glm::ivec2 size_;
+  uint64_t used_;
+  std::vector<segment> skyline_;
+};
+
+}
+}
+
+#endif  // SKYLINE_PACKER_H_
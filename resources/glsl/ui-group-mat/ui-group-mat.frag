@@ -1,27 +1,27 @@
 #version 430 core
 
-#define TEXTURES_PER_CALL 4
+#define MAX_TEXTURES 16
 
 precision mediump float;
 
-layout(location = 0) uniform sampler2D textures[4];
-layout(location = 4) uniform float opacities[4];
+layout(location = 0) uniform sampler2D textures[MAX_TEXTURES];
 
 layout(location = 0) in vec2 v_tex;
-layout(location = 1) in float v_ind;
+layout(location = 1) flat in int v_slot;
+layout(location = 2) flat in float v_opacity;
 
 layout(location = 0) out vec4 fragColor;
 
 void main() {
+  // samplers can't be indexed by an input, but they can be by a loop counter.
+  // textureLod, since derivatives aren't defined inside the branch
   vec4 result = vec4(0);
-  vec4 tex_content;
-  for (int i = 0; i < TEXTURES_PER_CALL; i++) {
-    tex_content = texture(textures[i], v_tex);
-    if (int(v_ind) == i) {
-      tex_content.a = tex_content.a * opacities[i];
-      result += tex_content;
+  for (int i = 0; i < MAX_TEXTURES; i++) {
+    if (i == v_slot) {
+      result = textureLod(textures[i], v_tex, 0.0);
     }
   }
 
+  result.a = result.a * v_opacity;
   fragColor = result;
-}
\ No newline at end of file
+}
@@ -2,15 +2,21 @@
 
 precision mediump float;
 
-layout(location = 0) in vec2 a_pos;
-layout(location = 1) in vec2 a_tex;
-layout(location = 2) in float a_ind;
+// one instance per child
+layout(location = 0) in vec4 a_rect;
+layout(location = 1) in vec4 a_tex;
+layout(location = 2) in float a_opacity;
+layout(location = 3) in float a_slot;
 
 layout(location = 0) out vec2 v_tex;
-layout(location = 1) out float v_ind;
+layout(location = 1) flat out int v_slot;
+layout(location = 2) flat out float v_opacity;
 
 void main() {
-  v_ind = a_ind;
-  v_tex = a_tex;
-  gl_Position = vec4(a_pos, 0.0, 1.0);
-}
\ No newline at end of file
+  // drawn as a strip: lower left, lower right, upper left, upper right
+  vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+  v_tex = mix(a_tex.xy, a_tex.zw, corner);
+  v_slot = int(a_slot);
+  v_opacity = a_opacity;
+  gl_Position = vec4(mix(a_rect.xy, a_rect.zw, corner), 0.0, 1.0);
+}
@@ -13,10 +13,11 @@ using engine::Context;
 GameCamera::GameCamera(Context* ctx) : GameObject(ctx) {
   fov_deg_ = 45.0f;
   active_ = false;
+  SetLocalBounds(utils::EmptyBounds());
 }
 
 void GameCamera::Accept(Visitor& v) {
-  v.Visit(std::dynamic_pointer_cast<GameCamera>(this->shared_from_this()));
+  v.Visit(std::static_pointer_cast<GameCamera>(this->shared_from_this()));
 }
 
 // Problem: skybox requires view separate from perspective, so that we can separate one from the other
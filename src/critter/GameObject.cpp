@@ -3,6 +3,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/euler_angles.hpp>
+#include <algorithm>
 #include <memory>
 
 #include <boost/log/trivial.hpp>
@@ -16,23 +17,43 @@ using utils::IDGenerator;
 using critter::visitor::ActiveCameraFindVisitor;
 using engine::Context;
 
+/**
+ *  @returns the hierarchy which objects in `ctx` store their transforms in.
+ *           Objects without a context (mostly in tests) share one.
+ */
+static std::shared_ptr<TransformHierarchy> GetContextHierarchy(Context* ctx) {
+  if (ctx != nullptr) {
+    return ctx->GetTransformHierarchy();
+  }
+
+  static std::shared_ptr<TransformHierarchy> default_transforms = std::make_shared<TransformHierarchy>();
+  return default_transforms;
+}
+
 GameObject::GameObject() : GameObject(nullptr) { }
 
 GameObject::GameObject(Context* ctx) : Object(ctx) {
   this->parent_ = std::weak_ptr<GameObject>();
-  this->dirty_ = true;
-  this->position = glm::vec3(0);
-  this->rotation = glm::vec3(0);
-  this->scale = glm::vec3(1);
+  transforms_ = GetContextHierarchy(ctx);
+  transform_ = CreateTransform(transforms_);
+}
+
+GameObject::~GameObject() {
+  // children can outlive us if someone else holds onto them -- they become roots
+  for (auto& child : children_) {
+    transforms_->SetParent(child->transform_, TransformHierarchy::NONE);
+  }
+
+  transforms_->Destroy(transform_);
 }
 
 void GameObject::Accept(Visitor& v) {
-  v.Visit(std::dynamic_pointer_cast<GameObject>(this->shared_from_this()));
+  v.Visit(this->shared_from_this());
 }
 
 void GameObject::AddChild(std::shared_ptr<GameObject> child) {
   // if the child is a parent (direct or indirect) this will fail.
-  if (child->GetChild(this->GetId()) != NULL) {
+  if (child.get() == this || HasAncestor(child.get())) {
     return;
   }
 
@@ -45,28 +66,18 @@ void GameObject::AddChild(std::shared_ptr<GameObject> child) {
   }
 
   child->parent_ = std::weak_ptr<GameObject>(this->shared_from_this());
+  if (child->transforms_ != transforms_) {
+    child->SetTransformHierarchy(transforms_);
+  }
+
+  child->Attach(child, GetRegistry());
+  transforms_->SetParent(child->transform_, transform_);
   // child is moved here -- don't want it in multiple locations
   children_.push_back(child);
 }
 
 std::shared_ptr<Object> GameObject::GetChild(uint64_t id) {
-  // direct nesting will probably be common
-  for (auto child : children_) {
-    if (child->GetId() == id) {
-      return child;
-    }
-  }
-
-  // check for multiple nesting levels
-  std::shared_ptr<Object> result;
-  for (auto child : children_) {
-    result = child->GetChild(id);
-    if (result != nullptr) {
-      return result;
-    }
-  }
-
-  return nullptr;
+  return FindDescendant(id);
 }
 
 std::vector<std::shared_ptr<Object>> GameObject::GetChildren() {
@@ -78,78 +89,109 @@ std::vector<std::shared_ptr<Object>> GameObject::GetChildren() {
   return res;
 }
 
+ChildSpan GameObject::GetChildSpan() {
+  return ChildSpan(children_);
+}
+
 std::shared_ptr<Object> GameObject::GetParent() {
   auto temp = parent_.lock();
   return temp;
 }
 
 void GameObject::SetPosition(const glm::vec3& new_pos) {
-  dirty_.store(true, std::memory_order_release);
-  position = new_pos;
+  transforms_->SetPosition(transform_, new_pos);
 }
 
 void GameObject::SetRotation(const glm::vec3& new_rot) {
-  dirty_.store(true, std::memory_order_release);
-  rotation = new_rot;
+  transforms_->SetRotation(transform_, new_rot);
 }
 
 void GameObject::SetScale(const glm::vec3& new_scale) {
-  dirty_.store(true, std::memory_order_release);
-  scale = new_scale;
+  transforms_->SetScale(transform_, new_scale);
 }
 
 glm::mat4 GameObject::GetTransformationMatrix() const {
-  if (dirty_) {
-    // const cast this cache var
-    // the external state does not change, the cache only exists to save some matrix calcs
-    glm::mat4& matrix_cache = const_cast<glm::mat4&>(tf_matrix_cache_);
-    matrix_cache = glm::mat4(1.0);
-    // scales, then rotates, then translates
-    matrix_cache = glm::translate(tf_matrix_cache_, position);
-    matrix_cache *= glm::eulerAngleYXZ(rotation.y, rotation.x, rotation.z);
-    matrix_cache = glm::scale(tf_matrix_cache_, scale);
+  return transforms_->GetWorldMatrix(transform_);
+}
+
+glm::mat3 GameObject::GetNormalMatrix() const {
+  return transforms_->GetNormalMatrix(transform_);
+}
+
+utils::aabb GameObject::GetWorldBounds() const {
+  return transforms_->GetWorldBounds(transform_);
+}
+
+utils::aabb GameObject::GetSubtreeBounds() const {
+  return transforms_->GetSubtreeBounds(transform_);
+}
+
+std::shared_ptr<TransformHierarchy> GameObject::GetTransformHierarchy() const {
+  return transforms_;
+}
+
+void GameObject::SetLocalBounds(const utils::aabb& bounds) {
+  transforms_->SetLocalBounds(transform_, bounds);
+}
+
+void GameObject::SetTransformHierarchy(const std::shared_ptr<TransformHierarchy>& transforms) {
+  TransformHierarchy::handle handle = CreateTransform(transforms);
+  transforms->SetPosition(handle, GetPosition());
+  transforms->SetRotation(handle, GetRotation());
+  transforms->SetScale(handle, GetScale());
+  transforms->SetLocalBounds(handle, transforms_->GetLocalBounds(transform_));
+  transforms_->Destroy(transform_);
+  transforms_ = transforms;
+  transform_ = handle;
+
+  for (auto& child : children_) {
+    child->SetTransformHierarchy(transforms);
+    transforms_->SetParent(child->transform_, transform_);
   }
+}
 
-  if (auto parent = parent_.lock()) {
-    return parent->GetTransformationMatrix() * tf_matrix_cache_;
+TransformHierarchy::handle GameObject::CreateTransform(const std::shared_ptr<TransformHierarchy>& transforms) {
+  if (TransformReservation* reservation = GetTransformReservation()) {
+    return reservation->Create(transforms, this);
   }
 
-  return tf_matrix_cache_;
+  return transforms->Create(this);
 }
 
 void GameObject::RemoveChild(uint64_t id) {
-  for (auto ptr = children_.begin(); ptr != children_.end(); ptr++) {
-    if ((*ptr)->GetId() == id) {
-      children_.erase(ptr);
-      return;
-    }
+  auto child = std::static_pointer_cast<GameObject>(GetChild(id));
+  if (!child) {
+    return;
   }
 
-  // check descendants
-  for (auto child : children_) {
-    child->RemoveChild(id);
-  }
+  // anything under us has a parent
+  auto parent = child->parent_.lock();
+  auto& siblings = parent->children_;
+  siblings.erase(std::find(siblings.begin(), siblings.end(), child));
+  child->parent_ = std::weak_ptr<GameObject>();
+  transforms_->SetParent(child->transform_, TransformHierarchy::NONE);
 }
 
 const glm::vec3& GameObject::GetRotation() const {
-  return rotation;
+  return transforms_->GetRotation(transform_);
 }
 
 const glm::vec3& GameObject::GetPosition() const {
-  return position;
+  return transforms_->GetPosition(transform_);
 }
 const glm::vec3& GameObject::GetScale() const {
-  return scale;
+  return transforms_->GetScale(transform_);
 }
 
 // superctor for gameobject :)
-GameObject::GameObject(const GameObject& other) : Object(other) {
-  position = other.position;
-  rotation = other.rotation;
-  scale = other.scale;
+GameObject::GameObject(const GameObject& other) : Object(other), transforms_(other.transforms_) {
+  transform_ = CreateTransform(transforms_);
+  SetPosition(other.GetPosition());
+  SetRotation(other.GetRotation());
+  SetScale(other.GetScale());
+  SetLocalBounds(transforms_->GetLocalBounds(other.transform_));
 
   parent_ = std::weak_ptr<GameObject>();
-  dirty_ = true;
 
   // deep copy the children
   for (auto child : other.children_) {
@@ -158,32 +200,37 @@ GameObject::GameObject(const GameObject& other) : Object(other) {
   }
 }
 
-GameObject::GameObject(GameObject&& other) : Object(other) {
-  position = std::move(other.position);
-  rotation = std::move(other.rotation);
-  scale = std::move(other.scale);
+GameObject::GameObject(GameObject&& other) : Object(other), transforms_(other.transforms_) {
+  // other still needs a transform of its own, so this is no cheaper than a copy
+  transform_ = CreateTransform(transforms_);
+  SetPosition(other.GetPosition());
+  SetRotation(other.GetRotation());
+  SetScale(other.GetScale());
+  SetLocalBounds(transforms_->GetLocalBounds(other.transform_));
 
   if (auto other_parent = other.parent_.lock()) {
     other_parent->RemoveChild(other.GetId());
     other_parent->AddChild(shared_from_this());
   }
 
-  dirty_ = true;
-
   // cannot copy over parent/child relationship
   // if for some reason this occurs: must rebind the parent
 
   children_ = std::move(other.children_);
+  for (auto& child : children_) {
+    transforms_->SetParent(child->transform_, transform_);
+  }
 }
 
 GameObject& GameObject::operator=(const GameObject& other) {
   Object::operator=(other);
-  position = other.position;
-  rotation = other.rotation;
-  scale = other.scale;
+  SetPosition(other.GetPosition());
+  SetRotation(other.GetRotation());
+  SetScale(other.GetScale());
+  SetLocalBounds(other.transforms_->GetLocalBounds(other.transform_));
 
   parent_ = std::weak_ptr<GameObject>();
-  dirty_ = true;
+  transforms_->SetParent(transform_, TransformHierarchy::NONE);
 
   for (auto child : other.children_) {
     AddChild(child);
@@ -194,22 +241,34 @@ GameObject& GameObject::operator=(const GameObject& other) {
 
 GameObject& GameObject::operator=(GameObject&& other) {
   Object::operator=(other);
-  position = std::move(other.position);
-  rotation = std::move(other.rotation);
-  scale = std::move(other.scale);
+  SetPosition(other.GetPosition());
+  SetRotation(other.GetRotation());
+  SetScale(other.GetScale());
+  SetLocalBounds(other.transforms_->GetLocalBounds(other.transform_));
 
   if (auto other_parent = other.parent_.lock()) {
     other_parent->RemoveChild(other.GetId());
     other_parent->AddChild(shared_from_this());
   }
 
-  dirty_ = true;
+  for (auto& child : children_) {
+    transforms_->SetParent(child->transform_, TransformHierarchy::NONE);
+  }
 
   children_ = std::move(other.children_);
+  for (auto& child : children_) {
+    if (child->transforms_ != transforms_) {
+      child->SetTransformHierarchy(transforms_);
+    }
+
+    transforms_->SetParent(child->transform_, transform_);
+  }
 
   return *this;
 }
 
+void GameObject::SyncRenderState() { }
+
 std::shared_ptr<Camera> GameObject::GetActiveCamera() {
   std::shared_ptr<GameObject> parent;
   if ((parent = std::dynamic_pointer_cast<GameObject>(GetParent())) != nullptr) {
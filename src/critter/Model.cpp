@@ -86,10 +86,13 @@ static data_type GetDataType(const std::string& line);
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-Model::Model(Context* ctx) : GameObject(ctx) {}
+Model::Model(Context* ctx) : GameObject(ctx) {
+  SetLocalBounds(utils::EmptyBounds());
+}
 
 void Model::SetMesh(const std::shared_ptr<const model::Mesh<>>& mesh) {
   mesh_ = mesh;
+  SetLocalBounds(mesh_ != nullptr ? mesh_->GetBounds() : utils::EmptyBounds());
 }
 
 std::shared_ptr<const Mesh<>> Model::GetMesh() {
@@ -1,13 +1,32 @@
 #include <critter/Object.hpp>
+#include <critter/TransformHierarchy.hpp>
 #include <critter/Visitor.hpp>
 
 namespace monkeysworld {
 namespace critter {
 
+/**
+ *  @returns the registry which objects in `ctx` are listed in.
+ *           Objects without a context (mostly in tests) share one.
+ */
+static std::shared_ptr<ObjectRegistry> GetContextRegistry(engine::Context* ctx) {
+  if (ctx != nullptr) {
+    return ctx->GetObjectRegistry();
+  }
+
+  static std::shared_ptr<ObjectRegistry> default_registry = std::make_shared<ObjectRegistry>();
+  return default_registry;
+}
+
 utils::IDGenerator Object::id_generator_;
+thread_local Object::IdBlockScope* Object::id_block_scope_ = nullptr;
+
+// nothing can find an object until it's attached, so that's when it joins the registry
 Object::Object(engine::Context* ctx) {
   ctx_ = ctx;
-  id_ = id_generator_.GetUniqueId();
+  id_ = GetNextId();
+  registry_ = GetContextRegistry(ctx);
+  registered_ = false;
 }
 
 uint64_t Object::GetId() {
@@ -16,7 +35,14 @@ uint64_t Object::GetId() {
 
 void Object::SetId(uint64_t new_id) {
   id_generator_.RegisterUniqueId(new_id);
+  if (!registered_) {
+    id_ = new_id;
+    return;
+  }
+
+  auto ref = Unregister();
   id_ = new_id;
+  Register(ref);
 }
 
 engine::Context* Object::GetContext() const {
@@ -35,30 +61,187 @@ void Object::Destroy() {
   // noop
 }
 
+bool Object::IsUpdateThreadSafe() {
+  return false;
+}
+
+std::shared_ptr<Object> Object::FindDescendant(uint64_t id) {
+  // walked outside of the registry's lock -- a parent may be the last thing holding its child
+  std::vector<std::shared_ptr<Object>> candidates;
+  FlushScopedRegistrations();
+  registry_->Find(id, &candidates);
+  for (auto& candidate : candidates) {
+    if (candidate->HasAncestor(this)) {
+      return candidate;
+    }
+  }
+
+  return nullptr;
+}
+
+bool Object::HasAncestor(Object* object) {
+  for (auto parent = GetParent(); parent; parent = parent->GetParent()) {
+    if (parent.get() == object) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+std::shared_ptr<ObjectRegistry> Object::GetRegistry() const {
+  return registry_;
+}
+
+void Object::SetRegistry(std::shared_ptr<ObjectRegistry> registry) {
+  if (registry == registry_) {
+    return;
+  }
+
+  if (registered_) {
+    auto ref = Unregister();
+    registry_ = registry;
+    Register(ref);
+  } else {
+    registry_ = registry;
+  }
+
+  for (Object* child : GetChildSpan()) {
+    child->SetRegistry(registry);
+  }
+}
+
+void Object::Attach(const std::shared_ptr<Object>& self, std::shared_ptr<ObjectRegistry> registry) {
+  SetRegistry(registry);
+  Unregister();
+  Register(self);
+}
+
+void Object::Register(const std::weak_ptr<Object>& ref) {
+  registered_ = true;
+  if (id_block_scope_ != nullptr) {
+    id_block_scope_->QueueRegistration(registry_, this, id_, ref);
+  } else {
+    registry_->Register(this, id_, ref);
+  }
+}
+
+std::weak_ptr<Object> Object::Unregister() {
+  if (!registered_) {
+    return std::weak_ptr<Object>();
+  }
+
+  // we may still be queued -- hand the queue over first, so we aren't added back afterwards
+  FlushScopedRegistrations();
+  registered_ = false;
+  return registry_->Unregister(this, id_);
+}
+
+// copies and moves have no owner of their own yet -- like new objects, they're registered once attached
+
 Object::Object(const Object& other) {
-  id_ = id_generator_.GetUniqueId();
+  id_ = GetNextId();
   ctx_ = other.ctx_;
+  registry_ = other.registry_;
+  registered_ = false;
 }
 
 Object& Object::operator=(const Object& other) {
-  id_ = id_generator_.GetUniqueId();
+  Unregister();
+  id_ = GetNextId();
   ctx_ = other.ctx_;
+  SetRegistry(other.registry_);
   return *this;
 }
 
 Object::Object(Object&& other) {
   id_ = other.id_;
-  other.id_ = 0;
   ctx_ = other.ctx_;
+  registry_ = other.registry_;
+  registered_ = false;
+  other.Unregister();
+  other.id_ = 0;
 }
 
 Object& Object::operator=(Object&& other) {
+  Unregister();
   id_ = other.id_;
-  other.id_ = 0;
   ctx_ = other.ctx_;
+  other.Unregister();
+  other.id_ = 0;
+  SetRegistry(other.registry_);
 
   return *this;
 }
 
+Object::~Object() {
+  Unregister();
+}
+
+uint64_t Object::GetNextId() {
+  IdBlockScope* scope = id_block_scope_;
+  if (scope == nullptr) {
+    return id_generator_.GetUniqueId();
+  }
+
+  if (scope->block_.first == scope->block_.end) {
+    scope->block_ = id_generator_.GetUniqueIds(scope->block_size_);
+  }
+
+  return scope->block_.first++;
+}
+
+TransformReservation* Object::GetTransformReservation() {
+  IdBlockScope* scope = id_block_scope_;
+  if (scope == nullptr) {
+    return nullptr;
+  }
+
+  if (!scope->transforms_) {
+    scope->transforms_ = std::make_unique<TransformReservation>(scope->block_size_);
+  }
+
+  return scope->transforms_.get();
+}
+
+void Object::FlushScopedRegistrations() {
+  for (IdBlockScope* scope = id_block_scope_; scope != nullptr; scope = scope->prev_) {
+    scope->FlushRegistrations();
+  }
+}
+
+Object::IdBlockScope::IdBlockScope(uint64_t block_size) {
+  block_size_ = block_size;
+  block_ = { 0, 0 };
+  prev_ = id_block_scope_;
+  id_block_scope_ = this;
+}
+
+void Object::IdBlockScope::QueueRegistration(const std::shared_ptr<ObjectRegistry>& registry,
+                                             Object* object, uint64_t id, const std::weak_ptr<Object>& ref) {
+  if (registry != registry_) {
+    FlushRegistrations();
+    registry_ = registry;
+  }
+
+  registrations_.push_back({ object, id, ref });
+  if (registrations_.size() >= block_size_) {
+    FlushRegistrations();
+  }
+}
+
+void Object::IdBlockScope::FlushRegistrations() {
+  if (!registrations_.empty()) {
+    registry_->Register(registrations_.data(), registrations_.size());
+    registrations_.clear();
+  }
+}
+
+Object::IdBlockScope::~IdBlockScope() {
+  FlushRegistrations();
+  transforms_.reset();
+  id_block_scope_ = prev_;
+}
+
+}
 }
-}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include <critter/ObjectRegistry.hpp>
+
+namespace monkeysworld {
+namespace critter {
+
+void ObjectRegistry::Register(Object* object, uint64_t id, std::weak_ptr<Object> ref) {
+  if (id == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(lock_);
+  objects_.emplace(id, entry { object, std::move(ref) });
+}
+
+void ObjectRegistry::Register(const registration* entries, size_t count) {
+  std::lock_guard<std::mutex> lock(lock_);
+  for (size_t i = 0; i < count; i++) {
+    // checked under the lock: an object which expires after this point
+    // unregisters itself once we're done, and finds its entry
+    if (entries[i].id == 0 || entries[i].ref.expired()) {
+      continue;
+    }
+
+    objects_.emplace(entries[i].id, entry { entries[i].object, entries[i].ref });
+  }
+}
+
+std::weak_ptr<Object> ObjectRegistry::Unregister(Object* object, uint64_t id) {
+  if (id == 0) {
+    return std::weak_ptr<Object>();
+  }
+
+  std::weak_ptr<Object> res;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto range = objects_.equal_range(id);
+    for (auto itr = range.first; itr != range.second; itr++) {
+      if (itr->second.object == object) {
+        res = std::move(itr->second.ref);
+        objects_.erase(itr);
+        break;
+      }
+    }
+  }
+
+  return res;
+}
+
+void ObjectRegistry::Find(uint64_t id, std::vector<std::shared_ptr<Object>>* out) const {
+  out->clear();
+  std::lock_guard<std::mutex> lock(lock_);
+  auto range = objects_.equal_range(id);
+  for (auto itr = range.first; itr != range.second; itr++) {
+    // fails if the object is being destroyed -- it's as good as gone
+    if (auto object = itr->second.ref.lock()) {
+      out->push_back(std::move(object));
+    }
+  }
+}
+
+size_t ObjectRegistry::GetSize() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return objects_.size();
+}
+
+}
+}
@@ -0,0 +1,147 @@
+#include <critter/ParallelUpdater.hpp>
+
+#include <algorithm>
+
+namespace monkeysworld {
+namespace critter {
+
+// subtrees walked by a single job. updates are assumed to be heavy enough that
+// a handful of subtrees outweighs the cost of queueing a job.
+static const size_t JOB_SUBTREES = 16;
+
+// objects with more children than this have them split into separate jobs
+static const size_t SPLIT_CHILDREN = 2 * JOB_SUBTREES;
+
+// each thread walks its jobs with its own walker, so that walks don't allocate once warm
+static thread_local SceneWalker tl_walker;
+
+ParallelUpdater::ParallelUpdater(std::shared_ptr<file::LoaderThreadPool> pool) : pool_(pool),
+                                                                                  outstanding_(0),
+                                                                                  job_count_(0) { }
+
+void ParallelUpdater::Schedule(Object* root) {
+  roots_.push_back(root);
+}
+
+bool ParallelUpdater::HasScheduled() const {
+  return !roots_.empty();
+}
+
+size_t ParallelUpdater::GetLastJobCount() const {
+  return job_count_.load();
+}
+
+void ParallelUpdater::Run() {
+  job_count_ = 0;
+  if (pool_ == nullptr || pool_->GetThreadCount() == 0) {
+    // nobody to share with -- everything beneath the roots is updated here, in order
+    try {
+      for (auto root : roots_) {
+        walker_.Walk(root, [](Object* o) {
+          o->Update();
+        });
+      }
+    } catch (...) {
+      roots_.clear();
+      throw;
+    }
+
+    roots_.clear();
+    return;
+  }
+
+  Submit(nullptr, 0, roots_.size());
+
+  // help out until the queues run dry, then wait for whatever's still running
+  while (outstanding_.load() > 0) {
+    if (!pool_->RunPendingTask()) {
+      std::unique_lock<std::mutex> lock(done_lock_);
+      done_cond_.wait(lock, [&] {
+        return (outstanding_.load() == 0);
+      });
+    }
+  }
+
+  {
+    // the last job may still be on its way out of FinishJob
+    std::lock_guard<std::mutex> lock(done_lock_);
+  }
+
+  // jobs are finished, so no more locking
+  std::exception_ptr error;
+  try {
+    for (auto object : deferred_) {
+      walker_.Walk(object, [](Object* o) {
+        o->Update();
+      });
+    }
+  } catch (...) {
+    // a job's exception came first, so it wins
+    error = std::current_exception();
+  }
+
+  if (error_) {
+    error = error_;
+  }
+
+  roots_.clear();
+  deferred_.clear();
+  error_ = nullptr;
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void ParallelUpdater::Submit(Object* parent, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i += JOB_SUBTREES) {
+    job j = { parent, i, std::min(end, i + JOB_SUBTREES) };
+    outstanding_++;
+    job_count_++;
+    pool_->AddTaskToQueue([this, j] {
+      try {
+        RunJob(j);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(deferred_lock_);
+        if (!error_) {
+          error_ = std::current_exception();
+        }
+      }
+
+      FinishJob();
+    }, file::PRIORITY_HIGH);
+  }
+}
+
+void ParallelUpdater::RunJob(const job& j) {
+  for (size_t i = j.begin; i < j.end; i++) {
+    Object* root = (j.parent == nullptr ? roots_[i] : j.parent->GetChildSpan()[i]);
+    tl_walker.Walk(root, [this](Object* o) {
+      if (!o->IsUpdateThreadSafe()) {
+        std::lock_guard<std::mutex> lock(deferred_lock_);
+        deferred_.push_back(o);
+        return WALK_SKIP_CHILDREN;
+      }
+
+      o->Update();
+      size_t children = o->GetChildSpan().GetSize();
+      if (children > SPLIT_CHILDREN) {
+        // our children are ready to go -- let other workers share them
+        Submit(o, 0, children);
+        return WALK_SKIP_CHILDREN;
+      }
+
+      return WALK_CONTINUE;
+    });
+  }
+}
+
+void ParallelUpdater::FinishJob() {
+  // decrement under the lock, so that Run can't return while we're still notifying
+  std::lock_guard<std::mutex> lock(done_lock_);
+  if (--outstanding_ == 0) {
+    done_cond_.notify_all();
+  }
+}
+
+}
+}
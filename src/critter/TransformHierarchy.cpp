@@ -0,0 +1,574 @@
+#include <critter/TransformHierarchy.hpp>
+#include <utils/MatrixBatch.hpp>
+
+#include <algorithm>
+#include <type_traits>
+
+namespace monkeysworld {
+namespace critter {
+
+const TransformHierarchy::handle TransformHierarchy::NONE;
+
+TransformHierarchy::TransformHierarchy() : indexed_(false), dead_(0), order_dirty_(false), subtrees_dirty_(false), pending_(false) { }
+
+TransformHierarchy::handle TransformHierarchy::Create(GameObject* owner) {
+  std::lock_guard<std::mutex> lock(structure_lock_);
+  handle res = CreateLocked();
+  owner_[res] = owner;
+  return res;
+}
+
+void TransformHierarchy::Create(size_t count, node_owner* nodes) {
+  std::lock_guard<std::mutex> lock(structure_lock_);
+  for (size_t i = 0; i < count; i++) {
+    handle node = CreateLocked();
+    nodes[i] = { node, generation_[node], nullptr };
+  }
+}
+
+TransformHierarchy::handle TransformHierarchy::CreateLocked() {
+  handle res;
+  if (!free_handles_.empty()) {
+    res = free_handles_.back();
+    free_handles_.pop_back();
+  } else {
+    res = static_cast<handle>(index_.size());
+    index_.push_back(NONE);
+    owner_.push_back(nullptr);
+    generation_.push_back(0);
+    proxy_.push_back(utils::BoundingVolumeTree::NULL_NODE);
+    index_queued_.push_back(0);
+  }
+
+  // new roots go on the end -- roots can sit anywhere, so order is preserved
+  index_[res] = static_cast<uint32_t>(handle_.size());
+  handle_.push_back(res);
+  parent_.push_back(NONE);
+  position_.push_back(glm::vec3(0));
+  rotation_.push_back(glm::vec3(0));
+  scale_.push_back(glm::vec3(1));
+  local_.push_back(glm::mat4(1.0));
+  world_.push_back(glm::mat4(1.0));
+  normal_.push_back(glm::mat3(1.0));
+  dirty_.push_back(0);
+  changed_.push_back(0);
+  local_bounds_.push_back(utils::InfiniteBounds());
+  world_bounds_.push_back(utils::InfiniteBounds());
+  subtree_bounds_.push_back(utils::InfiniteBounds());
+  return res;
+}
+
+void TransformHierarchy::Destroy(handle node) {
+  std::lock_guard<std::mutex> lock(structure_lock_);
+  DestroyLocked(node);
+}
+
+void TransformHierarchy::Destroy(const node_owner* nodes, size_t count) {
+  std::lock_guard<std::mutex> lock(structure_lock_);
+  for (size_t i = 0; i < count; i++) {
+    if (generation_[nodes[i].node] == nodes[i].generation) {
+      DestroyLocked(nodes[i].node);
+    }
+  }
+}
+
+void TransformHierarchy::DestroyLocked(handle node) {
+  uint32_t i = index_[node];
+  handle_[i] = NONE;
+  parent_[i] = NONE;
+  dirty_[i] = 0;
+  index_[node] = NONE;
+  owner_[node] = nullptr;
+  generation_[node]++;
+  if (proxy_[node] != utils::BoundingVolumeTree::NULL_NODE) {
+    spatial_index_.DestroyProxy(proxy_[node]);
+    proxy_[node] = utils::BoundingVolumeTree::NULL_NODE;
+  }
+
+  free_handles_.push_back(node);
+  dead_++;
+  // the node's old parent may have been relying on it for its subtree bounds
+  subtrees_dirty_ = true;
+  pending_ = true;
+}
+
+void TransformHierarchy::SetParent(handle node, handle parent) {
+  std::lock_guard<std::mutex> lock(structure_lock_);
+  uint32_t i = index_[node];
+  uint32_t p = (parent == NONE ? NONE : index_[parent]);
+  parent_[i] = p;
+  dirty_[i] |= DIRTY_WORLD;
+  pending_ = true;
+  // descendants of `node` already follow it, so only the node itself can end up out of order
+  if (p != NONE && p > i) {
+    order_dirty_ = true;
+  }
+}
+
+TransformHierarchy::handle TransformHierarchy::GetParent(handle node) const {
+  uint32_t p = parent_[index_[node]];
+  return (p == NONE ? NONE : handle_[p]);
+}
+
+void TransformHierarchy::SetPosition(handle node, const glm::vec3& position) {
+  uint32_t i = index_[node];
+  position_[i] = position;
+  dirty_[i] |= DIRTY_LOCAL;
+  // relaxed is enough: whoever runs the next pass has already synchronized with the writers
+  pending_.store(true, std::memory_order_relaxed);
+}
+
+void TransformHierarchy::SetRotation(handle node, const glm::vec3& rotation) {
+  uint32_t i = index_[node];
+  rotation_[i] = rotation;
+  dirty_[i] |= DIRTY_LOCAL;
+  pending_.store(true, std::memory_order_relaxed);
+}
+
+void TransformHierarchy::SetScale(handle node, const glm::vec3& scale) {
+  uint32_t i = index_[node];
+  scale_[i] = scale;
+  dirty_[i] |= DIRTY_LOCAL;
+  pending_.store(true, std::memory_order_relaxed);
+}
+
+void TransformHierarchy::SetLocalBounds(handle node, const utils::aabb& bounds) {
+  uint32_t i = index_[node];
+  local_bounds_[i] = bounds;
+  dirty_[i] |= DIRTY_BOUNDS;
+  pending_ = true;
+}
+
+const utils::aabb& TransformHierarchy::GetLocalBounds(handle node) const {
+  return local_bounds_[index_[node]];
+}
+
+const glm::vec3& TransformHierarchy::GetPosition(handle node) const {
+  return position_[index_[node]];
+}
+
+const glm::vec3& TransformHierarchy::GetRotation(handle node) const {
+  return rotation_[index_[node]];
+}
+
+const glm::vec3& TransformHierarchy::GetScale(handle node) const {
+  return scale_[index_[node]];
+}
+
+const glm::mat4& TransformHierarchy::GetWorldMatrix(handle node) {
+  bool stale;
+  return world_[ResolveChain(node, &stale)];
+}
+
+const glm::mat3& TransformHierarchy::GetNormalMatrix(handle node) {
+  bool stale;
+  uint32_t i = ResolveChain(node, &stale);
+  if (stale) {
+    utils::MatrixBatch::ComputeNormalMatrices(&world_[i], &normal_[i], 1);
+  }
+
+  return normal_[i];
+}
+
+const utils::aabb& TransformHierarchy::GetWorldBounds(handle node) {
+  bool stale;
+  uint32_t i = ResolveChain(node, &stale);
+  if (stale || (dirty_[i] & DIRTY_BOUNDS)) {
+    world_bounds_[i] = utils::TransformBounds(local_bounds_[i], world_[i]);
+  }
+
+  return world_bounds_[i];
+}
+
+const utils::aabb& TransformHierarchy::GetSubtreeBounds(handle node) {
+  // merging subtrees means visiting everything -- that's what the pass is for
+  return subtree_bounds_[index_[node]];
+}
+
+uint32_t TransformHierarchy::ResolveChain(handle node, bool* stale) {
+  *stale = false;
+  if (!pending_) {
+    return index_[node];
+  }
+
+  if (order_dirty_) {
+    // parents may follow their children, so walking up isn't safe
+    Update();
+    return index_[node];
+  }
+
+  // walk up to the root, noting the highest node whose transform was edited
+  uint32_t i = index_[node];
+  size_t top = 0;
+  chain_.clear();
+  for (uint32_t j = i; j != NONE; j = parent_[j]) {
+    chain_.push_back(j);
+    if (dirty_[j] & (DIRTY_LOCAL | DIRTY_WORLD)) {
+      top = chain_.size();
+    }
+
+    if (parent_[j] != NONE && parent_[j] >= j) {
+      // a parent which doesn't precede its child -- leave it to the pass
+      Update();
+      return index_[node];
+    }
+  }
+
+  for (size_t k = top; k-- > 0;) {
+    uint32_t j = chain_[k];
+    if (dirty_[j] & DIRTY_LOCAL) {
+      utils::MatrixBatch::ComposeTransforms(&position_[j], &rotation_[j], &scale_[j], &local_[j], 1);
+    }
+
+    uint32_t p = parent_[j];
+    world_[j] = (p != NONE ? world_[p] * local_[j] : local_[j]);
+  }
+
+  *stale = (top > 0);
+  return i;
+}
+
+void TransformHierarchy::SetOwner(handle node, GameObject* owner) {
+  std::lock_guard<std::mutex> lock(structure_lock_);
+  owner_[node] = owner;
+}
+
+void TransformHierarchy::SetOwners(const node_owner* owners, size_t count) {
+  std::lock_guard<std::mutex> lock(structure_lock_);
+  for (size_t i = 0; i < count; i++) {
+    if (generation_[owners[i].node] == owners[i].generation) {
+      owner_[owners[i].node] = owners[i].owner;
+    }
+  }
+}
+
+GameObject* TransformHierarchy::GetOwner(handle node) const {
+  return owner_[node];
+}
+
+const utils::BoundingVolumeTree& TransformHierarchy::GetSpatialIndex() {
+  SyncIndex();
+  return spatial_index_;
+}
+
+GameObject* TransformHierarchy::RayCast(const utils::ray& r, float max_distance, float* distance) {
+  handle nearest = NONE;
+  float nearest_t = max_distance;
+  GetSpatialIndex().RayCast(r, max_distance, [&](uint32_t node, float t) {
+    if (t < nearest_t || nearest == NONE) {
+      nearest = node;
+      nearest_t = t;
+    }
+
+    return nearest_t;
+  });
+
+  if (nearest == NONE) {
+    return nullptr;
+  }
+
+  if (distance != nullptr) {
+    *distance = nearest_t;
+  }
+
+  return owner_[nearest];
+}
+
+size_t TransformHierarchy::GetSize() const {
+  return handle_.size() - dead_;
+}
+
+void TransformHierarchy::Update() {
+  if (order_dirty_ || dead_ > handle_.size() / 2) {
+    Reorder();
+  }
+
+  if (!pending_) {
+    return;
+  }
+
+  size_t count = handle_.size();
+
+  // local matrices don't depend on one another, so rebuild them first, in batches
+  for (size_t i = 0; i < count;) {
+    if (!(dirty_[i] & DIRTY_LOCAL)) {
+      i++;
+      continue;
+    }
+
+    size_t run = 1;
+    while (i + run < count && (dirty_[i + run] & DIRTY_LOCAL)) {
+      run++;
+    }
+
+    utils::MatrixBatch::ComposeTransforms(&position_[i], &rotation_[i], &scale_[i], &local_[i], run);
+    i += run;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    uint32_t p = parent_[i];
+    bool parent_changed = (p != NONE && changed_[p]);
+    uint8_t dirty = dirty_[i];
+    changed_[i] = 0;
+    if (!dirty && !parent_changed) {
+      continue;
+    }
+
+    if ((dirty & (DIRTY_LOCAL | DIRTY_WORLD)) || parent_changed) {
+      world_[i] = (p != NONE ? world_[p] * local_[i] : local_[i]);
+      changed_[i] = 1;
+    }
+
+    world_bounds_[i] = utils::TransformBounds(local_bounds_[i], world_[i]);
+    dirty_[i] = 0;
+    subtrees_dirty_ = true;
+    if (indexed_) {
+      QueueIndexUpdate(handle_[i]);
+    }
+  }
+
+  // normal matrices for every world matrix which moved
+  for (size_t i = 0; i < count;) {
+    if (!changed_[i]) {
+      i++;
+      continue;
+    }
+
+    size_t run = 1;
+    while (i + run < count && changed_[i + run]) {
+      run++;
+    }
+
+    utils::MatrixBatch::ComputeNormalMatrices(&world_[i], &normal_[i], run);
+    i += run;
+  }
+
+  // children follow their parents, so going backwards merges each subtree before its parent reads it
+  if (subtrees_dirty_) {
+    subtree_bounds_ = world_bounds_;
+    for (size_t i = count; i-- > 0;) {
+      uint32_t p = parent_[i];
+      if (p != NONE) {
+        subtree_bounds_[p] = utils::Merge(subtree_bounds_[p], subtree_bounds_[i]);
+      }
+    }
+
+    subtrees_dirty_ = false;
+  }
+
+  pending_ = false;
+}
+
+void TransformHierarchy::QueueIndexUpdate(handle node) {
+  if (!index_queued_[node]) {
+    index_queued_[node] = 1;
+    index_queue_.push_back(node);
+  }
+}
+
+void TransformHierarchy::SyncIndex() {
+  if (!indexed_) {
+    indexed_ = true;
+    for (auto node : handle_) {
+      if (node != NONE) {
+        QueueIndexUpdate(node);
+      }
+    }
+  }
+
+  if (pending_) {
+    Update();
+  }
+
+  if (index_queue_.empty()) {
+    return;
+  }
+
+  index_moves_.clear();
+  index_new_boxes_.clear();
+  index_new_handles_.clear();
+  for (auto node : index_queue_) {
+    index_queued_[node] = 0;
+    // destroyed since it was queued
+    if (index_[node] == NONE) {
+      continue;
+    }
+
+    const utils::aabb& box = world_bounds_[index_[node]];
+    bool indexable = !utils::IsEmpty(box) && !utils::IsInfinite(box);
+    int& proxy = proxy_[node];
+    if (proxy == utils::BoundingVolumeTree::NULL_NODE) {
+      if (indexable) {
+        index_new_boxes_.push_back(box);
+        index_new_handles_.push_back(node);
+      }
+    } else if (indexable) {
+      index_moves_.push_back({ proxy, box });
+    } else {
+      spatial_index_.DestroyProxy(proxy);
+      proxy = utils::BoundingVolumeTree::NULL_NODE;
+    }
+  }
+
+  index_queue_.clear();
+  spatial_index_.MoveProxies(index_moves_.data(), index_moves_.size());
+  index_new_proxies_.resize(index_new_handles_.size());
+  spatial_index_.CreateProxies(index_new_boxes_.data(), index_new_handles_.data(),
+                               index_new_handles_.size(), index_new_proxies_.data());
+  for (size_t i = 0; i < index_new_handles_.size(); i++) {
+    proxy_[index_new_handles_[i]] = index_new_proxies_[i];
+  }
+}
+
+void TransformHierarchy::Reorder() {
+  static const uint32_t VISITING = NONE - 1;
+  size_t count = handle_.size();
+
+  // depth of each live node. parents are always shallower than their children,
+  // so sorting by depth puts every parent first
+  std::vector<uint32_t> depth(count, NONE);
+  std::vector<uint32_t> chain;
+  std::vector<uint32_t> depth_count;
+  for (uint32_t i = 0; i < count; i++) {
+    if (handle_[i] == NONE || depth[i] != NONE) {
+      continue;
+    }
+
+    // walk up until we reach a node whose depth is known
+    chain.clear();
+    uint32_t j = i;
+    while (j != NONE && handle_[j] != NONE && depth[j] == NONE) {
+      depth[j] = VISITING;
+      chain.push_back(j);
+      j = parent_[j];
+    }
+
+    uint32_t base;
+    if (j == NONE || handle_[j] == NONE || depth[j] == VISITING) {
+      // a root, a destroyed parent, or a cycle -- either way, treat the top of the chain as a root
+      if (j != NONE) {
+        parent_[chain.back()] = NONE;
+        dirty_[chain.back()] |= DIRTY_WORLD;
+        pending_ = true;
+      }
+
+      base = 0;
+    } else {
+      base = depth[j] + 1;
+    }
+
+    for (auto itr = chain.rbegin(); itr != chain.rend(); itr++) {
+      depth[*itr] = base;
+      if (base >= depth_count.size()) {
+        depth_count.resize(base + 1, 0);
+      }
+
+      depth_count[base]++;
+      base++;
+    }
+  }
+
+  // counting sort -- stable, so siblings keep their relative order
+  uint32_t offset = 0;
+  for (auto& c : depth_count) {
+    uint32_t temp = c;
+    c = offset;
+    offset += temp;
+  }
+
+  std::vector<uint32_t> new_index(count, NONE);
+  for (uint32_t i = 0; i < count; i++) {
+    if (handle_[i] != NONE) {
+      new_index[i] = depth_count[depth[i]]++;
+    }
+  }
+
+  size_t live = offset;
+  auto permute = [&](auto& data) {
+    typename std::remove_reference<decltype(data)>::type res(live);
+    for (size_t i = 0; i < count; i++) {
+      if (new_index[i] != NONE) {
+        res[new_index[i]] = data[i];
+      }
+    }
+
+    data.swap(res);
+  };
+
+  for (auto& p : parent_) {
+    p = (p == NONE ? NONE : new_index[p]);
+  }
+
+  permute(handle_);
+  permute(parent_);
+  permute(position_);
+  permute(rotation_);
+  permute(scale_);
+  permute(local_);
+  permute(world_);
+  permute(normal_);
+  permute(dirty_);
+  permute(changed_);
+  permute(local_bounds_);
+  permute(world_bounds_);
+  permute(subtree_bounds_);
+
+  for (uint32_t i = 0; i < live; i++) {
+    index_[handle_[i]] = i;
+  }
+
+  dead_ = 0;
+  order_dirty_ = false;
+}
+
+TransformReservation::TransformReservation(size_t batch_size) : batch_size_(batch_size > 0 ? batch_size : 1) { }
+
+TransformHierarchy::handle TransformReservation::Create(const std::shared_ptr<TransformHierarchy>& transforms,
+                                                        GameObject* owner) {
+  auto r = std::find_if(reserves_.begin(), reserves_.end(), [&transforms](const reserve& other) {
+    return other.transforms == transforms;
+  });
+
+  if (r == reserves_.end()) {
+    reserves_.push_back({ transforms });
+    r = std::prev(reserves_.end());
+  }
+
+  if (r->reserved.empty()) {
+    // a good time to catch up on owners, since we're taking the lock anyway
+    FlushOwners(*r);
+    r->reserved.resize(batch_size_);
+    transforms->Create(batch_size_, r->reserved.data());
+    // handed out from the back -- keep handles in the order they were created
+    std::reverse(r->reserved.begin(), r->reserved.end());
+  }
+
+  TransformHierarchy::node_owner node = r->reserved.back();
+  r->reserved.pop_back();
+  node.owner = owner;
+  r->owners.push_back(node);
+  return node.node;
+}
+
+void TransformReservation::Flush() {
+  for (auto& r : reserves_) {
+    FlushOwners(r);
+    r.transforms->Destroy(r.reserved.data(), r.reserved.size());
+  }
+
+  reserves_.clear();
+}
+
+void TransformReservation::FlushOwners(reserve& r) {
+  if (!r.owners.empty()) {
+    r.transforms->SetOwners(r.owners.data(), r.owners.size());
+    r.owners.clear();
+  }
+}
+
+TransformReservation::~TransformReservation() {
+  Flush();
+}
+
+}
+}
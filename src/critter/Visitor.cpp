@@ -4,10 +4,30 @@ namespace monkeysworld {
 namespace critter {
 
 void Visitor::VisitChildren(std::shared_ptr<Object> o) {
-  for (auto child : o->GetChildren()) {
-    child->Accept(*this);
+  if (walking_) {
+    // picked up by the walk below, once the current Visit returns
+    descend_ = true;
+    return;
   }
+
+  walking_ = true;
+  stop_ = false;
+  walker_.WalkChildren(o.get(), [this](Object* child) {
+    descend_ = false;
+    child->Accept(*this);
+    if (stop_) {
+      return WALK_STOP;
+    }
+
+    return (descend_ ? WALK_CONTINUE : WALK_SKIP_CHILDREN);
+  });
+
+  walking_ = false;
+}
+
+void Visitor::StopVisiting() {
+  stop_ = true;
 }
 
 }
-}
\ No newline at end of file
+}
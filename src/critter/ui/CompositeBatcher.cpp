@@ -0,0 +1,51 @@
+#include <critter/ui/CompositeBatcher.hpp>
+
+#include <algorithm>
+
+namespace monkeysworld {
+namespace critter {
+namespace ui {
+
+CompositeBatcher::CompositeBatcher() : max_textures_(1) { }
+
+void CompositeBatcher::Begin(int max_textures) {
+  max_textures_ = std::max(max_textures, 1);
+  quads_.clear();
+  batches_.clear();
+}
+
+void CompositeBatcher::Add(GLuint texture, composite_quad quad) {
+  composite_batch* batch = (batches_.empty() ? nullptr : &batches_.back());
+  int slot = -1;
+  if (batch != nullptr) {
+    auto itr = std::find(batch->textures.begin(), batch->textures.end(), texture);
+    if (itr != batch->textures.end()) {
+      slot = static_cast<int>(itr - batch->textures.begin());
+    } else if (batch->textures.size() < static_cast<size_t>(max_textures_)) {
+      slot = static_cast<int>(batch->textures.size());
+      batch->textures.push_back(texture);
+    }
+  }
+
+  if (slot < 0) {
+    batches_.push_back({ static_cast<uint32_t>(quads_.size()), 0, { texture } });
+    batch = &batches_.back();
+    slot = 0;
+  }
+
+  quad.slot = static_cast<float>(slot);
+  quads_.push_back(quad);
+  batch->count++;
+}
+
+const std::vector<composite_quad>& CompositeBatcher::GetQuads() const {
+  return quads_;
+}
+
+const std::vector<composite_batch>& CompositeBatcher::GetBatches() const {
+  return batches_;
+}
+
+}
+}
+}
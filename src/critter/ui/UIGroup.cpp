@@ -1,40 +1,227 @@
 #include <critter/ui/UIGroup.hpp>
 
-#include <utils/ObjectGraph.hpp>
-#include <critter/ui/layout/BoundingBox.hpp>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <unordered_map>
 
 namespace monkeysworld {
 namespace critter {
 namespace ui {
 
 using engine::Context;
-using utils::ObjectGraph;
+using utils::BoundingVolumeTree;
 using namespace layout;
 
 typedef std::shared_ptr<UIObject> child_ptr;
 
-UIGroup::UIGroup(Context* ctx) : UIObject(ctx), mat_(ctx) { 
-  max_textures_ = -1;
+// anchors in a layout_node which aren't other nodes
+static const int32_t GROUP_ANCHOR = -1;
+static const int32_t NO_ANCHOR = -2;
+
+/**
+ *  Logs any margin anchored to a face which makes no sense for it.
+ *  @param id - ID of the object the params belong to.
+ *  @param params - the object's layout params.
+ */
+static void CheckFaces(uint64_t id, const UILayoutParams& params) {
+  if (params.top.anchor_id != 0 && params.top.anchor_face != Face::TOP && params.top.anchor_face != Face::BOTTOM) {
+    BOOST_LOG_TRIVIAL(error) << "Invalid face provided for ID " << id << "'s top margin -- ignoring...";
+  }
+
+  if (params.bottom.anchor_id != 0 && params.bottom.anchor_face != Face::TOP && params.bottom.anchor_face != Face::BOTTOM) {
+    BOOST_LOG_TRIVIAL(error) << "Invalid face provided for ID " << id << "'s bottom margin -- ignoring...";
+  }
+
+  if (params.left.anchor_id != 0 && params.left.anchor_face != Face::LEFT && params.left.anchor_face != Face::RIGHT) {
+    BOOST_LOG_TRIVIAL(error) << "Invalid face provided for ID " << id << "'s left margin -- ignoring...";
+  }
+
+  if (params.right.anchor_id != 0 && params.right.anchor_face != Face::LEFT && params.right.anchor_face != Face::RIGHT) {
+    BOOST_LOG_TRIVIAL(error) << "Invalid face provided for ID " << id << "'s right margin -- ignoring...";
+  }
 }
 
-std::shared_ptr<Object> UIGroup::GetChild(uint64_t id) {
-  if (id == GetId()) {
-    return shared_from_this();
+/**
+ *  Works out where a child goes, given what it's anchored to.
+ *  @param params - the child's layout params.
+ *  @param child_pos - where the child is now.
+ *  @param child_dims - the child's current size.
+ *  @param anchors - boxes of whatever the top, bottom, left and right margins are anchored to,
+ *                   or nullptr for margins without an anchor.
+ *  @returns the child's bounding box.
+ */
+static BoundingBox SolveBox(const UILayoutParams& params, glm::vec2 child_pos, glm::vec2 child_dims,
+                            const BoundingBox* const anchors[4]) {
+  BoundingBox b;
+  // insert default values
+  b.top = child_pos.y;
+  b.left = child_pos.x;
+  b.bottom = b.top + child_dims.y;
+  b.right = b.left + child_dims.x;
+
+  // top/bottom
+  if (anchors[0] != nullptr) {
+    switch (params.top.anchor_face) {
+      case Face::BOTTOM:
+        b.top = anchors[0]->bottom;
+        break;
+      case Face::TOP:
+        b.top = anchors[0]->top;
+        break;
+      default:
+        // all others are invalid
+        break;
+    }
+
+    if (anchors[1] == nullptr) {
+      b.bottom = b.top + child_dims.y;
+    }
   }
 
-  for (auto child : children_) {
-    if (id == child->GetId()) {
-      return child;
+  if (anchors[1] != nullptr) {
+    switch (params.bottom.anchor_face) {
+      case Face::BOTTOM:
+        b.bottom = anchors[1]->bottom;
+        break;
+      case Face::TOP:
+        b.bottom = anchors[1]->top;
+        break;
+      default:
+        break;
+    }
+
+    if (anchors[0] == nullptr) {
+      b.top = b.bottom - child_dims.y;
     }
   }
 
-  for (auto child : children_) {
-    if (auto res = child->GetChild(id)) {
-      return res;
+  // left/right
+  if (anchors[2] != nullptr) {
+    switch (params.left.anchor_face) {
+      case Face::LEFT:
+        b.left = anchors[2]->left;
+        break;
+      case Face::RIGHT:
+        b.left = anchors[2]->right;
+        break;
+      default:
+        break;
+    }
+
+    if (anchors[3] == nullptr) {
+      b.right = b.left + child_dims.x;
     }
   }
 
-  return std::shared_ptr<Object>(nullptr);
+  if (anchors[3] != nullptr) {
+    switch (params.right.anchor_face) {
+      case Face::LEFT:
+        b.right = anchors[3]->left;
+        break;
+      case Face::RIGHT:
+        b.right = anchors[3]->right;
+        break;
+      default:
+        break;
+    }
+
+    if (anchors[2] == nullptr) {
+      b.left = b.right - child_dims.x;
+    }
+  }
+
+  // handle autos
+  if (params.top.margin.type == MarginType::AUTO || params.bottom.margin.type == MarginType::AUTO) {
+    // total range
+    float y_range = b.bottom - b.top;
+    // margin shrink on both sides
+    float y_squeeze = (y_range - child_dims.y) / 2;
+    b.top += y_squeeze;
+    b.bottom -= y_squeeze;
+  } else {
+    if (anchors[0] != nullptr) {
+      b.top += params.top.margin.dist;
+      if (anchors[1] == nullptr) {
+        b.bottom += params.top.margin.dist;
+      }
+    }
+
+    if (anchors[1] != nullptr) {
+      b.bottom -= params.bottom.margin.dist;
+      if (anchors[0] == nullptr) {
+        b.top -= params.bottom.margin.dist;
+      }
+    }
+  }
+
+  if (params.left.margin.type == MarginType::AUTO || params.right.margin.type == MarginType::AUTO) {
+    float x_range = b.right - b.left;
+    float x_squeeze = (x_range - child_dims.x) / 2;
+    b.left += x_squeeze;
+    b.right -= x_squeeze;
+  } else {
+    if (anchors[2] != nullptr) {
+      b.left += params.left.margin.dist;
+      if (anchors[3] == nullptr) {
+        b.right += params.left.margin.dist;
+      }
+    }
+
+    if (anchors[3] != nullptr) {
+      b.right -= params.right.margin.dist;
+      if (anchors[2] == nullptr) {
+        b.left -= params.right.margin.dist;
+      }
+    }
+  }
+
+  b.top = std::round(b.top);
+  b.bottom = std::round(b.bottom);
+  b.left = std::round(b.left);
+  b.right = std::round(b.right);
+  return b;
+}
+
+static bool SameBox(const BoundingBox& a, const BoundingBox& b) {
+  return (a.left == b.left && a.right == b.right && a.top == b.top && a.bottom == b.bottom);
+}
+
+// how far the hit index lets a child move before touching the tree, in pixels
+static const float HIT_MARGIN = 4.0f;
+
+/**
+ *  @returns the box the hit index keeps for a child. Flat, and never inside out.
+ */
+static utils::aabb GetHitBounds(const UIObject* child) {
+  glm::vec2 pos = child->GetPosition();
+  glm::vec2 max = pos + glm::max(child->GetDimensions(), glm::vec2(0));
+  return { glm::vec3(pos.x, pos.y, 0.0f), glm::vec3(max.x, max.y, 0.0f) };
+}
+
+UIGroup::UIGroup(Context* ctx) : UIObject(ctx), hit_tree_(HIT_MARGIN) { 
+  vao_ = instances_ = 0;
+  layout_size_ = glm::vec2(0);
+  layout_stale_ = true;
+  layout_ok_ = false;
+  in_layout_ = false;
+  layout_stats_ = {};
+  next_sibling_order_ = 0;
+  hit_built_ = false;
+}
+
+std::shared_ptr<Object> UIGroup::GetChild(uint64_t id) {
+  if (id == GetId()) {
+    return shared_from_this();
+  }
+
+  return FindDescendant(id);
 }
 
 std::vector<std::shared_ptr<Object>> UIGroup::GetChildren() {
@@ -46,8 +233,12 @@ std::vector<std::shared_ptr<Object>> UIGroup::GetChildren() {
   return res;
 }
 
+ChildSpan UIGroup::GetChildSpan() {
+  return ChildSpan(children_);
+}
+
 void UIGroup::AddChild(std::shared_ptr<UIObject> obj) {
-  if (obj->GetChild(this->GetId()) != NULL) {
+  if (HasAncestor(obj.get())) {
     // bad nesting!
     return;
   } else if (obj.get() == this) {
@@ -61,317 +252,436 @@ void UIGroup::AddChild(std::shared_ptr<UIObject> obj) {
   }
 
   obj->parent_ = std::weak_ptr<UIObject>(this->shared_from_this());
+  obj->Attach(obj, GetRegistry());
+  obj->sibling_order_ = next_sibling_order_++;
   children_.push_back(obj);
+  layout_stale_ = true;
+  if (hit_built_) {
+    AddHit(obj.get());
+  }
+
+  obj->DamageParent(obj->pos_, obj->pos_ + obj->size_);
 }
 
 void UIGroup::RemoveChild(uint64_t id) {
-  for (auto ptr = children_.begin(); ptr != children_.end(); ptr++) {
-    if ((*ptr)->GetId() == id) {
-      children_.erase(ptr);
-      return;
-    }
+  // anything under us is held by a group. the group may hold the last reference,
+  // so keep it alive until we're done with it
+  auto keep = std::static_pointer_cast<UIObject>(FindDescendant(id));
+  if (keep == nullptr) {
+    return;
   }
 
-  for (auto child : children_) {
-    if (auto group = std::dynamic_pointer_cast<UIGroup>(child)) {
-      group->RemoveChild(id);
-      return;
-    }
+  UIObject* obj = keep.get();
+  obj->DamageParent(obj->pos_, obj->pos_ + obj->size_);
+  auto group = std::static_pointer_cast<UIGroup>(obj->parent_.lock());
+  auto& siblings = group->children_;
+  siblings.erase(std::find_if(siblings.begin(), siblings.end(), [obj](const child_ptr& ptr) {
+    return ptr.get() == obj;
+  }));
+
+  group->layout_stale_ = true;
+  obj->layout_index_ = -1;
+  if (group->hit_built_) {
+    group->RemoveHit(obj);
   }
+
+  obj->parent_ = std::weak_ptr<UIObject>();
 }
 
 void UIGroup::Layout(glm::vec2 size) {
-  ObjectGraph o;
-  
-  for (auto child : children_) {
-    layout::UILayoutParams param = child->GetLayoutParams();
+  layout_stats_ = {};
+  if (layout_stale_) {
+    layout_ok_ = BuildLayout();
+    layout_stats_.rebuilt = true;
+  }
 
-    int i = 0;
-    for (layout::Margin* m = reinterpret_cast<layout::Margin*>(&param); i < 4; i++, m++) {
-      if (m->anchor_id != 0) {
-        // if we encounter a vertex which is not a child, break out.
-        o.AddEdge(m->anchor_id, child->GetId());
-      }
+  if (!layout_ok_) {
+    return;
+  }
+
+  glm::vec2 dims = GetDimensions();
+  if (dims != layout_size_) {
+    layout_size_ = dims;
+    for (auto index : group_dependents_) {
+      QueueLayout(index);
     }
   }
 
-  std::vector<uint64_t> sort = o.TopoSort();
+  std::vector<int32_t> unsettled;
+  unsettled.swap(unsettled_);
+  for (auto index : unsettled) {
+    QueueLayout(index);
+  }
 
-  std::unordered_map<uint64_t, layout::BoundingBox> bounding_boxes;
-  glm::vec2 dims_local = GetDimensions();
-  // working box
-  layout::BoundingBox b;
   // represents the containing group
-  b.left = 0;
-  b.right = dims_local.x;
-  b.top = 0;
-  b.bottom = dims_local.y;
-  bounding_boxes.insert(std::make_pair(GetId(), b));
-  // handle invalid orderings below
-  //  - if we encounter a node in our topo sort which is not a child, or not the group,
-  //    then break run some fallback method which just reads positions + dimensions.
-  //  - only once we have a bounding box for every node will we adjust positions + dimensions.
-  for (auto id : sort) {
-    if (id == GetId()) {
-      // avoid laying out myself
-      continue;
+  BoundingBox group_box;
+  group_box.left = 0;
+  group_box.right = dims.x;
+  group_box.top = 0;
+  group_box.bottom = dims.y;
+
+  // pending_ hands nodes out in anchor order, so anything a node is anchored to
+  // has already been solved by the time we get to it
+  std::vector<int32_t> solved;
+  while (!pending_.empty()) {
+    int32_t index = pending_.top();
+    pending_.pop();
+    layout_node& node = nodes_[index];
+    node.queued = false;
+
+    auto params = node.child->GetLayoutParams();
+    CheckFaces(node.child->GetId(), params);
+    const BoundingBox* anchors[4];
+    for (int i = 0; i < 4; i++) {
+      int32_t anchor = node.anchors[i];
+      anchors[i] = (anchor == NO_ANCHOR ? nullptr : (anchor == GROUP_ANCHOR ? &group_box : &nodes_[anchor].box));
     }
-    auto child = std::dynamic_pointer_cast<UIObject>(GetChild(id));
-    if (!child) {
-      BOOST_LOG_TRIVIAL(error) << "current layout invalid -- child with ID " << id << " not found in UIObject ID " << GetId() << "!";
-      return;
+
+    BoundingBox box = SolveBox(params, node.child->GetPosition(), node.child->GetDimensions(), anchors);
+
+    // some layouts don't settle -- solving again, from where this one puts the child, moves it
+    // again. those get solved on every pass, same as everything else used to be.
+    glm::vec2 next_pos(box.left, box.top);
+    glm::vec2 next_dims(box.right - box.left, box.bottom - box.top);
+    if (!SameBox(box, SolveBox(params, next_pos, next_dims, anchors))) {
+      unsettled_.push_back(index);
     }
 
-    auto params = child->GetLayoutParams();
-
-    glm::vec2 child_dims = child->GetDimensions();
-    glm::vec2 child_pos = child->GetPosition();
-
-    // insert default values
-    b.top = child_pos.y;
-    b.left = child_pos.x;
-    b.bottom = b.top + child_dims.y;
-    b.right = b.left + child_dims.x;
-    
-    // top/bottom
-    if (params.top.anchor_id != 0) {
-      const layout::BoundingBox& box = bounding_boxes.at(params.top.anchor_id);
-      switch (params.top.anchor_face) {
-        case Face::BOTTOM:
-          b.top = box.bottom;
-          break;
-        case Face::TOP:
-          b.top = box.top;
-          break;
-        default:
-          BOOST_LOG_TRIVIAL(error) << "Invalid face provided for ID " << id << "'s top margin -- ignoring...";
-        // all others are invalid
+    if (!SameBox(box, node.box)) {
+      node.box = box;
+      for (auto dependent : node.dependents) {
+        QueueLayout(dependent);
       }
+    }
 
-      if (params.bottom.anchor_id == 0) {
-        b.bottom = b.top + child_dims.y;
-      }
+    solved.push_back(index);
+  }
+
+  // only once every box is worked out do we move anything
+  in_layout_ = true;
+  for (auto index : solved) {
+    UIObject* child = nodes_[index].child;
+    const BoundingBox& bb = nodes_[index].box;
+    glm::ivec2 old_pos = child->pos_;
+    glm::ivec2 old_size = child->size_;
+    child->SetPosition(glm::vec2(bb.left, bb.top));
+    child->SetDimensions(glm::vec2(bb.right - bb.left, bb.bottom - bb.top));
+    if (child->pos_ != old_pos || child->size_ != old_size) {
+      layout_stats_.moved++;
     }
+  }
 
-    if (params.bottom.anchor_id != 0) {
-      const layout::BoundingBox& box = bounding_boxes.at(params.bottom.anchor_id);
-      switch (params.bottom.anchor_face) {
-        case Face::BOTTOM:
-          b.bottom = box.bottom;
-          break;
-        case Face::TOP:
-          b.bottom = box.top;
-          break;
-        default:
-          BOOST_LOG_TRIVIAL(error) << "Invalid face provided for ID " << id << "'s bottom margin -- ignoring...";
-      }
+  in_layout_ = false;
+  layout_stats_.solved = static_cast<uint32_t>(solved.size());
+}
 
-      if (params.top.anchor_id == 0) {
-        b.top = b.bottom - child_dims.y;
-      }
+const layout_stats& UIGroup::GetLayoutStats() const {
+  return layout_stats_;
+}
+
+void UIGroup::OnChildLayoutChanged(UIObject* child, bool anchors) {
+  if (hit_built_ && child->hit_slot_ >= 0) {
+    // caught up on the next search, so a child moving many times between clicks costs nothing
+    hit_entry& entry = hit_entries_[child->hit_slot_];
+    if (!entry.moved) {
+      entry.moved = true;
+      hit_moved_.push_back(static_cast<uint32_t>(child->hit_slot_));
     }
+  }
 
-    // left/right
-    if (params.left.anchor_id != 0) {
-      const layout::BoundingBox& box = bounding_boxes.at(params.left.anchor_id);
-      switch (params.left.anchor_face) {
-        case Face::LEFT:
-          b.left = box.left;
-          break;
-        case Face::RIGHT:
-          b.left = box.right;
-          break;
-        default:
-          BOOST_LOG_TRIVIAL(error) << "Invalid face provided for ID " << id << "'s left margin -- ignoring...";
-      }
+  if (in_layout_) {
+    // we're the ones moving it
+    return;
+  }
+
+  if (anchors) {
+    layout_stale_ = true;
+  } else if (!layout_stale_ && child->layout_index_ >= 0) {
+    QueueLayout(child->layout_index_);
+  }
+}
+
+bool UIGroup::BuildLayout() {
+  layout_stale_ = false;
+  nodes_.clear();
+  group_dependents_.clear();
+  unsettled_.clear();
+  pending_ = decltype(pending_)();
+
+  std::unordered_map<uint64_t, int32_t> indices;
+  for (size_t i = 0; i < children_.size(); i++) {
+    children_[i]->layout_index_ = -1;
+    indices.insert(std::make_pair(children_[i]->GetId(), static_cast<int32_t>(i)));
+  }
 
-      if (params.right.anchor_id == 0) {
-        b.right = b.left + child_dims.x;
+  // anchors and dependents by position in children_, for now
+  std::vector<std::array<int32_t, 4>> anchors(children_.size());
+  std::vector<std::vector<int32_t>> dependents(children_.size());
+  std::vector<int32_t> in_deg(children_.size(), 0);
+  for (size_t i = 0; i < children_.size(); i++) {
+    auto params = children_[i]->GetLayoutParams();
+    const Margin* margins[4] = { &params.top, &params.bottom, &params.left, &params.right };
+    for (int j = 0; j < 4; j++) {
+      uint64_t id = margins[j]->anchor_id;
+      if (id == 0) {
+        anchors[i][j] = NO_ANCHOR;
+      } else if (id == GetId()) {
+        anchors[i][j] = GROUP_ANCHOR;
+      } else {
+        auto itr = indices.find(id);
+        if (itr == indices.end()) {
+          BOOST_LOG_TRIVIAL(error) << "current layout invalid -- child with ID " << id << " not found in UIObject ID " << GetId() << "!";
+          // it may turn up later
+          layout_stale_ = true;
+          return false;
+        }
+
+        anchors[i][j] = itr->second;
+        dependents[itr->second].push_back(static_cast<int32_t>(i));
+        in_deg[i]++;
       }
     }
+  }
 
-    if (params.right.anchor_id != 0) {
-      const layout::BoundingBox& box = bounding_boxes.at(params.right.anchor_id);
-      switch (params.right.anchor_face) {
-        case Face::LEFT:
-          b.right = box.left;
-          break;
-        case Face::RIGHT:
-          b.right = box.right;
-          break;
-        default:
-          BOOST_LOG_TRIVIAL(error) << "Invalid face provided for ID " << id << "'s right margin -- ignoring...";
-      }
+  std::vector<int32_t> order;
+  for (size_t i = 0; i < children_.size(); i++) {
+    if (in_deg[i] == 0) {
+      order.push_back(static_cast<int32_t>(i));
+    }
+  }
 
-      if (params.left.anchor_id == 0) {
-        b.left = b.right - child_dims.x;
+  for (size_t next = 0; next < order.size(); next++) {
+    for (auto dependent : dependents[order[next]]) {
+      if (--in_deg[dependent] == 0) {
+        order.push_back(dependent);
       }
     }
+  }
 
-    // handle autos
-    if (params.top.margin.type == MarginType::AUTO || params.bottom.margin.type == MarginType::AUTO) {
-      // total range
-      float y_range = b.bottom - b.top;
-      // margin shrink on both sides
-      float y_squeeze = (y_range - child_dims.y) / 2;
-      b.top += y_squeeze;
-      b.bottom -= y_squeeze;
-    } else {
-      if (params.top.anchor_id != 0) {
-        b.top += params.top.margin.dist;
-        if (params.bottom.anchor_id == 0) {
-          b.bottom += params.top.margin.dist;
-        }
-      }
+  if (order.size() != children_.size()) {
+    // cycle -- nothing gets laid out until the anchors change
+    return false;
+  }
 
-      if (params.bottom.anchor_id != 0) {
-        b.bottom -= params.bottom.margin.dist;
-        if (params.top.anchor_id == 0) {
-          b.top -= params.bottom.margin.dist;
-        }
-      }
+  std::vector<int32_t> positions(children_.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    positions[order[i]] = static_cast<int32_t>(i);
+  }
+
+  nodes_.resize(order.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    int32_t source = order[i];
+    layout_node& node = nodes_[i];
+    node.child = children_[source].get();
+    node.child->layout_index_ = static_cast<int32_t>(i);
+    bool on_group = false;
+    for (int j = 0; j < 4; j++) {
+      int32_t anchor = anchors[source][j];
+      node.anchors[j] = (anchor >= 0 ? positions[anchor] : anchor);
+      on_group = on_group || (anchor == GROUP_ANCHOR);
     }
 
-    // BOOST_LOG_TRIVIAL(trace) << b.top << ", " << b.bottom << ", " << b.left << ", " << b.right;
-
-    if (params.left.margin.type == MarginType::AUTO || params.right.margin.type == MarginType::AUTO) {
-      float x_range = b.right - b.left;
-      float x_squeeze = (x_range - child_dims.x) / 2;
-      b.left += x_squeeze;
-      b.right -= x_squeeze;
-    } else {
-      if (params.left.anchor_id != 0) {
-        b.left += params.left.margin.dist;
-        if (params.right.anchor_id == 0) {
-          b.right += params.left.margin.dist;
-        }
-      }
+    node.dependents.clear();
+    for (auto dependent : dependents[source]) {
+      node.dependents.push_back(positions[dependent]);
+    }
 
-      if (params.right.anchor_id != 0) {
-        b.right -= params.right.margin.dist;
-        if (params.left.anchor_id == 0) {
-          b.left -= params.right.margin.dist;
-        }
-      }
+    if (on_group) {
+      group_dependents_.push_back(static_cast<int32_t>(i));
     }
 
-    b.top = std::round(b.top);
-    b.bottom = std::round(b.bottom);
-    b.left = std::round(b.left);
-    b.right = std::round(b.right);
-    bounding_boxes.insert(std::make_pair(id, b));
-    // BOOST_LOG_TRIVIAL(trace) << b.top << ", " << b.bottom << ", " << b.left << ", " << b.right;
+    glm::vec2 pos = node.child->GetPosition();
+    glm::vec2 dims = node.child->GetDimensions();
+    node.box.left = pos.x;
+    node.box.right = pos.x + dims.x;
+    node.box.top = pos.y;
+    node.box.bottom = pos.y + dims.y;
+    node.queued = false;
+    QueueLayout(static_cast<int32_t>(i));
   }
 
-  // once this has run for all components, our bounding boxes are defined for every component.
-  // now we can lay them out!
-  for (const auto& e : bounding_boxes) {
-    auto child = std::dynamic_pointer_cast<UIObject>(GetChild(e.first));
-    auto bb = e.second;
-    child->SetPosition(glm::vec2(bb.left, bb.top));
-    child->SetDimensions(glm::vec2(bb.right - bb.left, bb.bottom - bb.top));
+  layout_size_ = GetDimensions();
+  return true;
+}
+
+void UIGroup::QueueLayout(int32_t index) {
+  layout_node& node = nodes_[index];
+  if (!node.queued) {
+    node.queued = true;
+    pending_.push(index);
   }
 }
 
-void UIGroup::DrawUI(glm::vec2 min, glm::vec2 max, shader::Canvas canvas) {
-  // note: framebuffer is bound if this is being called
-  // plus, all of its children have already been drawn
-  glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &max_textures_);
-  UIGroupPacket p;
-  std::shared_ptr<UIObject> child;
-  glm::vec2 group_dims = GetDimensions();
-  GLuint textures[4];
-  float opacities[4];
-  int current_child = 0;
-  int index = 0;
-  mesh_.Clear();
-  
-  // maintain sorted z-index order for children+
-  std::sort(children_.begin(), children_.end(), [&](child_ptr a, child_ptr b) {
-    return (a->z_index > b->z_index);
+void UIGroup::GetChildrenAt(glm::vec2 point, std::vector<UIObject*>* children) {
+  UpdateHitIndex();
+  utils::aabb box = { glm::vec3(point.x, point.y, 0.0f), glm::vec3(point.x, point.y, 0.0f) };
+  hit_tree_.QueryBox(box, [&](uint32_t slot) {
+    // the tree's boxes include the far edges, ours don't
+    UIObject* child = hit_entries_[slot].child;
+    if (child->Covers(point)) {
+      children->push_back(child);
+    }
+
+    return true;
   });
-  
-  while (current_child < children_.size()) {
-    // add shit to our mesh as we go
-    // once we hit 4: draw it
-    // if we're done, and index > 0: draw it
-    child = children_[current_child];
-    glm::vec2 min_coord = child->GetPosition();
-    glm::vec2 max_coord = min_coord + child->GetDimensions();
-    if (min_coord.x > group_dims.x || min_coord.y > group_dims.y || max_coord.x < 0 || max_coord.y < 0) {
-      current_child++;
-      continue;
+
+  std::sort(children->begin(), children->end(), IsDrawnAbove);
+}
+
+void UIGroup::UpdateHitIndex() {
+  if (!hit_built_) {
+    std::vector<utils::aabb> boxes;
+    std::vector<uint32_t> slots;
+    for (auto& child : children_) {
+      child->hit_slot_ = static_cast<int32_t>(hit_entries_.size());
+      slots.push_back(static_cast<uint32_t>(hit_entries_.size()));
+      boxes.push_back(GetHitBounds(child.get()));
+      hit_entries_.push_back({ child.get(), BoundingVolumeTree::NULL_NODE, false });
     }
 
-    textures[index] = child->GetFramebufferColor();
-    opacities[index] = child->GetOpacity();
-    p.index = static_cast<float>(index);
+    std::vector<int> proxies(children_.size());
+    hit_tree_.CreateProxies(boxes.data(), slots.data(), boxes.size(), proxies.data());
+    for (size_t i = 0; i < proxies.size(); i++) {
+      hit_entries_[i].proxy = proxies[i];
+    }
 
-    glm::vec2 pos = child->GetPosition();
-    glm::vec2 dims = GetDimensions();
+    hit_built_ = true;
+    return;
+  }
 
-    auto dims_child = child->GetDimensions();
+  if (hit_moved_.empty()) {
+    return;
+  }
 
-    // top left
-    p.pos.x = (pos.x / dims.x) * 2 - 1;
-    p.pos.y = 1 - (pos.y / dims.y) * 2;
+  std::vector<BoundingVolumeTree::proxy_move> moves;
+  for (auto slot : hit_moved_) {
+    hit_entry& entry = hit_entries_[slot];
+    if (entry.moved) {
+      // slots freed (or reused) since they were queued aren't flagged
+      entry.moved = false;
+      moves.push_back({ entry.proxy, GetHitBounds(entry.child) });
+    }
+  }
 
+  hit_moved_.clear();
+  if (!moves.empty()) {
+    hit_tree_.MoveProxies(moves.data(), moves.size());
+  }
+}
 
-    p.texcoord = glm::vec2(0, 1);
-    mesh_.AddVertex(p);
+void UIGroup::AddHit(UIObject* child) {
+  uint32_t slot;
+  if (!hit_free_.empty()) {
+    slot = hit_free_.back();
+    hit_free_.pop_back();
+  } else {
+    slot = static_cast<uint32_t>(hit_entries_.size());
+    hit_entries_.push_back({});
+  }
 
-    // bottom left
-    p.pos.y -= (dims_child.y / dims.y) * 2;
-    p.texcoord = glm::vec2(0, 0);
-    mesh_.AddVertex(p);
+  hit_entries_[slot] = { child, hit_tree_.CreateProxy(GetHitBounds(child), slot), false };
+  child->hit_slot_ = static_cast<int32_t>(slot);
+}
 
-    // bottom right
-    p.pos.x += (dims_child.x / dims.x) * 2;
-    p.texcoord = glm::vec2(1, 0);
-    mesh_.AddVertex(p);
+void UIGroup::RemoveHit(UIObject* child) {
+  if (child->hit_slot_ < 0) {
+    return;
+  }
 
-    // top right
-    p.pos.y += (dims_child.y / dims.y) * 2;
-    p.texcoord = glm::vec2(1, 1);
-    mesh_.AddVertex(p);
+  hit_entry& entry = hit_entries_[child->hit_slot_];
+  hit_tree_.DestroyProxy(entry.proxy);
+  entry = { nullptr, BoundingVolumeTree::NULL_NODE, false };
+  hit_free_.push_back(static_cast<uint32_t>(child->hit_slot_));
+  child->hit_slot_ = -1;
+}
 
-    mesh_.AddPolygon(4 * index, 4 * index + 1, 4 * index + 2);
-    mesh_.AddPolygon(4 * index, 4 * index + 2, 4 * index + 3);
+void UIGroup::DrawUI(glm::vec2 min, glm::vec2 max, shader::Canvas canvas) {
+  // note: framebuffer is bound if this is being called
+  // plus, all of its children have already been drawn
+  if (!mat_) {
+    // built on first draw, so groups can be put together and laid out without GL
+    mat_ = std::make_unique<shader::materials::UIGroupMaterial>(GetContext());
+  }
 
-    current_child++;
-    index++;
+  glm::vec2 dims = GetDimensions();
+  
+  // maintain sorted z-index order for children, bottom first
+  std::sort(children_.begin(), children_.end(), [&](const child_ptr& a, const child_ptr& b) {
+    return IsDrawnAbove(b.get(), a.get());
+  });
 
-    if (index == 4) {
-      mat_.SetTextures(textures);
-      mat_.SetOpacity(opacities);
-      mesh_.PointToVertexAttribs();
-      mat_.UseMaterial();
-      glDrawElements(GL_TRIANGLES, static_cast<int>(mesh_.GetIndexCount()), GL_UNSIGNED_INT, (void*)0);
+  batcher_.Begin(mat_->GetMaxTextures());
+  for (auto& child : children_) {
+    glm::vec2 min_coord = child->GetPosition();
+    glm::vec2 max_coord = min_coord + child->GetDimensions();
+    if (min_coord.x > dims.x || min_coord.y > dims.y || max_coord.x < 0 || max_coord.y < 0) {
+      continue;
+    }
 
-      index = 0;
+    if (min_coord.x >= max.x || min_coord.y >= max.y || max_coord.x <= min.x || max_coord.y <= min.y) {
+      // outside of the region being redrawn
+      continue;
     }
+
+    // clip space is y-up, we're y-down
+    composite_quad quad;
+    quad.rect = glm::vec4((min_coord.x / dims.x) * 2 - 1, 1 - (max_coord.y / dims.y) * 2,
+                          (max_coord.x / dims.x) * 2 - 1, 1 - (min_coord.y / dims.y) * 2);
+    glm::vec2 tex_min, tex_max;
+    child->GetFramebufferTexcoords(&tex_min, &tex_max);
+    quad.texcoords = glm::vec4(tex_min.x, tex_min.y, tex_max.x, tex_max.y);
+    quad.opacity = std::min(std::max(child->GetOpacity(), 0.0f), 1.0f);
+    batcher_.Add(child->GetFramebufferColor(), quad);
   }
 
-  if (index > 0) {
-    mat_.SetTextures(textures);
-    mat_.SetOpacity(opacities);
-    mesh_.PointToVertexAttribs();
-    mat_.UseMaterial();
-    glDrawElements(GL_TRIANGLES, static_cast<int>(mesh_.GetIndexCount()), GL_UNSIGNED_INT, (void*)0);
+  auto& quads = batcher_.GetQuads();
+  if (quads.empty()) {
+    return;
   }
+
+  if (vao_ == 0) {
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &instances_);
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, instances_);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(composite_quad), (void*)offsetof(composite_quad, rect));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(composite_quad), (void*)offsetof(composite_quad, texcoords));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(composite_quad), (void*)offsetof(composite_quad, opacity));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(composite_quad), (void*)offsetof(composite_quad, slot));
+    for (GLuint i = 0; i < 4; i++) {
+      glEnableVertexAttribArray(i);
+      glVertexAttribDivisor(i, 1);
+    }
+  }
+
+  glBindVertexArray(vao_);
+  glBindBuffer(GL_ARRAY_BUFFER, instances_);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(composite_quad) * quads.size(), quads.data(), GL_STREAM_DRAW);
+
+  auto& batches = batcher_.GetBatches();
+  for (auto& batch : batches) {
+    mat_->SetTextures(batch.textures.data(), static_cast<int>(batch.textures.size()));
+    mat_->UseMaterial();
+    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, batch.count, batch.first);
+  }
+
+  CountDraws(static_cast<uint32_t>(batches.size()));
 }
 
-void UIGroup::UIGroupPacket::Bind() {
-  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(UIGroupPacket), (void*)0);
-  glEnableVertexAttribArray(0);
-  
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(UIGroupPacket), (void*)(sizeof(glm::vec2)));
-  glEnableVertexAttribArray(1);
+UIGroup::~UIGroup() {
+  if (vao_ == 0) {
+    // never drawn
+    return;
+  }
 
-  glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(UIGroupPacket), (void*)(2 * sizeof(glm::vec2)));
-  glEnableVertexAttribArray(2);
+  if (!glfwGetCurrentContext()) {
+    BOOST_LOG_TRIVIAL(error) << "could not delete GL components!";
+  } else {
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteBuffers(1, &instances_);
+  }
 }
 
 }
 }
-}
\ No newline at end of file
+}
@@ -1,5 +1,7 @@
 #include <critter/ui/UIObject.hpp>
 
+#include <algorithm>
+
 namespace monkeysworld {
 namespace critter {
 namespace ui {
@@ -14,13 +16,42 @@ std::weak_ptr<shader::materials::TextureXferMaterial> UIObject::xfer_mat_singlet
 std::mutex UIObject::xfer_lock_;
 model::Mesh<storage::VertexPacket2D> UIObject::xfer_mesh_;
 
+/**
+ *  @returns true if the rectangle from `min` to `max` covers nothing.
+ */
+static bool IsEmpty(glm::ivec2 min, glm::ivec2 max) {
+  return (min.x >= max.x || min.y >= max.y);
+}
+
+/**
+ *  Grows the rectangle from `min` to `max` to cover the one from `add_min` to `add_max`.
+ */
+static void Merge(glm::ivec2* min, glm::ivec2* max, glm::ivec2 add_min, glm::ivec2 add_max) {
+  if (IsEmpty(add_min, add_max)) {
+    return;
+  }
+
+  if (IsEmpty(*min, *max)) {
+    *min = add_min;
+    *max = add_max;
+  } else {
+    *min = glm::min(*min, add_min);
+    *max = glm::max(*max, add_max);
+  }
+}
+
 UIObject::UIObject(engine::Context* ctx) : Object(ctx) {
   pos_ = glm::vec2(0, 0);
   size_ = glm::vec2(1, 1);
-  fb_ = std::make_shared<Framebuffer>();
+  fb_ = std::make_shared<Framebuffer>(ctx ? ctx->GetFramebufferPool() : nullptr);
   opacity_ = 1.0f;
 
   valid_ = true;
+  damaged_ = false;
+  pending_min_ = pending_max_ = glm::ivec2(0);
+  damage_min_ = damage_max_ = glm::ivec2(0);
+  last_redraw_ = {};
+  tally_ = nullptr;
   parent_ = std::weak_ptr<UIObject>();
   z_index = 0;
 
@@ -28,6 +59,9 @@ UIObject::UIObject(engine::Context* ctx) : Object(ctx) {
   layout_.top.anchor_id =
   layout_.left.anchor_id =
   layout_.right.anchor_id = 0;
+  layout_index_ = -1;
+  sibling_order_ = 0;
+  hit_slot_ = -1;
 }
 
 void UIObject::Accept(Visitor& v) {
@@ -35,12 +69,15 @@ void UIObject::Accept(Visitor& v) {
 }
 
 void UIObject::PreLayout() {
-  if (!IsValid()) {
-    Layout(GetDimensions());
+  if (IsValid()) {
+    // damage propagates upwards, so nothing under us has changed either
+    return;
   }
 
-  for (auto child : GetChildren()) {
-    std::dynamic_pointer_cast<UIObject>(child)->PreLayout();
+  Layout(GetDimensions());
+
+  for (Object* child : GetChildSpan()) {
+    static_cast<UIObject*>(child)->PreLayout();
   }
 }
 
@@ -52,6 +89,10 @@ std::vector<std::shared_ptr<Object>> UIObject::GetChildren() {
   return std::vector<std::shared_ptr<Object>>();
 }
 
+ChildSpan UIObject::GetChildSpan() {
+  return ChildSpan();
+}
+
 std::shared_ptr<Object> UIObject::GetParent() {
   return parent_.lock();
 }
@@ -62,32 +103,109 @@ bool UIObject::HandleClickEvent(const input::MouseEvent& e) {
     return true;
   }
 
-  std::shared_ptr<UIObject> ui_child;
-  glm::vec2 child_pos;
-  glm::vec2 child_dims;
-  for (auto child : GetChildren()) {
+  std::vector<UIObject*> found;
+  GetChildrenAt(e.local_pos, &found);
+
+  // held onto, in case a click handler removes one of them
+  std::vector<std::shared_ptr<UIObject>> children;
+  for (auto child : found) {
+    children.push_back(child->shared_from_this());
+  }
+
+  for (auto& child : children) {
     input::MouseEvent e_child = e;
-    ui_child = std::static_pointer_cast<UIObject>(child);
-    child_pos = ui_child->GetPosition();
-    child_dims = ui_child->GetDimensions();
-    e_child.local_pos -= child_pos;
-    if (   e_child.local_pos.x >= 0 && e_child.local_pos.x < child_dims.x
-        && e_child.local_pos.y >= 0 && e_child.local_pos.y < child_dims.y) {
-      if (ui_child->HandleClickEvent(e_child)) {
-        return true;
-      }
+    e_child.local_pos -= child->GetPosition();
+    if (child->HandleClickEvent(e_child)) {
+      return true;
     }
   }
 
   return false;
 }
 
+void UIObject::HandleHoverEvent(const input::MouseEvent& e) {
+  glm::vec2 local;
+  auto target = GetObjectAt(e.local_pos, &local);
+  auto last = hovered_.lock();
+  if (target == last) {
+    return;
+  }
+
+  hovered_ = target;
+  if (last) {
+    input::MouseEvent e_last = e;
+    e_last.local_pos = e.local_pos + GetAbsolutePosition() - last->GetAbsolutePosition();
+    last->OnMouseExit(e_last);
+  }
+
+  if (target) {
+    input::MouseEvent e_target = e;
+    e_target.local_pos = local;
+    target->OnMouseEnter(e_target);
+  }
+}
+
+std::shared_ptr<UIObject> UIObject::GetObjectAt(glm::vec2 point, glm::vec2* local) {
+  if (point.x < 0 || point.y < 0 || point.x >= size_.x || point.y >= size_.y) {
+    return std::shared_ptr<UIObject>(nullptr);
+  }
+
+  UIObject* target = this;
+  std::vector<UIObject*> children;
+  while (true) {
+    children.clear();
+    target->GetChildrenAt(point, &children);
+    if (children.empty()) {
+      break;
+    }
+
+    target = children.front();
+    point -= glm::vec2(target->pos_);
+  }
+
+  if (local) {
+    *local = point;
+  }
+
+  return target->shared_from_this();
+}
+
+void UIObject::GetChildrenAt(glm::vec2 point, std::vector<UIObject*>* children) {
+  for (Object* child : GetChildSpan()) {
+    auto ui = static_cast<UIObject*>(child);
+    if (ui->Covers(point)) {
+      children->push_back(ui);
+    }
+  }
+
+  std::sort(children->begin(), children->end(), IsDrawnAbove);
+}
+
+bool UIObject::IsDrawnAbove(const UIObject* a, const UIObject* b) {
+  if (a->z_index != b->z_index) {
+    return (a->z_index < b->z_index);
+  }
+
+  return (a->sibling_order_ > b->sibling_order_);
+}
+
+bool UIObject::Covers(glm::vec2 point) const {
+  glm::vec2 local = point - glm::vec2(pos_);
+  return (local.x >= 0 && local.x < size_.x && local.y >= 0 && local.y < size_.y);
+}
+
 glm::vec2 UIObject::GetPosition() const {
   return pos_;
 }
 
 void UIObject::SetPosition(glm::vec2 pos) {
-  pos_ = static_cast<glm::ivec2>(glm::round(pos));
+  glm::ivec2 new_pos = static_cast<glm::ivec2>(glm::round(pos));
+  if (new_pos != pos_) {
+    DamageParent(pos_, pos_ + size_);
+    pos_ = new_pos;
+    DamageParent(pos_, pos_ + size_);
+    NotifyParentLayout(false);
+  }
 }
 
 glm::vec2 UIObject::GetAbsolutePosition() const {
@@ -103,7 +221,14 @@ glm::vec2 UIObject::GetDimensions() const {
 }
 
 void UIObject::SetDimensions(glm::vec2 size) {
-  size_ = static_cast<glm::ivec2>(size);
+  glm::ivec2 new_size = static_cast<glm::ivec2>(size);
+  if (new_size != size_) {
+    // whatever we covered before may be uncovered now
+    DamageParent(pos_, pos_ + size_);
+    size_ = new_size;
+    NotifyParentLayout(false);
+  }
+
   if (fb_->GetDimensions() != size_) {
     fb_->SetDimensions(size_);
     // new size requires a redraw
@@ -137,39 +262,149 @@ layout::UILayoutParams UIObject::GetLayoutParams() const {
 }
 
 void UIObject::SetLayoutParams(const layout::UILayoutParams& params) {
+  bool anchors = (params.top.anchor_id != layout_.top.anchor_id
+               || params.bottom.anchor_id != layout_.bottom.anchor_id
+               || params.left.anchor_id != layout_.left.anchor_id
+               || params.right.anchor_id != layout_.right.anchor_id);
   layout_ = params;
+  NotifyParentLayout(anchors);
 }
 
 void UIObject::Invalidate() {
-  valid_.store(false);
+  valid_ = false;
+  MarkDamaged();
+}
+
+void UIObject::MarkDamaged() {
+  if (damaged_) {
+    // if we were already damaged, so is everything above us
+    return;
+  }
+
+  damaged_ = true;
+  auto parent = parent_.lock();
+  while (parent && !parent->damaged_) {
+    parent->damaged_ = true;
+    parent = parent->parent_.lock();
+  }
+}
+
+void UIObject::DamageParent(glm::ivec2 min, glm::ivec2 max) {
+  if (auto parent = parent_.lock()) {
+    Merge(&parent->pending_min_, &parent->pending_max_, min, max);
+    parent->MarkDamaged();
+  }
+}
+
+void UIObject::NotifyParentLayout(bool anchors) {
+  if (auto parent = parent_.lock()) {
+    parent->OnChildLayoutChanged(this, anchors);
+  }
 }
 
 void UIObject::RenderMaterial(const engine::RenderContext& rc) {
-  if (!IsValid()) {
-    // at least one child is invalid
-    // get invalid binding box (while invalidity still applies)
-    glm::vec2 min, max;
-    GetInvalidatedBoundingBox(&min, &max);
-    
-    // render all children first (bottom up rendering)
-    for (auto child : GetChildren()) {
-      auto ui = std::static_pointer_cast<UIObject>(child);
-      ui->RenderMaterial(rc);
+  last_redraw_ = {};
+  tally_ = nullptr;
+  if (!damaged_) {
+    return;
+  }
+
+  UpdateDamage();
+  Redraw(&last_redraw_);
+  ClearDamage();
+}
+
+const redraw_stats& UIObject::GetRedrawStats() const {
+  return last_redraw_;
+}
+
+void UIObject::UpdateDamage() {
+  if (!damaged_) {
+    return;
+  }
+
+  glm::ivec2 min = pending_min_;
+  glm::ivec2 max = pending_max_;
+  if (!valid_) {
+    min = glm::ivec2(0);
+    max = size_;
+  }
+
+  // children which redraw part of themselves change the same part of us
+  for (Object* child : GetChildSpan()) {
+    auto ui = static_cast<UIObject*>(child);
+    ui->UpdateDamage();
+    Merge(&min, &max, ui->pos_ + ui->damage_min_, ui->pos_ + ui->damage_max_);
+  }
+
+  damage_min_ = glm::max(min, glm::ivec2(0));
+  damage_max_ = glm::min(max, size_);
+  if (IsEmpty(damage_min_, damage_max_)) {
+    damage_min_ = damage_max_ = glm::ivec2(0);
+  }
+}
+
+void UIObject::GetInvalidatedBoundingBox(glm::vec2* xyMin, glm::vec2* xyMax) const {
+  *xyMin = damage_min_;
+  *xyMax = damage_max_;
+}
+
+void UIObject::ClearDamage() {
+  if (!damaged_) {
+    return;
+  }
+
+  valid_ = true;
+  damaged_ = false;
+  pending_min_ = pending_max_ = glm::ivec2(0);
+  damage_min_ = damage_max_ = glm::ivec2(0);
+  for (Object* child : GetChildSpan()) {
+    static_cast<UIObject*>(child)->ClearDamage();
+  }
+}
+
+void UIObject::Redraw(redraw_stats* stats) {
+  // render all children first (bottom up rendering)
+  for (Object* child : GetChildSpan()) {
+    auto ui = static_cast<UIObject*>(child);
+    if (ui->damaged_) {
+      ui->Redraw(stats);
     }
+  }
+
+  if (IsEmpty(damage_min_, damage_max_)) {
+    return;
+  }
 
-    fb_->BindFramebuffer(FramebufferTarget::DEFAULT);
-    auto size = fb_->GetDimensions();
-    glViewport(0, 0, static_cast<uint32_t>(size.x), static_cast<uint32_t>(size.y));
-    
-    #ifdef DEBUG
-      glClearColor(1.0f, 0.0f, 0.0f, 0.2f);
-    #else
-      glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    #endif
-    
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-    DrawUI(min, max, Canvas(fb_));
-    valid_.store(true);
+  fb_->BindFramebuffer(FramebufferTarget::DEFAULT);
+  auto size = fb_->GetDimensions();
+  auto origin = fb_->GetOrigin();
+  glViewport(origin.x, origin.y, static_cast<uint32_t>(size.x), static_cast<uint32_t>(size.y));
+
+  // GL's origin is bottom left
+  glm::ivec2 extent = damage_max_ - damage_min_;
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(origin.x + damage_min_.x, origin.y + size.y - damage_max_.y, extent.x, extent.y);
+
+  #ifdef DEBUG
+    glClearColor(1.0f, 0.0f, 0.0f, 0.2f);
+  #else
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  #endif
+  
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  tally_ = stats;
+  DrawUI(damage_min_, damage_max_, Canvas(fb_));
+  tally_ = nullptr;
+  glDisable(GL_SCISSOR_TEST);
+
+  stats->objects++;
+  stats->pixels += static_cast<uint64_t>(extent.x) * extent.y;
+}
+
+void UIObject::CountDraws(uint32_t draws) {
+  if (tally_) {
+    tally_->draws += draws;
   }
 }
 
@@ -223,6 +458,14 @@ void UIObject::DrawToScreen() {
   xfer_mesh_[3].position.x = ((pos.x + dim.x) / win.x) * 2 - 1;
   xfer_mesh_[3].position.y = 1 - (pos.y / win.y) * 2;
 
+  // we may only cover part of our attachment
+  glm::vec2 tex_min, tex_max;
+  GetFramebufferTexcoords(&tex_min, &tex_max);
+  xfer_mesh_[0].texcoords = glm::vec2(tex_min.x, tex_max.y);
+  xfer_mesh_[1].texcoords = tex_min;
+  xfer_mesh_[2].texcoords = glm::vec2(tex_max.x, tex_min.y);
+  xfer_mesh_[3].texcoords = tex_max;
+
   xfer_mesh_.PointToVertexAttribs();
   xfer_mat_->SetTexture(GetFramebufferColor());
   xfer_mat_->SetOpacity(opacity_);
@@ -234,6 +477,20 @@ GLuint UIObject::GetFramebufferColor() {
   return fb_->GetColorAttachment();
 }
 
+void UIObject::GetFramebufferTexcoords(glm::vec2* min, glm::vec2* max) const {
+  fb_->GetTexcoords(min, max);
+}
+
+void UIObject::SetAtlased(bool atlased) {
+  if (!CanShareFramebuffer()) {
+    return;
+  }
+
+  fb_->SetAtlased(atlased);
+  // new attachments start out blank, and the parent needs to sample from the new spot
+  Invalidate();
+}
+
 // todo: create a "framebuffer" type object which constitutes an RAII wrapper around a framebuffer
 //       and its attachments.
 
@@ -243,66 +500,25 @@ GLuint UIObject::GetFramebuffer() {
 }
 
 bool UIObject::IsValid() {
-  if (valid_) {
-    for (auto child : GetChildren()) {
-      auto ui = std::static_pointer_cast<UIObject>(child);
-      if (!ui->IsValid()) {
-        return false;
-      }
-    }
-
-    // all children are still valid
-    return true;
-  }
-
-  // this uiobject is invalid regardless
-  return false;
-}
-
-void UIObject::GetInvalidatedBoundingBox(glm::vec2* xyMin, glm::vec2* xyMax) {
-  if (!valid_) {
-    // invalidate entire screen
-    *xyMin = glm::vec2(0);
-    *xyMax = GetDimensions();
-    return;
-  } else {
-    glm::vec2 min;
-    glm::vec2 max;
-    bool set = false;
-    for (auto child : GetChildren()) {
-      auto ui = std::static_pointer_cast<UIObject>(child);
-      if (!ui->IsValid()) {
-        // the first child defines the region
-        if (!set) {
-          set = true;
-          min = ui->GetPosition();
-          max = min + ui->GetDimensions();
-        } else {
-          min = glm::min(min, ui->GetPosition());
-          max = glm::max(max, ui->GetDimensions() + ui->GetPosition());
-          }
-        }
-    }
-
-    if (!set) {
-      // all children were valid -- no need to draw
-      *xyMin = glm::vec2(0);
-      *xyMax = glm::vec2(0);
-      return;
-    }
-
-    *xyMin = min;
-    *xyMax = max;
-    return;
-  }
+  return !damaged_;
 }
 
 UIObject::UIObject(const UIObject& other) : Object(other) {
   pos_ = other.pos_;
   size_ = other.size_;
+  // same pool, new attachments
+  fb_ = std::make_shared<Framebuffer>(*other.fb_);
 
   valid_ = false;
+  damaged_ = true;
+  pending_min_ = pending_max_ = glm::ivec2(0);
+  damage_min_ = damage_max_ = glm::ivec2(0);
+  last_redraw_ = {};
+  tally_ = nullptr;
   parent_ = std::weak_ptr<UIObject>();
+  layout_index_ = -1;
+  sibling_order_ = 0;
+  hit_slot_ = -1;
 }
 
 UIObject& UIObject::operator=(const UIObject& other) {
@@ -310,15 +526,26 @@ UIObject& UIObject::operator=(const UIObject& other) {
   pos_ = other.pos_;
   size_ = other.size_;
   valid_ = false;
+  MarkDamaged();
   return *this;
 }
 
 UIObject::UIObject(UIObject&& other) : Object(other) {
   pos_ = std::move(other.pos_);
   size_ = std::move(other.size_);
-
-  valid_ = other.valid_.load();
+  fb_ = std::make_shared<Framebuffer>(std::move(*other.fb_));
+
+  valid_ = other.valid_;
+  damaged_ = other.damaged_;
+  pending_min_ = other.pending_min_;
+  pending_max_ = other.pending_max_;
+  damage_min_ = damage_max_ = glm::ivec2(0);
+  last_redraw_ = {};
+  tally_ = nullptr;
   parent_ = std::weak_ptr<UIObject>();
+  layout_index_ = -1;
+  sibling_order_ = 0;
+  hit_slot_ = -1;
 }
 
 UIObject& UIObject::operator=(UIObject&& other) {
@@ -326,8 +553,11 @@ UIObject& UIObject::operator=(UIObject&& other) {
   pos_ = std::move(other.pos_);
   size_ = std::move(other.size_);
 
-  valid_ = other.valid_.load();
+  valid_ = other.valid_;
   parent_ = std::weak_ptr<UIObject>();
+  if (!valid_) {
+    MarkDamaged();
+  }
 
   return *this;
 }
@@ -8,15 +8,13 @@ ActiveCameraFindVisitor::ActiveCameraFindVisitor() : active_camera_(nullptr), ca
 
 void ActiveCameraFindVisitor::Visit(std::shared_ptr<Object> o) {
   if (!cam_found_.load()) {
-    auto children = o->GetChildren();
-    ActiveCameraVisitChildren(children);
+    VisitChildren(o);
   }
 }
 
 void ActiveCameraFindVisitor::Visit(std::shared_ptr<GameObject> o) {
   if (!cam_found_.load()) {
-    auto children = o->GetChildren();
-    ActiveCameraVisitChildren(children);
+    VisitChildren(o);
   }
 }
 
@@ -26,23 +24,21 @@ void ActiveCameraFindVisitor::Visit(std::shared_ptr<GameCamera> o) {
   if (o->IsActive()) {
     active_camera_ = o;
     cam_found_.store(true);
+    StopVisiting();
   } else {
-    auto children = o->GetChildren();
-    ActiveCameraVisitChildren(children);
+    VisitChildren(o);
   }
 }
 
 void ActiveCameraFindVisitor::Visit(std::shared_ptr<shader::light::SpotLight> o) {
   if (!cam_found_.load()) {
-    auto children = o->GetChildren();
-    ActiveCameraVisitChildren(children);
+    VisitChildren(o);
   }
 }
 
 void ActiveCameraFindVisitor::Visit(std::shared_ptr<font::TextObject> o) {
   if (!cam_found_.load()) {
-    auto children = o->GetChildren();
-    ActiveCameraVisitChildren(children);
+    VisitChildren(o);
   }
 }
 
@@ -59,19 +55,6 @@ void ActiveCameraFindVisitor::Clear() {
   cam_found_.store(false);
 }
 
-void ActiveCameraFindVisitor::ActiveCameraVisitChildren(std::vector<std::shared_ptr<Object>>& ol) {
-  // visit all children
-  // check if flag is raised
-  // if so: break
-  for (auto child : ol) {
-    child->Accept(*this);
-
-    if (cam_found_.load()) {
-      break;
-    }
-  }
-}
-
 }
 }
 }
\ No newline at end of file
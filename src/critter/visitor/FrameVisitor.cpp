@@ -0,0 +1,136 @@
+#include <critter/visitor/FrameVisitor.hpp>
+
+namespace monkeysworld {
+namespace critter {
+namespace visitor {
+
+using shader::light::SpotLight;
+
+FrameVisitor::FrameVisitor() {}
+
+FrameVisitor::FrameVisitor(std::shared_ptr<file::LoaderThreadPool> update_pool)
+  : updater_(std::make_unique<ParallelUpdater>(update_pool)) { }
+
+void FrameVisitor::Visit(std::shared_ptr<Object> o) {
+  Hold(std::move(o));
+}
+
+void FrameVisitor::Visit(std::shared_ptr<GameObject> o) {
+  Hold(std::move(o));
+}
+
+void FrameVisitor::Visit(std::shared_ptr<GameCamera> o) {
+  cameras_.push_back(o.get());
+  Hold(std::move(o));
+}
+
+void FrameVisitor::Visit(std::shared_ptr<SpotLight> o) {
+  spotlights_.push_back(o.get());
+  Hold(std::move(o));
+}
+
+void FrameVisitor::Visit(std::shared_ptr<font::TextObject> o) {
+  Hold(std::move(o));
+}
+
+void FrameVisitor::UpdateAndGather(Object* root) {
+  Clear();
+  if (updater_ == nullptr) {
+    // Visit never calls VisitChildren -- the walk takes care of descending
+    walker_.Walk(root, [this](Object* o) {
+      o->Update();
+      Gather(o);
+    });
+
+    FindSubtreeEnds();
+    return;
+  }
+
+  // thread-safe subtrees are left for the updater
+  walker_.Walk(root, [this](Object* o) {
+    if (o->IsUpdateThreadSafe()) {
+      updater_->Schedule(o);
+      return WALK_SKIP_CHILDREN;
+    }
+
+    o->Update();
+    Gather(o);
+    return WALK_CONTINUE;
+  });
+
+  if (updater_->HasScheduled()) {
+    updater_->Run();
+    Clear();
+    walker_.Walk(root, [this](Object* o) {
+      Gather(o);
+    });
+  }
+
+  FindSubtreeEnds();
+}
+
+void FrameVisitor::Gather(Object* o) {
+  // every Visit adds exactly one entry to the render list
+  o->Accept(*this);
+  depths_.push_back(static_cast<uint32_t>(walker_.GetDepth()));
+}
+
+void FrameVisitor::Hold(std::shared_ptr<Object> o) {
+  // Accept already made a reference for us, so holding onto it costs nothing extra
+  render_list_.push_back(o.get());
+  held_.push_back(std::move(o));
+}
+
+void FrameVisitor::FindSubtreeEnds() {
+  // a subtree ends at the next entry which is no deeper than its root
+  size_t count = render_list_.size();
+  subtree_ends_.resize(count);
+  open_.clear();
+  for (size_t i = 0; i < count; i++) {
+    while (!open_.empty() && depths_[open_.back()] >= depths_[i]) {
+      subtree_ends_[open_.back()] = static_cast<uint32_t>(i);
+      open_.pop_back();
+    }
+
+    open_.push_back(static_cast<uint32_t>(i));
+  }
+
+  for (uint32_t i : open_) {
+    subtree_ends_[i] = static_cast<uint32_t>(count);
+  }
+}
+
+void FrameVisitor::Clear() {
+  render_list_.clear();
+  held_.clear();
+  depths_.clear();
+  subtree_ends_.clear();
+  spotlights_.clear();
+  cameras_.clear();
+}
+
+const std::vector<Object*>& FrameVisitor::GetRenderList() const {
+  return render_list_;
+}
+
+const std::vector<uint32_t>& FrameVisitor::GetSubtreeEnds() const {
+  return subtree_ends_;
+}
+
+const std::vector<SpotLight*>& FrameVisitor::GetSpotLights() const {
+  return spotlights_;
+}
+
+std::shared_ptr<GameCamera> FrameVisitor::GetActiveCamera() const {
+  for (auto camera : cameras_) {
+    if (camera->IsActive()) {
+      return std::static_pointer_cast<GameCamera>(camera->shared_from_this());
+    }
+  }
+
+  return std::shared_ptr<GameCamera>();
+}
+
+}
+}
+}
@@ -37,12 +37,6 @@ void LightVisitor::Visit(std::shared_ptr<SpotLight> o) {
   VisitChildren(o);
 }
 
-void LightVisitor::VisitChildren(std::shared_ptr<Object> o) {
-  for (auto child : o->GetChildren()) {
-    child->Accept(*this);
-  }
-}
-
 void LightVisitor::Clear() {
   spotlights_.clear();
 }
@@ -2,64 +2,57 @@
 #include <GLFW/glfw3.h>
 
 #include <engine/BaseEngine.hpp>
-#include <engine/RenderContext.hpp>
+#include <engine/FramePipeline.hpp>
+#include <engine/GLRenderBackend.hpp>
 
-#include <critter/visitor/ActiveCameraFindVisitor.hpp>
-#include <critter/visitor/LightVisitor.hpp>
+#include <critter/SceneWalker.hpp>
+#include <critter/visitor/FrameVisitor.hpp>
 
-#include <shader/light/LightTypes.hpp>
+#include <file/LoaderThreadPool.hpp>
 
 // TODO: create an actual logging setup -- we can config it in init :)
 #include <boost/log/trivial.hpp>
 
-#include <critter/ui/UIObject.hpp>
-
 #ifdef DEBUG
 #include <shader/GLDebugSetup.hpp>
 #endif
 
+#include <algorithm>
 #include <chrono>
+#include <thread>
 
 
 namespace monkeysworld {
 namespace engine {
 namespace baseengine {
 
-using ::monkeysworld::critter::Camera;
-using ::monkeysworld::critter::visitor::ActiveCameraFindVisitor;
-using ::monkeysworld::critter::visitor::LightVisitor;
-
-using ::monkeysworld::shader::Material;
-using ::monkeysworld::shader::light::SpotLight;
-using ::monkeysworld::shader::light::spotlight_info;
-
-using ::monkeysworld::critter::ui::UIObject;
-
-using ::monkeysworld::engine::RenderContext;
+using ::monkeysworld::critter::Object;
+using ::monkeysworld::critter::SceneWalker;
+using ::monkeysworld::critter::visitor::FrameVisitor;
 
 /**
  *  Calls create funcs on all objects in the hierarchy.
  */ 
-static void CreateObjects(std::shared_ptr<critter::Object>);
+static void CreateObjects(std::shared_ptr<critter::Object>, SceneWalker&);
 
 /**
- *  Calls update funcs on all objects.
+ *  Simulates a single frame: updates the game tree, then captures it for the render stage.
  */ 
-static void UpdateObjects(std::shared_ptr<critter::Object>);
+static void SimulateFrame(EngineContext* ctx, FrameVisitor& frame_visitor, frame_snapshot& frame);
 
 /**
- *  Renders all objects nested within the passed root.
- */ 
-static void RenderObjects(std::shared_ptr<critter::Object>, RenderContext&);
+ *  Logs what the render stage has been up to.
+ *  @param ui - UI redraws, summed over the last STATS_INTERVAL frames.
+ *  @param framebuffers - the UI framebuffer pool's running totals.
+ */
+static void LogRenderStats(const critter::ui::redraw_stats& ui, const shader::framebuffer_pool_stats& framebuffers);
 
-/**
- *  Renders all UI objects.
- */ 
-static void RenderUI(std::shared_ptr<critter::Object>, RenderContext&);
+// frames between render stats logs
+static const uint64_t STATS_INTERVAL = 600;
 
 // subtype context to enable access to frequent update functions
 // pass supertype to scene
-void GameLoop(std::shared_ptr<engine::EngineContext> ctx, GLFWwindow* window) {
+void GameLoop(std::shared_ptr<engine::EngineContext> ctx, GLFWwindow* window, bool pipelined) {
   #ifdef DEBUG
   if (GLAD_GL_ARB_debug_output) {
     BOOST_LOG_TRIVIAL(debug) << "GL debug output supported!";
@@ -67,12 +60,15 @@ void GameLoop(std::shared_ptr<engine::EngineContext> ctx, GLFWwindow* window) {
   }
   #endif
 
-  LightVisitor light_visitor;
-  ActiveCameraFindVisitor cam_visitor;
-  
+  // objects which opt in are updated across the other cores -- the simulating thread pitches in as well.
+  // kept apart from the loaders' pool, so that a long load can't hold up a frame.
+  int update_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 0);
+  auto update_pool = std::make_shared<file::LoaderThreadPool>(update_threads);
 
-  RenderContext rc;
-  std::vector<spotlight_info> spotlights;
+  // updates the game tree, and gathers lights, cameras and renderables in the same pass
+  FrameVisitor frame_visitor(update_pool);
+  // reused every frame, so that walking the scene doesn't allocate
+  SceneWalker walker;
 
   glfwSwapInterval(0);
   glEnable(GL_DEPTH_TEST);
@@ -80,139 +76,82 @@ void GameLoop(std::shared_ptr<engine::EngineContext> ctx, GLFWwindow* window) {
 
   ctx->InitializeScene();
 
-  CreateObjects(ctx->GetScene()->GetGameObjectRoot());
-  CreateObjects(std::dynamic_pointer_cast<EngineWindow>(ctx->GetScene()->GetWindow())->GetRootObject());
+  CreateObjects(ctx->GetScene()->GetGameObjectRoot(), walker);
+  CreateObjects(std::dynamic_pointer_cast<EngineWindow>(ctx->GetScene()->GetWindow())->GetRootObject(), walker);
 
-  while(!glfwWindowShouldClose(window)) {
-    // reset any visitors which store info
-    light_visitor.Clear();
-    cam_visitor.Clear();
+  // `ctx` is only swapped while the simulation is idle
+  FramePipeline pipeline([&](frame_snapshot& frame) {
+    SimulateFrame(ctx.get(), frame_visitor, frame);
+  }, pipelined);
 
-    glClearColor(0.0, 0.0, 0.0, 1.0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  GLRenderBackend backend(window);
+  uint64_t frames = 0;
+  critter::ui::redraw_stats ui_stats = {};
 
-    auto win = std::dynamic_pointer_cast<EngineWindow>(ctx->GetScene()->GetWindow());
+  while(!glfwWindowShouldClose(window)) {
+    const frame_snapshot& frame = pipeline.WaitForFrame();
+
+    // the simulation is idle until the next frame starts -- anything which touches the game tree
+    // from outside of an update (input, executor tasks, scene swaps) has to happen here
+    glfwPollEvents();
+    ctx->UpdateContext();
 
     // swap to the new context if it's ready :)
     if (auto ctx_new = ctx->GetNewContext()) {
+      // the finished frame belongs to the old scene, so it's dropped rather than drawn
+      pipeline.Reset();
       ctx = ctx_new;
       auto scene = ctx_new->GetScene();
-      CreateObjects(scene->GetGameObjectRoot());
-      win = std::dynamic_pointer_cast<EngineWindow>(scene->GetWindow());
-      CreateObjects(win->GetRootObject());
+      CreateObjects(scene->GetGameObjectRoot(), walker);
+      auto win = std::dynamic_pointer_cast<EngineWindow>(scene->GetWindow());
+      CreateObjects(win->GetRootObject(), walker);
+      pipeline.StartNextFrame();
+      continue;
     }
 
-    auto scene = ctx->GetScene();
-    if (scene->GetGameObjectRoot()) {
-      UpdateObjects(scene->GetGameObjectRoot());
-      scene->GetGameObjectRoot()->Accept(light_visitor);
-      scene->GetGameObjectRoot()->Accept(cam_visitor);
-    }
-
-    UpdateObjects(win->GetRootObject());
-    // for each light:
-    //   - do a depth render from the perspective of our lights
-
-
-    // for now: put the lights by themselves in our render context
-
-    // SHADOW PASS -- get shadow info
-    // add light info to the render context, in appropriate places
-    // shadow pass is still a TODO. :)
-
-    // only spotlights for now -- the goal:
-    //   - see which lights are in the scene
-    //   - run the light pass for each one
-    //   - note: there should be a method which contains all GL calls required to draw the object
-    //   - that way, we can separate material configuration from drawing
-    //   - add a method to Object which accomplishes this
-
-    // MEMORY ISSUE: spotlights were never cleared, so the list just builds and builds -- slowdown increases over time because we spend so much time
-    // passing around a massive array of spotlights
-    spotlights.clear();
-    for (auto light : light_visitor.GetSpotLights()) {
-      // no render context needed -- we're just preparing attributes and calling a default shadow func
-      // we want to have the shadow map shader prepared beforehand
-
-      spotlights.push_back(light->GetSpotLightInfo());
+    // the UI isn't captured, so it's drawn before the simulation can touch it again
+    backend.SetContext(ctx.get());
+    backend.PrepareUI(frame);
+    pipeline.StartNextFrame();
+    backend.Render(frame);
+
+    const render_stats& stats = backend.GetStats();
+    ui_stats.objects += stats.ui.objects;
+    ui_stats.pixels += stats.ui.pixels;
+    ui_stats.draws += stats.ui.draws;
+    if (++frames % STATS_INTERVAL == 0) {
+      LogRenderStats(ui_stats, stats.framebuffers);
+      ui_stats = {};
     }
-    rc.SetSpotlights(spotlights);
-    rc.SetActiveCamera(std::static_pointer_cast<Camera>(cam_visitor.GetActiveCamera()));
-    ctx->GetCurrentFrame()->BindFramebuffer(shader::FramebufferTarget::DEFAULT);
-    int w, h;
-    ctx->GetFramebufferSize(&w, &h);
-    glViewport(0, 0, w, h);
-    RenderObjects(scene->GetGameObjectRoot(), rc);
-
-    
-    
-    // render UI
-    win->Layout();
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDisable(GL_DEPTH_TEST);
-    RenderUI(win->GetRootObject(), rc);
-    glViewport(0, 0, w, h);
-    ctx->GetCurrentFrame()->BindFramebuffer(shader::FramebufferTarget::DEFAULT);
-    auto ui_root = std::dynamic_pointer_cast<UIObject>(win->GetRootObject());
-    if (ui_root) {
-      ui_root->DrawToScreen();
-    }
-
-    glEnable(GL_DEPTH_TEST);
-
-    // blit last frame to current
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    ctx->GetCurrentFrame()->BindFramebuffer(shader::FramebufferTarget::READ);
-    glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-    glfwSwapBuffers(window);
-    glfwPollEvents();
-    ctx->UpdateContext();
-    ctx->GetCurrentFrame()->BindFramebuffer(shader::FramebufferTarget::DEFAULT);
-  }
-}
-
-void CreateObjects(std::shared_ptr<critter::Object> obj) {
-  obj->Create();
-  for (auto child : obj->GetChildren()) {
-    CreateObjects(child);
   }
 }
 
-void UpdateObjects(std::shared_ptr<critter::Object> obj) {
-  // call update func
-  obj->Update();
-  for (auto child : obj->GetChildren()) {
-    // if child exists, visit it and queue up its children
-    UpdateObjects(child);
-  }
+void CreateObjects(std::shared_ptr<critter::Object> obj, SceneWalker& walker) {
+  walker.Walk(obj.get(), [](Object* o) {
+    o->Create();
+  });
 }
 
-// simple render pass (albedo only)
-// TODO: expand so that we prepare the render context,
-//       then visit each component with shadows, etc
-//       prepared!
-void RenderObjects(std::shared_ptr<critter::Object> obj, RenderContext& rc) {
-  // todo: generate this on the fly!
-  if (!obj) {
-    // nothing to render!
-    return;
-  }
-
-  obj->PrepareAttributes();
-  obj->RenderMaterial(rc);
-  for (auto child : obj->GetChildren()) {
-    RenderObjects(child, rc);
-  }
+void LogRenderStats(const critter::ui::redraw_stats& ui, const shader::framebuffer_pool_stats& framebuffers) {
+  BOOST_LOG_TRIVIAL(debug) << "UI over " << STATS_INTERVAL << " frames: " << ui.objects << " redraws, "
+                           << ui.pixels << " px, " << ui.draws << " composite draws";
+  BOOST_LOG_TRIVIAL(debug) << "UI framebuffers: " << framebuffers.targets << " targets ("
+                           << framebuffers.bytes << " bytes, " << framebuffers.idle_bytes << " idle), "
+                           << framebuffers.reuses << "/" << framebuffers.leases << " leases reused, "
+                           << framebuffers.evictions << " evicted";
 }
 
-void RenderUI(std::shared_ptr<critter::Object> obj, RenderContext& rc) {
-  if (!obj) {
-    return;
+void SimulateFrame(EngineContext* ctx, FrameVisitor& frame_visitor, frame_snapshot& frame) {
+  auto scene = ctx->GetScene();
+  frame_visitor.Clear();
+  if (scene->GetGameObjectRoot()) {
+    frame_visitor.UpdateAndGather(scene->GetGameObjectRoot().get());
+    // one pass over every transform, so that capturing them is just a copy
+    ctx->GetTransformHierarchy()->Update();
   }
 
-  // note: components can fuck it up when they want to :)
-  obj->RenderMaterial(rc);
+  FramePipeline::CaptureFrame(frame_visitor, frame);
+  frame.window = scene->GetWindow();
 }
 
 GLFWwindow* InitializeGLFW(int win_width, int win_height, const std::string& window_name) {
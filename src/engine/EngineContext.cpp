@@ -14,6 +14,9 @@ EngineContext::EngineContext(GLFWwindow* window, Scene* scene) {
   event_mgr_ = std::make_shared<input::WindowEventManager>(window, this);
   audio_mgr_ = std::make_shared<AudioManager>();
   executor_ = std::make_shared<EngineExecutor>();
+  transforms_ = std::make_shared<critter::TransformHierarchy>();
+  registry_ = std::make_shared<critter::ObjectRegistry>();
+  fb_pool_ = std::make_shared<shader::FramebufferPool>();
 
   window_ = window;
 
@@ -61,6 +64,18 @@ std::shared_ptr<Executor<>> EngineContext::GetExecutor() {
   return executor_;
 }
 
+std::shared_ptr<critter::TransformHierarchy> EngineContext::GetTransformHierarchy() {
+  return transforms_;
+}
+
+std::shared_ptr<critter::ObjectRegistry> EngineContext::GetObjectRegistry() {
+  return registry_;
+}
+
+std::shared_ptr<shader::FramebufferPool> EngineContext::GetFramebufferPool() {
+  return fb_pool_;
+}
+
 std::shared_ptr<shader::Framebuffer> EngineContext::GetLastFrame() {
   if (a_front_) {
     return fb_a_;
@@ -142,6 +157,11 @@ EngineContext::EngineContext(const EngineContext& other, Scene* scene) {
   audio_mgr_ = other.audio_mgr_;
   window_ = other.window_;
   executor_ = other.executor_;
+  // each scene gets its own, so scenes being set up don't touch the one being drawn
+  transforms_ = std::make_shared<critter::TransformHierarchy>();
+  registry_ = std::make_shared<critter::ObjectRegistry>();
+  // GL objects outlive scenes, so the pool carries over
+  fb_pool_ = other.fb_pool_;
 
   initialized_ = false;
 
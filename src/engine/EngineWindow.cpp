@@ -36,6 +36,10 @@ bool EngineWindow::HandleClickEvent(input::MouseEvent& e) {
   return root_ui_->HandleClickEvent(e);
 }
 
+void EngineWindow::HandleHoverEvent(input::MouseEvent& e) {
+  root_ui_->HandleHoverEvent(e);
+}
+
 glm::vec2 EngineWindow::GetDimensions() const {
   return root_ui_->GetDimensions();
 }
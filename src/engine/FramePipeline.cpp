@@ -0,0 +1,114 @@
+#include <engine/FramePipeline.hpp>
+
+namespace monkeysworld {
+namespace engine {
+
+using critter::Camera;
+using critter::GameObject;
+using critter::Object;
+using critter::visitor::FrameVisitor;
+using shader::light::spotlight_info;
+using utils::Frustum;
+
+FramePipeline::FramePipeline(simulate_func simulate, bool pipelined)
+  : simulate_(simulate), front_(0), next_frame_(0), sim_thread_(pipelined ? 1 : 0) { }
+
+const frame_snapshot& FramePipeline::WaitForFrame() {
+  if (!in_flight_.valid()) {
+    StartNextFrame();
+  }
+
+  // get invalidates the future, so the next wait knows to start a frame
+  in_flight_.get();
+  front_ = 1 - front_;
+  for (auto& item : snapshots_[front_].items) {
+    item.object->SyncRenderState();
+  }
+
+  return snapshots_[front_];
+}
+
+void FramePipeline::StartNextFrame() {
+  frame_snapshot& back = snapshots_[1 - front_];
+  // drop the last frame's references here, so that any objects which have left the scene
+  // are destroyed on this thread, rather than the simulation's
+  back.items.clear();
+  back.window = nullptr;
+  back.culling = {};
+  back.frame = next_frame_++;
+  in_flight_ = sim_thread_.Submit([this, &back] {
+    simulate_(back);
+  }, file::PRIORITY_HIGH);
+}
+
+void FramePipeline::Reset() {
+  for (auto& snapshot : snapshots_) {
+    snapshot.items.clear();
+    snapshot.window = nullptr;
+    snapshot.culling = {};
+  }
+}
+
+bool FramePipeline::IsPipelined() const {
+  return (sim_thread_.GetThreadCount() > 0);
+}
+
+void FramePipeline::CaptureFrame(const FrameVisitor& visitor, frame_snapshot& frame) {
+  std::vector<spotlight_info> spotlights;
+  for (auto light : visitor.GetSpotLights()) {
+    spotlights.push_back(light->GetSpotLightInfo());
+  }
+
+  frame.rc.SetSpotlights(spotlights);
+  auto camera = visitor.GetActiveCamera();
+  frame.rc.SetActiveCamera(std::static_pointer_cast<Camera>(camera));
+  if (camera != nullptr) {
+    Frustum frustum(frame.rc.GetActiveCamera().vp_matrix);
+    CaptureItems(visitor, &frustum, frame);
+  } else {
+    // the stand-in camera doesn't know the screen's aspect ratio, so we can't trust it to cull
+    CaptureItems(visitor, nullptr, frame);
+  }
+}
+
+void FramePipeline::CaptureItems(const FrameVisitor& visitor, const Frustum* frustum, frame_snapshot& frame) {
+  const std::vector<Object*>& list = visitor.GetRenderList();
+  const std::vector<uint32_t>& ends = visitor.GetSubtreeEnds();
+  cull_stats& stats = frame.culling;
+  size_t i = 0;
+  while (i < list.size()) {
+    // the game tree is made up of GameObjects
+    auto object = static_cast<GameObject*>(list[i]);
+    if (frustum != nullptr) {
+      stats.tested++;
+      if (!frustum->TestBox(object->GetSubtreeBounds())) {
+        stats.culled += ends[i] - static_cast<uint32_t>(i);
+        i = ends[i];
+        continue;
+      }
+
+      // some of the subtree is visible, but maybe not this object. leaves have nothing more to check
+      if (ends[i] > i + 1) {
+        stats.tested++;
+        if (!frustum->TestBox(object->GetWorldBounds())) {
+          stats.culled++;
+          i++;
+          continue;
+        }
+      }
+    }
+
+    frame.items.push_back({ object->shared_from_this(), object->GetTransformationMatrix(), object->GetNormalMatrix() });
+    stats.drawn++;
+    i++;
+  }
+}
+
+FramePipeline::~FramePipeline() {
+  if (in_flight_.valid()) {
+    in_flight_.wait();
+  }
+}
+
+}
+}
@@ -0,0 +1,78 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <engine/GLRenderBackend.hpp>
+#include <engine/EngineWindow.hpp>
+
+namespace monkeysworld {
+namespace engine {
+
+using critter::Object;
+
+GLRenderBackend::GLRenderBackend(GLFWwindow* window) : window_(window), ctx_(nullptr), width_(0), height_(0) { }
+
+void GLRenderBackend::SetContext(EngineContext* ctx) {
+  ctx_ = ctx;
+}
+
+void GLRenderBackend::BeginFrame(const frame_snapshot& frame) {
+  ctx_->GetCurrentFrame()->BindFramebuffer(shader::FramebufferTarget::DEFAULT);
+  glClearColor(0.0, 0.0, 0.0, 1.0);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  ctx_->GetFramebufferSize(&width_, &height_);
+  glViewport(0, 0, width_, height_);
+}
+
+void GLRenderBackend::DrawObject(const render_item& item, const RenderContext& rc) {
+  // simple render pass (albedo only)
+  item.object->PrepareAttributes();
+  item.object->RenderMaterial(rc);
+}
+
+void GLRenderBackend::UpdateUI(const frame_snapshot& frame, const RenderContext& rc) {
+  auto win = std::dynamic_pointer_cast<EngineWindow>(frame.window);
+  if (!win) {
+    return;
+  }
+
+  walker_.Walk(win->GetRootObject().get(), [](Object* o) {
+    o->Update();
+  });
+
+  win->Layout();
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDisable(GL_DEPTH_TEST);
+  // note: components can fuck it up when they want to :)
+  win->GetRootObject()->RenderMaterial(rc);
+  stats_.ui = win->GetRootObject()->GetRedrawStats();
+  stats_.framebuffers = ctx_->GetFramebufferPool()->GetStats();
+  glEnable(GL_DEPTH_TEST);
+}
+
+void GLRenderBackend::DrawUI(const frame_snapshot& frame, const RenderContext& rc) {
+  auto win = std::dynamic_pointer_cast<EngineWindow>(frame.window);
+  if (!win) {
+    return;
+  }
+
+  // the root was sized by the last layout, which can't run again until the simulation is idle
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDisable(GL_DEPTH_TEST);
+  glViewport(0, 0, width_, height_);
+  ctx_->GetCurrentFrame()->BindFramebuffer(shader::FramebufferTarget::DEFAULT);
+  win->GetRootObject()->DrawToScreen();
+  glEnable(GL_DEPTH_TEST);
+}
+
+void GLRenderBackend::EndFrame(const frame_snapshot& frame) {
+  // blit last frame to current
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  ctx_->GetCurrentFrame()->BindFramebuffer(shader::FramebufferTarget::READ);
+  glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  glfwSwapBuffers(window_);
+}
+
+}
+}
@@ -0,0 +1,60 @@
+#include <engine/RecordingRenderBackend.hpp>
+#include <engine/EngineWindow.hpp>
+
+namespace monkeysworld {
+namespace engine {
+
+const std::vector<recorded_call>& RecordingRenderBackend::GetCalls() const {
+  return calls_;
+}
+
+void RecordingRenderBackend::Clear() {
+  calls_.clear();
+}
+
+void RecordingRenderBackend::BeginFrame(const frame_snapshot& frame) {
+  frame_ = frame.frame;
+  Record(CALL_BEGIN_FRAME, frame);
+}
+
+void RecordingRenderBackend::DrawObject(const render_item& item, const RenderContext& rc) {
+  recorded_call res;
+  res.call = CALL_DRAW_OBJECT;
+  res.frame = frame_;
+  res.object_id = item.object->GetId();
+  res.model_matrix = rc.GetModelMatrix();
+  res.camera_position = rc.GetActiveCamera().position;
+  res.thread = std::this_thread::get_id();
+  calls_.push_back(res);
+}
+
+void RecordingRenderBackend::UpdateUI(const frame_snapshot& frame, const RenderContext& rc) {
+  Record(CALL_UPDATE_UI, frame);
+  if (auto win = std::dynamic_pointer_cast<EngineWindow>(frame.window)) {
+    walker_.Walk(win->GetRootObject().get(), [](critter::Object* o) {
+      o->Update();
+    });
+  }
+}
+
+void RecordingRenderBackend::DrawUI(const frame_snapshot& frame, const RenderContext& rc) {
+  Record(CALL_DRAW_UI, frame);
+}
+
+void RecordingRenderBackend::EndFrame(const frame_snapshot& frame) {
+  Record(CALL_END_FRAME, frame);
+}
+
+void RecordingRenderBackend::Record(RenderCall call, const frame_snapshot& frame) {
+  recorded_call res;
+  res.call = call;
+  res.frame = frame.frame;
+  res.object_id = 0;
+  res.model_matrix = glm::mat4(1.0);
+  res.camera_position = frame.rc.GetActiveCamera().position;
+  res.thread = std::this_thread::get_id();
+  calls_.push_back(res);
+}
+
+}
+}
@@ -0,0 +1,31 @@
+#include <engine/RenderBackend.hpp>
+
+namespace monkeysworld {
+namespace engine {
+
+void RenderBackend::Render(const frame_snapshot& frame) {
+  rc_ = frame.rc;
+  BeginFrame(frame);
+  for (auto& item : frame.items) {
+    rc_.SetModelTransforms(item.model_matrix, item.normal_matrix);
+    DrawObject(item, rc_);
+  }
+
+  rc_.SetModelTransforms(glm::mat4(1.0), glm::mat3(1.0));
+  DrawUI(frame, rc_);
+  EndFrame(frame);
+}
+
+void RenderBackend::PrepareUI(const frame_snapshot& frame) {
+  rc_ = frame.rc;
+  stats_ = {};
+  rc_.SetModelTransforms(glm::mat4(1.0), glm::mat3(1.0));
+  UpdateUI(frame, rc_);
+}
+
+const render_stats& RenderBackend::GetStats() const {
+  return stats_;
+}
+
+}
+}
@@ -20,6 +20,14 @@ RenderPass RenderContext::GetRenderPass() const {
   return rp_;
 }
 
+const glm::mat4& RenderContext::GetModelMatrix() const {
+  return model_matrix_;
+}
+
+const glm::mat3& RenderContext::GetNormalMatrix() const {
+  return normal_matrix_;
+}
+
 void RenderContext::SetActiveCamera(std::shared_ptr<Camera> cam) {
   if (cam) {
     cam_info_ = cam->GetCameraInfo();
@@ -45,5 +53,10 @@ void RenderContext::SetRenderPass(RenderPass rp) {
   rp_ = rp;
 }
 
+void RenderContext::SetModelTransforms(const glm::mat4& model_matrix, const glm::mat3& normal_matrix) {
+  model_matrix_ = model_matrix;
+  normal_matrix_ = normal_matrix;
+}
+
 }
 }
\ No newline at end of file
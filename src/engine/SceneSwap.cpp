@@ -20,6 +20,10 @@ file::loader_progress SceneSwap::GetLoaderProgress() {
   return ctx_->GetCachedFileLoader()->GetLoaderProgress();
 }
 
+std::shared_ptr<file::LoaderTelemetry> SceneSwap::GetLoaderTelemetry() {
+  return ctx_->GetCachedFileLoader()->GetTelemetry();
+}
+
 void SceneSwap::Swap() {
   if (!swap_ready_) {
     std::unique_lock<std::mutex> lock(*mutex_);
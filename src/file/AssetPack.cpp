@@ -0,0 +1,378 @@
+#include <file/AssetPack.hpp>
+#include <file/BakedMesh.hpp>
+#include <file/ModelLoader.hpp>
+#include <file/exception/FileNotFoundException.hpp>
+
+#include <shader/Texture.hpp>
+
+#include <boost/log/trivial.hpp>
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <tuple>
+
+namespace monkeysworld {
+namespace file {
+
+using exception::FileNotFoundException;
+using model::Mesh;
+using storage::VertexPacket3D;
+
+namespace fs = std::filesystem;
+
+/**
+ *  Orders entries by type, then path. The table of contents is stored in this order.
+ */
+static bool EntryLess(uint16_t type_a, std::string_view path_a, uint16_t type_b, std::string_view path_b) {
+  return std::tie(type_a, path_a) < std::tie(type_b, path_b);
+}
+
+AssetPack::AssetPack(MappedFile&& file) : file_(std::move(file)),
+                                          toc_(nullptr),
+                                          strings_(nullptr),
+                                          entry_count_(0) { }
+
+std::shared_ptr<AssetPack> AssetPack::Open(const std::string& pack_path) {
+  std::error_code err;
+  if (!fs::exists(pack_path, err)) {
+    return nullptr;
+  }
+
+  std::shared_ptr<AssetPack> pack;
+  try {
+    // ctor is private, so make_shared won't do
+    pack = std::shared_ptr<AssetPack>(new AssetPack(MappedFile(pack_path)));
+  } catch (FileNotFoundException& e) {
+    BOOST_LOG_TRIVIAL(warning) << "could not map asset pack " << pack_path;
+    return nullptr;
+  }
+
+  if (!pack->Validate(pack_path)) {
+    return nullptr;
+  }
+
+  BOOST_LOG_TRIVIAL(debug) << "asset pack " << pack_path << " with " << pack->entry_count_ << " entries found";
+  return pack;
+}
+
+bool AssetPack::Validate(const std::string& pack_path) {
+  uint64_t size = file_.GetSize();
+  if (size < sizeof(asset_pack_header)) {
+    BOOST_LOG_TRIVIAL(warning) << "asset pack " << pack_path << " is truncated";
+    return false;
+  }
+
+  asset_pack_header header;
+  std::memcpy(&header, file_.GetData(), sizeof(header));
+  if (header.magic != ASSET_PACK_MAGIC || header.version != ASSET_PACK_VERSION) {
+    BOOST_LOG_TRIVIAL(warning) << "asset pack " << pack_path << " has an incompatible header";
+    return false;
+  }
+
+  // written this way to avoid overflow on garbage counts
+  if (header.toc_offset % ASSET_PACK_ALIGNMENT != 0
+   || header.toc_offset > size
+   || header.entry_count > (size - header.toc_offset) / sizeof(asset_pack_entry)
+   || header.strings_offset > size
+   || header.strings_size > size - header.strings_offset) {
+    BOOST_LOG_TRIVIAL(warning) << "asset pack " << pack_path << " is truncated or malformed";
+    return false;
+  }
+
+  toc_ = reinterpret_cast<const asset_pack_entry*>(file_.GetData() + header.toc_offset);
+  strings_ = file_.GetData() + header.strings_offset;
+  entry_count_ = header.entry_count;
+
+  for (uint64_t i = 0; i < entry_count_; i++) {
+    const asset_pack_entry& entry = toc_[i];
+    if (entry.path_offset > header.strings_size
+     || entry.path_length > header.strings_size - entry.path_offset
+     || entry.data_offset % ASSET_PACK_ALIGNMENT != 0
+     || entry.data_offset > size
+     || entry.data_size > size - entry.data_offset) {
+      BOOST_LOG_TRIVIAL(warning) << "asset pack " << pack_path << " contains an out of range entry";
+      return false;
+    }
+
+    // lookups binary search the toc, so it has to be in order
+    if (i > 0 && !EntryLess(toc_[i - 1].type, GetPath(toc_[i - 1]), entry.type, GetPath(entry))) {
+      BOOST_LOG_TRIVIAL(warning) << "asset pack " << pack_path << " is not sorted";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::string_view AssetPack::GetPath(const asset_pack_entry& entry) const {
+  return std::string_view(strings_ + entry.path_offset, entry.path_length);
+}
+
+const asset_pack_entry* AssetPack::Find(CacheType type, const std::string& path) const {
+  uint16_t key_type = static_cast<uint16_t>(type);
+  std::string_view key_path(path);
+  const asset_pack_entry* end = toc_ + entry_count_;
+  auto res = std::lower_bound(toc_, end, key_path, [&](const asset_pack_entry& entry, std::string_view key) {
+    return EntryLess(entry.type, GetPath(entry), key_type, key);
+  });
+
+  if (res == end || res->type != key_type || GetPath(*res) != key_path) {
+    return nullptr;
+  }
+
+  return res;
+}
+
+asset_stamp AssetPack::GetStamp(const asset_pack_entry& entry) {
+  asset_stamp res;
+  res.source_size = entry.source_size;
+  res.mtime = entry.source_mtime;
+  res.content_hash = entry.content_hash;
+  return res;
+}
+
+std::shared_ptr<const char> AssetPack::GetFile(const std::string& path, uint64_t* size, asset_stamp* stamp) {
+  const asset_pack_entry* entry = Find(FILE, path);
+  if (entry == nullptr) {
+    return nullptr;
+  }
+
+  *size = entry->data_size;
+  if (stamp != nullptr) {
+    *stamp = GetStamp(*entry);
+  }
+
+  // shares ownership with the pack, so the mapping outlives any stream reading from it
+  return std::shared_ptr<const char>(shared_from_this(), GetData(*entry));
+}
+
+std::shared_ptr<shader::Texture> AssetPack::GetTexture(const std::string& path, asset_stamp* stamp) {
+  const asset_pack_entry* entry = Find(TEXTURE, path);
+  if (entry == nullptr || entry->data_size < sizeof(asset_pack_texture)) {
+    return nullptr;
+  }
+
+  asset_pack_texture tex;
+  std::memcpy(&tex, GetData(*entry), sizeof(tex));
+  if (tex.width <= 0 || tex.height <= 0 || tex.channels <= 0 || tex.channels > 4
+   || entry->data_size - sizeof(asset_pack_texture)
+        != static_cast<uint64_t>(tex.width) * tex.height * tex.channels) {
+    BOOST_LOG_TRIVIAL(warning) << "packed texture " << path << " is malformed";
+    return nullptr;
+  }
+
+  auto pixels = std::shared_ptr<const unsigned char>(
+    shared_from_this(),
+    reinterpret_cast<const unsigned char*>(GetData(*entry) + sizeof(asset_pack_texture)));
+  if (stamp != nullptr) {
+    *stamp = GetStamp(*entry);
+  }
+
+  return std::make_shared<shader::Texture>(pixels, tex.width, tex.height, tex.channels);
+}
+
+std::shared_ptr<Mesh<VertexPacket3D>> AssetPack::GetModel(const std::string& path,
+                                                        uint64_t* file_size,
+                                                        asset_stamp* stamp) {
+  const asset_pack_entry* entry = Find(MODEL, path);
+  if (entry == nullptr) {
+    return nullptr;
+  }
+
+  *file_size = entry->source_size;
+  if (stamp != nullptr) {
+    *stamp = GetStamp(*entry);
+  }
+
+  return ReadBakedMesh(GetData(*entry), entry->data_size, path);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PACK BUILDING                                                                                 //
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ *  @returns `offset`, rounded up to the next multiple of ASSET_PACK_ALIGNMENT.
+ */
+static uint64_t AlignUp(uint64_t offset) {
+  return (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+}
+
+/**
+ *  Pads `output` with zeroes until its position is a multiple of ASSET_PACK_ALIGNMENT.
+ */
+static void PadToAlignment(std::ostream& output) {
+  static const char zeroes[ASSET_PACK_ALIGNMENT] = {};
+  uint64_t pos = static_cast<uint64_t>(output.tellp());
+  output.write(zeroes, AlignUp(pos) - pos);
+}
+
+static bool WriteFileBlob(std::ostream& output, const std::string& path) {
+  std::unique_ptr<MappedFile> file;
+  try {
+    file = std::make_unique<MappedFile>(path);
+  } catch (FileNotFoundException& e) {
+    return false;
+  }
+
+  PadToAlignment(output);
+  output.write(file->GetData(), file->GetSize());
+  return true;
+}
+
+static bool WriteTextureBlob(std::ostream& output, const std::string& path) {
+  asset_pack_texture tex = {};
+  // match shader::Texture, so the pixels can be handed to GL as-is.
+  // packs may be written off the main thread, so only flip for this one
+  stbi_set_flip_vertically_on_load_thread(true);
+  unsigned char* pixels = stbi_load(path.c_str(), &tex.width, &tex.height, &tex.channels, 0);
+  if (pixels == nullptr) {
+    return false;
+  }
+
+  PadToAlignment(output);
+  output.write(reinterpret_cast<const char*>(&tex), sizeof(tex));
+  output.write(reinterpret_cast<const char*>(pixels), static_cast<uint64_t>(tex.width) * tex.height * tex.channels);
+  stbi_image_free(pixels);
+  return true;
+}
+
+static bool WriteModelBlob(std::ostream& output, const std::string& path, const std::string& bake_dir,
+                           uint64_t source_size, int64_t source_mtime) {
+  std::shared_ptr<Mesh<VertexPacket3D>> mesh;
+  try {
+    uint64_t file_size;
+    mesh = ModelLoader::FromBakedOrObjFile(path, &file_size, nullptr, bake_dir);
+  } catch (FileNotFoundException& e) {
+    return false;
+  }
+
+  PadToAlignment(output);
+  return WriteBakedMesh(output, *mesh, source_size, source_mtime);
+}
+
+bool WriteAssetPack(const std::string& pack_path,
+                    const std::vector<cache_record>& records,
+                    const std::string& bake_dir) {
+  std::error_code err;
+  fs::path dest(pack_path);
+  if (dest.has_parent_path()) {
+    fs::create_directories(dest.parent_path(), err);
+    if (err) {
+      BOOST_LOG_TRIVIAL(warning) << "could not create directory for asset pack " << pack_path;
+      return false;
+    }
+  }
+
+  // written in toc order, so entries come out sorted
+  std::vector<cache_record> sorted(records);
+  std::sort(sorted.begin(), sorted.end(), [](const cache_record& a, const cache_record& b) {
+    return EntryLess(a.type, a.path, b.type, b.path);
+  });
+
+  sorted.erase(std::unique(sorted.begin(), sorted.end(), [](const cache_record& a, const cache_record& b) {
+    return (a.type == b.type && a.path == b.path);
+  }), sorted.end());
+
+  std::vector<asset_pack_entry> toc;
+  std::string strings;
+
+  // write to a temp file first, so that readers never see a partial pack
+  std::string temp_path = pack_path + ".tmp";
+  {
+    std::ofstream output(temp_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!output.good()) {
+      BOOST_LOG_TRIVIAL(warning) << "could not open " << temp_path << " for packing";
+      return false;
+    }
+
+    asset_pack_header header = {};
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (auto& record : sorted) {
+      if (record.type != FILE && record.type != TEXTURE && record.type != MODEL) {
+        // loaded from disk as usual
+        continue;
+      }
+
+      asset_pack_entry entry = {};
+      asset_stamp stamp = record.stamp;
+      if (!UpdateAssetStamp(record.path, &stamp)) {
+        BOOST_LOG_TRIVIAL(warning) << "skipping " << record.path << " -- missing";
+        continue;
+      }
+
+      entry.source_size = stamp.source_size;
+      entry.source_mtime = stamp.mtime;
+      entry.content_hash = stamp.content_hash;
+
+      bool written;
+      switch (record.type) {
+        case FILE:
+          written = WriteFileBlob(output, record.path);
+          break;
+        case TEXTURE:
+          written = WriteTextureBlob(output, record.path);
+          break;
+        case MODEL:
+          written = WriteModelBlob(output, record.path, bake_dir, entry.source_size, entry.source_mtime);
+          break;
+        default:
+          continue;
+      }
+
+      if (!written) {
+        BOOST_LOG_TRIVIAL(warning) << "skipping " << record.path << " -- could not be read";
+        continue;
+      }
+
+      // blob writers only pad once they know they can write, so the blob
+      // starts at the first aligned boundary after the previous one
+      uint64_t start = AlignUp(toc.empty() ? sizeof(asset_pack_header)
+                                           : toc.back().data_offset + toc.back().data_size);
+      entry.type = static_cast<uint16_t>(record.type);
+      entry.path_length = static_cast<uint32_t>(record.path.size());
+      entry.path_offset = strings.size();
+      entry.data_offset = start;
+      entry.data_size = static_cast<uint64_t>(output.tellp()) - start;
+      strings += record.path;
+      toc.push_back(entry);
+    }
+
+    PadToAlignment(output);
+    header.magic = ASSET_PACK_MAGIC;
+    header.version = ASSET_PACK_VERSION;
+    header.entry_count = toc.size();
+    header.toc_offset = static_cast<uint64_t>(output.tellp());
+    output.write(reinterpret_cast<const char*>(toc.data()), sizeof(asset_pack_entry) * toc.size());
+    header.strings_offset = static_cast<uint64_t>(output.tellp());
+    header.strings_size = strings.size();
+    output.write(strings.data(), strings.size());
+
+    output.seekp(0);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!output.good()) {
+      BOOST_LOG_TRIVIAL(warning) << "failed to write asset pack " << temp_path;
+      output.close();
+      fs::remove(temp_path, err);
+      return false;
+    }
+  }
+
+  fs::rename(temp_path, dest, err);
+  if (err) {
+    BOOST_LOG_TRIVIAL(warning) << "could not move asset pack into place at " << pack_path;
+    fs::remove(temp_path, err);
+    return false;
+  }
+
+  BOOST_LOG_TRIVIAL(debug) << "packed " << toc.size() << " of " << records.size() << " assets into " << pack_path;
+  return true;
+}
+
+}
+}
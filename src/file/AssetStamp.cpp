@@ -0,0 +1,143 @@
+#include <file/AssetStamp.hpp>
+#include <file/MappedFile.hpp>
+#include <file/exception/FileNotFoundException.hpp>
+
+#include <utils/CRC32.hpp>
+
+#include <filesystem>
+#include <vector>
+
+namespace monkeysworld {
+namespace file {
+
+using exception::FileNotFoundException;
+
+namespace fs = std::filesystem;
+
+/**
+ *  Splits a cubemap path into its faces. Any other path is returned as-is.
+ */
+static std::vector<std::string> GetSourcePaths(const std::string& path) {
+  std::vector<std::string> res;
+  if (path.empty() || path[0] != ':') {
+    res.push_back(path);
+    return res;
+  }
+
+  size_t start = 1;
+  while (start <= path.size()) {
+    size_t end = path.find(':', start);
+    if (end == std::string::npos) {
+      end = path.size();
+    }
+
+    // matches boost::token_compress_on in the cubemap loader -- empty groups are skipped
+    if (end > start) {
+      res.push_back(path.substr(start, end - start));
+    }
+
+    start = end + 1;
+  }
+
+  return res;
+}
+
+/**
+ *  Hashes the contents of a single file.
+ *  @returns true if the file could be read, false otherwise.
+ */
+static bool HashFile(const std::string& path, uint32_t* hash) {
+  try {
+    MappedFile file(path);
+    *hash = utils::CRC32::Calculate(file.GetData(), file.GetSize());
+  } catch (FileNotFoundException& e) {
+    return false;
+  }
+
+  return true;
+}
+
+bool GetSourceStamp(const std::string& path, uint64_t* size, int64_t* mtime) {
+  std::error_code err;
+  auto file_size = fs::file_size(path, err);
+  if (err) {
+    return false;
+  }
+
+  auto write_time = fs::last_write_time(path, err);
+  if (err) {
+    return false;
+  }
+
+  *size = static_cast<uint64_t>(file_size);
+  *mtime = static_cast<int64_t>(write_time.time_since_epoch().count());
+  return true;
+}
+
+bool UpdateAssetStamp(const std::string& path, asset_stamp* stamp) {
+  std::vector<std::string> sources = GetSourcePaths(path);
+  if (sources.size() == 1) {
+    asset_stamp res = {};
+    if (!GetSourceStamp(sources[0], &res.source_size, &res.mtime)) {
+      return false;
+    }
+
+    if (res.source_size == stamp->source_size && res.mtime == stamp->mtime) {
+      return true;
+    }
+
+    if (!HashFile(sources[0], &res.content_hash)) {
+      return false;
+    }
+
+    *stamp = res;
+    return true;
+  }
+
+  // composite: every face is statted, and all of them are rehashed if any one was touched
+  asset_stamp res = {};
+  uint64_t mtime_mix = 0;
+  for (auto& source : sources) {
+    uint64_t size;
+    int64_t mtime;
+    if (!GetSourceStamp(source, &size, &mtime)) {
+      return false;
+    }
+
+    res.source_size += size;
+    mtime_mix = mtime_mix * 31 + static_cast<uint64_t>(mtime);
+  }
+
+  res.mtime = static_cast<int64_t>(mtime_mix);
+  if (res.source_size == stamp->source_size && res.mtime == stamp->mtime) {
+    return true;
+  }
+
+  utils::CRC32 crc;
+  for (auto& source : sources) {
+    uint32_t hash;
+    if (!HashFile(source, &hash)) {
+      return false;
+    }
+
+    crc.Update(&hash, sizeof(hash));
+  }
+
+  res.content_hash = crc.GetHash();
+  *stamp = res;
+  return true;
+}
+
+StampResult CheckAssetStamp(const std::string& path, asset_stamp* stamp) {
+  asset_stamp current = *stamp;
+  if (!UpdateAssetStamp(path, &current)) {
+    return STAMP_MISSING;
+  }
+
+  bool changed = (current.content_hash != stamp->content_hash);
+  *stamp = current;
+  return (changed ? STAMP_CHANGED : STAMP_CURRENT);
+}
+
+}
+}
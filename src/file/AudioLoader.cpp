@@ -8,7 +8,7 @@
 namespace monkeysworld {
 namespace file {
 
-AudioLoader::AudioLoader(std::shared_ptr<LoaderThreadPool> thread_pool, std::vector<cache_record> cache) : CachedLoader(thread_pool) {
+AudioLoader::AudioLoader(std::shared_ptr<LoaderThreadPool> thread_pool, std::vector<cache_record> cache) : CachedLoader(thread_pool, AUDIO) {
   loader_.bytes_read = loader_.bytes_sum = 0;
   for (auto record : cache) {
     if (record.type == AUDIO) {
@@ -25,6 +25,7 @@ std::vector<cache_record> AudioLoader::GetCache() {
     temp.file_size = record.second.sample_count;
     temp.path = record.first;
     temp.type = AUDIO;
+    temp.stamp = record.second.stamp;
     res.push_back(temp);
   }
 
@@ -58,7 +59,7 @@ bool AudioLoader::IsCached(const std::string& path) {
   return (cache_.find(path) != cache_.end());
 }
 
-std::shared_ptr<audio::AudioBuffer> AudioLoader::LoadFromPath(const std::string& path) {
+std::shared_ptr<audio::AudioBuffer> AudioLoader::LoadFromPath(const std::string& path, const asset_stamp& stamp) {
   std::vector<std::string> suffix;
   boost::split(suffix, path, [](char c){ return (c == '.'); }, boost::token_compress_on);
   if (suffix.size() == 0) {
@@ -78,16 +79,42 @@ std::shared_ptr<audio::AudioBuffer> AudioLoader::LoadFromPath(const std::string&
     return nullptr;
   }
 
-  if (IsCached(path)) {
+  uint64_t generation = GetGeneration();
+  AudioCache cache = {};
+  cache.stamp = stamp;
+  {
     std::unique_lock<std::mutex> lock(cache_mutex_);
-    auto entry = cache_.find(path)->second;
-    res->Write(entry.sample_count, entry.left, entry.right);
-  } else {
-    AudioCache cache;
-    int bytes_written = res->WriteFromFile(SAMPLE_COUNT);
-    res->Peek(bytes_written, cache.left, cache.right);
+    auto i = cache_.find(path);
+    if (i != cache_.end()) {
+      // the buffer streams the rest of the file, so stale samples would be spliced onto new audio
+      if (i->second.checked == generation || CheckAssetStamp(path, &i->second.stamp) != STAMP_CHANGED) {
+        i->second.checked = generation;
+        res->Write(i->second.sample_count, i->second.left, i->second.right);
+        return res;
+      }
+
+      BOOST_LOG_TRIVIAL(debug) << path << " changed on disk -- rereading samples";
+      cache.stamp = i->second.stamp;
+      delete[] i->second.left;
+      delete[] i->second.right;
+      cache_.erase(i);
+    }
+  }
+
+  // stamped first, so that a write which races with the read shows up as a change next time
+  UpdateAssetStamp(path, &cache.stamp);
+  cache.checked = generation;
+  int bytes_written = res->WriteFromFile(SAMPLE_COUNT);
+  cache.left = new float[bytes_written];
+  cache.right = new float[bytes_written];
+  cache.sample_count = res->Peek(bytes_written, cache.left, cache.right);
+  {
     std::unique_lock<std::mutex> lock(cache_mutex_);
-    cache_.insert(std::make_pair(path, cache));
+    if (!cache_.insert(std::make_pair(path, cache)).second) {
+      // someone beat us to it
+      delete[] cache.left;
+      delete[] cache.right;
+    }
   }
 
   return res;
@@ -97,7 +124,7 @@ std::shared_ptr<audio::AudioBuffer> AudioLoader::LoadFromPath(const std::string&
 void AudioLoader::LoadFileToCache(cache_record& record) {
   // this handles caching -- just ignore the result it produces.
   auto lambda = [&, record] {
-    LoadFromPath(record.path);
+    LoadFromPath(record.path, record.stamp);
     std::unique_lock<std::mutex> lock(loader_mutex_);
     loader_.bytes_read += record.file_size;
     if (loader_.bytes_read >= loader_.bytes_sum) {
@@ -111,8 +138,8 @@ void AudioLoader::LoadFileToCache(cache_record& record) {
 AudioLoader::~AudioLoader() {
   std::unique_lock<std::mutex> lock(cache_mutex_);
   for (auto entry : cache_) {
-    delete entry.second.left;
-    delete entry.second.right;
+    delete[] entry.second.left;
+    delete[] entry.second.right;
   }
 }
 
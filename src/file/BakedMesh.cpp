@@ -0,0 +1,189 @@
+#include <file/BakedMesh.hpp>
+#include <file/MappedFile.hpp>
+#include <file/exception/FileNotFoundException.hpp>
+
+#include <boost/log/trivial.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+namespace monkeysworld {
+namespace file {
+
+using exception::FileNotFoundException;
+using model::Mesh;
+using storage::VertexPacket3D;
+
+namespace fs = std::filesystem;
+
+static_assert(sizeof(VertexPacket3D) == 32, "VertexPacket3D must be tightly packed for baking");
+static_assert(std::is_trivially_copyable<VertexPacket3D>::value, "VertexPacket3D must be trivially copyable");
+static_assert(sizeof(unsigned int) == sizeof(uint32_t), "mesh indices must be 32 bits wide");
+
+static const char* BAKED_MESH_EXT = ".mwmesh";
+
+std::string GetBakedMeshPath(const std::string& obj_path, const std::string& bake_dir) {
+  // flatten the path into a single file name, escaping separators
+  std::string res = bake_dir;
+  res.reserve(res.size() + obj_path.size() + 16);
+  for (char c : obj_path) {
+    switch (c) {
+      case '_':
+        res += "__";
+        break;
+      case '/':
+      case '\\':
+        res += "_s";
+        break;
+      case ':':
+        res += "_c";
+        break;
+      default:
+        res += c;
+    }
+  }
+
+  res += BAKED_MESH_EXT;
+  return res;
+}
+
+bool WriteBakedMesh(const std::string& bake_path,
+                    const Mesh<VertexPacket3D>& mesh,
+                    uint64_t source_size,
+                    int64_t source_mtime) {
+  std::error_code err;
+  fs::path dest(bake_path);
+  if (dest.has_parent_path()) {
+    fs::create_directories(dest.parent_path(), err);
+    if (err) {
+      BOOST_LOG_TRIVIAL(warning) << "could not create bake directory for " << bake_path;
+      return false;
+    }
+  }
+
+  // write to a temp file first, so that readers never see a partial bake
+  std::string temp_path = bake_path + ".tmp";
+  {
+    std::ofstream output(temp_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!output.good()) {
+      BOOST_LOG_TRIVIAL(warning) << "could not open " << temp_path << " for baking";
+      return false;
+    }
+
+    if (!WriteBakedMesh(output, mesh, source_size, source_mtime)) {
+      BOOST_LOG_TRIVIAL(warning) << "failed to write baked mesh " << temp_path;
+      output.close();
+      fs::remove(temp_path, err);
+      return false;
+    }
+  }
+
+  fs::rename(temp_path, dest, err);
+  if (err) {
+    BOOST_LOG_TRIVIAL(warning) << "could not move baked mesh into place at " << bake_path;
+    fs::remove(temp_path, err);
+    return false;
+  }
+
+  return true;
+}
+
+bool WriteBakedMesh(std::ostream& output,
+                    const Mesh<VertexPacket3D>& mesh,
+                    uint64_t source_size,
+                    int64_t source_mtime) {
+  baked_mesh_header header = {};
+  header.magic = BAKED_MESH_MAGIC;
+  header.version = BAKED_MESH_VERSION;
+  header.packet_size = sizeof(VertexPacket3D);
+  header.source_size = source_size;
+  header.source_mtime = source_mtime;
+  header.vertex_count = mesh.GetVertexCount();
+  header.index_count = mesh.GetIndexCount();
+
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  output.write(reinterpret_cast<const char*>(mesh.GetVertexData()),
+               sizeof(VertexPacket3D) * header.vertex_count);
+  output.write(reinterpret_cast<const char*>(mesh.GetIndexData()),
+               sizeof(uint32_t) * header.index_count);
+  return output.good();
+}
+
+std::shared_ptr<Mesh<VertexPacket3D>> ReadBakedMesh(const std::string& bake_path,
+                                                    uint64_t source_size,
+                                                    int64_t source_mtime) {
+  std::error_code err;
+  if (!fs::exists(bake_path, err)) {
+    return nullptr;
+  }
+
+  std::unique_ptr<MappedFile> file;
+  try {
+    file = std::make_unique<MappedFile>(bake_path);
+  } catch (FileNotFoundException& e) {
+    BOOST_LOG_TRIVIAL(warning) << "could not map baked mesh " << bake_path;
+    return nullptr;
+  }
+
+  if (file->GetSize() < sizeof(baked_mesh_header)) {
+    return nullptr;
+  }
+
+  baked_mesh_header header;
+  std::memcpy(&header, file->GetData(), sizeof(header));
+  if (header.source_size != source_size || header.source_mtime != source_mtime) {
+    BOOST_LOG_TRIVIAL(debug) << "baked mesh " << bake_path << " is stale";
+    return nullptr;
+  }
+
+  return ReadBakedMesh(file->GetData(), file->GetSize(), bake_path);
+}
+
+std::shared_ptr<Mesh<VertexPacket3D>> ReadBakedMesh(const char* data,
+                                                    uint64_t size,
+                                                    const std::string& name) {
+  if (size < sizeof(baked_mesh_header)) {
+    return nullptr;
+  }
+
+  baked_mesh_header header;
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != BAKED_MESH_MAGIC
+   || header.version != BAKED_MESH_VERSION
+   || header.packet_size != sizeof(VertexPacket3D)) {
+    BOOST_LOG_TRIVIAL(debug) << "baked mesh " << name << " has an incompatible header";
+    return nullptr;
+  }
+
+  // bound the counts by what's left before multiplying, so that huge ones can't wrap around
+  uint64_t body_size = size - sizeof(baked_mesh_header);
+  if (header.vertex_count > body_size / sizeof(VertexPacket3D)
+   || header.index_count > (body_size - header.vertex_count * sizeof(VertexPacket3D)) / sizeof(uint32_t)
+   || body_size != header.vertex_count * sizeof(VertexPacket3D) + header.index_count * sizeof(uint32_t)
+   || header.index_count % 3 != 0) {
+    BOOST_LOG_TRIVIAL(warning) << "baked mesh " << name << " is truncated or malformed";
+    return nullptr;
+  }
+
+  // header is 64 bytes and packets are 32, so both arrays are aligned
+  // as long as `data` is (true for mappings, and for asset pack entries)
+  const VertexPacket3D* verts = reinterpret_cast<const VertexPacket3D*>(data + sizeof(baked_mesh_header));
+  const uint32_t* indices = reinterpret_cast<const uint32_t*>(verts + header.vertex_count);
+
+  // don't hand a corrupt index buffer to GL
+  for (uint64_t i = 0; i < header.index_count; i++) {
+    if (indices[i] >= header.vertex_count) {
+      BOOST_LOG_TRIVIAL(warning) << "baked mesh " << name << " contains out of range indices";
+      return nullptr;
+    }
+  }
+
+  auto mesh = std::make_shared<Mesh<VertexPacket3D>>();
+  mesh->SetData(verts, header.vertex_count, indices, header.index_count);
+  return mesh;
+}
+
+}
+}
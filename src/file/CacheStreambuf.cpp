@@ -1,23 +1,61 @@
 #include <file/CacheStreambuf.hpp>
 #include <file/exception/FileNotFoundException.hpp>
 
-#include <iostream>
+#include <algorithm>
+#include <cstring>
 
 namespace monkeysworld {
 namespace file {
 
-// contract: always expose the full cached vector
-
 using std::ios_base;
 using exception::FileNotFoundException;
 
-CacheStreambuf::CacheStreambuf() : data_() {
+/**
+ *  Empty vectors and mappings have no data pointer, but they're still valid -- just empty.
+ *  Point those at a byte of our own, so that only a default-constructed streambuf is invalid.
+ *  @returns `data`, or an alias of it which isn't null if anything owns it.
+ */
+static std::shared_ptr<const char> NonNullData(const std::shared_ptr<const char>& data) {
+  static const char empty = '\0';
+  if (data.get() == nullptr && data.use_count() > 0) {
+    return std::shared_ptr<const char>(data, &empty);
+  }
+
+  return data;
+}
+
+CacheStreambuf::CacheStreambuf() : data_(), size_(0), chunk_size_(0) {
   setg(nullptr, nullptr, nullptr);
 }
 
-CacheStreambuf::CacheStreambuf(const std::shared_ptr<std::vector<char>>& data) : data_(data) {
-  char* data_ptr = data_->data();
-  setg(data_ptr, data_ptr, data_ptr + data_->size());
+CacheStreambuf::CacheStreambuf(const std::shared_ptr<std::vector<char>>& data)
+  : CacheStreambuf(std::shared_ptr<const char>(data, data->data()), data->size()) { }
+
+CacheStreambuf::CacheStreambuf(const std::shared_ptr<const char>& data, size_t size) : data_(NonNullData(data)),
+                                                                                      size_(size),
+                                                                                      chunk_size_(size) {
+  // already in memory, so there's no sense in chunking it
+  SetPosition(0);
+}
+
+CacheStreambuf::CacheStreambuf(const std::shared_ptr<const MappedFile>& file, size_t chunk_size)
+  : data_(NonNullData(std::shared_ptr<const char>(file, file->GetData()))),
+    size_(file->GetSize()),
+    file_(file),
+    chunk_size_(chunk_size) {
+  SetPosition(0);
+  file_->Prefetch(0, chunk_size_);
+}
+
+void CacheStreambuf::SetPosition(size_t pos) {
+  char* data_ptr = const_cast<char*>(data_.get());
+  size_t chunk_end = std::min(pos + chunk_size_, size_);
+  // eback stays at the start, so putback works across chunk boundaries
+  setg(data_ptr, data_ptr + pos, data_ptr + chunk_end);
+  if (file_ && chunk_end < size_) {
+    // the chunk after this one should be paged in by the time the reader gets to it
+    file_->Prefetch(chunk_end, chunk_size_);
+  }
 }
 
 std::streampos CacheStreambuf::seekoff(std::streamoff off, ios_base::seekdir way, ios_base::openmode which) {
@@ -29,20 +67,26 @@ std::streampos CacheStreambuf::seekoff(std::streamoff off, ios_base::seekdir way
     return -1;
   }
 
-  char* data_head = const_cast<char*>(data_->data());
-  std::streampos offset;
+  std::streamoff offset;
   switch (way) {
     case ios_base::beg:
       offset = off;
       break;
     case ios_base::cur:
-      offset = (gptr() - data_->data()) + off;
+      offset = (gptr() - data_.get()) + off;
       break;
     case ios_base::end:
-      offset = data_->size() - off;
+      offset = size_ - off;
+      break;
+    default:
+      return -1;
   }
 
-  setg(data_head, data_head + offset, data_head + data_->size());
+  if (offset < 0 || offset > static_cast<std::streamoff>(size_)) {
+    return -1;
+  }
+
+  SetPosition(static_cast<size_t>(offset));
   return offset;
 }
 
@@ -64,7 +108,22 @@ std::streamsize CacheStreambuf::showmanyc() {
     throw FileNotFoundException("streambuf not valid");
   }
 
-  return 0;
+  // only called once the current chunk is used up
+  size_t remaining = size_ - (gptr() - data_.get());
+  return (remaining > 0 ? static_cast<std::streamsize>(remaining) : -1);
+}
+
+std::streamsize CacheStreambuf::xsgetn(char* s, std::streamsize n) {
+  if (!data_) {
+    throw FileNotFoundException("streambuf not valid");
+  }
+
+  // large reads skip the chunking and copy straight out of the block
+  size_t pos = gptr() - data_.get();
+  size_t count = std::min(static_cast<size_t>(n), size_ - pos);
+  memcpy(s, data_.get() + pos, count);
+  SetPosition(pos + count);
+  return static_cast<std::streamsize>(count);
 }
 
 std::streamsize CacheStreambuf::xsputn(const char* s, std::streamsize n) {
@@ -84,40 +143,50 @@ CacheStreambuf::int_type CacheStreambuf::overflow(CacheStreambuf::int_type c) {
 }
 
 CacheStreambuf::int_type CacheStreambuf::underflow() {
-  std::cout << "underflow" << std::endl;
   if (!data_) {
-    std::cout << "hello!" << std::endl;
     throw FileNotFoundException("streambuf not valid");
   }
 
-  char* ptr = gptr();
-  if (ptr == (data_->data() + data_->size())) {
-    return EOF;
+  size_t pos = gptr() - data_.get();
+  if (pos >= size_) {
+    return traits_type::eof();
   }
 
-  return *ptr;
-  
+  SetPosition(pos);
+  return traits_type::to_int_type(*gptr());
 }
 
 CacheStreambuf::CacheStreambuf(const CacheStreambuf& other) : std::streambuf(other),
-                                                              data_(other.data_) {
+                                                              data_(other.data_),
+                                                              size_(other.size_),
+                                                              file_(other.file_),
+                                                              chunk_size_(other.chunk_size_) {
   setg(other.eback(), other.gptr(), other.egptr());
 }
 
 CacheStreambuf& CacheStreambuf::operator=(const CacheStreambuf& other) {
-  std::shared_ptr<std::vector<char>>& data = const_cast<std::shared_ptr<std::vector<char>>&>(data_);
+  std::shared_ptr<const char>& data = const_cast<std::shared_ptr<const char>&>(data_);
   data = other.data_;
+  size_ = other.size_;
+  file_ = other.file_;
+  chunk_size_ = other.chunk_size_;
   setg(other.eback(), other.gptr(), other.egptr());
   return *this;
 }
 
-CacheStreambuf::CacheStreambuf(CacheStreambuf&& other) : data_(std::move(other.data_)) {
+CacheStreambuf::CacheStreambuf(CacheStreambuf&& other) : data_(std::move(other.data_)),
+                                                         size_(other.size_),
+                                                         file_(std::move(other.file_)),
+                                                         chunk_size_(other.chunk_size_) {
   setg(other.eback(), other.gptr(), other.egptr());
 }
 
 CacheStreambuf& CacheStreambuf::operator=(CacheStreambuf&& other) {
-  std::shared_ptr<std::vector<char>>& data = const_cast<std::shared_ptr<std::vector<char>>&>(data_);
+  std::shared_ptr<const char>& data = const_cast<std::shared_ptr<const char>&>(data_);
   data = std::move(other.data_);
+  size_ = other.size_;
+  file_ = std::move(other.file_);
+  chunk_size_ = other.chunk_size_;
   setg(other.eback(), other.gptr(), other.egptr());
   return *this;
 }
@@ -1,11 +1,14 @@
 #include <file/CachedFileLoader.hpp>
 #include <file/CacheStreambuf.hpp>
+#include <utils/CRC32.hpp>
 #include <utils/FileUtils.hpp>
 
 #include <boost/log/trivial.hpp>
 
 
+#include <filesystem>
 #include <fstream> 
+#include <iterator>
 #include <sstream>
 #include <string>
 
@@ -15,45 +18,36 @@ namespace file {
 using utils::fileutils::WriteAsBytes;
 using utils::fileutils::ReadAsBytes;
 
-CachedFileLoader::CachedFileLoader(const std::string& cache_name) {
+namespace fs = std::filesystem;
+
+CachedFileLoader::CachedFileLoader(const std::string& cache_name, bool use_archive) : use_archive_(use_archive) {
   cache_path_ = "resources/cache/" + cache_name + ".cache";
   auto cache = ReadCacheFileToVector(cache_path_);
+  if (use_archive_) {
+    pack_path_ = "resources/cache/" + cache_name + ".pack";
+    pack_ = AssetPack::Open(pack_path_);
+  }
+
+  telemetry_ = std::make_shared<LoaderTelemetry>();
   thread_pool_ = std::make_shared<LoaderThreadPool>(8);
-  file_loader_ = std::make_unique<FileLoader>(thread_pool_, cache);
-  model_loader_ = std::make_unique<ModelLoader>(thread_pool_, cache);
-  font_loader_ = std::make_unique<FontLoader>(thread_pool_, cache);
-  texture_loader_ = std::make_unique<TextureLoader>(thread_pool_, cache);
-  cubemap_loader_ = std::make_unique<CubeMapLoader>(thread_pool_, cache);
+  file_loader_ = std::make_unique<FileLoader>(thread_pool_, cache, pack_, telemetry_);
+  model_loader_ = std::make_unique<ModelLoader>(thread_pool_, cache, pack_, telemetry_);
+  font_loader_ = std::make_unique<FontLoader>(thread_pool_, cache, telemetry_);
+  texture_loader_ = std::make_unique<TextureLoader>(thread_pool_, cache, pack_, telemetry_);
+  cubemap_loader_ = std::make_unique<CubeMapLoader>(thread_pool_, cache, telemetry_);
 }
 
-loader_progress CachedFileLoader::GetLoaderProgress() {
-  loader_progress res;
-  loader_progress temp;
-
-  res.bytes_read = 0;
-  res.bytes_sum = 0;
-
-  temp = file_loader_->GetLoaderProgress();
-  res.bytes_read += temp.bytes_read;
-  res.bytes_sum += temp.bytes_sum;
-
-  temp = model_loader_->GetLoaderProgress();
-  res.bytes_read += temp.bytes_read;
-  res.bytes_sum += temp.bytes_sum;
-
-  temp = font_loader_->GetLoaderProgress();
-  res.bytes_read += temp.bytes_read;
-  res.bytes_sum += temp.bytes_sum;
-
-  temp = texture_loader_->GetLoaderProgress();
-  res.bytes_read += temp.bytes_read;
-  res.bytes_sum += temp.bytes_sum;
-
-  temp = cubemap_loader_->GetLoaderProgress();
-  res.bytes_read += temp.bytes_read;
-  res.bytes_sum += temp.bytes_sum;
+void CachedFileLoader::RequestRevalidation() {
+  file_loader_->RequestRevalidation();
+  model_loader_->RequestRevalidation();
+  font_loader_->RequestRevalidation();
+  texture_loader_->RequestRevalidation();
+  cubemap_loader_->RequestRevalidation();
+}
 
-  return res;
+loader_progress CachedFileLoader::GetLoaderProgress() {
+  // every loader reports into our telemetry, so this doesn't need to take their locks
+  return telemetry_->GetProgress();
 }
 
 CacheStreambuf CachedFileLoader::LoadFile(const std::string& path) {
@@ -104,32 +98,64 @@ std::vector<cache_record> CachedFileLoader::ReadCacheFileToVector(const std::str
   }
 
   uint32_t crc_expected = ReadAsBytes<uint32_t>(cache);
-  cache.seekg(CACHE_DATA_START, std::ios_base::beg);
-  uint32_t crc_actual = utils::fileutils::CalculateCRCHash(cache, std::streampos(CACHE_DATA_START));
+  uint32_t num_entries = ReadAsBytes<uint32_t>(cache);
+
+  // records are small, so just read them all in one go
+  std::string data((std::istreambuf_iterator<char>(cache)), std::istreambuf_iterator<char>());
+  cache.close();
+  uint32_t crc_actual = utils::CRC32::Calculate(data.data(), data.size());
   if (crc_expected != crc_actual) {
     BOOST_LOG_TRIVIAL(warning) << "crc did not match preexisting cache file -- expected " << crc_expected << ", actual " << crc_actual;
-    cache.close();
     return record;
   }
 
-  cache.seekg(CACHE_DATA_START - 4, std::ios_base::beg);
-  uint32_t num_entries = ReadAsBytes<uint32_t>(cache);
   BOOST_LOG_TRIVIAL(debug) << "Cache file with " << num_entries << " entries found";
+  std::istringstream records(data);
   cache_record temp;
   uint16_t pathlen;
   for (unsigned int i = 0; i < num_entries; i++) {
-    temp.type = static_cast<CacheType>(ReadAsBytes<uint16_t>(cache));
-    pathlen = ReadAsBytes<uint16_t>(cache);
+    temp.type = static_cast<CacheType>(ReadAsBytes<uint16_t>(records));
+    pathlen = ReadAsBytes<uint16_t>(records);
     temp.path.resize(pathlen);
-    cache.read(&temp.path[0], pathlen);
-    temp.file_size = ReadAsBytes<uint64_t>(cache);
+    records.read(&temp.path[0], pathlen);
+    temp.file_size = ReadAsBytes<uint64_t>(records);
+    temp.stamp.source_size = ReadAsBytes<uint64_t>(records);
+    temp.stamp.mtime = ReadAsBytes<int64_t>(records);
+    temp.stamp.content_hash = ReadAsBytes<uint32_t>(records);
+    if (!records.good()) {
+      BOOST_LOG_TRIVIAL(warning) << "cache file is truncated -- ignoring";
+      record.clear();
+      break;
+    }
+
     record.push_back(temp);
   }
 
-  cache.close();
   return record;
 }
 
+bool CachedFileLoader::IsPackOutdated(const std::vector<cache_record>& cache) {
+  for (auto& record : cache) {
+    switch (record.type) {
+      case FILE:
+      case TEXTURE:
+      case MODEL: {
+        const asset_pack_entry* entry = (pack_ ? pack_->Find(record.type, record.path) : nullptr);
+        if (entry == nullptr || entry->content_hash != record.stamp.content_hash) {
+          return true;
+        }
+
+        break;
+      }
+      default:
+        // not stored in packs
+        break;
+    }
+  }
+
+  return false;
+}
+
 CachedFileLoader::~CachedFileLoader() {
   // write to the cache :)
   file_loader_->WaitUntilLoaded();
@@ -137,8 +163,6 @@ CachedFileLoader::~CachedFileLoader() {
   font_loader_->WaitUntilLoaded();
   texture_loader_->WaitUntilLoaded();
   cubemap_loader_->WaitUntilLoaded();
-  std::fstream cache_output;
-  cache_output.open(cache_path_, std::fstream::in | std::fstream::out | std::fstream::trunc | std::fstream::binary);
   std::vector<cache_record> cache;
   // ensure that cache is complete
   std::vector<cache_record> files = file_loader_->GetCache();
@@ -154,23 +178,55 @@ CachedFileLoader::~CachedFileLoader() {
   cache.insert(cache.end(), cubemaps.begin(), cubemaps.end());
   BOOST_LOG_TRIVIAL(debug) << "cacheing " << cache.size() << " files";
 
-  cache_output.seekp(0);
-  WriteAsBytes(cache_output, CACHE_MAGIC);
-  cache_output.seekp(CACHE_DATA_START);
-  for (auto entry : cache) {
-    WriteAsBytes(cache_output, static_cast<uint16_t>(entry.type));
-    WriteAsBytes(cache_output, static_cast<uint16_t>(entry.path.size()));
-    cache_output.write(&entry.path[0], entry.path.size());
-    WriteAsBytes(cache_output, static_cast<uint64_t>(entry.file_size));
+  std::ostringstream records;
+  for (auto& entry : cache) {
+    WriteAsBytes(records, static_cast<uint16_t>(entry.type));
+    WriteAsBytes(records, static_cast<uint16_t>(entry.path.size()));
+    records.write(&entry.path[0], entry.path.size());
+    WriteAsBytes(records, static_cast<uint64_t>(entry.file_size));
+    WriteAsBytes(records, static_cast<uint64_t>(entry.stamp.source_size));
+    WriteAsBytes(records, static_cast<int64_t>(entry.stamp.mtime));
+    WriteAsBytes(records, static_cast<uint32_t>(entry.stamp.content_hash));
   }
 
-  // btw: i get the feeling this method is bogus
-  uint32_t crc = utils::fileutils::CalculateCRCHash(cache_output, std::streampos(CACHE_DATA_START));
-  cache_output.seekp(CACHE_DATA_START - 8);
-  WriteAsBytes(cache_output, static_cast<uint32_t>(crc));
+  // hashes and mtimes are full of 0xFF bytes, so the whole record block is hashed --
+  // see CalculateCRCHash for why that matters
+  std::string data = records.str();
+  uint32_t crc = utils::CRC32::Calculate(data.data(), data.size());
   BOOST_LOG_TRIVIAL(trace) << "CRC: " << crc;
-  WriteAsBytes(cache_output, static_cast<uint32_t>(cache.size()));
-  cache_output.close();
+
+  // the cache directory won't exist on a fresh checkout
+  std::error_code err;
+  fs::path dest(cache_path_);
+  fs::create_directories(dest.parent_path(), err);
+  std::ofstream cache_output(cache_path_, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  if (!cache_output.good()) {
+    BOOST_LOG_TRIVIAL(warning) << "could not open cache file " << cache_path_ << " for writing";
+  } else {
+    WriteAsBytes(cache_output, CACHE_MAGIC);
+    WriteAsBytes(cache_output, static_cast<uint32_t>(crc));
+    WriteAsBytes(cache_output, static_cast<uint32_t>(cache.size()));
+    cache_output.write(data.data(), data.size());
+    cache_output.close();
+  }
+
+  if (!use_archive_ || !IsPackOutdated(cache)) {
+    return;
+  }
+
+  // our loaders, and whatever they've handed out, hold views into the old pack.
+  // let go of them before it's replaced -- windows won't rename over a file which is still mapped.
+  std::weak_ptr<AssetPack> old_pack = pack_;
+  file_loader_.reset();
+  model_loader_.reset();
+  texture_loader_.reset();
+  pack_.reset();
+  if (!old_pack.expired()) {
+    BOOST_LOG_TRIVIAL(warning) << "asset pack " << pack_path_ << " is still in use -- it may not be replaced";
+  }
+
+  BOOST_LOG_TRIVIAL(debug) << "rebuilding asset pack " << pack_path_;
+  WriteAssetPack(pack_path_, cache);
 }
 
 } // namespace file
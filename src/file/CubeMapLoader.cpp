@@ -7,8 +7,10 @@
 namespace monkeysworld {
 namespace file {
 
-CubeMapLoader::CubeMapLoader(std::shared_ptr<LoaderThreadPool> thread_pool, std::vector<cache_record> cache) 
-  : CachedLoader(thread_pool) {
+CubeMapLoader::CubeMapLoader(std::shared_ptr<LoaderThreadPool> thread_pool,
+                             std::vector<cache_record> cache,
+                             std::shared_ptr<LoaderTelemetry> telemetry)
+  : CachedLoader(thread_pool, CUBEMAP, telemetry) {
   loader_.bytes_read = 0;
   loader_.bytes_sum = 0;
   for (auto record : cache) {
@@ -16,20 +18,21 @@ CubeMapLoader::CubeMapLoader(std::shared_ptr<LoaderThreadPool> thread_pool, std:
       LoadFileToCache(record);
       // does not load in separate thread
       loader_.bytes_sum += record.file_size;
+      ReportExpectedBytes(record.file_size);
     }
   }
 }
 
 std::vector<cache_record> CubeMapLoader::GetCache() {
-  std::shared_lock<std::shared_timed_mutex> lock(cache_mutex_);
   cache_record temp;
   std::vector<cache_record> res;
-  for (auto i : file_cache_) {
-    temp.file_size = i.second->GetCubeMapSize();
-    temp.path = i.first;
+  file_cache_.ForEach([&](const AssetCache<std::shared_ptr<shader::CubeMap>>::node& i) {
+    temp.file_size = i.value->GetCubeMapSize();
+    temp.path = i.path;
     temp.type = CUBEMAP;
+    temp.stamp = i.stamp;
     res.push_back(temp);
-  }
+  });
 
   return res;
 }
@@ -50,71 +53,68 @@ void CubeMapLoader::WaitUntilLoaded() {
 }
 
 std::shared_ptr<shader::CubeMap> CubeMapLoader::LoadFile(const std::string& path) {
-  // split file apart on colons (check for first char is colon)
-  // pass each one to the thing
-  {
-    std::shared_lock<std::shared_timed_mutex> lock(cache_mutex_);
-    auto i = file_cache_.find(path);
-    if (i != file_cache_.end()) {
-      return i->second;
-    }
+  auto create_cubemap = [this](const std::string& p, bool use_pack, cache_entry<std::shared_ptr<shader::CubeMap>>* entry) {
+    return CreateCubeMap(p, use_pack, entry);
+  };
+
+  std::shared_ptr<shader::CubeMap> res;
+  if (!LookupEntry(file_cache_, path, create_cubemap, &res)) {
+    return std::shared_ptr<shader::CubeMap>(nullptr);
   }
 
-  if (path[0] == ':') {
-    // note: this behavior is intentional
-    std::vector<std::string> paths;
-    boost::split(paths, path, [](char c){ return (c == ':'); }, boost::token_compress_on);
-    // first colon, identifying split string, forms an empty group.
-    // ignore this :)
-    if (paths.size() != 7) {
-      BOOST_LOG_TRIVIAL(error) << "string does not contain correct number of paths -- expected 7, actual " << paths.size();
-      BOOST_LOG_TRIVIAL(error) << path;
-      for (auto s : paths) {
-        BOOST_LOG_TRIVIAL(error) << s;
-      }
-    }
+  return res;
+}
 
-    auto cubemap = std::make_shared<shader::CubeMap>(paths[1], paths[2], paths[3], paths[4], paths[5], paths[6]);
+bool CubeMapLoader::CreateCubeMap(const std::string& path,
+                                  bool use_pack,
+                                  cache_entry<std::shared_ptr<shader::CubeMap>>* entry) {
+  // split file apart on colons (check for first char is colon)
+  // pass each one to the thing
+  if (path.empty() || path[0] != ':') {
+    BOOST_LOG_TRIVIAL(warning) << "expected leading ':' in passed filename";
+    // haven't implemented cubemaps for single-file because i dont want to yet
+    return false;
+  }
 
-    {
-      std::unique_lock<std::shared_timed_mutex> lock(cache_mutex_);
-      file_cache_.insert(std::make_pair(path, cubemap));
+  // note: this behavior is intentional
+  std::vector<std::string> paths;
+  boost::split(paths, path, [](char c){ return (c == ':'); }, boost::token_compress_on);
+  // first colon, identifying split string, forms an empty group.
+  // ignore this :)
+  if (paths.size() != 7) {
+    BOOST_LOG_TRIVIAL(error) << "string does not contain correct number of paths -- expected 7, actual " << paths.size();
+    BOOST_LOG_TRIVIAL(error) << path;
+    for (auto s : paths) {
+      BOOST_LOG_TRIVIAL(error) << s;
     }
 
-    return cubemap;
-  } else {
-    BOOST_LOG_TRIVIAL(warning) << "expected leading ':' in passed filename";
-    // haven't implemented cubemaps for single-file because i dont want to yet
-    return std::shared_ptr<shader::CubeMap>(nullptr);
+    return false;
   }
+
+  // stamps all six faces at once. missing faces are reported by the cubemap itself
+  UpdateAssetStamp(path, &entry->stamp);
+  LoaderTelemetry::MarkPhase(PHASE_IO);
+  entry->value = std::make_shared<shader::CubeMap>(paths[1], paths[2], paths[3], paths[4], paths[5], paths[6]);
+  entry->value->SetUploadCallback(MakeUploadCallback(path));
+  entry->packed = false;
+  return true;
 }
 
 bool CubeMapLoader::IsCached(const std::string& path) {
-  auto res = file_cache_.find(path);
-  return (res != file_cache_.end());
+  return (file_cache_.Find(path) != nullptr);
 }
 
 void CubeMapLoader::LoadFileToCache(cache_record& record) {
-  if (record.path[0] == ':') {
-    std::vector<std::string> paths;
-    boost::split(paths, record.path, [](char c){ return (c == ':'); }, boost::token_compress_on);
-    // ensure path length is equal to 7
-    if (paths.size() != 7) {
-      BOOST_LOG_TRIVIAL(error) << "string does not contain correct number of paths -- expected 7, actual " << paths.size();
-      BOOST_LOG_TRIVIAL(error) << record.path;
-      return;
-    }
-
-    auto cubemap = std::make_shared<shader::CubeMap>(paths[1], paths[2], paths[3], paths[4], paths[5], paths[6]);
+  auto create_cubemap = [this](const std::string& p, bool use_pack, cache_entry<std::shared_ptr<shader::CubeMap>>* entry) {
+    return CreateCubeMap(p, use_pack, entry);
+  };
 
-    {
-      std::unique_lock<std::shared_timed_mutex> lock(cache_mutex_);
-      file_cache_.insert(std::make_pair(record.path, cubemap));
-    }
-  } else {
-    BOOST_LOG_TRIVIAL(warning) << "expected leading ':' in passed filename";
+  cache_entry<std::shared_ptr<shader::CubeMap>> entry;
+  if (PrefetchEntry(record.path, record.stamp, create_cubemap, &entry)) {
+    file_cache_.Store(record.path, std::move(entry), false);
   }
 
+  ReportLoadedBytes(record.file_size);
   {
     std::unique_lock<std::mutex> lock(loader_mutex_);
     loader_.bytes_read += record.file_size;
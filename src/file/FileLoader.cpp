@@ -1,19 +1,27 @@
 #include <file/FileLoader.hpp>
+#include <file/exception/FileNotFoundException.hpp>
+#include <utils/CRC32.hpp>
+
 #include <boost/log/trivial.hpp>
 
+#include <chrono>
 #include <fstream>
 
 namespace monkeysworld {
 namespace file {
 
 FileLoader::FileLoader(std::shared_ptr<LoaderThreadPool> thread_pool,
-                       std::vector<cache_record> cache) : CachedLoader(thread_pool) {
+                       std::vector<cache_record> cache,
+                       std::shared_ptr<AssetPack> pack,
+                       std::shared_ptr<LoaderTelemetry> telemetry) : CachedLoader(thread_pool, FILE, telemetry),
+                                                                     pack_(pack) {
   loader_.bytes_read = 0;
   loader_.bytes_sum = 0;
 
   for (auto record : cache) {
     if (record.type == FILE) {
       loader_.bytes_sum += record.file_size;
+      ReportExpectedBytes(record.file_size);
       LoadFileToCache(record);
     }
   }
@@ -21,14 +29,24 @@ FileLoader::FileLoader(std::shared_ptr<LoaderThreadPool> thread_pool,
 
 std::vector<cache_record> FileLoader::GetCache() {
   std::vector<cache_record> res;
-  {
-    std::shared_lock<std::shared_timed_mutex> lock(cache_mutex_);
-    cache_record temp;
-    for (auto record : file_cache_) {
-      temp.file_size = record.second->size();
-      temp.path = record.first;
-      temp.type = CacheType::FILE;
-      res.push_back(temp);
+  cache_record temp;
+  std::vector<std::shared_future<uint32_t>> pending;
+  file_cache_.ForEach([&](const AssetCache<file_record>::node& record) {
+    temp.file_size = record.value.size;
+    temp.path = record.path;
+    temp.type = CacheType::FILE;
+    temp.stamp = record.stamp;
+    res.push_back(temp);
+    pending.push_back(record.value.content_hash);
+  });
+
+  // fill in the hashes of mapped files which were still in flight.
+  // lend a hand while we wait, in case the pool is busy (or we're on it)
+  for (size_t i = 0; i < res.size(); i++) {
+    if (pending[i].valid()) {
+      while (pending[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready
+             && GetThreadPool()->RunPendingTask());
+      res[i].stamp.content_hash = pending[i].get();
     }
   }
 
@@ -52,66 +70,129 @@ void FileLoader::WaitUntilLoaded() {
 
 
 CacheStreambuf FileLoader::LoadFile(const std::string& path) {
-  {
-    std::shared_lock<std::shared_timed_mutex> lock(cache_mutex_);
-    auto i = file_cache_.find(path);
-    if (i != file_cache_.end()) {
-      return i->second;
-    }
-  }
-  
-  std::ifstream source_stream(path, std::ios_base::in | std::ios_base::binary);
-  if (!source_stream.good()) {
+  auto read_file = [this](const std::string& p, bool use_pack, cache_entry<file_record>* entry) {
+    return ReadFile(p, use_pack, entry);
+  };
+
+  file_record res;
+  if (!LookupEntry(file_cache_, path, read_file, &res)) {
     // bad ptr
     BOOST_LOG_TRIVIAL(error) << "bad path for new file";
     BOOST_LOG_TRIVIAL(error) << path;
     return CacheStreambuf();
   }
 
+  if (res.mapping) {
+    return CacheStreambuf(res.mapping);
+  }
+
+  return CacheStreambuf(res.data, res.size);
+}
+
+bool FileLoader::ReadFile(const std::string& path, bool use_pack, cache_entry<file_record>* entry) {
+  if (use_pack && pack_) {
+    entry->value.data = pack_->GetFile(path, &entry->value.size, &entry->stamp);
+    if (entry->value.data) {
+      entry->packed = true;
+      LoaderTelemetry::MarkPhase(PHASE_IO);
+      return true;
+    }
+  }
+
+  // stat before reading, so that a write which races with us shows up as a change next time
+  asset_stamp stamp;
+  if (!GetSourceStamp(path, &stamp.source_size, &stamp.mtime)) {
+    return false;
+  }
+
+  if (stamp.source_size >= MAP_THRESHOLD) {
+    return MapFile(path, stamp, entry);
+  }
+
+  std::ifstream source_stream(path, std::ios_base::in | std::ios_base::binary);
+  if (!source_stream.good()) {
+    return false;
+  }
+
+  // instead of ctor with a vector, ctor with a pointer and a size.
+  // then we can avoid calling resize() and having to manually set all of that memory
   auto res = std::make_shared<std::vector<char>>();
   source_stream.seekg(0, std::ios_base::end);
   uint64_t size = source_stream.tellg();
   source_stream.seekg(0, std::ios_base::beg);
   res->resize(size);
   source_stream.rdbuf()->sgetn(res->data(), size);
+  LoaderTelemetry::MarkPhase(PHASE_IO);
+
+  // we already have the contents in hand, so hashing them is cheap --
+  // but there's no need if the source hasn't been touched since it was last stamped
+  if (stamp.source_size == entry->stamp.source_size && stamp.mtime == entry->stamp.mtime) {
+    stamp.content_hash = entry->stamp.content_hash;
+  } else {
+    stamp.content_hash = utils::CRC32::Calculate(res->data(), size);
+  }
+
+  entry->value.data = std::shared_ptr<const char>(res, res->data());
+  entry->value.size = size;
+  entry->value.mapping = nullptr;
+  entry->value.content_hash = std::shared_future<uint32_t>();
+  entry->stamp = stamp;
+  entry->packed = false;
+  return true;
+}
 
-  {
-    std::unique_lock<std::shared_timed_mutex> lock(cache_mutex_);
-    file_cache_.insert(std::make_pair(path, res));
+bool FileLoader::MapFile(const std::string& path, asset_stamp stamp, cache_entry<file_record>* entry) {
+  std::shared_ptr<const MappedFile> mapping;
+  try {
+    mapping = std::make_shared<const MappedFile>(path);
+  } catch (exception::FileNotFoundException& e) {
+    return false;
   }
 
-  return CacheStreambuf(res);
+  LoaderTelemetry::MarkPhase(PHASE_IO);
+
+  // hashing faults in the whole mapping, which would hold up the first read until all of it
+  // was paged in. it's only needed once we write the cache, so it's left to the pool.
+  // skipped entirely if the stamp still matches
+  std::shared_future<uint32_t> content_hash;
+  if (stamp.source_size == entry->stamp.source_size && stamp.mtime == entry->stamp.mtime) {
+    stamp.content_hash = entry->stamp.content_hash;
+  } else {
+    content_hash = GetThreadPool()->Submit([mapping] {
+      return utils::CRC32::Calculate(mapping->GetData(), mapping->GetSize());
+    }, PRIORITY_LOW).share();
+  }
+
+  entry->value.data = std::shared_ptr<const char>(mapping, mapping->GetData());
+  entry->value.size = mapping->GetSize();
+  entry->value.mapping = mapping;
+  entry->value.content_hash = content_hash;
+  entry->stamp = stamp;
+  entry->packed = false;
+  return true;
 }
 
 bool FileLoader::IsCached(const std::string& path) {
-  auto res = file_cache_.find(path);
-  return (res != file_cache_.end());
+  return (file_cache_.Find(path) != nullptr);
 }
 
 void FileLoader::LoadFileToCache(cache_record& record) {
   auto load_file = [=] {
-    std::ifstream source_stream(record.path, std::ios_base::in | std::ios_base::binary);
-    if (!source_stream.good()) {
-      // skip file, return 0 bytes
-      BOOST_LOG_TRIVIAL(error) << "file " << record.path << " could not be cached -- missing";
+    auto read_file = [this](const std::string& p, bool use_pack, cache_entry<file_record>* entry) {
+      return ReadFile(p, use_pack, entry);
+    };
+
+    cache_entry<file_record> res;
+    if (PrefetchEntry(record.path, record.stamp, read_file, &res)) {
+      file_cache_.Store(record.path, std::move(res), false);
+    } else {
       // do not cache -- the sync/async function will handle the error :)
-      return;
-    }
-
-    // instead of ctor with a vector, ctor with a pointer and a size.
-    // then we can avoid calling resize() and having to manually set all of that memory
-    auto res = std::make_shared<std::vector<char>>();
-    source_stream.seekg(0, std::ios_base::end);
-    uint64_t len = source_stream.tellg();
-    source_stream.seekg(0, std::ios_base::beg);
-    res->resize(len);
-    source_stream.rdbuf()->sgetn(res->data(), len);
-
-    {
-      std::unique_lock<std::shared_timed_mutex> lock(cache_mutex_);
-      file_cache_.insert(std::make_pair(record.path, res));
+      // but do count it, so that misses waiting on the prefetch aren't stuck forever
+      BOOST_LOG_TRIVIAL(error) << "file " << record.path << " could not be cached -- missing";
     }
 
+    // reported first, so progress is complete by the time anyone waiting is woken
+    ReportLoadedBytes(record.file_size);
     {
       std::unique_lock<std::mutex> lock(loader_mutex_);
       // use the file size stored in record, not the new one, if it differs.
@@ -122,7 +203,7 @@ void FileLoader::LoadFileToCache(cache_record& record) {
     }
   };
 
-  GetThreadPool()->AddTaskToQueue(load_file);
+  QueueTask(load_file);
 }
 
 }
@@ -5,27 +5,29 @@ namespace monkeysworld {
 namespace file {
 
 FontLoader::FontLoader(std::shared_ptr<LoaderThreadPool> thread_pool,
-                       std::vector<cache_record> cache) : CachedLoader(thread_pool) {
+                       std::vector<cache_record> cache,
+                       std::shared_ptr<LoaderTelemetry> telemetry) : CachedLoader(thread_pool, FONT, telemetry) {
   loader_.bytes_read = 0;
   loader_.bytes_sum = 0;
   for (auto record : cache) {
     if (record.type == FONT) {
       loader_.bytes_sum++;
+      ReportExpectedBytes(1);
       LoadFontToCache(record);
     }
   }
 }
 
 std::vector<cache_record> FontLoader::GetCache() {
-  std::shared_lock<std::shared_timed_mutex> lock(cache_mutex_);
   std::vector<cache_record> result;
   cache_record temp;
-  for (auto record : font_cache_) {
-    temp.path = record.first;
+  font_cache_.ForEach([&](const AssetCache<std::shared_ptr<font::Font>>::node& record) {
+    temp.path = record.path;
     temp.file_size = 1;       // placeholder, doesn't really matter
     temp.type = CacheType::FONT;
+    temp.stamp = record.stamp;
     result.push_back(temp);
-  }
+  });
 
   return result;
 }
@@ -47,48 +49,47 @@ void FontLoader::WaitUntilLoaded() {
 }
 
 std::shared_ptr<font::Font> FontLoader::LoadFile(const std::string& path) {
-  std::shared_ptr<font::Font> res;
-  {
-    std::shared_lock<std::shared_timed_mutex> lock(cache_mutex_);
-    auto i = font_cache_.find(path);
-    if (i != font_cache_.end()) {
-      return i->second;
-    }
-  }
+  auto open_font = [this](const std::string& p, bool use_pack, cache_entry<std::shared_ptr<font::Font>>* entry) {
+    return OpenFont(p, use_pack, entry);
+  };
 
   // not catching this exception -- im gonna let it bump up and be public
   // TBA: in the event of an exception from this call, return a shitty default font
-  res = std::make_shared<font::Font>(path);
-
-  {
-    std::unique_lock<std::shared_timed_mutex> lock(cache_mutex_);
-    font_cache_.insert(std::make_pair(path, res));
-  }
-
+  std::shared_ptr<font::Font> res;
+  LookupEntry(font_cache_, path, open_font, &res);
   return res;
 }
 
+bool FontLoader::OpenFont(const std::string& path,
+                            bool use_pack,
+                            cache_entry<std::shared_ptr<font::Font>>* entry) {
+  // a missing file is reported by the font itself
+  UpdateAssetStamp(path, &entry->stamp);
+  LoaderTelemetry::MarkPhase(PHASE_IO);
+  entry->value = std::make_shared<font::Font>(path);
+  entry->packed = false;
+  return true;
+}
+
 bool FontLoader::IsCached(const std::string& path) {
-  auto res = font_cache_.find(path);
-  return (res != font_cache_.end());
+  return (font_cache_.Find(path) != nullptr);
 }
 
 void FontLoader::LoadFontToCache(cache_record& record) {
   auto load_font = [=] {
-    std::shared_ptr<font::Font> res;
+    auto open_font = [this](const std::string& p, bool use_pack, cache_entry<std::shared_ptr<font::Font>>* entry) {
+      return OpenFont(p, use_pack, entry);
+    };
 
+    cache_entry<std::shared_ptr<font::Font>> res;
     try {
-      res = std::make_shared<font::Font>(record.path);
-    } catch (font::exception::BadFontPathException e) {
+      PrefetchEntry(record.path, record.stamp, open_font, &res);
+      font_cache_.Store(record.path, std::move(res), false);
+    } catch (font::exception::BadFontPathException& e) {
       BOOST_LOG_TRIVIAL(trace) << "Could not load font " << record.path;
-      return;
-    }
-
-    {
-      std::unique_lock<std::shared_timed_mutex> lock(cache_mutex_);
-      font_cache_.insert(std::make_pair(record.path, res));
     }
 
+    ReportLoadedBytes(1);
     {
       std::unique_lock<std::mutex> lock(loader_mutex_);
       loader_.bytes_read++;
@@ -98,7 +99,7 @@ void FontLoader::LoadFontToCache(cache_record& record) {
     }
   };
 
-  GetThreadPool()->AddTaskToQueue(std::move(load_font));
+  QueueTask(std::move(load_font));
 }
 
 }
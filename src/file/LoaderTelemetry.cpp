@@ -0,0 +1,435 @@
+#include <file/LoaderTelemetry.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+namespace monkeysworld {
+namespace file {
+
+static uint64_t SteadyNow() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ *  @returns a small id for the calling thread, stable for its lifetime.
+ */
+static uint32_t GetThreadId() {
+  static std::atomic<uint32_t> next_id(1);
+  thread_local uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+// innermost scope open on this thread
+static thread_local LoaderTelemetry::AssetScope* current_scope = nullptr;
+
+// queue time for the next scope opened on this thread, if set
+static thread_local uint64_t pending_queue_time = 0;
+
+LoaderTelemetry::LoaderTelemetry(size_t capacity,
+                                 std::function<uint64_t()> clock) : clock_(clock ? std::move(clock) : SteadyNow),
+                                                                    epoch_ns_(clock_()),
+                                                                    capacity_(capacity),
+                                                                    slots_(new event_slot[capacity]()),
+                                                                    next_slot_(0),
+                                                                    dropped_(0) {
+  for (int i = 0; i < CACHE_TYPE_COUNT; i++) {
+    totals_[i].assets = 0;
+    totals_[i].bytes = 0;
+    for (int j = 0; j < PHASE_COUNT; j++) {
+      totals_[i].phase_ns[j] = 0;
+    }
+
+    progress_[i].bytes_read = 0;
+    progress_[i].bytes_sum = 0;
+  }
+}
+
+uint64_t LoaderTelemetry::GetTime() const {
+  // 0 means "never queued" to AssetScope, so time starts at 1
+  return clock_() - epoch_ns_ + 1;
+}
+
+LoaderTelemetry::AssetScope::AssetScope(LoaderTelemetry* telemetry,
+                                        CacheType type,
+                                        const std::string& path,
+                                        uint64_t queued_at) : telemetry_(telemetry),
+                                                              parent_(current_scope),
+                                                              timing_(),
+                                                              last_mark_(0) {
+  if (queued_at == 0) {
+    queued_at = pending_queue_time;
+  }
+
+  pending_queue_time = 0;
+  // scopes are stacked even if they're no-ops, so marks below them aren't misattributed
+  current_scope = this;
+  if (telemetry_ == nullptr) {
+    return;
+  }
+
+  uint64_t now = telemetry_->GetTime();
+  timing_.type = type;
+  timing_.path = path;
+  timing_.thread = GetThreadId();
+  if (queued_at != 0 && queued_at <= now) {
+    timing_.start_ns = queued_at;
+    timing_.phase_ns[PHASE_QUEUE] = now - queued_at;
+  } else {
+    timing_.start_ns = now;
+  }
+
+  last_mark_ = now;
+}
+
+LoaderTelemetry::AssetScope::~AssetScope() {
+  current_scope = parent_;
+  if (telemetry_ == nullptr) {
+    return;
+  }
+
+  // anything left over was spent decoding
+  timing_.phase_ns[PHASE_DECODE] += telemetry_->GetTime() - last_mark_;
+  telemetry_->Record(timing_, false);
+}
+
+void LoaderTelemetry::MarkPhase(LoadPhase phase) {
+  AssetScope* scope = current_scope;
+  if (scope == nullptr || scope->telemetry_ == nullptr) {
+    return;
+  }
+
+  uint64_t now = scope->telemetry_->GetTime();
+  scope->timing_.phase_ns[phase] += now - scope->last_mark_;
+  scope->last_mark_ = now;
+}
+
+void LoaderTelemetry::SetPendingQueueTime(uint64_t queued_at) {
+  pending_queue_time = queued_at;
+}
+
+void LoaderTelemetry::RecordUpload(CacheType type, const std::string& path, uint64_t start_ns, uint64_t upload_ns) {
+  asset_timing timing = {};
+  timing.type = type;
+  timing.path = path;
+  timing.start_ns = start_ns;
+  timing.phase_ns[PHASE_UPLOAD] = upload_ns;
+  timing.thread = GetThreadId();
+  Record(timing, true);
+}
+
+void LoaderTelemetry::Record(const asset_timing& timing, bool upload) {
+  loader_totals& totals = totals_[timing.type];
+  if (!upload) {
+    totals.assets.fetch_add(1, std::memory_order_relaxed);
+    totals.bytes.fetch_add(timing.bytes, std::memory_order_relaxed);
+  }
+
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    if (timing.phase_ns[i] != 0) {
+      totals.phase_ns[i].fetch_add(timing.phase_ns[i], std::memory_order_relaxed);
+    }
+  }
+
+  uint64_t index = next_slot_.fetch_add(1, std::memory_order_relaxed);
+  if (index >= capacity_) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // no one else will ever touch this slot, and readers skip it until it's marked ready
+  event_slot& slot = slots_[index];
+  slot.upload = upload;
+  slot.timing = timing;
+  slot.ready.store(true, std::memory_order_release);
+}
+
+loader_progress LoaderTelemetry::GetProgress() const {
+  loader_progress res = {0, 0};
+  for (int i = 0; i < CACHE_TYPE_COUNT; i++) {
+    res.bytes_read += progress_[i].bytes_read.load(std::memory_order_relaxed);
+    res.bytes_sum += progress_[i].bytes_sum.load(std::memory_order_relaxed);
+  }
+
+  return res;
+}
+
+std::vector<asset_timing> LoaderTelemetry::CollectAssets(std::vector<asset_timing>* uploads) const {
+  std::vector<asset_timing> res;
+  uint64_t count = std::min<uint64_t>(next_slot_.load(std::memory_order_acquire), capacity_);
+  for (uint64_t i = 0; i < count; i++) {
+    const event_slot& slot = slots_[i];
+    if (!slot.ready.load(std::memory_order_acquire)) {
+      // still being written
+      continue;
+    }
+
+    if (!slot.upload) {
+      res.push_back(slot.timing);
+      continue;
+    }
+
+    if (uploads != nullptr) {
+      uploads->push_back(slot.timing);
+    }
+
+    // merge into the most recent load of the same asset
+    for (auto itr = res.rbegin(); itr != res.rend(); itr++) {
+      if (itr->type == slot.timing.type && itr->path == slot.timing.path) {
+        itr->phase_ns[PHASE_UPLOAD] += slot.timing.phase_ns[PHASE_UPLOAD];
+        break;
+      }
+    }
+  }
+
+  return res;
+}
+
+telemetry_snapshot LoaderTelemetry::GetSnapshot(size_t slowest_count) const {
+  telemetry_snapshot res = {};
+  uint64_t total_bytes = 0;
+  for (int i = 0; i < CACHE_TYPE_COUNT; i++) {
+    loader_timing& loader = res.loaders[i];
+    loader.assets = totals_[i].assets.load(std::memory_order_relaxed);
+    loader.bytes = totals_[i].bytes.load(std::memory_order_relaxed);
+    for (int j = 0; j < PHASE_COUNT; j++) {
+      loader.phase_ns[j] = totals_[i].phase_ns[j].load(std::memory_order_relaxed);
+    }
+
+    uint64_t busy_ns = loader.phase_ns[PHASE_IO] + loader.phase_ns[PHASE_DECODE];
+    loader.bytes_per_second = (busy_ns > 0 ? loader.bytes / (busy_ns / 1e9) : 0.0);
+    total_bytes += loader.bytes;
+  }
+
+  res.progress = GetProgress();
+  res.dropped = dropped_.load(std::memory_order_relaxed);
+  res.assets = CollectAssets(nullptr);
+
+  uint64_t first = UINT64_MAX;
+  uint64_t last = 0;
+  for (auto& asset : res.assets) {
+    first = std::min(first, asset.start_ns);
+    last = std::max(last, asset.start_ns + asset.phase_ns[PHASE_QUEUE]
+                                         + asset.phase_ns[PHASE_IO]
+                                         + asset.phase_ns[PHASE_DECODE]);
+  }
+
+  res.elapsed_seconds = (last > first ? (last - first) / 1e9 : 0.0);
+  res.bytes_per_second = (res.elapsed_seconds > 0 ? total_bytes / res.elapsed_seconds : 0.0);
+
+  res.slowest = res.assets;
+  size_t count = std::min(slowest_count, res.slowest.size());
+  std::partial_sort(res.slowest.begin(), res.slowest.begin() + count, res.slowest.end(),
+                    [](const asset_timing& a, const asset_timing& b) {
+                      return a.GetWorkTime() > b.GetWorkTime();
+                    });
+  res.slowest.resize(count);
+  return res;
+}
+
+const char* LoaderTelemetry::GetTypeName(CacheType type) {
+  switch (type) {
+    case MODEL:
+      return "model";
+    case FONT:
+      return "font";
+    case TEXTURE:
+      return "texture";
+    case FILE:
+      return "file";
+    case CUBEMAP:
+      return "cubemap";
+    case AUDIO:
+      return "audio";
+    default:
+      return "unknown";
+  }
+}
+
+/**
+ *  Writes `str` as a JSON string literal.
+ */
+static void WriteString(std::ostream& output, const std::string& str) {
+  output << '"';
+  for (char c : str) {
+    switch (c) {
+      case '"':
+        output << "\\\"";
+        break;
+      case '\\':
+        output << "\\\\";
+        break;
+      case '\n':
+        output << "\\n";
+        break;
+      case '\t':
+        output << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          output << escaped;
+        } else {
+          output << c;
+        }
+    }
+  }
+
+  output << '"';
+}
+
+static double ToMillis(uint64_t ns) {
+  return ns / 1e6;
+}
+
+static double ToMicros(uint64_t ns) {
+  return ns / 1e3;
+}
+
+static void WritePhases(std::ostream& output, const uint64_t* phase_ns) {
+  output << "\"queue_ms\": " << ToMillis(phase_ns[PHASE_QUEUE])
+         << ", \"io_ms\": " << ToMillis(phase_ns[PHASE_IO])
+         << ", \"decode_ms\": " << ToMillis(phase_ns[PHASE_DECODE])
+         << ", \"upload_ms\": " << ToMillis(phase_ns[PHASE_UPLOAD]);
+}
+
+void LoaderTelemetry::WriteJSON(std::ostream& output, size_t slowest_count) const {
+  telemetry_snapshot snapshot = GetSnapshot(slowest_count);
+  output << "{\n";
+  output << "  \"elapsed_seconds\": " << snapshot.elapsed_seconds << ",\n";
+  output << "  \"bytes_per_second\": " << snapshot.bytes_per_second << ",\n";
+  output << "  \"assets\": " << snapshot.assets.size() << ",\n";
+  output << "  \"dropped\": " << snapshot.dropped << ",\n";
+  output << "  \"progress\": { \"bytes_read\": " << snapshot.progress.bytes_read
+         << ", \"bytes_sum\": " << snapshot.progress.bytes_sum << " },\n";
+
+  output << "  \"loaders\": {\n";
+  for (int i = 0; i < CACHE_TYPE_COUNT; i++) {
+    const loader_timing& loader = snapshot.loaders[i];
+    output << "    ";
+    WriteString(output, GetTypeName(static_cast<CacheType>(i)));
+    output << ": { \"assets\": " << loader.assets << ", \"bytes\": " << loader.bytes << ", ";
+    WritePhases(output, loader.phase_ns);
+    output << ", \"bytes_per_second\": " << loader.bytes_per_second << " }";
+    output << (i + 1 < CACHE_TYPE_COUNT ? ",\n" : "\n");
+  }
+
+  output << "  },\n";
+
+  output << "  \"slowest\": [\n";
+  for (size_t i = 0; i < snapshot.slowest.size(); i++) {
+    const asset_timing& asset = snapshot.slowest[i];
+    output << "    { \"type\": ";
+    WriteString(output, GetTypeName(asset.type));
+    output << ", \"path\": ";
+    WriteString(output, asset.path);
+    output << ", \"bytes\": " << asset.bytes << ", ";
+    WritePhases(output, asset.phase_ns);
+    output << ", \"work_ms\": " << ToMillis(asset.GetWorkTime()) << " }";
+    output << (i + 1 < snapshot.slowest.size() ? ",\n" : "\n");
+  }
+
+  output << "  ]\n";
+  output << "}\n";
+}
+
+/**
+ *  Writes a complete ("X") trace event.
+ */
+static void WriteSlice(std::ostream& output, const std::string& name, const char* category,
+                       uint64_t start_ns, uint64_t duration_ns, uint32_t thread) {
+  output << "{\"name\": ";
+  WriteString(output, name);
+  output << ", \"cat\": \"" << category << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread
+         << ", \"ts\": " << ToMicros(start_ns) << ", \"dur\": " << ToMicros(duration_ns) << "}";
+}
+
+void LoaderTelemetry::WriteChromeTrace(std::ostream& output) const {
+  std::vector<asset_timing> uploads;
+  std::vector<asset_timing> assets = CollectAssets(&uploads);
+  auto precision = output.precision(3);
+  auto flags = output.setf(std::ios_base::fixed, std::ios_base::floatfield);
+
+  output << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  bool first = true;
+  auto separate = [&] {
+    if (!first) {
+      output << ",\n";
+    }
+
+    first = false;
+  };
+
+  uint64_t async_id = 0;
+  for (auto& asset : assets) {
+    uint64_t queue_ns = asset.phase_ns[PHASE_QUEUE];
+    uint64_t work_start = asset.start_ns + queue_ns;
+    if (queue_ns > 0) {
+      // queue waits overlap, so they go on async tracks rather than a thread
+      separate();
+      output << "{\"name\": ";
+      WriteString(output, asset.path);
+      output << ", \"cat\": \"queue\", \"ph\": \"b\", \"pid\": 1, \"tid\": 0, \"id\": " << async_id
+             << ", \"ts\": " << ToMicros(asset.start_ns) << "},\n";
+      output << "{\"name\": ";
+      WriteString(output, asset.path);
+      output << ", \"cat\": \"queue\", \"ph\": \"e\", \"pid\": 1, \"tid\": 0, \"id\": " << async_id
+             << ", \"ts\": " << ToMicros(work_start) << "}";
+      async_id++;
+    }
+
+    // io and decode can interleave within a load -- they're drawn back to back, as totals
+    uint64_t io_ns = asset.phase_ns[PHASE_IO];
+    uint64_t decode_ns = asset.phase_ns[PHASE_DECODE];
+    separate();
+    output << "{\"name\": ";
+    WriteString(output, asset.path);
+    output << ", \"cat\": \"" << GetTypeName(asset.type) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << asset.thread
+           << ", \"ts\": " << ToMicros(work_start) << ", \"dur\": " << ToMicros(io_ns + decode_ns)
+           << ", \"args\": {\"bytes\": " << asset.bytes << "}}";
+    if (io_ns > 0) {
+      separate();
+      WriteSlice(output, "io", "io", work_start, io_ns, asset.thread);
+    }
+
+    if (decode_ns > 0) {
+      separate();
+      WriteSlice(output, "decode", "decode", work_start + io_ns, decode_ns, asset.thread);
+    }
+  }
+
+  for (auto& upload : uploads) {
+    separate();
+    WriteSlice(output, upload.path, "upload", upload.start_ns, upload.phase_ns[PHASE_UPLOAD], upload.thread);
+  }
+
+  output << "\n]}\n";
+  output.precision(precision);
+  output.flags(flags);
+}
+
+bool LoaderTelemetry::WriteJSON(const std::string& path, size_t slowest_count) const {
+  std::ofstream output(path, std::ios_base::out | std::ios_base::trunc);
+  if (!output.good()) {
+    return false;
+  }
+
+  WriteJSON(output, slowest_count);
+  return output.good();
+}
+
+bool LoaderTelemetry::WriteChromeTrace(const std::string& path) const {
+  std::ofstream output(path, std::ios_base::out | std::ios_base::trunc);
+  if (!output.good()) {
+    return false;
+  }
+
+  WriteChromeTrace(output);
+  return output.good();
+}
+
+}
+}
@@ -1,70 +1,203 @@
 #include <file/LoaderThreadPool.hpp>
 
+#include <chrono>
+
 namespace monkeysworld {
 namespace file {
 
+// identifies the pool + worker running on the current thread, if any.
+// lets tasks which spawn other tasks keep them on their own deque.
+static thread_local const LoaderThreadPool* tl_pool = nullptr;
+static thread_local int tl_index = -1;
+
 LoaderThreadPool::LoaderThreadPool(int num_threads) {
-  threads_ = new std::thread[num_threads];
-  flags_ = new std::atomic_flag[num_threads];
-  for (int i = 0; i < num_threads; i++) {
-    flags_->test_and_set();
+  num_threads_ = (num_threads > 0 ? num_threads : 0);
+  next_worker_ = 0;
+  pending_total_ = 0;
+  for (int i = 0; i < PRIORITY_COUNT; i++) {
+    pending_[i] = 0;
   }
-  
-  num_threads_ = num_threads;
+
+  sleepers_ = 0;
+  stopping_ = false;
+
+  workers_ = std::make_unique<worker[]>(num_threads_);
+  for (int i = 0; i < num_threads_; i++) {
+    workers_[i].tasks_run = 0;
+    workers_[i].steals = 0;
+    workers_[i].idle_ns = 0;
+  }
+
   for (int i = 0; i < num_threads_; i++) {
-    threads_[i] = std::thread(&LoaderThreadPool::threadfunc_, this, flags_ + i);
+    workers_[i].thread = std::thread(&LoaderThreadPool::threadfunc_, this, i);
   }
 }
 
-void LoaderThreadPool::AddTaskToQueue(std::function<void()> func) {
+void LoaderThreadPool::AddTaskToQueue(std::function<void()> func, TaskPriority priority) {
+  if (num_threads_ == 0) {
+    // nobody to hand it off to
+    func();
+    return;
+  }
+
+  int target;
+  if (tl_pool == this) {
+    target = tl_index;
+  } else {
+    target = static_cast<int>(next_worker_.fetch_add(1, std::memory_order_relaxed) % num_threads_);
+  }
+
   {
-    std::lock_guard<std::mutex> lock(queue_lock_);
-    task_queue_.push(func);
+    std::lock_guard<std::mutex> lock(workers_[target].lock);
+    workers_[target].tasks[priority].push_back(std::move(func));
+    pending_[priority]++;
+    pending_total_++;
+  }
+
+  // only wake a single worker, and only if someone's actually asleep
+  if (sleepers_.load() > 0) {
+    {
+      std::lock_guard<std::mutex> lock(sleep_lock_);
+    }
+
+    sleep_condvar_.notify_one();
   }
-  
-  task_condvar_.notify_all();
 }
 
-void LoaderThreadPool::threadfunc_(std::atomic_flag* flag) {
+bool LoaderThreadPool::RunPendingTask() {
+  if (num_threads_ == 0 || pending_total_.load() <= 0) {
+    return false;
+  }
+
+  // outside threads search as if they were one of the workers, picked round-robin
+  int index;
+  if (tl_pool == this) {
+    index = tl_index;
+  } else {
+    index = static_cast<int>(next_worker_.fetch_add(1, std::memory_order_relaxed) % num_threads_);
+  }
+
   std::function<void()> task;
-  for (;;) {
-    {
-      std::unique_lock<std::mutex> lock(queue_lock_);
-      while (task_queue_.empty()) {
-        if (!flag->test_and_set()) {
-          return;
-        }
+  if (!FindTask(index, task)) {
+    return false;
+  }
+
+  task();
+  return true;
+}
+
+std::vector<worker_stats> LoaderThreadPool::GetWorkerStats() const {
+  std::vector<worker_stats> res(num_threads_);
+  for (int i = 0; i < num_threads_; i++) {
+    res[i].tasks_run = workers_[i].tasks_run.load();
+    res[i].steals = workers_[i].steals.load();
+    res[i].idle_seconds = workers_[i].idle_ns.load() / 1e9;
+  }
+
+  return res;
+}
 
-        task_condvar_.wait(lock);
+bool LoaderThreadPool::FindTask(int index, std::function<void()>& task) {
+  for (int p = 0; p < PRIORITY_COUNT; p++) {
+    if (pending_[p].load() <= 0) {
+      continue;
+    }
+
+    // own deque first, oldest task first
+    {
+      worker& self = workers_[index];
+      std::lock_guard<std::mutex> lock(self.lock);
+      if (!self.tasks[p].empty()) {
+        task = std::move(self.tasks[p].front());
+        self.tasks[p].pop_front();
+        pending_[p]--;
+        pending_total_--;
+        return true;
       }
+    }
 
-      task = std::move(task_queue_.front());
-      task_queue_.pop();
+    // steal from the back, away from where the owner is working.
+    // take half of what's there, so that we don't have to come back for each task.
+    std::vector<std::function<void()>> stolen;
+    for (int i = 1; i < num_threads_ && stolen.empty(); i++) {
+      worker& victim = workers_[(index + i) % num_threads_];
+      std::lock_guard<std::mutex> lock(victim.lock);
+      auto& victim_tasks = victim.tasks[p];
+      size_t count = (victim_tasks.size() + 1) / 2;
+      for (size_t j = 0; j < count; j++) {
+        stolen.push_back(std::move(victim_tasks.back()));
+        victim_tasks.pop_back();
+      }
     }
 
-    task();
+    if (!stolen.empty()) {
+      task = std::move(stolen.front());
+      pending_[p]--;
+      pending_total_--;
+      workers_[index].steals += stolen.size();
+      if (stolen.size() > 1) {
+        // keep the stolen tasks in their original order
+        worker& self = workers_[index];
+        std::lock_guard<std::mutex> lock(self.lock);
+        for (size_t j = 1; j < stolen.size(); j++) {
+          self.tasks[p].push_front(std::move(stolen[j]));
+        }
+      }
+
+      return true;
+    }
   }
+
+  return false;
 }
 
-LoaderThreadPool::~LoaderThreadPool() {
-  if (num_threads_ > 0) {
-    for (int i = 0; i < num_threads_; i++) {
-      // notify all threads to wind down
-      flags_[i].clear();
+void LoaderThreadPool::threadfunc_(int index) {
+  tl_pool = this;
+  tl_index = index;
+  worker& self = workers_[index];
+  std::function<void()> task;
+  for (;;) {
+    if (FindTask(index, task)) {
+      // count the task before running it -- once it's done, its future may already be
+      // resolved, and whoever is waiting on it should see the count.
+      self.tasks_run++;
+      task();
+      // release anything captured by the task before we sleep
+      task = nullptr;
+      continue;
     }
 
-    // start up the threads
-    task_condvar_.notify_all();
-    for (int i = 0; i < num_threads_; i++) {
-      // join as they wind down
-      threads_[i].join();
+    if (stopping_.load() && pending_total_.load() <= 0) {
+      return;
     }
 
-    // delete heap allocated threads and flags
-    delete[] threads_;
-    delete[] flags_;
+    auto idle_start = std::chrono::steady_clock::now();
+    {
+      std::unique_lock<std::mutex> lock(sleep_lock_);
+      sleepers_++;
+      sleep_condvar_.wait(lock, [&] {
+        return (pending_total_.load() > 0 || stopping_.load());
+      });
+      sleepers_--;
+    }
+
+    auto idle_end = std::chrono::steady_clock::now();
+    self.idle_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(idle_end - idle_start).count();
+  }
+}
+
+LoaderThreadPool::~LoaderThreadPool() {
+  // workers drain whatever is left in the queues before they wind down
+  stopping_ = true;
+  {
+    std::lock_guard<std::mutex> lock(sleep_lock_);
+  }
+
+  sleep_condvar_.notify_all();
+  for (int i = 0; i < num_threads_; i++) {
+    workers_[i].thread.join();
   }
 }
 
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,185 @@
+#include <file/MappedFile.hpp>
+#include <file/exception/FileNotFoundException.hpp>
+
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace monkeysworld {
+namespace file {
+
+using exception::FileNotFoundException;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) : data_(nullptr), size_(0),
+                                                   file_handle_(INVALID_HANDLE_VALUE),
+                                                   mapping_handle_(NULL) {
+  file_handle_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file_handle_ == INVALID_HANDLE_VALUE) {
+    BOOST_LOG_TRIVIAL(error) << "could not open " << path << " for mapping";
+    throw FileNotFoundException("Could not open file for mapping");
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file_handle_, &size)) {
+    Unmap();
+    throw FileNotFoundException("Could not stat mapped file");
+  }
+
+  size_ = static_cast<uint64_t>(size.QuadPart);
+  if (size_ == 0) {
+    // can't map an empty file -- leave data null
+    return;
+  }
+
+  mapping_handle_ = CreateFileMappingA(file_handle_, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping_handle_ == NULL) {
+    Unmap();
+    throw FileNotFoundException("Could not create file mapping");
+  }
+
+  data_ = static_cast<const char*>(MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+  if (data_ == nullptr) {
+    Unmap();
+    throw FileNotFoundException("Could not map view of file");
+  }
+}
+
+void MappedFile::Unmap() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+
+  if (mapping_handle_ != NULL) {
+    CloseHandle(mapping_handle_);
+  }
+
+  if (file_handle_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(file_handle_);
+  }
+
+  data_ = nullptr;
+  size_ = 0;
+  mapping_handle_ = NULL;
+  file_handle_ = INVALID_HANDLE_VALUE;
+}
+
+void MappedFile::Prefetch(uint64_t offset, uint64_t size) const {
+  // PrefetchVirtualMemory isn't available before windows 8 -- views fault pages in on their own
+}
+
+MappedFile::MappedFile(MappedFile&& other) : data_(other.data_), size_(other.size_),
+                                             file_handle_(other.file_handle_),
+                                             mapping_handle_(other.mapping_handle_) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+  other.file_handle_ = INVALID_HANDLE_VALUE;
+  other.mapping_handle_ = NULL;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) {
+  if (this != &other) {
+    Unmap();
+    data_ = other.data_;
+    size_ = other.size_;
+    file_handle_ = other.file_handle_;
+    mapping_handle_ = other.mapping_handle_;
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.file_handle_ = INVALID_HANDLE_VALUE;
+    other.mapping_handle_ = NULL;
+  }
+
+  return *this;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) : data_(nullptr), size_(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    BOOST_LOG_TRIVIAL(error) << "could not open " << path << " for mapping";
+    throw FileNotFoundException("Could not open file for mapping");
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    throw FileNotFoundException("Could not stat mapped file");
+  }
+
+  size_ = static_cast<uint64_t>(info.st_size);
+  if (size_ == 0) {
+    close(fd);
+    return;
+  }
+
+  void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping holds its own reference to the file
+  close(fd);
+  if (addr == MAP_FAILED) {
+    size_ = 0;
+    throw FileNotFoundException("Could not map file");
+  }
+
+  data_ = static_cast<const char*>(addr);
+}
+
+void MappedFile::Unmap() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void MappedFile::Prefetch(uint64_t offset, uint64_t size) const {
+  if (data_ == nullptr || offset >= size_) {
+    return;
+  }
+
+  // madvise wants a page-aligned start
+  static const uint64_t page_mask = static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) - 1;
+  uint64_t end = std::min(offset + size, size_);
+  uint64_t start = offset & ~page_mask;
+  madvise(const_cast<char*>(data_) + start, end - start, MADV_WILLNEED);
+}
+
+MappedFile::MappedFile(MappedFile&& other) : data_(other.data_), size_(other.size_) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) {
+  if (this != &other) {
+    Unmap();
+    data_ = other.data_;
+    size_ = other.size_;
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+
+  return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+  Unmap();
+}
+
+}
+}
@@ -1,14 +1,16 @@
 #include <file/ModelLoader.hpp>
+#include <file/BakedMesh.hpp>
+#include <file/MappedFile.hpp>
 #include <critter/Model.hpp>
 
 #include <file/exception/FileNotFoundException.hpp>
 
-#include <boost/algorithm/string.hpp>
-#include <boost/regex.hpp>
-#include <boost/lexical_cast.hpp>
-
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <cinttypes>
-#include <fstream>
+#include <cstring>
+#include <functional>
 
 namespace monkeysworld {
 namespace file {
@@ -16,69 +18,51 @@ namespace file {
 using exception::FileNotFoundException;
 using model::Mesh;
 using storage::VertexPacket3D;
-using boost::lexical_cast;
-
-/**
- *  Static method used to load OBJ files.
- *  @param path - path to the model being loaded
- *  @param file_size - output param for file size
- */ 
-static std::shared_ptr<Mesh<VertexPacket3D>> FromObjFile(const std::string& path, uint64_t* file_size);
 
 ModelLoader::ModelLoader(std::shared_ptr<LoaderThreadPool> thread_pool,
-                         std::vector<cache_record> cache) : CachedLoader(thread_pool) {
+                         std::vector<cache_record> cache,
+                         std::shared_ptr<AssetPack> pack,
+                         std::shared_ptr<LoaderTelemetry> telemetry,
+                         const std::string& bake_dir) : CachedLoader(thread_pool, MODEL, telemetry),
+                                                        pack_(pack),
+                                                        bake_dir_(bake_dir) {
   loader_.bytes_read = 0;
   loader_.bytes_sum = 0;
   for (auto record : cache) {
     // figure out how many bytes we need to read
     if (record.type == MODEL) {
       loader_.bytes_sum += record.file_size;
+      ReportExpectedBytes(record.file_size);
       LoadOBJToCache(record);
     }
   }
 }
 
 std::shared_ptr<model::Mesh<>> ModelLoader::LoadFile(const std::string& path) {
+  auto create_model = [this](const std::string& p, bool use_pack, cache_entry<model_record>* entry) {
+    return CreateModel(p, use_pack, entry);
+  };
 
-  {
-    // wait until the cache is done loading :)
-    std::shared_lock<std::shared_timed_mutex>(cache_mutex_);
-    auto i = model_cache_.find(path);
-    if (i != model_cache_.end()) {
-      return i->second.ptr;
-    }
-  }
-
-  uint64_t size = 0;
-
-  std::shared_ptr<model::Mesh<>> mesh = FromObjFile(path, &size);
-
-  // insert old method here
-
-
-  model_record record = {mesh, size};
-
-  {
-    std::unique_lock<std::shared_timed_mutex>(cache_mutex_);
-    model_cache_.insert(std::make_pair(path, record));
+  model_record record;
+  if (!LookupEntry(model_cache_, path, create_model, &record)) {
+    BOOST_LOG_TRIVIAL(warning) << "Model " << path << " unable to be loaded.";
+    return nullptr;
   }
 
-  return mesh;
+  return record.ptr;
 }
 
 std::vector<cache_record> ModelLoader::GetCache() {
   std::vector<cache_record> result;
   // store something which preserves file size
-  {
-    std::shared_lock<std::shared_timed_mutex>(cache_mutex_);
-    cache_record record_temp;
-    for (auto entry : model_cache_) {
-      record_temp.file_size = entry.second.size;
-      record_temp.path = entry.first;
-      record_temp.type = CacheType::MODEL;
-      result.push_back(record_temp);
-    }
-  }
+  cache_record record_temp;
+  model_cache_.ForEach([&](const AssetCache<model_record>::node& entry) {
+    record_temp.file_size = entry.value.size;
+    record_temp.path = entry.path;
+    record_temp.type = CacheType::MODEL;
+    record_temp.stamp = entry.stamp;
+    result.push_back(record_temp);
+  });
 
   return result;
 }
@@ -100,35 +84,63 @@ void ModelLoader::WaitUntilLoaded() {
 }
 
 bool ModelLoader::IsCached(const std::string& path) {
-  auto res = model_cache_.find(path);
-  return (res != model_cache_.end());
+  return (model_cache_.Find(path) != nullptr);
+}
+
+bool ModelLoader::CreateModel(const std::string& path, bool use_pack, cache_entry<model_record>* entry) {
+  if (use_pack && pack_) {
+    entry->value.ptr = pack_->GetModel(path, &entry->value.size, &entry->stamp);
+    if (entry->value.ptr) {
+      entry->packed = true;
+      LoaderTelemetry::MarkPhase(PHASE_IO);
+      return true;
+    }
+  }
+
+  // stamped first, so that a write which races with the parse shows up as a change next time.
+  // the bake does its own size/mtime check, so a changed OBJ is always reparsed
+  if (!UpdateAssetStamp(path, &entry->stamp)) {
+    return false;
+  }
+
+  LoaderTelemetry::MarkPhase(PHASE_IO);
+
+  try {
+    entry->value.ptr = FromBakedOrObjFile(path, &entry->value.size, GetThreadPool().get(), bake_dir_);
+  } catch (FileNotFoundException& e) {
+    return false;
+  }
+
+  entry->packed = false;
+  return true;
 }
 
 void ModelLoader::LoadOBJToCache(cache_record& record) {
   auto load_model = [=] {
-    uint64_t file_size;
-    auto result = FromObjFile(record.path, &file_size);
+    auto create_model = [this](const std::string& p, bool use_pack, cache_entry<model_record>* entry) {
+      return CreateModel(p, use_pack, entry);
+    };
 
     // updates the file size if necessary
-    model_record cache = {result, file_size};
-    {
-      std::unique_lock<std::shared_timed_mutex>(cache_mutex_);
-      model_cache_.insert(std::make_pair(record.path, cache));
+    cache_entry<model_record> cache;
+    if (PrefetchEntry(record.path, record.stamp, create_model, &cache)) {
+      model_cache_.Store(record.path, std::move(cache), false);
+    } else {
+      BOOST_LOG_TRIVIAL(warning) << "While caching: Model " << record.path << " not found";
     }
 
+    ReportLoadedBytes(record.file_size);
     {
-      std::unique_lock<std::mutex>(this->loader_mutex_);
+      std::unique_lock<std::mutex> lock(this->loader_mutex_);
       loader_.bytes_read += record.file_size;
 
       if (loader_.bytes_read >= loader_.bytes_sum) {
         load_cond_var_.notify_all();
       }
     }
-
   };
 
-  
-  GetThreadPool()->AddTaskToQueue(load_model);
+  QueueTask(load_model);
 }
 
 
@@ -140,6 +152,7 @@ void ModelLoader::LoadOBJToCache(cache_record& record) {
 
 /**
  *  Hashable struct which refers to position, normal, tex indices when loading from obj.
+ *  Indices are absolute and 1-based -- 0 represents a missing index.
  */ 
 struct vnt_triplet {
   uint32_t v_index;
@@ -153,247 +166,703 @@ constexpr bool operator==(const vnt_triplet& lhs, const vnt_triplet& rhs) {
        && lhs.t_index == rhs.t_index);
 }
 
-enum data_type {
-  vertex_normal,
-  vertex_position,
-  texture_coord,
-  ignore
-};
-
 /**
  *  Hash func for triplets.
  */ 
 struct vnt_triplet_hash {
   std::size_t operator()(vnt_triplet const& triplet) const noexcept {
-    std::size_t res = triplet.v_index | (((std::size_t)triplet.n_index) << 32);
-    // whatever lol
-    return res ^ (std::size_t)triplet.t_index;
+    // exporters commonly emit v == t == n, so the components need to be mixed --
+    // xoring them directly collapses every such triplet into the same bucket.
+    uint64_t res = triplet.v_index * 0x9E3779B97F4A7C15ull;
+    res ^= triplet.n_index * 0xC2B2AE3D27D4EB4Full;
+    res ^= triplet.t_index * 0x165667B19E3779F9ull;
+    return static_cast<std::size_t>(res ^ (res >> 32));
   }
 };
 
 /**
- *  Inserts face indices found in `line` into `set`.
- *  @param map - map of triplets to indices.
- *  @param line - the line being parsed. Must contain OBJ data as specified by format.
- *  @param poly_data - reference to vector containing polygons by index.
- *  @param vert_count - number of vertices tallied so far.
+ *  Face index which was declared relative to the end of an attribute list.
+ *  Resolved once the number of elements declared before the chunk is known.
+ */ 
+struct relative_index {
+  size_t corner;              // index into obj_data::corners
+  int component;              // 0 = position, 1 = texcoord, 2 = normal
+  int64_t offset;             // 1-based index, relative to the start of the chunk
+};
+
+/**
+ *  Raw contents of an OBJ file (or a chunk of one), prior to deduplicating vertices.
+ */ 
+struct obj_data {
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> texcoords;
+  std::vector<glm::vec3> normals;
+
+  // one entry per face corner, in file order
+  std::vector<vnt_triplet> corners;
+
+  // number of corners in each face
+  std::vector<uint32_t> poly_sizes;
+
+  // corners which used negative indices
+  std::vector<relative_index> relative;
+};
+
+/**
+ *  A contiguous range of lines from an OBJ file, parsed independently of the others.
+ */ 
+struct obj_chunk {
+  const char* begin;
+  const char* end;
+  obj_data data;
+
+  // unique triplets in this chunk, in order of first appearance
+  std::vector<vnt_triplet> unique;
+  std::vector<size_t> unique_hashes;
+
+  // per corner: index into `unique`, later remapped to a vertex index
+  std::vector<unsigned int> corner_ids;
+};
+
+// files smaller than this are always parsed on the calling thread.
+static const uint64_t MIN_CHUNK_SIZE = 1 << 20;
+
+// chunks per thread -- a little extra keeps threads busy when chunk costs differ.
+static const int CHUNKS_PER_THREAD = 2;
+
+/**
+ *  Parses all OBJ lines in [cur, end) into `data`.
+ *  @param cur - start of the text being parsed. Must be the start of a line.
+ *  @param end - end of the text being parsed.
+ *  @param data - output for parsed attributes and faces.
  */ 
-static void InsertFaceIndices(std::unordered_map<vnt_triplet, unsigned int, vnt_triplet_hash>& map,
-                              std::string& line,
-                              std::vector<std::vector<unsigned int>>& poly_data,
-                              std::vector<vnt_triplet>& vert_triplets_ordered,
-                              unsigned int* vert_count);
+static void ParseObjText(const char* cur, const char* end, obj_data& data);
 
 /**
- *  Trims down the header of an OBJ line.
- *  @param line - the line we are trimming.
+ *  Splits `size` bytes of text at `data` into at most `count` chunks, on line boundaries.
  */ 
-static void TrimHeader(std::string& line);
-static data_type GetDataType(const std::string& line);
+static std::vector<obj_chunk> SplitObjText(const char* data, uint64_t size, int count);
 
-static std::shared_ptr<Mesh<VertexPacket3D>> FromObjFile(const std::string& path, uint64_t* file_size) {
-  auto obj_stream = std::ifstream(path);
-  if (!obj_stream.good()) {
-    // invalid model location
-    BOOST_LOG_TRIVIAL(error) << "File does not exist!";
-    throw FileNotFoundException("File does not exist");
+/**
+ *  Resolves relative indices, deduplicates corners, and builds a mesh from the parsed chunks.
+ *  Vertices are ordered by first appearance, regardless of how the file was chunked.
+ */ 
+static std::shared_ptr<Mesh<VertexPacket3D>> BuildMeshFromChunks(std::vector<obj_chunk>& chunks,
+                                                                 LoaderThreadPool* pool);
+
+/**
+ *  Runs `func(i)` for every i in [0, count), using `pool` to help out.
+ *  The calling thread participates, and returns once every call has completed --
+ *  so this is safe to call from inside a pool task, even if the pool is saturated.
+ */ 
+static void ParallelFor(LoaderThreadPool* pool, size_t count, const std::function<void(size_t)>& func);
+
+std::shared_ptr<Mesh<VertexPacket3D>> ModelLoader::FromBakedOrObjFile(const std::string& path,
+                                                                      uint64_t* file_size,
+                                                                      LoaderThreadPool* pool,
+                                                                      const std::string& bake_dir) {
+  uint64_t source_size;
+  int64_t source_mtime;
+  if (!GetSourceStamp(path, &source_size, &source_mtime)) {
+    // let the obj loader report the missing file
+    return FromObjFile(path, file_size, pool);
   }
 
-  obj_stream.seekg(0, std::ios_base::end);
-  *file_size = obj_stream.tellg();
-  obj_stream.seekg(0, std::ios_base::beg);
- 
-  std::string line_data;
-  const int MAX_LINE_SIZE = 512;
-  line_data.resize(MAX_LINE_SIZE);
+  std::string bake_path = GetBakedMeshPath(path, bake_dir);
+  auto mesh = ReadBakedMesh(bake_path, source_size, source_mtime);
+  LoaderTelemetry::MarkPhase(PHASE_IO);
+  if (mesh != nullptr) {
+    BOOST_LOG_TRIVIAL(trace) << "loaded baked mesh for " << path;
+    *file_size = source_size;
+    return mesh;
+  }
 
-  // maps unique triplets to their vert. address.
-  std::unordered_map<vnt_triplet, unsigned int, vnt_triplet_hash> vert_triplets;
+  mesh = FromObjFile(path, file_size, pool);
+  if (!WriteBakedMesh(bake_path, *mesh, source_size, source_mtime)) {
+    BOOST_LOG_TRIVIAL(warning) << "could not bake " << path << " -- will parse OBJ on next load";
+  }
 
-  // ordered list which backs up vert_triplets.
-  std::vector<vnt_triplet> vert_triplets_ordered;
+  return mesh;
+}
 
-  // stores vectors representing polygons in the model.
-  std::vector<std::vector<unsigned int>> poly_data;
+std::shared_ptr<Mesh<VertexPacket3D>> ModelLoader::FromObjFile(const std::string& path,
+                                                               uint64_t* file_size,
+                                                               LoaderThreadPool* pool) {
+  // throws FileNotFoundException if the model doesn't exist
+  MappedFile obj_file(path);
+  *file_size = obj_file.GetSize();
+
+  int chunk_count = 1;
+  if (pool != nullptr) {
+    // the calling thread pitches in as well
+    uint64_t max_chunks = obj_file.GetSize() / MIN_CHUNK_SIZE;
+    chunk_count = static_cast<int>(std::min<uint64_t>((pool->GetThreadCount() + 1) * CHUNKS_PER_THREAD, max_chunks));
+    chunk_count = std::max(chunk_count, 1);
+  }
 
-  // stores position data.
-  std::vector<glm::vec3> position_data;
+  auto chunks = SplitObjText(obj_file.GetData(), obj_file.GetSize(), chunk_count);
+  if (chunks.empty()) {
+    // empty file -- nothing to parse, and nothing to merge
+    return std::make_shared<Mesh<VertexPacket3D>>();
+  }
 
-  // stores texture coordinate data.
-  std::vector<glm::vec2> texcoord_data;
+  ParallelFor(pool, chunks.size(), [&](size_t i) {
+    ParseObjText(chunks[i].begin, chunks[i].end, chunks[i].data);
+  });
 
-  // stores normal data.
-  std::vector<glm::vec3> normal_data;
+  return BuildMeshFromChunks(chunks, pool);
+}
+
+static void ParallelFor(LoaderThreadPool* pool, size_t count, const std::function<void(size_t)>& func) {
+  if (pool == nullptr || count <= 1) {
+    for (size_t i = 0; i < count; i++) {
+      func(i);
+    }
+
+    return;
+  }
+
+  // shared with pool tasks, which may outlive this call if they start late
+  struct parallel_state {
+    std::function<void(size_t)> func;
+    size_t count;
+    std::atomic<size_t> next;
+    size_t done;
+    std::mutex done_lock;
+    std::condition_variable done_cond;
+  };
+
+  auto state = std::make_shared<parallel_state>();
+  state->func = func;
+  state->count = count;
+  state->next = 0;
+  state->done = 0;
+
+  auto worker = [state] {
+    size_t finished = 0;
+    size_t i;
+    while ((i = state->next.fetch_add(1)) < state->count) {
+      state->func(i);
+      finished++;
+    }
+
+    if (finished > 0) {
+      std::lock_guard<std::mutex> lock(state->done_lock);
+      state->done += finished;
+      if (state->done == state->count) {
+        state->done_cond.notify_all();
+      }
+    }
+  };
+
+  int helpers = std::min<int>(pool->GetThreadCount(), static_cast<int>(count) - 1);
+  for (int i = 0; i < helpers; i++) {
+    pool->AddTaskToQueue(worker);
+  }
+
+  worker();
+
+  std::unique_lock<std::mutex> lock(state->done_lock);
+  state->done_cond.wait(lock, [&] { return state->done == state->count; });
+}
+
+static std::vector<obj_chunk> SplitObjText(const char* data, uint64_t size, int count) {
+  std::vector<obj_chunk> chunks;
+  const char* end = data + size;
+  const char* cur = data;
+  for (int i = 1; i <= count && cur < end; i++) {
+    const char* split = data + (size * i) / count;
+    if (split < cur) {
+      continue;
+    }
+
+    // extend to the end of the line, so that chunks always start on a fresh line
+    if (split < end) {
+      const char* line_end = static_cast<const char*>(std::memchr(split, '\n', end - split));
+      split = (line_end == nullptr ? end : line_end + 1);
+    }
+
+    obj_chunk chunk;
+    chunk.begin = cur;
+    chunk.end = split;
+    chunks.push_back(std::move(chunk));
+    cur = split;
+  }
+
+  return chunks;
+}
+
+static bool IsSpace(char c) {
+  return (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f');
+}
+
+/**
+ *  Skips past the header of an OBJ line, up to the first digit, minus sign, or slash.
+ *  @returns pointer to the first character of line data.
+ */ 
+static const char* TrimHeader(const char* cur, const char* end) {
+  while (cur < end && !((*cur >= '0' && *cur <= '9') || *cur == '-' || *cur == '/')) {
+    cur++;
+  }
+
+  return cur;
+}
+
+/**
+ *  @returns pointer to the end of the whitespace-delimited token starting at `cur`.
+ */ 
+static const char* FindTokenEnd(const char* cur, const char* end) {
+  while (cur < end && !IsSpace(*cur)) {
+    cur++;
+  }
+
+  return cur;
+}
+
+/**
+ *  Parses a float which spans the whole of [begin, end).
+ *  @returns the parsed value, or 0 if the token is not a valid float.
+ */ 
+static float ParseFloatToken(const char* begin, const char* end) {
+  if (begin < end && *begin == '+') {
+    begin++;
+  }
+
+  float res = 0.0f;
+  auto conv = std::from_chars(begin, end, res);
+  if (conv.ec != std::errc() || conv.ptr != end) {
+    return 0.0f;
+  }
+
+  return res;
+}
+
+/**
+ *  Parses a single v/t/n index which spans the whole of [begin, end).
+ *  @returns the index as written, or 0 if the index is missing or invalid.
+ *           Negative return values are relative indices.
+ */ 
+static int64_t ParseIndexToken(const char* begin, const char* end) {
+  if (begin < end && *begin == '+') {
+    begin++;
+  }
 
-  // used for tracking number of vertices thus far.
-  unsigned int vert_count = 0;
-  while (!obj_stream.eof()) {
-    // fetch line
-    std::getline(obj_stream, line_data);
-    if (line_data[0] == 'f') {
-      // face data -- call InsertFaceIndices to handle.
-      InsertFaceIndices(vert_triplets, line_data, poly_data, vert_triplets_ordered, &vert_count);
-    } else if (line_data[0] == 'v') {
-      data_type type = GetDataType(line_data);
-      TrimHeader(line_data);
-
-      std::vector<std::string> vals;
-      boost::split(vals, line_data, [](char c){ return std::isspace(c); }, boost::token_compress_on);
-      glm::vec3 data(0.0);
-
-      // read values from string to float!
-      for (int i = 0; i < vals.size() && i < 3; i++) {
-        if (vals[i].size() > 0) {
-          try {
-            data[i] = boost::lexical_cast<float>(vals[i]);
-          }
-          catch (boost::bad_lexical_cast e) {
-            data[i] = 0.0f;
-          }
+  if (begin == end) {
+    return 0;
+  }
+
+  int64_t res;
+  auto conv = std::from_chars(begin, end, res);
+  if (conv.ec != std::errc() || conv.ptr != end) {
+    return 0;
+  }
+
+  return res;
+}
+
+/**
+ *  @returns `index` as a triplet component, or 0 if it is out of range.
+ */ 
+static uint32_t ToTripletIndex(int64_t index) {
+  return ((index < 1 || index > UINT32_MAX) ? 0 : static_cast<uint32_t>(index));
+}
+
+/**
+ *  Sets the component of `t` designated by `component`.
+ */ 
+static void SetTripletComponent(vnt_triplet& t, int component, uint32_t value) {
+  switch (component) {
+    case 0:
+      t.v_index = value;
+      break;
+    case 1:
+      t.t_index = value;
+      break;
+    default:
+      t.n_index = value;
+  }
+}
+
+/**
+ *  Reads up to three floats from a `v`, `vt` or `vn` line.
+ */ 
+static glm::vec3 ParseVertexLine(const char* cur, const char* end) {
+  glm::vec3 res(0.0f);
+  cur = TrimHeader(cur, end);
+  for (int i = 0; i < 3 && cur < end; i++) {
+    const char* token_end = FindTokenEnd(cur, end);
+    res[i] = ParseFloatToken(cur, token_end);
+    cur = token_end;
+    while (cur < end && IsSpace(*cur)) {
+      cur++;
+    }
+  }
+
+  return res;
+}
+
+/**
+ *  Reads the v/t/n corners of an `f` line into `data`.
+ */ 
+static void ParseFaceLine(const char* cur, const char* end, obj_data& data) {
+  uint32_t corner_count = 0;
+  const size_t counts[3] = { data.positions.size(), data.texcoords.size(), data.normals.size() };
+  cur = TrimHeader(cur, end);
+  while (cur < end) {
+    const char* token_end = FindTokenEnd(cur, end);
+    if (token_end != cur) {
+      // split the corner on slashes -- any component may be missing
+      vnt_triplet t;
+      const char* comp = cur;
+      for (int i = 0; i < 3; i++) {
+        const char* comp_begin = comp;
+        while (comp < token_end && *comp != '/') {
+          comp++;
+        }
+
+        int64_t index = ParseIndexToken(comp_begin, comp);
+        if (index < 0) {
+          // relative to the most recently declared element
+          data.relative.push_back({ data.corners.size(), i, static_cast<int64_t>(counts[i]) + index + 1 });
+          index = 0;
         }
-        else {
-          data[i] = 0.0f;
+
+        SetTripletComponent(t, i, ToTripletIndex(index));
+        if (comp < token_end) {
+          comp++;
         }
       }
 
-      switch(type) {
-        case vertex_position:
-          position_data.push_back(data);
+      data.corners.push_back(t);
+      corner_count++;
+    }
+
+    cur = token_end;
+    while (cur < end && IsSpace(*cur)) {
+      cur++;
+    }
+  }
+
+  data.poly_sizes.push_back(corner_count);
+}
+
+static void ParseObjText(const char* cur, const char* end, obj_data& data) {
+  while (cur < end) {
+    const char* line_end = static_cast<const char*>(std::memchr(cur, '\n', end - cur));
+    if (line_end == nullptr) {
+      line_end = end;
+    }
+
+    if (*cur == 'f') {
+      ParseFaceLine(cur, line_end, data);
+    } else if (*cur == 'v' && cur + 1 < line_end) {
+      // "vp" (parameter space vertices) is not supported
+      switch (cur[1]) {
+        case 'n':
+          data.normals.push_back(ParseVertexLine(cur, line_end));
           break;
-        case vertex_normal:
-          normal_data.push_back(data);
+        case 't': {
+          glm::vec3 coord = ParseVertexLine(cur, line_end);
+          data.texcoords.push_back(glm::vec2(coord.x, coord.y));
           break;
-        case texture_coord:
-          texcoord_data.push_back(glm::vec2(data.x, data.y));
+        }
+        case 'p':
           break;
-        // ignore default case
+        default:
+          data.positions.push_back(ParseVertexLine(cur, line_end));
       }
-    } else {
-      // ignore (comment, line, mtl, etc)
-      continue;
     }
+
+    // ignore anything else (comment, line, mtl, etc)
+    cur = line_end + 1;
   }
-  
-  std::shared_ptr<model::Mesh<>> mesh = std::make_shared<model::Mesh<>>();
+}
 
-  VertexPacket3D temp_data;
-  BOOST_LOG_TRIVIAL(trace) << "logged " << position_data.size() << "pos, " << texcoord_data.size() << "tex, " << normal_data.size() << "norm.";
-  for (auto vert_triplet : vert_triplets_ordered) {
-    if (vert_triplet.v_index == 0) {
-      temp_data.position = glm::vec3(0);
-    } else {
-      temp_data.position = position_data[vert_triplet.v_index - 1];
+/**
+ *  Open-addressed hash table mapping triplets to indices.
+ *  Loading large models makes millions of tiny inserts, which unordered_map handles poorly.
+ */ 
+class TripletTable {
+ public:
+  /**
+   *  @param expected - rough number of entries, used to size the table.
+   */ 
+  TripletTable(size_t expected) : size_(0) {
+    size_t capacity = 16;
+    while (capacity < expected * 2) {
+      capacity <<= 1;
     }
 
-    if (vert_triplet.t_index == 0) {
-      temp_data.coords = glm::vec2(0);
-    } else {
-      temp_data.coords = texcoord_data[vert_triplet.t_index - 1];
-    }
+    slots_.resize(capacity, { { 0, 0, 0 }, EMPTY });
+  }
 
-    if (vert_triplet.n_index == 0) {
-      temp_data.normals = glm::vec3(1, 0, 0);
-    } else {
-      temp_data.normals = normal_data[vert_triplet.n_index - 1];
+  /**
+   *  Inserts `value` under `key`, if no entry exists yet.
+   *  @param hash - vnt_triplet_hash of `key`.
+   *  @param inserted - output param, set to true if a new entry was created.
+   *  @returns the value associated with `key` after the insert.
+   */ 
+  uint32_t Insert(const vnt_triplet& key, size_t hash, uint32_t value, bool* inserted) {
+    if ((size_ + 1) * 2 > slots_.size()) {
+      Grow();
     }
 
-    mesh->AddVertex(temp_data);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+      slot& s = slots_[i];
+      if (s.value == EMPTY) {
+        s.key = key;
+        s.value = value;
+        size_++;
+        *inserted = true;
+        return value;
+      } else if (s.key == key) {
+        *inserted = false;
+        return s.value;
+      }
+    }
   }
 
-  for (auto poly : poly_data) {
-    mesh->AddPolygon(poly);
+ private:
+  static const uint32_t EMPTY = UINT32_MAX;
+
+  struct slot {
+    vnt_triplet key;
+    uint32_t value;
+  };
+
+  void Grow() {
+    std::vector<slot> old;
+    old.swap(slots_);
+    slots_.resize(old.size() * 2, { { 0, 0, 0 }, EMPTY });
+    size_t mask = slots_.size() - 1;
+    vnt_triplet_hash hasher;
+    for (auto& s : old) {
+      if (s.value != EMPTY) {
+        size_t i = hasher(s.key) & mask;
+        while (slots_[i].value != EMPTY) {
+          i = (i + 1) & mask;
+        }
+
+        slots_[i] = s;
+      }
+    }
   }
 
-  return mesh;
-}
+  std::vector<slot> slots_;
+  size_t size_;
+};
 
-static void TrimHeader(std::string& line) {
-  // int cur = 0;
-  // while (line[cur] != '-'                       // negative number
-  //   && !(line[cur] >= '0' && line[cur] <= '9')  // number
-  //   &&   line[cur] != '/') {                    // face decl
-  //   cur++;
-  // }
-
-  line.erase(line.begin(), std::find_if(line.begin(), line.end(), [](char c) {
-    return ((c >= '0' && c <= '9') || c == '-' || c == '/');
-  }));
+/**
+ *  Deduplicates the corners of a single chunk, populating `unique`, `unique_hashes` and `corner_ids`.
+ */ 
+static void DeduplicateChunk(obj_chunk& chunk) {
+  const auto& corners = chunk.data.corners;
+  vnt_triplet_hash hasher;
+  TripletTable local_ids(corners.size() / 2);
+  chunk.corner_ids.resize(corners.size());
+  for (size_t i = 0; i < corners.size(); i++) {
+    bool inserted;
+    size_t hash = hasher(corners[i]);
+    chunk.corner_ids[i] = local_ids.Insert(corners[i], hash, static_cast<uint32_t>(chunk.unique.size()), &inserted);
+    if (inserted) {
+      chunk.unique.push_back(corners[i]);
+      chunk.unique_hashes.push_back(hash);
+    }
+  }
 }
 
-static void InsertFaceIndices(std::unordered_map<vnt_triplet, unsigned int, vnt_triplet_hash>& map,
-                              std::string& line,
-                              std::vector<std::vector<unsigned int>>& poly_data,
-                              std::vector<vnt_triplet>& vert_triplets_ordered,
-                              unsigned int* vert_count) {
-  
-  // regex to read 3+ face values (v/t/n, any missing)
-
-  // stores face strings
-  std::vector<std::string> verts;
-
-  // stores the calculated indices for this polygon
-  std::vector<unsigned int> ind_data;
-  TrimHeader(line);
-  boost::split(verts, line, [](char c){ return std::isspace(c); }, boost::token_compress_on);
-  // each entry in `verts` now contains a single face decl
-  for (auto vert : verts) {
-    if (vert.size() == 0) {
-      continue;
+/**
+ *  Merges the unique triplets of each chunk into a single list, in order of first appearance.
+ *  Triplets are sharded by hash, so that each shard can be merged on its own thread.
+ *  On return, each chunk's `corner_ids` refer to indices in `vert_triplets_ordered`.
+ */ 
+static void MergeChunkTriplets(std::vector<obj_chunk>& chunks,
+                               std::vector<vnt_triplet>& vert_triplets_ordered,
+                               LoaderThreadPool* pool) {
+  // position of each chunk's unique triplets, in the concatenation of all chunks
+  std::vector<size_t> offsets(chunks.size() + 1, 0);
+  for (size_t c = 0; c < chunks.size(); c++) {
+    offsets[c + 1] = offsets[c] + chunks[c].unique.size();
+  }
+
+  size_t total = offsets.back();
+  size_t shard_count = chunks.size();
+
+  // per concatenated triplet: whether it's the first appearance, and its vertex index
+  std::vector<uint8_t> first(total, 0);
+  std::vector<unsigned int> vertex_ids(total);
+
+  // repeated triplets, paired with the position of their first appearance
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> repeats(shard_count);
+
+  ParallelFor(pool, shard_count, [&](size_t s) {
+    TripletTable table(total / shard_count);
+    for (size_t c = 0; c < chunks.size(); c++) {
+      const auto& chunk = chunks[c];
+      for (size_t i = 0; i < chunk.unique.size(); i++) {
+        // use high bits for the shard -- the table uses the low ones
+        if (((chunk.unique_hashes[i] >> (sizeof(size_t) * 4)) % shard_count) != s) {
+          continue;
+        }
+
+        bool inserted;
+        uint32_t pos = static_cast<uint32_t>(offsets[c] + i);
+        uint32_t first_pos = table.Insert(chunk.unique[i], chunk.unique_hashes[i], pos, &inserted);
+        if (inserted) {
+          first[pos] = 1;
+        } else {
+          repeats[s].push_back(std::make_pair(pos, first_pos));
+        }
+      }
+    }
+  });
+
+  // first appearances are numbered in chunk order
+  std::vector<size_t> id_base(chunks.size() + 1, 0);
+  for (size_t c = 0; c < chunks.size(); c++) {
+    size_t count = 0;
+    for (size_t i = offsets[c]; i < offsets[c + 1]; i++) {
+      count += first[i];
     }
 
-    std::vector<std::string> coord_inds;
-    boost::split(coord_inds, vert, [](char c){ return c == '/'; }, boost::token_compress_off);
-    vnt_triplet t;
+    id_base[c + 1] = id_base[c] + count;
+  }
 
-    // for each: if begin == end, empty string (slashes next to each other)
-    if (coord_inds[0].begin() != coord_inds[0].end()) {
-      t.v_index = lexical_cast<uint32_t>(coord_inds[0]);
-    } else {
-      t.v_index = 0;
+  vert_triplets_ordered.resize(id_base.back());
+  ParallelFor(pool, chunks.size(), [&](size_t c) {
+    unsigned int id = static_cast<unsigned int>(id_base[c]);
+    for (size_t i = 0; i < chunks[c].unique.size(); i++) {
+      if (first[offsets[c] + i]) {
+        vert_triplets_ordered[id] = chunks[c].unique[i];
+        vertex_ids[offsets[c] + i] = id++;
+      }
     }
+  });
 
-    if (coord_inds[1].begin() != coord_inds[1].end()) {
-      t.t_index = lexical_cast<uint32_t>(coord_inds[1]);
-    } else {
-      t.t_index = 0;
+  ParallelFor(pool, shard_count, [&](size_t s) {
+    for (auto& repeat : repeats[s]) {
+      vertex_ids[repeat.first] = vertex_ids[repeat.second];
     }
+  });
 
-    if (coord_inds[2].begin() != coord_inds[2].end()) {
-      t.n_index = lexical_cast<uint32_t>(coord_inds[2]);
-    } else {
-      t.n_index = 0;
+  ParallelFor(pool, chunks.size(), [&](size_t c) {
+    const unsigned int* ids = vertex_ids.data() + offsets[c];
+    for (auto& id : chunks[c].corner_ids) {
+      id = ids[id];
     }
+  });
+}
 
-    auto triplet_entry = map.find(t);
-    if (triplet_entry == map.end()) {
-      // new vertex
-      map.insert(std::make_pair(t, *vert_count));
-      vert_triplets_ordered.push_back(t);
-      ind_data.push_back(*vert_count);
-      (*vert_count)++;
-    } else {
-      // use the old entry!
-      ind_data.push_back(triplet_entry->second);
+static std::shared_ptr<Mesh<VertexPacket3D>> BuildMeshFromChunks(std::vector<obj_chunk>& chunks,
+                                                                 LoaderThreadPool* pool) {
+  // resolve relative indices now that we know how much precedes each chunk
+  int64_t base[3] = { 0, 0, 0 };
+  for (auto& chunk : chunks) {
+    for (auto& rel : chunk.data.relative) {
+      SetTripletComponent(chunk.data.corners[rel.corner], rel.component, ToTripletIndex(base[rel.component] + rel.offset));
     }
 
+    base[0] += chunk.data.positions.size();
+    base[1] += chunk.data.texcoords.size();
+    base[2] += chunk.data.normals.size();
   }
 
-  poly_data.push_back(std::move(ind_data));
-}
+  ParallelFor(pool, chunks.size(), [&](size_t i) {
+    DeduplicateChunk(chunks[i]);
+  });
 
-static data_type GetDataType(const std::string& line) {
-  if (line[0] == 'v') {
-    if (line[1] == 'n') {
-      return data_type::vertex_normal;
-    } else if (line[1] == 't') {
-      return data_type::texture_coord;
-    } else {
-      return data_type::vertex_position;
-    }
+  std::vector<vnt_triplet> vert_triplets_ordered;
+  if (chunks.size() == 1) {
+    // corner ids are already vertex indices
+    vert_triplets_ordered = std::move(chunks[0].unique);
   } else {
-    return data_type::ignore;
+    MergeChunkTriplets(chunks, vert_triplets_ordered, pool);
   }
+
+  // gather attribute data in file order
+  std::vector<glm::vec3> position_data;
+  std::vector<glm::vec2> texcoord_data;
+  std::vector<glm::vec3> normal_data;
+  position_data.reserve(base[0]);
+  texcoord_data.reserve(base[1]);
+  normal_data.reserve(base[2]);
+  for (auto& chunk : chunks) {
+    position_data.insert(position_data.end(), chunk.data.positions.begin(), chunk.data.positions.end());
+    texcoord_data.insert(texcoord_data.end(), chunk.data.texcoords.begin(), chunk.data.texcoords.end());
+    normal_data.insert(normal_data.end(), chunk.data.normals.begin(), chunk.data.normals.end());
+  }
+
+  BOOST_LOG_TRIVIAL(trace) << "logged " << position_data.size() << "pos, " << texcoord_data.size() << "tex, " << normal_data.size() << "norm.";
+
+  std::vector<VertexPacket3D> vertices(vert_triplets_ordered.size());
+  std::atomic_bool out_of_range(false);
+  size_t vertex_chunk = (vertices.size() + chunks.size() - 1) / chunks.size();
+  ParallelFor(pool, chunks.size(), [&](size_t c) {
+    size_t end = std::min(vertices.size(), (c + 1) * vertex_chunk);
+    for (size_t i = c * vertex_chunk; i < end; i++) {
+      const vnt_triplet& t = vert_triplets_ordered[i];
+      VertexPacket3D& packet = vertices[i];
+
+      // missing (or invalid) attributes fall back to defaults
+      packet.position = glm::vec3(0);
+      packet.coords = glm::vec2(0);
+      packet.normals = glm::vec3(1, 0, 0);
+      if (t.v_index != 0) {
+        if (t.v_index <= position_data.size()) {
+          packet.position = position_data[t.v_index - 1];
+        } else {
+          out_of_range = true;
+        }
+      }
+
+      if (t.t_index != 0) {
+        if (t.t_index <= texcoord_data.size()) {
+          packet.coords = texcoord_data[t.t_index - 1];
+        } else {
+          out_of_range = true;
+        }
+      }
+
+      if (t.n_index != 0) {
+        if (t.n_index <= normal_data.size()) {
+          packet.normals = normal_data[t.n_index - 1];
+        } else {
+          out_of_range = true;
+        }
+      }
+    }
+  });
+
+  if (out_of_range) {
+    BOOST_LOG_TRIVIAL(warning) << "OBJ face references missing vertex data -- using defaults";
+  }
+
+  // triangulate each chunk separately, then append in order
+  std::vector<std::vector<unsigned int>> triangles(chunks.size());
+  ParallelFor(pool, chunks.size(), [&](size_t c) {
+    std::vector<unsigned int> poly;
+    size_t corner = 0;
+    triangles[c].reserve(chunks[c].corner_ids.size() * 3 / 2);
+    for (uint32_t size : chunks[c].data.poly_sizes) {
+      // degenerate faces can't be triangulated
+      if (size >= 3) {
+        poly.assign(chunks[c].corner_ids.begin() + corner, chunks[c].corner_ids.begin() + corner + size);
+        Mesh<VertexPacket3D>::TriangulatePolygon(vertices.data(), vertices.size(), poly, triangles[c]);
+      }
+
+      corner += size;
+    }
+  });
+
+  std::shared_ptr<model::Mesh<>> mesh = std::make_shared<model::Mesh<>>();
+  mesh->SetData(vertices.data(), vertices.size(), nullptr, 0);
+  for (auto& tris : triangles) {
+    mesh->AddIndices(tris.data(), tris.size());
+  }
+
+  return mesh;
 }
 
 }
-}
\ No newline at end of file
+}
@@ -6,13 +6,17 @@
 namespace monkeysworld {
 namespace file {
 
-TextureLoader::TextureLoader(std::shared_ptr<LoaderThreadPool> thread_pool, std::vector<cache_record> cache)
-  : CachedLoader(thread_pool) {
+TextureLoader::TextureLoader(std::shared_ptr<LoaderThreadPool> thread_pool,
+                             std::vector<cache_record> cache,
+                             std::shared_ptr<AssetPack> pack,
+                             std::shared_ptr<LoaderTelemetry> telemetry)
+  : CachedLoader(thread_pool, TEXTURE, telemetry), pack_(pack) {
   loader_.bytes_read = 0;
   loader_.bytes_sum = 0;
   for (auto record : cache) {
     if (record.type == TEXTURE) {
       loader_.bytes_sum += record.file_size;
+      ReportExpectedBytes(record.file_size);
       LoadTextureToCache(record);
     }
   }
@@ -20,16 +24,14 @@ TextureLoader::TextureLoader(std::shared_ptr<LoaderThreadPool> thread_pool, std:
 
 std::vector<cache_record> TextureLoader::GetCache() {
   std::vector<cache_record> res;
-  {
-    std::shared_lock<std::shared_timed_mutex>(cache_mutex_);
-    cache_record temp;
-    for (auto entry : texture_cache_) {
-      temp.file_size = entry.second->GetTextureSize();
-      temp.path = entry.first;
-      temp.type = TEXTURE;
-      res.push_back(temp);
-    }
-  }
+  cache_record temp;
+  texture_cache_.ForEach([&](const AssetCache<std::shared_ptr<shader::Texture>>::node& entry) {
+    temp.file_size = entry.value->GetTextureSize();
+    temp.path = entry.path;
+    temp.type = TEXTURE;
+    temp.stamp = entry.stamp;
+    res.push_back(temp);
+  });
 
   return res;
 }
@@ -51,54 +53,71 @@ void TextureLoader::WaitUntilLoaded() {
 }
 
 std::shared_ptr<shader::Texture> TextureLoader::LoadFile(const std::string& path) {
-
-  {
-    std::shared_lock<std::shared_timed_mutex>(cache_mutex_);
-    auto i = texture_cache_.find(path);
-    if (i != texture_cache_.end()) {
-      return i->second;
-    }
-  }
+  auto create_texture = [this](const std::string& p, bool use_pack, cache_entry<std::shared_ptr<shader::Texture>>* entry) {
+    return CreateTexture(p, use_pack, entry);
+  };
 
   std::shared_ptr<shader::Texture> t;
-  try {
-    t = std::make_shared<shader::Texture>(path);
-  } catch (shader::exception::InvalidTexturePathException e) {
+  if (!LookupEntry(texture_cache_, path, create_texture, &t)) {
     BOOST_LOG_TRIVIAL(warning) << "Texture " << path << " unable to be loaded.";
     return std::shared_ptr<shader::Texture>(nullptr);
   }
 
-  {
-    std::unique_lock<std::shared_timed_mutex>(cache_mutex_);
-    texture_cache_.insert(std::make_pair(path, t));
-  }
-
   return t;
 }
 
 bool TextureLoader::IsCached(const std::string& path) {
-  auto res = texture_cache_.find(path);
-  return (res != texture_cache_.end());
+  return (texture_cache_.Find(path) != nullptr);
+}
+
+bool TextureLoader::CreateTexture(const std::string& path,
+                                  bool use_pack,
+                                  cache_entry<std::shared_ptr<shader::Texture>>* entry) {
+  if (use_pack && pack_) {
+    entry->value = pack_->GetTexture(path, &entry->stamp);
+    if (entry->value) {
+      LoaderTelemetry::MarkPhase(PHASE_IO);
+      entry->value->SetUploadCallback(MakeUploadCallback(path));
+      entry->packed = true;
+      return true;
+    }
+  }
+
+  // stamped first, so that a write which races with the decode shows up as a change next time
+  if (!UpdateAssetStamp(path, &entry->stamp)) {
+    return false;
+  }
+
+  // stamping reads the whole source, so what's left is mostly decode
+  LoaderTelemetry::MarkPhase(PHASE_IO);
+  try {
+    entry->value = std::make_shared<shader::Texture>(path);
+  } catch (shader::exception::InvalidTexturePathException& e) {
+    return false;
+  }
+
+  entry->value->SetUploadCallback(MakeUploadCallback(path));
+  entry->packed = false;
+  return true;
 }
 
 void TextureLoader::LoadTextureToCache(const cache_record& record) {
   auto lambda = [=] {
-    std::shared_ptr<shader::Texture> t;
-    try {
-      t = std::make_shared<shader::Texture>(record.path);
-    } catch (shader::exception::InvalidTexturePathException e) {
+    auto create_texture = [this](const std::string& p, bool use_pack, cache_entry<std::shared_ptr<shader::Texture>>* entry) {
+      return CreateTexture(p, use_pack, entry);
+    };
+
+    cache_entry<std::shared_ptr<shader::Texture>> t;
+    if (PrefetchEntry(record.path, record.stamp, create_texture, &t)) {
+      texture_cache_.Store(record.path, std::move(t), false);
+    } else {
       // invalid path
       BOOST_LOG_TRIVIAL(warning) << "While caching: File " << record.path << " not found";
-      return;
-    }
-
-    {
-      std::unique_lock<std::shared_timed_mutex>(cache_mutex_);
-      texture_cache_.insert(std::make_pair(record.path, t));
     }
 
+    ReportLoadedBytes(record.file_size);
     {
-      std::unique_lock<std::mutex>(loader_mutex_);
+      std::unique_lock<std::mutex> lock(loader_mutex_);
       loader_.bytes_read += record.file_size;
 
       if (loader_.bytes_read >= loader_.bytes_sum) {
@@ -107,7 +126,7 @@ void TextureLoader::LoadTextureToCache(const cache_record& record) {
     }
   };
 
-  GetThreadPool()->AddTaskToQueue(lambda);
+  QueueTask(lambda);
 }
 
 }
@@ -9,27 +9,40 @@ using critter::Visitor;
 using critter::GameObject;
 
 TextObject::TextObject(engine::Context* ctx, const std::string& font_path)
-  : GameObject(ctx), Text(ctx, font_path), mat(ctx) { }
+  : GameObject(ctx),
+    Text(ctx, font_path),
+    mat(ctx),
+    frame_geometry_(std::make_shared<model::Mesh<storage::VertexPacket2D>>()),
+    frame_color_(GetTextColor()),
+    frame_texture_(0) { }
 
 void TextObject::Accept(critter::Visitor& v) {
-  v.Visit(std::dynamic_pointer_cast<TextObject>(shared_from_this()));
+  v.Visit(std::static_pointer_cast<TextObject>(shared_from_this()));
+}
+
+void TextObject::SyncRenderState() {
+  // the simulation is idle, so the text can't change under us.
+  // rebuilding the geometry is left until now, since it's only read from here on
+  frame_geometry_ = GetGeometry();
+  frame_color_ = GetTextColor();
+  frame_texture_ = GetTexture();
 }
 
 void TextObject::PrepareAttributes() {
-  GetGeometry()->PointToVertexAttribs();
+  frame_geometry_->PointToVertexAttribs();
 }
 
 void TextObject::RenderMaterial(const engine::RenderContext& rc) {
-  mat.SetModelTransforms(GetTransformationMatrix());
+  mat.SetModelTransforms(rc.GetModelMatrix());
   mat.SetCameraTransforms(rc.GetActiveCamera().vp_matrix);
-  mat.SetGlyphTexture(GetTexture());
-  mat.SetTextColor(GetTextColor());
+  mat.SetGlyphTexture(frame_texture_);
+  mat.SetTextColor(frame_color_);
   mat.UseMaterial();
   Draw();
 }
 
 void TextObject::Draw() {
-  glDrawElements(GL_TRIANGLES, static_cast<uint32_t>(GetGeometry()->GetIndexCount()), GL_UNSIGNED_INT, (void*)0);
+  glDrawElements(GL_TRIANGLES, static_cast<uint32_t>(frame_geometry_->GetIndexCount()), GL_UNSIGNED_INT, (void*)0);
 }
 
 }
@@ -13,6 +13,26 @@ glm::dvec2 Cursor::GetCursorPosition() {
   return cursor_cache_;
 }
 
+utils::ray Cursor::GetPickRay(const critter::camera_info& camera) {
+  // cursor positions are in screen coordinates, which may not match the framebuffer's pixels
+  glm::ivec2 win;
+  glfwGetWindowSize(window_, &win.x, &win.y);
+  return GetPickRay(camera, cursor_cache_, win);
+}
+
+utils::ray Cursor::GetPickRay(const critter::camera_info& camera,
+                              const glm::dvec2& position,
+                              const glm::ivec2& window_size) {
+  // back from NDC, on the near and far planes
+  glm::vec2 ndc(2.0 * position.x / window_size.x - 1.0, 1.0 - 2.0 * position.y / window_size.y);
+  glm::mat4 inv_vp = glm::inverse(camera.vp_matrix);
+  glm::vec4 near_point = inv_vp * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+  glm::vec4 far_point = inv_vp * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+  glm::vec3 origin = glm::vec3(near_point) / near_point.w;
+  glm::vec3 end = glm::vec3(far_point) / far_point.w;
+  return { origin, glm::normalize(end - origin) };
+}
+
 void Cursor::UpdateCursorPosition() {
   glm::ivec2 win;
   glfwGetCursorPos(window_, &cursor_cache_.x, &cursor_cache_.y);
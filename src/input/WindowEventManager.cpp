@@ -36,6 +36,7 @@ WindowEventManager::WindowEventManager(GLFWwindow* window, engine::Context* ctx)
   window_ = window;
 
   cursor_ = std::make_shared<Cursor>(window);
+  hover_pos_ = glm::dvec2(-1.0);
 }
 
 std::shared_ptr<Cursor> WindowEventManager::GetCursor() {
@@ -63,6 +64,21 @@ void WindowEventManager::ProcessWaitingEvents() {
     event_queue_.clear();
   }
 
+  // let the UI know where the cursor is, for hover tracking. a locked cursor isn't over anything
+  glm::dvec2 cursor_pos = (cursor_->IsCursorLocked() ? glm::dvec2(-1.0) : cursor_->GetCursorPosition());
+  if (cursor_pos != hover_pos_ && ctx_ != nullptr) {
+    hover_pos_ = cursor_pos;
+    MouseEvent e = {};
+    e.absolute_pos = glm::vec2(cursor_pos);
+    e.local_pos = e.absolute_pos;
+    e.button = e.action = -1;
+    if (auto scene = ctx_->GetScene()) {
+      if (auto window = scene->GetWindow()) {
+        window->HandleHoverEvent(e);
+      }
+    }
+  }
+
   for (auto event : events) {
     if (event.scancode < 0) {
       // mouse event
@@ -24,24 +24,28 @@ namespace {
   // for ensuring geometry need not be reinstanced
   model::Mesh<storage::VertexPacket2D> geom_cache;
   std::mutex geom_lock;
-}
 
-Canvas::Canvas(std::shared_ptr<Framebuffer> framebuffer) {
-  fb_ = framebuffer;
-  // quick lock-free check (it's kinda gross but whatever)
-  if (!shaders_built) {
-    std::unique_lock<std::mutex> lock(build_shaders_mtx);
+  // builds the shaders on first draw -- most redraws never use their canvas
+  void BuildShaders() {
+    // quick lock-free check (it's kinda gross but whatever)
     if (!shaders_built) {
-      fill_mat = std::make_shared<FillMaterial>();
-      filter_mat = std::make_shared<ImageFilterMaterial>();
-    }
+      std::unique_lock<std::mutex> lock(build_shaders_mtx);
+      if (!shaders_built) {
+        fill_mat = std::make_shared<FillMaterial>();
+        filter_mat = std::make_shared<ImageFilterMaterial>();
+      }
 
-    shaders_built = true;
+      shaders_built = true;
+    }
   }
 }
 
+Canvas::Canvas(std::shared_ptr<Framebuffer> framebuffer) {
+  fb_ = framebuffer;
+}
+
 void Canvas::DrawLine(glm::vec2 start, glm::vec2 end, float thickness, glm::vec4 color) {
-  
+  BuildShaders();
   fb_->BindFramebuffer();
   glm::vec2 fb_dims(fb_->GetDimensions());
   start.y = fb_dims.y - start.y;
@@ -84,6 +88,7 @@ void Canvas::DrawLine(glm::vec2 start, glm::vec2 end, float thickness, glm::vec4
 }
 
 void Canvas::DrawImage(std::shared_ptr<const Texture> tex, glm::vec2 origin, glm::vec2 dims) {
+  BuildShaders();
   std::lock_guard<std::mutex> lock(geom_lock);
   SetupImageMesh(tex, origin, dims);
 
@@ -95,6 +100,7 @@ void Canvas::DrawImage(std::shared_ptr<const Texture> tex, glm::vec2 origin, glm
 }
 
 void Canvas::DrawImage(std::shared_ptr<const Texture> tex, glm::vec2 origin, glm::vec2 dims, const FilterSequence& filter) {
+  BuildShaders();
   std::lock_guard<std::mutex> lock(geom_lock);
   SetupImageMesh(tex, origin, dims);
 
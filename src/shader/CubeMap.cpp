@@ -5,6 +5,8 @@
 
 #include <GLFW/glfw3.h>
 
+#include <chrono>
+
 #include <stb_image.h>
 
 namespace monkeysworld {
@@ -20,6 +22,8 @@ CubeMap::CubeMap(std::string x_pos,
   std::string* paths[6] = {&x_pos, &x_neg, &y_pos, &y_neg, &z_pos, &z_neg};
   cubemap_ = 0;
 
+  // cubemap faces aren't flipped -- set per thread, since textures on this thread may be
+  stbi_set_flip_vertically_on_load_thread(false);
   for (int i = 0; i < 6; i++) {
     data[i].data = stbi_load(paths[i]->c_str(), &data[i].width, &data[i].height, &data[i].channels, 0);
     if (!data[i].data) {
@@ -42,6 +46,7 @@ uint64_t CubeMap::GetCubeMapSize() const {
 
 GLuint CubeMap::GetCubeMapDescriptor() const {
   if (cubemap_ == 0) {
+    auto upload_start = std::chrono::steady_clock::now();
     GLuint* cubemap_ref = const_cast<GLuint*>(&cubemap_);
     glGenTextures(1, cubemap_ref);
     glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap_);
@@ -74,6 +79,12 @@ GLuint CubeMap::GetCubeMapDescriptor() const {
       stbi_image_free(data->data);
       data->data = nullptr;
     }
+
+    if (upload_callback_) {
+      auto upload_time = std::chrono::steady_clock::now() - upload_start;
+      upload_callback_(std::chrono::duration_cast<std::chrono::nanoseconds>(upload_time).count());
+      const_cast<std::function<void(uint64_t)>&>(upload_callback_) = nullptr;
+    }
   }
 
   glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
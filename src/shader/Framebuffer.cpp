@@ -9,10 +9,28 @@
 namespace monkeysworld {
 namespace shader {
 
-Framebuffer::Framebuffer() {
+/**
+ *  Clears a framebuffer to transparent black. glClear only touches the draw binding, so `fb` is
+ *  bound for drawing while it's cleared, and whatever was bound there before is put back --
+ *  the caller may have just bound something else to draw into, e.g. before a blit.
+ */
+static void ClearFramebuffer(GLuint fb) {
+  GLint old_draw;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &old_draw);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fb);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(old_draw));
+}
+
+Framebuffer::Framebuffer() : Framebuffer(nullptr) { }
+
+Framebuffer::Framebuffer(std::shared_ptr<FramebufferPool> pool) : pool_(pool) {
   fb_ = color_ = depth_stencil_ = 0;
+  atlased_ = in_region_ = false;
   fb_size_ = glm::ivec2(1);
   fb_size_old_ = glm::ivec2(0);
+  alloc_size_ = origin_ = region_size_ = glm::ivec2(0);
 }
 
 void Framebuffer::SetDimensions(glm::ivec2 size) {
@@ -61,52 +79,128 @@ GLuint Framebuffer::GetFramebuffer() {
   return fb_;
 }
 
+void Framebuffer::SetAtlased(bool atlased) {
+  if (atlased != atlased_) {
+    atlased_ = atlased;
+    // pick new attachments on the next bind
+    fb_size_old_ = glm::ivec2(0);
+  }
+}
+
+glm::ivec2 Framebuffer::GetOrigin() const {
+  return origin_;
+}
+
+void Framebuffer::GetTexcoords(glm::vec2* min, glm::vec2* max) const {
+  if (alloc_size_.x == 0) {
+    *min = glm::vec2(0);
+    *max = glm::vec2(1);
+    return;
+  }
+
+  glm::vec2 alloc(alloc_size_);
+  *min = glm::vec2(origin_) / alloc;
+  *max = glm::vec2(origin_ + fb_size_) / alloc;
+}
+
 void Framebuffer::GenerateFramebuffer(GLenum target) {
-  glDeleteFramebuffers(1, &fb_);
-  glDeleteTextures(1, &color_);
-  glDeleteTextures(1, &depth_stencil_);
-
-  glGenTextures(1, &color_);
-  glGenTextures(1, &depth_stencil_);
-  glBindTexture(GL_TEXTURE_2D, depth_stencil_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8,
-                static_cast<uint32_t>(fb_size_.x), static_cast<uint32_t>(fb_size_.y),
-                0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
-  glBindTexture(GL_TEXTURE_2D, color_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                static_cast<uint32_t>(fb_size_.x), static_cast<uint32_t>(fb_size_.y),
-                0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-
-  glGenFramebuffers(1, &fb_);
-  glBindFramebuffer(target, fb_);
-  glFramebufferTexture2D(target, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_, 0);
-  glFramebufferTexture2D(target, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth_stencil_, 0);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  if (pool_ && atlased_) {
+    if (in_region_ && fb_size_.x <= region_size_.x && fb_size_.y <= region_size_.y) {
+      // still fits
+      fb_size_old_ = fb_size_;
+      return;
+    }
+
+    if (LeaseRegion()) {
+      // clear the padding too, since it's what we blend into at our edges
+      glEnable(GL_SCISSOR_TEST);
+      glScissor(origin_.x - 1, origin_.y - 1, region_size_.x + 2, region_size_.y + 2);
+      ClearFramebuffer(fb_);
+      glDisable(GL_SCISSOR_TEST);
+      glBindFramebuffer(target, fb_);
+      fb_size_old_ = fb_size_;
+      return;
+    }
+  }
+
+  render_target attachments;
+  if (pool_) {
+    glm::ivec2 bucket_size = FramebufferPool::GetBucketSize(fb_size_);
+    if (fb_ != 0 && !in_region_ && alloc_size_ == bucket_size) {
+      // still fits
+      fb_size_old_ = fb_size_;
+      return;
+    }
+
+    ReleaseFramebuffer();
+    attachments = pool_->Lease(fb_size_);
+  } else {
+    ReleaseFramebuffer();
+    attachments = {};
+    attachments.size = fb_size_;
+    RenderTargetAllocatorGL().Allocate(&attachments);
+  }
 
-  if (glCheckFramebufferStatus(target) != GL_FRAMEBUFFER_COMPLETE) {
-    BOOST_LOG_TRIVIAL(error) << "incomplete framebuffer :(";
-    BOOST_LOG_TRIVIAL(error) << GetDimensions().x << ", " << GetDimensions().y;
-  } 
+  fb_ = attachments.fb;
+  color_ = attachments.color;
+  depth_stencil_ = attachments.depth_stencil;
+  alloc_size_ = attachments.size;
 
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // leased attachments hold whatever their last user drew
+  ClearFramebuffer(fb_);
+  glBindFramebuffer(target, fb_);
   fb_size_old_ = fb_size_;
 }
 
-Framebuffer::~Framebuffer() {
-  if (!glfwGetCurrentContext()) {
-    BOOST_LOG_TRIVIAL(error) << "could not delete GL components!";
-  } else if (fb_ != 0) {
-    glDeleteFramebuffers(1, &fb_);
-    glDeleteTextures(1, &color_);
-    glDeleteTextures(1, &depth_stencil_);
+bool Framebuffer::LeaseRegion() {
+  atlas_region region;
+  if (!pool_->LeaseRegion(fb_size_, &region)) {
+    return false;
+  }
+
+  // lease before returning, so a page we're alone on doesn't go back and come straight out again
+  ReleaseFramebuffer();
+  fb_ = region.page.fb;
+  color_ = region.page.color;
+  depth_stencil_ = region.page.depth_stencil;
+  alloc_size_ = region.page.size;
+  origin_ = region.origin;
+  region_size_ = region.size;
+  in_region_ = true;
+  return true;
+}
+
+void Framebuffer::ReleaseFramebuffer() {
+  if (fb_ == 0) {
+    // never drawn to -- nothing to give up
+    return;
+  }
+
+  render_target attachments = { fb_, color_, depth_stencil_, alloc_size_ };
+  if (in_region_) {
+    pool_->ReturnRegion({ attachments, origin_, region_size_ });
+  } else if (pool_) {
+    pool_->Return(attachments);
+  } else {
+    RenderTargetAllocatorGL().Free(attachments);
   }
+
+  fb_ = color_ = depth_stencil_ = 0;
+  in_region_ = false;
+  alloc_size_ = origin_ = region_size_ = glm::ivec2(0);
 }
 
-Framebuffer::Framebuffer(const Framebuffer& other) {
+Framebuffer::~Framebuffer() {
+  ReleaseFramebuffer();
+}
+
+Framebuffer::Framebuffer(const Framebuffer& other) : pool_(other.pool_) {
   fb_ = color_ = depth_stencil_ = 0;
+  atlased_ = other.atlased_;
+  in_region_ = false;
   fb_size_ = other.fb_size_;
   fb_size_old_ = glm::ivec2(0, 0);
+  alloc_size_ = origin_ = region_size_ = glm::ivec2(0);
 }
 
 Framebuffer& Framebuffer::operator=(const Framebuffer& other) {
@@ -114,24 +208,45 @@ Framebuffer& Framebuffer::operator=(const Framebuffer& other) {
   return *this;
 }
 
-Framebuffer::Framebuffer(Framebuffer&& other) {
+Framebuffer::Framebuffer(Framebuffer&& other) : pool_(other.pool_) {
   fb_ = other.fb_;
   color_ = other.color_;
   depth_stencil_ = other.depth_stencil_;
   other.fb_ = other.color_ = other.depth_stencil_ = 0;
+  atlased_ = other.atlased_;
+  in_region_ = other.in_region_;
+  other.in_region_ = false;
   fb_size_ = other.fb_size_;
   fb_size_old_ = other.fb_size_old_;
+  alloc_size_ = other.alloc_size_;
+  origin_ = other.origin_;
+  region_size_ = other.region_size_;
+  other.alloc_size_ = other.origin_ = other.region_size_ = glm::ivec2(0);
 }
 
 Framebuffer& Framebuffer::operator=(Framebuffer&& other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  // attachments go back to whoever they came from
+  ReleaseFramebuffer();
+  pool_ = other.pool_;
   fb_ = other.fb_;
   color_ = other.color_;
   depth_stencil_ = other.depth_stencil_;
   other.fb_ = other.color_ = other.depth_stencil_ = 0;
+  atlased_ = other.atlased_;
+  in_region_ = other.in_region_;
+  other.in_region_ = false;
   fb_size_ = other.fb_size_;
   fb_size_old_ = other.fb_size_old_;
+  alloc_size_ = other.alloc_size_;
+  origin_ = other.origin_;
+  region_size_ = other.region_size_;
+  other.alloc_size_ = other.origin_ = other.region_size_ = glm::ivec2(0);
   return *this;
 }
 
 }
-}
\ No newline at end of file
+}
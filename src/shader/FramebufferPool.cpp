@@ -0,0 +1,218 @@
+#include <shader/FramebufferPool.hpp>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+
+namespace monkeysworld {
+namespace shader {
+
+// smallest step sizes are rounded to -- keeps tiny targets from landing in dozens of buckets
+static const int MIN_BUCKET_STEP = 8;
+
+const uint64_t FramebufferPool::DEFAULT_BUDGET;
+const int FramebufferPool::ATLAS_PAGE_SIZE;
+const int FramebufferPool::MAX_ATLAS_REGION;
+
+void RenderTargetAllocatorGL::Allocate(render_target* target) {
+  glGenTextures(1, &target->color);
+  glGenTextures(1, &target->depth_stencil);
+  glBindTexture(GL_TEXTURE_2D, target->depth_stencil);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8,
+                static_cast<uint32_t>(target->size.x), static_cast<uint32_t>(target->size.y),
+                0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+  glBindTexture(GL_TEXTURE_2D, target->color);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+                static_cast<uint32_t>(target->size.x), static_cast<uint32_t>(target->size.y),
+                0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  glGenFramebuffers(1, &target->fb);
+  glBindFramebuffer(GL_FRAMEBUFFER, target->fb);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->color, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, target->depth_stencil, 0);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    BOOST_LOG_TRIVIAL(error) << "incomplete framebuffer :(";
+    BOOST_LOG_TRIVIAL(error) << target->size.x << ", " << target->size.y;
+  }
+}
+
+void RenderTargetAllocatorGL::Free(const render_target& target) {
+  if (!glfwGetCurrentContext()) {
+    BOOST_LOG_TRIVIAL(error) << "could not delete GL components!";
+    return;
+  }
+
+  glDeleteFramebuffers(1, &target.fb);
+  glDeleteTextures(1, &target.color);
+  glDeleteTextures(1, &target.depth_stencil);
+}
+
+FramebufferPool::FramebufferPool(uint64_t budget)
+  : FramebufferPool(std::make_unique<RenderTargetAllocatorGL>(), budget) { }
+
+FramebufferPool::FramebufferPool(std::unique_ptr<RenderTargetAllocator> allocator, uint64_t budget)
+  : allocator_(std::move(allocator)), budget_(budget), stats_({}) { }
+
+render_target FramebufferPool::Lease(glm::ivec2 size) {
+  glm::ivec2 bucket_size = GetBucketSize(size);
+  stats_.leases++;
+
+  auto bucket = buckets_.find(GetBucketKey(bucket_size));
+  if (bucket != buckets_.end() && !bucket->second.empty()) {
+    // most recently returned, so least likely to be evicted next
+    idle_itr itr = bucket->second.back();
+    bucket->second.pop_back();
+    render_target target = *itr;
+    idle_.erase(itr);
+    stats_.idle_bytes -= GetTargetBytes(target.size);
+    stats_.reuses++;
+    return target;
+  }
+
+  render_target target = {};
+  target.size = bucket_size;
+  allocator_->Allocate(&target);
+  stats_.allocations++;
+  stats_.targets++;
+  stats_.bytes += GetTargetBytes(bucket_size);
+
+  // the new target may have pushed us over
+  EvictToBudget();
+  return target;
+}
+
+void FramebufferPool::Return(const render_target& target) {
+  idle_.push_front(target);
+  buckets_[GetBucketKey(target.size)].push_back(idle_.begin());
+  stats_.idle_bytes += GetTargetBytes(target.size);
+  EvictToBudget();
+}
+
+bool FramebufferPool::LeaseRegion(glm::ivec2 size, atlas_region* region) {
+  if (size.x <= 0 || size.y <= 0 || size.x > MAX_ATLAS_REGION || size.y > MAX_ATLAS_REGION) {
+    return false;
+  }
+
+  // a pixel of space on each side
+  glm::ivec2 padded = size + glm::ivec2(2);
+  glm::ivec2 corner;
+  atlas_page* page = nullptr;
+  for (auto& candidate : pages_) {
+    if (candidate.packer.Insert(padded, &corner)) {
+      page = &candidate;
+      break;
+    }
+  }
+
+  if (page == nullptr) {
+    glm::ivec2 page_size(ATLAS_PAGE_SIZE);
+    pages_.push_back({ Lease(page_size), utils::SkylinePacker(page_size), 0 });
+    page = &pages_.back();
+    page->packer.Insert(padded, &corner);
+    stats_.atlas_pages++;
+  }
+
+  page->regions++;
+  stats_.atlas_regions++;
+  region->page = page->target;
+  region->origin = corner + glm::ivec2(1);
+  region->size = size;
+  return true;
+}
+
+void FramebufferPool::ReturnRegion(const atlas_region& region) {
+  auto page = std::find_if(pages_.begin(), pages_.end(), [&](const atlas_page& p) {
+    return p.target.fb == region.page.fb;
+  });
+
+  if (page == pages_.end()) {
+    BOOST_LOG_TRIVIAL(error) << "returned region does not belong to this pool";
+    return;
+  }
+
+  stats_.atlas_regions--;
+  if (--page->regions == 0) {
+    // nothing left on it -- let the page go like any other target
+    Return(page->target);
+    pages_.erase(page);
+    stats_.atlas_pages--;
+  }
+}
+
+void FramebufferPool::SetBudget(uint64_t budget) {
+  budget_ = budget;
+  EvictToBudget();
+}
+
+uint64_t FramebufferPool::GetBudget() const {
+  return budget_;
+}
+
+void FramebufferPool::Trim() {
+  while (!idle_.empty()) {
+    Evict(std::prev(idle_.end()));
+  }
+}
+
+const framebuffer_pool_stats& FramebufferPool::GetStats() const {
+  return stats_;
+}
+
+glm::ivec2 FramebufferPool::GetBucketSize(glm::ivec2 size) {
+  glm::ivec2 res;
+  for (int i = 0; i < 2; i++) {
+    int dim = std::max(size[i], 1);
+    int pow = 1;
+    while (pow < dim) {
+      pow <<= 1;
+    }
+
+    int step = std::max(pow / 8, MIN_BUCKET_STEP);
+    res[i] = ((dim + step - 1) / step) * step;
+  }
+
+  return res;
+}
+
+uint64_t FramebufferPool::GetTargetBytes(glm::ivec2 size) {
+  // RGBA8 color, plus 24-bit depth and 8-bit stencil
+  return static_cast<uint64_t>(size.x) * static_cast<uint64_t>(size.y) * 8;
+}
+
+uint64_t FramebufferPool::GetBucketKey(glm::ivec2 size) {
+  return (static_cast<uint64_t>(size.x) << 32) | static_cast<uint32_t>(size.y);
+}
+
+void FramebufferPool::EvictToBudget() {
+  while (stats_.bytes > budget_ && !idle_.empty()) {
+    Evict(std::prev(idle_.end()));
+  }
+}
+
+void FramebufferPool::Evict(idle_itr target) {
+  auto& bucket = buckets_[GetBucketKey(target->size)];
+  bucket.erase(std::find(bucket.begin(), bucket.end(), target));
+  if (bucket.empty()) {
+    buckets_.erase(GetBucketKey(target->size));
+  }
+
+  uint64_t bytes = GetTargetBytes(target->size);
+  stats_.bytes -= bytes;
+  stats_.idle_bytes -= bytes;
+  stats_.targets--;
+  stats_.evictions++;
+  allocator_->Free(*target);
+  idle_.erase(target);
+}
+
+FramebufferPool::~FramebufferPool() {
+  Trim();
+}
+
+}
+}
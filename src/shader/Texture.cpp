@@ -8,6 +8,8 @@
 
 #include <GLFW/glfw3.h>
 
+#include <chrono>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -15,8 +17,8 @@ namespace monkeysworld {
 namespace shader {
 
 Texture::Texture(const std::string& path) {
-  // use stb image to load texture
-  stbi_set_flip_vertically_on_load(true);
+  // use stb image to load texture. textures load on the pool, so the flip is set per thread
+  stbi_set_flip_vertically_on_load_thread(true);
   tex_cache_ = stbi_load(path.c_str(), &width_, &height_, &channels_, 0);
   if (!tex_cache_) {
     BOOST_LOG_TRIVIAL(warning) << "could not load texture!";
@@ -31,6 +33,14 @@ Texture::Texture(int width, int height, int channels) : width_(width),
                                                         tex_(0),
                                                         tex_cache_(nullptr) {}
 
+Texture::Texture(std::shared_ptr<const unsigned char> pixels, int width, int height, int channels)
+  : tex_cache_(nullptr),
+    pixel_source_(std::move(pixels)),
+    tex_(0),
+    width_(width),
+    height_(height),
+    channels_(channels) {}
+
 Texture::Texture(engine::Context* ctx, std::shared_ptr<Framebuffer> fb) {
   auto dims = fb->GetDimensions();
   width_ = dims.x;
@@ -44,7 +54,9 @@ Texture::Texture(engine::Context* ctx, std::shared_ptr<Framebuffer> fb) {
     glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
     // fb->BindFramebuffer(FramebufferTarget::READ);
     // glReadBuffer(GL_COLOR_ATTACHMENT0);
-    glCopyImageSubData(fb->GetColorAttachment(), GL_TEXTURE_2D, 0, 0, 0, 0, tex_, GL_TEXTURE_2D, 0, 0, 0, 0, width, height, 1);
+    // the framebuffer may only cover part of its attachment
+    glm::ivec2 origin = fb->GetOrigin();
+    glCopyImageSubData(fb->GetColorAttachment(), GL_TEXTURE_2D, 0, origin.x, origin.y, 0, tex_, GL_TEXTURE_2D, 0, 0, 0, 0, width, height, 1);
     tex_cache_ = nullptr;
   };
 
@@ -55,18 +67,20 @@ Texture::Texture(engine::Context* ctx, std::shared_ptr<Framebuffer> fb) {
 // find some way to pass the data type in on load
 GLuint Texture::GetTextureDescriptor() const {
   if (tex_ == 0) {
+    auto upload_start = std::chrono::steady_clock::now();
     GLuint* tex = const_cast<GLuint*>(&tex_);
     glGenTextures(1, tex);
     glBindTexture(GL_TEXTURE_2D, tex_);
+    const unsigned char* pixels = (tex_cache_ ? tex_cache_ : pixel_source_.get());
     switch (channels_) {
       case 1:
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width_, height_, 0, GL_RED, GL_UNSIGNED_BYTE, tex_cache_);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width_, height_, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
         break;
       case 3:
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width_, height_, 0, GL_RGB, GL_UNSIGNED_BYTE, tex_cache_);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width_, height_, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
         break;
       case 4:
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex_cache_);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
         break;
       default:
         BOOST_LOG_TRIVIAL(error) << "not sure how to load this one tbh";
@@ -81,10 +95,18 @@ GLuint Texture::GetTextureDescriptor() const {
       stbi_image_free(tex_cache_);
       const_cast<unsigned char*>(tex_cache_) = nullptr;
     }
+
+    const_cast<std::shared_ptr<const unsigned char>&>(pixel_source_).reset();
     
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (upload_callback_) {
+      auto upload_time = std::chrono::steady_clock::now() - upload_start;
+      upload_callback_(std::chrono::duration_cast<std::chrono::nanoseconds>(upload_time).count());
+      const_cast<std::function<void(uint64_t)>&>(upload_callback_) = nullptr;
+    }
   }
 
   return tex_;
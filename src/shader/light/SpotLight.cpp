@@ -16,6 +16,7 @@ using materials::ShadowMapMaterial;
 
 SpotLight::SpotLight(Context* ctx) : GameObject(ctx), Light(), mat_(ctx) {
   angle_ = 45.0f; // simple default
+  SetLocalBounds(utils::EmptyBounds());
   // setup the framebuffer
   glGenTextures(1, &map_);
 
@@ -34,7 +35,7 @@ SpotLight::SpotLight(Context* ctx) : GameObject(ctx), Light(), mat_(ctx) {
 }
 
 void SpotLight::Accept(Visitor& v) {
-  v.Visit(std::dynamic_pointer_cast<SpotLight>(this->shared_from_this()));
+  v.Visit(std::static_pointer_cast<SpotLight>(this->shared_from_this()));
 }
 
 void SpotLight::SetAngle(float deg) {
@@ -46,12 +46,15 @@ void MatteMaterial::SetCameraTransforms(const glm::mat4& vp_matrix) {
 }
 
 void MatteMaterial::SetModelTransforms(const glm::mat4& model_matrix) {
+  SetModelTransforms(model_matrix, glm::inverseTranspose(glm::mat3(model_matrix)));
+}
+
+void MatteMaterial::SetModelTransforms(const glm::mat4& model_matrix, const glm::mat3& normal_matrix) {
   glProgramUniformMatrix4fv(matte_prog_.GetProgramDescriptor(),
                             0,
                             1,
                             GL_FALSE,
                             glm::value_ptr(model_matrix));
-  glm::mat3 normal_matrix = glm::inverseTranspose(glm::mat3(model_matrix));
   glProgramUniformMatrix3fv(matte_prog_.GetProgramDescriptor(),
                             2,
                             1,
@@ -2,11 +2,14 @@
 
 #include <shader/ShaderProgramBuilder.hpp>
 
+#include <algorithm>
 
 namespace monkeysworld {
 namespace shader {
 namespace materials {
 
+const int UIGroupMaterial::MAX_TEXTURES;
+
 UIGroupMaterial::UIGroupMaterial(engine::Context* ctx) {
   auto loader = ctx->GetCachedFileLoader();
   auto exec_func = [&] {
@@ -19,43 +22,41 @@ UIGroupMaterial::UIGroupMaterial(engine::Context* ctx) {
   auto f = ctx->GetExecutor()->ScheduleOnMainThread(exec_func);
   f.wait();
 
-  for (int i = 0; i < TEXTURES_PER_CALL; i++) {
-    opacities_[i] = 1.0f;
-  }
+  texture_count_ = 0;
+  max_textures_ = -1;
 }
 
-void UIGroupMaterial::SetTextures(GLuint textures[TEXTURES_PER_CALL]) {
-  for (int i = 0; i < TEXTURES_PER_CALL; i++) {
-    textures_[i] = textures[i];
+int UIGroupMaterial::GetMaxTextures() {
+  if (max_textures_ < 0) {
+    // the fragment shader does the sampling, so its limit is the one which counts
+    GLint units;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &units);
+    max_textures_ = std::min(static_cast<int>(units), MAX_TEXTURES);
   }
+
+  return max_textures_;
 }
 
-void UIGroupMaterial::SetOpacity(float opacities[TEXTURES_PER_CALL]) {
-  for (int i = 0; i < TEXTURES_PER_CALL; i++) {
-    if (opacities[i] < 0.0f) {
-      opacities_[i] = 0.0f;
-    } else if (opacities[i] > 1.0f) {
-      opacities_[i] = 1.0f;
-    } else {
-      opacities_[i] = opacities[i];
-    }
+void UIGroupMaterial::SetTextures(const GLuint* textures, int count) {
+  texture_count_ = std::min(count, GetMaxTextures());
+  for (int i = 0; i < texture_count_; i++) {
+    textures_[i] = textures[i];
   }
 }
 
 void UIGroupMaterial::UseMaterial() {
   glUseProgram(prog_.GetProgramDescriptor());
-  
-  // prepare textures
-  for (int i = 0; i < TEXTURES_PER_CALL; i++) {
-    // todo: deal with this
+
+  GLint units[MAX_TEXTURES];
+  for (int i = 0; i < texture_count_; i++) {
     glActiveTexture(GL_TEXTURE0 + i);
     glBindTexture(GL_TEXTURE_2D, textures_[i]);
-    glUniform1i(i, i);
+    units[i] = i;
   }
 
-  glUniform1fv(4, 4, opacities_);
+  glUniform1iv(0, texture_count_, units);
 }
 
 }
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,380 @@
+#include <utils/BoundingVolumeTree.hpp>
+
+#include <algorithm>
+
+namespace monkeysworld {
+namespace utils {
+
+const int BoundingVolumeTree::NULL_NODE;
+
+// batches moving more than this share of the proxies rebuild the tree instead
+static const size_t REBUILD_FRACTION = 4;
+// the tree's cost is checked after this share of the proxies has moved
+static const size_t CHECK_FRACTION = 8;
+// how much worse than the last rebuild the tree may get before it is rebuilt again
+static const float REBUILD_COST_RATIO = 1.5f;
+// below this many proxies, rebuilds aren't worth checking for
+static const size_t MIN_REBUILD_COUNT = 64;
+
+BoundingVolumeTree::BoundingVolumeTree(float margin)
+  : root_(NULL_NODE), free_list_(NULL_NODE), proxy_count_(0), margin_(margin), built_cost_(0.0f), edits_(0) { }
+
+int BoundingVolumeTree::CreateProxy(const aabb& box, uint32_t data) {
+  int leaf = AllocateLeaf(box, data);
+  InsertLeaf(leaf);
+  return leaf;
+}
+
+void BoundingVolumeTree::CreateProxies(const aabb* boxes, const uint32_t* data, size_t count, int* proxies) {
+  if (!IsLarge(count)) {
+    for (size_t i = 0; i < count; i++) {
+      proxies[i] = CreateProxy(boxes[i], data[i]);
+    }
+
+    return;
+  }
+
+  // the rebuild places them
+  for (size_t i = 0; i < count; i++) {
+    proxies[i] = AllocateLeaf(boxes[i], data[i]);
+  }
+
+  Rebuild();
+}
+
+void BoundingVolumeTree::DestroyProxy(int proxy) {
+  RemoveLeaf(proxy);
+  FreeNode(proxy);
+  proxy_count_--;
+}
+
+void BoundingVolumeTree::MoveProxy(int proxy, const aabb& box) {
+  boxes_[proxy] = box;
+  node& leaf = nodes_[proxy];
+  if (Contains(leaf.box, box)) {
+    return;
+  }
+
+  if (Overlaps(leaf.box, box)) {
+    leaf.box = Fatten(box);
+    Refit(leaf.parent);
+  } else {
+    RemoveLeaf(proxy);
+    nodes_[proxy].box = Fatten(box);
+    InsertLeaf(proxy);
+  }
+
+  NoteEdits(1);
+}
+
+void BoundingVolumeTree::MoveProxies(const proxy_move* moves, size_t count) {
+  if (!IsLarge(count)) {
+    for (size_t i = 0; i < count; i++) {
+      MoveProxy(moves[i].proxy, moves[i].box);
+    }
+
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    boxes_[moves[i].proxy] = moves[i].box;
+    nodes_[moves[i].proxy].box = Fatten(moves[i].box);
+  }
+
+  Rebuild();
+}
+
+void BoundingVolumeTree::Rebuild() {
+  // keep the leaves, and throw away everything above them
+  leaves_.clear();
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    if (nodes_[i].height == 0) {
+      leaves_.push_back(static_cast<int>(i));
+    } else if (nodes_[i].height > 0) {
+      FreeNode(static_cast<int>(i));
+    }
+  }
+
+  root_ = (leaves_.empty() ? NULL_NODE : Build(leaves_.data(), leaves_.size(), NULL_NODE));
+  built_cost_ = GetCost();
+  edits_ = 0;
+}
+
+uint32_t BoundingVolumeTree::GetData(int proxy) const {
+  return nodes_[proxy].data;
+}
+
+const aabb& BoundingVolumeTree::GetBounds(int proxy) const {
+  return boxes_[proxy];
+}
+
+size_t BoundingVolumeTree::GetProxyCount() const {
+  return proxy_count_;
+}
+
+int BoundingVolumeTree::GetHeight() const {
+  return (root_ == NULL_NODE ? -1 : nodes_[root_].height);
+}
+
+float BoundingVolumeTree::GetCost() const {
+  if (root_ == NULL_NODE) {
+    return 0.0f;
+  }
+
+  float root_area = SurfaceArea(nodes_[root_].box);
+  if (root_area <= 0.0f) {
+    return 0.0f;
+  }
+
+  float total = 0.0f;
+  for (auto& n : nodes_) {
+    if (n.height > 0) {
+      total += SurfaceArea(n.box);
+    }
+  }
+
+  return total / root_area;
+}
+
+int BoundingVolumeTree::AllocateNode() {
+  if (free_list_ == NULL_NODE) {
+    nodes_.emplace_back();
+    boxes_.emplace_back();
+    nodes_.back().height = -1;
+    return static_cast<int>(nodes_.size() - 1);
+  }
+
+  int res = free_list_;
+  free_list_ = nodes_[res].parent;
+  return res;
+}
+
+void BoundingVolumeTree::FreeNode(int n) {
+  nodes_[n].parent = free_list_;
+  nodes_[n].height = -1;
+  free_list_ = n;
+}
+
+int BoundingVolumeTree::AllocateLeaf(const aabb& box, uint32_t data) {
+  int res = AllocateNode();
+  node& leaf = nodes_[res];
+  leaf.box = Fatten(box);
+  leaf.parent = NULL_NODE;
+  leaf.child1 = NULL_NODE;
+  leaf.child2 = NULL_NODE;
+  leaf.height = 0;
+  leaf.data = data;
+  boxes_[res] = box;
+  proxy_count_++;
+  return res;
+}
+
+aabb BoundingVolumeTree::Fatten(const aabb& box) const {
+  return { box.min - glm::vec3(margin_), box.max + glm::vec3(margin_) };
+}
+
+void BoundingVolumeTree::InsertLeaf(int leaf) {
+  if (root_ == NULL_NODE) {
+    root_ = leaf;
+    nodes_[leaf].parent = NULL_NODE;
+    return;
+  }
+
+  // walk down, towards whichever child would grow the least by taking the leaf,
+  // and stop once making a new sibling here is cheaper than going further (Catto)
+  aabb box = nodes_[leaf].box;
+  int index = root_;
+  while (nodes_[index].child1 != NULL_NODE) {
+    const node& n = nodes_[index];
+    float area = SurfaceArea(n.box);
+    float combined_area = SurfaceArea(Merge(n.box, box));
+    float cost = 2.0f * combined_area;
+    // every node beneath here grows along with this one
+    float inherited_cost = 2.0f * (combined_area - area);
+    float child_cost[2];
+    int children[2] = { n.child1, n.child2 };
+    for (int c = 0; c < 2; c++) {
+      const node& child = nodes_[children[c]];
+      float merged = SurfaceArea(Merge(child.box, box));
+      child_cost[c] = (child.child1 == NULL_NODE ? merged : merged - SurfaceArea(child.box)) + inherited_cost;
+    }
+
+    if (cost < child_cost[0] && cost < child_cost[1]) {
+      break;
+    }
+
+    index = (child_cost[0] < child_cost[1] ? children[0] : children[1]);
+  }
+
+  int sibling = index;
+  int old_parent = nodes_[sibling].parent;
+  int new_parent = AllocateNode();
+  node& p = nodes_[new_parent];
+  p.parent = old_parent;
+  p.box = Merge(box, nodes_[sibling].box);
+  p.height = nodes_[sibling].height + 1;
+  p.child1 = sibling;
+  p.child2 = leaf;
+  p.data = 0;
+  nodes_[sibling].parent = new_parent;
+  nodes_[leaf].parent = new_parent;
+  if (old_parent == NULL_NODE) {
+    root_ = new_parent;
+  } else if (nodes_[old_parent].child1 == sibling) {
+    nodes_[old_parent].child1 = new_parent;
+  } else {
+    nodes_[old_parent].child2 = new_parent;
+  }
+
+  for (index = new_parent; index != NULL_NODE; index = nodes_[index].parent) {
+    index = Balance(index);
+    node& n = nodes_[index];
+    n.height = 1 + std::max(nodes_[n.child1].height, nodes_[n.child2].height);
+    n.box = Merge(nodes_[n.child1].box, nodes_[n.child2].box);
+  }
+}
+
+void BoundingVolumeTree::RemoveLeaf(int leaf) {
+  if (leaf == root_) {
+    root_ = NULL_NODE;
+    return;
+  }
+
+  int parent = nodes_[leaf].parent;
+  int grandparent = nodes_[parent].parent;
+  int sibling = (nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1);
+  FreeNode(parent);
+  nodes_[leaf].parent = NULL_NODE;
+  nodes_[sibling].parent = grandparent;
+  if (grandparent == NULL_NODE) {
+    root_ = sibling;
+    return;
+  }
+
+  if (nodes_[grandparent].child1 == parent) {
+    nodes_[grandparent].child1 = sibling;
+  } else {
+    nodes_[grandparent].child2 = sibling;
+  }
+
+  for (int index = grandparent; index != NULL_NODE; index = nodes_[index].parent) {
+    index = Balance(index);
+    node& n = nodes_[index];
+    n.height = 1 + std::max(nodes_[n.child1].height, nodes_[n.child2].height);
+    n.box = Merge(nodes_[n.child1].box, nodes_[n.child2].box);
+  }
+}
+
+int BoundingVolumeTree::Balance(int a) {
+  node& A = nodes_[a];
+  if (A.child1 == NULL_NODE || A.height < 2) {
+    return a;
+  }
+
+  int b = A.child1, c = A.child2;
+  int balance = nodes_[c].height - nodes_[b].height;
+  if (balance >= -1 && balance <= 1) {
+    return a;
+  }
+
+  // `up` is the taller child, which takes A's place. A keeps the shorter child, plus the shorter
+  // of up's children, and up keeps its taller child
+  int up = (balance > 1 ? c : b);
+  int stay = (balance > 1 ? b : c);
+  node& U = nodes_[up];
+  int f = U.child1, g = U.child2;
+  int tall = (nodes_[f].height > nodes_[g].height ? f : g);
+  int moved = (tall == f ? g : f);
+
+  U.parent = A.parent;
+  if (U.parent == NULL_NODE) {
+    root_ = up;
+  } else if (nodes_[U.parent].child1 == a) {
+    nodes_[U.parent].child1 = up;
+  } else {
+    nodes_[U.parent].child2 = up;
+  }
+
+  U.child1 = a;
+  U.child2 = tall;
+  A.parent = up;
+  A.child1 = stay;
+  A.child2 = moved;
+  nodes_[moved].parent = a;
+
+  A.box = Merge(nodes_[stay].box, nodes_[moved].box);
+  A.height = 1 + std::max(nodes_[stay].height, nodes_[moved].height);
+  U.box = Merge(A.box, nodes_[tall].box);
+  U.height = 1 + std::max(A.height, nodes_[tall].height);
+  return up;
+}
+
+void BoundingVolumeTree::Refit(int n) {
+  for (; n != NULL_NODE; n = nodes_[n].parent) {
+    node& parent = nodes_[n];
+    aabb box = Merge(nodes_[parent.child1].box, nodes_[parent.child2].box);
+    if (box.min == parent.box.min && box.max == parent.box.max) {
+      // nothing further up can change either
+      return;
+    }
+
+    parent.box = box;
+  }
+}
+
+int BoundingVolumeTree::Build(int* leaves, size_t count, int parent) {
+  if (count == 1) {
+    nodes_[leaves[0]].parent = parent;
+    return leaves[0];
+  }
+
+  // split at the median along the axis the leaves' centers are most spread out on
+  aabb centers = EmptyBounds();
+  for (size_t i = 0; i < count; i++) {
+    const aabb& box = nodes_[leaves[i]].box;
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    centers = Merge(centers, { center, center });
+  }
+
+  glm::vec3 spread = centers.max - centers.min;
+  int axis = (spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2));
+  size_t mid = count / 2;
+  std::nth_element(leaves, leaves + mid, leaves + count, [this, axis](int a, int b) {
+    return (nodes_[a].box.min[axis] + nodes_[a].box.max[axis] < nodes_[b].box.min[axis] + nodes_[b].box.max[axis]);
+  });
+
+  int res = AllocateNode();
+  int child1 = Build(leaves, mid, res);
+  int child2 = Build(leaves + mid, count - mid, res);
+  node& n = nodes_[res];
+  n.parent = parent;
+  n.child1 = child1;
+  n.child2 = child2;
+  n.height = 1 + std::max(nodes_[child1].height, nodes_[child2].height);
+  n.box = Merge(nodes_[child1].box, nodes_[child2].box);
+  n.data = 0;
+  return res;
+}
+
+void BoundingVolumeTree::NoteEdits(size_t count) {
+  edits_ += count;
+  if (proxy_count_ < MIN_REBUILD_COUNT || edits_ * CHECK_FRACTION < proxy_count_) {
+    return;
+  }
+
+  edits_ = 0;
+  float cost = GetCost();
+  if (built_cost_ <= 0.0f) {
+    // never rebuilt -- measure against the tree as insertion left it
+    built_cost_ = cost;
+  } else if (cost > built_cost_ * REBUILD_COST_RATIO) {
+    Rebuild();
+  }
+}
+
+bool BoundingVolumeTree::IsLarge(size_t count) const {
+  return (count >= MIN_REBUILD_COUNT && count * REBUILD_FRACTION > proxy_count_);
+}
+
+}
+}
@@ -0,0 +1,247 @@
+#include <utils/CRC32.hpp>
+
+#include <array>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CRC32_X86
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// gcc/clang need to be told that the clmul kernel may use pclmul, msvc doesn't care
+#if defined(CRC32_X86) && !defined(_MSC_VER)
+#define CRC32_TARGET_CLMUL __attribute__((target("pclmul,sse2")))
+#else
+#define CRC32_TARGET_CLMUL
+#endif
+
+namespace monkeysworld {
+namespace utils {
+
+static const uint32_t CRC_POLY = 0x04C11DB7;
+
+// below this, setting up the clmul kernel costs more than it saves
+static const size_t CLMUL_MIN_SIZE = 256;
+
+using crc_tables = std::array<std::array<uint32_t, 256>, 8>;
+
+/**
+ *  Builds the slice-by-8 tables.
+ *  tables[0] is the classic byte-at-a-time table. tables[k] advances a byte through k more zero bytes.
+ */
+static constexpr crc_tables BuildTables() {
+  crc_tables tables = {};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int j = 0; j < 8; j++) {
+      crc = (crc & 1) ? ((crc >> 1) ^ CRC_POLY) : (crc >> 1);
+    }
+
+    tables[0][i] = crc;
+  }
+
+  for (int k = 1; k < 8; k++) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t prev = tables[k - 1][i];
+      tables[k][i] = (prev >> 8) ^ tables[0][prev & 0xFF];
+    }
+  }
+
+  return tables;
+}
+
+static constexpr crc_tables CRC_TABLES = BuildTables();
+
+static inline uint32_t Load32(const unsigned char* p) {
+  // compiles down to a single load on little endian targets
+  return static_cast<uint32_t>(p[0])
+       | (static_cast<uint32_t>(p[1]) << 8)
+       | (static_cast<uint32_t>(p[2]) << 16)
+       | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+CRC32::CRC32() : state_(0xFFFFFFFF) { }
+
+void CRC32::Reset() {
+  state_ = 0xFFFFFFFF;
+}
+
+void CRC32::Update(const void* data, size_t size) {
+  if (size >= CLMUL_MIN_SIZE && HasCLMUL()) {
+    state_ = UpdateCLMUL(state_, data, size);
+  } else {
+    state_ = UpdateSliceBy8(state_, data, size);
+  }
+}
+
+uint32_t CRC32::Calculate(const void* data, size_t size) {
+  CRC32 crc;
+  crc.Update(data, size);
+  return crc.GetHash();
+}
+
+uint32_t CRC32::UpdateSliceBy8(uint32_t state, const void* data, size_t size) {
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  const auto& t = CRC_TABLES;
+  while (size >= 8) {
+    uint32_t lo = Load32(p) ^ state;
+    uint32_t hi = Load32(p + 4);
+    state = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+          ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    p += 8;
+    size -= 8;
+  }
+
+  while (size-- > 0) {
+    state = (state >> 8) ^ t[0][(*p++ ^ state) & 0xFF];
+  }
+
+  return state;
+}
+
+#ifdef CRC32_X86
+
+/**
+ *  Folding constants.
+ *
+ *  Our table shifts right, so the register is bit-reflected: bit i holds the coefficient of x^(31 - i),
+ *  and the generator is x^32 + reverse(CRC_POLY). A 16 byte block loaded into an xmm register holds
+ *  h (low qword) * x^64 + l (high qword), again reflected. Moving that block F bits further down the
+ *  message multiplies it by x^F, which we can do modulo the generator:
+ *
+ *    h * x^(F + 64) + l * x^F  ==  clmul(h, x^(F + 63) mod G) ^ clmul(l, x^(F - 1) mod G)
+ *
+ *  (the product of two reflected 64 bit values comes out one place short in a 128 bit register,
+ *  hence the - 1s.) The result is < 96 bits, so it can be xored straight into the block F bits on.
+ */
+struct clmul_constants {
+  uint64_t fold_512_hi;
+  uint64_t fold_512_lo;
+  uint64_t fold_128_hi;
+  uint64_t fold_128_lo;
+};
+
+static uint64_t Reverse64(uint64_t value) {
+  uint64_t res = 0;
+  for (int i = 0; i < 64; i++) {
+    res = (res << 1) | ((value >> i) & 1);
+  }
+
+  return res;
+}
+
+/**
+ *  @returns x^n mod G, reflected into the high half of a qword.
+ */
+static uint64_t XPowModG(int n) {
+  // generator in normal (unreflected) form, minus the x^32 term
+  uint32_t gen = static_cast<uint32_t>(Reverse64(CRC_POLY) >> 32);
+  uint32_t rem = 1;
+  for (int i = 0; i < n; i++) {
+    bool carry = (rem & 0x80000000) != 0;
+    rem <<= 1;
+    if (carry) {
+      rem ^= gen;
+    }
+  }
+
+  return Reverse64(rem);
+}
+
+static const clmul_constants& GetCLMULConstants() {
+  static const clmul_constants constants = {
+    XPowModG(512 + 63),
+    XPowModG(512 - 1),
+    XPowModG(128 + 63),
+    XPowModG(128 - 1)
+  };
+
+  return constants;
+}
+
+CRC32_TARGET_CLMUL
+static inline __m128i Fold(__m128i block, __m128i k) {
+  return _mm_xor_si128(_mm_clmulepi64_si128(block, k, 0x00), _mm_clmulepi64_si128(block, k, 0x11));
+}
+
+CRC32_TARGET_CLMUL
+uint32_t CRC32::UpdateCLMUL(uint32_t state, const void* data, size_t size) {
+  if (size < 64) {
+    return UpdateSliceBy8(state, data, size);
+  }
+
+  const clmul_constants& c = GetCLMULConstants();
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+
+  // four independent lanes hide the multiply latency.
+  // the running state is xored into the first four bytes, which is equivalent to starting from it.
+  __m128i x0 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+                             _mm_cvtsi32_si128(static_cast<int>(state)));
+  __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+  __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32));
+  __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48));
+  p += 64;
+  size -= 64;
+
+  __m128i k = _mm_set_epi64x(static_cast<int64_t>(c.fold_512_lo), static_cast<int64_t>(c.fold_512_hi));
+  while (size >= 64) {
+    x0 = _mm_xor_si128(Fold(x0, k), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    x1 = _mm_xor_si128(Fold(x1, k), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)));
+    x2 = _mm_xor_si128(Fold(x2, k), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32)));
+    x3 = _mm_xor_si128(Fold(x3, k), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48)));
+    p += 64;
+    size -= 64;
+  }
+
+  // collapse the lanes into one, then pick up any remaining whole blocks
+  k = _mm_set_epi64x(static_cast<int64_t>(c.fold_128_lo), static_cast<int64_t>(c.fold_128_hi));
+  __m128i x = _mm_xor_si128(Fold(x0, k), x1);
+  x = _mm_xor_si128(Fold(x, k), x2);
+  x = _mm_xor_si128(Fold(x, k), x3);
+  while (size >= 16) {
+    x = _mm_xor_si128(Fold(x, k), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    p += 16;
+    size -= 16;
+  }
+
+  // everything before now lives in `x` -- run it through the tables from a zero state
+  alignas(16) unsigned char tail[16];
+  _mm_store_si128(reinterpret_cast<__m128i*>(tail), x);
+  state = UpdateSliceBy8(0, tail, sizeof(tail));
+  return UpdateSliceBy8(state, p, size);
+}
+
+static bool DetectCLMUL() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  // ecx bit 1: pclmulqdq, edx bit 26: sse2
+  return (info[2] & (1 << 1)) != 0 && (info[3] & (1 << 26)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool CRC32::HasCLMUL() {
+  static const bool supported = DetectCLMUL();
+  return supported;
+}
+
+#else
+
+uint32_t CRC32::UpdateCLMUL(uint32_t state, const void* data, size_t size) {
+  return UpdateSliceBy8(state, data, size);
+}
+
+bool CRC32::HasCLMUL() {
+  return false;
+}
+
+#endif
+
+}
+}
@@ -1,8 +1,11 @@
 #include <utils/FileUtils.hpp>
+#include <utils/CRC32.hpp>
 
 #include <atomic>
 #include <cinttypes>
+#include <cstring>
 #include <mutex>
+#include <vector>
 
 #include <boost/log/trivial.hpp>
 
@@ -10,38 +13,36 @@ namespace monkeysworld {
 namespace utils {
 namespace fileutils {
 
-static const uint32_t CRC_MAGIC = 0x04C11DB7;
+// read size used when hashing streams
+static const size_t CRC_BUFFER_SIZE = 65536;
 
 uint32_t CalculateCRCHash(std::istream& input, std::streamoff offset) {
-  // todo: get this to store, lock/unlock properly
-  uint32_t crc_table[256];
-  uint32_t crc;
-
-  for (int i = 0; i < 256; i++) {
-    crc = i;
-    for (int j = 0; j < 8; j++) {
-      if (crc & 1) {
-        crc >>= 1;
-        crc ^= CRC_MAGIC;
-      } else {
-        crc >>= 1;
-      }
-    }
-    crc_table[i] = crc;
-  }
-
-  crc = 0xFFFFFFFF;
-  char c;
+  CRC32 crc;
+  std::vector<char> buffer(CRC_BUFFER_SIZE);
   std::streampos pos_initial = input.tellg();
   input.seekg(offset);
 
-  while ((c = input.get()) != EOF) {
-    crc = (crc >> 8) ^ crc_table[(c ^ crc) & 0xFF];
+  while (input) {
+    input.read(buffer.data(), buffer.size());
+    std::streamsize count = input.gcount();
+    if (count <= 0) {
+      break;
+    }
+
+    // this used to read a byte at a time into a char, which made 0xFF look like EOF.
+    // hashes stop at the first 0xFF byte for that reason -- existing caches depend on it.
+    const void* stop = std::memchr(buffer.data(), 0xFF, count);
+    if (stop != nullptr) {
+      crc.Update(buffer.data(), static_cast<const char*>(stop) - buffer.data());
+      break;
+    }
+
+    crc.Update(buffer.data(), count);
   }
 
   input.clear();
   input.seekg(pos_initial);
-  return ~crc;
+  return crc.GetHash();
 }
 
 } // namespace fileutils
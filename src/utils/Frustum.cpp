@@ -0,0 +1,369 @@
+#include <utils/Frustum.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// same deal as MatrixBatch: sse2 is always there on x86-64, avx2 is checked for at runtime
+#if defined(__x86_64__) || defined(_M_X64)
+#define FRUSTUM_X86
+#include <immintrin.h>
+#endif
+
+#if defined(FRUSTUM_X86) && !defined(_MSC_VER)
+#define FRUSTUM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define FRUSTUM_TARGET_AVX2
+#endif
+
+namespace monkeysworld {
+namespace utils {
+
+// the kernels read boxes as min xyz, then max xyz
+static_assert(sizeof(aabb) == 6 * sizeof(float), "aabb must be tightly packed");
+
+typedef float plane_table[Frustum::ROW_COUNT][8];
+
+/**
+ *  Splits a box into its center and half-extent.
+ *  Halving before adding keeps infinite boxes (+-FLT_MAX) from overflowing.
+ */
+static inline void CenterExtent(const aabb& box, glm::vec3* center, glm::vec3* extent) {
+  *center = box.min * 0.5f + box.max * 0.5f;
+  *extent = box.max * 0.5f - box.min * 0.5f;
+}
+
+// a box is outside a plane if its center is further behind it than the box's extent along the normal.
+// comparisons are written so that NaNs (from infinite boxes against axis-aligned planes) count as inside
+
+static inline bool BoxScalar(const plane_table& planes, const aabb& box) {
+  glm::vec3 c, e;
+  CenterExtent(box, &c, &e);
+  for (int i = 0; i < Frustum::PLANE_COUNT; i++) {
+    float dist = planes[Frustum::ROW_NX][i] * c.x + planes[Frustum::ROW_NY][i] * c.y
+               + planes[Frustum::ROW_NZ][i] * c.z + planes[Frustum::ROW_D][i];
+    float radius = planes[Frustum::ROW_ABS_NX][i] * e.x + planes[Frustum::ROW_ABS_NY][i] * e.y
+                 + planes[Frustum::ROW_ABS_NZ][i] * e.z;
+    if (dist + radius < 0.0f) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static size_t BoxesScalar(const plane_table& planes, const aabb* boxes, uint8_t* visible, size_t count) {
+  size_t res = 0;
+  for (size_t i = 0; i < count; i++) {
+    visible[i] = (BoxScalar(planes, boxes[i]) ? 1 : 0);
+    res += visible[i];
+  }
+
+  return res;
+}
+
+#ifdef FRUSTUM_X86
+
+/**
+ *  Tests a box against planes 0-3 and 4-7.
+ */
+static inline bool BoxSSE(const plane_table& planes, const aabb& box) {
+  glm::vec3 c, e;
+  CenterExtent(box, &c, &e);
+  __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+  __m128 ex = _mm_set1_ps(e.x), ey = _mm_set1_ps(e.y), ez = _mm_set1_ps(e.z);
+  __m128 outside = _mm_setzero_ps();
+  for (int i = 0; i < 8; i += 4) {
+    __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(&planes[Frustum::ROW_NX][i]), cx),
+                                        _mm_mul_ps(_mm_load_ps(&planes[Frustum::ROW_NY][i]), cy)),
+                             _mm_add_ps(_mm_mul_ps(_mm_load_ps(&planes[Frustum::ROW_NZ][i]), cz),
+                                        _mm_load_ps(&planes[Frustum::ROW_D][i])));
+    __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(&planes[Frustum::ROW_ABS_NX][i]), ex),
+                                          _mm_mul_ps(_mm_load_ps(&planes[Frustum::ROW_ABS_NY][i]), ey)),
+                               _mm_mul_ps(_mm_load_ps(&planes[Frustum::ROW_ABS_NZ][i]), ez));
+    outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, radius), _mm_setzero_ps()));
+  }
+
+  return (_mm_movemask_ps(outside) == 0);
+}
+
+/**
+ *  Loads 4 boxes, transposed so that each register holds one of their coordinates:
+ *  min x, min y, min z, max x, max y, max z.
+ */
+static inline void LoadBoxes4(const aabb* boxes, __m128* out) {
+  // each pair of boxes spans three registers
+  const float* p = &boxes[0].min.x;
+  __m128 a0 = _mm_loadu_ps(p), a1 = _mm_loadu_ps(p + 4), a2 = _mm_loadu_ps(p + 8);
+  __m128 b0 = _mm_loadu_ps(p + 12), b1 = _mm_loadu_ps(p + 16), b2 = _mm_loadu_ps(p + 20);
+  __m128 a_min_xy = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 2, 1, 0));
+  __m128 b_min_xy = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 2, 1, 0));
+  __m128 a_mid = _mm_shuffle_ps(a0, a2, _MM_SHUFFLE(1, 0, 3, 2));       // min z, max x
+  __m128 b_mid = _mm_shuffle_ps(b0, b2, _MM_SHUFFLE(1, 0, 3, 2));
+  __m128 a_max_yz = _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(3, 2, 1, 0));
+  __m128 b_max_yz = _mm_shuffle_ps(b1, b2, _MM_SHUFFLE(3, 2, 1, 0));
+  out[0] = _mm_shuffle_ps(a_min_xy, b_min_xy, _MM_SHUFFLE(2, 0, 2, 0));
+  out[1] = _mm_shuffle_ps(a_min_xy, b_min_xy, _MM_SHUFFLE(3, 1, 3, 1));
+  out[2] = _mm_shuffle_ps(a_mid, b_mid, _MM_SHUFFLE(2, 0, 2, 0));
+  out[3] = _mm_shuffle_ps(a_mid, b_mid, _MM_SHUFFLE(3, 1, 3, 1));
+  out[4] = _mm_shuffle_ps(a_max_yz, b_max_yz, _MM_SHUFFLE(2, 0, 2, 0));
+  out[5] = _mm_shuffle_ps(a_max_yz, b_max_yz, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+/**
+ *  Writes one flag per box from a mask of culled boxes.
+ *  @returns the number of visible boxes.
+ */
+static inline size_t StoreVisible(int culled, uint8_t* visible, int count) {
+  size_t res = 0;
+  for (int i = 0; i < count; i++) {
+    visible[i] = static_cast<uint8_t>(((culled >> i) & 1) ^ 1);
+    res += visible[i];
+  }
+
+  return res;
+}
+
+// the batch kernels put a box in each lane, and go through the planes one at a time
+
+static size_t BoxesSSE(const plane_table& planes, const aabb* boxes, uint8_t* visible, size_t count) {
+  const __m128 half = _mm_set1_ps(0.5f);
+  size_t res = 0;
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 b[6];
+    LoadBoxes4(boxes + i, b);
+    __m128 cx = _mm_add_ps(_mm_mul_ps(b[0], half), _mm_mul_ps(b[3], half));
+    __m128 cy = _mm_add_ps(_mm_mul_ps(b[1], half), _mm_mul_ps(b[4], half));
+    __m128 cz = _mm_add_ps(_mm_mul_ps(b[2], half), _mm_mul_ps(b[5], half));
+    __m128 ex = _mm_sub_ps(_mm_mul_ps(b[3], half), _mm_mul_ps(b[0], half));
+    __m128 ey = _mm_sub_ps(_mm_mul_ps(b[4], half), _mm_mul_ps(b[1], half));
+    __m128 ez = _mm_sub_ps(_mm_mul_ps(b[5], half), _mm_mul_ps(b[2], half));
+    __m128 outside = _mm_setzero_ps();
+    for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+      __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[Frustum::ROW_NX][p]), cx),
+                                          _mm_mul_ps(_mm_set1_ps(planes[Frustum::ROW_NY][p]), cy)),
+                               _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[Frustum::ROW_NZ][p]), cz),
+                                          _mm_set1_ps(planes[Frustum::ROW_D][p])));
+      __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[Frustum::ROW_ABS_NX][p]), ex),
+                                            _mm_mul_ps(_mm_set1_ps(planes[Frustum::ROW_ABS_NY][p]), ey)),
+                                 _mm_mul_ps(_mm_set1_ps(planes[Frustum::ROW_ABS_NZ][p]), ez));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, radius), _mm_setzero_ps()));
+    }
+
+    res += StoreVisible(_mm_movemask_ps(outside), visible + i, 4);
+  }
+
+  for (; i < count; i++) {
+    visible[i] = (BoxSSE(planes, boxes[i]) ? 1 : 0);
+    res += visible[i];
+  }
+
+  return res;
+}
+
+/**
+ *  Plane table, loaded into registers.
+ */
+struct planes_avx2 {
+  __m256 nx, ny, nz, d;
+  __m256 abs_nx, abs_ny, abs_nz;
+};
+
+FRUSTUM_TARGET_AVX2
+static inline planes_avx2 LoadPlanesAVX2(const plane_table& planes) {
+  planes_avx2 res;
+  res.nx = _mm256_load_ps(planes[Frustum::ROW_NX]);
+  res.ny = _mm256_load_ps(planes[Frustum::ROW_NY]);
+  res.nz = _mm256_load_ps(planes[Frustum::ROW_NZ]);
+  res.d = _mm256_load_ps(planes[Frustum::ROW_D]);
+  res.abs_nx = _mm256_load_ps(planes[Frustum::ROW_ABS_NX]);
+  res.abs_ny = _mm256_load_ps(planes[Frustum::ROW_ABS_NY]);
+  res.abs_nz = _mm256_load_ps(planes[Frustum::ROW_ABS_NZ]);
+  return res;
+}
+
+/**
+ *  Tests a box against all eight planes at once.
+ */
+FRUSTUM_TARGET_AVX2
+static inline bool BoxAVX2(const planes_avx2& p, const aabb& box) {
+  // center and extent for x, y, z in one go
+  __m128 lo = _mm_loadu_ps(&box.min.x);                                   // min xyz, max x
+  __m128 hi = _mm_loadu_ps(&box.max.x - 1);                               // min z, max xyz
+  hi = _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(0, 3, 2, 1));                   // max xyz, min z
+  __m128 half = _mm_set1_ps(0.5f);
+  __m128 c = _mm_add_ps(_mm_mul_ps(lo, half), _mm_mul_ps(hi, half));
+  __m128 e = _mm_sub_ps(_mm_mul_ps(hi, half), _mm_mul_ps(lo, half));
+
+  __m256 cx = _mm256_broadcastss_ps(c);
+  __m256 cy = _mm256_broadcastss_ps(_mm_shuffle_ps(c, c, _MM_SHUFFLE(1, 1, 1, 1)));
+  __m256 cz = _mm256_broadcastss_ps(_mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 2, 2, 2)));
+  __m256 ex = _mm256_broadcastss_ps(e);
+  __m256 ey = _mm256_broadcastss_ps(_mm_shuffle_ps(e, e, _MM_SHUFFLE(1, 1, 1, 1)));
+  __m256 ez = _mm256_broadcastss_ps(_mm_shuffle_ps(e, e, _MM_SHUFFLE(2, 2, 2, 2)));
+
+  __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p.nx, cx), _mm256_mul_ps(p.ny, cy)),
+                              _mm256_add_ps(_mm256_mul_ps(p.nz, cz), p.d));
+  __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p.abs_nx, ex), _mm256_mul_ps(p.abs_ny, ey)),
+                                _mm256_mul_ps(p.abs_nz, ez));
+  __m256 outside = _mm256_cmp_ps(_mm256_add_ps(dist, radius), _mm256_setzero_ps(), _CMP_LT_OQ);
+  return (_mm256_movemask_ps(outside) == 0);
+}
+
+FRUSTUM_TARGET_AVX2
+static bool BoxSingleAVX2(const plane_table& planes, const aabb& box) {
+  return BoxAVX2(LoadPlanesAVX2(planes), box);
+}
+
+/**
+ *  LoadBoxes4, for 8 boxes: the first four in the low half of each register, the rest in the high half.
+ */
+FRUSTUM_TARGET_AVX2
+static inline void LoadBoxes8(const aabb* boxes, __m256* out) {
+  __m128 lo[6], hi[6];
+  LoadBoxes4(boxes, lo);
+  LoadBoxes4(boxes + 4, hi);
+  for (int i = 0; i < 6; i++) {
+    out[i] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo[i]), hi[i], 1);
+  }
+}
+
+FRUSTUM_TARGET_AVX2
+static size_t BoxesAVX2(const plane_table& planes, const aabb* boxes, uint8_t* visible, size_t count) {
+  const __m256 half = _mm256_set1_ps(0.5f);
+  size_t res = 0;
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 b[6];
+    LoadBoxes8(boxes + i, b);
+    __m256 cx = _mm256_add_ps(_mm256_mul_ps(b[0], half), _mm256_mul_ps(b[3], half));
+    __m256 cy = _mm256_add_ps(_mm256_mul_ps(b[1], half), _mm256_mul_ps(b[4], half));
+    __m256 cz = _mm256_add_ps(_mm256_mul_ps(b[2], half), _mm256_mul_ps(b[5], half));
+    __m256 ex = _mm256_sub_ps(_mm256_mul_ps(b[3], half), _mm256_mul_ps(b[0], half));
+    __m256 ey = _mm256_sub_ps(_mm256_mul_ps(b[4], half), _mm256_mul_ps(b[1], half));
+    __m256 ez = _mm256_sub_ps(_mm256_mul_ps(b[5], half), _mm256_mul_ps(b[2], half));
+    __m256 outside = _mm256_setzero_ps();
+    for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+      __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[Frustum::ROW_NX][p]), cx),
+                                                _mm256_mul_ps(_mm256_set1_ps(planes[Frustum::ROW_NY][p]), cy)),
+                                  _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[Frustum::ROW_NZ][p]), cz),
+                                                _mm256_set1_ps(planes[Frustum::ROW_D][p])));
+      __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[Frustum::ROW_ABS_NX][p]), ex),
+                                                  _mm256_mul_ps(_mm256_set1_ps(planes[Frustum::ROW_ABS_NY][p]), ey)),
+                                    _mm256_mul_ps(_mm256_set1_ps(planes[Frustum::ROW_ABS_NZ][p]), ez));
+      outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(dist, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+    }
+
+    res += StoreVisible(_mm256_movemask_ps(outside), visible + i, 8);
+  }
+
+  planes_avx2 p = LoadPlanesAVX2(planes);
+  for (; i < count; i++) {
+    visible[i] = (BoxAVX2(p, boxes[i]) ? 1 : 0);
+    res += visible[i];
+  }
+
+  return res;
+}
+
+#endif
+
+Frustum::Frustum() : kernel_(MatrixBatch::GetBestKernel()) {
+  for (int i = 0; i < 8; i++) {
+    for (int row = 0; row < ROW_COUNT; row++) {
+      planes_[row][i] = 0.0f;
+    }
+
+    planes_[ROW_D][i] = 1.0f;
+  }
+}
+
+Frustum::Frustum(const glm::mat4& vp_matrix) : Frustum() {
+  // Gribb/Hartmann: each plane is the last row of the matrix, plus or minus one of the others
+  glm::mat4 rows = glm::transpose(vp_matrix);
+  glm::vec4 planes[PLANE_COUNT] = {
+    rows[3] + rows[0],        // left
+    rows[3] - rows[0],        // right
+    rows[3] + rows[1],        // bottom
+    rows[3] - rows[1],        // top
+    rows[3] + rows[2],        // near
+    rows[3] - rows[2]         // far
+  };
+
+  for (int i = 0; i < PLANE_COUNT; i++) {
+    // normalized so that extents and sphere radii can be compared against distances
+    float len = glm::length(glm::vec3(planes[i]));
+    glm::vec4 plane = (len > 0.0f ? planes[i] / len : planes[i]);
+    planes_[ROW_NX][i] = plane.x;
+    planes_[ROW_NY][i] = plane.y;
+    planes_[ROW_NZ][i] = plane.z;
+    planes_[ROW_D][i] = plane.w;
+    planes_[ROW_ABS_NX][i] = std::abs(plane.x);
+    planes_[ROW_ABS_NY][i] = std::abs(plane.y);
+    planes_[ROW_ABS_NZ][i] = std::abs(plane.z);
+  }
+}
+
+bool Frustum::TestBox(const aabb& box) const {
+  switch (kernel_) {
+#ifdef FRUSTUM_X86
+    case MatrixBatch::KERNEL_AVX2:
+      return BoxSingleAVX2(planes_, box);
+    case MatrixBatch::KERNEL_SSE:
+      return BoxSSE(planes_, box);
+#endif
+    default:
+      return BoxScalar(planes_, box);
+  }
+}
+
+bool Frustum::TestSphere(const bounding_sphere& sphere) const {
+  for (int i = 0; i < PLANE_COUNT; i++) {
+    float dist = planes_[ROW_NX][i] * sphere.center.x + planes_[ROW_NY][i] * sphere.center.y
+               + planes_[ROW_NZ][i] * sphere.center.z + planes_[ROW_D][i];
+    if (dist < -sphere.radius) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Frustum::ContainsBox(const aabb& box) const {
+  if (IsEmpty(box)) {
+    return false;
+  }
+
+  glm::vec3 c, e;
+  CenterExtent(box, &c, &e);
+  for (int i = 0; i < PLANE_COUNT; i++) {
+    float dist = planes_[ROW_NX][i] * c.x + planes_[ROW_NY][i] * c.y + planes_[ROW_NZ][i] * c.z + planes_[ROW_D][i];
+    float radius = planes_[ROW_ABS_NX][i] * e.x + planes_[ROW_ABS_NY][i] * e.y + planes_[ROW_ABS_NZ][i] * e.z;
+    // NaNs fail here, which is the safe way for this test
+    if (!(dist - radius >= 0.0f)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+size_t Frustum::TestBoxes(const aabb* boxes, uint8_t* visible, size_t count) const {
+  return TestBoxes(kernel_, boxes, visible, count);
+}
+
+size_t Frustum::TestBoxes(MatrixBatch::Kernel kernel, const aabb* boxes, uint8_t* visible, size_t count) const {
+  switch (std::min(kernel, MatrixBatch::GetBestKernel())) {
+#ifdef FRUSTUM_X86
+    case MatrixBatch::KERNEL_AVX2:
+      return BoxesAVX2(planes_, boxes, visible, count);
+    case MatrixBatch::KERNEL_SSE:
+      return BoxesSSE(planes_, boxes, visible, count);
+#endif
+    default:
+      return BoxesScalar(planes_, boxes, visible, count);
+  }
+}
+
+}
+}
@@ -1,29 +1,106 @@
 #include <utils/IDGenerator.hpp>
 
+#include <algorithm>
+#include <limits>
+
 namespace monkeysworld {
 namespace utils {
 
+static const uint64_t NO_RESERVED_ID = std::numeric_limits<uint64_t>::max();
+
 IDGenerator::IDGenerator() {
-  id_min_.store(1, std::memory_order_release);
+  // 0 and 1 are taken
+  id_next_.store(2);
+  reserved_min_.store(NO_RESERVED_ID);
 }
 
 uint64_t IDGenerator::GetUniqueId() {
-  std::lock_guard<std::mutex> lock(id_generation_lock_);
-  while (used_ids_.find(++id_min_) != used_ids_.end());
+  return GetUniqueIds(1).first;
+}
 
-  auto itr = used_ids_.begin();
-  while (itr != used_ids_.end() && *itr < id_min_) {
-    itr++;
-  }
-  used_ids_.erase(used_ids_.begin(), itr);
+id_block IDGenerator::GetUniqueIds(uint64_t count) {
+  uint64_t first = id_next_.load();
+  for (;;) {
+    uint64_t limit = reserved_min_.load();
+    if (first < limit) {
+      uint64_t end = std::min(first + std::max(count, static_cast<uint64_t>(1)), limit);
+      if (id_next_.compare_exchange_weak(first, end)) {
+        return { first, end };
+      }
+
+      // someone else got there first -- `first` has been reloaded
+      continue;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(reserve_lock_);
+      SkipReservedIds();
+    }
 
-  return id_min_.load(std::memory_order_acquire);
+    first = id_next_.load();
+  }
 }
 
 void IDGenerator::RegisterUniqueId(uint64_t new_id) {
-  std::lock_guard<std::mutex> lock(id_generation_lock_);
-  used_ids_.insert(new_id);
+  std::lock_guard<std::mutex> lock(reserve_lock_);
+  if (new_id < id_next_.load()) {
+    // already handed out -- we won't see it again
+    return;
+  }
+
+  // find the first range (counting from the back) which starts above new_id
+  auto above = std::upper_bound(reserved_.rbegin(), reserved_.rend(), new_id, [](uint64_t id, const id_range& r) {
+    return id < r.first;
+  });
+
+  bool joins_above = (above != reserved_.rend() && above->first == new_id + 1);
+  if (above != reserved_.rbegin()) {
+    auto below = std::prev(above);
+    if (below->last >= new_id) {
+      // already in use
+      return;
+    }
+
+    if (below->last + 1 == new_id) {
+      below->last = new_id;
+      if (joins_above) {
+        below->last = above->last;
+        reserved_.erase(std::next(above).base());
+      }
+
+      reserved_min_.store(reserved_.back().first);
+      return;
+    }
+  }
+
+  if (joins_above) {
+    above->first = new_id;
+  } else {
+    reserved_.insert(above.base(), { new_id, new_id });
+  }
+
+  reserved_min_.store(reserved_.back().first);
 }
 
+void IDGenerator::SkipReservedIds() {
+  uint64_t next = id_next_.load();
+  while (!reserved_.empty()) {
+    const id_range& r = reserved_.back();
+    if (r.last < next) {
+      // passed it already
+      reserved_.pop_back();
+    } else if (r.first <= next) {
+      // only an ID marked as used while someone was drawing could race us here
+      while (next <= r.last && !id_next_.compare_exchange_weak(next, r.last + 1));
+      next = std::max(next, r.last + 1);
+      reserved_.pop_back();
+    } else {
+      break;
+    }
+  }
+
+  reserved_min_.store(reserved_.empty() ? NO_RESERVED_ID : reserved_.back().first);
+}
+
+}
 }
-}
\ No newline at end of file
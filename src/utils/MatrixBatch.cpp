@@ -0,0 +1,491 @@
+#include <utils/MatrixBatch.hpp>
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/euler_angles.hpp>
+
+#include <algorithm>
+
+// sse2 is part of x86-64, so only avx2 needs checking for at runtime
+#if defined(__x86_64__) || defined(_M_X64)
+#define MATRIX_BATCH_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// gcc/clang need to be told that the avx2 kernels may use avx2, msvc doesn't care
+#if defined(MATRIX_BATCH_X86) && !defined(_MSC_VER)
+#define MATRIX_BATCH_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MATRIX_BATCH_TARGET_AVX2
+#endif
+
+namespace monkeysworld {
+namespace utils {
+
+// the SIMD kernels treat glm types as plain arrays of floats
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "vec3 must be tightly packed");
+static_assert(sizeof(glm::mat3) == 9 * sizeof(float), "mat3 must be tightly packed");
+static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "mat4 must be tightly packed");
+
+static void ComposeScalar(const glm::vec3* position,
+                          const glm::vec3* rotation,
+                          const glm::vec3* scale,
+                          glm::mat4* out,
+                          size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    // scales, then rotates, then translates
+    glm::mat4 res = glm::translate(glm::mat4(1.0), position[i]);
+    res *= glm::eulerAngleYXZ(rotation[i].y, rotation[i].x, rotation[i].z);
+    out[i] = glm::scale(res, scale[i]);
+  }
+}
+
+static void NormalsScalar(const glm::mat4* model, glm::mat3* out, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    out[i] = glm::inverseTranspose(glm::mat3(model[i]));
+  }
+}
+
+#ifdef MATRIX_BATCH_X86
+
+// constants for cephes' single precision sin/cos, which most SIMD math libraries use.
+// good to a couple of ulps for |x| < 8192 -- far beyond any sensible rotation
+static const float FOUR_OVER_PI = 1.27323954473516f;
+static const float DP1 = 0.78515625f;
+static const float DP2 = 2.4187564849853515625e-4f;
+static const float DP3 = 3.77489497744594108e-8f;
+static const float SIN_P0 = -1.9515295891e-4f;
+static const float SIN_P1 = 8.3321608736e-3f;
+static const float SIN_P2 = -1.6666654611e-1f;
+static const float COS_P0 = 2.443315711809948e-5f;
+static const float COS_P1 = -1.388731625493765e-3f;
+static const float COS_P2 = 4.166664568298827e-2f;
+
+/**
+ *  Computes sin and cos of 4 floats.
+ */
+static inline void SinCos4(__m128 x, __m128* s, __m128* c) {
+  const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000)));
+  __m128 sign_sin = _mm_and_ps(x, sign_mask);
+  x = _mm_andnot_ps(sign_mask, x);
+
+  // octant, rounded up to even
+  __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOUR_OVER_PI)));
+  j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+  __m128 y = _mm_cvtepi32_ps(j);
+
+  __m128 swap_sin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29));
+  __m128 sign_cos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)),
+                                                                     _mm_set1_epi32(4)), 29));
+  // set where the sin polynomial gives sin (rather than cos)
+  __m128 poly_mask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+  sign_sin = _mm_xor_ps(sign_sin, swap_sin);
+
+  // x - y * pi/4, in three parts to keep precision
+  x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP1)));
+  x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP2)));
+  x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP3)));
+
+  __m128 z = _mm_mul_ps(x, x);
+  __m128 cos_poly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_P0), z), _mm_set1_ps(COS_P1));
+  cos_poly = _mm_add_ps(_mm_mul_ps(cos_poly, z), _mm_set1_ps(COS_P2));
+  cos_poly = _mm_mul_ps(_mm_mul_ps(cos_poly, z), z);
+  cos_poly = _mm_sub_ps(cos_poly, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+  cos_poly = _mm_add_ps(cos_poly, _mm_set1_ps(1.0f));
+
+  __m128 sin_poly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_P0), z), _mm_set1_ps(SIN_P1));
+  sin_poly = _mm_add_ps(_mm_mul_ps(sin_poly, z), _mm_set1_ps(SIN_P2));
+  sin_poly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sin_poly, z), x), x);
+
+  __m128 sin_res = _mm_or_ps(_mm_and_ps(poly_mask, sin_poly), _mm_andnot_ps(poly_mask, cos_poly));
+  __m128 cos_res = _mm_or_ps(_mm_and_ps(poly_mask, cos_poly), _mm_andnot_ps(poly_mask, sin_poly));
+  *s = _mm_xor_ps(sin_res, sign_sin);
+  *c = _mm_xor_ps(cos_res, sign_cos);
+}
+
+/**
+ *  Loads 4 consecutive vec3s, and splits them into x, y and z lanes.
+ */
+static inline void LoadVec3x4(const float* p, __m128* x, __m128* y, __m128* z) {
+  // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+  __m128 a = _mm_loadu_ps(p);
+  __m128 b = _mm_loadu_ps(p + 4);
+  __m128 c = _mm_loadu_ps(p + 8);
+  __m128 lo = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 3, 0));     // x0 x1 . .
+  __m128 hi = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));     // x2 . x3 .
+  *x = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 1, 0));
+  lo = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));            // y0 . y1 .
+  hi = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));            // y2 . y3 .
+  *y = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+  lo = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));            // z0 . z1 .
+  hi = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));            // z2 . z3 .
+  *z = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+/**
+ *  Loads the xyz of one column from each of 4 consecutive mat4s.
+ *  @param p - the column's first element, in the first matrix.
+ */
+static inline void LoadColumns4(const float* p, __m128* x, __m128* y, __m128* z) {
+  __m128 c0 = _mm_loadu_ps(p);
+  __m128 c1 = _mm_loadu_ps(p + 16);
+  __m128 c2 = _mm_loadu_ps(p + 32);
+  __m128 c3 = _mm_loadu_ps(p + 48);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+  *x = c0;
+  *y = c1;
+  *z = c2;
+}
+
+/**
+ *  Writes one column to each of 4 consecutive mat4s.
+ *  @param p - the column's first element, in the first matrix.
+ */
+static inline void StoreColumns4(float* p, __m128 x, __m128 y, __m128 z, __m128 w) {
+  _MM_TRANSPOSE4_PS(x, y, z, w);
+  _mm_storeu_ps(p, x);
+  _mm_storeu_ps(p + 16, y);
+  _mm_storeu_ps(p + 32, z);
+  _mm_storeu_ps(p + 48, w);
+}
+
+/**
+ *  Writes one column to each of 4 consecutive mat3s.
+ *  @param p - the column's first element, in the first matrix.
+ */
+static inline void StoreColumns4Mat3(float* p, __m128 x, __m128 y, __m128 z) {
+  __m128 w = _mm_setzero_ps();
+  _MM_TRANSPOSE4_PS(x, y, z, w);
+  __m128 cols[4] = { x, y, z, w };
+  for (int i = 0; i < 4; i++) {
+    // three floats at a time, so we don't run over the end of the last matrix
+    _mm_storel_pi(reinterpret_cast<__m64*>(p + 9 * i), cols[i]);
+    _mm_store_ss(p + 9 * i + 2, _mm_movehl_ps(cols[i], cols[i]));
+  }
+}
+
+static void ComposeSSE(const glm::vec3* position,
+                       const glm::vec3* rotation,
+                       const glm::vec3* scale,
+                       glm::mat4* out,
+                       size_t count) {
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 px, py, pz, rx, ry, rz, sx, sy, sz;
+    LoadVec3x4(&position[i].x, &px, &py, &pz);
+    LoadVec3x4(&rotation[i].x, &rx, &ry, &rz);
+    LoadVec3x4(&scale[i].x, &sx, &sy, &sz);
+
+    // yaw (y), pitch (x), roll (z) -- same names as glm's eulerAngleYXZ
+    __m128 sh, ch, sp, cp, sb, cb;
+    SinCos4(ry, &sh, &ch);
+    SinCos4(rx, &sp, &cp);
+    SinCos4(rz, &sb, &cb);
+    __m128 sh_sp = _mm_mul_ps(sh, sp);
+    __m128 ch_sp = _mm_mul_ps(ch, sp);
+
+    __m128 m00 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ch, cb), _mm_mul_ps(sh_sp, sb)), sx);
+    __m128 m01 = _mm_mul_ps(_mm_mul_ps(sb, cp), sx);
+    __m128 m02 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ch_sp, sb), _mm_mul_ps(sh, cb)), sx);
+    __m128 m10 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sh_sp, cb), _mm_mul_ps(ch, sb)), sy);
+    __m128 m11 = _mm_mul_ps(_mm_mul_ps(cb, cp), sy);
+    __m128 m12 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sb, sh), _mm_mul_ps(ch_sp, cb)), sy);
+    __m128 m20 = _mm_mul_ps(_mm_mul_ps(sh, cp), sz);
+    __m128 m21 = _mm_mul_ps(_mm_sub_ps(zero, sp), sz);
+    __m128 m22 = _mm_mul_ps(_mm_mul_ps(ch, cp), sz);
+
+    float* res = &out[i][0][0];
+    StoreColumns4(res, m00, m01, m02, zero);
+    StoreColumns4(res + 4, m10, m11, m12, zero);
+    StoreColumns4(res + 8, m20, m21, m22, zero);
+    StoreColumns4(res + 12, px, py, pz, one);
+  }
+
+  ComposeScalar(position + i, rotation + i, scale + i, out + i, count - i);
+}
+
+static void NormalsSSE(const glm::mat4* model, glm::mat3* out, size_t count) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    // columns a, b and c of the upper 3x3
+    const float* m = &model[i][0][0];
+    __m128 ax, ay, az, bx, by, bz, cx, cy, cz;
+    LoadColumns4(m, &ax, &ay, &az);
+    LoadColumns4(m + 4, &bx, &by, &bz);
+    LoadColumns4(m + 8, &cx, &cy, &cz);
+
+    // the inverse transpose's columns are b x c, c x a and a x b, over the determinant
+    __m128 bcx = _mm_sub_ps(_mm_mul_ps(by, cz), _mm_mul_ps(bz, cy));
+    __m128 bcy = _mm_sub_ps(_mm_mul_ps(bz, cx), _mm_mul_ps(bx, cz));
+    __m128 bcz = _mm_sub_ps(_mm_mul_ps(bx, cy), _mm_mul_ps(by, cx));
+    __m128 cax = _mm_sub_ps(_mm_mul_ps(cy, az), _mm_mul_ps(cz, ay));
+    __m128 cay = _mm_sub_ps(_mm_mul_ps(cz, ax), _mm_mul_ps(cx, az));
+    __m128 caz = _mm_sub_ps(_mm_mul_ps(cx, ay), _mm_mul_ps(cy, ax));
+    __m128 abx = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+    __m128 aby = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+    __m128 abz = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bcx), _mm_mul_ps(ay, bcy)), _mm_mul_ps(az, bcz));
+    __m128 inv = _mm_div_ps(one, det);
+
+    float* res = &out[i][0][0];
+    StoreColumns4Mat3(res, _mm_mul_ps(bcx, inv), _mm_mul_ps(bcy, inv), _mm_mul_ps(bcz, inv));
+    StoreColumns4Mat3(res + 3, _mm_mul_ps(cax, inv), _mm_mul_ps(cay, inv), _mm_mul_ps(caz, inv));
+    StoreColumns4Mat3(res + 6, _mm_mul_ps(abx, inv), _mm_mul_ps(aby, inv), _mm_mul_ps(abz, inv));
+  }
+
+  NormalsScalar(model + i, out + i, count - i);
+}
+
+/**
+ *  Computes sin and cos of 8 floats. See SinCos4.
+ */
+MATRIX_BATCH_TARGET_AVX2
+static inline void SinCos8(__m256 x, __m256* s, __m256* c) {
+  const __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(0x80000000)));
+  __m256 sign_sin = _mm256_and_ps(x, sign_mask);
+  x = _mm256_andnot_ps(sign_mask, x);
+
+  __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(FOUR_OVER_PI)));
+  j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+  __m256 y = _mm256_cvtepi32_ps(j);
+
+  __m256 swap_sin = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29));
+  __m256 sign_cos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, _mm256_set1_epi32(2)),
+                                                                              _mm256_set1_epi32(4)), 29));
+  __m256 poly_mask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)),
+                                                            _mm256_setzero_si256()));
+  sign_sin = _mm256_xor_ps(sign_sin, swap_sin);
+
+  x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(DP1)));
+  x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(DP2)));
+  x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(DP3)));
+
+  __m256 z = _mm256_mul_ps(x, x);
+  __m256 cos_poly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(COS_P0), z), _mm256_set1_ps(COS_P1));
+  cos_poly = _mm256_add_ps(_mm256_mul_ps(cos_poly, z), _mm256_set1_ps(COS_P2));
+  cos_poly = _mm256_mul_ps(_mm256_mul_ps(cos_poly, z), z);
+  cos_poly = _mm256_sub_ps(cos_poly, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+  cos_poly = _mm256_add_ps(cos_poly, _mm256_set1_ps(1.0f));
+
+  __m256 sin_poly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_P0), z), _mm256_set1_ps(SIN_P1));
+  sin_poly = _mm256_add_ps(_mm256_mul_ps(sin_poly, z), _mm256_set1_ps(SIN_P2));
+  sin_poly = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sin_poly, z), x), x);
+
+  __m256 sin_res = _mm256_blendv_ps(cos_poly, sin_poly, poly_mask);
+  __m256 cos_res = _mm256_blendv_ps(sin_poly, cos_poly, poly_mask);
+  *s = _mm256_xor_ps(sin_res, sign_sin);
+  *c = _mm256_xor_ps(cos_res, sign_cos);
+}
+
+/**
+ *  Loads 8 consecutive vec3s, and splits them into x, y and z lanes.
+ */
+MATRIX_BATCH_TARGET_AVX2
+static inline void LoadVec3x8(const float* p, __m256* x, __m256* y, __m256* z) {
+  __m128 x_lo, y_lo, z_lo, x_hi, y_hi, z_hi;
+  LoadVec3x4(p, &x_lo, &y_lo, &z_lo);
+  LoadVec3x4(p + 12, &x_hi, &y_hi, &z_hi);
+  *x = _mm256_insertf128_ps(_mm256_castps128_ps256(x_lo), x_hi, 1);
+  *y = _mm256_insertf128_ps(_mm256_castps128_ps256(y_lo), y_hi, 1);
+  *z = _mm256_insertf128_ps(_mm256_castps128_ps256(z_lo), z_hi, 1);
+}
+
+MATRIX_BATCH_TARGET_AVX2
+static void ComposeAVX2(const glm::vec3* position,
+                        const glm::vec3* rotation,
+                        const glm::vec3* scale,
+                        glm::mat4* out,
+                        size_t count) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 px, py, pz, rx, ry, rz, sx, sy, sz;
+    LoadVec3x8(&position[i].x, &px, &py, &pz);
+    LoadVec3x8(&rotation[i].x, &rx, &ry, &rz);
+    LoadVec3x8(&scale[i].x, &sx, &sy, &sz);
+
+    __m256 sh, ch, sp, cp, sb, cb;
+    SinCos8(ry, &sh, &ch);
+    SinCos8(rx, &sp, &cp);
+    SinCos8(rz, &sb, &cb);
+    __m256 sh_sp = _mm256_mul_ps(sh, sp);
+    __m256 ch_sp = _mm256_mul_ps(ch, sp);
+
+    // cols[c][r] holds row r of column c, for all 8 matrices
+    __m256 cols[4][4];
+    cols[0][0] = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(ch, cb), _mm256_mul_ps(sh_sp, sb)), sx);
+    cols[0][1] = _mm256_mul_ps(_mm256_mul_ps(sb, cp), sx);
+    cols[0][2] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(ch_sp, sb), _mm256_mul_ps(sh, cb)), sx);
+    cols[1][0] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(sh_sp, cb), _mm256_mul_ps(ch, sb)), sy);
+    cols[1][1] = _mm256_mul_ps(_mm256_mul_ps(cb, cp), sy);
+    cols[1][2] = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(sb, sh), _mm256_mul_ps(ch_sp, cb)), sy);
+    cols[2][0] = _mm256_mul_ps(_mm256_mul_ps(sh, cp), sz);
+    cols[2][1] = _mm256_mul_ps(_mm256_sub_ps(zero, sp), sz);
+    cols[2][2] = _mm256_mul_ps(_mm256_mul_ps(ch, cp), sz);
+    cols[0][3] = cols[1][3] = cols[2][3] = zero;
+    cols[3][0] = px;
+    cols[3][1] = py;
+    cols[3][2] = pz;
+    cols[3][3] = one;
+
+    float* res = &out[i][0][0];
+    for (int c = 0; c < 4; c++) {
+      StoreColumns4(res + 4 * c,
+                    _mm256_castps256_ps128(cols[c][0]), _mm256_castps256_ps128(cols[c][1]),
+                    _mm256_castps256_ps128(cols[c][2]), _mm256_castps256_ps128(cols[c][3]));
+      StoreColumns4(res + 64 + 4 * c,
+                    _mm256_extractf128_ps(cols[c][0], 1), _mm256_extractf128_ps(cols[c][1], 1),
+                    _mm256_extractf128_ps(cols[c][2], 1), _mm256_extractf128_ps(cols[c][3], 1));
+    }
+  }
+
+  ComposeSSE(position + i, rotation + i, scale + i, out + i, count - i);
+}
+
+MATRIX_BATCH_TARGET_AVX2
+static void NormalsAVX2(const glm::mat4* model, glm::mat3* out, size_t count) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    // load[c][r] holds row r of column c, for all 8 matrices
+    const float* m = &model[i][0][0];
+    __m256 load[3][3];
+    for (int c = 0; c < 3; c++) {
+      __m128 lo[3];
+      __m128 hi[3];
+      LoadColumns4(m + 4 * c, &lo[0], &lo[1], &lo[2]);
+      LoadColumns4(m + 64 + 4 * c, &hi[0], &hi[1], &hi[2]);
+      for (int r = 0; r < 3; r++) {
+        load[c][r] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo[r]), hi[r], 1);
+      }
+    }
+
+    const __m256* a = load[0];
+    const __m256* b = load[1];
+    const __m256* c = load[2];
+    __m256 res[3][3];
+    res[0][0] = _mm256_sub_ps(_mm256_mul_ps(b[1], c[2]), _mm256_mul_ps(b[2], c[1]));
+    res[0][1] = _mm256_sub_ps(_mm256_mul_ps(b[2], c[0]), _mm256_mul_ps(b[0], c[2]));
+    res[0][2] = _mm256_sub_ps(_mm256_mul_ps(b[0], c[1]), _mm256_mul_ps(b[1], c[0]));
+    res[1][0] = _mm256_sub_ps(_mm256_mul_ps(c[1], a[2]), _mm256_mul_ps(c[2], a[1]));
+    res[1][1] = _mm256_sub_ps(_mm256_mul_ps(c[2], a[0]), _mm256_mul_ps(c[0], a[2]));
+    res[1][2] = _mm256_sub_ps(_mm256_mul_ps(c[0], a[1]), _mm256_mul_ps(c[1], a[0]));
+    res[2][0] = _mm256_sub_ps(_mm256_mul_ps(a[1], b[2]), _mm256_mul_ps(a[2], b[1]));
+    res[2][1] = _mm256_sub_ps(_mm256_mul_ps(a[2], b[0]), _mm256_mul_ps(a[0], b[2]));
+    res[2][2] = _mm256_sub_ps(_mm256_mul_ps(a[0], b[1]), _mm256_mul_ps(a[1], b[0]));
+    __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[0], res[0][0]), _mm256_mul_ps(a[1], res[0][1])),
+                               _mm256_mul_ps(a[2], res[0][2]));
+    __m256 inv = _mm256_div_ps(one, det);
+
+    float* dst = &out[i][0][0];
+    for (int col = 0; col < 3; col++) {
+      __m256 x = _mm256_mul_ps(res[col][0], inv);
+      __m256 y = _mm256_mul_ps(res[col][1], inv);
+      __m256 z = _mm256_mul_ps(res[col][2], inv);
+      StoreColumns4Mat3(dst + 3 * col,
+                        _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z));
+      StoreColumns4Mat3(dst + 36 + 3 * col,
+                        _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1));
+    }
+  }
+
+  NormalsSSE(model + i, out + i, count - i);
+}
+
+static bool DetectAVX2() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+
+  // ecx bit 27: osxsave, ecx bit 28: avx
+  __cpuid(info, 1);
+  if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) {
+    return false;
+  }
+
+  // the OS has to save ymm registers for us, too
+  if ((_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+
+  // ebx bit 5: avx2
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+MatrixBatch::Kernel MatrixBatch::GetBestKernel() {
+  static const Kernel best = (DetectAVX2() ? KERNEL_AVX2 : KERNEL_SSE);
+  return best;
+}
+
+#else
+
+MatrixBatch::Kernel MatrixBatch::GetBestKernel() {
+  return KERNEL_SCALAR;
+}
+
+#endif
+
+void MatrixBatch::ComposeTransforms(const glm::vec3* position,
+                                    const glm::vec3* rotation,
+                                    const glm::vec3* scale,
+                                    glm::mat4* out,
+                                    size_t count) {
+  ComposeTransforms(GetBestKernel(), position, rotation, scale, out, count);
+}
+
+void MatrixBatch::ComputeNormalMatrices(const glm::mat4* model, glm::mat3* out, size_t count) {
+  ComputeNormalMatrices(GetBestKernel(), model, out, count);
+}
+
+void MatrixBatch::ComposeTransforms(Kernel kernel,
+                                    const glm::vec3* position,
+                                    const glm::vec3* rotation,
+                                    const glm::vec3* scale,
+                                    glm::mat4* out,
+                                    size_t count) {
+  switch (std::min(kernel, GetBestKernel())) {
+#ifdef MATRIX_BATCH_X86
+    case KERNEL_AVX2:
+      ComposeAVX2(position, rotation, scale, out, count);
+      break;
+    case KERNEL_SSE:
+      ComposeSSE(position, rotation, scale, out, count);
+      break;
+#endif
+    default:
+      ComposeScalar(position, rotation, scale, out, count);
+  }
+}
+
+void MatrixBatch::ComputeNormalMatrices(Kernel kernel, const glm::mat4* model, glm::mat3* out, size_t count) {
+  switch (std::min(kernel, GetBestKernel())) {
+#ifdef MATRIX_BATCH_X86
+    case KERNEL_AVX2:
+      NormalsAVX2(model, out, count);
+      break;
+    case KERNEL_SSE:
+      NormalsSSE(model, out, count);
+      break;
+#endif
+    default:
+      NormalsScalar(model, out, count);
+  }
+}
+
+}
+}
@@ -0,0 +1,108 @@
+#include <utils/SkylinePacker.hpp>
+
+#include <algorithm>
+
+namespace monkeysworld {
+namespace utils {
+
+SkylinePacker::SkylinePacker(glm::ivec2 size) : size_(size) {
+  Clear();
+}
+
+bool SkylinePacker::Insert(glm::ivec2 size, glm::ivec2* origin) {
+  if (size.x <= 0 || size.y <= 0) {
+    return false;
+  }
+
+  int best = -1;
+  int best_top = size_.y + 1;
+  int best_width = 0;
+  for (size_t i = 0; i < skyline_.size(); i++) {
+    int y = Fit(i, size);
+    if (y < 0) {
+      continue;
+    }
+
+    // lowest top edge wins, then the snuggest segment
+    int top = y + size.y;
+    if (top < best_top || (top == best_top && skyline_[i].width < best_width)) {
+      best = static_cast<int>(i);
+      best_top = top;
+      best_width = skyline_[i].width;
+    }
+  }
+
+  if (best < 0) {
+    return false;
+  }
+
+  origin->x = skyline_[best].x;
+  origin->y = best_top - size.y;
+
+  // raise the skyline under the new rectangle, then trim whatever it now covers
+  skyline_.insert(skyline_.begin() + best, { origin->x, best_top, size.x });
+  int right = origin->x + size.x;
+  size_t next = best + 1;
+  while (next < skyline_.size() && skyline_[next].x < right) {
+    segment& s = skyline_[next];
+    int overlap = right - s.x;
+    if (overlap >= s.width) {
+      skyline_.erase(skyline_.begin() + next);
+    } else {
+      s.x += overlap;
+      s.width -= overlap;
+      break;
+    }
+  }
+
+  // merge neighbors of the same height
+  for (size_t i = 0; i + 1 < skyline_.size();) {
+    if (skyline_[i].y == skyline_[i + 1].y) {
+      skyline_[i].width += skyline_[i + 1].width;
+      skyline_.erase(skyline_.begin() + i + 1);
+    } else {
+      i++;
+    }
+  }
+
+  used_ += static_cast<uint64_t>(size.x) * static_cast<uint64_t>(size.y);
+  return true;
+}
+
+void SkylinePacker::Clear() {
+  skyline_.clear();
+  skyline_.push_back({ 0, 0, size_.x });
+  used_ = 0;
+}
+
+glm::ivec2 SkylinePacker::GetSize() const {
+  return size_;
+}
+
+uint64_t SkylinePacker::GetUsedArea() const {
+  return used_;
+}
+
+int SkylinePacker::Fit(size_t index, glm::ivec2 size) const {
+  int x = skyline_[index].x;
+  if (x + size.x > size_.x) {
+    return -1;
+  }
+
+  // the rectangle rests on the highest segment it spans
+  int y = 0;
+  int remaining = size.x;
+  for (size_t i = index; remaining > 0; i++) {
+    y = std::max(y, skyline_[i].y);
+    if (y + size.y > size_.y) {
+      return -1;
+    }
+
+    remaining -= skyline_[i].width;
+  }
+
+  return y;
+}
+
+}
+}
@@ -0,0 +1,31 @@
+#ifndef ALLOCATION_COUNTER_H_
+#define ALLOCATION_COUNTER_H_
+
+// replaces the global operator new, so that tests and benchmarks can check what a piece of code
+// allocates. replacements can't be inline -- include this from exactly one file per executable.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// counts every allocation made through operator new, from any thread
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+  allocations++;
+  if (void* res = std::malloc(size > 0 ? size : 1)) {
+    return res;
+  }
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+  std::free(ptr);
+}
+
+#endif  // ALLOCATION_COUNTER_H_
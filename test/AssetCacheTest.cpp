@@ -0,0 +1,144 @@
+#include <file/AssetCache.hpp>
+#include <file/LoaderTelemetry.hpp>
+#include <file/ModelLoader.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TempDir.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using ::monkeysworld::file::AssetCache;
+using ::monkeysworld::file::cache_entry;
+using ::monkeysworld::file::cache_record;
+using ::monkeysworld::file::CacheType;
+using ::monkeysworld::file::LoaderTelemetry;
+using ::monkeysworld::file::LoaderThreadPool;
+using ::monkeysworld::file::ModelLoader;
+
+using ::testfiles::TempDir;
+
+static cache_entry<int> MakeEntry(int value) {
+  cache_entry<int> res;
+  res.value = value;
+  res.checked = 1;
+  return res;
+}
+
+TEST(AssetCacheTests, StoreAndFind) {
+  AssetCache<int> cache;
+  ASSERT_EQ(nullptr, cache.Find("a"));
+  auto a = cache.Store("a", MakeEntry(1), false);
+  ASSERT_EQ(a, cache.Find("a"));
+  ASSERT_EQ(1, a->value);
+  ASSERT_EQ(1, a->checked.load());
+
+  // without replace, the existing node wins
+  ASSERT_EQ(a, cache.Store("a", MakeEntry(2), false));
+  ASSERT_EQ(1, cache.Find("a")->value);
+
+  // replaced nodes stay readable
+  auto b = cache.Store("a", MakeEntry(3), true);
+  ASSERT_NE(a, b);
+  ASSERT_EQ(3, cache.Find("a")->value);
+  ASSERT_EQ(1, a->value);
+
+  int count = 0;
+  cache.ForEach([&](const AssetCache<int>::node& n) {
+    count++;
+    ASSERT_EQ("a", n.path);
+  });
+
+  ASSERT_EQ(1, count);
+}
+
+TEST(AssetCacheTests, ReadersSurviveGrowth) {
+  AssetCache<int> cache(16);
+  const int COUNT = 5000;
+  cache.Store("0", MakeEntry(0), false);
+  std::atomic<bool> done(false);
+  std::atomic<int> bad_reads(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.push_back(std::thread([&] {
+      while (!done.load()) {
+        auto n = cache.Find("0");
+        if (n == nullptr || n->value != 0) {
+          bad_reads++;
+        }
+      }
+    }));
+  }
+
+  for (int i = 1; i < COUNT; i++) {
+    cache.Store(std::to_string(i), MakeEntry(i), false);
+  }
+
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  ASSERT_EQ(0, bad_reads.load());
+  for (int i = 0; i < COUNT; i++) {
+    auto n = cache.Find(std::to_string(i));
+    ASSERT_NE(nullptr, n);
+    ASSERT_EQ(i, n->value);
+  }
+}
+
+TEST(AssetCacheTests, ConcurrentMissesBuildOnce) {
+  TempDir dir;
+  std::string path = dir.Get("asset-cache-shared.obj");
+  {
+    std::ofstream output(path);
+    output << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+  }
+
+  auto telemetry = std::make_shared<LoaderTelemetry>();
+  auto threadpool = std::make_shared<LoaderThreadPool>(2);
+  ModelLoader loader(threadpool, std::vector<cache_record>(), nullptr, telemetry, dir.Get(""));
+  std::vector<std::thread> threads;
+  std::vector<decltype(loader.LoadFile(path))> results(8);
+  for (int i = 0; i < 8; i++) {
+    threads.push_back(std::thread([&, i] {
+      results[i] = loader.LoadFile(path);
+    }));
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_NE(nullptr, results[0]);
+  for (auto& result : results) {
+    ASSERT_EQ(results[0], result);
+  }
+
+  // only one of them did the work
+  ASSERT_EQ(1, telemetry->GetSnapshot().loaders[CacheType::MODEL].assets);
+}
+
+TEST(AssetCacheTests, FailedLoadsDontBlockWaiters) {
+  auto threadpool = std::make_shared<LoaderThreadPool>(2);
+  ModelLoader loader(threadpool, std::vector<cache_record>());
+  std::vector<std::thread> threads;
+  std::atomic<int> misses(0);
+  for (int i = 0; i < 4; i++) {
+    threads.push_back(std::thread([&] {
+      if (loader.LoadFile("resources/test/asset-cache-missing.obj") == nullptr) {
+        misses++;
+      }
+    }));
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(4, misses.load());
+}
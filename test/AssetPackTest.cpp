@@ -0,0 +1,190 @@
+#include <file/AssetPack.hpp>
+#include <file/CachedFileLoader.hpp>
+#include <file/FileLoader.hpp>
+#include <file/ModelLoader.hpp>
+#include <shader/Texture.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TempDir.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using ::monkeysworld::file::AssetPack;
+using ::monkeysworld::file::CachedFileLoader;
+using ::monkeysworld::file::CacheType;
+using ::monkeysworld::file::cache_record;
+using ::monkeysworld::file::FileLoader;
+using ::monkeysworld::file::LoaderThreadPool;
+using ::monkeysworld::file::ModelLoader;
+using ::monkeysworld::file::WriteAssetPack;
+using ::monkeysworld::shader::Texture;
+using ::monkeysworld::storage::VertexPacket3D;
+using ::testfiles::TempDir;
+
+static std::string ReadWholeFile(const std::string& path) {
+  std::ifstream input(path, std::ios_base::in | std::ios_base::binary);
+  return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+static std::string ReadWholeStream(std::streambuf* buf) {
+  std::istream input(buf);
+  return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+static void WriteWholeFile(const std::string& path, const std::string& contents) {
+  std::ofstream output(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  output.write(contents.data(), contents.size());
+}
+
+static cache_record Record(CacheType type, const std::string& path) {
+  cache_record res;
+  res.type = type;
+  res.path = path;
+  res.file_size = 0;
+  return res;
+}
+
+TEST(AssetPackTests, RoundTrip) {
+  TempDir dir;
+  std::string pack_path = dir.Get("test-roundtrip.pack");
+  std::vector<cache_record> records = {
+    Record(CacheType::FILE, "resources/themoney.txt"),
+    Record(CacheType::MODEL, "resources/test/CUBE.obj"),
+    Record(CacheType::FILE, "resources/test/dummy-shader.vert"),
+    Record(CacheType::TEXTURE, "resources/test/texturetest.png"),
+    // not packable -- skipped
+    Record(CacheType::FONT, "resources/8bitoperator_jve.ttf"),
+    // missing -- skipped
+    Record(CacheType::FILE, "resources/test/does-not-exist.txt")
+  };
+
+  ASSERT_TRUE(WriteAssetPack(pack_path, records, dir.Get("")));
+  auto pack = AssetPack::Open(pack_path);
+  ASSERT_NE(nullptr, pack);
+  ASSERT_EQ(4, pack->GetEntryCount());
+
+  uint64_t size;
+  auto data = pack->GetFile("resources/themoney.txt", &size);
+  ASSERT_NE(nullptr, data);
+  ASSERT_EQ(ReadWholeFile("resources/themoney.txt"), std::string(data.get(), size));
+
+  ASSERT_EQ(nullptr, pack->GetFile("resources/test/does-not-exist.txt", &size));
+  ASSERT_EQ(nullptr, pack->Find(CacheType::FONT, "resources/8bitoperator_jve.ttf"));
+  // right path, wrong type
+  ASSERT_EQ(nullptr, pack->Find(CacheType::TEXTURE, "resources/themoney.txt"));
+
+  auto tex = pack->GetTexture("resources/test/texturetest.png");
+  Texture expected_tex("resources/test/texturetest.png");
+  ASSERT_NE(nullptr, tex);
+  ASSERT_EQ(expected_tex.GetWidth(), tex->GetWidth());
+  ASSERT_EQ(expected_tex.GetHeight(), tex->GetHeight());
+  ASSERT_EQ(expected_tex.GetChannelCount(), tex->GetChannelCount());
+
+  auto mesh = pack->GetModel("resources/test/CUBE.obj", &size);
+  auto expected_mesh = ModelLoader::FromObjFile("resources/test/CUBE.obj", &size);
+  ASSERT_NE(nullptr, mesh);
+  ASSERT_EQ(expected_mesh->GetVertexCount(), mesh->GetVertexCount());
+  ASSERT_EQ(expected_mesh->GetIndexCount(), mesh->GetIndexCount());
+  ASSERT_EQ(0, std::memcmp(expected_mesh->GetVertexData(), mesh->GetVertexData(),
+                           sizeof(VertexPacket3D) * mesh->GetVertexCount()));
+  ASSERT_EQ(0, std::memcmp(expected_mesh->GetIndexData(), mesh->GetIndexData(),
+                           sizeof(unsigned int) * mesh->GetIndexCount()));
+}
+
+TEST(AssetPackTests, MalformedPackIsRejected) {
+  TempDir dir;
+  std::string pack_path = dir.Get("test-malformed.pack");
+  std::vector<cache_record> records = {
+    Record(CacheType::FILE, "resources/themoney.txt"),
+    Record(CacheType::FILE, "resources/test/dummy-shader.frag")
+  };
+
+  ASSERT_TRUE(WriteAssetPack(pack_path, records));
+  std::string contents = ReadWholeFile(pack_path);
+
+  // cut off the string table
+  WriteWholeFile(pack_path, contents.substr(0, contents.size() - 8));
+  ASSERT_EQ(nullptr, AssetPack::Open(pack_path));
+
+  std::string bad_magic = contents;
+  bad_magic[0] ^= 0xFF;
+  WriteWholeFile(pack_path, bad_magic);
+  ASSERT_EQ(nullptr, AssetPack::Open(pack_path));
+
+  WriteWholeFile(pack_path, "");
+  ASSERT_EQ(nullptr, AssetPack::Open(pack_path));
+
+  remove(pack_path.c_str());
+  ASSERT_EQ(nullptr, AssetPack::Open(pack_path));
+}
+
+TEST(AssetPackTests, FileLoaderReadsFromPack) {
+  TempDir dir;
+  std::string pack_path = dir.Get("test-fileloader.pack");
+  std::string source_path = dir.Get("packed-only.txt");
+  std::string contents = "this file only exists inside the pack";
+  WriteWholeFile(source_path, contents);
+
+  std::vector<cache_record> records = { Record(CacheType::FILE, source_path) };
+  // loaders track progress by size, so WaitUntilLoaded needs this to be accurate
+  records[0].file_size = contents.size();
+  ASSERT_TRUE(WriteAssetPack(pack_path, records));
+  remove(source_path.c_str());
+
+  auto threadpool = std::make_shared<LoaderThreadPool>(2);
+  auto pack = AssetPack::Open(pack_path);
+  ASSERT_NE(nullptr, pack);
+
+  {
+    // cached on construction
+    FileLoader loader(threadpool, records, pack);
+    loader.WaitUntilLoaded();
+    auto buf = loader.LoadFile(source_path);
+    ASSERT_EQ(contents, ReadWholeStream(&buf));
+  }
+
+  {
+    // loaded on demand
+    FileLoader loader(threadpool, std::vector<cache_record>(), pack);
+    auto buf = loader.LoadFile(source_path);
+    pack.reset();
+    // the stream keeps the mapping alive
+    ASSERT_EQ(contents, ReadWholeStream(&buf));
+  }
+}
+
+TEST(AssetPackTests, ArchiveModeWritesPack) {
+  TempDir dir;
+  remove("resources/cache/packcache.cache");
+  remove("resources/cache/packcache.pack");
+  std::string source_path = dir.Get("archive-only.txt");
+  std::string contents = "served from the archive";
+  WriteWholeFile(source_path, contents);
+
+  {
+    CachedFileLoader loader("packcache", true);
+    auto buf = loader.LoadFile(source_path);
+    ASSERT_EQ(contents, ReadWholeStream(&buf));
+  }
+
+  auto pack = AssetPack::Open("resources/cache/packcache.pack");
+  ASSERT_NE(nullptr, pack);
+  ASSERT_NE(nullptr, pack->Find(CacheType::FILE, source_path));
+  pack.reset();
+
+  remove(source_path.c_str());
+  {
+    CachedFileLoader loader("packcache", true);
+    auto buf = loader.LoadFile(source_path);
+    ASSERT_EQ(contents, ReadWholeStream(&buf));
+  }
+
+  remove("resources/cache/packcache.cache");
+  remove("resources/cache/packcache.pack");
+}
@@ -0,0 +1,307 @@
+#include <utils/BoundingVolumeTree.hpp>
+#include <critter/Empty.hpp>
+#include <critter/TransformHierarchy.hpp>
+#include <input/Cursor.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TestScene.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::GameObject;
+using ::monkeysworld::critter::TransformHierarchy;
+using ::monkeysworld::critter::camera_info;
+using ::monkeysworld::input::Cursor;
+using ::monkeysworld::utils::BoundingVolumeTree;
+using ::monkeysworld::utils::Frustum;
+using ::monkeysworld::utils::aabb;
+using ::monkeysworld::utils::bounding_sphere;
+using ::monkeysworld::utils::ray;
+using ::testscene::BoxEmpty;
+
+/**
+ *  Checks every query against testing each box in turn.
+ *  @param boxes - box for each payload. Empty boxes aren't in the tree.
+ */
+static void CheckQueries(const BoundingVolumeTree& tree, const std::vector<aabb>& boxes, std::mt19937& gen) {
+  std::uniform_real_distribution<float> pos(-60.0f, 60.0f);
+  std::uniform_real_distribution<float> size(1.0f, 30.0f);
+  for (int q = 0; q < 20; q++) {
+    glm::vec3 corner(pos(gen), pos(gen), pos(gen));
+    aabb query = { corner, corner + glm::vec3(size(gen), size(gen), size(gen)) };
+    bounding_sphere sphere = { glm::vec3(pos(gen), pos(gen), pos(gen)), size(gen) };
+    glm::mat4 view = glm::translate(glm::mat4(1.0), -corner);
+    Frustum frustum(glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 50.0f) * view);
+
+    std::vector<uint32_t> found_box, found_sphere, found_frustum;
+    tree.QueryBox(query, [&](uint32_t data) { found_box.push_back(data); return true; });
+    tree.QuerySphere(sphere, [&](uint32_t data) { found_sphere.push_back(data); return true; });
+    tree.QueryFrustum(frustum, [&](uint32_t data) { found_frustum.push_back(data); return true; });
+    std::sort(found_box.begin(), found_box.end());
+    std::sort(found_sphere.begin(), found_sphere.end());
+    std::sort(found_frustum.begin(), found_frustum.end());
+
+    std::vector<uint32_t> expected_box, expected_sphere, expected_frustum;
+    for (uint32_t i = 0; i < boxes.size(); i++) {
+      if (IsEmpty(boxes[i])) {
+        continue;
+      }
+
+      if (Overlaps(boxes[i], query)) {
+        expected_box.push_back(i);
+      }
+
+      if (Overlaps(boxes[i], sphere)) {
+        expected_sphere.push_back(i);
+      }
+
+      if (frustum.TestBox(boxes[i])) {
+        expected_frustum.push_back(i);
+      }
+    }
+
+    ASSERT_EQ(expected_box, found_box);
+    ASSERT_EQ(expected_sphere, found_sphere);
+    ASSERT_EQ(expected_frustum, found_frustum);
+
+    // nearest box along a ray
+    ray r = { glm::vec3(pos(gen), pos(gen), pos(gen)), glm::normalize(glm::vec3(pos(gen), pos(gen), pos(gen))) };
+    glm::vec3 inv_dir = glm::vec3(1.0f) / r.direction;
+    float expected_t = 1000.0f;
+    for (uint32_t i = 0; i < boxes.size(); i++) {
+      float t;
+      if (!IsEmpty(boxes[i]) && IntersectRay(boxes[i], r.origin, inv_dir, expected_t, &t)) {
+        expected_t = std::min(expected_t, t);
+      }
+    }
+
+    float nearest_t = 1000.0f;
+    tree.RayCast(r, 1000.0f, [&](uint32_t data, float t) {
+      nearest_t = std::min(nearest_t, t);
+      return nearest_t;
+    });
+
+    ASSERT_FLOAT_EQ(expected_t, nearest_t);
+  }
+}
+
+static aabb RandomBox(std::mt19937& gen, float range) {
+  std::uniform_real_distribution<float> pos(-range, range);
+  std::uniform_real_distribution<float> size(0.1f, 4.0f);
+  glm::vec3 corner(pos(gen), pos(gen), pos(gen));
+  return { corner, corner + glm::vec3(size(gen), size(gen), size(gen)) };
+}
+
+TEST(BoundingVolumeTreeTests, QueriesMatchBruteForce) {
+  std::mt19937 gen(1);
+  BoundingVolumeTree tree;
+  std::vector<aabb> boxes;
+  std::vector<int> proxies;
+
+  // one at a time, then a batch big enough to be placed by a rebuild
+  for (uint32_t i = 0; i < 300; i++) {
+    boxes.push_back(RandomBox(gen, 50.0f));
+    proxies.push_back(tree.CreateProxy(boxes.back(), i));
+  }
+
+  std::vector<uint32_t> data;
+  for (uint32_t i = 300; i < 1000; i++) {
+    boxes.push_back(RandomBox(gen, 50.0f));
+    data.push_back(i);
+  }
+
+  proxies.resize(boxes.size());
+  tree.CreateProxies(&boxes[300], data.data(), data.size(), &proxies[300]);
+  ASSERT_EQ(1000, tree.GetProxyCount());
+  for (uint32_t i = 0; i < boxes.size(); i++) {
+    ASSERT_EQ(i, tree.GetData(proxies[i]));
+  }
+
+  // balanced, give or take
+  ASSERT_LT(tree.GetHeight(), 30);
+  CheckQueries(tree, boxes, gen);
+
+  // small nudges, which are absorbed or refit
+  std::uniform_real_distribution<float> nudge(-0.3f, 0.3f);
+  for (int step = 0; step < 10; step++) {
+    for (size_t i = 0; i < boxes.size(); i += 7) {
+      glm::vec3 d(nudge(gen), nudge(gen), nudge(gen));
+      boxes[i] = { boxes[i].min + d, boxes[i].max + d };
+      tree.MoveProxy(proxies[i], boxes[i]);
+    }
+  }
+
+  CheckQueries(tree, boxes, gen);
+
+  // teleports, which are reinserted
+  for (size_t i = 0; i < 100; i++) {
+    boxes[i] = RandomBox(gen, 50.0f);
+    tree.MoveProxy(proxies[i], boxes[i]);
+  }
+
+  CheckQueries(tree, boxes, gen);
+
+  // most of them at once
+  std::vector<BoundingVolumeTree::proxy_move> moves;
+  for (size_t i = 0; i < boxes.size(); i += 2) {
+    boxes[i] = RandomBox(gen, 50.0f);
+    moves.push_back({ proxies[i], boxes[i] });
+  }
+
+  tree.MoveProxies(moves.data(), moves.size());
+  ASSERT_LT(tree.GetHeight(), 30);
+  CheckQueries(tree, boxes, gen);
+
+  // destroyed proxies aren't reported, and their ids are handed out again
+  for (size_t i = 0; i < boxes.size(); i += 3) {
+    tree.DestroyProxy(proxies[i]);
+    boxes[i] = ::monkeysworld::utils::EmptyBounds();
+  }
+
+  CheckQueries(tree, boxes, gen);
+  boxes[0] = RandomBox(gen, 50.0f);
+  int reused = tree.CreateProxy(boxes[0], 0);
+  ASSERT_EQ(boxes[0].min, tree.GetBounds(reused).min);
+  CheckQueries(tree, boxes, gen);
+}
+
+TEST(BoundingVolumeTreeTests, StopsEarly) {
+  std::mt19937 gen(2);
+  BoundingVolumeTree tree;
+  for (uint32_t i = 0; i < 100; i++) {
+    tree.CreateProxy(RandomBox(gen, 5.0f), i);
+  }
+
+  int found = 0;
+  tree.QueryBox({ glm::vec3(-10), glm::vec3(10) }, [&](uint32_t data) { return (++found < 3); });
+  ASSERT_EQ(3, found);
+
+  // everything is inside this frustum, so its whole tree is reported without testing
+  found = 0;
+  tree.QueryFrustum(Frustum(), [&](uint32_t data) { found++; return true; });
+  ASSERT_EQ(100, found);
+}
+
+TEST(BoundingVolumeTreeTests, RefitsDontDegradeForever) {
+  // boxes drifting apart a little at a time, so that every move is a refit
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<float> dir(-1.0f, 1.0f);
+  BoundingVolumeTree tree;
+  std::vector<aabb> boxes;
+  std::vector<glm::vec3> velocity;
+  std::vector<int> proxies;
+  for (uint32_t i = 0; i < 2000; i++) {
+    boxes.push_back(RandomBox(gen, 10.0f));
+    velocity.push_back(glm::vec3(dir(gen), dir(gen), dir(gen)) * 0.3f);
+  }
+
+  std::vector<uint32_t> data(boxes.size());
+  for (uint32_t i = 0; i < data.size(); i++) {
+    data[i] = i;
+  }
+
+  proxies.resize(boxes.size());
+  tree.CreateProxies(boxes.data(), data.data(), boxes.size(), proxies.data());
+  float initial_cost = tree.GetCost();
+  for (int step = 0; step < 200; step++) {
+    // a sixth of the boxes move each step, which is below the batch rebuild threshold
+    for (size_t i = step % 6; i < boxes.size(); i += 6) {
+      boxes[i] = { boxes[i].min + velocity[i], boxes[i].max + velocity[i] };
+      tree.MoveProxy(proxies[i], boxes[i]);
+    }
+  }
+
+  // the world has grown a lot wider, but the tree has been rebuilt to keep up
+  ASSERT_LT(tree.GetCost(), initial_cost * 2.0f);
+  CheckQueries(tree, boxes, gen);
+}
+
+TEST(BoundingVolumeTreeTests, HierarchyIndexFollowsObjects) {
+  testscene::QuietLogs();
+  auto root = std::make_shared<Empty>(nullptr);
+  std::vector<std::shared_ptr<BoxEmpty>> boxes;
+  for (int i = 0; i < 5; i++) {
+    auto box = std::make_shared<BoxEmpty>(aabb { glm::vec3(-0.5f), glm::vec3(0.5f) });
+    box->SetPosition(glm::vec3(i * 10.0f, 0, 0));
+    root->AddChild(box);
+    boxes.push_back(box);
+  }
+
+  auto transforms = root->GetTransformHierarchy();
+  auto FindNear = [&](const glm::vec3& point) {
+    std::vector<GameObject*> res;
+    transforms->GetSpatialIndex().QuerySphere({ point, 1.0f }, [&](uint32_t node) {
+      res.push_back(transforms->GetOwner(node));
+      return true;
+    });
+
+    return res;
+  };
+
+  // empties bound nothing, so only the boxes are found
+  ASSERT_EQ(std::vector<GameObject*> { boxes[2].get() }, FindNear(glm::vec3(20, 0, 0)));
+  boxes[2]->SetPosition(glm::vec3(20, 30, 0));
+  ASSERT_TRUE(FindNear(glm::vec3(20, 0, 0)).empty());
+  ASSERT_EQ(std::vector<GameObject*> { boxes[2].get() }, FindNear(glm::vec3(20, 30, 0)));
+
+  // moving the parent moves everything beneath it
+  root->SetPosition(glm::vec3(0, 0, -100));
+  ASSERT_TRUE(FindNear(glm::vec3(10, 0, 0)).empty());
+  ASSERT_EQ(std::vector<GameObject*> { boxes[1].get() }, FindNear(glm::vec3(10, 0, -100)));
+
+  // destroyed objects leave the index
+  GameObject* dropped = boxes[4].get();
+  boxes.pop_back();
+  root = nullptr;
+  for (auto owner : FindNear(glm::vec3(40, 0, -100))) {
+    ASSERT_NE(dropped, owner);
+  }
+}
+
+TEST(BoundingVolumeTreeTests, PicksNearestUnderCursor) {
+  testscene::QuietLogs();
+  auto root = std::make_shared<Empty>(nullptr);
+  auto near_box = std::make_shared<BoxEmpty>(aabb { glm::vec3(-1), glm::vec3(1) });
+  auto far_box = std::make_shared<BoxEmpty>(aabb { glm::vec3(-1), glm::vec3(1) });
+  auto side_box = std::make_shared<BoxEmpty>(aabb { glm::vec3(-1), glm::vec3(1) });
+  near_box->SetPosition(glm::vec3(0, 0, -10));
+  far_box->SetPosition(glm::vec3(0, 0, -20));
+  side_box->SetPosition(glm::vec3(8, 0, -20));
+  root->AddChild(far_box);
+  root->AddChild(near_box);
+  root->AddChild(side_box);
+
+  // a camera at the origin, looking down -z
+  camera_info camera;
+  camera.position = glm::vec3(0);
+  camera.view_matrix = glm::mat4(1.0);
+  camera.persp_matrix = glm::perspective(glm::radians(45.0f), 2.0f, 0.1f, 100.0f);
+  camera.vp_matrix = camera.persp_matrix;
+
+  ray center = Cursor::GetPickRay(camera, glm::dvec2(400, 200), glm::ivec2(800, 400));
+  ASSERT_NEAR(0.0f, glm::length(center.direction - glm::vec3(0, 0, -1)), 1e-4f);
+
+  float distance;
+  auto transforms = root->GetTransformHierarchy();
+  ASSERT_EQ(near_box.get(), transforms->RayCast(center, 100.0f, &distance));
+  // the ray starts on the near plane
+  ASSERT_NEAR(8.9f, distance, 1e-3f);
+
+  // towards the right of the screen
+  glm::vec4 clip = camera.vp_matrix * glm::vec4(8, 0, -20, 1);
+  double x = (clip.x / clip.w + 1.0) * 400.0;
+  ray right = Cursor::GetPickRay(camera, glm::dvec2(x, 200), glm::ivec2(800, 400));
+  ASSERT_EQ(side_box.get(), transforms->RayCast(right, 100.0f));
+
+  // up and away from everything
+  ray up = Cursor::GetPickRay(camera, glm::dvec2(400, 0), glm::ivec2(800, 400));
+  ASSERT_EQ(nullptr, transforms->RayCast(up, 100.0f));
+}
@@ -0,0 +1,97 @@
+#include <utils/CRC32.hpp>
+#include <utils/FileUtils.hpp>
+#include <gtest/gtest.h>
+
+#include "LegacyCRC.hpp"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using ::monkeysworld::utils::CRC32;
+using ::monkeysworld::utils::fileutils::CalculateCRCHash;
+
+static const size_t SIZES[] = { 0, 1, 3, 7, 8, 9, 15, 16, 17, 63, 64, 65, 127, 128, 129,
+                                255, 256, 257, 1000, 4096, 65535, 65536, 65537, 200003 };
+
+/**
+ *  @param allow_ff - if false, 0xFF bytes are left out, so the legacy hash reads the whole buffer.
+ */
+static std::vector<unsigned char> RandomBytes(size_t size, bool allow_ff, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<unsigned char> res(size);
+  for (auto& b : res) {
+    b = static_cast<unsigned char>(rng() % (allow_ff ? 256 : 255));
+  }
+
+  return res;
+}
+
+TEST(CRC32Tests, MatchesLegacyStreamHash) {
+  for (size_t size : SIZES) {
+    auto bytes = RandomBytes(size, false, static_cast<uint32_t>(size));
+    std::stringstream stream(std::string(bytes.begin(), bytes.end()));
+    for (std::streamoff offset : { 0, 1, 12 }) {
+      if (offset > static_cast<std::streamoff>(size)) {
+        continue;
+      }
+
+      ASSERT_EQ(legacycrc::CalculateCRCHash(stream, offset), CalculateCRCHash(stream, offset))
+        << "size " << size << ", offset " << offset;
+    }
+  }
+}
+
+TEST(CRC32Tests, StreamHashStopsAtFF) {
+  auto bytes = RandomBytes(100000, false, 1);
+  for (size_t pos : { size_t(0), size_t(5), size_t(70000) }) {
+    auto copy = bytes;
+    copy[pos] = 0xFF;
+    std::stringstream stream(std::string(copy.begin(), copy.end()));
+    ASSERT_EQ(legacycrc::CalculateCRCHash(stream, 0), CalculateCRCHash(stream, 0)) << "0xFF at " << pos;
+  }
+}
+
+TEST(CRC32Tests, StreamPositionIsRestored) {
+  std::stringstream stream("some cache data");
+  stream.seekg(4);
+  CalculateCRCHash(stream, 0);
+  ASSERT_EQ(4, stream.tellg());
+}
+
+TEST(CRC32Tests, KernelsMatchBitwise) {
+  for (size_t size : SIZES) {
+    // misalign the start to exercise unaligned loads
+    auto bytes = RandomBytes(size + 3, true, static_cast<uint32_t>(size) + 7);
+    const unsigned char* data = bytes.data() + 3;
+    uint32_t expected = legacycrc::BitwiseCRC(data, size);
+    ASSERT_EQ(expected, ~CRC32::UpdateSliceBy8(0xFFFFFFFF, data, size)) << "size " << size;
+    ASSERT_EQ(expected, CRC32::Calculate(data, size)) << "size " << size;
+    if (CRC32::HasCLMUL()) {
+      ASSERT_EQ(expected, ~CRC32::UpdateCLMUL(0xFFFFFFFF, data, size)) << "size " << size;
+    }
+  }
+}
+
+TEST(CRC32Tests, StreamingMatchesOneShot) {
+  auto bytes = RandomBytes(300000, true, 42);
+  uint32_t expected = CRC32::Calculate(bytes.data(), bytes.size());
+
+  std::mt19937 rng(1234);
+  CRC32 crc;
+  size_t pos = 0;
+  while (pos < bytes.size()) {
+    // mix of tiny and large chunks, so that both kernels run
+    size_t chunk = (rng() % 2) ? rng() % 32 : rng() % 20000;
+    chunk = std::min(chunk, bytes.size() - pos);
+    crc.Update(bytes.data() + pos, chunk);
+    pos += chunk;
+  }
+
+  ASSERT_EQ(expected, crc.GetHash());
+
+  crc.Reset();
+  ASSERT_EQ(CRC32::Calculate(nullptr, 0), crc.GetHash());
+}
@@ -2,12 +2,16 @@
 
 #include <gtest/gtest.h>
 
+#include "TempDir.hpp"
+
 #include <fstream>
 #include <iostream>
 #include <thread>
 
 using ::monkeysworld::file::CachedFileLoader;
 
+using ::testfiles::TempDir;
+
 TEST(CacheTests, CreateEmptyCache) {
   remove("resources/cache/testcache.cache");
   CachedFileLoader loader("testcache");
@@ -58,4 +62,44 @@ TEST(CacheTests, QuickCubeMapTest) {
   auto res = loader.LoadCubeMap(s, s, s, s, s, s);
   ASSERT_LT((100 * 100 * 24), res->GetCubeMapSize());
   remove("resources/cache/coolcache.cache");
-}
\ No newline at end of file
+}
+
+TEST(CacheTests, StreamLargeFile) {
+  TempDir dir;
+  remove("resources/cache/largecache.cache");
+  const std::string path = dir.Get("large-file.bin");
+  std::string contents(600 * 1024, '\0');
+  for (size_t i = 0; i < contents.size(); i++) {
+    contents[i] = (char)((i * 31) & 0xFF);
+  }
+
+  {
+    std::ofstream output(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    output.write(contents.data(), contents.size());
+  }
+
+  {
+    CachedFileLoader loader("largecache");
+    // large enough to be mapped -- both loads read from the same mapping
+    auto first = loader.LoadFile(path);
+    auto second = loader.LoadFile(path);
+    std::istream first_stream(&first);
+    std::istream second_stream(&second);
+
+    first_stream.seekg(0, std::ios_base::end);
+    ASSERT_EQ(contents.size(), first_stream.tellg());
+    first_stream.seekg(0, std::ios_base::beg);
+
+    std::string actual(contents.size(), '\0');
+    first_stream.read(&actual[0], actual.size());
+    ASSERT_EQ(contents, actual);
+
+    for (size_t i = 0; i < contents.size(); i++) {
+      ASSERT_EQ(contents[i], (char)second_stream.get());
+    }
+
+    ASSERT_EQ(EOF, second_stream.get());
+  }
+
+  remove("resources/cache/largecache.cache");
+}
@@ -1,11 +1,27 @@
 #include <file/CacheStreambuf.hpp>
+#include <file/MappedFile.hpp>
 
 #include <gtest/gtest.h>
 
+#include "TempDir.hpp"
+
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <memory>
 
 using ::monkeysworld::file::CacheStreambuf;
+using ::monkeysworld::file::MappedFile;
+
+using ::testfiles::TempDir;
+
+// writes a file of `size` bytes, where byte i is (i * 7) & 0xFF
+static void WritePatternFile(const std::string& path, int size) {
+  std::ofstream output(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  for (int i = 0; i < size; i++) {
+    output.put((char)((i * 7) & 0xFF));
+  }
+}
 
 TEST(StreambufTests, CreateStreambufFromArbVector) {
   std::shared_ptr<std::vector<char>> data = std::make_shared<std::vector<char>>();
@@ -21,6 +37,24 @@ TEST(StreambufTests, CreateStreambufFromArbVector) {
   ASSERT_EQ((char)EOF, (char)test_buf.sbumpc());
 }
 
+TEST(StreambufTests, EmptyFileReadsAsEOF) {
+  // an empty vector has no data pointer, but the streambuf is still valid
+  CacheStreambuf test_buf(std::make_shared<std::vector<char>>());
+  std::istream test_stream(&test_buf);
+  ASSERT_EQ(EOF, test_stream.get());
+  ASSERT_TRUE(test_stream.eof());
+  ASSERT_FALSE(test_stream.bad());
+
+  test_stream.clear();
+  test_stream.seekg(0, std::ios_base::end);
+  ASSERT_EQ(0, test_stream.tellg());
+  char data[16];
+  test_stream.seekg(0, std::ios_base::beg);
+  test_stream.read(data, 16);
+  ASSERT_EQ(0, test_stream.gcount());
+  ASSERT_FALSE(test_stream.bad());
+}
+
 TEST(StreambufTests, AttemptWrite) {
   std::shared_ptr<std::vector<char>> data = std::make_shared<std::vector<char>>();
   for (int i = 0; i < 1024; i++) {
@@ -101,4 +135,88 @@ TEST(StreambufTests, VerifyIstreamBehavior) {
   std::istream bad_i(&bad_streambuf);
   bad_i.get();
   ASSERT_FALSE(bad_i.good());
-}
\ No newline at end of file
+}
+
+TEST(StreambufTests, MappedChunksReadInOrder) {
+  TempDir dir;
+  const std::string path = dir.Get("streambuf-mapped.bin");
+  WritePatternFile(path, 1000);
+  {
+    auto file = std::make_shared<const MappedFile>(path);
+    // chunks don't line up with the file size, so the last one is short
+    CacheStreambuf test_buf(file, 64);
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_EQ((char)((i * 7) & 0xFF), (char)test_buf.sbumpc());
+    }
+
+    ASSERT_EQ(EOF, test_buf.sbumpc());
+  }
+}
+
+TEST(StreambufTests, MappedIstreamBehavior) {
+  TempDir dir;
+  const std::string path = dir.Get("streambuf-mapped.bin");
+  WritePatternFile(path, 1000);
+  {
+    auto file = std::make_shared<const MappedFile>(path);
+    CacheStreambuf test_buf(file, 64);
+    std::istream test_stream(&test_buf);
+
+    // reads which span several chunks
+    char data_actual[1000];
+    test_stream.read(data_actual, 300);
+    ASSERT_EQ(300, test_stream.gcount());
+    for (int i = 0; i < 300; i++) {
+      ASSERT_EQ((char)((i * 7) & 0xFF), data_actual[i]);
+    }
+
+    test_stream.seekg(500, std::ios_base::cur);
+    ASSERT_EQ(800, test_stream.tellg());
+    ASSERT_EQ((char)((800 * 7) & 0xFF), (char)test_stream.get());
+    test_stream.unget();
+    ASSERT_EQ((char)((800 * 7) & 0xFF), (char)test_stream.get());
+
+    test_stream.seekg(0, std::ios_base::end);
+    ASSERT_EQ(1000, test_stream.tellg());
+    test_stream.seekg(0, std::ios_base::beg);
+    test_stream.read(data_actual, 1000);
+    ASSERT_EQ(1000, test_stream.gcount());
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_EQ((char)((i * 7) & 0xFF), data_actual[i]);
+    }
+
+    ASSERT_EQ(EOF, test_stream.get());
+    ASSERT_TRUE(test_stream.eof());
+
+    // out of range seeks fail, rather than moving past the mapping
+    test_stream.clear();
+    test_stream.seekg(2000, std::ios_base::beg);
+    ASSERT_TRUE(test_stream.fail());
+  }
+}
+
+TEST(StreambufTests, MappedStreambufsShareMapping) {
+  TempDir dir;
+  const std::string path = dir.Get("streambuf-mapped.bin");
+  WritePatternFile(path, 1000);
+  {
+    CacheStreambuf first;
+    CacheStreambuf second;
+    {
+      auto file = std::make_shared<const MappedFile>(path);
+      first = CacheStreambuf(file, 128);
+      second = first;
+    }
+
+    // readers keep the mapping alive, and don't affect one another's position
+    for (int i = 0; i < 500; i++) {
+      ASSERT_EQ((char)((i * 7) & 0xFF), (char)first.sbumpc());
+    }
+
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_EQ((char)((i * 7) & 0xFF), (char)second.sbumpc());
+    }
+
+    ASSERT_EQ((char)((500 * 7) & 0xFF), (char)first.sbumpc());
+  }
+}
@@ -0,0 +1,226 @@
+#include <file/AssetPack.hpp>
+#include <file/AssetStamp.hpp>
+#include <file/CachedFileLoader.hpp>
+#include <file/FileLoader.hpp>
+#include <file/ModelLoader.hpp>
+#include <utils/CRC32.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TempDir.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using ::monkeysworld::file::AssetPack;
+using ::monkeysworld::file::asset_stamp;
+using ::monkeysworld::file::CachedFileLoader;
+using ::monkeysworld::file::CacheType;
+using ::monkeysworld::file::cache_record;
+using ::monkeysworld::file::CheckAssetStamp;
+using ::monkeysworld::file::FileLoader;
+using ::monkeysworld::file::LoaderThreadPool;
+using ::monkeysworld::file::ModelLoader;
+using ::monkeysworld::file::StampResult;
+using ::monkeysworld::file::UpdateAssetStamp;
+using ::monkeysworld::utils::CRC32;
+
+using ::testfiles::TempDir;
+
+namespace fs = std::filesystem;
+
+static std::string ReadWholeStream(std::streambuf* buf) {
+  std::istream input(buf);
+  return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+static void WriteWholeFile(const std::string& path, const std::string& contents) {
+  std::ofstream output(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  output.write(contents.data(), contents.size());
+}
+
+/**
+ *  Moves a file's mtime forward, so that edits register even if they land within the same tick.
+ */
+static void Touch(const std::string& path, int seconds) {
+  fs::last_write_time(path, fs::last_write_time(path) + std::chrono::seconds(seconds));
+}
+
+static const char* TRIANGLE_OBJ = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+// same size as TRIANGLE_OBJ, different geometry
+static const char* TRIANGLE_OBJ_EDITED = "v 0 0 0\nv 2 0 0\nv 0 2 0\nf 1 2 3\n";
+
+TEST(CacheValidationTests, TouchedButUnchangedIsCurrent) {
+  TempDir dir;
+  std::string path = dir.Get("stamp-touched.txt");
+  WriteWholeFile(path, "unchanged contents");
+  asset_stamp stamp;
+  ASSERT_TRUE(UpdateAssetStamp(path, &stamp));
+  ASSERT_EQ(CRC32::Calculate("unchanged contents", 18), stamp.content_hash);
+
+  int64_t old_mtime = stamp.mtime;
+  Touch(path, 5);
+  ASSERT_EQ(StampResult::STAMP_CURRENT, CheckAssetStamp(path, &stamp));
+  // picks up the new mtime, so the next check is just a stat
+  ASSERT_NE(old_mtime, stamp.mtime);
+
+  remove(path.c_str());
+  ASSERT_EQ(StampResult::STAMP_MISSING, CheckAssetStamp(path, &stamp));
+}
+
+TEST(CacheValidationTests, SameSizeEditIsDetected) {
+  TempDir dir;
+  std::string path = dir.Get("stamp-edited.txt");
+  WriteWholeFile(path, "aaaa");
+  asset_stamp stamp;
+  ASSERT_TRUE(UpdateAssetStamp(path, &stamp));
+
+  WriteWholeFile(path, "bbbb");
+  Touch(path, 5);
+  ASSERT_EQ(StampResult::STAMP_CHANGED, CheckAssetStamp(path, &stamp));
+  ASSERT_EQ(CRC32::Calculate("bbbb", 4), stamp.content_hash);
+}
+
+TEST(CacheValidationTests, CubeMapPathsAreStampedPerFace) {
+  TempDir dir;
+  // cubemap paths are split on ':', so the faces are named relative to the working directory
+  std::string face_a = fs::relative(dir.Get("stamp-face-a.txt")).generic_string();
+  std::string face_b = fs::relative(dir.Get("stamp-face-b.txt")).generic_string();
+  WriteWholeFile(face_a, "face a");
+  WriteWholeFile(face_b, "face b");
+  std::string path = ":" + face_a + ":" + face_b + ":" + face_a + ":" + face_b + ":" + face_a + ":" + face_b;
+
+  asset_stamp stamp;
+  ASSERT_TRUE(UpdateAssetStamp(path, &stamp));
+  ASSERT_EQ(36, stamp.source_size);
+
+  WriteWholeFile(face_b, "face c");
+  Touch(face_b, 5);
+  ASSERT_EQ(StampResult::STAMP_CHANGED, CheckAssetStamp(path, &stamp));
+
+  remove(face_a.c_str());
+  ASSERT_EQ(StampResult::STAMP_MISSING, CheckAssetStamp(path, &stamp));
+}
+
+TEST(CacheValidationTests, RevalidationRebuildsOnlyChangedEntries) {
+  TempDir dir;
+  std::string changed_path = dir.Get("stamp-changed.obj");
+  std::string unchanged_path = dir.Get("stamp-unchanged.obj");
+  WriteWholeFile(changed_path, TRIANGLE_OBJ);
+  WriteWholeFile(unchanged_path, TRIANGLE_OBJ);
+
+  auto threadpool = std::make_shared<LoaderThreadPool>(2);
+  ModelLoader loader(threadpool, std::vector<cache_record>(), nullptr, nullptr, dir.Get(""));
+  auto changed = loader.LoadFile(changed_path);
+  auto unchanged = loader.LoadFile(unchanged_path);
+  ASSERT_NE(nullptr, changed);
+  ASSERT_NE(nullptr, unchanged);
+
+  WriteWholeFile(changed_path, TRIANGLE_OBJ_EDITED);
+  Touch(changed_path, 5);
+  Touch(unchanged_path, 5);
+
+  // nothing is checked until revalidation is requested
+  ASSERT_EQ(changed, loader.LoadFile(changed_path));
+
+  loader.RequestRevalidation();
+  auto changed_after = loader.LoadFile(changed_path);
+  ASSERT_NE(nullptr, changed_after);
+  ASSERT_NE(changed, changed_after);
+  ASSERT_EQ(2.0f, changed_after->GetVertexData()[1].position.x);
+  // touched, but the contents match -- served from the cache as-is
+  ASSERT_EQ(unchanged, loader.LoadFile(unchanged_path));
+  // and the rebuilt entry stays put
+  ASSERT_EQ(changed_after, loader.LoadFile(changed_path));
+}
+
+TEST(CacheValidationTests, MappedFilesAreHashedForTheCache) {
+  TempDir dir;
+  std::string path = dir.Get("stamp-mapped.bin");
+  // large enough to be mapped rather than read
+  std::string contents(512 * 1024, 'm');
+  WriteWholeFile(path, contents);
+
+  auto threadpool = std::make_shared<LoaderThreadPool>(1);
+  FileLoader loader(threadpool, std::vector<cache_record>());
+  auto buf = loader.LoadFile(path);
+  ASSERT_EQ(contents, ReadWholeStream(&buf));
+
+  // the hash is left to the pool, but it's in place by the time the cache is written
+  auto records = loader.GetCache();
+  ASSERT_EQ(1, records.size());
+  ASSERT_EQ(CRC32::Calculate(contents.data(), contents.size()), records[0].stamp.content_hash);
+  ASSERT_EQ(contents.size(), records[0].stamp.source_size);
+}
+
+TEST(CacheValidationTests, WarmStartPicksUpEdits) {
+  TempDir dir;
+  remove("resources/cache/stampcache.cache");
+  std::string path = dir.Get("stamp-warm.txt");
+  WriteWholeFile(path, "first version");
+
+  {
+    CachedFileLoader loader("stampcache");
+    auto buf = loader.LoadFile(path);
+    ASSERT_EQ("first version", ReadWholeStream(&buf));
+  }
+
+  auto records = CachedFileLoader::ReadCacheFileToVector("resources/cache/stampcache.cache");
+  ASSERT_EQ(1, records.size());
+  ASSERT_EQ(CRC32::Calculate("first version", 13), records[0].stamp.content_hash);
+  ASSERT_EQ(13, records[0].stamp.source_size);
+
+  WriteWholeFile(path, "other version");
+  Touch(path, 5);
+  {
+    CachedFileLoader loader("stampcache");
+    auto buf = loader.LoadFile(path);
+    ASSERT_EQ("other version", ReadWholeStream(&buf));
+  }
+
+  records = CachedFileLoader::ReadCacheFileToVector("resources/cache/stampcache.cache");
+  ASSERT_EQ(1, records.size());
+  ASSERT_EQ(CRC32::Calculate("other version", 13), records[0].stamp.content_hash);
+
+  remove("resources/cache/stampcache.cache");
+}
+
+TEST(CacheValidationTests, StalePackEntryIsRebuilt) {
+  TempDir dir;
+  remove("resources/cache/stamppack.cache");
+  remove("resources/cache/stamppack.pack");
+  std::string path = dir.Get("stamp-packed.txt");
+  WriteWholeFile(path, "packed version");
+
+  {
+    CachedFileLoader loader("stamppack", true);
+    auto buf = loader.LoadFile(path);
+    ASSERT_EQ("packed version", ReadWholeStream(&buf));
+  }
+
+  WriteWholeFile(path, "edited version");
+  Touch(path, 5);
+  {
+    // the pack copy is served on startup, then checked against the source when first loaded
+    CachedFileLoader loader("stamppack", true);
+    auto buf = loader.LoadFile(path);
+    ASSERT_EQ("edited version", ReadWholeStream(&buf));
+  }
+
+  // and the pack is rewritten with the new contents
+  auto pack = AssetPack::Open("resources/cache/stamppack.pack");
+  ASSERT_NE(nullptr, pack);
+  uint64_t size;
+  auto data = pack->GetFile(path, &size);
+  ASSERT_NE(nullptr, data);
+  ASSERT_EQ("edited version", std::string(data.get(), size));
+  pack.reset();
+
+  remove("resources/cache/stamppack.cache");
+  remove("resources/cache/stamppack.pack");
+}
@@ -0,0 +1,335 @@
+#include <engine/FramePipeline.hpp>
+#include <engine/RecordingRenderBackend.hpp>
+#include <engine/EngineWindow.hpp>
+#include <critter/Empty.hpp>
+#include <critter/visitor/FrameVisitor.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TestScene.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::ui::UIObject;
+using ::monkeysworld::critter::visitor::FrameVisitor;
+using ::monkeysworld::engine::CALL_BEGIN_FRAME;
+using ::monkeysworld::engine::CALL_DRAW_OBJECT;
+using ::monkeysworld::engine::CALL_DRAW_UI;
+using ::monkeysworld::engine::CALL_END_FRAME;
+using ::monkeysworld::engine::CALL_UPDATE_UI;
+using ::monkeysworld::engine::EngineWindow;
+using ::monkeysworld::engine::FramePipeline;
+using ::monkeysworld::engine::RecordingRenderBackend;
+using ::monkeysworld::engine::frame_snapshot;
+using ::monkeysworld::engine::recorded_call;
+using ::monkeysworld::shader::Canvas;
+
+/**
+ *  Empty which moves one unit along x every update.
+ */
+class MovingEmpty : public Empty {
+ public:
+  MovingEmpty(uint64_t id) : Empty(nullptr) {
+    SetId(id);
+  }
+
+  void Update() override {
+    SetPosition(GetPosition() + glm::vec3(1, 0, 0));
+  }
+
+  // RemoveChild is normally only for subclasses
+  using GameObject::RemoveChild;
+};
+
+/**
+ *  Empty which notes the thread it was destroyed on.
+ */
+class WatchedEmpty : public Empty {
+ public:
+  WatchedEmpty(std::thread::id* destroyed_on) : Empty(nullptr), destroyed_on_(destroyed_on) {}
+
+  ~WatchedEmpty() {
+    *destroyed_on_ = std::this_thread::get_id();
+  }
+
+ private:
+  std::thread::id* destroyed_on_;
+};
+
+/**
+ *  Empty which counts its updates, and copies the count when its render state is synced.
+ */
+class SyncedEmpty : public Empty {
+ public:
+  SyncedEmpty(const std::atomic<bool>* simulating) : Empty(nullptr), simulating_(simulating) {}
+
+  void Update() override {
+    updates++;
+  }
+
+  void SyncRenderState() override {
+    synced_updates = updates;
+    synced_on = std::this_thread::get_id();
+    if (simulating_->load()) {
+      overlaps++;
+    }
+  }
+
+  int updates = 0;
+  int synced_updates = 0;
+  int overlaps = 0;
+  std::thread::id synced_on;
+
+ private:
+  const std::atomic<bool>* simulating_;
+};
+
+/**
+ *  UI object which counts its updates, and notes any which ran alongside the simulation.
+ */
+class WatchedUIObject : public UIObject {
+ public:
+  WatchedUIObject(const std::atomic<bool>* simulating) : UIObject(nullptr), simulating_(simulating) {}
+
+  void Update() override {
+    updates++;
+    if (simulating_->load()) {
+      overlaps++;
+    }
+  }
+
+  void DrawUI(glm::vec2 min, glm::vec2 max, Canvas canvas) override {}
+
+  int updates = 0;
+  int overlaps = 0;
+
+ private:
+  const std::atomic<bool>* simulating_;
+};
+
+class FramePipelineTests : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    testscene::QuietLogs();
+    root = std::make_shared<MovingEmpty>(1);
+    for (int i = 0; i < 3; i++) {
+      root->AddChild(std::make_shared<MovingEmpty>(i + 2));
+    }
+  }
+
+  /**
+   *  Simulates a frame of the test scene.
+   */
+  void Simulate(frame_snapshot& frame) {
+    sim_thread = std::this_thread::get_id();
+    visitor.UpdateAndGather(root.get());
+    root->GetTransformHierarchy()->Update();
+    FramePipeline::CaptureFrame(visitor, frame);
+  }
+
+  /**
+   *  Runs `count` frames through `pipeline`, the way GameLoop does.
+   */
+  void RunFrames(FramePipeline& pipeline, int count) {
+    for (int i = 0; i < count; i++) {
+      const frame_snapshot& frame = pipeline.WaitForFrame();
+      backend.PrepareUI(frame);
+      pipeline.StartNextFrame();
+      backend.Render(frame);
+    }
+  }
+
+  /**
+   *  Checks that `count` frames were drawn in order, each showing the scene as it was simulated.
+   */
+  void CheckFrames(int count) {
+    auto& calls = backend.GetCalls();
+    ASSERT_EQ(count * 8, calls.size());
+    for (int i = 0; i < count; i++) {
+      const recorded_call* frame = &calls[i * 8 + 1];
+      ASSERT_EQ(CALL_UPDATE_UI, frame[-1].call);
+      ASSERT_EQ(CALL_BEGIN_FRAME, frame[0].call);
+      ASSERT_EQ(CALL_DRAW_UI, frame[5].call);
+      ASSERT_EQ(CALL_END_FRAME, frame[6].call);
+      for (int j = -1; j < 7; j++) {
+        ASSERT_EQ(i, frame[j].frame);
+        ASSERT_EQ(std::this_thread::get_id(), frame[j].thread);
+      }
+
+      // the root, then its children. by frame i, everything has been updated i + 1 times
+      for (int j = 0; j < 4; j++) {
+        ASSERT_EQ(CALL_DRAW_OBJECT, frame[j + 1].call);
+        ASSERT_EQ(j + 1, frame[j + 1].object_id);
+        ASSERT_FLOAT_EQ(static_cast<float>(j == 0 ? i + 1 : 2 * (i + 1)), frame[j + 1].model_matrix[3][0]);
+      }
+    }
+  }
+
+  std::shared_ptr<MovingEmpty> root;
+  FrameVisitor visitor;
+  RecordingRenderBackend backend;
+  std::thread::id sim_thread;
+};
+
+TEST_F(FramePipelineTests, DrawsFramesInOrder) {
+  {
+    FramePipeline pipeline([this](frame_snapshot& frame) { Simulate(frame); }, true);
+    ASSERT_TRUE(pipeline.IsPipelined());
+    RunFrames(pipeline, 5);
+    CheckFrames(5);
+
+    // the simulation is a frame ahead of what was drawn
+    pipeline.WaitForFrame();
+    ASSERT_FLOAT_EQ(6.0f, root->GetPosition().x);
+    ASSERT_NE(std::this_thread::get_id(), sim_thread);
+  }
+
+  backend.Clear();
+  root->SetPosition(glm::vec3(0));
+  for (auto& child : root->GetChildren()) {
+    std::static_pointer_cast<MovingEmpty>(child)->SetPosition(glm::vec3(0));
+  }
+
+  // same frames without the extra thread
+  FramePipeline serial([this](frame_snapshot& frame) { Simulate(frame); }, false);
+  ASSERT_FALSE(serial.IsPipelined());
+  RunFrames(serial, 5);
+  CheckFrames(5);
+  ASSERT_EQ(std::this_thread::get_id(), sim_thread);
+}
+
+TEST_F(FramePipelineTests, SimulationOverlapsRendering) {
+  std::promise<void> rendered;
+  std::shared_future<void> rendered_future = rendered.get_future().share();
+  bool overlapped = false;
+
+  // frame 1 can't finish until frame 0 has been drawn
+  FramePipeline pipeline([&](frame_snapshot& frame) {
+    if (frame.frame == 1) {
+      overlapped = (rendered_future.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    }
+
+    Simulate(frame);
+  }, true);
+
+  const frame_snapshot& first = pipeline.WaitForFrame();
+  pipeline.StartNextFrame();
+  backend.Render(first);
+  rendered.set_value();
+
+  const frame_snapshot& second = pipeline.WaitForFrame();
+  ASSERT_TRUE(overlapped);
+  ASSERT_EQ(1, second.frame);
+}
+
+TEST_F(FramePipelineTests, UIOnlyUpdatesWhileSimulationIsIdle) {
+  std::atomic<bool> simulating(false);
+  auto window = std::make_shared<EngineWindow>(nullptr);
+  auto widget = std::make_shared<WatchedUIObject>(&simulating);
+  window->AddChild(widget);
+
+  // each simulation lasts long enough that a UI update running alongside it would be caught
+  FramePipeline pipeline([&](frame_snapshot& frame) {
+    simulating = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    Simulate(frame);
+    frame.window = window;
+    simulating = false;
+  }, true);
+
+  RunFrames(pipeline, 10);
+  pipeline.WaitForFrame();
+  ASSERT_EQ(10, widget->updates);
+  ASSERT_EQ(0, widget->overlaps);
+}
+
+TEST_F(FramePipelineTests, RenderStateSyncsWhileSimulationIsIdle) {
+  std::atomic<bool> simulating(false);
+  auto synced = std::make_shared<SyncedEmpty>(&simulating);
+  root->AddChild(synced);
+
+  FramePipeline pipeline([&](frame_snapshot& frame) {
+    simulating = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    Simulate(frame);
+    simulating = false;
+  }, true);
+
+  for (int i = 0; i < 10; i++) {
+    const frame_snapshot& frame = pipeline.WaitForFrame();
+    // synced as of the frame being handed out, before the next one starts
+    ASSERT_EQ(i + 1, synced->synced_updates);
+    pipeline.StartNextFrame();
+    backend.Render(frame);
+  }
+
+  pipeline.WaitForFrame();
+  ASSERT_EQ(0, synced->overlaps);
+  ASSERT_EQ(std::this_thread::get_id(), synced->synced_on);
+}
+
+TEST_F(FramePipelineTests, RemovedObjectsOutliveTheirLastFrame) {
+  std::thread::id destroyed_on;
+  auto watched = std::make_shared<WatchedEmpty>(&destroyed_on);
+  uint64_t watched_id = watched->GetId();
+  root->AddChild(watched);
+  std::weak_ptr<WatchedEmpty> watched_weak = watched;
+  watched = nullptr;
+
+  // frame 1 drops the object from the scene, while frame 0 is still to be drawn
+  FramePipeline pipeline([&](frame_snapshot& frame) {
+    if (frame.frame == 1) {
+      root->RemoveChild(watched_id);
+    }
+
+    Simulate(frame);
+  }, true);
+
+  const frame_snapshot& first = pipeline.WaitForFrame();
+  ASSERT_EQ(5, first.items.size());
+  pipeline.StartNextFrame();
+  backend.Render(first);
+  ASSERT_EQ(watched_id, backend.GetCalls()[5].object_id);
+
+  pipeline.WaitForFrame();
+  ASSERT_FALSE(watched_weak.expired());
+
+  // released once its frame is recycled -- on this thread, rather than the simulation's
+  pipeline.StartNextFrame();
+  ASSERT_TRUE(watched_weak.expired());
+  ASSERT_EQ(std::this_thread::get_id(), destroyed_on);
+  pipeline.WaitForFrame();
+}
+
+TEST_F(FramePipelineTests, ResetDropsSnapshots) {
+  FramePipeline pipeline([this](frame_snapshot& frame) { Simulate(frame); }, true);
+  const frame_snapshot& frame = pipeline.WaitForFrame();
+  ASSERT_EQ(4, frame.items.size());
+  pipeline.Reset();
+  ASSERT_EQ(0, frame.items.size());
+}
+
+TEST_F(FramePipelineTests, ExceptionsReachCaller) {
+  FramePipeline pipeline([this](frame_snapshot& frame) {
+    if (frame.frame == 1) {
+      throw std::runtime_error("oops");
+    }
+
+    Simulate(frame);
+  }, true);
+
+  pipeline.WaitForFrame();
+  pipeline.StartNextFrame();
+  ASSERT_THROW(pipeline.WaitForFrame(), std::runtime_error);
+
+  // and the pipeline keeps going afterwards
+  const frame_snapshot& frame = pipeline.WaitForFrame();
+  ASSERT_EQ(2, frame.frame);
+}
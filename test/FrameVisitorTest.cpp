@@ -0,0 +1,145 @@
+#include <critter/visitor/FrameVisitor.hpp>
+#include <critter/GameCamera.hpp>
+#include <critter/Empty.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TestScene.hpp"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::GameCamera;
+using ::monkeysworld::critter::Object;
+using ::monkeysworld::critter::visitor::FrameVisitor;
+
+/**
+ *  Empty which counts its updates, and can run some code from Update.
+ */
+class CountingEmpty : public Empty {
+ public:
+  CountingEmpty(uint64_t id) : Empty(nullptr), updates(0) {
+    SetId(id);
+  }
+
+  void Update() override {
+    updates++;
+    if (on_update) {
+      on_update();
+    }
+  }
+
+  using GameObject::RemoveChild;
+
+  int updates;
+  std::function<void()> on_update;
+};
+
+class FrameVisitorTests : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    testscene::QuietLogs();
+  }
+};
+
+TEST_F(FrameVisitorTests, GathersInOnePass) {
+  //        1
+  //    2       cam_a
+  //  3   cam_b
+  auto root = std::make_shared<CountingEmpty>(1);
+  auto a = std::make_shared<CountingEmpty>(2);
+  auto b = std::make_shared<CountingEmpty>(3);
+  auto cam_a = std::make_shared<GameCamera>(nullptr);
+  auto cam_b = std::make_shared<GameCamera>(nullptr);
+  cam_a->SetActive(true);
+  cam_b->SetActive(false);
+  root->AddChild(a);
+  root->AddChild(cam_a);
+  a->AddChild(b);
+  a->AddChild(cam_b);
+
+  FrameVisitor v;
+  v.UpdateAndGather(root.get());
+  std::vector<Object*> expected = { root.get(), a.get(), b.get(), cam_b.get(), cam_a.get() };
+  ASSERT_EQ(expected, v.GetRenderList());
+  ASSERT_EQ(cam_a, v.GetActiveCamera());
+  ASSERT_EQ(0, v.GetSpotLights().size());
+  ASSERT_EQ(1, root->updates);
+  ASSERT_EQ(1, a->updates);
+  ASSERT_EQ(1, b->updates);
+
+  // a second frame starts from scratch
+  v.UpdateAndGather(root.get());
+  ASSERT_EQ(expected, v.GetRenderList());
+  ASSERT_EQ(2, b->updates);
+
+  v.Clear();
+  ASSERT_EQ(0, v.GetRenderList().size());
+  ASSERT_EQ(nullptr, v.GetActiveCamera());
+}
+
+TEST_F(FrameVisitorTests, CameraChosenAfterUpdates) {
+  auto root = std::make_shared<CountingEmpty>(1);
+  auto cam_a = std::make_shared<GameCamera>(nullptr);
+  auto last = std::make_shared<CountingEmpty>(2);
+  auto cam_b = std::make_shared<GameCamera>(nullptr);
+  cam_a->SetActive(true);
+  cam_b->SetActive(false);
+  root->AddChild(cam_a);
+  root->AddChild(last);
+  root->AddChild(cam_b);
+
+  // cam_a is gathered before `last` switches cameras
+  last->on_update = [&] {
+    cam_a->SetActive(false);
+    cam_b->SetActive(true);
+  };
+
+  FrameVisitor v;
+  v.UpdateAndGather(root.get());
+  ASSERT_EQ(cam_b, v.GetActiveCamera());
+}
+
+TEST_F(FrameVisitorTests, ObjectsCanRemoveThemselvesAndSiblings) {
+  auto root = std::make_shared<CountingEmpty>(1);
+  std::weak_ptr<CountingEmpty> children[3];
+  for (int i = 0; i < 3; i++) {
+    auto child = std::make_shared<CountingEmpty>(i + 2);
+    root->AddChild(child);
+    children[i] = child;
+  }
+
+  // the root holds the only reference to each child.
+  // 3 removes 2, which has already been gathered, then itself
+  children[1].lock()->on_update = [&] {
+    root->RemoveChild(2);
+    root->RemoveChild(3);
+  };
+
+  FrameVisitor v;
+  v.UpdateAndGather(root.get());
+  ASSERT_EQ(1, root->GetChildSpan().GetSize());
+  ASSERT_EQ(4, v.GetRenderList().size());
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(i + 1, v.GetRenderList()[i]->GetId());
+  }
+
+  ASSERT_EQ(1, children[2].lock()->updates);
+
+  // removed objects last until the visitor lets go of them
+  ASSERT_FALSE(children[0].expired());
+  ASSERT_FALSE(children[1].expired());
+  v.UpdateAndGather(root.get());
+  ASSERT_TRUE(children[0].expired());
+  ASSERT_TRUE(children[1].expired());
+  ASSERT_EQ(2, v.GetRenderList().size());
+}
+
+TEST_F(FrameVisitorTests, NullRoot) {
+  FrameVisitor v;
+  v.UpdateAndGather(nullptr);
+  ASSERT_EQ(0, v.GetRenderList().size());
+  ASSERT_EQ(nullptr, v.GetActiveCamera());
+}
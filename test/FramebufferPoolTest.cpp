@@ -0,0 +1,266 @@
+#include <shader/FramebufferPool.hpp>
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <set>
+#include <vector>
+
+using ::monkeysworld::shader::FramebufferPool;
+using ::monkeysworld::shader::RenderTargetAllocator;
+using ::monkeysworld::shader::atlas_region;
+using ::monkeysworld::shader::render_target;
+
+/**
+ *  Hands out made up names, and keeps track of which are alive.
+ */
+class FakeAllocator : public RenderTargetAllocator {
+ public:
+  FakeAllocator(std::set<GLuint>* live, std::vector<GLuint>* freed) : live_(live), freed_(freed), next_(1) {}
+
+  void Allocate(render_target* target) override {
+    target->fb = next_++;
+    target->color = next_++;
+    target->depth_stencil = next_++;
+    live_->insert(target->fb);
+  }
+
+  void Free(const render_target& target) override {
+    ASSERT_EQ(1, live_->erase(target.fb));
+    freed_->push_back(target.fb);
+  }
+
+ private:
+  std::set<GLuint>* live_;
+  std::vector<GLuint>* freed_;
+  GLuint next_;
+};
+
+class FramebufferPoolTests : public ::testing::Test {
+ protected:
+  std::unique_ptr<FramebufferPool> MakePool(uint64_t budget) {
+    return std::make_unique<FramebufferPool>(std::make_unique<FakeAllocator>(&live, &freed), budget);
+  }
+
+  std::set<GLuint> live;
+  std::vector<GLuint> freed;
+};
+
+static const uint64_t SMALL_TARGET = FramebufferPool::GetTargetBytes(glm::ivec2(64, 64));
+
+TEST(FramebufferPoolBucketTests, BucketsRoundUpSlightly) {
+  ASSERT_EQ(glm::ivec2(8, 8), FramebufferPool::GetBucketSize(glm::ivec2(1, 1)));
+  ASSERT_EQ(glm::ivec2(1024, 512), FramebufferPool::GetBucketSize(glm::ivec2(1024, 512)));
+  ASSERT_EQ(glm::ivec2(896, 640), FramebufferPool::GetBucketSize(glm::ivec2(800, 600)));
+  ASSERT_EQ(glm::ivec2(896, 640), FramebufferPool::GetBucketSize(glm::ivec2(820, 610)));
+
+  // small sizes round to multiples of 8 instead
+  for (int i = 1; i < 64; i++) {
+    int bucket = FramebufferPool::GetBucketSize(glm::ivec2(i, 1)).x;
+    ASSERT_GE(bucket, i);
+    ASSERT_LT(bucket - i, 8);
+  }
+
+  for (int i = 64; i < 5000; i++) {
+    int bucket = FramebufferPool::GetBucketSize(glm::ivec2(i, 1)).x;
+    ASSERT_GE(bucket, i);
+    ASSERT_LE(bucket * 4, i * 5);
+  }
+}
+
+TEST_F(FramebufferPoolTests, ReuseReturnedTargets) {
+  auto pool = MakePool(FramebufferPool::DEFAULT_BUDGET);
+  render_target a = pool->Lease(glm::ivec2(100, 100));
+  ASSERT_EQ(glm::ivec2(112, 112), a.size);
+  pool->Return(a);
+
+  render_target b = pool->Lease(glm::ivec2(110, 105));
+  ASSERT_EQ(a.fb, b.fb);
+
+  // different bucket
+  render_target c = pool->Lease(glm::ivec2(300, 100));
+  ASSERT_NE(a.fb, c.fb);
+
+  auto& stats = pool->GetStats();
+  ASSERT_EQ(2, stats.allocations);
+  ASSERT_EQ(3, stats.leases);
+  ASSERT_EQ(1, stats.reuses);
+  ASSERT_EQ(2, stats.targets);
+  ASSERT_EQ(FramebufferPool::GetTargetBytes(a.size) + FramebufferPool::GetTargetBytes(c.size), stats.bytes);
+  ASSERT_EQ(0, stats.idle_bytes);
+}
+
+TEST_F(FramebufferPoolTests, EvictLeastRecentlyReturned) {
+  auto pool = MakePool(SMALL_TARGET * 5);
+  render_target a = pool->Lease(glm::ivec2(64, 64));
+  render_target b = pool->Lease(glm::ivec2(64, 64));
+  render_target c = pool->Lease(glm::ivec2(64, 64));
+  pool->Return(a);
+  pool->Return(b);
+  pool->Return(c);
+  ASSERT_EQ(3 * SMALL_TARGET, pool->GetStats().idle_bytes);
+
+  // twice the size -- fits
+  pool->Lease(glm::ivec2(128, 64));
+  ASSERT_TRUE(freed.empty());
+
+  // doesn't fit until the two oldest are gone
+  pool->Lease(glm::ivec2(128, 64));
+  ASSERT_EQ((std::vector<GLuint> { a.fb, b.fb }), freed);
+  ASSERT_EQ(5 * SMALL_TARGET, pool->GetStats().bytes);
+  ASSERT_EQ(2, pool->GetStats().evictions);
+
+  ASSERT_EQ(c.fb, pool->Lease(glm::ivec2(64, 64)).fb);
+}
+
+TEST_F(FramebufferPoolTests, NeverEvictLeasedTargets) {
+  auto pool = MakePool(0);
+  render_target a = pool->Lease(glm::ivec2(64, 64));
+  render_target b = pool->Lease(glm::ivec2(64, 64));
+  ASSERT_EQ(2, live.size());
+  ASSERT_EQ(2 * SMALL_TARGET, pool->GetStats().bytes);
+
+  pool->Return(a);
+  ASSERT_EQ((std::vector<GLuint> { a.fb }), freed);
+
+  pool->SetBudget(SMALL_TARGET);
+  pool->Return(b);
+  ASSERT_EQ(1, live.size());
+  ASSERT_EQ(SMALL_TARGET, pool->GetStats().idle_bytes);
+}
+
+TEST_F(FramebufferPoolTests, FreeIdleTargetsOnTrim) {
+  {
+    auto pool = MakePool(FramebufferPool::DEFAULT_BUDGET);
+    render_target a = pool->Lease(glm::ivec2(64, 64));
+    render_target b = pool->Lease(glm::ivec2(256, 256));
+    pool->Lease(glm::ivec2(512, 512));
+    pool->Return(a);
+    pool->Return(b);
+    pool->Trim();
+    ASSERT_EQ(1, live.size());
+    ASSERT_EQ(1, pool->GetStats().targets);
+    ASSERT_EQ(0, pool->GetStats().idle_bytes);
+
+    render_target c = pool->Lease(glm::ivec2(64, 64));
+    pool->Return(c);
+  }
+
+  // the leased target is left to whoever holds it
+  ASSERT_EQ(1, live.size());
+  ASSERT_EQ(3, freed.size());
+}
+
+// mirrors Framebuffer, which keeps its attachments until its size leaves their bucket
+struct Resizable {
+  render_target target;
+
+  void Resize(FramebufferPool* pool, glm::ivec2 size) {
+    if (target.fb != 0 && target.size == FramebufferPool::GetBucketSize(size)) {
+      return;
+    }
+
+    if (target.fb != 0) {
+      pool->Return(target);
+    }
+
+    target = pool->Lease(size);
+  }
+};
+
+TEST_F(FramebufferPoolTests, AllocateOnlyWhenCrossingBuckets) {
+  // enough to keep everything
+  auto pool = MakePool(1ull << 32);
+  std::vector<Resizable> panels(20, Resizable { {} });
+
+  // a window being dragged from 640x480 to 1280x960 over 320 frames, then back
+  const int frames = 320;
+  for (int f = 0; f <= frames; f++) {
+    glm::ivec2 window(640 + 2 * f, 480 + (3 * f) / 2);
+    for (size_t i = 0; i < panels.size(); i++) {
+      panels[i].Resize(pool.get(), window / 2 - glm::ivec2(static_cast<int>(i)));
+    }
+  }
+
+  uint64_t allocations = pool->GetStats().allocations;
+  ASSERT_LT(allocations, panels.size() * 20);
+
+  // panels in reverse as well, so none asks for a target before the panel giving it up has done so
+  for (int f = frames; f >= 0; f--) {
+    glm::ivec2 window(640 + 2 * f, 480 + (3 * f) / 2);
+    for (size_t i = panels.size(); i-- > 0;) {
+      panels[i].Resize(pool.get(), window / 2 - glm::ivec2(static_cast<int>(i)));
+    }
+  }
+
+  // everything needed on the way back down was returned on the way up
+  ASSERT_EQ(allocations, pool->GetStats().allocations);
+  ASSERT_TRUE(freed.empty());
+}
+
+TEST_F(FramebufferPoolTests, ShareAtlasPages) {
+  auto pool = MakePool(FramebufferPool::DEFAULT_BUDGET);
+  std::vector<atlas_region> regions(50);
+  for (auto& region : regions) {
+    ASSERT_TRUE(pool->LeaseRegion(glm::ivec2(120, 30), &region));
+  }
+
+  // 50 widgets on a single target
+  ASSERT_EQ(1, live.size());
+  ASSERT_EQ(1, pool->GetStats().atlas_pages);
+  ASSERT_EQ(50, pool->GetStats().atlas_regions);
+  for (size_t i = 0; i < regions.size(); i++) {
+    ASSERT_EQ(regions[0].page.fb, regions[i].page.fb);
+    ASSERT_EQ(glm::ivec2(120, 30), regions[i].size);
+
+    // with a pixel between neighbors, and between them and the edge
+    glm::ivec2 min = regions[i].origin - glm::ivec2(1);
+    glm::ivec2 max = regions[i].origin + regions[i].size + glm::ivec2(1);
+    ASSERT_GE(min.x, 0);
+    ASSERT_GE(min.y, 0);
+    ASSERT_LE(max.x, FramebufferPool::ATLAS_PAGE_SIZE);
+    ASSERT_LE(max.y, FramebufferPool::ATLAS_PAGE_SIZE);
+    for (size_t j = 0; j < i; j++) {
+      glm::ivec2 other_min = regions[j].origin - glm::ivec2(1);
+      glm::ivec2 other_max = regions[j].origin + regions[j].size + glm::ivec2(1);
+      ASSERT_TRUE(min.x >= other_max.x || other_min.x >= max.x || min.y >= other_max.y || other_min.y >= max.y);
+    }
+  }
+
+  // too large to share
+  atlas_region large;
+  ASSERT_FALSE(pool->LeaseRegion(glm::ivec2(FramebufferPool::MAX_ATLAS_REGION + 1, 16), &large));
+}
+
+TEST_F(FramebufferPoolTests, ReturnEmptyAtlasPages) {
+  auto pool = MakePool(FramebufferPool::DEFAULT_BUDGET);
+  std::vector<atlas_region> regions;
+  atlas_region region;
+  while (pool->GetStats().atlas_pages < 2) {
+    ASSERT_TRUE(pool->LeaseRegion(glm::ivec2(254, 254), &region));
+    regions.push_back(region);
+  }
+
+  // a full page holds 16, and the 17th starts a new one
+  ASSERT_EQ(17, regions.size());
+  ASSERT_NE(regions.front().page.fb, regions.back().page.fb);
+
+  for (size_t i = 0; i < 16; i++) {
+    pool->ReturnRegion(regions[i]);
+  }
+
+  ASSERT_EQ(1, pool->GetStats().atlas_pages);
+  ASSERT_EQ(FramebufferPool::GetTargetBytes(glm::ivec2(FramebufferPool::ATLAS_PAGE_SIZE)),
+            pool->GetStats().idle_bytes);
+
+  // the empty page comes back when another is needed, and is filled from the start
+  GLuint last_page = regions.back().page.fb;
+  do {
+    ASSERT_TRUE(pool->LeaseRegion(glm::ivec2(254, 254), &region));
+  } while (region.page.fb == last_page);
+
+  ASSERT_EQ(regions.front().page.fb, region.page.fb);
+  ASSERT_EQ(glm::ivec2(1, 1), region.origin);
+  ASSERT_EQ(2, pool->GetStats().atlas_pages);
+  ASSERT_EQ(2, pool->GetStats().allocations);
+  ASSERT_EQ(1, pool->GetStats().reuses);
+}
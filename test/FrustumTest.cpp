@@ -0,0 +1,263 @@
+#include <utils/Frustum.hpp>
+#include <critter/Empty.hpp>
+#include <critter/visitor/FrameVisitor.hpp>
+#include <engine/FramePipeline.hpp>
+#include <model/Mesh.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TestScene.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::GameObject;
+using ::monkeysworld::critter::visitor::FrameVisitor;
+using ::monkeysworld::engine::FramePipeline;
+using ::monkeysworld::engine::RenderContext;
+using ::monkeysworld::engine::frame_snapshot;
+using ::monkeysworld::model::Mesh;
+using ::monkeysworld::storage::VertexPacket3D;
+using ::monkeysworld::utils::Frustum;
+using ::monkeysworld::utils::MatrixBatch;
+using ::monkeysworld::utils::aabb;
+using ::monkeysworld::utils::bounding_sphere;
+using ::monkeysworld::utils::EmptyBounds;
+using ::monkeysworld::utils::InfiniteBounds;
+
+static const MatrixBatch::Kernel KERNELS[] = {
+  MatrixBatch::KERNEL_SCALAR,
+  MatrixBatch::KERNEL_SSE,
+  MatrixBatch::KERNEL_AVX2
+};
+
+/**
+ *  A camera at the origin, looking down -z -- so its view matrix is the identity.
+ */
+static glm::mat4 CameraMatrix() {
+  return glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+}
+
+/**
+ *  Empty which draws a box.
+ */
+class BoxEmpty : public Empty {
+ public:
+  BoxEmpty(const aabb& bounds) : Empty(nullptr) {
+    SetLocalBounds(bounds);
+  }
+};
+
+/**
+ *  Object which doesn't say what it draws.
+ */
+class UnboundedObject : public GameObject {
+ public:
+  UnboundedObject() : GameObject(nullptr) {}
+  void PrepareAttributes() override {}
+  void RenderMaterial(const RenderContext& rc) override {}
+  void Draw() override {}
+};
+
+TEST(FrustumTests, KernelsMatchClipSpace) {
+  glm::mat4 vp = CameraMatrix();
+  Frustum frustum(vp);
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<float> pos(-150.0f, 150.0f);
+  std::uniform_real_distribution<float> size(0.1f, 20.0f);
+  std::vector<aabb> boxes(1003);
+  for (auto& box : boxes) {
+    box.min = glm::vec3(pos(gen), pos(gen), pos(gen));
+    box.max = box.min + glm::vec3(size(gen), size(gen), size(gen));
+  }
+
+  std::vector<uint8_t> expected(boxes.size());
+  size_t expected_count = frustum.TestBoxes(MatrixBatch::KERNEL_SCALAR, boxes.data(), expected.data(), boxes.size());
+  ASSERT_GT(expected_count, 0);
+  ASSERT_LT(expected_count, boxes.size());
+
+  for (auto kernel : KERNELS) {
+    // one past the end, to catch overruns
+    std::vector<uint8_t> visible(boxes.size() + 1, 7);
+    ASSERT_EQ(expected_count, frustum.TestBoxes(kernel, boxes.data(), visible.data(), boxes.size()));
+    ASSERT_EQ(7, visible.back());
+    for (size_t i = 0; i < boxes.size(); i++) {
+      ASSERT_EQ(expected[i], visible[i]);
+      ASSERT_EQ(expected[i] != 0, frustum.TestBox(boxes[i]));
+    }
+  }
+
+  // check against the corners in clip space, where they can be told apart
+  for (size_t i = 0; i < boxes.size(); i++) {
+    bool any_inside = false;
+    int outside[6] = { 0 };
+    for (int c = 0; c < 8; c++) {
+      glm::vec3 corner((c & 1) ? boxes[i].max.x : boxes[i].min.x,
+                       (c & 2) ? boxes[i].max.y : boxes[i].min.y,
+                       (c & 4) ? boxes[i].max.z : boxes[i].min.z);
+      glm::vec4 clip = vp * glm::vec4(corner, 1.0f);
+      bool inside = true;
+      for (int axis = 0; axis < 3; axis++) {
+        outside[axis * 2] += (clip[axis] < -clip.w ? 1 : 0);
+        outside[axis * 2 + 1] += (clip[axis] > clip.w ? 1 : 0);
+        inside = inside && (clip[axis] >= -clip.w && clip[axis] <= clip.w);
+      }
+
+      any_inside = any_inside || inside;
+    }
+
+    if (any_inside) {
+      ASSERT_EQ(1, expected[i]);
+    }
+
+    for (int p = 0; p < 6; p++) {
+      if (outside[p] == 8) {
+        ASSERT_EQ(0, expected[i]);
+      }
+    }
+  }
+}
+
+TEST(FrustumTests, SpecialBoxes) {
+  Frustum frustum(CameraMatrix());
+  aabb behind = { glm::vec3(-1, -1, 5), glm::vec3(1, 1, 6) };
+  aabb ahead = { glm::vec3(-1, -1, -6), glm::vec3(1, 1, -5) };
+  aabb boxes[] = { InfiniteBounds(), EmptyBounds(), behind, ahead };
+  for (auto kernel : KERNELS) {
+    uint8_t visible[4];
+    ASSERT_EQ(2, frustum.TestBoxes(kernel, boxes, visible, 4));
+    ASSERT_EQ(1, visible[0]);
+    ASSERT_EQ(0, visible[1]);
+    ASSERT_EQ(0, visible[2]);
+    ASSERT_EQ(1, visible[3]);
+  }
+
+  // the default frustum keeps everything
+  Frustum everything;
+  ASSERT_TRUE(everything.TestBox(behind));
+  ASSERT_TRUE(everything.TestBox(InfiniteBounds()));
+}
+
+TEST(FrustumTests, Spheres) {
+  Frustum frustum(CameraMatrix());
+  ASSERT_TRUE(frustum.TestSphere({ glm::vec3(0, 0, -10), 1.0f }));
+  ASSERT_FALSE(frustum.TestSphere({ glm::vec3(0, 0, 10), 1.0f }));
+  ASSERT_FALSE(frustum.TestSphere({ glm::vec3(0, 0, -200), 50.0f }));
+  // off to the side, but big enough to poke in
+  ASSERT_FALSE(frustum.TestSphere({ glm::vec3(30, 0, -10), 1.0f }));
+  ASSERT_TRUE(frustum.TestSphere({ glm::vec3(30, 0, -10), 30.0f }));
+}
+
+TEST(FrustumTests, MeshBounds) {
+  Mesh<> mesh;
+  ASSERT_TRUE(IsEmpty(mesh.GetBounds()));
+  ASSERT_LT(mesh.GetBoundingSphere().radius, 0.0f);
+
+  VertexPacket3D packet = {};
+  packet.position = glm::vec3(-1, 0, 2);
+  mesh.AddVertex(packet);
+  packet.position = glm::vec3(3, -2, 4);
+  mesh.AddVertex(packet);
+  ASSERT_EQ(glm::vec3(-1, -2, 2), mesh.GetBounds().min);
+  ASSERT_EQ(glm::vec3(3, 0, 4), mesh.GetBounds().max);
+  ASSERT_EQ(glm::vec3(1, -1, 3), mesh.GetBoundingSphere().center);
+  ASSERT_FLOAT_EQ(std::sqrt(6.0f), mesh.GetBoundingSphere().radius);
+
+  // edits in place are picked up too
+  mesh[0].position = glm::vec3(-5, 0, 2);
+  ASSERT_EQ(glm::vec3(-5, -2, 2), mesh.GetBounds().min);
+
+  mesh.Clear();
+  ASSERT_TRUE(IsEmpty(mesh.GetBounds()));
+}
+
+TEST(FrustumTests, MeshBoundsFromSeveralThreads) {
+  // models sharing a mesh can ask for its bounds from different update threads
+  auto mesh = std::make_shared<Mesh<>>();
+  VertexPacket3D packet = {};
+  for (int i = 0; i < 10000; i++) {
+    packet.position = glm::vec3(i % 100, i / 100, -i);
+    mesh->AddVertex(packet);
+  }
+
+  std::shared_ptr<const Mesh<>> shared = mesh;
+  std::vector<aabb> bounds(8);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < bounds.size(); i++) {
+    threads.emplace_back([&, i] {
+      bounds[i] = shared->GetBounds();
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (auto& box : bounds) {
+    ASSERT_EQ(glm::vec3(0, 0, -9999), box.min);
+    ASSERT_EQ(glm::vec3(99, 99, 0), box.max);
+  }
+}
+
+TEST(FrustumTests, CaptureSkipsHiddenSubtrees) {
+  testscene::QuietLogs();
+  aabb unit = { glm::vec3(-1), glm::vec3(1) };
+  auto root = std::make_shared<Empty>(nullptr);
+  auto ahead = std::make_shared<Empty>(nullptr);
+  auto behind = std::make_shared<Empty>(nullptr);
+  auto unbounded = std::make_shared<UnboundedObject>();
+  ahead->SetPosition(glm::vec3(0, 0, -10));
+  behind->SetPosition(glm::vec3(0, 0, 50));
+  unbounded->SetPosition(glm::vec3(0, 0, 50));
+  root->AddChild(ahead);
+  root->AddChild(behind);
+  root->AddChild(unbounded);
+  for (int i = 0; i < 3; i++) {
+    auto box = std::make_shared<BoxEmpty>(unit);
+    box->SetPosition(glm::vec3(i - 1, 0, 0));
+    ahead->AddChild(box);
+    behind->AddChild(std::make_shared<BoxEmpty>(unit));
+  }
+
+  FrameVisitor visitor;
+  visitor.UpdateAndGather(root.get());
+  // root, ahead and its boxes, behind and its boxes, unbounded
+  std::vector<uint32_t> ends = { 10, 5, 3, 4, 5, 9, 7, 8, 9, 10 };
+  ASSERT_EQ(ends, visitor.GetSubtreeEnds());
+  // as the engine does -- subtree bounds come from the last pass
+  root->GetTransformHierarchy()->Update();
+
+  Frustum frustum(CameraMatrix());
+  frame_snapshot frame;
+  FramePipeline::CaptureItems(visitor, &frustum, frame);
+  ASSERT_EQ(4, frame.items.size());
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(ahead->GetChildren()[i], frame.items[i].object);
+  }
+
+  ASSERT_EQ(unbounded, frame.items[3].object);
+
+  // behind's boxes are skipped along with it, and the empties don't draw anything
+  ASSERT_EQ(9, frame.culling.tested);
+  ASSERT_EQ(6, frame.culling.culled);
+  ASSERT_EQ(4, frame.culling.drawn);
+
+  frame_snapshot unculled;
+  FramePipeline::CaptureItems(visitor, nullptr, unculled);
+  ASSERT_EQ(10, unculled.items.size());
+  ASSERT_EQ(0, unculled.culling.tested);
+  ASSERT_EQ(10, unculled.culling.drawn);
+
+  // once it's moved into view, behind's subtree is drawn
+  behind->SetPosition(glm::vec3(0, 0, -20));
+  root->GetTransformHierarchy()->Update();
+  frame_snapshot moved;
+  FramePipeline::CaptureItems(visitor, &frustum, moved);
+  ASSERT_EQ(7, moved.items.size());
+}
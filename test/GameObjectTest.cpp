@@ -3,11 +3,17 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 // verify successful instantiation of trivially derived class
 // verify transform matrix accuracy
 // add child and verify that child matrix is correct
 
 using ::monkeysworld::critter::GameObject;
+using ::monkeysworld::critter::Object;
+using ::monkeysworld::critter::ObjectRegistry;
 using ::monkeysworld::engine::RenderContext;
 
 
@@ -25,6 +31,30 @@ class DummyGameObject : public GameObject {
     void Draw() override {
       // also also do nothing
     }
+
+};
+
+/**
+ *  Object with nothing on top, for checking what Object does by itself.
+ */
+class BareObject : public Object {
+ public:
+  BareObject() : Object(nullptr) {}
+  BareObject(BareObject&& other) : Object(std::move(other)) {}
+  BareObject& operator=(BareObject&& other) {
+    Object::operator=(std::move(other));
+    return *this;
+  }
+
+  void Accept(::monkeysworld::critter::Visitor& v) override {}
+  void PrepareAttributes() override {}
+  void RenderMaterial(const RenderContext& rc) override {}
+  void Draw() override {}
+  std::shared_ptr<Object> GetChild(uint64_t id) override { return nullptr; }
+  std::vector<std::shared_ptr<Object>> GetChildren() override { return {}; }
+  ::monkeysworld::critter::ChildSpan GetChildSpan() override { return {}; }
+  std::shared_ptr<Object> GetParent() override { return nullptr; }
+  using Object::GetRegistry;
 };
 
 TEST(GameObjectTests, CreateGameObject) {
@@ -84,4 +114,199 @@ TEST(GameObjectTests, VerifyTransformations) {
       ASSERT_NEAR(object_rot[i][j], actual_transform[i][j], 0.001);
     }
   }
-}
\ No newline at end of file
+}
+
+TEST(GameObjectTests, FindDeeplyNestedChildren) {
+  auto root = std::make_shared<DummyGameObject>();
+  std::vector<std::shared_ptr<DummyGameObject>> chain;
+  std::shared_ptr<GameObject> parent = root;
+  for (int i = 0; i < 8; i++) {
+    auto child = std::make_shared<DummyGameObject>();
+    parent->AddChild(child);
+    chain.push_back(child);
+    parent = child;
+  }
+
+  auto stray = std::make_shared<DummyGameObject>();
+  for (auto& object : chain) {
+    ASSERT_EQ(object, root->GetChild(object->GetId()));
+  }
+
+  // nothing finds itself, or anything above it, or anything outside of it
+  ASSERT_EQ(nullptr, root->GetChild(root->GetId()));
+  ASSERT_EQ(nullptr, chain[4]->GetChild(chain[2]->GetId()));
+  ASSERT_EQ(nullptr, root->GetChild(stray->GetId()));
+
+  // ids can be changed after the fact
+  chain[6]->SetId(0xBEEF0000);
+  ASSERT_EQ(chain[6], root->GetChild(0xBEEF0000));
+  ASSERT_EQ(chain[6], chain[5]->GetChild(0xBEEF0000));
+  ASSERT_EQ(nullptr, chain[6]->GetChild(0xBEEF0000));
+}
+
+TEST(GameObjectTests, RejectCycles) {
+  auto a = std::make_shared<DummyGameObject>();
+  auto b = std::make_shared<DummyGameObject>();
+  auto c = std::make_shared<DummyGameObject>();
+  a->AddChild(b);
+  b->AddChild(c);
+
+  c->AddChild(a);
+  c->AddChild(c);
+  ASSERT_EQ(nullptr, a->GetParent());
+  ASSERT_EQ(nullptr, c->GetChild(a->GetId()));
+  ASSERT_EQ(c, a->GetChild(c->GetId()));
+}
+
+TEST(GameObjectTests, ReparentedChildrenLeaveTheirOldParent) {
+  auto a = std::make_shared<DummyGameObject>();
+  auto b = std::make_shared<DummyGameObject>();
+  auto child = std::make_shared<DummyGameObject>();
+  auto grandchild = std::make_shared<DummyGameObject>();
+  a->AddChild(child);
+  child->AddChild(grandchild);
+
+  b->AddChild(child);
+  ASSERT_EQ(b, child->GetParent());
+  ASSERT_EQ(0, a->GetChildren().size());
+  ASSERT_EQ(nullptr, a->GetChild(grandchild->GetId()));
+  ASSERT_EQ(grandchild, b->GetChild(grandchild->GetId()));
+
+  // objects are forgotten once they're destroyed
+  uint64_t id = grandchild->GetId();
+  auto c = std::make_shared<DummyGameObject>();
+  c->AddChild(child);
+  child.reset();
+  grandchild.reset();
+  c.reset();
+
+  auto replacement = std::make_shared<DummyGameObject>();
+  replacement->SetId(id);
+  b->AddChild(replacement);
+  ASSERT_EQ(replacement, b->GetChild(id));
+}
+
+TEST(GameObjectTests, TakeIDsFromThreadBlocks) {
+  std::vector<std::unique_ptr<DummyGameObject>> outside;
+  std::vector<std::unique_ptr<DummyGameObject>> inside;
+  outside.push_back(std::make_unique<DummyGameObject>());
+  {
+    GameObject::IdBlockScope scope(16);
+    for (int i = 0; i < 40; i++) {
+      inside.push_back(std::make_unique<DummyGameObject>());
+    }
+  }
+
+  outside.push_back(std::make_unique<DummyGameObject>());
+
+  // consecutive within a block, and nothing after the scope reuses what it left over
+  for (int i = 1; i < 16; i++) {
+    ASSERT_EQ(inside[i - 1]->GetId() + 1, inside[i]->GetId());
+  }
+
+  ASSERT_LT(inside.back()->GetId(), outside.back()->GetId());
+  ASSERT_LT(outside.front()->GetId(), inside.front()->GetId());
+}
+
+TEST(GameObjectTests, AttachInBlocks) {
+  auto root = std::make_shared<DummyGameObject>();
+  size_t size = BareObject().GetRegistry()->GetSize();
+  {
+    GameObject::IdBlockScope scope(16);
+    std::vector<std::shared_ptr<DummyGameObject>> children;
+    for (int i = 0; i < 40; i++) {
+      children.push_back(std::make_shared<DummyGameObject>());
+      root->AddChild(children.back());
+    }
+
+    // lookups from this thread see everything attached so far
+    ASSERT_EQ(children.back(), root->GetChild(children.back()->GetId()));
+
+    // objects which go away while they're queued are never added
+    auto doomed_parent = std::make_shared<DummyGameObject>();
+    doomed_parent->AddChild(std::make_shared<DummyGameObject>());
+    doomed_parent.reset();
+  }
+
+  ASSERT_EQ(size + 40, BareObject().GetRegistry()->GetSize());
+}
+
+TEST(GameObjectTests, MovedFromObjectsLeaveTheRegistry) {
+  BareObject a;
+  uint64_t id = a.GetId();
+  auto registry = a.GetRegistry();
+  size_t size = registry->GetSize();
+
+  BareObject b(std::move(a));
+  ASSERT_EQ(id, b.GetId());
+  ASSERT_EQ(0, a.GetId());
+  ASSERT_EQ(size, registry->GetSize());
+
+  BareObject c;
+  c = std::move(b);
+  ASSERT_EQ(id, c.GetId());
+  ASSERT_EQ(size, registry->GetSize());
+  std::vector<std::shared_ptr<Object>> found;
+  registry->Find(0, &found);
+  ASSERT_TRUE(found.empty());
+}
+
+TEST(GameObjectTests, RegisterFromSeveralThreads) {
+  ObjectRegistry registry;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&registry, t] {
+      // the registry never dereferences what it's given
+      for (uintptr_t i = 1; i <= 10000; i++) {
+        auto object = reinterpret_cast<Object*>(i * 4 + t);
+        registry.Register(object, i);
+        if (i % 2 == 0) {
+          registry.Unregister(object, i);
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(4 * 5000, registry.GetSize());
+}
+
+TEST(GameObjectTests, LookupsRaceWithDestruction) {
+  // nothing is ever under `finder`, so every lookup fails -- but each one walks up from objects
+  // which another thread is busy destroying, and may end up holding the last reference to them
+  auto finder = std::make_shared<DummyGameObject>();
+  std::atomic<uint64_t> latest(0);
+  std::atomic<bool> done(false);
+  std::thread destroyer([&] {
+    for (int i = 0; i < 20000; i++) {
+      auto parent = std::make_shared<DummyGameObject>();
+      auto child = std::make_shared<DummyGameObject>();
+      parent->AddChild(child);
+      latest = child->GetId();
+    }
+
+    done = true;
+  });
+
+  while (!done) {
+    ASSERT_EQ(nullptr, finder->GetChild(latest.load()));
+  }
+
+  destroyer.join();
+}
+
+TEST(GameObjectTests, RenamedDescendantsAreStillFound) {
+  auto parent = std::make_shared<DummyGameObject>();
+  auto child = std::make_shared<DummyGameObject>();
+  auto grandchild = std::make_shared<DummyGameObject>();
+  child->AddChild(grandchild);
+  parent->AddChild(child);
+  ASSERT_EQ(grandchild, parent->GetChild(grandchild->GetId()));
+
+  // ID changes carry the reference over
+  grandchild->SetId(grandchild->GetId() + 1000000);
+  ASSERT_EQ(grandchild, parent->GetChild(grandchild->GetId()));
+}
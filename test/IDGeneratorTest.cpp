@@ -1,14 +1,19 @@
 #include <utils/IDGenerator.hpp>
 
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <set>
+#include <thread>
+#include <vector>
 
 using ::monkeysworld::utils::IDGenerator;
+using ::monkeysworld::utils::id_block;
 
 TEST(IDGeneratorTests, GetSingleID) {
   IDGenerator gen;
   uint64_t id = gen.GetUniqueId();
-  ASSERT_EQ(1, id);
+  // 1 is reserved for the window
+  ASSERT_EQ(2, id);
 }
 
 TEST(IDGeneratorTests, GenerateMultipleIDs) {
@@ -17,7 +22,7 @@ TEST(IDGeneratorTests, GenerateMultipleIDs) {
     gen.GetUniqueId();
   }
 
-  ASSERT_EQ(129, gen.GetUniqueId());
+  ASSERT_EQ(130, gen.GetUniqueId());
 }
 
 void WasteIDs(IDGenerator& gen) {
@@ -39,7 +44,7 @@ TEST(IDGeneratorTests, MultiThreadGeneration) {
     threads[i].join();
   }
 
-  ASSERT_EQ(129, gen.GetUniqueId());
+  ASSERT_EQ(130, gen.GetUniqueId());
 
 }
 
@@ -65,4 +70,75 @@ TEST(IDGeneratorTests, EnsureIDsUnique) {
     ASSERT_TRUE(ids.find(id) == ids.end());
     ids.insert(id);
   }
-}
\ No newline at end of file
+}
+
+TEST(IDGeneratorTests, BlocksStopShortOfUsedIDs) {
+  IDGenerator gen;
+  gen.RegisterUniqueId(12);
+  gen.RegisterUniqueId(11);
+  gen.RegisterUniqueId(13);
+  gen.RegisterUniqueId(20);
+  gen.RegisterUniqueId(12);
+
+  id_block block = gen.GetUniqueIds(64);
+  ASSERT_EQ(2, block.first);
+  ASSERT_EQ(11, block.end);
+
+  block = gen.GetUniqueIds(64);
+  ASSERT_EQ(14, block.first);
+  ASSERT_EQ(20, block.end);
+
+  block = gen.GetUniqueIds(4);
+  ASSERT_EQ(21, block.first);
+  ASSERT_EQ(25, block.end);
+
+  // too late to reserve these
+  gen.RegisterUniqueId(3);
+  gen.RegisterUniqueId(24);
+  ASSERT_EQ(25, gen.GetUniqueId());
+}
+
+TEST(IDGeneratorTests, ManyThreadsNeverShareIDs) {
+  const int THREADS = 16;
+  const int IDS_PER_THREAD = 20000;
+  IDGenerator gen;
+  std::vector<uint64_t> reserved;
+  for (uint64_t id = 100; id < 300000; id += 97) {
+    reserved.push_back(id);
+    gen.RegisterUniqueId(id);
+  }
+
+  std::vector<std::vector<uint64_t>> ids(THREADS);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < THREADS; i++) {
+    threads.push_back(std::thread([&, i] {
+      auto& mine = ids[i];
+      while (mine.size() < IDS_PER_THREAD) {
+        if (i % 2 == 0) {
+          mine.push_back(gen.GetUniqueId());
+        } else {
+          id_block block = gen.GetUniqueIds(1 + mine.size() % 37);
+          for (uint64_t id = block.first; id < block.end; id++) {
+            mine.push_back(id);
+          }
+        }
+      }
+    }));
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  std::vector<uint64_t> all;
+  for (auto& mine : ids) {
+    all.insert(all.end(), mine.begin(), mine.end());
+  }
+
+  std::sort(all.begin(), all.end());
+  ASSERT_TRUE(std::adjacent_find(all.begin(), all.end()) == all.end());
+  ASSERT_EQ(2, all.front());
+  for (auto id : reserved) {
+    ASSERT_FALSE(std::binary_search(all.begin(), all.end(), id));
+  }
+}
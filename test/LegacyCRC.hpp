@@ -0,0 +1,60 @@
+#ifndef LEGACY_CRC_H_
+#define LEGACY_CRC_H_
+
+// the original byte-at-a-time CalculateCRCHash, kept as a reference implementation
+// for checking that the current CRC produces identical hashes.
+
+#include <cinttypes>
+#include <istream>
+
+namespace legacycrc {
+
+inline uint32_t CalculateCRCHash(std::istream& input, std::streamoff offset) {
+  uint32_t crc_table[256];
+  uint32_t crc;
+
+  for (int i = 0; i < 256; i++) {
+    crc = i;
+    for (int j = 0; j < 8; j++) {
+      if (crc & 1) {
+        crc >>= 1;
+        crc ^= 0x04C11DB7;
+      } else {
+        crc >>= 1;
+      }
+    }
+    crc_table[i] = crc;
+  }
+
+  crc = 0xFFFFFFFF;
+  char c;
+  std::streampos pos_initial = input.tellg();
+  input.seekg(offset);
+
+  while ((c = input.get()) != EOF) {
+    crc = (crc >> 8) ^ crc_table[(c ^ crc) & 0xFF];
+  }
+
+  input.clear();
+  input.seekg(pos_initial);
+  return ~crc;
+}
+
+/**
+ *  Bitwise CRC over a buffer, with the same polynomial. Doesn't stop at 0xFF.
+ */
+inline uint32_t BitwiseCRC(const unsigned char* data, size_t size) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (int j = 0; j < 8; j++) {
+      crc = (crc & 1) ? ((crc >> 1) ^ 0x04C11DB7) : (crc >> 1);
+    }
+  }
+
+  return ~crc;
+}
+
+}
+
+#endif  // LEGACY_CRC_H_
@@ -0,0 +1,148 @@
+#ifndef LEGACY_OBJ_PARSER_H_
+#define LEGACY_OBJ_PARSER_H_
+
+// the original getline/boost::split OBJ parser, kept as a reference implementation
+// for checking that the current parser produces identical meshes.
+// only handles faces with full v/t/n corners, and positive indices.
+
+#include <model/Mesh.hpp>
+#include <storage/VertexPacketTypes.hpp>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace legacyobj {
+
+using ::monkeysworld::model::Mesh;
+using ::monkeysworld::storage::VertexPacket3D;
+
+struct vnt_triplet {
+  uint32_t v_index;
+  uint32_t n_index;
+  uint32_t t_index;
+};
+
+inline bool operator==(const vnt_triplet& lhs, const vnt_triplet& rhs) {
+  return (lhs.v_index == rhs.v_index
+       && lhs.n_index == rhs.n_index
+       && lhs.t_index == rhs.t_index);
+}
+
+struct vnt_triplet_hash {
+  std::size_t operator()(vnt_triplet const& triplet) const noexcept {
+    uint64_t res = triplet.v_index * 0x9E3779B97F4A7C15ull;
+    res ^= triplet.n_index * 0xC2B2AE3D27D4EB4Full;
+    res ^= triplet.t_index * 0x165667B19E3779F9ull;
+    return static_cast<std::size_t>(res ^ (res >> 32));
+  }
+};
+
+inline void TrimHeader(std::string& line) {
+  line.erase(line.begin(), std::find_if(line.begin(), line.end(), [](char c) {
+    return ((c >= '0' && c <= '9') || c == '-' || c == '/');
+  }));
+}
+
+inline void InsertFaceIndices(std::unordered_map<vnt_triplet, unsigned int, vnt_triplet_hash>& map,
+                              std::string& line,
+                              std::vector<std::vector<unsigned int>>& poly_data,
+                              std::vector<vnt_triplet>& vert_triplets_ordered,
+                              unsigned int* vert_count) {
+  std::vector<std::string> verts;
+  std::vector<unsigned int> ind_data;
+  TrimHeader(line);
+  boost::split(verts, line, [](char c){ return std::isspace(c); }, boost::token_compress_on);
+  for (auto vert : verts) {
+    if (vert.size() == 0) {
+      continue;
+    }
+
+    std::vector<std::string> coord_inds;
+    boost::split(coord_inds, vert, [](char c){ return c == '/'; }, boost::token_compress_off);
+    vnt_triplet t;
+    t.v_index = (coord_inds[0].empty() ? 0 : boost::lexical_cast<uint32_t>(coord_inds[0]));
+    t.t_index = (coord_inds[1].empty() ? 0 : boost::lexical_cast<uint32_t>(coord_inds[1]));
+    t.n_index = (coord_inds[2].empty() ? 0 : boost::lexical_cast<uint32_t>(coord_inds[2]));
+
+    auto triplet_entry = map.find(t);
+    if (triplet_entry == map.end()) {
+      map.insert(std::make_pair(t, *vert_count));
+      vert_triplets_ordered.push_back(t);
+      ind_data.push_back(*vert_count);
+      (*vert_count)++;
+    } else {
+      ind_data.push_back(triplet_entry->second);
+    }
+  }
+
+  poly_data.push_back(std::move(ind_data));
+}
+
+inline std::shared_ptr<Mesh<VertexPacket3D>> FromObjFile(const std::string& path) {
+  auto obj_stream = std::ifstream(path);
+  std::string line_data;
+  std::unordered_map<vnt_triplet, unsigned int, vnt_triplet_hash> vert_triplets;
+  std::vector<vnt_triplet> vert_triplets_ordered;
+  std::vector<std::vector<unsigned int>> poly_data;
+  std::vector<glm::vec3> position_data;
+  std::vector<glm::vec2> texcoord_data;
+  std::vector<glm::vec3> normal_data;
+  unsigned int vert_count = 0;
+  while (!obj_stream.eof()) {
+    std::getline(obj_stream, line_data);
+    if (line_data[0] == 'f') {
+      InsertFaceIndices(vert_triplets, line_data, poly_data, vert_triplets_ordered, &vert_count);
+    } else if (line_data[0] == 'v') {
+      char type = line_data[1];
+      TrimHeader(line_data);
+
+      std::vector<std::string> vals;
+      boost::split(vals, line_data, [](char c){ return std::isspace(c); }, boost::token_compress_on);
+      glm::vec3 data(0.0);
+      for (int i = 0; i < vals.size() && i < 3; i++) {
+        if (vals[i].size() > 0) {
+          try {
+            data[i] = boost::lexical_cast<float>(vals[i]);
+          } catch (boost::bad_lexical_cast e) {
+            data[i] = 0.0f;
+          }
+        }
+      }
+
+      if (type == 'n') {
+        normal_data.push_back(data);
+      } else if (type == 't') {
+        texcoord_data.push_back(glm::vec2(data.x, data.y));
+      } else {
+        position_data.push_back(data);
+      }
+    }
+  }
+
+  auto mesh = std::make_shared<Mesh<VertexPacket3D>>();
+  VertexPacket3D temp_data;
+  for (auto vert_triplet : vert_triplets_ordered) {
+    temp_data.position = (vert_triplet.v_index == 0 ? glm::vec3(0) : position_data[vert_triplet.v_index - 1]);
+    temp_data.coords = (vert_triplet.t_index == 0 ? glm::vec2(0) : texcoord_data[vert_triplet.t_index - 1]);
+    temp_data.normals = (vert_triplet.n_index == 0 ? glm::vec3(1, 0, 0) : normal_data[vert_triplet.n_index - 1]);
+    mesh->AddVertex(temp_data);
+  }
+
+  for (auto& poly : poly_data) {
+    mesh->AddPolygon(poly);
+  }
+
+  return mesh;
+}
+
+}
+
+#endif  // LEGACY_OBJ_PARSER_H_
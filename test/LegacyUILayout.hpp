@@ -0,0 +1,228 @@
+#ifndef LEGACY_UI_LAYOUT_H_
+#define LEGACY_UI_LAYOUT_H_
+
+// the original UIGroup::Layout, which re-solved every child on every pass. kept as a reference
+// for checking that incremental layout places everything identically, and as a benchmark baseline.
+
+#include <critter/ui/UIGroup.hpp>
+#include <critter/ui/layout/BoundingBox.hpp>
+#include <utils/ObjectGraph.hpp>
+
+#include <boost/log/trivial.hpp>
+
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace legacyui {
+
+using ::monkeysworld::critter::ui::UIGroup;
+using ::monkeysworld::critter::ui::UIObject;
+using ::monkeysworld::critter::ui::layout::Face;
+using ::monkeysworld::critter::ui::layout::MarginType;
+using ::monkeysworld::utils::ObjectGraph;
+namespace layout = ::monkeysworld::critter::ui::layout;
+
+inline void Layout(UIGroup* group) {
+  ObjectGraph o;
+  
+  for (auto& obj : group->GetChildren()) {
+    auto child = std::static_pointer_cast<UIObject>(obj);
+    layout::UILayoutParams param = child->GetLayoutParams();
+
+    int i = 0;
+    for (layout::Margin* m = reinterpret_cast<layout::Margin*>(&param); i < 4; i++, m++) {
+      if (m->anchor_id != 0) {
+        // if we encounter a vertex which is not a child, break out.
+        o.AddEdge(m->anchor_id, child->GetId());
+      }
+    }
+  }
+
+  std::vector<uint64_t> sort = o.TopoSort();
+
+  std::unordered_map<uint64_t, layout::BoundingBox> bounding_boxes;
+  glm::vec2 dims_local = group->GetDimensions();
+  // working box
+  layout::BoundingBox b;
+  // represents the containing group
+  b.left = 0;
+  b.right = dims_local.x;
+  b.top = 0;
+  b.bottom = dims_local.y;
+  bounding_boxes.insert(std::make_pair(group->GetId(), b));
+  // handle invalid orderings below
+  //  - if we encounter a node in our topo sort which is not a child, or not the group,
+  //    then break run some fallback method which just reads positions + dimensions.
+  //  - only once we have a bounding box for every node will we adjust positions + dimensions.
+  for (auto id : sort) {
+    if (id == group->GetId()) {
+      // avoid laying out myself
+      continue;
+    }
+    auto child = std::dynamic_pointer_cast<UIObject>(group->GetChild(id));
+    if (!child) {
+      BOOST_LOG_TRIVIAL(error) << "current layout invalid -- child with ID " << id << " not found in UIObject ID " << group->GetId() << "!";
+      return;
+    }
+
+    auto params = child->GetLayoutParams();
+
+    glm::vec2 child_dims = child->GetDimensions();
+    glm::vec2 child_pos = child->GetPosition();
+
+    // insert default values
+    b.top = child_pos.y;
+    b.left = child_pos.x;
+    b.bottom = b.top + child_dims.y;
+    b.right = b.left + child_dims.x;
+    
+    // top/bottom
+    if (params.top.anchor_id != 0) {
+      const layout::BoundingBox& box = bounding_boxes.at(params.top.anchor_id);
+      switch (params.top.anchor_face) {
+        case Face::BOTTOM:
+          b.top = box.bottom;
+          break;
+        case Face::TOP:
+          b.top = box.top;
+          break;
+        default:
+          BOOST_LOG_TRIVIAL(error) << "Invalid face provided for ID " << id << "'s top margin -- ignoring...";
+        // all others are invalid
+      }
+
+      if (params.bottom.anchor_id == 0) {
+        b.bottom = b.top + child_dims.y;
+      }
+    }
+
+    if (params.bottom.anchor_id != 0) {
+      const layout::BoundingBox& box = bounding_boxes.at(params.bottom.anchor_id);
+      switch (params.bottom.anchor_face) {
+        case Face::BOTTOM:
+          b.bottom = box.bottom;
+          break;
+        case Face::TOP:
+          b.bottom = box.top;
+          break;
+        default:
+          BOOST_LOG_TRIVIAL(error) << "Invalid face provided for ID " << id << "'s bottom margin -- ignoring...";
+      }
+
+      if (params.top.anchor_id == 0) {
+        b.top = b.bottom - child_dims.y;
+      }
+    }
+
+    // left/right
+    if (params.left.anchor_id != 0) {
+      const layout::BoundingBox& box = bounding_boxes.at(params.left.anchor_id);
+      switch (params.left.anchor_face) {
+        case Face::LEFT:
+          b.left = box.left;
+          break;
+        case Face::RIGHT:
+          b.left = box.right;
+          break;
+        default:
+          BOOST_LOG_TRIVIAL(error) << "Invalid face provided for ID " << id << "'s left margin -- ignoring...";
+      }
+
+      if (params.right.anchor_id == 0) {
+        b.right = b.left + child_dims.x;
+      }
+    }
+
+    if (params.right.anchor_id != 0) {
+      const layout::BoundingBox& box = bounding_boxes.at(params.right.anchor_id);
+      switch (params.right.anchor_face) {
+        case Face::LEFT:
+          b.right = box.left;
+          break;
+        case Face::RIGHT:
+          b.right = box.right;
+          break;
+        default:
+          BOOST_LOG_TRIVIAL(error) << "Invalid face provided for ID " << id << "'s right margin -- ignoring...";
+      }
+
+      if (params.left.anchor_id == 0) {
+        b.left = b.right - child_dims.x;
+      }
+    }
+
+    // handle autos
+    if (params.top.margin.type == MarginType::AUTO || params.bottom.margin.type == MarginType::AUTO) {
+      // total range
+      float y_range = b.bottom - b.top;
+      // margin shrink on both sides
+      float y_squeeze = (y_range - child_dims.y) / 2;
+      b.top += y_squeeze;
+      b.bottom -= y_squeeze;
+    } else {
+      if (params.top.anchor_id != 0) {
+        b.top += params.top.margin.dist;
+        if (params.bottom.anchor_id == 0) {
+          b.bottom += params.top.margin.dist;
+        }
+      }
+
+      if (params.bottom.anchor_id != 0) {
+        b.bottom -= params.bottom.margin.dist;
+        if (params.top.anchor_id == 0) {
+          b.top -= params.bottom.margin.dist;
+        }
+      }
+    }
+
+    // BOOST_LOG_TRIVIAL(trace) << b.top << ", " << b.bottom << ", " << b.left << ", " << b.right;
+
+    if (params.left.margin.type == MarginType::AUTO || params.right.margin.type == MarginType::AUTO) {
+      float x_range = b.right - b.left;
+      float x_squeeze = (x_range - child_dims.x) / 2;
+      b.left += x_squeeze;
+      b.right -= x_squeeze;
+    } else {
+      if (params.left.anchor_id != 0) {
+        b.left += params.left.margin.dist;
+        if (params.right.anchor_id == 0) {
+          b.right += params.left.margin.dist;
+        }
+      }
+
+      if (params.right.anchor_id != 0) {
+        b.right -= params.right.margin.dist;
+        if (params.left.anchor_id == 0) {
+          b.left -= params.right.margin.dist;
+        }
+      }
+    }
+
+    b.top = std::round(b.top);
+    b.bottom = std::round(b.bottom);
+    b.left = std::round(b.left);
+    b.right = std::round(b.right);
+    bounding_boxes.insert(std::make_pair(id, b));
+    // BOOST_LOG_TRIVIAL(trace) << b.top << ", " << b.bottom << ", " << b.left << ", " << b.right;
+  }
+
+  // once this has run for all components, our bounding boxes are defined for every component.
+  // now we can lay them out!
+  for (const auto& e : bounding_boxes) {
+    if (e.first == group->GetId()) {
+      // only there for children to anchor to
+      continue;
+    }
+
+    auto child = std::dynamic_pointer_cast<UIObject>(group->GetChild(e.first));
+    auto bb = e.second;
+    child->SetPosition(glm::vec2(bb.left, bb.top));
+    child->SetDimensions(glm::vec2(bb.right - bb.left, bb.bottom - bb.top));
+  }
+}
+
+}
+
+#endif  // LEGACY_UI_LAYOUT_H_
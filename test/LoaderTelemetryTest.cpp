@@ -0,0 +1,297 @@
+#include <file/FileLoader.hpp>
+#include <file/LoaderTelemetry.hpp>
+#include <file/ModelLoader.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TempDir.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using ::monkeysworld::file::asset_timing;
+using ::monkeysworld::file::CacheType;
+using ::monkeysworld::file::cache_record;
+using ::monkeysworld::file::FileLoader;
+using ::monkeysworld::file::LoaderTelemetry;
+using ::monkeysworld::file::LoaderThreadPool;
+using ::monkeysworld::file::LoadPhase;
+using ::monkeysworld::file::ModelLoader;
+using ::testfiles::TempDir;
+
+static void WriteWholeFile(const std::string& path, const std::string& contents) {
+  std::ofstream output(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  output.write(contents.data(), contents.size());
+}
+
+/**
+ *  Clock which only moves when told to, so recorded times are exact.
+ */
+class ManualClock {
+ public:
+  std::function<uint64_t()> Get() {
+    return [this] { return now_.load(); };
+  }
+
+  void Advance(uint64_t ms) {
+    now_ += ms * 1000000;
+  }
+
+ private:
+  std::atomic<uint64_t> now_ = 1000;
+};
+
+/**
+ *  Counts unescaped braces and brackets, to check that output is at least well nested.
+ */
+static bool IsBalanced(const std::string& json) {
+  int depth = 0;
+  bool in_string = false;
+  for (size_t i = 0; i < json.size(); i++) {
+    char c = json[i];
+    if (in_string) {
+      if (c == '\\') {
+        i++;
+      } else if (c == '"') {
+        in_string = false;
+      }
+    } else if (c == '"') {
+      in_string = true;
+    } else if (c == '{' || c == '[') {
+      depth++;
+    } else if (c == '}' || c == ']') {
+      if (--depth < 0) {
+        return false;
+      }
+    }
+  }
+
+  return (depth == 0 && !in_string);
+}
+
+TEST(LoaderTelemetryTests, PhasesAreAttributedInOrder) {
+  ManualClock clock;
+  LoaderTelemetry telemetry(4096, clock.Get());
+  uint64_t queued_at = telemetry.GetTime();
+  clock.Advance(5);
+  {
+    LoaderTelemetry::AssetScope scope(&telemetry, CacheType::TEXTURE, "tex.png", queued_at);
+    scope.SetBytes(1024);
+    clock.Advance(10);
+    LoaderTelemetry::MarkPhase(LoadPhase::PHASE_IO);
+    clock.Advance(20);
+  }
+
+  auto snapshot = telemetry.GetSnapshot();
+  ASSERT_EQ(1, snapshot.assets.size());
+  const asset_timing& asset = snapshot.assets[0];
+  ASSERT_EQ(CacheType::TEXTURE, asset.type);
+  ASSERT_EQ("tex.png", asset.path);
+  ASSERT_EQ(1024, asset.bytes);
+  ASSERT_EQ(queued_at, asset.start_ns);
+  ASSERT_EQ(5000000, asset.phase_ns[LoadPhase::PHASE_QUEUE]);
+  ASSERT_EQ(10000000, asset.phase_ns[LoadPhase::PHASE_IO]);
+  // leftover time is decode
+  ASSERT_EQ(20000000, asset.phase_ns[LoadPhase::PHASE_DECODE]);
+  ASSERT_EQ(0, asset.phase_ns[LoadPhase::PHASE_UPLOAD]);
+
+  auto& loader = snapshot.loaders[CacheType::TEXTURE];
+  ASSERT_EQ(1, loader.assets);
+  ASSERT_EQ(1024, loader.bytes);
+  // queue time isn't work
+  ASSERT_DOUBLE_EQ(1024 / 0.03, loader.bytes_per_second);
+  ASSERT_EQ(0, snapshot.loaders[CacheType::MODEL].assets);
+}
+
+TEST(LoaderTelemetryTests, NestedAndNullScopesDontLeak) {
+  ManualClock clock;
+  LoaderTelemetry telemetry(4096, clock.Get());
+  {
+    LoaderTelemetry::AssetScope outer(&telemetry, CacheType::MODEL, "outer.obj");
+    {
+      // a scope without telemetry still swallows marks made beneath it
+      LoaderTelemetry::AssetScope inner(nullptr, CacheType::MODEL, "inner.obj");
+      clock.Advance(10);
+      LoaderTelemetry::MarkPhase(LoadPhase::PHASE_IO);
+    }
+
+    LoaderTelemetry::AssetScope cancelled(&telemetry, CacheType::MODEL, "cancelled.obj");
+    cancelled.Cancel();
+  }
+
+  // outside of any scope, this does nothing
+  LoaderTelemetry::MarkPhase(LoadPhase::PHASE_IO);
+
+  auto snapshot = telemetry.GetSnapshot();
+  ASSERT_EQ(1, snapshot.assets.size());
+  ASSERT_EQ("outer.obj", snapshot.assets[0].path);
+  ASSERT_EQ(0, snapshot.assets[0].phase_ns[LoadPhase::PHASE_IO]);
+  ASSERT_EQ(10000000, snapshot.assets[0].phase_ns[LoadPhase::PHASE_DECODE]);
+}
+
+TEST(LoaderTelemetryTests, SlowestAreRankedByWorkTime) {
+  ManualClock clock;
+  LoaderTelemetry telemetry(4096, clock.Get());
+  int durations[] = { 2, 12, 6, 1, 9 };
+  for (int i = 0; i < 5; i++) {
+    LoaderTelemetry::AssetScope scope(&telemetry, CacheType::FILE, "file" + std::to_string(i));
+    clock.Advance(durations[i]);
+  }
+
+  auto snapshot = telemetry.GetSnapshot(3);
+  ASSERT_EQ(5, snapshot.assets.size());
+  ASSERT_EQ(3, snapshot.slowest.size());
+  ASSERT_EQ("file1", snapshot.slowest[0].path);
+  ASSERT_EQ("file4", snapshot.slowest[1].path);
+  ASSERT_EQ("file2", snapshot.slowest[2].path);
+  ASSERT_DOUBLE_EQ(0.03, snapshot.elapsed_seconds);
+}
+
+TEST(LoaderTelemetryTests, UploadsAreMergedIntoTheirAsset) {
+  LoaderTelemetry telemetry;
+  {
+    LoaderTelemetry::AssetScope scope(&telemetry, CacheType::TEXTURE, "a.png");
+  }
+
+  {
+    LoaderTelemetry::AssetScope scope(&telemetry, CacheType::TEXTURE, "b.png");
+  }
+
+  telemetry.RecordUpload(CacheType::TEXTURE, "a.png", telemetry.GetTime(), 50000000);
+
+  auto snapshot = telemetry.GetSnapshot(1);
+  ASSERT_EQ(2, snapshot.assets.size());
+  ASSERT_EQ(50000000, snapshot.assets[0].phase_ns[LoadPhase::PHASE_UPLOAD]);
+  ASSERT_EQ(0, snapshot.assets[1].phase_ns[LoadPhase::PHASE_UPLOAD]);
+  ASSERT_EQ("a.png", snapshot.slowest[0].path);
+  ASSERT_EQ(2, snapshot.loaders[CacheType::TEXTURE].assets);
+  ASSERT_EQ(50000000, snapshot.loaders[CacheType::TEXTURE].phase_ns[LoadPhase::PHASE_UPLOAD]);
+}
+
+TEST(LoaderTelemetryTests, EventsPastCapacityAreDropped) {
+  LoaderTelemetry telemetry(4);
+  for (int i = 0; i < 10; i++) {
+    LoaderTelemetry::AssetScope scope(&telemetry, CacheType::FONT, "font" + std::to_string(i));
+    scope.SetBytes(10);
+  }
+
+  auto snapshot = telemetry.GetSnapshot();
+  ASSERT_EQ(4, snapshot.assets.size());
+  ASSERT_EQ(6, snapshot.dropped);
+  // totals still count everything
+  ASSERT_EQ(10, snapshot.loaders[CacheType::FONT].assets);
+  ASSERT_EQ(100, snapshot.loaders[CacheType::FONT].bytes);
+}
+
+TEST(LoaderTelemetryTests, ConcurrentRecording) {
+  LoaderTelemetry telemetry;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.push_back(std::thread([&telemetry, t] {
+      for (int i = 0; i < 250; i++) {
+        LoaderTelemetry::AssetScope scope(&telemetry, CacheType::MODEL, std::to_string(t) + "/" + std::to_string(i));
+        scope.SetBytes(1);
+        LoaderTelemetry::MarkPhase(LoadPhase::PHASE_IO);
+      }
+    }));
+  }
+
+  // snapshots may be taken while recording is underway
+  auto partial = telemetry.GetSnapshot();
+  ASSERT_LE(partial.assets.size(), 2000);
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto snapshot = telemetry.GetSnapshot();
+  ASSERT_EQ(2000, snapshot.assets.size());
+  ASSERT_EQ(2000, snapshot.loaders[CacheType::MODEL].assets);
+  ASSERT_EQ(2000, snapshot.loaders[CacheType::MODEL].bytes);
+  ASSERT_EQ(0, snapshot.dropped);
+}
+
+TEST(LoaderTelemetryTests, ProgressIsSummedAcrossLoaders) {
+  LoaderTelemetry telemetry;
+  telemetry.AddExpectedBytes(CacheType::MODEL, 100);
+  telemetry.AddExpectedBytes(CacheType::TEXTURE, 50);
+  telemetry.AddLoadedBytes(CacheType::MODEL, 100);
+  auto progress = telemetry.GetProgress();
+  ASSERT_EQ(100, progress.bytes_read);
+  ASSERT_EQ(150, progress.bytes_sum);
+}
+
+TEST(LoaderTelemetryTests, ExportsAreWellFormed) {
+  LoaderTelemetry telemetry;
+  uint64_t queued_at = telemetry.GetTime();
+  {
+    LoaderTelemetry::AssetScope scope(&telemetry, CacheType::MODEL, "quote\"and\\slash.obj", queued_at);
+    scope.SetBytes(64);
+    LoaderTelemetry::MarkPhase(LoadPhase::PHASE_IO);
+  }
+
+  telemetry.RecordUpload(CacheType::TEXTURE, "tex.png", telemetry.GetTime(), 1000);
+
+  std::stringstream json;
+  telemetry.WriteJSON(json);
+  std::string json_str = json.str();
+  ASSERT_TRUE(IsBalanced(json_str));
+  ASSERT_NE(std::string::npos, json_str.find("\"slowest\""));
+  ASSERT_NE(std::string::npos, json_str.find("\"model\": { \"assets\": 1, \"bytes\": 64"));
+  ASSERT_NE(std::string::npos, json_str.find("quote\\\"and\\\\slash.obj"));
+
+  std::stringstream trace;
+  telemetry.WriteChromeTrace(trace);
+  std::string trace_str = trace.str();
+  ASSERT_TRUE(IsBalanced(trace_str));
+  ASSERT_EQ(0, trace_str.find("{\"displayTimeUnit\": \"ms\", \"traceEvents\": ["));
+  ASSERT_NE(std::string::npos, trace_str.find("\"cat\": \"io\""));
+  ASSERT_NE(std::string::npos, trace_str.find("\"cat\": \"upload\""));
+  ASSERT_NE(std::string::npos, trace_str.find("\"ph\": \"b\""));
+
+  TempDir dir;
+  ASSERT_TRUE(telemetry.WriteChromeTrace(dir.Get("telemetry-trace.json")));
+}
+
+TEST(LoaderTelemetryTests, LoadersReportPrefetchAndMisses) {
+  TempDir dir;
+  std::string cached_path = dir.Get("telemetry-cached.obj");
+  std::string missed_path = dir.Get("telemetry-missed.txt");
+  WriteWholeFile(cached_path, "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+  WriteWholeFile(missed_path, "not cached yet");
+
+  auto telemetry = std::make_shared<LoaderTelemetry>();
+  auto threadpool = std::make_shared<LoaderThreadPool>(2);
+  cache_record record;
+  record.type = CacheType::MODEL;
+  record.path = cached_path;
+  record.file_size = 32;
+
+  ModelLoader models(threadpool, { record }, nullptr, telemetry, dir.Get(""));
+  FileLoader files(threadpool, std::vector<cache_record>(), nullptr, telemetry);
+  models.WaitUntilLoaded();
+  auto progress = telemetry->GetProgress();
+  ASSERT_EQ(32, progress.bytes_sum);
+  ASSERT_EQ(32, progress.bytes_read);
+
+  auto buf = files.LoadFile(missed_path);
+  std::istream input(&buf);
+  std::string contents(std::istreambuf_iterator<char>(input), (std::istreambuf_iterator<char>()));
+  ASSERT_EQ("not cached yet", contents);
+  // hits aren't timed
+  ASSERT_NE(nullptr, models.LoadFile(cached_path));
+
+  auto snapshot = telemetry->GetSnapshot();
+  ASSERT_EQ(2, snapshot.assets.size());
+  ASSERT_EQ(1, snapshot.loaders[CacheType::MODEL].assets);
+  ASSERT_EQ(32, snapshot.loaders[CacheType::MODEL].bytes);
+  ASSERT_EQ(1, snapshot.loaders[CacheType::FILE].assets);
+  ASSERT_EQ(14, snapshot.loaders[CacheType::FILE].bytes);
+  ASSERT_GT(snapshot.loaders[CacheType::FILE].phase_ns[LoadPhase::PHASE_IO], 0);
+}
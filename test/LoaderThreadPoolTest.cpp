@@ -1,7 +1,15 @@
 #include <file/LoaderThreadPool.hpp>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 using ::monkeysworld::file::LoaderThreadPool;
+using ::monkeysworld::file::PRIORITY_HIGH;
+using ::monkeysworld::file::PRIORITY_LOW;
 
 TEST(LoaderThreadPoolTests, CreateThreadPool) {
   int test = 0;
@@ -38,4 +46,100 @@ TEST(LoaderThreadPoolTests, MultipleTasks) {
   }
 
   ASSERT_EQ(512, test.load());
-}
\ No newline at end of file
+}
+
+TEST(LoaderThreadPoolTests, SubmitReturnsFuture) {
+  LoaderThreadPool pool(4);
+  auto res = pool.Submit([] { return 42; });
+  ASSERT_EQ(42, res.get());
+
+  auto thrown = pool.Submit([]() -> int { throw std::runtime_error("oops"); });
+  ASSERT_THROW(thrown.get(), std::runtime_error);
+}
+
+TEST(LoaderThreadPoolTests, HighPriorityRunsFirst) {
+  LoaderThreadPool pool(1);
+  std::promise<void> gate;
+  std::shared_future<void> gate_future = gate.get_future().share();
+  std::mutex order_lock;
+  std::vector<int> order;
+
+  // occupy the only worker while we queue up tasks
+  auto blocker = pool.Submit([gate_future] { gate_future.wait(); });
+  std::vector<std::future<void>> results;
+  for (int i = 0; i < 4; i++) {
+    results.push_back(pool.Submit([&, i] {
+      std::lock_guard<std::mutex> lock(order_lock);
+      order.push_back(i);
+    }, (i % 2 == 0 ? PRIORITY_LOW : PRIORITY_HIGH)));
+  }
+
+  gate.set_value();
+  for (auto& r : results) {
+    r.wait();
+  }
+
+  ASSERT_EQ(std::vector<int>({ 1, 3, 0, 2 }), order);
+}
+
+TEST(LoaderThreadPoolTests, StatsAndStealing) {
+  LoaderThreadPool pool(4);
+  // all subtasks land on a single worker's deque -- the rest have to steal them
+  auto spawner = pool.Submit([&pool] {
+    std::vector<std::future<void>> subtasks;
+    for (int i = 0; i < 64; i++) {
+      subtasks.push_back(pool.Submit([] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      }));
+    }
+
+    return subtasks;
+  });
+
+  auto subtasks = spawner.get();
+  for (auto& s : subtasks) {
+    s.wait();
+  }
+
+  auto stats = pool.GetWorkerStats();
+  ASSERT_EQ(4, stats.size());
+  uint64_t tasks = 0;
+  uint64_t steals = 0;
+  for (auto& s : stats) {
+    tasks += s.tasks_run;
+    steals += s.steals;
+    ASSERT_GE(s.idle_seconds, 0.0);
+  }
+
+  // the spawner plus its 64 subtasks
+  ASSERT_EQ(65, tasks);
+  ASSERT_GT(steals, 0);
+}
+
+TEST(LoaderThreadPoolTests, RunPendingTaskOnCaller) {
+  LoaderThreadPool pool(1);
+  std::promise<void> started;
+  std::promise<void> gate;
+  std::shared_future<void> gate_future = gate.get_future().share();
+
+  // wait until the only worker is busy, so that the next task stays queued
+  auto blocker = pool.Submit([&started, gate_future] {
+    started.set_value();
+    gate_future.wait();
+  });
+
+  started.get_future().wait();
+  std::thread::id ran_on;
+  auto queued = pool.Submit([&ran_on] { ran_on = std::this_thread::get_id(); });
+  ASSERT_TRUE(pool.RunPendingTask());
+  ASSERT_EQ(std::this_thread::get_id(), ran_on);
+  queued.get();
+
+  ASSERT_FALSE(pool.RunPendingTask());
+  gate.set_value();
+  blocker.get();
+
+  // nobody to hand tasks to, so nothing is ever pending
+  LoaderThreadPool empty(0);
+  ASSERT_FALSE(empty.RunPendingTask());
+}
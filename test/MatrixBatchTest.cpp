@@ -0,0 +1,136 @@
+#include <utils/MatrixBatch.hpp>
+
+#include <gtest/gtest.h>
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/euler_angles.hpp>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using ::monkeysworld::utils::MatrixBatch;
+
+static const MatrixBatch::Kernel KERNELS[] = {
+  MatrixBatch::KERNEL_SCALAR,
+  MatrixBatch::KERNEL_SSE,
+  MatrixBatch::KERNEL_AVX2
+};
+
+// covers empty input, partial batches, and several full ones with a tail
+static const size_t COUNTS[] = { 0, 1, 3, 4, 7, 8, 9, 17, 100, 1003 };
+
+static glm::mat4 ExpectedModel(const glm::vec3& pos, const glm::vec3& rot, const glm::vec3& scale) {
+  glm::mat4 res = glm::translate(glm::mat4(1.0), pos);
+  res *= glm::eulerAngleYXZ(rot.y, rot.x, rot.z);
+  return glm::scale(res, scale);
+}
+
+static void AssertNear(float expected, float actual) {
+  ASSERT_NEAR(expected, actual, 1e-4f + 1e-5f * std::abs(expected));
+}
+
+static std::vector<glm::vec3> RandomVectors(std::mt19937& gen, size_t count, float lo, float hi) {
+  std::uniform_real_distribution<float> dist(lo, hi);
+  std::vector<glm::vec3> res(count);
+  for (auto& v : res) {
+    v = glm::vec3(dist(gen), dist(gen), dist(gen));
+  }
+
+  return res;
+}
+
+TEST(MatrixBatchTests, ComposeMatchesGLM) {
+  std::mt19937 gen(1);
+  for (auto kernel : KERNELS) {
+    for (auto count : COUNTS) {
+      auto pos = RandomVectors(gen, count, -100.0f, 100.0f);
+      // several turns either way, to exercise range reduction
+      auto rot = RandomVectors(gen, count, -20.0f, 20.0f);
+      auto scale = RandomVectors(gen, count, 0.1f, 4.0f);
+      // one past the end, to catch overruns
+      std::vector<glm::mat4> out(count + 1, glm::mat4(7.0f));
+      MatrixBatch::ComposeTransforms(kernel, pos.data(), rot.data(), scale.data(), out.data(), count);
+      for (size_t i = 0; i < count; i++) {
+        glm::mat4 expected = ExpectedModel(pos[i], rot[i], scale[i]);
+        for (int c = 0; c < 4; c++) {
+          for (int r = 0; r < 4; r++) {
+            AssertNear(expected[c][r], out[i][c][r]);
+          }
+        }
+      }
+
+      ASSERT_EQ(glm::mat4(7.0f), out[count]);
+    }
+  }
+}
+
+TEST(MatrixBatchTests, ComposeSpecialAngles) {
+  // octant boundaries, where sin and cos swap polynomials
+  std::vector<glm::vec3> rot;
+  for (int i = -16; i <= 16; i++) {
+    float a = static_cast<float>(i * M_PI / 4.0);
+    rot.push_back(glm::vec3(a, -a, a * 0.5f));
+  }
+
+  std::vector<glm::vec3> pos(rot.size(), glm::vec3(1, 2, 3));
+  std::vector<glm::vec3> scale(rot.size(), glm::vec3(1));
+  std::vector<glm::mat4> out(rot.size());
+  for (auto kernel : KERNELS) {
+    MatrixBatch::ComposeTransforms(kernel, pos.data(), rot.data(), scale.data(), out.data(), rot.size());
+    for (size_t i = 0; i < rot.size(); i++) {
+      glm::mat4 expected = ExpectedModel(pos[i], rot[i], scale[i]);
+      for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+          AssertNear(expected[c][r], out[i][c][r]);
+        }
+      }
+    }
+  }
+}
+
+TEST(MatrixBatchTests, NormalsMatchGLM) {
+  std::mt19937 gen(2);
+  for (auto kernel : KERNELS) {
+    for (auto count : COUNTS) {
+      auto pos = RandomVectors(gen, count, -100.0f, 100.0f);
+      auto rot = RandomVectors(gen, count, -4.0f, 4.0f);
+      // non-uniform scale, so the normal matrix isn't just the rotation
+      auto scale = RandomVectors(gen, count, 0.25f, 4.0f);
+      std::vector<glm::mat4> model(count);
+      for (size_t i = 0; i < count; i++) {
+        model[i] = ExpectedModel(pos[i], rot[i], scale[i]);
+      }
+
+      std::vector<glm::mat3> out(count + 1, glm::mat3(7.0f));
+      MatrixBatch::ComputeNormalMatrices(kernel, model.data(), out.data(), count);
+      for (size_t i = 0; i < count; i++) {
+        glm::mat3 expected = glm::inverseTranspose(glm::mat3(model[i]));
+        for (int c = 0; c < 3; c++) {
+          for (int r = 0; r < 3; r++) {
+            AssertNear(expected[c][r], out[i][c][r]);
+          }
+        }
+      }
+
+      ASSERT_EQ(glm::mat3(7.0f), out[count]);
+    }
+  }
+}
+
+TEST(MatrixBatchTests, BestKernelIsUsable) {
+  glm::vec3 pos(1, 2, 3);
+  glm::vec3 rot(0.5, 0.25, -1);
+  glm::vec3 scale(2);
+  glm::mat4 out;
+  MatrixBatch::ComposeTransforms(&pos, &rot, &scale, &out, 1);
+  glm::mat4 expected = ExpectedModel(pos, rot, scale);
+  for (int c = 0; c < 4; c++) {
+    for (int r = 0; r < 4; r++) {
+      AssertNear(expected[c][r], out[c][r]);
+    }
+  }
+
+  ASSERT_GE(MatrixBatch::GetBestKernel(), MatrixBatch::KERNEL_SCALAR);
+}
@@ -1,12 +1,30 @@
 #include <file/ModelLoader.hpp>
+#include <file/BakedMesh.hpp>
 #include <gtest/gtest.h>
 
+#include "TempDir.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using ::monkeysworld::file::GetBakedMeshPath;
 using ::monkeysworld::file::ModelLoader;
 using ::monkeysworld::file::LoaderThreadPool;
+using ::monkeysworld::file::ReadBakedMesh;
+using ::monkeysworld::file::WriteBakedMesh;
+using ::monkeysworld::storage::VertexPacket3D;
+
+using ::testfiles::TempDir;
+
+namespace fs = std::filesystem;
 
 TEST(ModelLoaderTests, CreateModelLoader) {
   auto threadpool = std::make_shared<LoaderThreadPool>(4);
-  ModelLoader m(threadpool, std::vector<::monkeysworld::file::cache_record>());
+  TempDir dir;
+  ModelLoader m(threadpool, std::vector<::monkeysworld::file::cache_record>(), nullptr, nullptr, dir.Get(""));
   auto res = m.LoadFile("resources/test/untitled4.obj");
   std::this_thread::sleep_for(std::chrono::milliseconds(200));
   ASSERT_NE(nullptr, res.get());
@@ -15,11 +33,102 @@ TEST(ModelLoaderTests, CreateModelLoader) {
 
 TEST(ModelLoaderTests, TestAsync) {
   auto threadpool = std::make_shared<LoaderThreadPool>(4);
-  ModelLoader m(threadpool, std::vector<::monkeysworld::file::cache_record>());
+  TempDir dir;
+  ModelLoader m(threadpool, std::vector<::monkeysworld::file::cache_record>(), nullptr, nullptr, dir.Get(""));
   auto future = m.LoadFileAsync("resources/test/untitled4.obj");
   std::this_thread::sleep_for(std::chrono::milliseconds(200));
   future.wait();
   auto res = future.get();
   ASSERT_NE(nullptr, res.get());
   ASSERT_EQ(47194, res->GetVertexCount());
-}
\ No newline at end of file
+}
+
+TEST(ModelLoaderTests, EmptyFileIsAnEmptyMesh) {
+  TempDir dir;
+  const std::string path = dir.Get("empty.obj");
+  std::ofstream(path).close();
+
+  uint64_t size = 1;
+  auto mesh = ModelLoader::FromObjFile(path, &size);
+  ASSERT_NE(nullptr, mesh.get());
+  ASSERT_EQ(0, size);
+  ASSERT_EQ(0, mesh->GetVertexCount());
+  ASSERT_EQ(0, mesh->GetIndexCount());
+
+  // same with a pool, which would otherwise split it up
+  LoaderThreadPool pool(2);
+  mesh = ModelLoader::FromObjFile(path, &size, &pool);
+  ASSERT_NE(nullptr, mesh.get());
+  ASSERT_EQ(0, mesh->GetVertexCount());
+}
+
+TEST(ModelLoaderTests, BakedMeshRoundTrip) {
+  uint64_t size;
+  auto parsed = ModelLoader::FromObjFile("resources/test/monkeyquads.obj", &size);
+  ASSERT_NE(nullptr, parsed.get());
+
+  TempDir dir;
+  const std::string bake_path = dir.Get("roundtrip-test.mwmesh");
+  ASSERT_TRUE(WriteBakedMesh(bake_path, *parsed, size, 1234));
+  auto baked = ReadBakedMesh(bake_path, size, 1234);
+  ASSERT_NE(nullptr, baked.get());
+
+  ASSERT_EQ(parsed->GetVertexCount(), baked->GetVertexCount());
+  ASSERT_EQ(parsed->GetIndexCount(), baked->GetIndexCount());
+  ASSERT_EQ(0, memcmp(parsed->GetVertexData(), baked->GetVertexData(),
+                      parsed->GetVertexCount() * sizeof(VertexPacket3D)));
+  ASSERT_EQ(0, memcmp(parsed->GetIndexData(), baked->GetIndexData(),
+                      parsed->GetIndexCount() * sizeof(unsigned int)));
+}
+
+TEST(ModelLoaderTests, StaleBakeIsIgnored) {
+  uint64_t size;
+  auto parsed = ModelLoader::FromObjFile("resources/test/CUBE.obj", &size);
+  TempDir dir;
+  const std::string bake_path = dir.Get("stale-test.mwmesh");
+  ASSERT_TRUE(WriteBakedMesh(bake_path, *parsed, size, 1234));
+
+  // source changed size or modification time -- bake should be rejected
+  ASSERT_EQ(nullptr, ReadBakedMesh(bake_path, size + 1, 1234).get());
+  ASSERT_EQ(nullptr, ReadBakedMesh(bake_path, size, 4321).get());
+  ASSERT_EQ(nullptr, ReadBakedMesh(dir.Get("does-not-exist.mwmesh"), size, 1234).get());
+}
+
+TEST(ModelLoaderTests, OversizedCountsAreRejected) {
+  uint64_t size;
+  auto parsed = ModelLoader::FromObjFile("resources/test/CUBE.obj", &size);
+  TempDir dir;
+  const std::string bake_path = dir.Get("oversized-test.mwmesh");
+  ASSERT_TRUE(WriteBakedMesh(bake_path, *parsed, size, 1234));
+
+  std::ifstream input(bake_path, std::ios::binary);
+  std::string bake((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+  ASSERT_NE(nullptr, ReadBakedMesh(bake.data(), bake.size(), bake_path).get());
+
+  // counts which only add up to the right size once the multiplication wraps around
+  ::monkeysworld::file::baked_mesh_header header;
+  std::memcpy(&header, bake.data(), sizeof(header));
+  header.vertex_count += (1ULL << 59);
+  std::memcpy(&bake[0], &header, sizeof(header));
+  ASSERT_EQ(nullptr, ReadBakedMesh(bake.data(), bake.size(), bake_path).get());
+
+  header.vertex_count -= (1ULL << 59);
+  header.index_count += (1ULL << 62);
+  std::memcpy(&bake[0], &header, sizeof(header));
+  ASSERT_EQ(nullptr, ReadBakedMesh(bake.data(), bake.size(), bake_path).get());
+}
+
+TEST(ModelLoaderTests, LoadsFromBake) {
+  uint64_t size;
+  auto parsed = ModelLoader::FromObjFile("resources/test/untitled4.obj", &size);
+  // first call writes the bake, second reads it back
+  TempDir dir;
+  const std::string bake_dir = dir.Get("");
+  auto first = ModelLoader::FromBakedOrObjFile("resources/test/untitled4.obj", &size, nullptr, bake_dir);
+  ASSERT_TRUE(fs::exists(GetBakedMeshPath("resources/test/untitled4.obj", bake_dir)));
+  auto second = ModelLoader::FromBakedOrObjFile("resources/test/untitled4.obj", &size, nullptr, bake_dir);
+  ASSERT_EQ(parsed->GetVertexCount(), second->GetVertexCount());
+  ASSERT_EQ(parsed->GetIndexCount(), second->GetIndexCount());
+  ASSERT_EQ(0, memcmp(parsed->GetVertexData(), second->GetVertexData(),
+                      parsed->GetVertexCount() * sizeof(VertexPacket3D)));
+}
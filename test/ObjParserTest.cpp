@@ -0,0 +1,162 @@
+#include <file/ModelLoader.hpp>
+#include <gtest/gtest.h>
+
+#include "LegacyObjParser.hpp"
+#include "TempDir.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+
+using ::monkeysworld::file::LoaderThreadPool;
+using ::monkeysworld::file::ModelLoader;
+using ::monkeysworld::model::Mesh;
+using ::monkeysworld::storage::VertexPacket3D;
+
+using ::testfiles::TempDir;
+
+static void ExpectMeshesEqual(const Mesh<VertexPacket3D>& expected, const Mesh<VertexPacket3D>& actual) {
+  ASSERT_EQ(expected.GetVertexCount(), actual.GetVertexCount());
+  ASSERT_EQ(expected.GetIndexCount(), actual.GetIndexCount());
+  ASSERT_EQ(0, memcmp(expected.GetVertexData(), actual.GetVertexData(),
+                      expected.GetVertexCount() * sizeof(VertexPacket3D)));
+  ASSERT_EQ(0, memcmp(expected.GetIndexData(), actual.GetIndexData(),
+                      expected.GetIndexCount() * sizeof(unsigned int)));
+}
+
+static void WriteFile(const std::string& path, const std::string& contents) {
+  std::ofstream out(path, std::ios_base::binary);
+  out << contents;
+}
+
+TEST(ObjParserTests, MatchesLegacyParser) {
+  int files_checked = 0;
+  for (auto& entry : std::filesystem::directory_iterator("resources/test")) {
+    if (entry.path().extension() != ".obj") {
+      continue;
+    }
+
+    std::string path = entry.path().string();
+    SCOPED_TRACE(path);
+    uint64_t size;
+    auto expected = legacyobj::FromObjFile(path);
+    auto actual = ModelLoader::FromObjFile(path, &size);
+    ASSERT_EQ(std::filesystem::file_size(path), size);
+    ExpectMeshesEqual(*expected, *actual);
+    files_checked++;
+  }
+
+  ASSERT_GT(files_checked, 0);
+}
+
+TEST(ObjParserTests, NegativeIndices) {
+  TempDir dir;
+  std::string absolute_path = dir.Get("absolute-test.obj");
+  std::string relative_path = dir.Get("relative-test.obj");
+  const std::string header = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0 0\nvt 1 0\nvt 1 1\nvn 0 0 1\n";
+  WriteFile(absolute_path, header + "f 1/1/1 2/2/1 3/3/1\nf 1/1/1 3/3/1 4/1/1\n");
+  WriteFile(relative_path, header + "f -4/-3/-1 -3/-2/-1 -2/-1/-1\nf -4/-3/-1 -2/-1/-1 -1/-3/-1\n");
+
+  uint64_t size;
+  auto absolute = ModelLoader::FromObjFile(absolute_path, &size);
+  auto relative = ModelLoader::FromObjFile(relative_path, &size);
+
+  ASSERT_EQ(4, absolute->GetVertexCount());
+  ExpectMeshesEqual(*absolute, *relative);
+}
+
+TEST(ObjParserTests, MissingComponents) {
+  TempDir dir;
+  std::string path = dir.Get("missing-test.obj");
+  // position-only and position/normal corners, CRLF line endings
+  WriteFile(path,
+            "v 0 0 0\r\nv 1 0 0\r\nv 0 1 0\r\nvn 0 0 -1\r\nf 1 2 3\r\nf 1//1 2//1 3//1\r\n");
+
+  uint64_t size;
+  auto mesh = ModelLoader::FromObjFile(path, &size);
+
+  ASSERT_EQ(6, mesh->GetVertexCount());
+  ASSERT_EQ(6, mesh->GetIndexCount());
+  const VertexPacket3D* verts = mesh->GetVertexData();
+  ASSERT_FLOAT_EQ(1.0f, verts[1].position.x);
+  ASSERT_FLOAT_EQ(1.0f, verts[0].normals.x);
+  ASSERT_FLOAT_EQ(-1.0f, verts[3].normals.z);
+  ASSERT_FLOAT_EQ(0.0f, verts[3].coords.x);
+}
+
+TEST(ObjParserTests, MissingFileThrows) {
+  uint64_t size;
+  ASSERT_ANY_THROW(ModelLoader::FromObjFile("resources/test/does-not-exist.obj", &size));
+}
+
+/**
+ *  Writes a few MB of OBJ data, declaring vertex data in between faces.
+ *  @param relative - whether faces should use negative indices.
+ */
+static void WriteInterleavedObj(const std::string& path, bool relative) {
+  std::ofstream out(path, std::ios_base::binary);
+  const int QUADS = 60000;
+  for (int i = 0; i < QUADS; i++) {
+    for (int j = 0; j < 4; j++) {
+      out << "v " << i * 0.5f + (j & 1) << " " << (j >> 1) << " " << (i % 13) * 0.25f << "\n";
+      out << "vt " << (j & 1) << " " << (j >> 1) << "\n";
+    }
+
+    out << "vn 0 " << (i % 2) << " " << ((i + 1) % 2) << "\n";
+    if (relative) {
+      out << "f -4/-4/-1 -3/-3/-1 -1/-1/-1 -2/-2/-1\n";
+    } else {
+      int a = 4 * i + 1;
+      int n = i + 1;
+      out << "f " << a << "/" << a << "/" << n << " " << a + 1 << "/" << a + 1 << "/" << n << " "
+          << a + 3 << "/" << a + 3 << "/" << n << " " << a + 2 << "/" << a + 2 << "/" << n << "\n";
+    }
+  }
+}
+
+TEST(ObjParserTests, ParallelMatchesSerial) {
+  TempDir dir;
+  std::string absolute_path = dir.Get("parallel-abs-test.obj");
+  std::string relative_path = dir.Get("parallel-rel-test.obj");
+  WriteInterleavedObj(absolute_path, false);
+  WriteInterleavedObj(relative_path, true);
+
+  uint64_t size;
+  auto serial = ModelLoader::FromObjFile(absolute_path, &size);
+  ASSERT_GT(size, 4u << 20);
+  ExpectMeshesEqual(*legacyobj::FromObjFile(absolute_path), *serial);
+
+  for (int threads : { 1, 3, 7 }) {
+    SCOPED_TRACE(threads);
+    LoaderThreadPool pool(threads);
+    auto parallel = ModelLoader::FromObjFile(absolute_path, &size, &pool);
+    ExpectMeshesEqual(*serial, *parallel);
+
+    // relative indices crossing chunk boundaries
+    auto relative = ModelLoader::FromObjFile(relative_path, &size, &pool);
+    ExpectMeshesEqual(*serial, *relative);
+  }
+}
+
+TEST(ObjParserTests, ParallelFromPoolTask) {
+  // parsing from inside a saturated pool must not deadlock
+  TempDir dir;
+  std::string path = dir.Get("pool-task-test.obj");
+  WriteInterleavedObj(path, true);
+  LoaderThreadPool pool(2);
+  std::vector<std::shared_ptr<std::promise<size_t>>> results;
+  for (int i = 0; i < 4; i++) {
+    auto p = std::make_shared<std::promise<size_t>>();
+    results.push_back(p);
+    pool.AddTaskToQueue([p, path, &pool] {
+      uint64_t size;
+      auto mesh = ModelLoader::FromObjFile(path, &size, &pool);
+      p->set_value(mesh->GetVertexCount());
+    });
+  }
+
+  for (auto& p : results) {
+    ASSERT_EQ(240000u, p->get_future().get());
+  }
+}
@@ -0,0 +1,229 @@
+#include <critter/ParallelUpdater.hpp>
+#include <critter/Empty.hpp>
+#include <critter/visitor/FrameVisitor.hpp>
+#include <engine/EngineExecutor.hpp>
+#include <file/LoaderThreadPool.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TestScene.hpp"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::Object;
+using ::monkeysworld::critter::ParallelUpdater;
+using ::monkeysworld::critter::visitor::FrameVisitor;
+using ::monkeysworld::engine::EngineExecutor;
+using ::monkeysworld::file::LoaderThreadPool;
+
+// stamped onto objects as they update
+static std::atomic<int> update_clock(0);
+
+/**
+ *  Empty which records when, and on which thread, it was last updated.
+ */
+class StampedEmpty : public Empty {
+ public:
+  StampedEmpty(bool thread_safe) : Empty(nullptr), updates(0), stamp(-1), thread_safe_(thread_safe) {}
+
+  bool IsUpdateThreadSafe() override {
+    return thread_safe_;
+  }
+
+  void Update() override {
+    updates++;
+    stamp = update_clock++;
+    thread = std::this_thread::get_id();
+    if (on_update) {
+      on_update();
+    }
+  }
+
+  std::atomic<int> updates;
+  int stamp;
+  std::thread::id thread;
+  std::function<void()> on_update;
+ private:
+  bool thread_safe_;
+};
+
+class ParallelUpdaterTests : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    testscene::QuietLogs();
+    update_clock = 0;
+  }
+
+  /**
+   *  Builds a tree `depth` levels deep, with `width` children per object.
+   *  @param safe - decides whether the object at a given depth is thread-safe.
+   *  @param out - every object in the tree, parents before children.
+   */
+  std::shared_ptr<StampedEmpty> BuildTree(int depth, int width, std::function<bool(int)> safe,
+                                          std::vector<std::shared_ptr<StampedEmpty>>& out, int level = 0) {
+    auto res = std::make_shared<StampedEmpty>(safe(level));
+    out.push_back(res);
+    if (level + 1 < depth) {
+      for (int i = 0; i < width; i++) {
+        res->AddChild(BuildTree(depth, width, safe, out, level + 1));
+      }
+    }
+
+    return res;
+  }
+
+  /**
+   *  Checks that every object in `objects` was updated once, after its parent.
+   */
+  void CheckUpdatedOnce(const std::vector<std::shared_ptr<StampedEmpty>>& objects) {
+    for (auto& o : objects) {
+      ASSERT_EQ(1, o->updates.load());
+      if (auto parent = std::static_pointer_cast<StampedEmpty>(o->GetParent())) {
+        ASSERT_LT(parent->stamp, o->stamp);
+      }
+    }
+  }
+};
+
+TEST_F(ParallelUpdaterTests, ParentsBeforeChildren) {
+  // wide enough at each level to be split into several jobs
+  std::vector<std::shared_ptr<StampedEmpty>> objects;
+  auto root = BuildTree(3, 40, [](int) { return true; }, objects);
+
+  ParallelUpdater updater(std::make_shared<LoaderThreadPool>(4));
+  updater.Schedule(root.get());
+  ASSERT_TRUE(updater.HasScheduled());
+  updater.Run();
+  ASSERT_FALSE(updater.HasScheduled());
+  ASSERT_GT(updater.GetLastJobCount(), 1);
+  CheckUpdatedOnce(objects);
+}
+
+TEST_F(ParallelUpdaterTests, UnsafeObjectsUpdateOnCaller) {
+  // every other level has opted out
+  std::vector<std::shared_ptr<StampedEmpty>> objects;
+  auto root = BuildTree(3, 40, [](int level) { return (level % 2 == 0); }, objects);
+
+  ParallelUpdater updater(std::make_shared<LoaderThreadPool>(4));
+  updater.Schedule(root.get());
+  updater.Run();
+  CheckUpdatedOnce(objects);
+
+  // along with everything beneath them
+  for (auto& o : objects) {
+    if (!o->IsUpdateThreadSafe()) {
+      ASSERT_EQ(std::this_thread::get_id(), o->thread);
+      for (auto& child : o->GetChildren()) {
+        ASSERT_EQ(std::this_thread::get_id(), std::static_pointer_cast<StampedEmpty>(child)->thread);
+      }
+    }
+  }
+}
+
+TEST_F(ParallelUpdaterTests, NoWorkersUpdatesInOrder) {
+  std::vector<std::shared_ptr<StampedEmpty>> objects;
+  auto root = BuildTree(3, 4, [](int) { return true; }, objects);
+
+  ParallelUpdater updater(std::make_shared<LoaderThreadPool>(0));
+  updater.Schedule(root.get());
+  updater.Run();
+  CheckUpdatedOnce(objects);
+  for (size_t i = 0; i < objects.size(); i++) {
+    ASSERT_EQ(i, objects[i]->stamp);
+  }
+}
+
+TEST_F(ParallelUpdaterTests, ExceptionsReachCaller) {
+  std::vector<std::shared_ptr<StampedEmpty>> objects;
+  auto root = BuildTree(3, 40, [](int) { return true; }, objects);
+  objects.back()->on_update = [] {
+    throw std::runtime_error("oops");
+  };
+
+  ParallelUpdater updater(std::make_shared<LoaderThreadPool>(4));
+  updater.Schedule(root.get());
+  ASSERT_THROW(updater.Run(), std::runtime_error);
+
+  // the rest of the frame still ran
+  CheckUpdatedOnce(objects);
+
+  objects.back()->on_update = nullptr;
+  updater.Schedule(root.get());
+  updater.Run();
+  ASSERT_EQ(2, root->updates.load());
+}
+
+TEST_F(ParallelUpdaterTests, DeferredExceptionsReachCaller) {
+  std::vector<std::shared_ptr<StampedEmpty>> objects;
+  auto root = BuildTree(3, 40, [](int level) { return (level != 1); }, objects);
+  objects[1]->on_update = [] {
+    throw std::runtime_error("oops");
+  };
+
+  ParallelUpdater updater(std::make_shared<LoaderThreadPool>(4));
+  updater.Schedule(root.get());
+  ASSERT_THROW(updater.Run(), std::runtime_error);
+  ASSERT_FALSE(updater.HasScheduled());
+
+  // nothing from the failed run is walked again
+  std::vector<std::shared_ptr<StampedEmpty>> others;
+  auto other = BuildTree(2, 4, [](int) { return true; }, others);
+  updater.Schedule(other.get());
+  updater.Run();
+  CheckUpdatedOnce(others);
+  ASSERT_EQ(1, objects[1]->updates.load());
+  ASSERT_EQ(1, root->updates.load());
+}
+
+TEST_F(ParallelUpdaterTests, MainThreadWorkIsDeferred) {
+  EngineExecutor executor;
+  std::vector<std::shared_ptr<StampedEmpty>> objects;
+  auto root = BuildTree(3, 40, [](int) { return true; }, objects);
+
+  // stands in for GL calls, which have to happen on the main thread
+  std::thread::id main_thread = std::this_thread::get_id();
+  std::atomic<int> main_thread_calls(0);
+  std::atomic<int> wrong_thread_calls(0);
+  for (auto& o : objects) {
+    o->on_update = [&] {
+      executor.ScheduleOnMainThread([&] {
+        if (std::this_thread::get_id() == main_thread) {
+          main_thread_calls++;
+        } else {
+          wrong_thread_calls++;
+        }
+      });
+    };
+  }
+
+  ParallelUpdater updater(std::make_shared<LoaderThreadPool>(4));
+  updater.Schedule(root.get());
+  updater.Run();
+  executor.RunTasks(1000.0);
+
+  ASSERT_EQ(objects.size(), main_thread_calls.load());
+  ASSERT_EQ(0, wrong_thread_calls.load());
+}
+
+TEST_F(ParallelUpdaterTests, FrameVisitorGathersTheSame) {
+  // thread-safe subtrees beneath an unsafe root
+  std::vector<std::shared_ptr<StampedEmpty>> objects;
+  auto root = BuildTree(3, 40, [](int level) { return (level > 0); }, objects);
+
+  FrameVisitor serial;
+  serial.UpdateAndGather(root.get());
+  std::vector<Object*> expected = serial.GetRenderList();
+
+  FrameVisitor parallel(std::make_shared<LoaderThreadPool>(4));
+  parallel.UpdateAndGather(root.get());
+  ASSERT_EQ(expected, parallel.GetRenderList());
+  for (auto& o : objects) {
+    ASSERT_EQ(2, o->updates.load());
+  }
+}
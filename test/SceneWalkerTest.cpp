@@ -0,0 +1,254 @@
+#include <critter/SceneWalker.hpp>
+#include <critter/Empty.hpp>
+#include <critter/GameCamera.hpp>
+#include <critter/visitor/ActiveCameraFindVisitor.hpp>
+#include <critter/visitor/LightVisitor.hpp>
+
+#include <gtest/gtest.h>
+
+#include "AllocationCounter.hpp"
+#include "TestScene.hpp"
+
+#include <memory>
+#include <vector>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::GameCamera;
+using ::monkeysworld::critter::GameObject;
+using ::monkeysworld::critter::Object;
+using ::monkeysworld::critter::SceneWalker;
+using ::monkeysworld::critter::WALK_CONTINUE;
+using ::monkeysworld::critter::WALK_SKIP_CHILDREN;
+using ::monkeysworld::critter::WALK_STOP;
+using ::monkeysworld::critter::visitor::ActiveCameraFindVisitor;
+using ::monkeysworld::critter::visitor::LightVisitor;
+
+// RemoveChild is normally only for subclasses
+class DetachableEmpty : public Empty {
+ public:
+  DetachableEmpty() : Empty(nullptr) {}
+  using GameObject::RemoveChild;
+};
+
+static std::shared_ptr<DetachableEmpty> MakeEmpty(uint64_t id) {
+  auto res = std::make_shared<DetachableEmpty>();
+  res->SetId(id);
+  return res;
+}
+
+class SceneWalkerTests : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    testscene::QuietLogs();
+  }
+
+  /**
+   *  Builds a chain `depth` objects deep.
+   *  @returns every object in the chain, root first.
+   */
+  std::vector<std::shared_ptr<DetachableEmpty>> BuildChain(int depth) {
+    std::vector<std::shared_ptr<DetachableEmpty>> res;
+    res.push_back(MakeEmpty(1));
+    for (int i = 1; i < depth; i++) {
+      res.push_back(MakeEmpty(i + 1));
+      res[i - 1]->AddChild(res[i]);
+    }
+
+    return res;
+  }
+
+  /**
+   *  Unlinks a chain from the bottom up, so that tearing it down doesn't recurse.
+   */
+  void ReleaseChain(std::vector<std::shared_ptr<DetachableEmpty>>& chain) {
+    for (size_t i = chain.size() - 1; i > 0; i--) {
+      chain[i - 1]->RemoveChild(chain[i]->GetId());
+    }
+  }
+};
+
+TEST_F(SceneWalkerTests, VisitsInPreOrder) {
+  //      1
+  //    2   5
+  //   3 4   6
+  auto root = MakeEmpty(1);
+  auto a = MakeEmpty(2);
+  auto b = MakeEmpty(5);
+  root->AddChild(a);
+  root->AddChild(b);
+  a->AddChild(MakeEmpty(3));
+  a->AddChild(MakeEmpty(4));
+  b->AddChild(MakeEmpty(6));
+
+  SceneWalker walker;
+  std::vector<uint64_t> order;
+  walker.Walk(root.get(), [&](Object* o) {
+    order.push_back(o->GetId());
+  });
+
+  ASSERT_EQ(std::vector<uint64_t>({ 1, 2, 3, 4, 5, 6 }), order);
+
+  order.clear();
+  walker.WalkChildren(root.get(), [&](Object* o) {
+    order.push_back(o->GetId());
+  });
+
+  ASSERT_EQ(std::vector<uint64_t>({ 2, 3, 4, 5, 6 }), order);
+
+  // skipping 2 hides 3 and 4, stopping at 5 hides 6
+  order.clear();
+  walker.Walk(root.get(), [&](Object* o) {
+    order.push_back(o->GetId());
+    if (o->GetId() == 2) {
+      return WALK_SKIP_CHILDREN;
+    }
+
+    return (o->GetId() == 5 ? WALK_STOP : WALK_CONTINUE);
+  });
+
+  ASSERT_EQ(std::vector<uint64_t>({ 1, 2, 5 }), order);
+}
+
+TEST_F(SceneWalkerTests, ObjectsCanRemoveThemselves) {
+  auto root = MakeEmpty(1);
+  for (int i = 0; i < 6; i++) {
+    root->AddChild(MakeEmpty(i + 2));
+  }
+
+  // every other child detaches itself when visited
+  SceneWalker walker;
+  std::vector<uint64_t> order;
+  walker.WalkChildren(root.get(), [&](Object* o) {
+    order.push_back(o->GetId());
+    if (o->GetId() % 2 == 0) {
+      root->RemoveChild(o->GetId());
+    }
+  });
+
+  ASSERT_EQ(std::vector<uint64_t>({ 2, 3, 4, 5, 6, 7 }), order);
+  ASSERT_EQ(3, root->GetChildSpan().GetSize());
+}
+
+TEST_F(SceneWalkerTests, RemovingEarlierSiblingsSkipsNothing) {
+  //      1
+  //  2   3   4
+  //      5   6
+  auto root = MakeEmpty(1);
+  auto a = MakeEmpty(3);
+  auto b = MakeEmpty(4);
+  root->AddChild(MakeEmpty(2));
+  root->AddChild(a);
+  root->AddChild(b);
+  a->AddChild(MakeEmpty(5));
+  b->AddChild(MakeEmpty(6));
+
+  // 3 removes 2, which has already been visited
+  SceneWalker walker;
+  std::vector<uint64_t> order;
+  walker.WalkChildren(root.get(), [&](Object* o) {
+    order.push_back(o->GetId());
+    if (o->GetId() == 3) {
+      root->RemoveChild(2);
+    }
+  });
+
+  ASSERT_EQ(std::vector<uint64_t>({ 2, 3, 5, 4, 6 }), order);
+  ASSERT_EQ(2, root->GetChildSpan().GetSize());
+}
+
+TEST_F(SceneWalkerTests, ObjectsCanRemoveThemselvesWhenNothingElseHoldsThem) {
+  auto root = MakeEmpty(1);
+  for (int i = 0; i < 4; i++) {
+    auto child = MakeEmpty(i + 2);
+    child->AddChild(MakeEmpty(i + 10));
+    root->AddChild(child);
+  }
+
+  // the root holds the only reference to each child
+  SceneWalker walker;
+  std::vector<uint64_t> order;
+  walker.WalkChildren(root.get(), [&](Object* o) {
+    uint64_t id = o->GetId();
+    if (id == 3) {
+      root->RemoveChild(id);
+    }
+
+    // still alive after removing itself
+    order.push_back(o->GetId());
+    return (id == 3 ? WALK_SKIP_CHILDREN : WALK_CONTINUE);
+  });
+
+  ASSERT_EQ(std::vector<uint64_t>({ 2, 10, 3, 4, 12, 5, 13 }), order);
+  ASSERT_EQ(3, root->GetChildSpan().GetSize());
+}
+
+TEST_F(SceneWalkerTests, DeepChainsDontRecurse) {
+  auto chain = BuildChain(20000);
+  SceneWalker walker;
+  size_t count = 0;
+  walker.Walk(chain[0].get(), [&](Object* o) {
+    count++;
+  });
+
+  ASSERT_EQ(chain.size(), count);
+
+  // visitors walk iteratively as well
+  ActiveCameraFindVisitor cameras;
+  auto cam = std::make_shared<GameCamera>(nullptr);
+  cam->SetActive(true);
+  chain.back()->AddChild(cam);
+  chain[0]->Accept(cameras);
+  ASSERT_EQ(cam, cameras.GetActiveCamera());
+  chain.back()->RemoveChild(cam->GetId());
+  ReleaseChain(chain);
+}
+
+TEST_F(SceneWalkerTests, WalksDontAllocate) {
+  auto chain = BuildChain(1000);
+  auto wide = MakeEmpty(1);
+  for (int i = 0; i < 1000; i++) {
+    auto child = MakeEmpty(i + 2);
+    wide->AddChild(child);
+    for (int j = 0; j < 4; j++) {
+      child->AddChild(MakeEmpty(0));
+    }
+  }
+
+  auto cam = std::make_shared<GameCamera>(nullptr);
+  cam->SetActive(true);
+  chain.back()->AddChild(cam);
+
+  SceneWalker walker;
+  LightVisitor light_visitor;
+  ActiveCameraFindVisitor cam_visitor;
+  size_t visited = 0;
+  auto frame = [&] {
+    light_visitor.Clear();
+    cam_visitor.Clear();
+    walker.Walk(chain[0].get(), [&](Object* o) {
+      o->Update();
+      visited++;
+    });
+
+    walker.Walk(wide.get(), [&](Object* o) {
+      o->Update();
+      visited++;
+    });
+
+    chain[0]->Accept(light_visitor);
+    chain[0]->Accept(cam_visitor);
+  };
+
+  // the first frame grows stacks and lists to size
+  frame();
+  size_t before = allocations.load();
+  visited = 0;
+  frame();
+  ASSERT_EQ(before, allocations.load());
+  ASSERT_EQ(1001 + 5001, visited);
+  ASSERT_EQ(0, light_visitor.GetSpotLights().size());
+  ASSERT_EQ(cam, cam_visitor.GetActiveCamera());
+
+  chain.back()->RemoveChild(cam->GetId());
+  ReleaseChain(chain);
+}
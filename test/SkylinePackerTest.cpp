@@ -0,0 +1,91 @@
+#include <utils/SkylinePacker.hpp>
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+using ::monkeysworld::utils::SkylinePacker;
+
+struct placed {
+  glm::ivec2 origin;
+  glm::ivec2 size;
+};
+
+static bool Overlaps(const placed& a, const placed& b) {
+  return (a.origin.x < b.origin.x + b.size.x && b.origin.x < a.origin.x + a.size.x
+       && a.origin.y < b.origin.y + b.size.y && b.origin.y < a.origin.y + a.size.y);
+}
+
+TEST(SkylinePackerTests, FillRowsLeftToRight) {
+  SkylinePacker packer(glm::ivec2(100, 100));
+  glm::ivec2 origin;
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(packer.Insert(glm::ivec2(25, 10), &origin));
+    ASSERT_EQ(glm::ivec2(25 * i, 0), origin);
+  }
+
+  // next row up
+  ASSERT_TRUE(packer.Insert(glm::ivec2(50, 10), &origin));
+  ASSERT_EQ(glm::ivec2(0, 10), origin);
+  ASSERT_EQ(1500, packer.GetUsedArea());
+}
+
+TEST(SkylinePackerTests, FillGapsBeforeGoingHigher) {
+  SkylinePacker packer(glm::ivec2(100, 100));
+  glm::ivec2 origin;
+  ASSERT_TRUE(packer.Insert(glm::ivec2(40, 50), &origin));
+  ASSERT_TRUE(packer.Insert(glm::ivec2(40, 20), &origin));
+  ASSERT_EQ(glm::ivec2(40, 0), origin);
+
+  // lowest spot is the sliver on the right, then on top of the short one
+  ASSERT_TRUE(packer.Insert(glm::ivec2(20, 30), &origin));
+  ASSERT_EQ(glm::ivec2(80, 0), origin);
+  ASSERT_TRUE(packer.Insert(glm::ivec2(60, 10), &origin));
+  ASSERT_EQ(glm::ivec2(40, 30), origin);
+}
+
+TEST(SkylinePackerTests, RejectWhatDoesNotFit) {
+  SkylinePacker packer(glm::ivec2(64, 64));
+  glm::ivec2 origin;
+  ASSERT_FALSE(packer.Insert(glm::ivec2(65, 1), &origin));
+  ASSERT_FALSE(packer.Insert(glm::ivec2(1, 65), &origin));
+  ASSERT_FALSE(packer.Insert(glm::ivec2(0, 4), &origin));
+  ASSERT_TRUE(packer.Insert(glm::ivec2(64, 64), &origin));
+  ASSERT_FALSE(packer.Insert(glm::ivec2(1, 1), &origin));
+
+  packer.Clear();
+  ASSERT_EQ(0, packer.GetUsedArea());
+  ASSERT_TRUE(packer.Insert(glm::ivec2(1, 1), &origin));
+  ASSERT_EQ(glm::ivec2(0, 0), origin);
+}
+
+TEST(SkylinePackerTests, PackWidgetsTightly) {
+  const glm::ivec2 size(1024, 1024);
+  SkylinePacker packer(size);
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<int> width(16, 200);
+  std::uniform_int_distribution<int> height(12, 64);
+
+  std::vector<placed> rects;
+  glm::ivec2 origin;
+  while (true) {
+    glm::ivec2 dims(width(gen), height(gen));
+    if (!packer.Insert(dims, &origin)) {
+      break;
+    }
+
+    placed rect = { origin, dims };
+    ASSERT_GE(origin.x, 0);
+    ASSERT_GE(origin.y, 0);
+    ASSERT_LE(origin.x + dims.x, size.x);
+    ASSERT_LE(origin.y + dims.y, size.y);
+    for (auto& other : rects) {
+      ASSERT_FALSE(Overlaps(rect, other));
+    }
+
+    rects.push_back(rect);
+  }
+
+  // button and label sized rectangles should cover most of the area before one doesn't fit
+  ASSERT_GT(packer.GetUsedArea(), static_cast<uint64_t>(size.x) * size.y * 3 / 4);
+}
@@ -0,0 +1,45 @@
+#ifndef TEMP_DIR_H_
+#define TEMP_DIR_H_
+
+// scratch space for tests which write files, so that nothing is left in the resource tree.
+
+#include <filesystem>
+#include <random>
+#include <string>
+
+namespace testfiles {
+
+/**
+ *  A fresh directory under the system's temp directory, removed along with its contents.
+ */
+class TempDir {
+ public:
+  TempDir() {
+    std::random_device rd;
+    path_ = std::filesystem::temp_directory_path() / ("monkeys-world-test-" + std::to_string(rd()));
+    std::filesystem::create_directories(path_);
+  }
+
+  ~TempDir() {
+    std::error_code err;
+    std::filesystem::remove_all(path_, err);
+  }
+
+  /**
+   *  @returns the path to `name` within this directory. Get("") ends in a separator, for
+   *           anything which wants a directory prefix.
+   */
+  std::string Get(const std::string& name) const {
+    return (path_ / name).string();
+  }
+
+  TempDir(const TempDir& other) = delete;
+  TempDir& operator=(const TempDir& other) = delete;
+
+ private:
+  std::filesystem::path path_;
+};
+
+}
+
+#endif  // TEMP_DIR_H_
@@ -0,0 +1,35 @@
+#ifndef TEST_SCENE_H_
+#define TEST_SCENE_H_
+
+// helpers shared by the tests and benchmarks which build scenes without an engine.
+
+#include <critter/Empty.hpp>
+#include <utils/Bounds.hpp>
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/trivial.hpp>
+
+namespace testscene {
+
+/**
+ *  Hides everything below a warning. AddChild traces every call, and UI objects complain
+ *  about running without GL.
+ */
+inline void QuietLogs() {
+  boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::warning);
+}
+
+/**
+ *  Empty which draws a box.
+ */
+class BoxEmpty : public ::monkeysworld::critter::Empty {
+ public:
+  BoxEmpty(const ::monkeysworld::utils::aabb& bounds) : Empty(nullptr) {
+    SetLocalBounds(bounds);
+  }
+};
+
+}
+
+#endif  // TEST_SCENE_H_
@@ -0,0 +1,315 @@
+#include <critter/GameObject.hpp>
+#include <critter/TransformHierarchy.hpp>
+
+#include <gtest/gtest.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/euler_angles.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using ::monkeysworld::critter::GameObject;
+using ::monkeysworld::critter::Object;
+using ::monkeysworld::critter::TransformHierarchy;
+using ::monkeysworld::critter::TransformReservation;
+using ::monkeysworld::engine::RenderContext;
+using ::monkeysworld::utils::aabb;
+using ::monkeysworld::utils::EmptyBounds;
+using ::monkeysworld::utils::InfiniteBounds;
+
+class DummyGameObject : public GameObject {
+ public:
+  DummyGameObject() : GameObject() {}
+  void PrepareAttributes() override {}
+  void RenderMaterial(const RenderContext& rc) override {}
+  void Draw() override {}
+};
+
+static glm::mat4 LocalMatrix(const glm::vec3& pos, const glm::vec3& rot, const glm::vec3& scale) {
+  glm::mat4 res = glm::translate(glm::mat4(1.0), pos);
+  res *= glm::eulerAngleYXZ(rot.y, rot.x, rot.z);
+  return glm::scale(res, scale);
+}
+
+static void AssertMatrixNear(const glm::mat4& expected, const glm::mat4& actual) {
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      ASSERT_NEAR(expected[i][j], actual[i][j], 0.001);
+    }
+  }
+}
+
+TEST(TransformHierarchyTests, NestedObjectsComposeParentTransforms) {
+  auto root = std::make_shared<DummyGameObject>();
+  auto child = std::make_shared<DummyGameObject>();
+  auto grandchild = std::make_shared<DummyGameObject>();
+  root->AddChild(child);
+  child->AddChild(grandchild);
+
+  root->SetPosition(glm::vec3(1, 2, 3));
+  root->SetRotation(glm::vec3(0, 1, 0));
+  child->SetScale(glm::vec3(2));
+  child->SetPosition(glm::vec3(0, 0, -1));
+  grandchild->SetRotation(glm::vec3(0.5, 0, 0.25));
+
+  glm::mat4 root_local = LocalMatrix(glm::vec3(1, 2, 3), glm::vec3(0, 1, 0), glm::vec3(1));
+  glm::mat4 child_local = LocalMatrix(glm::vec3(0, 0, -1), glm::vec3(0), glm::vec3(2));
+  glm::mat4 grandchild_local = LocalMatrix(glm::vec3(0), glm::vec3(0.5, 0, 0.25), glm::vec3(1));
+  AssertMatrixNear(root_local, root->GetTransformationMatrix());
+  AssertMatrixNear(root_local * child_local, child->GetTransformationMatrix());
+  AssertMatrixNear(root_local * child_local * grandchild_local, grandchild->GetTransformationMatrix());
+
+  // edits to the root reach the whole subtree
+  root->SetPosition(glm::vec3(0));
+  root_local = LocalMatrix(glm::vec3(0), glm::vec3(0, 1, 0), glm::vec3(1));
+  AssertMatrixNear(root_local * child_local * grandchild_local, grandchild->GetTransformationMatrix());
+}
+
+TEST(TransformHierarchyTests, ChildrenCreatedBeforeParents) {
+  TransformHierarchy transforms;
+  // built bottom up, so every node starts out ahead of its parent
+  std::vector<TransformHierarchy::handle> chain;
+  for (int i = 0; i < 16; i++) {
+    chain.push_back(transforms.Create());
+    transforms.SetPosition(chain.back(), glm::vec3(1, 0, 0));
+  }
+
+  for (int i = 0; i < 15; i++) {
+    transforms.SetParent(chain[i], chain[i + 1]);
+  }
+
+  // the last node created is the root, and the first is 16 levels deep
+  for (int i = 0; i < 16; i++) {
+    ASSERT_NEAR(16 - i, transforms.GetWorldMatrix(chain[i])[3][0], 0.001);
+  }
+
+  ASSERT_EQ(chain[1], transforms.GetParent(chain[0]));
+  ASSERT_EQ(TransformHierarchy::NONE, transforms.GetParent(chain[15]));
+}
+
+TEST(TransformHierarchyTests, ReparentingMovesSubtree) {
+  TransformHierarchy transforms;
+  auto a = transforms.Create();
+  auto b = transforms.Create();
+  auto c = transforms.Create();
+  transforms.SetPosition(a, glm::vec3(1, 0, 0));
+  transforms.SetPosition(b, glm::vec3(0, 1, 0));
+  transforms.SetPosition(c, glm::vec3(0, 0, 1));
+  transforms.SetParent(c, a);
+  ASSERT_NEAR(1.0, transforms.GetWorldMatrix(c)[3][0], 0.001);
+
+  // move c's subtree beneath a node which comes later
+  auto d = transforms.Create();
+  transforms.SetParent(d, c);
+  transforms.SetParent(c, b);
+  glm::mat4 world = transforms.GetWorldMatrix(d);
+  ASSERT_NEAR(0.0, world[3][0], 0.001);
+  ASSERT_NEAR(1.0, world[3][1], 0.001);
+  ASSERT_NEAR(1.0, world[3][2], 0.001);
+
+  transforms.SetParent(c, TransformHierarchy::NONE);
+  world = transforms.GetWorldMatrix(d);
+  ASSERT_NEAR(0.0, world[3][1], 0.001);
+  ASSERT_NEAR(1.0, world[3][2], 0.001);
+}
+
+TEST(TransformHierarchyTests, DestroyedNodesAreCompacted) {
+  TransformHierarchy transforms;
+  auto root = transforms.Create();
+  transforms.SetPosition(root, glm::vec3(0, 5, 0));
+  std::vector<TransformHierarchy::handle> nodes;
+  for (int i = 0; i < 100; i++) {
+    nodes.push_back(transforms.Create());
+    transforms.SetParent(nodes.back(), root);
+    transforms.SetPosition(nodes.back(), glm::vec3(i, 0, 0));
+  }
+
+  for (int i = 0; i < 100; i += 4) {
+    transforms.SetPosition(nodes[i], glm::vec3(0));
+  }
+
+  for (int i = 0; i < 100; i++) {
+    if (i % 4 != 0) {
+      transforms.Destroy(nodes[i]);
+    }
+  }
+
+  ASSERT_EQ(26, transforms.GetSize());
+  transforms.Update();
+  for (int i = 0; i < 100; i += 4) {
+    glm::mat4 world = transforms.GetWorldMatrix(nodes[i]);
+    ASSERT_NEAR(0.0, world[3][0], 0.001);
+    ASSERT_NEAR(5.0, world[3][1], 0.001);
+  }
+
+  // freed handles are reused
+  auto reused = transforms.Create();
+  ASSERT_LT(reused, 101);
+  ASSERT_EQ(27, transforms.GetSize());
+}
+
+TEST(TransformHierarchyTests, ObjectsSpawnedFromSeveralThreads) {
+  // objects without a context all share one hierarchy
+  auto transforms = std::make_shared<DummyGameObject>()->GetTransformHierarchy();
+  size_t before = transforms->GetSize();
+
+  const int THREADS = 4;
+  const int PAIRS = 250;
+  std::vector<std::vector<std::shared_ptr<DummyGameObject>>> spawned(THREADS);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; t++) {
+    threads.emplace_back([&spawned, t] {
+      Object::IdBlockScope scope;
+      for (int i = 0; i < PAIRS; i++) {
+        auto parent = std::make_shared<DummyGameObject>();
+        auto child = std::make_shared<DummyGameObject>();
+        parent->AddChild(child);
+        spawned[t].push_back(parent);
+        spawned[t].push_back(child);
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(before + THREADS * PAIRS * 2, transforms->GetSize());
+  for (int t = 0; t < THREADS; t++) {
+    for (int i = 0; i < PAIRS; i++) {
+      spawned[t][2 * i]->SetPosition(glm::vec3(t, i, 0));
+      spawned[t][2 * i + 1]->SetPosition(glm::vec3(0, 0, 1));
+    }
+  }
+
+  for (int t = 0; t < THREADS; t++) {
+    for (int i = 0; i < PAIRS; i++) {
+      glm::mat4 world = spawned[t][2 * i + 1]->GetTransformationMatrix();
+      ASSERT_NEAR(t, world[3][0], 0.001);
+      ASSERT_NEAR(i, world[3][1], 0.001);
+      ASSERT_NEAR(1.0, world[3][2], 0.001);
+    }
+  }
+}
+
+TEST(TransformHierarchyTests, ReservedNodesGetOwnersInBatches) {
+  auto transforms = std::make_shared<TransformHierarchy>();
+  // the hierarchy never dereferences owners
+  auto owner_a = reinterpret_cast<GameObject*>(0x10);
+  auto owner_b = reinterpret_cast<GameObject*>(0x20);
+  TransformHierarchy::handle a, b, reused;
+  {
+    TransformReservation reservation(8);
+    a = reservation.Create(transforms, owner_a);
+    b = reservation.Create(transforms, owner_b);
+    ASSERT_EQ(8, transforms->GetSize());
+    ASSERT_EQ(nullptr, transforms->GetOwner(a));
+
+    // b goes away before its owner is recorded -- whoever gets its handle next shouldn't inherit it
+    transforms->Destroy(b);
+    reused = transforms->Create();
+    ASSERT_EQ(b, reused);
+  }
+
+  ASSERT_EQ(owner_a, transforms->GetOwner(a));
+  ASSERT_EQ(nullptr, transforms->GetOwner(reused));
+  ASSERT_EQ(2, transforms->GetSize());
+}
+
+TEST(TransformHierarchyTests, ChildrenOutliveParents) {
+  auto child = std::make_shared<DummyGameObject>();
+  child->SetPosition(glm::vec3(0, 0, 1));
+  {
+    auto parent = std::make_shared<DummyGameObject>();
+    parent->SetPosition(glm::vec3(4, 0, 0));
+    parent->AddChild(child);
+    ASSERT_NEAR(4.0, child->GetTransformationMatrix()[3][0], 0.001);
+  }
+
+  // parent is gone, so the child is a root again
+  glm::mat4 world = child->GetTransformationMatrix();
+  ASSERT_NEAR(0.0, world[3][0], 0.001);
+  ASSERT_NEAR(1.0, world[3][2], 0.001);
+}
+
+static void AssertBoundsNear(const glm::vec3& min, const glm::vec3& max, const aabb& actual) {
+  for (int i = 0; i < 3; i++) {
+    ASSERT_NEAR(min[i], actual.min[i], 0.001);
+    ASSERT_NEAR(max[i], actual.max[i], 0.001);
+  }
+}
+
+TEST(TransformHierarchyTests, BoundsFollowTransforms) {
+  TransformHierarchy transforms;
+  auto root = transforms.Create();
+  auto child = transforms.Create();
+  auto grandchild = transforms.Create();
+  transforms.SetParent(child, root);
+  transforms.SetParent(grandchild, child);
+
+  // nothing is bounded yet
+  ASSERT_TRUE(IsInfinite(transforms.GetSubtreeBounds(root)));
+
+  aabb unit = { glm::vec3(-1), glm::vec3(1) };
+  transforms.SetLocalBounds(root, EmptyBounds());
+  transforms.SetLocalBounds(child, unit);
+  transforms.SetLocalBounds(grandchild, unit);
+  transforms.SetPosition(child, glm::vec3(10, 0, 0));
+  transforms.SetPosition(grandchild, glm::vec3(0, 0, 5));
+  transforms.SetScale(grandchild, glm::vec3(2));
+
+  ASSERT_TRUE(IsEmpty(transforms.GetWorldBounds(root)));
+  AssertBoundsNear(glm::vec3(9, -1, -1), glm::vec3(11, 1, 1), transforms.GetWorldBounds(child));
+  AssertBoundsNear(glm::vec3(8, -2, 3), glm::vec3(12, 2, 7), transforms.GetWorldBounds(grandchild));
+  transforms.Update();
+  AssertBoundsNear(glm::vec3(8, -2, -1), glm::vec3(12, 2, 7), transforms.GetSubtreeBounds(root));
+
+  // a quarter turn about y swaps x and z extents
+  transforms.SetRotation(root, glm::vec3(0, glm::radians(90.0f), 0));
+  AssertBoundsNear(glm::vec3(-1, -1, -11), glm::vec3(1, 1, -9), transforms.GetWorldBounds(child));
+
+  // detached subtrees stop counting towards their old parent
+  transforms.SetRotation(root, glm::vec3(0));
+  transforms.SetParent(grandchild, TransformHierarchy::NONE);
+  transforms.Update();
+  AssertBoundsNear(glm::vec3(9, -1, -1), glm::vec3(11, 1, 1), transforms.GetSubtreeBounds(root));
+  AssertBoundsNear(glm::vec3(-2, -2, 3), glm::vec3(2, 2, 7), transforms.GetSubtreeBounds(grandchild));
+
+  transforms.SetLocalBounds(child, InfiniteBounds());
+  transforms.Update();
+  ASSERT_TRUE(IsInfinite(transforms.GetSubtreeBounds(root)));
+
+  transforms.SetParent(child, TransformHierarchy::NONE);
+  transforms.Destroy(child);
+  transforms.Update();
+  ASSERT_TRUE(IsEmpty(transforms.GetSubtreeBounds(root)));
+}
+
+TEST(TransformHierarchyTests, ReadsBetweenPassesOnlyResolveTheirChain) {
+  TransformHierarchy transforms;
+  auto root = transforms.Create();
+  auto child = transforms.Create();
+  auto grandchild = transforms.Create();
+  auto other = transforms.Create();
+  transforms.SetParent(child, root);
+  transforms.SetParent(grandchild, child);
+  transforms.SetParent(other, root);
+  transforms.Update();
+
+  transforms.SetPosition(root, glm::vec3(1, 0, 0));
+  transforms.SetPosition(child, glm::vec3(0, 2, 0));
+  AssertMatrixNear(glm::translate(glm::mat4(1.0), glm::vec3(1, 2, 0)), transforms.GetWorldMatrix(child));
+
+  // the subtree bounds still come from the last pass
+  transforms.SetLocalBounds(grandchild, { glm::vec3(-1), glm::vec3(1) });
+  AssertBoundsNear(glm::vec3(0, 1, -1), glm::vec3(2, 3, 1), transforms.GetWorldBounds(grandchild));
+  ASSERT_TRUE(IsInfinite(transforms.GetSubtreeBounds(grandchild)));
+
+  // reading one chain leaves the rest for the pass to pick up
+  transforms.Update();
+  AssertMatrixNear(glm::translate(glm::mat4(1.0), glm::vec3(1, 0, 0)), transforms.GetWorldMatrix(other));
+  AssertMatrixNear(glm::translate(glm::mat4(1.0), glm::vec3(1, 2, 0)), transforms.GetWorldMatrix(grandchild));
+  AssertBoundsNear(glm::vec3(0, 1, -1), glm::vec3(2, 3, 1), transforms.GetSubtreeBounds(grandchild));
+}
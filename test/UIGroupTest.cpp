@@ -0,0 +1,1027 @@
+#include <gtest/gtest.h>
+#include <critter/ui/UIGroup.hpp>
+
+#include "LegacyUILayout.hpp"
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// groups are built without a context -- only the redraw tests draw, through FakeGL below
+
+using ::monkeysworld::critter::Object;
+using ::monkeysworld::critter::ui::CompositeBatcher;
+using ::monkeysworld::critter::ui::composite_quad;
+using ::monkeysworld::critter::ui::UIGroup;
+using ::monkeysworld::critter::ui::UIObject;
+using ::monkeysworld::critter::ui::layout::Face;
+using ::monkeysworld::critter::ui::layout::Margin;
+using ::monkeysworld::critter::ui::layout::MarginType;
+using ::monkeysworld::critter::ui::layout::UILayoutParams;
+using ::monkeysworld::engine::RenderContext;
+using ::monkeysworld::input::MouseEvent;
+using ::monkeysworld::shader::Canvas;
+
+class DummyUIObject : public UIObject {
+ public:
+  DummyUIObject() : UIObject(nullptr) {}
+  void DrawUI(glm::vec2 min, glm::vec2 max, Canvas canvas) override {
+    // do nothing
+  }
+};
+
+TEST(UIGroupTests, FindNestedChildren) {
+  auto root = std::make_shared<UIGroup>(nullptr);
+  auto inner = std::make_shared<UIGroup>(nullptr);
+  auto leaf = std::make_shared<DummyUIObject>();
+  root->AddChild(inner);
+  inner->AddChild(leaf);
+
+  ASSERT_EQ(root, root->GetChild(root->GetId()));
+  ASSERT_EQ(inner, root->GetChild(inner->GetId()));
+  ASSERT_EQ(leaf, root->GetChild(leaf->GetId()));
+  ASSERT_EQ(nullptr, inner->GetChild(root->GetId()));
+  ASSERT_EQ(nullptr, leaf->GetChild(leaf->GetId()));
+
+  // no cycles
+  inner->AddChild(root);
+  ASSERT_EQ(nullptr, root->GetParent());
+  ASSERT_EQ(root, inner->GetParent());
+}
+
+TEST(UIGroupTests, RemoveFromAnyNestedGroup) {
+  auto root = std::make_shared<UIGroup>(nullptr);
+  auto first = std::make_shared<UIGroup>(nullptr);
+  auto second = std::make_shared<UIGroup>(nullptr);
+  auto leaf = std::make_shared<DummyUIObject>();
+  root->AddChild(first);
+  root->AddChild(second);
+  second->AddChild(leaf);
+
+  root->RemoveChild(leaf->GetId());
+  ASSERT_EQ(nullptr, leaf->GetParent());
+  ASSERT_EQ(0, second->GetChildren().size());
+  ASSERT_EQ(nullptr, root->GetChild(leaf->GetId()));
+  ASSERT_EQ(2, root->GetChildren().size());
+}
+
+TEST(UIGroupTests, RemoveChildrenNobodyElseHolds) {
+  auto root = std::make_shared<UIGroup>(nullptr);
+  auto inner = std::make_shared<UIGroup>(nullptr);
+  root->AddChild(inner);
+  uint64_t leaf_id, inner_id = inner->GetId();
+  {
+    auto leaf = std::make_shared<DummyUIObject>();
+    leaf_id = leaf->GetId();
+    inner->AddChild(leaf);
+  }
+
+  // build the hit index, so removing has it to update too
+  root->GetObjectAt(glm::vec2(0, 0), nullptr);
+  inner->GetObjectAt(glm::vec2(0, 0), nullptr);
+  inner.reset();
+
+  root->RemoveChild(leaf_id);
+  ASSERT_EQ(nullptr, root->GetChild(leaf_id));
+  root->RemoveChild(inner_id);
+  ASSERT_EQ(nullptr, root->GetChild(inner_id));
+  ASSERT_EQ(0, root->GetChildren().size());
+}
+
+TEST(UIGroupTests, LayoutFollowsAnchors) {
+  auto group = std::make_shared<UIGroup>(nullptr);
+  group->SetDimensions(glm::vec2(100, 400));
+  std::vector<std::shared_ptr<DummyUIObject>> column;
+  uint64_t anchor = group->GetId();
+  Face face = Face::TOP;
+  for (int i = 0; i < 4; i++) {
+    auto child = std::make_shared<DummyUIObject>();
+    child->SetDimensions(glm::vec2(50, 20));
+    UILayoutParams params = child->GetLayoutParams();
+    params.top.anchor_id = anchor;
+    params.top.anchor_face = face;
+    params.top.margin = 10.0f;
+    child->SetLayoutParams(params);
+    group->AddChild(child);
+    column.push_back(child);
+
+    anchor = child->GetId();
+    face = Face::BOTTOM;
+  }
+
+  group->Layout(group->GetDimensions());
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(glm::vec2(0, 10 + 30 * i), column[i]->GetPosition());
+    ASSERT_EQ(glm::vec2(50, 20), column[i]->GetDimensions());
+  }
+}
+
+TEST(UIGroupTests, LayoutOnlyWhatMoved) {
+  auto group = std::make_shared<UIGroup>(nullptr);
+  group->SetDimensions(glm::vec2(100, 4000));
+  std::vector<std::shared_ptr<DummyUIObject>> column;
+  uint64_t anchor = group->GetId();
+  Face face = Face::TOP;
+  for (int i = 0; i < 100; i++) {
+    auto child = std::make_shared<DummyUIObject>();
+    child->SetDimensions(glm::vec2(50, 20));
+    UILayoutParams params = child->GetLayoutParams();
+    params.top.anchor_id = anchor;
+    params.top.anchor_face = face;
+    child->SetLayoutParams(params);
+    group->AddChild(child);
+    column.push_back(child);
+
+    anchor = child->GetId();
+    face = Face::BOTTOM;
+  }
+
+  group->Layout(group->GetDimensions());
+  ASSERT_TRUE(group->GetLayoutStats().rebuilt);
+  ASSERT_EQ(100, group->GetLayoutStats().solved);
+
+  group->Layout(group->GetDimensions());
+  ASSERT_FALSE(group->GetLayoutStats().rebuilt);
+  ASSERT_EQ(0, group->GetLayoutStats().solved);
+
+  // everything below a taller child moves down
+  column[60]->SetDimensions(glm::vec2(50, 30));
+  group->Layout(group->GetDimensions());
+  ASSERT_EQ(40, group->GetLayoutStats().solved);
+  ASSERT_EQ(39, group->GetLayoutStats().moved);
+  ASSERT_EQ(glm::vec2(0, 99 * 20 + 10), column[99]->GetPosition());
+
+  // a child dragged out of place is put back, and nothing else moves
+  column[99]->SetPosition(glm::vec2(0, 0));
+  group->Layout(group->GetDimensions());
+  ASSERT_EQ(1, group->GetLayoutStats().solved);
+  ASSERT_EQ(glm::vec2(0, 99 * 20 + 10), column[99]->GetPosition());
+}
+
+/**
+ *  Anchors on each face of a child, as indices into the tree's children.
+ */
+static const int ANCHOR_GROUP = -1;
+static const int ANCHOR_NONE = -2;
+
+/**
+ *  Two copies of a UI tree, one laid out by the original solver and one by UIGroup.
+ */
+class LayoutPair {
+ public:
+  LayoutPair() {
+    legacy = std::make_shared<UIGroup>(nullptr);
+    current = std::make_shared<UIGroup>(nullptr);
+  }
+
+  void AddChild(glm::vec2 pos, glm::vec2 dims) {
+    for (auto& tree : { std::make_pair(legacy, &legacy_children), std::make_pair(current, &current_children) }) {
+      auto child = std::make_shared<DummyUIObject>();
+      child->SetPosition(pos);
+      child->SetDimensions(dims);
+      tree.first->AddChild(child);
+      tree.second->push_back(child);
+    }
+  }
+
+  void RemoveChild(size_t index) {
+    // whatever hung off it hangs off the group instead
+    for (size_t i = 0; i < legacy_children.size(); i++) {
+      for (int face = 0; face < 4; face++) {
+        if (GetAnchor(i, face) == static_cast<int>(index)) {
+          SetAnchor(i, face, ANCHOR_GROUP, GetFace(i, face));
+        }
+      }
+    }
+
+    legacy->RemoveChild(legacy_children[index]->GetId());
+    current->RemoveChild(current_children[index]->GetId());
+    legacy_children.erase(legacy_children.begin() + index);
+    current_children.erase(current_children.begin() + index);
+  }
+
+  int GetAnchor(size_t index, int face) {
+    UILayoutParams params = legacy_children[index]->GetLayoutParams();
+    uint64_t id = GetMargin(&params, face)->anchor_id;
+    if (id == 0) {
+      return ANCHOR_NONE;
+    } else if (id == legacy->GetId()) {
+      return ANCHOR_GROUP;
+    }
+
+    for (size_t i = 0; i < legacy_children.size(); i++) {
+      if (legacy_children[i]->GetId() == id) {
+        return static_cast<int>(i);
+      }
+    }
+
+    return ANCHOR_NONE;
+  }
+
+  Face GetFace(size_t index, int face) {
+    UILayoutParams params = legacy_children[index]->GetLayoutParams();
+    return GetMargin(&params, face)->anchor_face;
+  }
+
+  void SetAnchor(size_t index, int face, int anchor, Face anchor_face) {
+    Edit(index, [&](UILayoutParams* params, UIGroup* group, std::vector<std::shared_ptr<DummyUIObject>>& children) {
+      Margin* margin = GetMargin(params, face);
+      margin->anchor_id = (anchor == ANCHOR_NONE ? 0 : (anchor == ANCHOR_GROUP ? group->GetId() : children[anchor]->GetId()));
+      margin->anchor_face = anchor_face;
+    });
+  }
+
+  void SetMargin(size_t index, int face, float dist, bool automatic) {
+    Edit(index, [&](UILayoutParams* params, UIGroup* group, std::vector<std::shared_ptr<DummyUIObject>>& children) {
+      Margin* margin = GetMargin(params, face);
+      margin->margin = dist;
+      if (automatic) {
+        margin->margin.type = MarginType::AUTO;
+      }
+    });
+  }
+
+  void Layout() {
+    legacyui::Layout(legacy.get());
+    current->Layout(current->GetDimensions());
+  }
+
+  std::shared_ptr<UIGroup> legacy;
+  std::shared_ptr<UIGroup> current;
+  std::vector<std::shared_ptr<DummyUIObject>> legacy_children;
+  std::vector<std::shared_ptr<DummyUIObject>> current_children;
+
+ private:
+  template <typename Func>
+  void Edit(size_t index, Func func) {
+    for (auto& tree : { std::make_pair(legacy, &legacy_children), std::make_pair(current, &current_children) }) {
+      auto& child = (*tree.second)[index];
+      UILayoutParams params = child->GetLayoutParams();
+      func(&params, tree.first.get(), *tree.second);
+      child->SetLayoutParams(params);
+    }
+  }
+
+  static Margin* GetMargin(UILayoutParams* params, int face) {
+    Margin* margins[4] = { &params->top, &params->bottom, &params->left, &params->right };
+    return margins[face];
+  }
+};
+
+TEST(UIGroupTests, IncrementalLayoutMatchesFullLayout) {
+  std::mt19937 gen(11);
+  LayoutPair pair;
+  pair.legacy->SetDimensions(glm::vec2(300, 200));
+  pair.current->SetDimensions(glm::vec2(300, 200));
+
+  // faces which make sense for each margin: top, bottom, left, right
+  const Face faces[4][2] = { { Face::TOP, Face::BOTTOM }, { Face::TOP, Face::BOTTOM },
+                             { Face::LEFT, Face::RIGHT }, { Face::LEFT, Face::RIGHT } };
+  auto random_pos = [&] { return glm::vec2(static_cast<int>(gen() % 200) - 50, static_cast<int>(gen() % 150) - 50); };
+  auto random_dims = [&] { return glm::vec2(1 + gen() % 40, 1 + gen() % 40); };
+  auto random_dist = [&] { return static_cast<float>(static_cast<int>(gen() % 21) - 10) / 2; };
+
+  // anchored to the group or to children added before, so it starts out with no cycles
+  for (size_t i = 0; i < 60; i++) {
+    pair.AddChild(random_pos(), random_dims());
+    for (int face = 0; face < 4; face++) {
+      if (gen() % 3 == 0) {
+        continue;
+      }
+
+      int anchor = (i == 0 || gen() % 4 == 0 ? ANCHOR_GROUP : static_cast<int>(gen() % i));
+      pair.SetAnchor(i, face, anchor, faces[face][gen() % 2]);
+      pair.SetMargin(i, face, random_dist(), gen() % 5 == 0);
+    }
+  }
+
+  uint64_t legacy_solved = 0, current_solved = 0;
+  for (int frame = 0; frame < 2000; frame++) {
+    size_t index = gen() % pair.legacy_children.size();
+    int face = static_cast<int>(gen() % 4);
+    // re-anchoring, adding and removing sort everything again, so they're rarer
+    switch (gen() % 16) {
+      case 0: {
+        glm::vec2 pos = random_pos();
+        pair.legacy_children[index]->SetPosition(pos);
+        pair.current_children[index]->SetPosition(pos);
+        break;
+      }
+      case 1: {
+        glm::vec2 dims = random_dims();
+        pair.legacy_children[index]->SetDimensions(dims);
+        pair.current_children[index]->SetDimensions(dims);
+        break;
+      }
+      case 2:
+        pair.SetMargin(index, face, random_dist(), gen() % 5 == 0);
+        break;
+      case 3: {
+        // anywhere at all -- cycles lay out nothing, until they're broken again
+        size_t count = pair.legacy_children.size();
+        int anchor = (gen() % 3 == 0 ? ANCHOR_NONE : static_cast<int>(gen() % (count + 1)) - 1);
+        if (gen() % 4 != 0 && anchor >= static_cast<int>(index)) {
+          anchor = ANCHOR_GROUP;
+        }
+
+        pair.SetAnchor(index, face, anchor, faces[face][gen() % 2]);
+        break;
+      }
+      case 4: {
+        glm::vec2 dims(200 + gen() % 200, 150 + gen() % 100);
+        pair.legacy->SetDimensions(dims);
+        pair.current->SetDimensions(dims);
+        break;
+      }
+      case 5:
+        if (gen() % 2 == 0 && pair.legacy_children.size() > 20) {
+          pair.RemoveChild(index);
+        } else {
+          pair.AddChild(random_pos(), random_dims());
+          pair.SetAnchor(pair.legacy_children.size() - 1, face, static_cast<int>(index), faces[face][gen() % 2]);
+        }
+
+        break;
+      default:
+        // nothing changed
+        break;
+    }
+
+    pair.Layout();
+    legacy_solved += pair.legacy_children.size();
+    current_solved += pair.current->GetLayoutStats().solved;
+    for (size_t i = 0; i < pair.legacy_children.size(); i++) {
+      ASSERT_EQ(pair.legacy_children[i]->GetPosition(), pair.current_children[i]->GetPosition()) << "frame " << frame << ", child " << i;
+      ASSERT_EQ(pair.legacy_children[i]->GetDimensions(), pair.current_children[i]->GetDimensions()) << "frame " << frame << ", child " << i;
+    }
+  }
+
+  // random anchors make plenty of boxes which never settle, and get solved every pass --
+  // even so, one change a frame shouldn't come close to solving everything
+  ASSERT_LT(current_solved * 2, legacy_solved);
+}
+
+// redraws run through the real UIObject path, against just enough of GL -- in software -- to
+// hold each framebuffer as an array of colors. the viewport and scissor clip every clear and
+// draw like they would on a GPU, so a wrong damage rect or scissor shows up as stale pixels.
+
+typedef std::vector<uint32_t> image;
+
+/**
+ *  Stands in for the GL entry points UIObject::Redraw reaches, while it's in scope.
+ */
+class FakeGL {
+ public:
+  FakeGL() {
+    active_ = this;
+    glad_glGenTextures = GenTextures;
+    glad_glBindTexture = BindTexture;
+    glad_glTexImage2D = TexImage2D;
+    glad_glTexParameteri = TexParameteri;
+    glad_glGenFramebuffers = GenFramebuffers;
+    glad_glBindFramebuffer = BindFramebuffer;
+    glad_glGetIntegerv = GetIntegerv;
+    glad_glFramebufferTexture2D = FramebufferTexture2D;
+    glad_glCheckFramebufferStatus = CheckFramebufferStatus;
+    glad_glViewport = Viewport;
+    glad_glEnable = Enable;
+    glad_glDisable = Disable;
+    glad_glScissor = Scissor;
+    glad_glClearColor = ClearColor;
+    glad_glClear = Clear;
+
+    // there's no window to free framebuffers into -- every resize would complain
+    boost::log::core::get()->set_filter(boost::log::trivial::severity > boost::log::trivial::error);
+  }
+
+  ~FakeGL() {
+    glad_glGenTextures = nullptr;
+    glad_glBindTexture = nullptr;
+    glad_glTexImage2D = nullptr;
+    glad_glTexParameteri = nullptr;
+    glad_glGenFramebuffers = nullptr;
+    glad_glBindFramebuffer = nullptr;
+    glad_glGetIntegerv = nullptr;
+    glad_glFramebufferTexture2D = nullptr;
+    glad_glCheckFramebufferStatus = nullptr;
+    glad_glViewport = nullptr;
+    glad_glEnable = nullptr;
+    glad_glDisable = nullptr;
+    glad_glScissor = nullptr;
+    glad_glClearColor = nullptr;
+    glad_glClear = nullptr;
+    boost::log::core::get()->reset_filter();
+    active_ = nullptr;
+  }
+
+  static FakeGL* Get() {
+    return active_;
+  }
+
+  /**
+   *  Draws a flat color over the viewport of the bound framebuffer.
+   */
+  void Fill(uint32_t color) {
+    for (int y = viewport_.y; y < viewport_.y + viewport_.w; y++) {
+      for (int x = viewport_.x; x < viewport_.x + viewport_.z; x++) {
+        Draw(x, y, color);
+      }
+    }
+  }
+
+  /**
+   *  Draws `child`'s framebuffer at its position in the viewport of the bound framebuffer.
+   */
+  void Blit(UIObject* child) {
+    const image& src = Read(child);
+    glm::ivec2 pos = child->GetPosition();
+    glm::ivec2 dims = child->GetDimensions();
+    for (int y = 0; y < dims.y; y++) {
+      for (int x = 0; x < dims.x; x++) {
+        // viewport coords are bottom up, ours are top down
+        Draw(viewport_.x + pos.x + x, viewport_.y + viewport_.w - 1 - (pos.y + y), src[y * dims.x + x]);
+      }
+    }
+  }
+
+  /**
+   *  @returns what's in `object`'s framebuffer, top row first.
+   */
+  image Read(UIObject* object) {
+    auto& tex = textures_[color_[object->GetFramebuffer()]];
+    glm::ivec2 dims = object->GetDimensions();
+    image res(dims.x * dims.y);
+    for (int y = 0; y < dims.y; y++) {
+      for (int x = 0; x < dims.x; x++) {
+        res[y * dims.x + x] = tex.pixels[(tex.size.y - 1 - y) * tex.size.x + x];
+      }
+    }
+
+    return res;
+  }
+
+ private:
+  struct texture {
+    glm::ivec2 size;
+    image pixels;
+  };
+
+  /**
+   *  Writes one fragment, at GL coords on the bound framebuffer.
+   */
+  void Draw(int x, int y, uint32_t color) {
+    if (x < viewport_.x || y < viewport_.y || x >= viewport_.x + viewport_.z || y >= viewport_.y + viewport_.w) {
+      return;
+    }
+
+    Write(x, y, color);
+  }
+
+  /**
+   *  Writes one pixel, at GL coords on the bound framebuffer, if the scissor lets it through.
+   */
+  void Write(int x, int y, uint32_t color) {
+    if (scissor_test_ && (x < scissor_.x || y < scissor_.y || x >= scissor_.x + scissor_.z || y >= scissor_.y + scissor_.w)) {
+      return;
+    }
+
+    auto& tex = textures_[color_[fb_]];
+    if (x < 0 || y < 0 || x >= tex.size.x || y >= tex.size.y) {
+      return;
+    }
+
+    tex.pixels[y * tex.size.x + x] = color;
+  }
+
+  static void APIENTRY GenTextures(GLsizei n, GLuint* names) {
+    for (GLsizei i = 0; i < n; i++) {
+      names[i] = ++active_->next_name_;
+    }
+  }
+
+  static void APIENTRY BindTexture(GLenum target, GLuint texture) {
+    active_->texture_ = texture;
+  }
+
+  static void APIENTRY TexImage2D(GLenum target, GLint level, GLint internal, GLsizei w, GLsizei h,
+                                  GLint border, GLenum format, GLenum type, const void* data) {
+    // a new texture holds garbage until it's drawn
+    active_->textures_[active_->texture_] = { glm::ivec2(w, h), image(w * h, 0xDEADBEEF) };
+  }
+
+  static void APIENTRY TexParameteri(GLenum target, GLenum name, GLint param) {}
+
+  static void APIENTRY GenFramebuffers(GLsizei n, GLuint* names) {
+    GenTextures(n, names);
+  }
+
+  static void APIENTRY BindFramebuffer(GLenum target, GLuint fb) {
+    active_->fb_ = fb;
+  }
+
+  // draw and read share one binding here, which is all the redraws use
+  static void APIENTRY GetIntegerv(GLenum name, GLint* data) {
+    if (name == GL_DRAW_FRAMEBUFFER_BINDING) {
+      *data = static_cast<GLint>(active_->fb_);
+    }
+  }
+
+  static void APIENTRY FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+    if (attachment == GL_COLOR_ATTACHMENT0) {
+      active_->color_[active_->fb_] = texture;
+    }
+  }
+
+  static GLenum APIENTRY CheckFramebufferStatus(GLenum target) {
+    return GL_FRAMEBUFFER_COMPLETE;
+  }
+
+  static void APIENTRY Viewport(GLint x, GLint y, GLsizei w, GLsizei h) {
+    active_->viewport_ = glm::ivec4(x, y, w, h);
+  }
+
+  static void APIENTRY Enable(GLenum cap) {
+    if (cap == GL_SCISSOR_TEST) {
+      active_->scissor_test_ = true;
+    }
+  }
+
+  static void APIENTRY Disable(GLenum cap) {
+    if (cap == GL_SCISSOR_TEST) {
+      active_->scissor_test_ = false;
+    }
+  }
+
+  static void APIENTRY Scissor(GLint x, GLint y, GLsizei w, GLsizei h) {
+    active_->scissor_ = glm::ivec4(x, y, w, h);
+  }
+
+  // the clear color differs between debug and release builds -- clears show up as 0 either way
+  static void APIENTRY ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {}
+
+  static void APIENTRY Clear(GLbitfield mask) {
+    // clears ignore the viewport, but not the scissor
+    auto& tex = active_->textures_[active_->color_[active_->fb_]];
+    for (int y = 0; y < tex.size.y; y++) {
+      for (int x = 0; x < tex.size.x; x++) {
+        active_->Write(x, y, 0);
+      }
+    }
+  }
+
+  static FakeGL* active_;
+
+  GLuint next_name_ = 0;
+  GLuint texture_ = 0;
+  GLuint fb_ = 0;
+  glm::ivec4 viewport_ = glm::ivec4(0);
+  glm::ivec4 scissor_ = glm::ivec4(0);
+  bool scissor_test_ = false;
+  std::unordered_map<GLuint, GLuint> color_;           // framebuffer -> color attachment
+  std::unordered_map<GLuint, texture> textures_;
+};
+
+FakeGL* FakeGL::active_ = nullptr;
+
+/**
+ *  @returns `group`'s children, bottom first.
+ */
+static std::vector<UIObject*> DrawOrder(UIObject* group) {
+  std::vector<UIObject*> res;
+  for (auto& child : group->GetChildren()) {
+    res.push_back(static_cast<UIObject*>(child.get()));
+  }
+
+  std::stable_sort(res.begin(), res.end(), [](UIObject* a, UIObject* b) {
+    return a->z_index > b->z_index;
+  });
+
+  return res;
+}
+
+/**
+ *  What the tests need from each object. Damage accessors are protected, so each test type
+ *  passes them through.
+ */
+class Painted {
+ public:
+  virtual void GetDamage(glm::ivec2* min, glm::ivec2* max) = 0;
+  virtual ~Painted() {}
+};
+
+class ColorLeaf : public UIObject, public Painted {
+ public:
+  ColorLeaf(uint32_t color) : UIObject(nullptr), color(color) {}
+  void DrawUI(glm::vec2 min, glm::vec2 max, Canvas canvas) override {
+    // the scissor keeps this to the damaged region
+    FakeGL::Get()->Fill(color);
+  }
+
+  void GetDamage(glm::ivec2* min, glm::ivec2* max) override {
+    glm::vec2 a, b;
+    GetInvalidatedBoundingBox(&a, &b);
+    *min = a;
+    *max = b;
+  }
+
+  uint32_t color;
+};
+
+class PaintedGroup : public UIGroup, public Painted {
+ public:
+  PaintedGroup() : UIGroup(nullptr) {}
+  void DrawUI(glm::vec2 min, glm::vec2 max, Canvas canvas) override {
+    for (auto child : DrawOrder(this)) {
+      FakeGL::Get()->Blit(child);
+    }
+  }
+
+  void GetDamage(glm::ivec2* min, glm::ivec2* max) override {
+    glm::vec2 a, b;
+    GetInvalidatedBoundingBox(&a, &b);
+    *min = a;
+    *max = b;
+  }
+
+  void BeginRedraw() {
+    UpdateDamage();
+  }
+
+  void EndRedraw() {
+    ClearDamage();
+  }
+};
+
+/**
+ *  @returns what `object` should look like, drawn from scratch.
+ */
+static image Expected(UIObject* object) {
+  glm::ivec2 size = object->GetDimensions();
+  if (auto leaf = dynamic_cast<ColorLeaf*>(object)) {
+    return image(size.x * size.y, leaf->color);
+  }
+
+  image res(size.x * size.y, 0);
+  for (auto child : DrawOrder(object)) {
+    image src = Expected(child);
+    glm::ivec2 pos = child->GetPosition();
+    glm::ivec2 dims = child->GetDimensions();
+    for (int y = std::max(pos.y, 0); y < std::min(pos.y + dims.y, size.y); y++) {
+      for (int x = std::max(pos.x, 0); x < std::min(pos.x + dims.x, size.x); x++) {
+        res[y * size.x + x] = src[(y - pos.y) * dims.x + (x - pos.x)];
+      }
+    }
+  }
+
+  return res;
+}
+
+/**
+ *  @returns the number of pixels a full redraw of `object` touches.
+ */
+static uint64_t FullRedrawPixels(UIObject* object) {
+  glm::ivec2 size = object->GetDimensions();
+  uint64_t res = static_cast<uint64_t>(size.x) * size.y;
+  for (auto& child : object->GetChildren()) {
+    res += FullRedrawPixels(static_cast<UIObject*>(child.get()));
+  }
+
+  return res;
+}
+
+TEST(UIGroupTests, PartialRedrawsMatchFullRedraws) {
+  FakeGL gl;
+  RenderContext rc;
+  std::mt19937 gen(7);
+  auto root = std::make_shared<PaintedGroup>();
+  root->SetDimensions(glm::vec2(96, 64));
+  std::vector<std::shared_ptr<PaintedGroup>> groups = { root };
+  std::vector<std::shared_ptr<ColorLeaf>> leaves;
+  for (int i = 0; i < 3; i++) {
+    auto group = std::make_shared<PaintedGroup>();
+    group->SetDimensions(glm::vec2(40, 30));
+    group->SetPosition(glm::vec2(i * 25, i * 12));
+    group->z_index = i;
+    groups[gen() % groups.size()]->AddChild(group);
+    groups.push_back(group);
+  }
+
+  for (int i = 0; i < 12; i++) {
+    auto leaf = std::make_shared<ColorLeaf>(i + 1);
+    leaf->SetDimensions(glm::vec2(4 + gen() % 12, 4 + gen() % 12));
+    leaf->SetPosition(glm::vec2(gen() % 40, gen() % 30));
+    leaf->z_index = i;
+    groups[gen() % groups.size()]->AddChild(leaf);
+    leaves.push_back(leaf);
+  }
+
+  root->RenderMaterial(rc);
+  ASSERT_EQ(Expected(root.get()), gl.Read(root.get()));
+
+  uint64_t partial_pixels = 0, full_pixels = 0;
+  for (int frame = 0; frame < 200; frame++) {
+    auto& leaf = leaves[gen() % leaves.size()];
+    switch (gen() % 5) {
+      case 0:
+        leaf->color += 100;
+        leaf->Invalidate();
+        break;
+      case 1:
+        leaf->SetPosition(glm::vec2(gen() % 40, gen() % 30));
+        break;
+      case 2:
+        leaf->SetDimensions(glm::vec2(4 + gen() % 12, 4 + gen() % 12));
+        break;
+      case 3:
+        groups[gen() % groups.size()]->AddChild(leaf);
+        break;
+      case 4:
+        // nothing changed -- nothing should be drawn
+        break;
+    }
+
+    root->RenderMaterial(rc);
+    partial_pixels += root->GetRedrawStats().pixels;
+    full_pixels += FullRedrawPixels(root.get());
+    ASSERT_EQ(Expected(root.get()), gl.Read(root.get())) << "frame " << frame;
+  }
+
+  // a leaf changing shouldn't come close to redrawing everything
+  ASSERT_LT(partial_pixels * 4, full_pixels);
+}
+
+TEST(UIGroupTests, UnchangedTreesRedrawNothing) {
+  auto root = std::make_shared<PaintedGroup>();
+  root->SetDimensions(glm::vec2(64, 64));
+  auto leaf = std::make_shared<ColorLeaf>(1);
+  auto other = std::make_shared<ColorLeaf>(2);
+  leaf->SetDimensions(glm::vec2(8, 8));
+  leaf->SetPosition(glm::vec2(10, 20));
+  other->SetDimensions(glm::vec2(8, 8));
+  root->AddChild(leaf);
+  root->AddChild(other);
+  root->BeginRedraw();
+  root->EndRedraw();
+
+  glm::ivec2 min, max;
+  root->BeginRedraw();
+  root->GetDamage(&min, &max);
+  ASSERT_EQ(min, max);
+  root->EndRedraw();
+
+  // one leaf changes: the group recomposites its area, and the other leaf isn't touched
+  leaf->Invalidate();
+  root->BeginRedraw();
+  root->GetDamage(&min, &max);
+  ASSERT_EQ(glm::ivec2(10, 20), min);
+  ASSERT_EQ(glm::ivec2(18, 28), max);
+  other->GetDamage(&min, &max);
+  ASSERT_EQ(min, max);
+  root->EndRedraw();
+}
+
+static composite_quad Quad(float index) {
+  composite_quad quad = {};
+  quad.opacity = index;
+  return quad;
+}
+
+TEST(CompositeBatcherTests, ShareUnitsBetweenChildrenOnOneTexture) {
+  CompositeBatcher batcher;
+  batcher.Begin(16);
+
+  // a hundred atlased widgets across two pages, and a few with framebuffers of their own
+  for (int i = 0; i < 100; i++) {
+    batcher.Add(static_cast<GLuint>(1 + (i % 2)), Quad(static_cast<float>(i)));
+  }
+
+  for (int i = 0; i < 10; i++) {
+    batcher.Add(static_cast<GLuint>(10 + i), Quad(100.0f + i));
+  }
+
+  auto& batches = batcher.GetBatches();
+  ASSERT_EQ(1, batches.size());
+  ASSERT_EQ(110, batches[0].count);
+  ASSERT_EQ(12, batches[0].textures.size());
+
+  auto& quads = batcher.GetQuads();
+  for (size_t i = 0; i < quads.size(); i++) {
+    // order is kept, and each quad points at its own texture
+    ASSERT_EQ(static_cast<float>(i), quads[i].opacity);
+    GLuint texture = batches[0].textures[static_cast<size_t>(quads[i].slot)];
+    ASSERT_EQ((i < 100 ? 1 + (i % 2) : 10 + (i - 100)), texture);
+  }
+}
+
+TEST(CompositeBatcherTests, SplitWhenOutOfUnits) {
+  CompositeBatcher batcher;
+  batcher.Begin(4);
+  GLuint textures[] = { 1, 2, 3, 4, 1, 5, 6, 2, 7, 8, 9 };
+  for (int i = 0; i < 11; i++) {
+    batcher.Add(textures[i], Quad(static_cast<float>(i)));
+  }
+
+  auto& batches = batcher.GetBatches();
+  ASSERT_EQ(3, batches.size());
+  ASSERT_EQ(0, batches[0].first);
+  ASSERT_EQ(5, batches[0].count);
+  ASSERT_EQ((std::vector<GLuint> { 1, 2, 3, 4 }), batches[0].textures);
+  ASSERT_EQ(5, batches[1].first);
+  ASSERT_EQ(4, batches[1].count);
+  ASSERT_EQ((std::vector<GLuint> { 5, 6, 2, 7 }), batches[1].textures);
+  ASSERT_EQ(9, batches[2].first);
+  ASSERT_EQ(2, batches[2].count);
+  ASSERT_EQ((std::vector<GLuint> { 8, 9 }), batches[2].textures);
+
+  // starting over clears everything
+  batcher.Begin(4);
+  ASSERT_TRUE(batcher.GetQuads().empty());
+  ASSERT_TRUE(batcher.GetBatches().empty());
+}
+
+// clicks are checked against a linear search through each group, topmost child first
+
+class ClickLeaf : public UIObject {
+ public:
+  ClickLeaf(bool consume, UIObject** clicked) : UIObject(nullptr), consume(consume), clicked(clicked) {}
+  void DrawUI(glm::vec2 min, glm::vec2 max, Canvas canvas) override {}
+  bool OnClick(const MouseEvent& e) override {
+    if (consume) {
+      *clicked = this;
+    }
+
+    return consume;
+  }
+
+  void OnMouseEnter(const MouseEvent& e) override {
+    enters++;
+    enter_pos = e.local_pos;
+  }
+
+  void OnMouseExit(const MouseEvent& e) override {
+    exits++;
+  }
+
+  bool consume;
+  UIObject** clicked;
+  int enters = 0;
+  int exits = 0;
+  glm::vec2 enter_pos;
+};
+
+/**
+ *  @returns whichever leaf should take a click at `point`, relative to `object`.
+ *  @param order - when each object was added to its group.
+ */
+static UIObject* FindClicked(UIObject* object, glm::vec2 point, std::unordered_map<UIObject*, uint64_t>& order) {
+  if (auto leaf = dynamic_cast<ClickLeaf*>(object)) {
+    if (leaf->consume) {
+      return leaf;
+    }
+  }
+
+  std::vector<UIObject*> under;
+  for (auto& child : object->GetChildren()) {
+    auto ui = static_cast<UIObject*>(child.get());
+    glm::vec2 local = point - ui->GetPosition();
+    glm::vec2 dims = ui->GetDimensions();
+    if (local.x >= 0 && local.y >= 0 && local.x < dims.x && local.y < dims.y) {
+      under.push_back(ui);
+    }
+  }
+
+  // lowest z-index is drawn last, then the latest added
+  std::sort(under.begin(), under.end(), [&](UIObject* a, UIObject* b) {
+    return (a->z_index != b->z_index ? a->z_index < b->z_index : order[a] > order[b]);
+  });
+
+  for (auto ui : under) {
+    if (UIObject* res = FindClicked(ui, point - ui->GetPosition(), order)) {
+      return res;
+    }
+  }
+
+  return nullptr;
+}
+
+TEST(UIGroupTests, ClickTopmostChild) {
+  std::mt19937 gen(5);
+  std::unordered_map<UIObject*, uint64_t> order;
+  uint64_t added = 0;
+  UIObject* clicked = nullptr;
+
+  auto root = std::make_shared<UIGroup>(nullptr);
+  root->SetDimensions(glm::vec2(200, 200));
+  std::vector<std::shared_ptr<UIGroup>> groups = { root };
+  for (int i = 0; i < 4; i++) {
+    auto group = std::make_shared<UIGroup>(nullptr);
+    group->SetPosition(glm::vec2(gen() % 100, gen() % 100));
+    group->SetDimensions(glm::vec2(50 + gen() % 100, 50 + gen() % 100));
+    group->z_index = gen() % 4;
+    groups[gen() % groups.size()]->AddChild(group);
+    order[group.get()] = added++;
+    groups.push_back(group);
+  }
+
+  std::vector<std::shared_ptr<ClickLeaf>> leaves;
+  for (int i = 0; i < 80; i++) {
+    auto leaf = std::make_shared<ClickLeaf>(gen() % 4 != 0, &clicked);
+    leaf->SetPosition(glm::vec2(gen() % 150, gen() % 150));
+    leaf->SetDimensions(glm::vec2(5 + gen() % 40, 5 + gen() % 40));
+    leaf->z_index = gen() % 4;
+    groups[gen() % groups.size()]->AddChild(leaf);
+    order[leaf.get()] = added++;
+    leaves.push_back(leaf);
+  }
+
+  for (int frame = 0; frame < 300; frame++) {
+    auto& leaf = leaves[gen() % leaves.size()];
+    switch (gen() % 5) {
+      case 0:
+        leaf->SetPosition(glm::vec2(gen() % 150, gen() % 150));
+        break;
+      case 1:
+        leaf->SetDimensions(glm::vec2(gen() % 40, gen() % 40));
+        break;
+      case 2:
+        leaf->z_index = gen() % 4;
+        break;
+      case 3:
+        groups[gen() % groups.size()]->AddChild(leaf);
+        order[leaf.get()] = added++;
+        break;
+      default:
+        break;
+    }
+
+    for (int i = 0; i < 20; i++) {
+      MouseEvent e = {};
+      e.local_pos = e.absolute_pos = glm::vec2(gen() % 2000, gen() % 2000) / 10.0f;
+      clicked = nullptr;
+      bool consumed = root->HandleClickEvent(e);
+      UIObject* expected = FindClicked(root.get(), e.local_pos, order);
+      ASSERT_EQ(expected, clicked) << "frame " << frame << ", click " << i;
+      ASSERT_EQ(expected != nullptr, consumed);
+    }
+  }
+}
+
+TEST(UIGroupTests, HoverEntersAndExits) {
+  UIObject* clicked = nullptr;
+  auto root = std::make_shared<UIGroup>(nullptr);
+  root->SetDimensions(glm::vec2(100, 100));
+  auto panel = std::make_shared<UIGroup>(nullptr);
+  panel->SetPosition(glm::vec2(10, 10));
+  panel->SetDimensions(glm::vec2(50, 50));
+  auto below = std::make_shared<ClickLeaf>(true, &clicked);
+  auto above = std::make_shared<ClickLeaf>(true, &clicked);
+  below->SetDimensions(glm::vec2(30, 30));
+  above->SetPosition(glm::vec2(20, 20));
+  above->SetDimensions(glm::vec2(30, 30));
+  root->AddChild(panel);
+  panel->AddChild(below);
+  panel->AddChild(above);
+
+  auto hover = [&](float x, float y) {
+    MouseEvent e = {};
+    e.local_pos = e.absolute_pos = glm::vec2(x, y);
+    root->HandleHoverEvent(e);
+  };
+
+  hover(15, 15);
+  ASSERT_EQ(1, below->enters);
+  ASSERT_EQ(glm::vec2(5, 5), below->enter_pos);
+
+  // moving within it changes nothing
+  hover(20, 20);
+  ASSERT_EQ(1, below->enters);
+  ASSERT_EQ(0, below->exits);
+
+  // onto the overlap -- the one added last is on top
+  hover(35, 35);
+  ASSERT_EQ(1, below->exits);
+  ASSERT_EQ(1, above->enters);
+  ASSERT_EQ(glm::vec2(5, 5), above->enter_pos);
+  ASSERT_EQ(above, root->GetObjectAt(glm::vec2(35, 35), nullptr));
+
+  // until the other is raised above it
+  below->z_index = -1;
+  hover(36, 36);
+  ASSERT_EQ(1, above->exits);
+  ASSERT_EQ(2, below->enters);
+
+  // children which move are found where they went
+  above->SetPosition(glm::vec2(0, 40));
+  ASSERT_EQ(above, root->GetObjectAt(glm::vec2(15, 55), nullptr));
+  ASSERT_EQ(panel, root->GetObjectAt(glm::vec2(55, 55), nullptr));
+
+  // off of everything
+  hover(150, 150);
+  ASSERT_EQ(2, below->exits);
+  ASSERT_EQ(nullptr, root->GetObjectAt(glm::vec2(150, 150), nullptr));
+}
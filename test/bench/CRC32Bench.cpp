@@ -0,0 +1,71 @@
+// measures CRC throughput for each kernel, against the original stream-based hash.
+// usage: crc-bench [size in MB]
+
+#include <utils/CRC32.hpp>
+#include <utils/FileUtils.hpp>
+
+#include "../LegacyCRC.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+
+using ::monkeysworld::utils::CRC32;
+using ::monkeysworld::utils::fileutils::CalculateCRCHash;
+
+static const int ITERATIONS = 5;
+
+/**
+ *  @returns best throughput for `func` over a few runs, in GB/s.
+ */
+static double BestGBps(size_t bytes, const std::function<uint32_t()>& func, uint32_t* hash) {
+  double best = 1e30;
+  for (int i = 0; i < ITERATIONS; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    *hash = func();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double>(end - start).count());
+  }
+
+  return (bytes / 1e9) / best;
+}
+
+int main(int argc, char** argv) {
+  size_t mb = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64);
+  size_t size = mb * 1024 * 1024;
+
+  // no 0xFF bytes, so that the stream hashes read everything
+  std::string data(size, '\0');
+  std::mt19937 rng(1);
+  for (auto& c : data) {
+    c = static_cast<char>(rng() % 255);
+  }
+
+  std::printf("%zu MB, best of %d\n", mb, ITERATIONS);
+  std::printf("%-28s %10s %12s\n", "kernel", "GB/s", "hash");
+
+  uint32_t hash;
+  std::istringstream stream(data);
+  double gbps = BestGBps(size, [&] { return legacycrc::CalculateCRCHash(stream, 0); }, &hash);
+  std::printf("%-28s %10.3f     %08x\n", "legacy stream", gbps, hash);
+
+  gbps = BestGBps(size, [&] { return CalculateCRCHash(stream, 0); }, &hash);
+  std::printf("%-28s %10.3f     %08x\n", "CalculateCRCHash (stream)", gbps, hash);
+
+  gbps = BestGBps(size, [&] { return ~CRC32::UpdateSliceBy8(0xFFFFFFFF, data.data(), size); }, &hash);
+  std::printf("%-28s %10.3f     %08x\n", "slice-by-8", gbps, hash);
+
+  if (CRC32::HasCLMUL()) {
+    gbps = BestGBps(size, [&] { return ~CRC32::UpdateCLMUL(0xFFFFFFFF, data.data(), size); }, &hash);
+    std::printf("%-28s %10.3f     %08x\n", "pclmulqdq", gbps, hash);
+  } else {
+    std::printf("%-28s %10s\n", "pclmulqdq", "n/a");
+  }
+
+  return 0;
+}
@@ -0,0 +1,134 @@
+// measures cache hit throughput with 1-16 threads hammering LoadFont/LoadModel on cached paths,
+// against the original mutex-guarded hit path.
+
+#include <file/CachedFileLoader.hpp>
+
+#include "LegacyLoaderCache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using ::monkeysworld::file::CachedFileLoader;
+
+static const int LOADS_PER_THREAD = 200000;
+static const int ITERATIONS = 3;
+
+static const char* MODEL_PATHS[] = {
+  "resources/test/CUBE.obj",
+  "resources/test/quadobj.obj",
+  "resources/test/untitled.obj",
+  "resources/test/untitled3.obj"
+};
+
+static const char* FONT_PATHS[] = {
+  "resources/Montserrat-Light.ttf",
+  "resources/8bitoperator_jve.ttf"
+};
+
+static std::atomic<uint64_t> sink;
+
+/**
+ *  Runs `load(i)` LOADS_PER_THREAD times on each of `threads` threads, all starting at once.
+ *  @returns millions of loads per second, best of ITERATIONS.
+ */
+template <typename Load>
+static double MeasureHits(int threads, Load load) {
+  double best = 0.0;
+  for (int iter = 0; iter < ITERATIONS; iter++) {
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+      workers.push_back(std::thread([&, t] {
+        ready.fetch_add(1);
+        while (!go.load()) {
+          std::this_thread::yield();
+        }
+
+        uint64_t found = 0;
+        for (int i = 0; i < LOADS_PER_THREAD; i++) {
+          found += load(i + t);
+        }
+
+        sink.fetch_add(found, std::memory_order_relaxed);
+      }));
+    }
+
+    while (ready.load() < threads) {
+      std::this_thread::yield();
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    go = true;
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    best = std::max(best, (static_cast<double>(threads) * LOADS_PER_THREAD) / seconds / 1e6);
+  }
+
+  return best;
+}
+
+int main(int argc, char** argv) {
+  CachedFileLoader loader("cache-hit-bench");
+  legacycache::LoaderCache<std::shared_ptr<const void>> legacy_models;
+  legacycache::LoaderCache<std::shared_ptr<const void>> legacy_fonts;
+
+  // warm both caches
+  for (auto path : MODEL_PATHS) {
+    auto model = loader.LoadModel(path);
+    if (model == nullptr) {
+      std::printf("could not load %s -- run from the build directory\n", path);
+      return 1;
+    }
+
+    legacy_models.Insert(path, model);
+  }
+
+  for (auto path : FONT_PATHS) {
+    auto font = loader.LoadFont(path);
+    legacy_fonts.Insert(path, font);
+  }
+
+  const int model_count = sizeof(MODEL_PATHS) / sizeof(MODEL_PATHS[0]);
+  const int font_count = sizeof(FONT_PATHS) / sizeof(FONT_PATHS[0]);
+  std::vector<std::string> model_paths(MODEL_PATHS, MODEL_PATHS + model_count);
+  std::vector<std::string> font_paths(FONT_PATHS, FONT_PATHS + font_count);
+
+  std::printf("%d loads per thread, best of %d, hardware threads: %u\n",
+              LOADS_PER_THREAD, ITERATIONS, std::thread::hardware_concurrency());
+  std::printf("%-10s %-8s %16s %16s\n", "asset", "threads", "legacy Mloads/s", "current Mloads/s");
+  for (int threads : { 1, 4, 16 }) {
+    double legacy = MeasureHits(threads, [&](int i) {
+      return (legacy_models.LoadFile(model_paths[i % model_count]) != nullptr);
+    });
+
+    double current = MeasureHits(threads, [&](int i) {
+      return (loader.LoadModel(model_paths[i % model_count]) != nullptr);
+    });
+
+    std::printf("%-10s %-8d %16.2f %16.2f\n", "model", threads, legacy, current);
+  }
+
+  for (int threads : { 1, 4, 16 }) {
+    double legacy = MeasureHits(threads, [&](int i) {
+      return (legacy_fonts.LoadFile(font_paths[i % font_count]) != nullptr);
+    });
+
+    double current = MeasureHits(threads, [&](int i) {
+      return (loader.LoadFont(font_paths[i % font_count]) != nullptr);
+    });
+
+    std::printf("%-10s %-8d %16.2f %16.2f\n", "font", threads, legacy, current);
+  }
+
+  return (sink.load() > 0 ? 0 : 1);
+}
@@ -0,0 +1,126 @@
+// measures frame times with and without pipelining, on a scene whose updates take a few
+// milliseconds of CPU, drawn by a headless backend which waits a fixed time to present
+// (standing in for GL submission and vsync). pipelined frames should approach the longer of
+// the two stages, rather than their sum.
+
+#include <engine/FramePipeline.hpp>
+#include <engine/RenderBackend.hpp>
+#include <critter/Empty.hpp>
+#include <critter/visitor/FrameVisitor.hpp>
+
+#include "../TestScene.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::visitor::FrameVisitor;
+using ::monkeysworld::engine::FramePipeline;
+using ::monkeysworld::engine::RenderBackend;
+using ::monkeysworld::engine::RenderContext;
+using ::monkeysworld::engine::frame_snapshot;
+using ::monkeysworld::engine::render_item;
+
+static const int OBJECT_COUNT = 10000;
+static const int STEPS_PER_UPDATE = 32;
+static const int PRESENT_MS = 8;
+static const int FRAMES = 60;
+
+static size_t sink;
+
+/**
+ *  An object which integrates a little orbit every frame.
+ */
+class Orbiter : public Empty {
+ public:
+  Orbiter(float seed) : Empty(nullptr), phase_(seed) {}
+
+  void Update() override {
+    glm::vec3 pos = GetPosition();
+    for (int i = 0; i < STEPS_PER_UPDATE; i++) {
+      phase_ += 0.001f;
+      pos.x += std::cos(phase_) * 0.01f;
+      pos.z += std::sin(phase_) * 0.01f;
+    }
+
+    SetPosition(pos);
+  }
+
+ private:
+  float phase_;
+};
+
+/**
+ *  Touches each item, then blocks as if waiting on the GPU.
+ */
+class SleepingBackend : public RenderBackend {
+ protected:
+  void BeginFrame(const frame_snapshot& frame) override {}
+
+  void DrawObject(const render_item& item, const RenderContext& rc) override {
+    sink += static_cast<size_t>(rc.GetModelMatrix()[3][0]);
+  }
+
+  void UpdateUI(const frame_snapshot& frame, const RenderContext& rc) override {}
+  void DrawUI(const frame_snapshot& frame, const RenderContext& rc) override {}
+
+  void EndFrame(const frame_snapshot& frame) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(PRESENT_MS));
+  }
+};
+
+/**
+ *  Runs FRAMES frames the way GameLoop does.
+ *  @param sim_ms - output param for the mean time spent simulating a frame.
+ *  @returns the mean frame time, in milliseconds.
+ */
+static double RunPipeline(std::shared_ptr<Empty> root, bool pipelined, double* sim_ms) {
+  FrameVisitor visitor;
+  SleepingBackend backend;
+  double sim_total = 0.0;
+  int sim_frames = 0;
+  FramePipeline pipeline([&](frame_snapshot& frame) {
+    auto start = std::chrono::high_resolution_clock::now();
+    visitor.UpdateAndGather(root.get());
+    root->GetTransformHierarchy()->Update();
+    FramePipeline::CaptureFrame(visitor, frame);
+    auto end = std::chrono::high_resolution_clock::now();
+    sim_total += std::chrono::duration<double, std::milli>(end - start).count();
+    sim_frames++;
+  }, pipelined);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < FRAMES; i++) {
+    const frame_snapshot& frame = pipeline.WaitForFrame();
+    backend.PrepareUI(frame);
+    pipeline.StartNextFrame();
+    backend.Render(frame);
+  }
+
+  auto end = std::chrono::high_resolution_clock::now();
+  pipeline.WaitForFrame();
+  *sim_ms = sim_total / sim_frames;
+  return std::chrono::duration<double, std::milli>(end - start).count() / FRAMES;
+}
+
+int main(int argc, char** argv) {
+  testscene::QuietLogs();
+
+  auto root = std::make_shared<Empty>(nullptr);
+  for (int i = 0; i < OBJECT_COUNT; i++) {
+    root->AddChild(std::make_shared<Orbiter>(static_cast<float>(i)));
+  }
+
+  std::printf("%d objects, %d ms to present\n", OBJECT_COUNT, PRESENT_MS);
+  std::printf("%-10s %10s %10s\n", "mode", "sim ms", "frame ms");
+  for (bool pipelined : { false, true }) {
+    double sim_ms;
+    double frame_ms = RunPipeline(root, pipelined, &sim_ms);
+    std::printf("%-10s %10.2f %10.2f\n", (pipelined ? "pipelined" : "serial"), sim_ms, frame_ms);
+  }
+
+  return (sink == 0xdeadbeef ? 1 : 0);
+}
@@ -0,0 +1,116 @@
+// measures the per-object part of a frame on a 50k object scene: updates, finding lights
+// and the active camera, and the render pass (with no-op materials, so only the walk is timed).
+// compares separate walks for each of those against FrameVisitor's single pass plus a render list.
+
+#include <critter/Empty.hpp>
+#include <critter/GameCamera.hpp>
+#include <critter/SceneWalker.hpp>
+#include <critter/visitor/ActiveCameraFindVisitor.hpp>
+#include <critter/visitor/FrameVisitor.hpp>
+#include <critter/visitor/LightVisitor.hpp>
+
+#include "../TestScene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::GameCamera;
+using ::monkeysworld::critter::GameObject;
+using ::monkeysworld::critter::Object;
+using ::monkeysworld::critter::SceneWalker;
+using ::monkeysworld::critter::visitor::ActiveCameraFindVisitor;
+using ::monkeysworld::critter::visitor::FrameVisitor;
+using ::monkeysworld::critter::visitor::LightVisitor;
+using ::monkeysworld::engine::RenderContext;
+
+static const int OBJECT_COUNT = 50000;
+static const int CAMERA_EVERY = 1000;
+static const int FRAMES = 50;
+
+static size_t sink;
+
+/**
+ *  @returns the best of FRAMES runs of `frame`, in milliseconds.
+ */
+template <typename Frame>
+static double MeasureFrames(Frame frame) {
+  double best = 1e30;
+  for (int i = 0; i < FRAMES; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    frame();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  return best;
+}
+
+int main(int argc, char** argv) {
+  testscene::QuietLogs();
+
+  // random parents, so that scene order and allocation order disagree, as they do after editing
+  std::mt19937 gen(1);
+  std::vector<std::shared_ptr<GameObject>> nodes;
+  nodes.reserve(OBJECT_COUNT);
+  nodes.push_back(std::make_shared<Empty>(nullptr));
+  for (int i = 1; i < OBJECT_COUNT; i++) {
+    std::shared_ptr<GameObject> node;
+    if (i % CAMERA_EVERY == 0) {
+      auto cam = std::make_shared<GameCamera>(nullptr);
+      // only the last camera is active, so the camera search can't stop early
+      cam->SetActive(i + CAMERA_EVERY >= OBJECT_COUNT);
+      node = cam;
+    } else {
+      node = std::make_shared<Empty>(nullptr);
+    }
+
+    std::uniform_int_distribution<int> parent(std::max(0, i - 2000), i - 1);
+    nodes[parent(gen)]->AddChild(node);
+    nodes.push_back(node);
+  }
+
+  auto root = nodes[0];
+  RenderContext rc;
+
+  LightVisitor lights;
+  ActiveCameraFindVisitor cameras;
+  SceneWalker walker;
+  double separate = MeasureFrames([&] {
+    lights.Clear();
+    cameras.Clear();
+    walker.Walk(root.get(), [](Object* o) {
+      o->Update();
+    });
+
+    root->Accept(lights);
+    root->Accept(cameras);
+    walker.Walk(root.get(), [&rc](Object* o) {
+      o->PrepareAttributes();
+      o->RenderMaterial(rc);
+    });
+
+    sink += lights.GetSpotLights().size() + (cameras.GetActiveCamera() ? 1 : 0);
+  });
+
+  FrameVisitor frame_visitor;
+  double fused = MeasureFrames([&] {
+    frame_visitor.UpdateAndGather(root.get());
+    for (Object* o : frame_visitor.GetRenderList()) {
+      o->PrepareAttributes();
+      o->RenderMaterial(rc);
+    }
+
+    sink += frame_visitor.GetSpotLights().size() + (frame_visitor.GetActiveCamera() ? 1 : 0);
+  });
+
+  std::printf("%d objects, best of %d frames\n", OBJECT_COUNT, FRAMES);
+  std::printf("%-10s %12s\n", "path", "ms/frame");
+  std::printf("%-10s %12.2f\n", "separate", separate);
+  std::printf("%-10s %12.2f\n", "fused", fused);
+  return (sink != 0 ? 0 : 1);
+}
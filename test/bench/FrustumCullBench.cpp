@@ -0,0 +1,157 @@
+// measures frustum culling on the CPU, with a million boxes scattered around a camera:
+// first the raw plane tests with each kernel, then culling a scene of a million objects, laid out
+// flat under the root, and in spatially grouped subtrees which can be skipped whole.
+
+#include <utils/Frustum.hpp>
+#include <critter/Empty.hpp>
+#include <critter/visitor/FrameVisitor.hpp>
+#include <engine/FramePipeline.hpp>
+
+#include "../TestScene.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::visitor::FrameVisitor;
+using ::monkeysworld::engine::FramePipeline;
+using ::monkeysworld::engine::frame_snapshot;
+using ::monkeysworld::utils::Frustum;
+using ::monkeysworld::utils::MatrixBatch;
+using ::monkeysworld::utils::aabb;
+
+static const size_t BOX_COUNT = 1000000;
+static const int GROUP_SIZE = 1000;
+static const float WORLD_SIZE = 400.0f;       // boxes sit in a cube this wide, centered on the camera
+static const int RUNS = 5;
+
+static size_t sink;
+
+/**
+ *  Empty which draws a box.
+ */
+class BoxEmpty : public Empty {
+ public:
+  BoxEmpty(const aabb& bounds) : Empty(nullptr) {
+    SetLocalBounds(bounds);
+  }
+};
+
+/**
+ *  @returns the best of RUNS runs of `func`, in milliseconds.
+ */
+template <typename Func>
+static double Measure(Func func) {
+  double best = 1e30;
+  for (int i = 0; i < RUNS; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  return best;
+}
+
+/**
+ *  Culls a scene, and prints how long it took along with its cull stats.
+ */
+static void CullScene(const char* name, std::shared_ptr<Empty> root, const Frustum& frustum) {
+  FrameVisitor visitor;
+  visitor.UpdateAndGather(root.get());
+  root->GetTransformHierarchy()->Update();
+  frame_snapshot frame;
+  double ms = Measure([&] {
+    frame.items.clear();
+    frame.culling = {};
+    FramePipeline::CaptureItems(visitor, &frustum, frame);
+  });
+
+  sink += frame.items.size();
+  std::printf("%-10s %10.2f %10u %10u %10u\n", name, ms,
+              frame.culling.tested, frame.culling.culled, frame.culling.drawn);
+}
+
+int main(int argc, char** argv) {
+  testscene::QuietLogs();
+
+  // a camera at the origin, looking down -z
+  Frustum frustum(glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f));
+
+  // groups are cells of a grid, with their boxes scattered inside
+  std::mt19937 gen(1);
+  int cells = 1;
+  while (cells * cells * cells < static_cast<int>(BOX_COUNT / GROUP_SIZE)) {
+    cells++;
+  }
+
+  float cell_size = WORLD_SIZE / cells;
+  std::uniform_real_distribution<float> offset(0.0f, cell_size);
+  std::uniform_real_distribution<float> size(0.1f, 1.0f);
+  std::vector<glm::vec3> group_pos(BOX_COUNT / GROUP_SIZE);
+  for (size_t g = 0; g < group_pos.size(); g++) {
+    int x = g % cells, y = (g / cells) % cells, z = static_cast<int>(g / (cells * cells));
+    group_pos[g] = glm::vec3(x, y, z) * cell_size - glm::vec3(WORLD_SIZE / 2);
+  }
+
+  std::vector<glm::vec3> box_pos(BOX_COUNT);
+  std::vector<aabb> local(BOX_COUNT), world(BOX_COUNT);
+  for (size_t i = 0; i < BOX_COUNT; i++) {
+    box_pos[i] = glm::vec3(offset(gen), offset(gen), offset(gen));
+    glm::vec3 half = glm::vec3(size(gen), size(gen), size(gen)) * 0.5f;
+    local[i] = { -half, half };
+    glm::vec3 center = group_pos[i / GROUP_SIZE] + box_pos[i];
+    world[i] = { center - half, center + half };
+  }
+
+  const char* names[] = { "scalar", "sse", "avx2" };
+  std::printf("%zu boxes, best kernel: %s, best of %d runs\n", BOX_COUNT, names[MatrixBatch::GetBestKernel()], RUNS);
+  std::printf("%-10s %10s %10s %10s\n", "kernel", "ms", "ns/box", "visible");
+  std::vector<uint8_t> visible(BOX_COUNT);
+  for (int k = MatrixBatch::KERNEL_SCALAR; k <= MatrixBatch::GetBestKernel(); k++) {
+    size_t count = 0;
+    double ms = Measure([&] {
+      count = frustum.TestBoxes(static_cast<MatrixBatch::Kernel>(k), world.data(), visible.data(), BOX_COUNT);
+    });
+
+    sink += count;
+    std::printf("%-10s %10.2f %10.2f %10zu\n", names[k], ms, ms * 1e6 / BOX_COUNT, count);
+  }
+
+  std::printf("\n%-10s %10s %10s %10s %10s\n", "scene", "cull ms", "tested", "culled", "drawn");
+  {
+    auto flat = std::make_shared<Empty>(nullptr);
+    for (size_t i = 0; i < BOX_COUNT; i++) {
+      auto box = std::make_shared<BoxEmpty>(local[i]);
+      box->SetPosition(group_pos[i / GROUP_SIZE] + box_pos[i]);
+      flat->AddChild(box);
+    }
+
+    CullScene("flat", flat, frustum);
+  }
+
+  {
+    auto grouped = std::make_shared<Empty>(nullptr);
+    for (size_t g = 0; g < group_pos.size(); g++) {
+      auto group = std::make_shared<Empty>(nullptr);
+      group->SetPosition(group_pos[g]);
+      for (size_t i = g * GROUP_SIZE; i < (g + 1) * GROUP_SIZE; i++) {
+        auto box = std::make_shared<BoxEmpty>(local[i]);
+        box->SetPosition(box_pos[i]);
+        group->AddChild(box);
+      }
+
+      grouped->AddChild(group);
+    }
+
+    CullScene("grouped", grouped, frustum);
+  }
+
+  return (sink == 0xdeadbeef ? 1 : 0);
+}
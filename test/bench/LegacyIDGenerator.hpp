@@ -0,0 +1,45 @@
+#ifndef LEGACY_ID_GENERATOR_H_
+#define LEGACY_ID_GENERATOR_H_
+
+// the original mutex-and-set ID generator, kept around as a baseline for benchmarks.
+
+#include <atomic>
+#include <cinttypes>
+#include <mutex>
+#include <set>
+
+namespace legacyid {
+
+class IDGenerator {
+ public:
+  IDGenerator() {
+    id_min_.store(1, std::memory_order_release);
+  }
+
+  uint64_t GetUniqueId() {
+    std::lock_guard<std::mutex> lock(id_generation_lock_);
+    while (used_ids_.find(++id_min_) != used_ids_.end());
+
+    auto itr = used_ids_.begin();
+    while (itr != used_ids_.end() && *itr < id_min_) {
+      itr++;
+    }
+    used_ids_.erase(used_ids_.begin(), itr);
+
+    return id_min_.load(std::memory_order_acquire);
+  }
+
+  void RegisterUniqueId(uint64_t new_id) {
+    std::lock_guard<std::mutex> lock(id_generation_lock_);
+    used_ids_.insert(new_id);
+  }
+
+ private:
+  std::mutex id_generation_lock_;
+  std::atomic<uint64_t> id_min_;
+  std::set<uint64_t> used_ids_;
+};
+
+}
+
+#endif  // LEGACY_ID_GENERATOR_H_
@@ -0,0 +1,67 @@
+#ifndef LEGACY_LOADER_CACHE_H_
+#define LEGACY_LOADER_CACHE_H_
+
+// the original cache hit path from CachedLoader, kept around as a baseline for benchmarks:
+// every load waits on the loader mutex, checks the in-flight load list,
+// then reads the cache behind a shared_timed_mutex.
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace legacycache {
+
+template <typename V>
+class LoaderCache {
+ public:
+  LoaderCache() : bytes_read_(0), bytes_sum_(0) {}
+
+  void Insert(const std::string& path, V value) {
+    std::unique_lock<std::shared_timed_mutex> lock(cache_mutex_);
+    cache_.insert(std::make_pair(path, value));
+  }
+
+  V LoadFile(const std::string& path) {
+    WaitUntilLoaded();
+    {
+      std::unique_lock<std::mutex> lock(loads_lock_);
+      auto rec = loads_.find(path);
+      if (rec != loads_.end()) {
+        auto cond_var = rec->second;
+        cond_var->wait(lock, [&] { return IsCached(path); });
+      }
+    }
+
+    std::shared_lock<std::shared_timed_mutex> lock(cache_mutex_);
+    auto i = cache_.find(path);
+    return (i != cache_.end() ? i->second : V());
+  }
+
+ private:
+  void WaitUntilLoaded() {
+    std::unique_lock<std::mutex> lock(loader_mutex_);
+    load_cond_var_.wait(lock, [&] { return bytes_read_ == bytes_sum_; });
+  }
+
+  bool IsCached(const std::string& path) {
+    return (cache_.find(path) != cache_.end());
+  }
+
+  size_t bytes_read_;
+  size_t bytes_sum_;
+  std::mutex loader_mutex_;
+  std::condition_variable load_cond_var_;
+
+  std::unordered_map<std::string, std::shared_ptr<std::condition_variable>> loads_;
+  std::mutex loads_lock_;
+
+  std::shared_timed_mutex cache_mutex_;
+  std::unordered_map<std::string, V> cache_;
+};
+
+}
+
+#endif  // LEGACY_LOADER_CACHE_H_
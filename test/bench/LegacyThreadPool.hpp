@@ -0,0 +1,79 @@
+#ifndef LEGACY_THREAD_POOL_H_
+#define LEGACY_THREAD_POOL_H_
+
+// the original single-queue loader pool, kept around as a baseline for benchmarks.
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace legacypool {
+
+class LoaderThreadPool {
+ public:
+  LoaderThreadPool(int num_threads) : flags_(num_threads) {
+    for (int i = 0; i < num_threads; i++) {
+      flags_[i].test_and_set();
+    }
+
+    for (int i = 0; i < num_threads; i++) {
+      threads_.push_back(std::thread(&LoaderThreadPool::threadfunc_, this, &flags_[i]));
+    }
+  }
+
+  void AddTaskToQueue(std::function<void()> func) {
+    {
+      std::lock_guard<std::mutex> lock(queue_lock_);
+      task_queue_.push(func);
+    }
+
+    task_condvar_.notify_all();
+  }
+
+  ~LoaderThreadPool() {
+    for (auto& flag : flags_) {
+      flag.clear();
+    }
+
+    task_condvar_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+ private:
+  void threadfunc_(std::atomic_flag* flag) {
+    std::function<void()> task;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(queue_lock_);
+        while (task_queue_.empty()) {
+          if (!flag->test_and_set()) {
+            return;
+          }
+
+          task_condvar_.wait(lock);
+        }
+
+        task = std::move(task_queue_.front());
+        task_queue_.pop();
+      }
+
+      task();
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::vector<std::atomic_flag> flags_;
+  std::queue<std::function<void()>> task_queue_;
+  std::mutex queue_lock_;
+  std::condition_variable task_condvar_;
+};
+
+}
+
+#endif  // LEGACY_THREAD_POOL_H_
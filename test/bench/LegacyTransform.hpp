@@ -0,0 +1,61 @@
+#ifndef LEGACY_TRANSFORM_H_
+#define LEGACY_TRANSFORM_H_
+
+// the original GameObject transform path, kept around as a baseline for benchmarks:
+// each node holds its own TRS and a weak_ptr to its parent, and GetTransformationMatrix
+// recurses to the root, locking every parent along the way.
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/euler_angles.hpp>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace legacytransform {
+
+class Node : public std::enable_shared_from_this<Node> {
+ public:
+  Node() : position(0), rotation(0), scale(1), dirty_(true) {}
+
+  void AddChild(std::shared_ptr<Node> child) {
+    child->parent_ = shared_from_this();
+    children_.push_back(child);
+  }
+
+  void SetPosition(const glm::vec3& new_pos) {
+    dirty_.store(true, std::memory_order_release);
+    position = new_pos;
+  }
+
+  // as before: the dirty flag is never cleared, so the local matrix is rebuilt on every call
+  glm::mat4 GetTransformationMatrix() const {
+    if (dirty_) {
+      glm::mat4& matrix_cache = const_cast<glm::mat4&>(tf_matrix_cache_);
+      matrix_cache = glm::mat4(1.0);
+      matrix_cache = glm::translate(tf_matrix_cache_, position);
+      matrix_cache *= glm::eulerAngleYXZ(rotation.y, rotation.x, rotation.z);
+      matrix_cache = glm::scale(tf_matrix_cache_, scale);
+    }
+
+    if (auto parent = parent_.lock()) {
+      return parent->GetTransformationMatrix() * tf_matrix_cache_;
+    }
+
+    return tf_matrix_cache_;
+  }
+
+ private:
+  glm::vec3 position;
+  glm::vec3 rotation;
+  glm::vec3 scale;
+  std::weak_ptr<Node> parent_;
+  std::vector<std::shared_ptr<Node>> children_;
+  glm::mat4 tf_matrix_cache_;
+  std::atomic_bool dirty_;
+};
+
+}
+
+#endif  // LEGACY_TRANSFORM_H_
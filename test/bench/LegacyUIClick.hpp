@@ -0,0 +1,44 @@
+#ifndef LEGACY_UI_CLICK_H_
+#define LEGACY_UI_CLICK_H_
+
+// the original UIObject::HandleClickEvent, which checked every child of every group in
+// insertion order. kept around as a baseline for benchmarks.
+
+#include <critter/ui/UIObject.hpp>
+#include <input/MouseEvent.hpp>
+
+#include <memory>
+
+namespace legacyui {
+
+inline bool HandleClickEvent(::monkeysworld::critter::ui::UIObject* object,
+                             const ::monkeysworld::input::MouseEvent& e) {
+  using ::monkeysworld::critter::ui::UIObject;
+  bool event = object->OnClick(e);
+  if (event) {
+    return true;
+  }
+
+  std::shared_ptr<UIObject> ui_child;
+  glm::vec2 child_pos;
+  glm::vec2 child_dims;
+  for (auto child : object->GetChildren()) {
+    ::monkeysworld::input::MouseEvent e_child = e;
+    ui_child = std::static_pointer_cast<UIObject>(child);
+    child_pos = ui_child->GetPosition();
+    child_dims = ui_child->GetDimensions();
+    e_child.local_pos -= child_pos;
+    if (   e_child.local_pos.x >= 0 && e_child.local_pos.x < child_dims.x
+        && e_child.local_pos.y >= 0 && e_child.local_pos.y < child_dims.y) {
+      if (HandleClickEvent(ui_child.get(), e_child)) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+}
+
+#endif  // LEGACY_UI_CLICK_H_
@@ -0,0 +1,89 @@
+// measures model and normal matrix throughput for scenes of 1k to 1M objects:
+// per-object glm math (what the engine did before batching) against each MatrixBatch kernel.
+
+#include <utils/MatrixBatch.hpp>
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/euler_angles.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using ::monkeysworld::utils::MatrixBatch;
+
+static const size_t COUNTS[] = { 1000, 10000, 100000, 1000000 };
+static const int RUNS = 5;
+
+static float sink;
+
+/**
+ *  @returns the best of RUNS runs of `func`, in ns per object.
+ */
+template <typename Func>
+static double Measure(size_t count, Func func) {
+  double best = 1e30;
+  for (int i = 0; i < RUNS; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+  }
+
+  return best / count;
+}
+
+int main(int argc, char** argv) {
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<float> dist(-3.0f, 3.0f);
+  const char* names[] = { "scalar", "sse", "avx2" };
+  std::printf("best kernel: %s, best of %d runs\n", names[MatrixBatch::GetBestKernel()], RUNS);
+  std::printf("%-10s %-8s %14s %14s\n", "objects", "path", "model ns/obj", "normal ns/obj");
+  for (auto count : COUNTS) {
+    std::vector<glm::vec3> pos(count), rot(count), scale(count);
+    for (size_t i = 0; i < count; i++) {
+      pos[i] = glm::vec3(dist(gen), dist(gen), dist(gen));
+      rot[i] = glm::vec3(dist(gen), dist(gen), dist(gen));
+      scale[i] = glm::vec3(1.0f) + glm::abs(glm::vec3(dist(gen), dist(gen), dist(gen)));
+    }
+
+    std::vector<glm::mat4> model(count);
+    std::vector<glm::mat3> normal(count);
+
+    double glm_model = Measure(count, [&] {
+      for (size_t i = 0; i < count; i++) {
+        glm::mat4 res = glm::translate(glm::mat4(1.0), pos[i]);
+        res *= glm::eulerAngleYXZ(rot[i].y, rot[i].x, rot[i].z);
+        model[i] = glm::scale(res, scale[i]);
+      }
+    });
+
+    double glm_normal = Measure(count, [&] {
+      for (size_t i = 0; i < count; i++) {
+        normal[i] = glm::inverseTranspose(glm::mat3(model[i]));
+      }
+    });
+
+    sink += model[count / 2][3][0] + normal[count / 2][1][1];
+    std::printf("%-10zu %-8s %14.2f %14.2f\n", count, "glm", glm_model, glm_normal);
+
+    for (int k = MatrixBatch::KERNEL_SCALAR; k <= MatrixBatch::GetBestKernel(); k++) {
+      auto kernel = static_cast<MatrixBatch::Kernel>(k);
+      double model_ns = Measure(count, [&] {
+        MatrixBatch::ComposeTransforms(kernel, pos.data(), rot.data(), scale.data(), model.data(), count);
+      });
+
+      double normal_ns = Measure(count, [&] {
+        MatrixBatch::ComputeNormalMatrices(kernel, model.data(), normal.data(), count);
+      });
+
+      sink += model[count / 2][3][0] + normal[count / 2][1][1];
+      std::printf("%-10zu %-8s %14.2f %14.2f\n", count, names[k], model_ns, normal_ns);
+    }
+  }
+
+  return (sink != 0.0f ? 0 : 1);
+}
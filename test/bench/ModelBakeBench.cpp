@@ -0,0 +1,102 @@
+// compares OBJ parse time against baked mesh load time.
+// run from the build directory, so that resources/ is reachable.
+
+#include <file/BakedMesh.hpp>
+#include <file/ModelLoader.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using ::monkeysworld::file::GetSourceStamp;
+using ::monkeysworld::file::ModelLoader;
+using ::monkeysworld::file::ReadBakedMesh;
+using ::monkeysworld::file::WriteBakedMesh;
+
+static const int ITERATIONS = 5;
+
+/**
+ *  Writes a flat grid of `quads_per_side`^2 quads to an OBJ, split into triangles.
+ */
+static void WriteGridObj(const std::string& path, int quads_per_side) {
+  std::ofstream out(path);
+  int verts_per_side = quads_per_side + 1;
+  for (int y = 0; y < verts_per_side; y++) {
+    for (int x = 0; x < verts_per_side; x++) {
+      out << "v " << x * 0.01f << " " << y * 0.01f << " " << ((x ^ y) & 7) * 0.001f << "\n";
+      out << "vt " << static_cast<float>(x) / quads_per_side << " " << static_cast<float>(y) / quads_per_side << "\n";
+    }
+  }
+
+  out << "vn 0.0 0.0 1.0\n";
+  for (int y = 0; y < quads_per_side; y++) {
+    for (int x = 0; x < quads_per_side; x++) {
+      int a = y * verts_per_side + x + 1;
+      int b = a + 1;
+      int c = a + verts_per_side;
+      int d = c + 1;
+      out << "f " << a << "/" << a << "/1 " << b << "/" << b << "/1 " << d << "/" << d << "/1\n";
+      out << "f " << a << "/" << a << "/1 " << d << "/" << d << "/1 " << c << "/" << c << "/1\n";
+    }
+  }
+}
+
+template <typename F>
+static double BestOf(F func) {
+  double best = 1e30;
+  for (int i = 0; i < ITERATIONS; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  return best;
+}
+
+static void RunBench(const std::string& obj_path) {
+  uint64_t size;
+  int64_t mtime;
+  GetSourceStamp(obj_path, &size, &mtime);
+  std::string bake_path = obj_path + ".bench.mwmesh";
+
+  std::shared_ptr<::monkeysworld::model::Mesh<>> mesh;
+  double obj_ms = BestOf([&] {
+    uint64_t file_size;
+    mesh = ModelLoader::FromObjFile(obj_path, &file_size);
+  });
+
+  double write_ms = BestOf([&] {
+    WriteBakedMesh(bake_path, *mesh, size, mtime);
+  });
+
+  size_t verts = 0;
+  double bake_ms = BestOf([&] {
+    auto baked = ReadBakedMesh(bake_path, size, mtime);
+    verts = baked->GetVertexCount();
+  });
+
+  std::printf("%s\n", obj_path.c_str());
+  std::printf("  %zu verts, %zu tris, %.2f MB OBJ\n",
+              mesh->GetVertexCount(), mesh->GetIndexCount() / 3, size / (1024.0 * 1024.0));
+  std::printf("  obj parse:  %10.3f ms\n", obj_ms);
+  std::printf("  bake write: %10.3f ms\n", write_ms);
+  std::printf("  bake load:  %10.3f ms (%zu verts)\n", bake_ms, verts);
+  std::printf("  speedup:    %10.1fx\n", obj_ms / bake_ms);
+  std::remove(bake_path.c_str());
+}
+
+int main(int argc, char** argv) {
+  RunBench("resources/test/monkeyquads.obj");
+
+  // 708^2 quads * 2 = ~1M triangles
+  const std::string synthetic_path = "resources/test/synthetic-1m.obj";
+  WriteGridObj(synthetic_path, 708);
+  RunBench(synthetic_path);
+  std::remove(synthetic_path.c_str());
+  return 0;
+}
@@ -0,0 +1,90 @@
+// sweeps OBJ parsing across 1-N threads.
+// usage: obj-parallel-bench [path to obj]
+// if no path is provided, a large synthetic grid is generated in resources/test.
+
+#include <file/LoaderThreadPool.hpp>
+#include <file/ModelLoader.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+using ::monkeysworld::file::LoaderThreadPool;
+using ::monkeysworld::file::ModelLoader;
+
+static const int ITERATIONS = 3;
+
+static void WriteGridObj(const std::string& path, int quads_per_side) {
+  std::ofstream out(path);
+  int verts_per_side = quads_per_side + 1;
+  for (int y = 0; y < verts_per_side; y++) {
+    for (int x = 0; x < verts_per_side; x++) {
+      out << "v " << x * 0.01f << " " << y * 0.01f << " " << ((x ^ y) & 7) * 0.001f << "\n";
+      out << "vt " << static_cast<float>(x) / quads_per_side << " " << static_cast<float>(y) / quads_per_side << "\n";
+      out << "vn 0.0 " << ((x & 3) * 0.1f) << " 1.0\n";
+    }
+  }
+
+  for (int y = 0; y < quads_per_side; y++) {
+    for (int x = 0; x < quads_per_side; x++) {
+      int a = y * verts_per_side + x + 1;
+      int b = a + 1;
+      int c = a + verts_per_side;
+      int d = c + 1;
+      out << "f " << a << "/" << a << "/" << a << " " << b << "/" << b << "/" << b << " "
+          << d << "/" << d << "/" << d << " " << c << "/" << c << "/" << c << "\n";
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  std::string path;
+  bool generated = false;
+  if (argc > 1) {
+    path = argv[1];
+  } else {
+    path = "resources/test/synthetic-parallel.obj";
+    WriteGridObj(path, 1200);
+    generated = true;
+  }
+
+  double mb = std::filesystem::file_size(path) / (1024.0 * 1024.0);
+  int max_threads = std::max(2u, std::thread::hardware_concurrency());
+  std::printf("%s: %.1f MB\n", path.c_str(), mb);
+  std::printf("%8s %12s %10s %10s\n", "threads", "ms", "MB/s", "speedup");
+
+  double serial_ms = 0.0;
+  for (int threads = 1; threads <= max_threads; threads++) {
+    // the calling thread parses too, so the pool gets one less worker
+    std::unique_ptr<LoaderThreadPool> pool;
+    if (threads > 1) {
+      pool = std::make_unique<LoaderThreadPool>(threads - 1);
+    }
+
+    double best = 1e30;
+    for (int i = 0; i < ITERATIONS; i++) {
+      uint64_t size;
+      auto start = std::chrono::high_resolution_clock::now();
+      auto mesh = ModelLoader::FromObjFile(path, &size, pool.get());
+      auto end = std::chrono::high_resolution_clock::now();
+      best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    if (threads == 1) {
+      serial_ms = best;
+    }
+
+    std::printf("%8d %12.2f %10.1f %9.2fx\n", threads, best, mb / (best / 1000.0), serial_ms / best);
+  }
+
+  if (generated) {
+    std::remove(path.c_str());
+  }
+
+  return 0;
+}
@@ -0,0 +1,60 @@
+// reports OBJ parsing throughput, for the current parser and the old boost::split parser.
+// run from the build directory, so that resources/ is reachable.
+
+#include <file/ModelLoader.hpp>
+
+#include "../LegacyObjParser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+using ::monkeysworld::file::ModelLoader;
+
+static const int ITERATIONS = 5;
+
+template <typename F>
+static double BestOf(F func) {
+  double best = 1e30;
+  for (int i = 0; i < ITERATIONS; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double>(end - start).count());
+  }
+
+  return best;
+}
+
+int main(int argc, char** argv) {
+  std::printf("%-36s %10s %12s %12s\n", "file", "MB", "legacy MB/s", "MB/s");
+  double total_mb = 0.0;
+  double total_legacy = 0.0;
+  double total_current = 0.0;
+  for (auto& entry : std::filesystem::directory_iterator("resources/test")) {
+    if (entry.path().extension() != ".obj") {
+      continue;
+    }
+
+    std::string path = entry.path().string();
+    double mb = std::filesystem::file_size(path) / (1024.0 * 1024.0);
+    double legacy = BestOf([&] {
+      legacyobj::FromObjFile(path);
+    });
+
+    double current = BestOf([&] {
+      uint64_t size;
+      ModelLoader::FromObjFile(path, &size);
+    });
+
+    std::printf("%-36s %10.2f %12.1f %12.1f\n", path.c_str(), mb, mb / legacy, mb / current);
+    total_mb += mb;
+    total_legacy += legacy;
+    total_current += current;
+  }
+
+  std::printf("%-36s %10.2f %12.1f %12.1f\n", "total", total_mb, total_mb / total_legacy, total_mb / total_current);
+  return 0;
+}
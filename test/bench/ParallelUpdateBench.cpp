@@ -0,0 +1,123 @@
+// measures the update phase of a frame on a 100k object scene, where every object does a
+// few microseconds of math and moves itself. compares FrameVisitor's serial walk against
+// parallel updates, across a range of worker counts.
+// scenes: "flat" puts every object directly beneath the root, "grouped" nests them in
+// groups of 100 beneath an unsafe root, and "mixed" opts out every tenth group.
+
+#include <critter/Empty.hpp>
+#include <critter/visitor/FrameVisitor.hpp>
+#include <file/LoaderThreadPool.hpp>
+
+#include "../TestScene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::GameObject;
+using ::monkeysworld::critter::visitor::FrameVisitor;
+using ::monkeysworld::file::LoaderThreadPool;
+
+static const int OBJECT_COUNT = 100000;
+static const int GROUP_SIZE = 100;
+static const int UNSAFE_GROUP_EVERY = 10;
+static const int STEPS_PER_UPDATE = 64;
+static const int FRAMES = 10;
+
+/**
+ *  An object which integrates a little orbit every frame.
+ */
+class Orbiter : public Empty {
+ public:
+  Orbiter(float seed, bool thread_safe) : Empty(nullptr), phase_(seed), thread_safe_(thread_safe) {}
+
+  bool IsUpdateThreadSafe() override {
+    return thread_safe_;
+  }
+
+  void Update() override {
+    glm::vec3 pos = GetPosition();
+    for (int i = 0; i < STEPS_PER_UPDATE; i++) {
+      phase_ += 0.001f;
+      pos.x += std::cos(phase_) * 0.01f;
+      pos.z += std::sin(phase_) * 0.01f;
+    }
+
+    SetPosition(pos);
+  }
+
+ private:
+  float phase_;
+  bool thread_safe_;
+};
+
+/**
+ *  @returns the best of FRAMES runs of `frame`, in milliseconds.
+ */
+template <typename Frame>
+static double MeasureFrames(Frame frame) {
+  double best = 1e30;
+  for (int i = 0; i < FRAMES; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    frame();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  return best;
+}
+
+static std::shared_ptr<GameObject> BuildScene(bool grouped, bool mixed) {
+  // the root never opts in, like most scene roots
+  auto root = std::make_shared<Orbiter>(0.0f, false);
+  std::shared_ptr<GameObject> group = root;
+  for (int i = 0; i < OBJECT_COUNT; i++) {
+    bool safe = !(mixed && (i / GROUP_SIZE) % UNSAFE_GROUP_EVERY == 0);
+    if (grouped && i % GROUP_SIZE == 0) {
+      group = std::make_shared<Orbiter>(static_cast<float>(i), safe);
+      root->AddChild(group);
+    }
+
+    group->AddChild(std::make_shared<Orbiter>(static_cast<float>(i), safe));
+  }
+
+  return root;
+}
+
+static void RunScene(const char* name, std::shared_ptr<GameObject> root) {
+  FrameVisitor serial;
+  double serial_ms = MeasureFrames([&] {
+    serial.UpdateAndGather(root.get());
+  });
+
+  std::printf("%-8s %8s %10.2f %8.2fx\n", name, "serial", serial_ms, 1.0);
+
+  int max_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 1);
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    FrameVisitor parallel(std::make_shared<LoaderThreadPool>(threads));
+    double parallel_ms = MeasureFrames([&] {
+      parallel.UpdateAndGather(root.get());
+    });
+
+    // workers plus the main thread
+    char label[16];
+    std::snprintf(label, sizeof(label), "%d+1", threads);
+    std::printf("%-8s %8s %10.2f %8.2fx\n", name, label, parallel_ms, serial_ms / parallel_ms);
+  }
+}
+
+int main(int argc, char** argv) {
+  testscene::QuietLogs();
+  std::printf("%d objects, %u hardware threads\n", OBJECT_COUNT, std::thread::hardware_concurrency());
+  std::printf("%-8s %8s %10s %9s\n", "scene", "threads", "ms/frame", "speedup");
+
+  RunScene("flat", BuildScene(false, false));
+  RunScene("grouped", BuildScene(true, false));
+  RunScene("mixed", BuildScene(true, true));
+  return 0;
+}
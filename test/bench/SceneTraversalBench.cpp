@@ -0,0 +1,152 @@
+// measures one frame's worth of scene traversal -- an update walk, then the light and camera
+// visitors -- over a deep tree (one long chain) and a wide one (a root with many small subtrees).
+// compares the original recursive walk, which copies every child list, against SceneWalker.
+
+#include <critter/Empty.hpp>
+#include <critter/SceneWalker.hpp>
+#include <critter/visitor/ActiveCameraFindVisitor.hpp>
+#include <critter/visitor/LightVisitor.hpp>
+
+#include "../AllocationCounter.hpp"
+#include "../TestScene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::GameObject;
+using ::monkeysworld::critter::Object;
+using ::monkeysworld::critter::SceneWalker;
+using ::monkeysworld::critter::visitor::ActiveCameraFindVisitor;
+using ::monkeysworld::critter::visitor::LightVisitor;
+
+static const int DEEP_DEPTH = 10000;
+static const int WIDE_CHILDREN = 20000;
+static const int WIDE_GRANDCHILDREN = 4;
+static const int FRAMES = 50;
+
+// RemoveChild is normally only for subclasses
+class DetachableEmpty : public Empty {
+ public:
+  DetachableEmpty() : Empty(nullptr) {}
+  using GameObject::RemoveChild;
+};
+
+/**
+ *  The update walk as BaseEngine used to do it.
+ */
+static void LegacyUpdateObjects(std::shared_ptr<Object> obj) {
+  obj->Update();
+  for (auto child : obj->GetChildren()) {
+    LegacyUpdateObjects(child);
+  }
+}
+
+/**
+ *  Stands in for the old visitors: every Visit recursed through GetChildren.
+ */
+class LegacyVisitor : public ::monkeysworld::critter::Visitor {
+ public:
+  void Visit(std::shared_ptr<Object> o) override { VisitLegacy(o); }
+  void Visit(std::shared_ptr<GameObject> o) override { VisitLegacy(o); }
+  void Visit(std::shared_ptr<::monkeysworld::critter::GameCamera> o) override { VisitLegacy(o); }
+  void Visit(std::shared_ptr<::monkeysworld::shader::light::SpotLight> o) override { VisitLegacy(o); }
+  void Visit(std::shared_ptr<::monkeysworld::font::TextObject> o) override { VisitLegacy(o); }
+ private:
+  void VisitLegacy(std::shared_ptr<Object> o) {
+    for (auto child : o->GetChildren()) {
+      child->Accept(*this);
+    }
+  }
+};
+
+struct FrameResult {
+  double ms;                  // best frame time
+  size_t allocs;              // allocations in the last frame
+};
+
+/**
+ *  Runs FRAMES frames of `frame`.
+ */
+template <typename Frame>
+static FrameResult MeasureFrames(Frame frame) {
+  FrameResult res = { 1e30, 0 };
+  for (int i = 0; i < FRAMES; i++) {
+    size_t allocs = allocations.load();
+    auto start = std::chrono::high_resolution_clock::now();
+    frame();
+    auto end = std::chrono::high_resolution_clock::now();
+    res.allocs = allocations.load() - allocs;
+    res.ms = std::min(res.ms, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  return res;
+}
+
+static void RunScene(const char* name, std::shared_ptr<GameObject> root, size_t count) {
+  LightVisitor lights;
+  ActiveCameraFindVisitor cameras;
+  SceneWalker walker;
+
+  LegacyVisitor legacy_lights;
+  LegacyVisitor legacy_cameras;
+
+  FrameResult legacy = MeasureFrames([&] {
+    LegacyUpdateObjects(root);
+    root->Accept(legacy_lights);
+    root->Accept(legacy_cameras);
+  });
+
+  FrameResult current = MeasureFrames([&] {
+    lights.Clear();
+    cameras.Clear();
+    walker.Walk(root.get(), [](Object* o) {
+      o->Update();
+    });
+
+    root->Accept(lights);
+    root->Accept(cameras);
+  });
+
+  std::printf("%-6s %8zu %-8s %10.2f %12zu\n", name, count, "legacy", legacy.ms, legacy.allocs);
+  std::printf("%-6s %8zu %-8s %10.2f %12zu\n", name, count, "walker", current.ms, current.allocs);
+}
+
+int main(int argc, char** argv) {
+  testscene::QuietLogs();
+  std::printf("%-6s %8s %-8s %10s %12s\n", "tree", "objects", "path", "ms/frame", "allocs/frame");
+
+  {
+    std::vector<std::shared_ptr<DetachableEmpty>> chain;
+    chain.push_back(std::make_shared<DetachableEmpty>());
+    for (int i = 1; i < DEEP_DEPTH; i++) {
+      chain.push_back(std::make_shared<DetachableEmpty>());
+      chain[i - 1]->AddChild(chain[i]);
+    }
+
+    RunScene("deep", chain[0], chain.size());
+
+    // unlink from the bottom, so that teardown doesn't recurse through the whole chain
+    for (size_t i = chain.size() - 1; i > 0; i--) {
+      chain[i - 1]->RemoveChild(chain[i]->GetId());
+    }
+  }
+
+  {
+    auto root = std::make_shared<Empty>(nullptr);
+    for (int i = 0; i < WIDE_CHILDREN; i++) {
+      auto child = std::make_shared<Empty>(nullptr);
+      root->AddChild(child);
+      for (int j = 0; j < WIDE_GRANDCHILDREN; j++) {
+        child->AddChild(std::make_shared<Empty>(nullptr));
+      }
+    }
+
+    RunScene("wide", root, 1 + WIDE_CHILDREN * (1 + WIDE_GRANDCHILDREN));
+  }
+
+  return 0;
+}
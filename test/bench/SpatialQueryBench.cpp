@@ -0,0 +1,232 @@
+// measures spatial query throughput over a few hundred thousand boxes scattered around a camera:
+// frustum, box, sphere and ray queries against the bounding volume tree, next to testing every box,
+// then the cost of keeping a scene's index up to date as some of its objects move each frame.
+
+#include <utils/BoundingVolumeTree.hpp>
+#include <critter/Empty.hpp>
+#include <critter/TransformHierarchy.hpp>
+
+#include "../TestScene.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::TransformHierarchy;
+using ::monkeysworld::utils::BoundingVolumeTree;
+using ::monkeysworld::utils::Frustum;
+using ::monkeysworld::utils::aabb;
+using ::monkeysworld::utils::bounding_sphere;
+using ::monkeysworld::utils::ray;
+using ::testscene::BoxEmpty;
+
+static const size_t BOX_COUNT = 200000;
+static const float WORLD_SIZE = 400.0f;       // boxes sit in a cube this wide, centered on the origin
+static const int QUERY_COUNT = 1000;
+static const size_t SCENE_COUNT = 100000;
+static const size_t MOVERS = SCENE_COUNT / 100;
+static const int RUNS = 5;
+
+static size_t sink;
+
+/**
+ *  @returns the best of RUNS runs of `func`, in milliseconds.
+ */
+template <typename Func>
+static double Measure(Func func) {
+  double best = 1e30;
+  for (int i = 0; i < RUNS; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  return best;
+}
+
+static void PrintRow(const char* name, double tree_ms, double brute_ms, int queries, size_t hits) {
+  std::printf("%-10s %12.2f %12.2f %10.1fx %12.2f\n", name, tree_ms * 1e3 / queries, brute_ms * 1e3 / queries,
+              brute_ms / tree_ms, static_cast<double>(hits) / queries);
+}
+
+int main(int argc, char** argv) {
+  testscene::QuietLogs();
+
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<float> pos(-WORLD_SIZE / 2, WORLD_SIZE / 2);
+  std::uniform_real_distribution<float> size(0.1f, 2.0f);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  std::vector<aabb> boxes(BOX_COUNT);
+  std::vector<uint32_t> data(BOX_COUNT);
+  for (size_t i = 0; i < BOX_COUNT; i++) {
+    glm::vec3 corner(pos(gen), pos(gen), pos(gen));
+    boxes[i] = { corner, corner + glm::vec3(size(gen), size(gen), size(gen)) };
+    data[i] = static_cast<uint32_t>(i);
+  }
+
+  BoundingVolumeTree tree;
+  std::vector<int> proxies(BOX_COUNT);
+  auto start = std::chrono::high_resolution_clock::now();
+  tree.CreateProxies(boxes.data(), data.data(), BOX_COUNT, proxies.data());
+  double build_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  std::printf("%zu boxes, built in %.2f ms, height %d, cost %.1f\n", BOX_COUNT, build_ms, tree.GetHeight(), tree.GetCost());
+
+  // the same queries for the tree and for brute force
+  std::vector<Frustum> frustums;
+  std::vector<aabb> regions;
+  std::vector<bounding_sphere> spheres;
+  std::vector<ray> rays;
+  for (int q = 0; q < QUERY_COUNT; q++) {
+    glm::vec3 eye(pos(gen), pos(gen), pos(gen));
+    glm::vec3 dir = glm::normalize(glm::vec3(unit(gen), unit(gen), unit(gen)));
+    glm::mat4 view = glm::rotate(glm::mat4(1.0), unit(gen) * 3.14f, dir);
+    view = glm::inverse(glm::translate(glm::mat4(1.0), eye) * view);
+    frustums.push_back(Frustum(glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f) * view));
+    regions.push_back({ eye, eye + glm::vec3(10.0f) });
+    spheres.push_back({ eye, 10.0f });
+    rays.push_back({ eye, dir });
+  }
+
+  std::printf("\n%-10s %12s %12s %11s %12s\n", "query", "tree us", "brute us", "speedup", "hits/query");
+  std::vector<uint8_t> visible(BOX_COUNT);
+  size_t hits = 0;
+  auto count_hit = [&](uint32_t) { hits++; return true; };
+  double tree_ms = Measure([&] {
+    hits = 0;
+    for (auto& frustum : frustums) {
+      tree.QueryFrustum(frustum, count_hit);
+    }
+  });
+
+  double brute_ms = Measure([&] {
+    for (auto& frustum : frustums) {
+      sink += frustum.TestBoxes(boxes.data(), visible.data(), BOX_COUNT);
+    }
+  });
+
+  PrintRow("frustum", tree_ms, brute_ms, QUERY_COUNT, hits);
+
+  tree_ms = Measure([&] {
+    hits = 0;
+    for (auto& region : regions) {
+      tree.QueryBox(region, count_hit);
+    }
+  });
+
+  brute_ms = Measure([&] {
+    for (auto& region : regions) {
+      for (auto& box : boxes) {
+        sink += (Overlaps(box, region) ? 1 : 0);
+      }
+    }
+  });
+
+  PrintRow("box", tree_ms, brute_ms, QUERY_COUNT, hits);
+
+  tree_ms = Measure([&] {
+    hits = 0;
+    for (auto& sphere : spheres) {
+      tree.QuerySphere(sphere, count_hit);
+    }
+  });
+
+  brute_ms = Measure([&] {
+    for (auto& sphere : spheres) {
+      for (auto& box : boxes) {
+        sink += (Overlaps(box, sphere) ? 1 : 0);
+      }
+    }
+  });
+
+  PrintRow("sphere", tree_ms, brute_ms, QUERY_COUNT, hits);
+
+  // nearest hit, as picking does
+  tree_ms = Measure([&] {
+    hits = 0;
+    for (auto& r : rays) {
+      float nearest = WORLD_SIZE;
+      tree.RayCast(r, WORLD_SIZE, [&](uint32_t, float t) {
+        nearest = std::min(nearest, t);
+        return nearest;
+      });
+
+      hits += (nearest < WORLD_SIZE ? 1 : 0);
+    }
+  });
+
+  brute_ms = Measure([&] {
+    for (auto& r : rays) {
+      glm::vec3 inv_dir = glm::vec3(1.0f) / r.direction;
+      float nearest = WORLD_SIZE, t;
+      for (auto& box : boxes) {
+        if (IntersectRay(box, r.origin, inv_dir, nearest, &t)) {
+          nearest = t;
+        }
+      }
+
+      sink += (nearest < WORLD_SIZE ? 1 : 0);
+    }
+  });
+
+  PrintRow("ray", tree_ms, brute_ms, QUERY_COUNT, hits);
+
+  // a scene where 1% of the objects move each frame -- mostly small steps, with a few teleports.
+  // each frame ends with a frustum query, which brings the index up to date first
+  std::printf("\n%zu objects, %zu moving per frame\n", SCENE_COUNT, MOVERS);
+  std::printf("%-10s %12s %12s %12s\n", "motion", "update ms", "index ms", "query ms");
+  auto root = std::make_shared<Empty>(nullptr);
+  std::vector<std::shared_ptr<BoxEmpty>> objects;
+  for (size_t i = 0; i < SCENE_COUNT; i++) {
+    auto object = std::make_shared<BoxEmpty>(aabb { glm::vec3(-0.5f), glm::vec3(0.5f) });
+    object->SetPosition(glm::vec3(pos(gen), pos(gen), pos(gen)));
+    root->AddChild(object);
+    objects.push_back(object);
+  }
+
+  auto transforms = root->GetTransformHierarchy();
+  start = std::chrono::high_resolution_clock::now();
+  transforms->GetSpatialIndex();
+  double first_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  std::printf("%-10s %12s %12.2f\n", "first", "", first_ms);
+
+  typedef std::chrono::high_resolution_clock clock;
+  auto Elapsed = [](clock::time_point a, clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+  };
+
+  const char* motions[] = { "nudge", "teleport" };
+  for (int m = 0; m < 2; m++) {
+    double update_ms = 0.0, index_ms = 0.0, query_ms = 0.0;
+    const int frames = 50;
+    for (int f = 0; f < frames; f++) {
+      for (size_t i = 0; i < MOVERS; i++) {
+        auto& object = objects[gen() % SCENE_COUNT];
+        glm::vec3 step = (m == 0 ? glm::vec3(unit(gen), unit(gen), unit(gen)) * 0.5f
+                                 : glm::vec3(pos(gen), pos(gen), pos(gen)) - object->GetPosition());
+        object->SetPosition(object->GetPosition() + step);
+      }
+
+      auto t0 = clock::now();
+      transforms->Update();
+      auto t1 = clock::now();
+      const BoundingVolumeTree& index = transforms->GetSpatialIndex();
+      auto t2 = clock::now();
+      index.QueryFrustum(frustums[f], [&](uint32_t) { sink++; return true; });
+      auto t3 = clock::now();
+      update_ms += Elapsed(t0, t1);
+      index_ms += Elapsed(t1, t2);
+      query_ms += Elapsed(t2, t3);
+    }
+
+    std::printf("%-10s %12.3f %12.3f %12.3f\n", motions[m], update_ms / frames, index_ms / frames, query_ms / frames);
+  }
+
+  return (sink == 0xdeadbeef ? 1 : 0);
+}
@@ -0,0 +1,201 @@
+// measures how quickly several threads can spawn objects at once, as loader threads do when
+// building scenes. first just the IDs -- the old locked generator against the lock-free one,
+// drawing one at a time and in blocks -- then whole objects, each thread filling its own scene,
+// then whole objects with every thread filling the same scene.
+
+#include <critter/Empty.hpp>
+#include <critter/ObjectRegistry.hpp>
+#include <critter/TransformHierarchy.hpp>
+#include <engine/Context.hpp>
+#include <utils/IDGenerator.hpp>
+
+#include "LegacyIDGenerator.hpp"
+
+#include "../TestScene.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace ::monkeysworld;
+using critter::Empty;
+using critter::GameObject;
+using critter::Object;
+using critter::ObjectRegistry;
+using critter::TransformHierarchy;
+using utils::IDGenerator;
+using utils::id_block;
+
+static const int THREAD_COUNTS[] = { 1, 2, 4, 8, 16 };
+static const int IDS_PER_THREAD = 1000000;
+static const int OBJECTS_PER_THREAD = 50000;
+static const uint64_t BLOCK_SIZE = 256;
+static const int RUNS = 3;
+
+static std::atomic<uint64_t> sink;
+
+/**
+ *  Just enough of a context for a scene to be built on its own thread.
+ */
+class SceneContext : public engine::Context {
+ public:
+  SceneContext() : transforms_(std::make_shared<TransformHierarchy>()), registry_(std::make_shared<ObjectRegistry>()) {}
+  std::shared_ptr<file::CachedFileLoader> GetCachedFileLoader() override { return nullptr; }
+  std::shared_ptr<input::EventManager> GetEventManager() override { return nullptr; }
+  std::shared_ptr<audio::AudioManager> GetAudioManager() override { return nullptr; }
+  std::shared_ptr<engine::Executor<engine::EngineExecutor>> GetExecutor() override { return nullptr; }
+  std::shared_ptr<TransformHierarchy> GetTransformHierarchy() override { return transforms_; }
+  std::shared_ptr<ObjectRegistry> GetObjectRegistry() override { return registry_; }
+  std::shared_ptr<shader::Framebuffer> GetLastFrame() override { return nullptr; }
+  std::shared_ptr<shader::FramebufferPool> GetFramebufferPool() override { return nullptr; }
+  void GetFramebufferSize(int* width, int* height) override { *width = *height = 0; }
+  std::shared_ptr<engine::SceneSwap> SwapScene(engine::Scene* scene) override { return nullptr; }
+  engine::Scene* GetScene() override { return nullptr; }
+  double GetDeltaTime() override { return 0.0; }
+
+ private:
+  std::shared_ptr<TransformHierarchy> transforms_;
+  std::shared_ptr<ObjectRegistry> registry_;
+};
+
+/**
+ *  Runs `func(thread_index)` on `threads` threads at once.
+ *  @returns the best of RUNS runs, in milliseconds.
+ */
+template <typename Func>
+static double MeasureThreads(int threads, Func func) {
+  double best = 1e30;
+  for (int r = 0; r < RUNS; r++) {
+    std::vector<std::thread> workers;
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    for (int i = 0; i < threads; i++) {
+      workers.push_back(std::thread([&, i] {
+        ready++;
+        while (!go.load());
+        func(i);
+      }));
+    }
+
+    while (ready.load() < threads);
+    auto start = std::chrono::high_resolution_clock::now();
+    go.store(true);
+    for (auto& t : workers) {
+      t.join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  return best;
+}
+
+/**
+ *  @returns millions of things per second, given how many were made in `ms` milliseconds.
+ */
+static double Rate(double count, double ms) {
+  return count / (ms * 1e3);
+}
+
+int main(int argc, char** argv) {
+  testscene::QuietLogs();
+
+  std::printf("million IDs/sec\n");
+  std::printf("%-8s %12s %12s %12s\n", "threads", "legacy", "lock-free", "blocks");
+  for (int threads : THREAD_COUNTS) {
+    legacyid::IDGenerator legacy;
+    double legacy_ms = MeasureThreads(threads, [&](int) {
+      uint64_t sum = 0;
+      for (int i = 0; i < IDS_PER_THREAD; i++) {
+        sum += legacy.GetUniqueId();
+      }
+
+      sink += sum;
+    });
+
+    IDGenerator gen;
+    double single_ms = MeasureThreads(threads, [&](int) {
+      uint64_t sum = 0;
+      for (int i = 0; i < IDS_PER_THREAD; i++) {
+        sum += gen.GetUniqueId();
+      }
+
+      sink += sum;
+    });
+
+    double block_ms = MeasureThreads(threads, [&](int) {
+      uint64_t sum = 0;
+      id_block block = { 0, 0 };
+      for (int i = 0; i < IDS_PER_THREAD; i++) {
+        if (block.first == block.end) {
+          block = gen.GetUniqueIds(BLOCK_SIZE);
+        }
+
+        sum += block.first++;
+      }
+
+      sink += sum;
+    });
+
+    double total = static_cast<double>(threads) * IDS_PER_THREAD;
+    std::printf("%-8d %12.1f %12.1f %12.1f\n", threads, Rate(total, legacy_ms), Rate(total, single_ms), Rate(total, block_ms));
+  }
+
+  // each thread builds a flat scene of its own, which is safe: only the ID generator is shared
+  std::printf("\nmillion objects/sec, one scene per thread\n");
+  std::printf("%-8s %12s %12s\n", "threads", "shared", "blocks");
+  for (int threads : THREAD_COUNTS) {
+    auto spawn = [](bool use_blocks) {
+      std::unique_ptr<GameObject::IdBlockScope> scope;
+      if (use_blocks) {
+        scope = std::make_unique<GameObject::IdBlockScope>(BLOCK_SIZE);
+      }
+
+      SceneContext ctx;
+      auto root = std::make_shared<Empty>(&ctx);
+      for (int i = 0; i < OBJECTS_PER_THREAD; i++) {
+        root->AddChild(std::make_shared<Empty>(&ctx));
+      }
+
+      sink += root->GetChildSpan().GetSize();
+    };
+
+    double shared_ms = MeasureThreads(threads, [&](int) { spawn(false); });
+    double block_ms = MeasureThreads(threads, [&](int) { spawn(true); });
+    double total = static_cast<double>(threads) * OBJECTS_PER_THREAD;
+    std::printf("%-8d %12.2f %12.2f\n", threads, Rate(total, shared_ms), Rate(total, block_ms));
+  }
+
+  // every thread hangs its objects off a root of its own, but they all share one scene --
+  // and so one transform hierarchy and one registry
+  std::printf("\nmillion objects/sec, one scene shared by every thread\n");
+  std::printf("%-8s %12s %12s\n", "threads", "shared", "blocks");
+  for (int threads : THREAD_COUNTS) {
+    auto spawn = [](SceneContext* ctx, bool use_blocks) {
+      std::unique_ptr<GameObject::IdBlockScope> scope;
+      if (use_blocks) {
+        scope = std::make_unique<GameObject::IdBlockScope>(BLOCK_SIZE);
+      }
+
+      auto root = std::make_shared<Empty>(ctx);
+      for (int i = 0; i < OBJECTS_PER_THREAD; i++) {
+        root->AddChild(std::make_shared<Empty>(ctx));
+      }
+
+      sink += root->GetChildSpan().GetSize();
+    };
+
+    SceneContext ctx;
+    double shared_ms = MeasureThreads(threads, [&](int) { spawn(&ctx, false); });
+    double block_ms = MeasureThreads(threads, [&](int) { spawn(&ctx, true); });
+    double total = static_cast<double>(threads) * OBJECTS_PER_THREAD;
+    std::printf("%-8d %12.2f %12.2f\n", threads, Rate(total, shared_ms), Rate(total, block_ms));
+  }
+
+  return (sink == 0xdeadbeef ? 1 : 0);
+}
@@ -0,0 +1,93 @@
+// compares the work-stealing loader pool with the original single-queue pool.
+// scenarios: 10k tiny tasks, and 100 large tasks, each submitted from a single thread.
+
+#include <file/LoaderThreadPool.hpp>
+
+#include "LegacyThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+using ::monkeysworld::file::LoaderThreadPool;
+
+static const int THREADS = 8;
+static const int ITERATIONS = 5;
+
+static std::atomic<uint64_t> sink;
+
+/**
+ *  Burns a little CPU, so that the compiler can't drop the task.
+ */
+static void Work(int iterations) {
+  double acc = 0.0;
+  for (int i = 0; i < iterations; i++) {
+    acc += std::sqrt(static_cast<double>(i) + acc);
+  }
+
+  sink.fetch_add(static_cast<uint64_t>(acc), std::memory_order_relaxed);
+}
+
+/**
+ *  Submits `count` tasks to `pool`, and waits for all of them to complete.
+ *  @returns wall time in milliseconds.
+ */
+template <typename Pool>
+static double RunTasks(Pool& pool, int count, int work) {
+  std::atomic<int> remaining(count);
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < count; i++) {
+    pool.AddTaskToQueue([&remaining, work] {
+      Work(work);
+      remaining.fetch_sub(1);
+    });
+  }
+
+  while (remaining.load() > 0) {
+    std::this_thread::yield();
+  }
+
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+template <typename Pool>
+static double BestOf(int count, int work) {
+  Pool pool(THREADS);
+  double best = 1e30;
+  for (int i = 0; i < ITERATIONS; i++) {
+    best = std::min(best, RunTasks(pool, count, work));
+  }
+
+  return best;
+}
+
+int main(int argc, char** argv) {
+  std::printf("%d threads, best of %d\n", THREADS, ITERATIONS);
+  std::printf("%-24s %14s %14s\n", "scenario", "legacy ms", "stealing ms");
+
+  double legacy_tiny = BestOf<legacypool::LoaderThreadPool>(10000, 10);
+  double current_tiny = BestOf<LoaderThreadPool>(10000, 10);
+  std::printf("%-24s %14.2f %14.2f\n", "10k tiny tasks", legacy_tiny, current_tiny);
+
+  double legacy_large = BestOf<legacypool::LoaderThreadPool>(100, 2000000);
+  double current_large = BestOf<LoaderThreadPool>(100, 2000000);
+  std::printf("%-24s %14.2f %14.2f\n", "100 large tasks", legacy_large, current_large);
+
+  // per-worker stats for a single round of tiny tasks
+  LoaderThreadPool pool(THREADS);
+  RunTasks(pool, 10000, 10);
+  std::printf("\n%-8s %10s %10s %10s\n", "worker", "tasks", "steals", "idle s");
+  auto stats = pool.GetWorkerStats();
+  for (size_t i = 0; i < stats.size(); i++) {
+    std::printf("%-8zu %10llu %10llu %10.4f\n", i,
+                static_cast<unsigned long long>(stats[i].tasks_run),
+                static_cast<unsigned long long>(stats[i].steals),
+                stats[i].idle_seconds);
+  }
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+// measures a frame's worth of transform work on a 100k object scene, with chains 1-32 deep:
+// move 1% of the objects, then fetch every object's world matrix, as lights, cameras and draws do.
+// compares the flat TransformHierarchy against the original recursive lookup.
+
+#include <critter/Empty.hpp>
+
+#include "LegacyTransform.hpp"
+
+#include "../TestScene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using ::monkeysworld::critter::Empty;
+using ::monkeysworld::critter::GameObject;
+
+static const int OBJECT_COUNT = 100000;
+static const int MAX_DEPTH = 32;
+static const int FRAMES = 20;
+static const int MOVES_PER_FRAME = OBJECT_COUNT / 100;
+
+static float sink;
+
+/**
+ *  Builds OBJECT_COUNT nodes as chains of depth 1, 2, ... MAX_DEPTH, 1, 2...
+ *  @param create - returns a new node.
+ *  @param add_child - attaches its second arg beneath its first.
+ *  @returns every node, in creation order.
+ */
+template <typename T, typename Create, typename AddChild>
+static std::vector<std::shared_ptr<T>> BuildScene(Create create, AddChild add_child) {
+  std::vector<std::shared_ptr<T>> res;
+  res.reserve(OBJECT_COUNT);
+  int depth = 0;
+  while (res.size() < OBJECT_COUNT) {
+    depth = (depth % MAX_DEPTH) + 1;
+    std::shared_ptr<T> parent = create();
+    res.push_back(parent);
+    for (int i = 1; i < depth && res.size() < OBJECT_COUNT; i++) {
+      std::shared_ptr<T> child = create();
+      add_child(parent, child);
+      res.push_back(child);
+      parent = child;
+    }
+  }
+
+  return res;
+}
+
+/**
+ *  Runs FRAMES frames over `nodes`.
+ *  @returns the best frame time, in milliseconds.
+ */
+template <typename T>
+static double MeasureFrames(std::vector<std::shared_ptr<T>>& nodes) {
+  double best = 1e30;
+  for (int frame = 0; frame < FRAMES; frame++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < MOVES_PER_FRAME; i++) {
+      // spread out, so that most chains see a move at some depth
+      size_t index = (static_cast<size_t>(i) * 7919 + frame * 31) % nodes.size();
+      nodes[index]->SetPosition(glm::vec3(frame, i, 0));
+    }
+
+    // for the flat hierarchy, the first lookup runs its update pass
+    float sum = 0.0f;
+    for (auto& node : nodes) {
+      sum += node->GetTransformationMatrix()[3][0];
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    sink += sum;
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  return best;
+}
+
+int main(int argc, char** argv) {
+  testscene::QuietLogs();
+  auto legacy = BuildScene<legacytransform::Node>([] {
+    return std::make_shared<legacytransform::Node>();
+  }, [](std::shared_ptr<legacytransform::Node>& parent, std::shared_ptr<legacytransform::Node>& child) {
+    parent->AddChild(child);
+  });
+
+  auto current = BuildScene<GameObject>([] {
+    return std::static_pointer_cast<GameObject>(std::make_shared<Empty>(nullptr));
+  }, [](std::shared_ptr<GameObject>& parent, std::shared_ptr<GameObject>& child) {
+    parent->AddChild(child);
+  });
+
+  std::printf("%d objects, depths 1-%d, %d moves per frame, best of %d frames\n",
+              OBJECT_COUNT, MAX_DEPTH, MOVES_PER_FRAME, FRAMES);
+  double legacy_ms = MeasureFrames(legacy);
+  double current_ms = MeasureFrames(current);
+
+  std::printf("%-10s %12s\n", "path", "ms/frame");
+  std::printf("%-10s %12.2f\n", "legacy", legacy_ms);
+  std::printf("%-10s %12.2f\n", "flat", current_ms);
+  return (sink != 0.0f ? 0 : 1);
+}
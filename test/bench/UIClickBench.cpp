@@ -0,0 +1,142 @@
+// measures dispatching 10000 clicks into a UI of 10000 widgets, laid out either flat in one
+// group or as 100 panels of 100 widgets. the original dispatch copied and checked every child of
+// each group it passed through. now each group searches a bounding volume tree of its children,
+// built on the first click ("build ms") and kept up to date as they move.
+
+#include <critter/ui/UIGroup.hpp>
+
+#include "LegacyUIClick.hpp"
+
+#include "../TestScene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+using ::monkeysworld::critter::ui::UIGroup;
+using ::monkeysworld::critter::ui::UIObject;
+using ::monkeysworld::input::MouseEvent;
+using ::monkeysworld::shader::Canvas;
+
+static const int WIDGETS = 10000;
+static const int CLICKS = 10000;
+static const int RUNS = 5;
+
+static size_t sink;
+
+/**
+ *  UI object which draws nothing, and takes every click.
+ */
+class ClickableUIObject : public UIObject {
+ public:
+  ClickableUIObject() : UIObject(nullptr) {}
+  void DrawUI(glm::vec2 min, glm::vec2 max, Canvas canvas) override {}
+  bool OnClick(const MouseEvent& e) override {
+    sink++;
+    return true;
+  }
+};
+
+/**
+ *  Fills `group` with a `count` x `count` grid of cells, `size` pixels each.
+ *  Each cell gets a widget, or a panel filled the same way if `nested` is set.
+ */
+static void FillGrid(std::shared_ptr<UIGroup> group, int count, float size, bool nested) {
+  group->SetDimensions(glm::vec2(count * size));
+  for (int y = 0; y < count; y++) {
+    for (int x = 0; x < count; x++) {
+      std::shared_ptr<UIObject> cell;
+      if (nested) {
+        auto panel = std::make_shared<UIGroup>(nullptr);
+        FillGrid(panel, count, size / count, false);
+        cell = panel;
+      } else {
+        cell = std::make_shared<ClickableUIObject>();
+        // a gap between widgets, so some clicks miss
+        cell->SetDimensions(glm::vec2(size - 2));
+      }
+
+      cell->SetPosition(glm::vec2(x * size, y * size));
+      group->AddChild(cell);
+    }
+  }
+}
+
+/**
+ *  @returns the best of RUNS runs of `func`, in milliseconds.
+ */
+template <typename Func>
+static double Measure(Func func) {
+  double best = 1e30;
+  for (int i = 0; i < RUNS; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  return best;
+}
+
+int main(int argc, char** argv) {
+  testscene::QuietLogs();
+
+  std::printf("%-8s %12s %12s %12s %10s\n", "layout", "linear us", "indexed us", "build ms", "speedup");
+  for (bool nested : { false, true }) {
+    auto root = std::make_shared<UIGroup>(nullptr);
+    if (nested) {
+      FillGrid(root, 10, 1000.0f, true);
+    } else {
+      FillGrid(root, 100, 10.0f, false);
+    }
+
+    std::mt19937 gen(1);
+    std::vector<MouseEvent> clicks(CLICKS);
+    for (auto& e : clicks) {
+      e = {};
+      e.local_pos = e.absolute_pos = glm::vec2(gen() % 100000, gen() % 100000) / 100.0f;
+    }
+
+    double linear_ms = Measure([&] {
+      for (auto& e : clicks) {
+        legacyui::HandleClickEvent(root.get(), e);
+      }
+    });
+
+    // the first click into each group builds its index -- time clicks which pass through
+    // every group of a fresh tree, then clicks with the indices in place
+    double build_ms = 1e30;
+    for (int i = 0; i < RUNS; i++) {
+      auto fresh = std::make_shared<UIGroup>(nullptr);
+      FillGrid(fresh, (nested ? 10 : 100), (nested ? 1000.0f : 10.0f), nested);
+      auto children = fresh->GetChildren();
+      auto start = std::chrono::high_resolution_clock::now();
+      for (auto& child : children) {
+        MouseEvent e = {};
+        e.local_pos = std::static_pointer_cast<UIObject>(child)->GetPosition();
+        fresh->HandleClickEvent(e);
+        if (!nested) {
+          // one is enough
+          break;
+        }
+      }
+
+      auto end = std::chrono::high_resolution_clock::now();
+      build_ms = std::min(build_ms, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    double indexed_ms = Measure([&] {
+      for (auto& e : clicks) {
+        root->HandleClickEvent(e);
+      }
+    });
+
+    std::printf("%-8s %12.3f %12.3f %12.2f %9.1fx\n", (nested ? "nested" : "flat"),
+                linear_ms * 1e3 / CLICKS, indexed_ms * 1e3 / CLICKS, build_ms, linear_ms / indexed_ms);
+  }
+
+  return (sink == 0xdeadbeef ? 1 : 0);
+}
@@ -0,0 +1,114 @@
+// measures building and laying out one very wide UI group: adding each child, then a layout
+// pass over a column where every child hangs off the one before it. both used to search the
+// whole group for every child they touched.
+
+#include <critter/ui/UIGroup.hpp>
+
+#include "../TestScene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using ::monkeysworld::critter::ui::UIGroup;
+using ::monkeysworld::critter::ui::UIObject;
+using ::monkeysworld::critter::ui::layout::Face;
+using ::monkeysworld::critter::ui::layout::UILayoutParams;
+using ::monkeysworld::shader::Canvas;
+
+static const size_t CHILD_COUNTS[] = { 1000, 10000 };
+static const int RUNS = 5;
+
+static size_t sink;
+
+/**
+ *  UI object which draws nothing.
+ */
+class BlankUIObject : public UIObject {
+ public:
+  BlankUIObject() : UIObject(nullptr) {}
+  void DrawUI(glm::vec2 min, glm::vec2 max, Canvas canvas) override {}
+};
+
+/**
+ *  @returns the best of RUNS runs of `func`, in milliseconds.
+ */
+template <typename Func>
+static double Measure(Func func) {
+  double best = 1e30;
+  for (int i = 0; i < RUNS; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  return best;
+}
+
+/**
+ *  @returns `count` children, each anchored below the one before it. the first hangs off the group.
+ */
+static std::vector<std::shared_ptr<BlankUIObject>> CreateColumn(uint64_t group_id, size_t count) {
+  std::vector<std::shared_ptr<BlankUIObject>> column;
+  uint64_t anchor = group_id;
+  Face face = Face::TOP;
+  for (size_t i = 0; i < count; i++) {
+    auto child = std::make_shared<BlankUIObject>();
+    child->SetDimensions(glm::vec2(100, 20));
+    UILayoutParams params = child->GetLayoutParams();
+    params.top.anchor_id = anchor;
+    params.top.anchor_face = face;
+    params.top.margin = 2.0f;
+    child->SetLayoutParams(params);
+    column.push_back(child);
+
+    anchor = child->GetId();
+    face = Face::BOTTOM;
+  }
+
+  return column;
+}
+
+int main(int argc, char** argv) {
+  testscene::QuietLogs();
+
+  std::printf("%-10s %12s %12s %12s\n", "children", "add ms", "layout ms", "lookup us");
+  for (size_t count : CHILD_COUNTS) {
+    double add_ms = 1e30;
+    std::shared_ptr<UIGroup> group;
+    for (int i = 0; i < RUNS; i++) {
+      group = std::make_shared<UIGroup>(nullptr);
+      group->SetDimensions(glm::vec2(100, 1 << 20));
+      auto column = CreateColumn(group->GetId(), count);
+      auto start = std::chrono::high_resolution_clock::now();
+      for (auto& child : column) {
+        group->AddChild(child);
+      }
+
+      auto end = std::chrono::high_resolution_clock::now();
+      add_ms = std::min(add_ms, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    // resizing the head of the column moves everything after it, so each pass solves every child
+    auto head = std::static_pointer_cast<UIObject>(group->GetChildren().front());
+    int height = 20;
+    double layout_ms = Measure([&] {
+      head->SetDimensions(glm::vec2(100, ++height));
+      group->Layout(group->GetDimensions());
+    });
+
+    auto children = group->GetChildren();
+    double lookup_ms = Measure([&] {
+      for (auto& child : children) {
+        sink += (group->GetChild(child->GetId()) != nullptr ? 1 : 0);
+      }
+    });
+
+    std::printf("%-10zu %12.2f %12.2f %12.3f\n", count, add_ms, layout_ms, lookup_ms * 1e3 / count);
+  }
+
+  return (sink == 0xdeadbeef ? 1 : 0);
+}
@@ -0,0 +1,115 @@
+// measures laying out a grid of 5000 anchored widgets -- each hangs off its neighbors above and
+// to the left -- when one widget changes size every frame. the original layout solved every
+// widget, every pass. now only the changed widget and whatever is anchored after it are solved.
+
+#include <critter/ui/UIGroup.hpp>
+
+#include "../LegacyUILayout.hpp"
+
+#include "../TestScene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+using ::monkeysworld::critter::ui::UIGroup;
+using ::monkeysworld::critter::ui::UIObject;
+using ::monkeysworld::critter::ui::layout::Face;
+using ::monkeysworld::critter::ui::layout::UILayoutParams;
+using ::monkeysworld::shader::Canvas;
+
+static const int COLUMNS = 50;
+static const int ROWS = 100;
+static const int FRAMES = 500;
+static const int RUNS = 5;
+
+static size_t sink;
+
+/**
+ *  UI object which draws nothing.
+ */
+class BlankUIObject : public UIObject {
+ public:
+  BlankUIObject() : UIObject(nullptr) {}
+  void DrawUI(glm::vec2 min, glm::vec2 max, Canvas canvas) override {}
+};
+
+/**
+ *  @returns a group holding a COLUMNS x ROWS grid of widgets, each anchored below the widget
+ *           above it and right of the widget to its left. Widgets are returned row by row.
+ */
+static std::shared_ptr<UIGroup> CreateGrid(std::vector<std::shared_ptr<BlankUIObject>>* widgets) {
+  auto group = std::make_shared<UIGroup>(nullptr);
+  group->SetDimensions(glm::vec2(COLUMNS * 64, ROWS * 32));
+  widgets->clear();
+  for (int y = 0; y < ROWS; y++) {
+    for (int x = 0; x < COLUMNS; x++) {
+      auto widget = std::make_shared<BlankUIObject>();
+      widget->SetDimensions(glm::vec2(40, 20));
+      UILayoutParams params = widget->GetLayoutParams();
+      params.top.anchor_id = (y == 0 ? group->GetId() : (*widgets)[(y - 1) * COLUMNS + x]->GetId());
+      params.top.anchor_face = (y == 0 ? Face::TOP : Face::BOTTOM);
+      params.top.margin = 4.0f;
+      params.left.anchor_id = (x == 0 ? group->GetId() : widgets->back()->GetId());
+      params.left.anchor_face = (x == 0 ? Face::LEFT : Face::RIGHT);
+      params.left.margin = 4.0f;
+      widget->SetLayoutParams(params);
+      group->AddChild(widget);
+      widgets->push_back(widget);
+    }
+  }
+
+  return group;
+}
+
+/**
+ *  Lays out FRAMES frames, each after resizing one random widget.
+ *  @param incremental - whether to use UIGroup's own layout, or the original solver.
+ *  @returns the best of RUNS runs, in microseconds per frame.
+ */
+static double MeasureFrames(bool incremental, uint64_t* solved) {
+  double best = 1e30;
+  for (int i = 0; i < RUNS; i++) {
+    std::vector<std::shared_ptr<BlankUIObject>> widgets;
+    auto group = CreateGrid(&widgets);
+    // first pass lays out everything either way
+    group->Layout(group->GetDimensions());
+
+    std::mt19937 gen(1);
+    *solved = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+      auto& widget = widgets[gen() % widgets.size()];
+      widget->SetDimensions(glm::vec2(40 + gen() % 8, 20 + gen() % 8));
+      if (incremental) {
+        group->Layout(group->GetDimensions());
+        *solved += group->GetLayoutStats().solved;
+      } else {
+        legacyui::Layout(group.get());
+        *solved += widgets.size();
+      }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::micro>(end - start).count() / FRAMES);
+    sink += static_cast<size_t>(widgets.back()->GetPosition().y);
+  }
+
+  return best;
+}
+
+int main(int argc, char** argv) {
+  testscene::QuietLogs();
+
+  std::printf("%-12s %12s %14s\n", "layout", "us/frame", "solved/frame");
+  uint64_t solved;
+  double legacy_us = MeasureFrames(false, &solved);
+  std::printf("%-12s %12.1f %14.1f\n", "full", legacy_us, static_cast<double>(solved) / FRAMES);
+  double incremental_us = MeasureFrames(true, &solved);
+  std::printf("%-12s %12.1f %14.1f\n", "incremental", incremental_us, static_cast<double>(solved) / FRAMES);
+  std::printf("speedup: %.1fx\n", legacy_us / incremental_us);
+  return (sink == 0xdeadbeef ? 1 : 0);
+}
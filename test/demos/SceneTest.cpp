@@ -91,11 +91,10 @@ class RatModel2 : public Model {
   }
 
   void RenderMaterial(const RenderContext& rc) override {
-    glm::mat4 tf_matrix = GetTransformationMatrix();
     camera_info cam = rc.GetActiveCamera();
     m.SetSpotlights(rc.GetSpotlights());
     spotlight_info i = rc.GetSpotlights()[0];
-    m.SetModelTransforms(tf_matrix);
+    m.SetModelTransforms(rc.GetModelMatrix(), rc.GetNormalMatrix());
     m.SetCameraTransforms(cam.vp_matrix);
     m.SetSurfaceColor(glm::vec4(0.0, 1.0, 0.0, 1.0));
     m.UseMaterial();
@@ -121,12 +120,11 @@ class RatModel : public Model {
   }
 
   void RenderMaterial(const RenderContext& rc) override {
-    glm::mat4 tf_matrix = GetTransformationMatrix();
     camera_info cam = rc.GetActiveCamera();
     // matte material doesn't accept spotlights!
     m.SetSpotlights(rc.GetSpotlights());
     spotlight_info i = rc.GetSpotlights()[0];
-    m.SetModelTransforms(tf_matrix);
+    m.SetModelTransforms(rc.GetModelMatrix(), rc.GetNormalMatrix());
     m.SetCameraTransforms(cam.vp_matrix);
     m.SetSurfaceColor(glm::vec4(1.0, 0.6, 0.0, 1.0));
     m.UseMaterial();
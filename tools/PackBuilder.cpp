@@ -0,0 +1,54 @@
+// builds an asset pack from an existing cache record list.
+// usage: pack-builder <path to .cache> [path to output .pack]
+// if no output is provided, the pack is written next to the cache, with a .pack extension.
+// run from the directory containing resources/, so that cached paths resolve.
+
+#include <file/AssetPack.hpp>
+#include <file/CachedFileLoader.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+using ::monkeysworld::file::AssetPack;
+using ::monkeysworld::file::CachedFileLoader;
+using ::monkeysworld::file::WriteAssetPack;
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s <cache file> [pack file]\n", argv[0]);
+    return 1;
+  }
+
+  std::string cache_path = argv[1];
+  std::string pack_path;
+  if (argc > 2) {
+    pack_path = argv[2];
+  } else {
+    pack_path = std::filesystem::path(cache_path).replace_extension(".pack").string();
+  }
+
+  auto records = CachedFileLoader::ReadCacheFileToVector(cache_path);
+  if (records.empty()) {
+    std::fprintf(stderr, "no records found in %s\n", cache_path.c_str());
+    return 1;
+  }
+
+  if (!WriteAssetPack(pack_path, records)) {
+    std::fprintf(stderr, "failed to write %s\n", pack_path.c_str());
+    return 1;
+  }
+
+  auto pack = AssetPack::Open(pack_path);
+  if (!pack) {
+    std::fprintf(stderr, "wrote %s, but it could not be read back\n", pack_path.c_str());
+    return 1;
+  }
+
+  std::printf("packed %llu of %zu records into %s (%llu bytes)\n",
+              static_cast<unsigned long long>(pack->GetEntryCount()),
+              records.size(),
+              pack_path.c_str(),
+              static_cast<unsigned long long>(std::filesystem::file_size(pack_path)));
+  return 0;
+}